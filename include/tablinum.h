@@ -25,7 +25,21 @@ typedef enum tbl_role_e {
     TBL_ROLE_PACKAGE,
     TBL_ROLE_VERIFY_PACKAGE,
     TBL_ROLE_INGEST_PACKAGE,
-    TBL_ROLE_VERIFY_AUDIT
+    TBL_ROLE_VERIFY_AUDIT,
+    TBL_ROLE_SPOOL_PRUNE,
+    TBL_ROLE_AUDIT_PROOF,
+    TBL_ROLE_EVENTS_INDEX,
+    TBL_ROLE_MIGRATE_JOBS,
+    TBL_ROLE_EVENTS,
+    TBL_ROLE_COMPRESS_AUDIT,
+    TBL_ROLE_REFS,
+    TBL_ROLE_RECORDS,
+    TBL_ROLE_MIGRATE_RECORDS,
+    TBL_ROLE_STATS,
+    TBL_ROLE_SEARCH,
+    TBL_ROLE_FIND,
+    TBL_ROLE_TAGGED,
+    TBL_ROLE_VERIFY_ALL
 } tbl_role_t;
 
 /* Packaging kinds (E-ARK inspired, OAIS-light). */
@@ -43,10 +57,69 @@ typedef struct tbl_app_config_s {
     const char *jobid;       /* verify/export/package: job id (job directory name) */
     const char *out_dir;     /* export/package: output directory */
     const char *pkg_dir;     /* verify-package/ingest-package: package directory */
+    const char *refs_sha;    /* refs: sha256 (64 hex) of a CAS object */
+    const char *search_query; /* search: full-text query (one argument) */
+    const char *find_fragment; /* find: part of a job id or payload name */
+    const char *tag_query;   /* tagged: KEY=VALUE */
 
     /* package: AIP/SIP kind */
     tbl_pkg_kind_t pkg_kind;
     int pkg_kind_set; /* strict: if set but role!=package => error */
+
+    /* spool-prune: retention in days */
+    unsigned long older_than_days;
+    int older_than_set; /* strict: if set but role!=spool-prune => error */
+
+    /* index: also write the columnar snapshot index/records.col */
+    int index_snapshot; /* strict: if set but role!=index => error */
+
+    /* index: rebuild records.idx, refs.idx, sec runs, trigram.idx and
+       tags.idx from the records (default: only feed the full-text index) */
+    int index_rebuild; /* strict: if set but role!=index => error */
+
+    /* index: drop cursors/fts and rebuild the full-text index from offset 0 */
+    int index_reset_cursor; /* strict: if set but role!=index => error */
+
+    /* verify-audit: rehash the whole log (the default; kept for scripts);
+       events-index: rebuild from the whole legacy events.log;
+       verify-all: ignore the checkpoint and start a new pass */
+    int audit_full; /* strict: if set but role!=verify-audit/events-index/verify-all => error */
+
+    /* verify-audit: resume after audit/ops.checkpoint; the prefix before
+       it is only anchor-checked, not rehashed */
+    int audit_incremental; /* strict: if set but role!=verify-audit, or with --full => error */
+
+    /* verify-all: walk CAS objects instead of records */
+    int scrub_objects; /* strict: if set but role!=verify-all => error */
+
+    /* audit-proof: LINE or JOBID, or --consistency SIZE */
+    const char *proof_target;
+    unsigned long proof_old_size;
+    int proof_old_set; /* strict: if set but role!=audit-proof => error */
+
+    /* events: query filters (NULL = not given); strict: only with events */
+    const char *q_since;
+    const char *q_until;
+    const char *q_event;
+    const char *q_status;
+    const char *q_job;
+
+    /* events: tail the log (--follow), start offset, consumer cursor,
+       publish target (FIFO / Unix socket); strict: only with events
+       (--follow also with index: keep feeding the full-text index) */
+    int q_follow;
+    const char *q_from;
+    const char *q_cursor;
+    const char *q_publish;
+
+    /* records: index order, bytes range, limit, descending; --since,
+       --until and --status are shared with events; strict: only with records
+       (--limit also with search, find and tagged) */
+    const char *q_by;
+    const char *q_min_bytes;
+    const char *q_max_bytes;
+    const char *q_limit;
+    int q_desc;
 } tbl_app_config_t;
 
 #endif /* TABLINUM_H */
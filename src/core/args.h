@@ -35,16 +35,62 @@ static void tbl_usage(const char *prog)
     (void)tbl_fputs3_ok(stdout, "  ", prog, " export  JOBID OUTDIR [--config FILE]\n");
     (void)tbl_fputs3_ok(stdout, "  ", prog, " verify-package PKGDIR\n");
     (void)tbl_fputs3_ok(stdout, "  ", prog, " ingest-package PKGDIR [--config FILE]\n");
-    (void)tbl_fputs3_ok(stdout, "  ", prog, " verify-audit [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " verify-all [--objects] [--full] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " verify-audit [--incremental|--full] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " audit-proof LINE|JOBID [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " audit-proof --consistency SIZE [--config FILE]\n");
     (void)tbl_fputs3_ok(stdout, "  ", prog, " package JOBID OUTDIR [--format aip|sip] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " spool-prune --older-than DAYS [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " index [--rebuild] [--snapshot] [--reset-cursor] [--follow]\n");
+    (void)tbl_fputs_ok(stdout, "          [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " stats [--since T] [--until T] [--status S] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " search \"QUERY\" [--limit N] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " find FRAGMENT [--limit N] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " tagged KEY=VALUE [--limit N] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " refs SHA256 [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " records [--by time|bytes] [--since T] [--until T] [--status S]\n");
+    (void)tbl_fputs_ok(stdout, "          [--min-bytes N] [--max-bytes N] [--desc] [--limit N] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " events-index [--full] [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " migrate-jobs [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " migrate-records [--config FILE]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " events [--since T] [--until T] [--event NAME] [--status S] [--job ID]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " events --follow [--from-offset N] [--cursor NAME] [--publish PATH] [filters]\n");
+    (void)tbl_fputs3_ok(stdout, "  ", prog, " compress-audit [--config FILE]\n");
     (void)tbl_fputs_ok(stdout, "\n");
     (void)tbl_fputs_ok(stdout, "Roles:\n");
-    (void)tbl_fputs_ok(stdout, "  all | serve | ingest | index | worker | verify | export | package | verify-package | ingest-package | verify-audit\n");
+    (void)tbl_fputs_ok(stdout, "  all | serve | ingest | index | worker | verify | export | package | verify-package | ingest-package | verify-audit | spool-prune\n");
+    (void)tbl_fputs_ok(stdout, "  audit-proof | events-index | migrate-jobs | migrate-records | events | compress-audit | refs | records\n");
+    (void)tbl_fputs_ok(stdout, "  stats | search | find | tagged | verify-all\n");
     (void)tbl_fputs_ok(stdout, "\n");
     (void)tbl_fputs_ok(stdout, "Options:\n");
     (void)tbl_fputs_ok(stdout, "  --config FILE        Path to INI config (default: tablinum.ini)\n");
     (void)tbl_fputs_ok(stdout, "  --role ROLE          Role to run (default: all)\n");
     (void)tbl_fputs_ok(stdout, "  --format KIND        Packaging kind for 'package' (aip|sip)\n");
+    (void)tbl_fputs_ok(stdout, "  --older-than DAYS    Retention for 'spool-prune' (jobs older than DAYS)\n");
+    (void)tbl_fputs_ok(stdout, "  --incremental        'verify-audit': resume after audit/ops.checkpoint\n");
+    (void)tbl_fputs_ok(stdout, "                       (older lines only anchor-checked; default: rehash all)\n");
+    (void)tbl_fputs_ok(stdout, "  --full               'verify-audit': rehash all (default);\n");
+    (void)tbl_fputs_ok(stdout, "                       'events-index': rebuild from the whole events.log;\n");
+    (void)tbl_fputs_ok(stdout, "                       'verify-all': ignore the checkpoint, start a new pass\n");
+    (void)tbl_fputs_ok(stdout, "  --objects            'verify-all': rehash all CAS objects instead of records\n");
+    (void)tbl_fputs_ok(stdout, "  --rebuild            'index': rebuild the record, refs, sec, trigram, tag indexes\n");
+    (void)tbl_fputs_ok(stdout, "                       (default: only feed the full-text index)\n");
+    (void)tbl_fputs_ok(stdout, "  --snapshot           'index': also write the columnar index/records.col\n");
+    (void)tbl_fputs_ok(stdout, "  --reset-cursor       'index': rebuild the full-text index from offset 0\n");
+    (void)tbl_fputs_ok(stdout, "  --consistency SIZE   'audit-proof': prove the log of SIZE lines is a prefix\n");
+    (void)tbl_fputs_ok(stdout, "  --since T, --until T 'events'/'records'/'stats': time range [since, until); T = unix seconds,\n");
+    (void)tbl_fputs_ok(stdout, "                       30m/1h/2d ago, or UTC YYYY-MM-DD[THH:MM[:SS]]\n");
+    (void)tbl_fputs_ok(stdout, "  --event NAME         'events': event name or prefix (verify -> verify.*)\n");
+    (void)tbl_fputs_ok(stdout, "  --status S, --job ID 'events': exact status / job id\n");
+    (void)tbl_fputs_ok(stdout, "  --follow             'events': stream new lines as they are appended;\n");
+    (void)tbl_fputs_ok(stdout, "                       'index': keep feeding the full-text index\n");
+    (void)tbl_fputs_ok(stdout, "  --from-offset N      'events': start at byte offset N of events.log\n");
+    (void)tbl_fputs_ok(stdout, "  --cursor NAME        'events': resume from / store to cursors/NAME\n");
+    (void)tbl_fputs_ok(stdout, "  --publish PATH       'events': write lines to a FIFO or Unix socket\n");
+    (void)tbl_fputs_ok(stdout, "  --by time|bytes      'records': index order (default time; status with --status)\n");
+    (void)tbl_fputs_ok(stdout, "  --min-bytes N, --max-bytes N 'records': payload size range\n");
+    (void)tbl_fputs_ok(stdout, "  --desc, --limit N    'records': largest first / at most N records\n");
+    (void)tbl_fputs_ok(stdout, "                       ('search': at most N matches, default 20; 'find', 'tagged': at most N)\n");
     (void)tbl_fputs_ok(stdout, "  --version            Print version\n");
     (void)tbl_fputs_ok(stdout, "  -h, --help           This help\n");
 }
@@ -66,10 +112,76 @@ static int tbl_role_from_str(const char *s, tbl_role_t *out)
     if (tbl_streq(s, "ingest-package")) { *out = TBL_ROLE_INGEST_PACKAGE; return 1; }
     if (tbl_streq(s, "verify-audit")) { *out = TBL_ROLE_VERIFY_AUDIT; return 1; }
     if (tbl_streq(s, "audit-verify")) { *out = TBL_ROLE_VERIFY_AUDIT; return 1; } /* alias */
+    if (tbl_streq(s, "spool-prune")) { *out = TBL_ROLE_SPOOL_PRUNE; return 1; }
+    if (tbl_streq(s, "audit-proof")) { *out = TBL_ROLE_AUDIT_PROOF; return 1; }
+    if (tbl_streq(s, "events-index")) { *out = TBL_ROLE_EVENTS_INDEX; return 1; }
+    if (tbl_streq(s, "migrate-jobs")) { *out = TBL_ROLE_MIGRATE_JOBS; return 1; }
+    if (tbl_streq(s, "migrate-records")) { *out = TBL_ROLE_MIGRATE_RECORDS; return 1; }
+    if (tbl_streq(s, "events")) { *out = TBL_ROLE_EVENTS; return 1; }
+    if (tbl_streq(s, "compress-audit")) { *out = TBL_ROLE_COMPRESS_AUDIT; return 1; }
+    if (tbl_streq(s, "refs")) { *out = TBL_ROLE_REFS; return 1; }
+    if (tbl_streq(s, "records")) { *out = TBL_ROLE_RECORDS; return 1; }
+    if (tbl_streq(s, "stats")) { *out = TBL_ROLE_STATS; return 1; }
+    if (tbl_streq(s, "search")) { *out = TBL_ROLE_SEARCH; return 1; }
+    if (tbl_streq(s, "find")) { *out = TBL_ROLE_FIND; return 1; }
+    if (tbl_streq(s, "tagged")) { *out = TBL_ROLE_TAGGED; return 1; }
+    if (tbl_streq(s, "verify-all")) { *out = TBL_ROLE_VERIFY_ALL; return 1; }
 
     return 0;
 }
 
+/* Subcommands accepted as the first positional token. */
+static int tbl_is_subcmd(const char *a)
+{
+    if (!a) return 0;
+    return (tbl_streq(a, "verify") || tbl_streq(a, "export") || tbl_streq(a, "package") ||
+            tbl_streq(a, "verify-package") || tbl_streq(a, "ingest-package") ||
+            tbl_streq(a, "verify-audit") || tbl_streq(a, "audit-verify") ||
+            tbl_streq(a, "spool-prune") || tbl_streq(a, "audit-proof") ||
+            tbl_streq(a, "index") || tbl_streq(a, "events-index") ||
+            tbl_streq(a, "migrate-jobs") || tbl_streq(a, "migrate-records") ||
+            tbl_streq(a, "events") ||
+            tbl_streq(a, "compress-audit") || tbl_streq(a, "refs") ||
+            tbl_streq(a, "records") || tbl_streq(a, "stats") || tbl_streq(a, "search") ||
+            tbl_streq(a, "find") || tbl_streq(a, "tagged") || tbl_streq(a, "verify-all"));
+}
+
+/* Assign a positional argument for the selected role. Returns 1 if consumed. */
+static int tbl_take_positional(tbl_app_config_t *cfg, const char *a)
+{
+    if (cfg->role == TBL_ROLE_VERIFY) {
+        if (!cfg->jobid) { cfg->jobid = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_EXPORT) {
+        if (!cfg->jobid) { cfg->jobid = a; return 1; }
+        if (!cfg->out_dir) { cfg->out_dir = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_PACKAGE) {
+        if (!cfg->jobid) { cfg->jobid = a; return 1; }
+        if (!cfg->out_dir) { cfg->out_dir = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_VERIFY_PACKAGE) {
+        if (!cfg->pkg_dir) { cfg->pkg_dir = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_INGEST_PACKAGE) {
+        if (!cfg->pkg_dir) { cfg->pkg_dir = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_AUDIT_PROOF) {
+        if (!cfg->proof_target) { cfg->proof_target = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_REFS) {
+        if (!cfg->refs_sha) { cfg->refs_sha = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_SEARCH) {
+        if (!cfg->search_query) { cfg->search_query = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_FIND) {
+        if (!cfg->find_fragment) { cfg->find_fragment = a; return 1; }
+    } else if (cfg->role == TBL_ROLE_TAGGED) {
+        if (!cfg->tag_query) { cfg->tag_query = a; return 1; }
+    }
+    return 0;
+}
+
+static int tbl_days_from_str(const char *s, unsigned long *out)
+{
+    if (!s || !out) return 0;
+    if (!tbl_parse_u32_ok(s, out)) return 0;
+    return (*out <= 36500UL) ? 1 : 0; /* 100 years keeps cutoff math in range */
+}
+
 static int tbl_pkg_from_str(const char *s, tbl_pkg_kind_t *out)
 {
     if (!s || !out) return 0;
@@ -92,6 +204,26 @@ static const char *tbl_match_kv(const char *arg, const char *key)
     return arg + klen + 1;
 }
 
+/* 'events' filters: --NAME VALUE or --NAME=VALUE.
+   Returns 1 consumed, 0 not this option, -1 missing value. */
+static int tbl_take_filter(int argc, char **argv, int *i, const char *name, const char **out)
+{
+    const char *a = argv[*i];
+    const char *v;
+
+    if (tbl_streq(a, name)) {
+        if (*i + 1 >= argc || !argv[*i + 1] || !argv[*i + 1][0]) return -1;
+        (*i)++;
+        *out = argv[*i];
+        return 1;
+    }
+    v = tbl_match_kv(a, name);
+    if (!v) return 0;
+    if (!v[0]) return -1;
+    *out = v;
+    return 1;
+}
+
 static int tbl_is_option(const char *a)
 {
     if (!a || !a[0]) return 0;
@@ -115,8 +247,37 @@ int tbl_args_parse(int argc, char **argv, tbl_app_config_t *cfg)
     cfg->jobid = NULL;
     cfg->out_dir = NULL;
     cfg->pkg_dir = NULL;
+    cfg->refs_sha = NULL;
+    cfg->search_query = NULL;
+    cfg->find_fragment = NULL;
+    cfg->tag_query = NULL;
     cfg->pkg_kind = TBL_PKG_AIP;
     cfg->pkg_kind_set = 0;
+    cfg->older_than_days = 0UL;
+    cfg->older_than_set = 0;
+    cfg->audit_full = 0;
+    cfg->audit_incremental = 0;
+    cfg->scrub_objects = 0;
+    cfg->index_snapshot = 0;
+    cfg->index_rebuild = 0;
+    cfg->index_reset_cursor = 0;
+    cfg->proof_target = NULL;
+    cfg->proof_old_size = 0UL;
+    cfg->proof_old_set = 0;
+    cfg->q_since = NULL;
+    cfg->q_until = NULL;
+    cfg->q_event = NULL;
+    cfg->q_status = NULL;
+    cfg->q_job = NULL;
+    cfg->q_follow = 0;
+    cfg->q_from = NULL;
+    cfg->q_cursor = NULL;
+    cfg->q_publish = NULL;
+    cfg->q_by = NULL;
+    cfg->q_min_bytes = NULL;
+    cfg->q_max_bytes = NULL;
+    cfg->q_limit = NULL;
+    cfg->q_desc = 0;
 
     got_subcmd = 0;
     prog = (argc > 0 && argv && argv[0]) ? argv[0] : TBL_NAME;
@@ -192,6 +353,64 @@ int tbl_args_parse(int argc, char **argv, tbl_app_config_t *cfg)
             continue;
         }
 
+        /* --older-than=DAYS (for 'spool-prune') */
+        v = tbl_match_kv(a, "--older-than");
+        if (v) {
+            if (!tbl_days_from_str(v, &cfg->older_than_days)) {
+                (void)tbl_fputs3_ok(stderr, "error: invalid --older-than: ", v, "\n");
+                return 2;
+            }
+            cfg->older_than_set = 1;
+            continue;
+        }
+
+        /* --consistency=SIZE (for 'audit-proof') */
+        v = tbl_match_kv(a, "--consistency");
+        if (v) {
+            if (!tbl_parse_u32_ok(v, &cfg->proof_old_size) || cfg->proof_old_size == 0UL) {
+                (void)tbl_fputs3_ok(stderr, "error: invalid --consistency: ", v, "\n");
+                return 2;
+            }
+            cfg->proof_old_set = 1;
+            continue;
+        }
+
+        /* --snapshot (for 'index') */
+        if (tbl_streq(a, "--snapshot")) {
+            cfg->index_snapshot = 1;
+            continue;
+        }
+
+        /* --rebuild (for 'index') */
+        if (tbl_streq(a, "--rebuild")) {
+            cfg->index_rebuild = 1;
+            continue;
+        }
+
+        /* --reset-cursor (for 'index') */
+        if (tbl_streq(a, "--reset-cursor")) {
+            cfg->index_reset_cursor = 1;
+            continue;
+        }
+
+        /* --full (for 'verify-audit' / 'events-index' / 'verify-all') */
+        if (tbl_streq(a, "--full")) {
+            cfg->audit_full = 1;
+            continue;
+        }
+
+        /* --incremental (for 'verify-audit') */
+        if (tbl_streq(a, "--incremental")) {
+            cfg->audit_incremental = 1;
+            continue;
+        }
+
+        /* --objects (for 'verify-all') */
+        if (tbl_streq(a, "--objects")) {
+            cfg->scrub_objects = 1;
+            continue;
+        }
+
         /* --config FILE */
         if (tbl_streq(a, "--config")) {
             if (i + 1 >= argc) {
@@ -246,10 +465,85 @@ int tbl_args_parse(int argc, char **argv, tbl_app_config_t *cfg)
             continue;
         }
 
+        /* --older-than DAYS */
+        if (tbl_streq(a, "--older-than")) {
+            if (i + 1 >= argc) {
+                (void)tbl_fputs_ok(stderr, "error: --older-than needs a value\n");
+                return 2;
+            }
+            i++;
+            if (!tbl_days_from_str(argv[i], &cfg->older_than_days)) {
+                (void)tbl_fputs3_ok(stderr, "error: invalid --older-than: ", argv[i] ? argv[i] : "", "\n");
+                return 2;
+            }
+            cfg->older_than_set = 1;
+            continue;
+        }
+
+        /* --consistency SIZE */
+        if (tbl_streq(a, "--consistency")) {
+            if (i + 1 >= argc) {
+                (void)tbl_fputs_ok(stderr, "error: --consistency needs a value\n");
+                return 2;
+            }
+            i++;
+            if (!tbl_parse_u32_ok(argv[i], &cfg->proof_old_size) || cfg->proof_old_size == 0UL) {
+                (void)tbl_fputs3_ok(stderr, "error: invalid --consistency: ", argv[i] ? argv[i] : "", "\n");
+                return 2;
+            }
+            cfg->proof_old_set = 1;
+            continue;
+        }
+
+        /* --follow (for 'events') */
+        if (tbl_streq(a, "--follow")) {
+            cfg->q_follow = 1;
+            continue;
+        }
+
+        /* --desc (for 'records') */
+        if (tbl_streq(a, "--desc")) {
+            cfg->q_desc = 1;
+            continue;
+        }
+
+        /* --since/--until/--event/--status/--job/--from-offset/--cursor/--publish (for 'events'),
+           --by/--min-bytes/--max-bytes/--limit (for 'records') */
+        {
+            static const char *const names[12] = { "--since", "--until", "--event", "--status", "--job",
+                                                   "--from-offset", "--cursor", "--publish",
+                                                   "--by", "--min-bytes", "--max-bytes", "--limit" };
+            const char **outs[12];
+            int k;
+            int t;
+
+            outs[0] = &cfg->q_since;
+            outs[1] = &cfg->q_until;
+            outs[2] = &cfg->q_event;
+            outs[3] = &cfg->q_status;
+            outs[4] = &cfg->q_job;
+            outs[5] = &cfg->q_from;
+            outs[6] = &cfg->q_cursor;
+            outs[7] = &cfg->q_publish;
+            outs[8] = &cfg->q_by;
+            outs[9] = &cfg->q_min_bytes;
+            outs[10] = &cfg->q_max_bytes;
+            outs[11] = &cfg->q_limit;
+            t = 0;
+            for (k = 0; k < 12 && t == 0; ++k) {
+                t = tbl_take_filter(argc, argv, &i, names[k], outs[k]);
+                if (t < 0) {
+                    (void)tbl_fputs3_ok(stderr, "error: ", names[k], " needs a value\n");
+                    return 2;
+                }
+            }
+            if (t) continue;
+        }
+
         /* Non-option token (subcommand/positional). */
         if (!tbl_is_option(a)) {
-            /* allow "verify" / "export" as subcommand */
-            if (!got_subcmd && (tbl_streq(a, "verify") || tbl_streq(a, "export") || tbl_streq(a, "package") || tbl_streq(a, "verify-package") || tbl_streq(a, "ingest-package") || tbl_streq(a, "verify-audit") || tbl_streq(a, "audit-verify"))) {
+            /* allow "verify" / "export" / ... as subcommand */
+            if (!got_subcmd && tbl_is_subcmd(a)) {
                 got_subcmd = 1;
                 if (!tbl_role_from_str(a, &cfg->role)) {
                     (void)tbl_fputs3_ok(stderr, "error: unknown subcommand: ", a, "\n");
@@ -258,29 +552,8 @@ int tbl_args_parse(int argc, char **argv, tbl_app_config_t *cfg)
                 continue;
             }
 
-            /* positional args for verify/export */
-            if (cfg->role == TBL_ROLE_VERIFY) {
-                if (!cfg->jobid) {
-                    cfg->jobid = a;
-                    continue;
-                }
-            } else if (cfg->role == TBL_ROLE_EXPORT) {
-                if (!cfg->jobid) {
-                    cfg->jobid = a;
-                    continue;
-                }
-                if (!cfg->out_dir) {
-                    cfg->out_dir = a;
-                    continue;
-                }
-            } else if (cfg->role == TBL_ROLE_PACKAGE) {
-                if (!cfg->jobid) { cfg->jobid = a; continue; }
-                if (!cfg->out_dir) { cfg->out_dir = a; continue; }
-            } else if (cfg->role == TBL_ROLE_VERIFY_PACKAGE) {
-                if (!cfg->pkg_dir) { cfg->pkg_dir = a; continue; }
-            } else if (cfg->role == TBL_ROLE_INGEST_PACKAGE) {
-                if (!cfg->pkg_dir) { cfg->pkg_dir = a; continue; }
-            }
+            /* positional args for verify/export/... */
+            if (tbl_take_positional(cfg, a)) continue;
 
             /* anything else is an error (strict) */
             (void)tbl_fputs3_ok(stderr, "error: unexpected positional argument: ", a, "\n");
@@ -299,7 +572,7 @@ int tbl_args_parse(int argc, char **argv, tbl_app_config_t *cfg)
         const char *a = argv[i];
         if (!a || !a[0]) continue;
 
-        if (!got_subcmd && (tbl_streq(a, "verify") || tbl_streq(a, "export") || tbl_streq(a, "package") || tbl_streq(a, "verify-package") || tbl_streq(a, "ingest-package") || tbl_streq(a, "verify-audit") || tbl_streq(a, "audit-verify"))) {
+        if (!got_subcmd && tbl_is_subcmd(a)) {
             got_subcmd = 1;
             if (!tbl_role_from_str(a, &cfg->role)) {
                 (void)tbl_fputs3_ok(stderr, "error: unknown subcommand: ", a, "\n");
@@ -308,19 +581,7 @@ int tbl_args_parse(int argc, char **argv, tbl_app_config_t *cfg)
             continue;
         }
 
-        if (cfg->role == TBL_ROLE_VERIFY) {
-            if (!cfg->jobid) { cfg->jobid = a; continue; }
-        } else if (cfg->role == TBL_ROLE_EXPORT) {
-            if (!cfg->jobid) { cfg->jobid = a; continue; }
-            if (!cfg->out_dir) { cfg->out_dir = a; continue; }
-        } else if (cfg->role == TBL_ROLE_PACKAGE) {
-            if (!cfg->jobid) { cfg->jobid = a; continue; }
-            if (!cfg->out_dir) { cfg->out_dir = a; continue; }
-        } else if (cfg->role == TBL_ROLE_VERIFY_PACKAGE) {
-            if (!cfg->pkg_dir) { cfg->pkg_dir = a; continue; }
-        } else if (cfg->role == TBL_ROLE_INGEST_PACKAGE) {
-            if (!cfg->pkg_dir) { cfg->pkg_dir = a; continue; }
-        }
+        if (tbl_take_positional(cfg, a)) continue;
 
         (void)tbl_fputs3_ok(stderr, "error: unexpected positional argument: ", a, "\n");
                 (void)tbl_fputs_ok(stderr, "hint: use --help\n");
@@ -371,6 +632,133 @@ int tbl_args_parse(int argc, char **argv, tbl_app_config_t *cfg)
         /* no positional args */
     }
 
+    if (cfg->audit_full && cfg->role != TBL_ROLE_VERIFY_AUDIT && cfg->role != TBL_ROLE_EVENTS_INDEX &&
+        cfg->role != TBL_ROLE_VERIFY_ALL) {
+        (void)tbl_fputs_ok(stderr, "error: --full is only valid with 'verify-audit', 'events-index' or 'verify-all'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " verify-audit --full\n");
+        if (cfg->role == TBL_ROLE_INDEX) {
+            (void)tbl_fputs3_ok(stderr, "hint: ", prog, " index --reset-cursor (full-text index from offset 0)\n");
+        }
+        return 2;
+    }
+
+    if (cfg->audit_incremental && (cfg->role != TBL_ROLE_VERIFY_AUDIT || cfg->audit_full)) {
+        (void)tbl_fputs_ok(stderr, "error: --incremental is only valid with 'verify-audit', without --full\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " verify-audit --incremental\n");
+        return 2;
+    }
+
+    if (cfg->scrub_objects && cfg->role != TBL_ROLE_VERIFY_ALL) {
+        (void)tbl_fputs_ok(stderr, "error: --objects is only valid with 'verify-all'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " verify-all --objects\n");
+        return 2;
+    }
+
+    if (cfg->index_snapshot && cfg->role != TBL_ROLE_INDEX) {
+        (void)tbl_fputs_ok(stderr, "error: --snapshot is only valid with 'index'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " index --snapshot\n");
+        return 2;
+    }
+
+    if ((cfg->index_rebuild || cfg->index_reset_cursor) && cfg->role != TBL_ROLE_INDEX) {
+        (void)tbl_fputs_ok(stderr, "error: --rebuild/--reset-cursor are only valid with 'index'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " index --rebuild\n");
+        return 2;
+    }
+
+    if (cfg->role == TBL_ROLE_SPOOL_PRUNE && !cfg->older_than_set) {
+        (void)tbl_fputs_ok(stderr, "error: spool-prune needs --older-than DAYS\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " spool-prune --older-than 30\n");
+        return 2;
+    }
+
+    if (cfg->older_than_set && cfg->role != TBL_ROLE_SPOOL_PRUNE) {
+        (void)tbl_fputs_ok(stderr, "error: --older-than is only valid with 'spool-prune'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " spool-prune --older-than DAYS\n");
+        return 2;
+    }
+
+    if (cfg->role == TBL_ROLE_AUDIT_PROOF) {
+        if ((cfg->proof_target != NULL) == (cfg->proof_old_set != 0)) {
+            (void)tbl_fputs_ok(stderr, "error: audit-proof needs LINE, JOBID or --consistency SIZE\n");
+            (void)tbl_fputs3_ok(stderr, "hint: ", prog, " audit-proof 42\n");
+            return 2;
+        }
+    }
+
+    if (cfg->role == TBL_ROLE_REFS) {
+        if (!cfg->refs_sha || !cfg->refs_sha[0]) {
+            (void)tbl_fputs_ok(stderr, "error: refs needs SHA256\n");
+            (void)tbl_fputs3_ok(stderr, "hint: ", prog, " refs 9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08\n");
+            return 2;
+        }
+    }
+
+    if (cfg->role == TBL_ROLE_SEARCH) {
+        if (!cfg->search_query || !cfg->search_query[0]) {
+            (void)tbl_fputs_ok(stderr, "error: search needs QUERY\n");
+            (void)tbl_fputs3_ok(stderr, "hint: ", prog, " search \"invoice 2026 OR rechnung\"\n");
+            return 2;
+        }
+    }
+
+    if (cfg->role == TBL_ROLE_FIND) {
+        if (!cfg->find_fragment || !cfg->find_fragment[0]) {
+            (void)tbl_fputs_ok(stderr, "error: find needs FRAGMENT\n");
+            (void)tbl_fputs3_ok(stderr, "hint: ", prog, " find 2026-0417\n");
+            return 2;
+        }
+    }
+
+    if (cfg->role == TBL_ROLE_TAGGED) {
+        if (!cfg->tag_query || !strchr(cfg->tag_query, '=') || cfg->tag_query[0] == '=') {
+            (void)tbl_fputs_ok(stderr, "error: tagged needs KEY=VALUE\n");
+            (void)tbl_fputs3_ok(stderr, "hint: ", prog, " tagged customer=ACME\n");
+            return 2;
+        }
+    }
+
+    if (cfg->proof_old_set && cfg->role != TBL_ROLE_AUDIT_PROOF) {
+        (void)tbl_fputs_ok(stderr, "error: --consistency is only valid with 'audit-proof'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " audit-proof --consistency SIZE\n");
+        return 2;
+    }
+
+    if ((cfg->q_since || cfg->q_until || cfg->q_status) && cfg->role != TBL_ROLE_EVENTS &&
+        cfg->role != TBL_ROLE_RECORDS && cfg->role != TBL_ROLE_STATS) {
+        (void)tbl_fputs_ok(stderr, "error: --since/--until/--status are only valid with 'events', 'records' or 'stats'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " events --since 1h --status fail\n");
+        return 2;
+    }
+
+    if ((cfg->q_event || cfg->q_job) && cfg->role != TBL_ROLE_EVENTS) {
+        (void)tbl_fputs_ok(stderr, "error: --event/--job are only valid with 'events'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " events --event verify --job JOBID\n");
+        return 2;
+    }
+
+    if ((cfg->q_by || cfg->q_min_bytes || cfg->q_max_bytes || cfg->q_desc ||
+         (cfg->q_limit && cfg->role != TBL_ROLE_SEARCH && cfg->role != TBL_ROLE_FIND &&
+          cfg->role != TBL_ROLE_TAGGED)) &&
+        cfg->role != TBL_ROLE_RECORDS) {
+        (void)tbl_fputs_ok(stderr, "error: --by/--min-bytes/--max-bytes/--limit/--desc are only valid with 'records'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " records --by bytes --desc --limit 100\n");
+        return 2;
+    }
+
+    if (cfg->role == TBL_ROLE_RECORDS && cfg->q_by && !tbl_streq(cfg->q_by, "time") &&
+        !tbl_streq(cfg->q_by, "bytes")) {
+        (void)tbl_fputs3_ok(stderr, "error: invalid --by: ", cfg->q_by, " (time|bytes)\n");
+        return 2;
+    }
+
+    if ((cfg->q_from || cfg->q_cursor || cfg->q_publish || (cfg->q_follow && cfg->role != TBL_ROLE_INDEX)) &&
+        cfg->role != TBL_ROLE_EVENTS) {
+        (void)tbl_fputs_ok(stderr, "error: --follow/--from-offset/--cursor/--publish are only valid with 'events'\n");
+        (void)tbl_fputs3_ok(stderr, "hint: ", prog, " events --follow --cursor indexer\n");
+        return 2;
+    }
+
     if (cfg->pkg_kind_set && cfg->role != TBL_ROLE_PACKAGE) {
         (void)tbl_fputs_ok(stderr, "error: --format is only valid with 'package'\n");
         (void)tbl_fputs3_ok(stderr, "hint: ", prog, " package JOBID OUTDIR --format aip|sip\n");
@@ -10,6 +10,11 @@
 #include "core/safe.h"
 
 /* Verify the ops audit hash-chain at <repo_root>/audit/ops.log.
+ * With segmentation the chain runs through the sealed segments
+ * audit/ops.000001.log, ops.000002.log, ... (no gaps) and ends in ops.log;
+ * every segment after the first must start with its header line
+ * (event=audit.segment seg=<n> lines=<lines before it>). Errors in a
+ * segmented log name the file and use line numbers within it.
  * Return Tablinum exit codes:
  *   0 ok
  *   3 notfound
@@ -18,16 +23,75 @@
  */
 int tbl_audit_verify_ops(const char *repo_root, char *err, size_t errsz);
 
+/* Same check, hashing on nthreads workers (0 = one per CPU). Lines are
+ * hashed independently in chunks; the prev links are then checked in file
+ * order, so the reported first failing line and reason do not depend on
+ * nthreads. Memory: TBL_AUDIT_CHUNK_BYTES per worker.
+ */
+int tbl_audit_verify_ops_ex(const char *repo_root, unsigned long nthreads, char *err, size_t errsz);
+
+/* Incremental check. Resumes after the verified prefix recorded in
+ * <repo_root>/audit/ops.checkpoint (segment, offset, line count, chain head
+ * and a digest of the last TBL_AUDIT_ANCHOR_BYTES before the offset) and rewrites
+ * the checkpoint after a successful run. full != 0 ignores the checkpoint.
+ * A resumed prefix is NOT rehashed: only its last TBL_AUDIT_ANCHOR_BYTES
+ * are compared, so an edit further back goes unnoticed. Callers resume
+ * only on request and report the out_resumed lines as not re-checked.
+ * A checkpoint that no longer matches the log is an integrity failure (5);
+ * a missing or malformed one just means a full run.
+ * out_resumed: lines taken from the checkpoint; out_lines: lines in total.
+ */
+int tbl_audit_verify_ops_incr(const char *repo_root, unsigned long nthreads, int full,
+                              unsigned long *out_resumed, unsigned long *out_lines,
+                              char *err, size_t errsz);
+
+/* Number of sealed segments (audit/ops.NNNNNN.log) under repo_root. */
+unsigned long tbl_audit_sealed_count(const char *repo_root);
+
+/* Path of chain file seq (1-based): sealed segment seq (its .tlz if it
+ * has been compressed), or ops.log for seq > sealed. Returns 1 on success. */
+int tbl_audit_chain_path_ok(const char *repo_root, unsigned long seq, unsigned long sealed,
+                            char *out, size_t outsz);
+
+/* 1 if path names a compressed segment (core/tlz.h frame). */
+int tbl_audit_path_tlz_ok(const char *path);
+
+/* Archive sealed segments: every sealed segment except the newest keep
+ * (at least 1) is compressed into ops.NNNNNN.log.tlz (core/tlz.h) on
+ * nthreads workers. Each frame is decoded and compared (SHA-256) with the
+ * original before it replaces it; the chain itself is not changed, and
+ * verify-audit and the Merkle reader decompress transparently.
+ * out_segs: segments compressed; out_raw/out_comp: their bytes before and
+ * after. Returns the exit codes above (4 io, 5 a frame did not match). */
+int tbl_audit_compress_segments(const char *repo_root, unsigned long keep, unsigned long nthreads,
+                                unsigned long *out_segs, unsigned long *out_raw,
+                                unsigned long *out_comp, char *err, size_t errsz);
+
+/* Bytes per worker and read window. Must exceed TBL_AUDIT_LINE_MAX. */
+#ifndef TBL_AUDIT_CHUNK_BYTES
+#define TBL_AUDIT_CHUNK_BYTES 1048576UL
+#endif
+
+/* Bytes of verified log re-hashed to validate a checkpoint. */
+#define TBL_AUDIT_ANCHOR_BYTES 65536UL
+
+/* Longest accepted line (including LF) is TBL_AUDIT_LINE_MAX - 1 bytes. */
+#define TBL_AUDIT_LINE_MAX 4096
+
 #ifdef TBL_AUDIT_IMPLEMENTATION
 
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "core/path.h"
 #include "core/safe.h"
 #include "core/sha256.h"
 #include "core/str.h"
+#include "core/tlz.h"
 #include "os/fs.h"
+#include "os/thread.h"
 
 /* Keep exit codes local to avoid include cycles. */
 enum {
@@ -45,7 +109,9 @@ static void tbl_audit_seterr(char *err, size_t errsz, const char *msg)
     (void)tbl_strlcpy(err, msg, errsz);
 }
 
-static void tbl_audit_seterr_line(char *err, size_t errsz, unsigned long line_no, const char *tail)
+/* "audit integrity: [<file> ]line N: tail" */
+static void tbl_audit_seterr_line(char *err, size_t errsz, const char *file,
+                                  unsigned long line_no, const char *tail)
 {
     char nbuf[32];
     char msg[256];
@@ -57,7 +123,12 @@ static void tbl_audit_seterr_line(char *err, size_t errsz, unsigned long line_no
     }
 
     msg[0] = '\0';
-    (void)tbl_strlcpy(msg, "audit integrity: line ", sizeof(msg));
+    (void)tbl_strlcpy(msg, "audit integrity: ", sizeof(msg));
+    if (file && file[0]) {
+        (void)tbl_strlcat(msg, file, sizeof(msg));
+        (void)tbl_strlcat(msg, " ", sizeof(msg));
+    }
+    (void)tbl_strlcat(msg, "line ", sizeof(msg));
     (void)tbl_strlcat(msg, nbuf, sizeof(msg));
     (void)tbl_strlcat(msg, ": ", sizeof(msg));
     (void)tbl_strlcat(msg, tail, sizeof(msg));
@@ -135,119 +206,1196 @@ static int tbl_audit_parse_line(const char *line,
     return 1;
 }
 
-int tbl_audit_verify_ops(const char *repo_root, char *err, size_t errsz)
+/* Per-line verdicts, in the order the checks run. Codes below
+ * TBL_AUDIT_E_PREV are decided before the prev link is looked at. */
+enum {
+    TBL_AUDIT_E_NONE = 0,
+    TBL_AUDIT_E_CR,
+    TBL_AUDIT_E_NUL,
+    TBL_AUDIT_E_LF,
+    TBL_AUDIT_E_EMPTY,
+    TBL_AUDIT_E_FORMAT,
+    TBL_AUDIT_E_HEX,
+    TBL_AUDIT_E_PREV,
+    TBL_AUDIT_E_CANON,
+    TBL_AUDIT_E_HASH
+};
+
+static const char *tbl_audit_reason(int code)
+{
+    switch (code) {
+    case TBL_AUDIT_E_CR:     return "CR found";
+    case TBL_AUDIT_E_NUL:    return "NUL found";
+    case TBL_AUDIT_E_LF:     return "missing LF or line too long";
+    case TBL_AUDIT_E_EMPTY:  return "empty line";
+    case TBL_AUDIT_E_FORMAT: return "invalid format";
+    case TBL_AUDIT_E_HEX:    return "invalid hex";
+    case TBL_AUDIT_E_PREV:   return "prev mismatch";
+    case TBL_AUDIT_E_CANON:  return "canonical malformed";
+    case TBL_AUDIT_E_HASH:   return "hash mismatch";
+    default:                 return "error";
+    }
+}
+
+/* Check one line s[0..n) (n includes the LF, if any) except for the prev
+ * link. Lines are limited to TBL_AUDIT_LINE_MAX - 1 bytes including LF. */
+static int tbl_audit_check_line(const char *s, size_t n, char prev[65], char hash[65])
+{
+    char buf[TBL_AUDIT_LINE_MAX];
+    const char *canonical;
+    char calc[65];
+    size_t lim;
+    size_t i;
+
+    lim = (n < (size_t)TBL_AUDIT_LINE_MAX - 1U) ? n : (size_t)TBL_AUDIT_LINE_MAX - 1U;
+    for (i = 0; i < lim; ++i) {
+        if (s[i] == '\r') return TBL_AUDIT_E_CR;
+        if (s[i] == '\0') return TBL_AUDIT_E_NUL;
+    }
+    if (n > lim || s[n - 1] != '\n') return TBL_AUDIT_E_LF;
+    if (n == 1U) return TBL_AUDIT_E_EMPTY;
+
+    (void)memcpy(buf, s, n - 1U);
+    buf[n - 1U] = '\0';
+
+    canonical = NULL;
+    if (!tbl_audit_parse_line(buf, prev, hash, &canonical)) return TBL_AUDIT_E_FORMAT;
+    if (!tbl_audit_is_hex64(prev) || !tbl_audit_is_hex64(hash)) return TBL_AUDIT_E_HEX;
+
+    /* Optional sanity check: canonical begins with ts= and contains event= */
+    if (!tbl_str_starts_with(canonical, "ts=") || strstr(canonical, " event=") == NULL) {
+        return TBL_AUDIT_E_CANON;
+    }
+
+    tbl_audit_hash_chain(prev, canonical, calc);
+    if (!tbl_streq(calc, hash)) return TBL_AUDIT_E_HASH;
+    return TBL_AUDIT_E_NONE;
+}
+
+/* A run of whole lines checked by one worker. Links inside the chunk are
+ * checked by the worker; the link into its first line is left to the
+ * sequential pass, which knows the previous chunk's last hash. */
+typedef struct tbl_audit_chunk_s {
+    const char *p;
+    size_t len;
+    unsigned long nlines;   /* lines checked (up to and including err_line) */
+    unsigned long err_line; /* 1-based within the chunk, 0 = none */
+    int err_code;
+    int have_first;         /* first line parsed: first_prev is valid */
+    char first_prev[65];
+    char last_hash[65];
+} tbl_audit_chunk_t;
+
+static void tbl_audit_chunk_worker(void *ud, unsigned long worker)
+{
+    tbl_audit_chunk_t *c;
+    const char *p;
+    size_t rem;
+
+    c = (tbl_audit_chunk_t *)ud + worker;
+    c->nlines = 0UL;
+    c->err_line = 0UL;
+    c->err_code = TBL_AUDIT_E_NONE;
+    c->have_first = 0;
+    c->last_hash[0] = '\0';
+
+    p = c->p;
+    rem = c->len;
+    while (rem > 0) {
+        const char *lf;
+        size_t n;
+        char prev[65];
+        char hash[65];
+        int code;
+
+        lf = (const char *)memchr(p, '\n', rem);
+        n = lf ? (size_t)(lf - p) + 1U : rem;
+
+        c->nlines++;
+        code = tbl_audit_check_line(p, n, prev, hash);
+        if (code != TBL_AUDIT_E_NONE && code < TBL_AUDIT_E_PREV) {
+            c->err_line = c->nlines;
+            c->err_code = code;
+            return;
+        }
+        if (c->nlines == 1UL) {
+            (void)tbl_strlcpy(c->first_prev, prev, sizeof(c->first_prev));
+            c->have_first = 1;
+        } else if (!tbl_streq(prev, c->last_hash)) {
+            code = TBL_AUDIT_E_PREV;
+        }
+        if (code != TBL_AUDIT_E_NONE) {
+            c->err_line = c->nlines;
+            c->err_code = code;
+            return;
+        }
+        (void)tbl_strlcpy(c->last_hash, hash, sizeof(c->last_hash));
+
+        p += n;
+        rem -= n;
+    }
+}
+
+/* Split buf[0..len) into at most nchunks runs of whole lines. */
+static unsigned long tbl_audit_split(const char *buf, size_t len, unsigned long nchunks,
+                                     tbl_audit_chunk_t *chunks)
+{
+    size_t off;
+    size_t target;
+    unsigned long k;
+
+    target = len / (size_t)nchunks;
+    if (target < 1U) target = 1U;
+
+    off = 0;
+    k = 0UL;
+    while (off < len && k < nchunks) {
+        size_t end;
+
+        if (k + 1UL == nchunks || len - off <= target) {
+            end = len;
+        } else {
+            const char *lf;
+            end = off + target - 1U;
+            lf = (const char *)memchr(buf + end, '\n', len - end);
+            end = lf ? (size_t)(lf - buf) + 1U : len;
+        }
+        chunks[k].p = buf + off;
+        chunks[k].len = end - off;
+        k++;
+        off = end;
+    }
+    return k;
+}
+
+/* Verify lines from the current position of fp to EOF on nw workers.
+ * head: expected prev of the first line; receives the last verified hash.
+ * lines/off: advanced by the verified lines and bytes.
+ * On an integrity failure *bad_line (absolute) and *bad_code are set. */
+/* Scan from the current position to end_off (file offset; -1: EOF). */
+static int tbl_audit_scan(FILE *fp, long end_off, unsigned long nw,
+                          char head[65], unsigned long *lines, unsigned long *off,
+                          unsigned long *bad_line, int *bad_code,
+                          char *err, size_t errsz)
+{
+    char *buf;
+    size_t cap;
+    size_t carry;
+    unsigned long left;
+    tbl_audit_chunk_t chunks[TBL_THREAD_MAX];
+    int rc;
+
+    left = 0UL;
+    if (end_off >= 0L) {
+        long cur = ftell(fp);
+        if (cur < 0L) {
+            tbl_audit_seterr(err, errsz, "read error");
+            return TBLX_EXIT_IO;
+        }
+        left = (end_off > cur) ? (unsigned long)(end_off - cur) : 0UL;
+    }
+
+    cap = (size_t)nw * (size_t)TBL_AUDIT_CHUNK_BYTES;
+    buf = (char *)malloc(cap);
+    if (!buf) {
+        tbl_audit_seterr(err, errsz, "out of memory");
+        return TBLX_EXIT_IO;
+    }
+
+    carry = 0;
+    rc = TBLX_EXIT_OK;
+
+    /* Read window by window; each window ends on a line boundary (the
+     * partial tail is carried over), is hashed by nw workers and then
+     * linked in file order, so the first failing line is the same as
+     * with a single worker. */
+    for (;;) {
+        size_t want;
+        size_t got;
+        size_t avail;
+        size_t end;
+        unsigned long nc;
+        unsigned long k;
+        int eof;
+
+        want = cap - carry;
+        if (end_off >= 0L && left < (unsigned long)want) want = (size_t)left;
+        got = (want > 0) ? fread(buf + carry, 1, want, fp) : 0;
+        if (got < want && ferror(fp)) {
+            tbl_audit_seterr(err, errsz, "read error");
+            rc = TBLX_EXIT_IO;
+            break;
+        }
+        if (end_off >= 0L) left -= (unsigned long)got;
+        eof = (got < want || (end_off >= 0L && left == 0UL)) ? 1 : 0;
+        avail = carry + got;
+        if (avail == 0) break;
+
+        end = avail;
+        if (!eof) {
+            while (end > 0 && buf[end - 1] != '\n') end--;
+            if (end == 0) end = avail; /* no LF in a whole window: over-long line */
+        }
+
+        nc = tbl_audit_split(buf, end, nw, chunks);
+        tbl_thread_run(nc, tbl_audit_chunk_worker, chunks);
+
+        for (k = 0UL; k < nc; ++k) {
+            const tbl_audit_chunk_t *c = &chunks[k];
+            unsigned long bad;
+            int code;
+
+            bad = 0UL;
+            code = TBL_AUDIT_E_NONE;
+            if (c->err_line == 1UL && c->err_code < TBL_AUDIT_E_PREV) {
+                bad = 1UL;
+                code = c->err_code;
+            } else if (c->have_first && !tbl_streq(c->first_prev, head)) {
+                bad = 1UL;
+                code = TBL_AUDIT_E_PREV;
+            } else if (c->err_line != 0UL) {
+                bad = c->err_line;
+                code = c->err_code;
+            }
+            if (bad != 0UL) {
+                *bad_line = *lines + bad;
+                *bad_code = code;
+                rc = TBLX_EXIT_INTEGRITY;
+                break;
+            }
+
+            *lines += c->nlines;
+            *off += (unsigned long)c->len;
+            (void)tbl_strlcpy(head, c->last_hash, 65);
+        }
+        if (rc != TBLX_EXIT_OK) break;
+
+        carry = avail - end;
+        if (carry > 0) (void)memmove(buf, buf + end, carry);
+        if (eof && carry == 0) break;
+    }
+
+    free(buf);
+    return rc;
+}
+
+/* Same for a compressed segment: from raw offset start (a line start) to
+ * the end, one block per worker. Blocks hold whole lines, so each worker
+ * decodes and checks its block on its own; the blocks are then linked in
+ * order. A block that does not decode is an integrity failure (err set,
+ * *bad_line stays 0). */
+typedef struct tbl_audit_zjob_s {
+    const tbl_tlz_ent_t *e;
+    const unsigned char *comp;
+    char *raw;
+    size_t skip;
+    int damaged;
+    tbl_audit_chunk_t c;
+} tbl_audit_zjob_t;
+
+static void tbl_audit_zjob_worker(void *ud, unsigned long worker)
+{
+    tbl_audit_zjob_t *j = (tbl_audit_zjob_t *)ud + worker;
+
+    j->damaged = tbl_tlz_decode_ok(j->e, j->comp, j->raw) ? 0 : 1;
+    if (j->damaged) return;
+    j->c.p = j->raw + j->skip;
+    j->c.len = (size_t)j->e->raw_len - j->skip;
+    tbl_audit_chunk_worker(&j->c, 0UL);
+}
+
+static int tbl_audit_scan_tlz(tbl_tlz_t *z, unsigned long start, unsigned long nw,
+                              char head[65], unsigned long *lines, unsigned long *off,
+                              unsigned long *bad_line, int *bad_code,
+                              char *err, size_t errsz)
+{
+    tbl_audit_zjob_t jobs[TBL_THREAD_MAX];
+    unsigned char *cbuf;
+    char *rbuf;
+    unsigned long b;
+    unsigned long k;
+    int rc;
+
+    if (start >= z->raw_size) return TBLX_EXIT_OK;
+
+    cbuf = (unsigned char *)malloc((size_t)nw * tbl_tlz_bound((size_t)TBL_TLZ_BLOCK_MAX));
+    rbuf = (char *)malloc((size_t)nw * (size_t)TBL_TLZ_BLOCK_MAX);
+    if (!cbuf || !rbuf) {
+        free(cbuf);
+        free(rbuf);
+        tbl_audit_seterr(err, errsz, "out of memory");
+        return TBLX_EXIT_IO;
+    }
+
+    rc = TBLX_EXIT_OK;
+    b = tbl_tlz_block_at(z, start);
+    while (b < z->nblocks && rc == TBLX_EXIT_OK) {
+        unsigned long nb = z->nblocks - b;
+
+        if (nb > nw) nb = nw;
+        /* one read for the whole round */
+        if (!tbl_tlz_read_comp_ok(z, b, nb, cbuf)) {
+            tbl_audit_seterr(err, errsz, "read error");
+            rc = TBLX_EXIT_IO;
+            break;
+        }
+        for (k = 0UL; k < nb; ++k) {
+            jobs[k].e = &z->ent[b + k];
+            jobs[k].comp = cbuf + (z->ent[b + k].comp_off - z->ent[b].comp_off);
+            jobs[k].raw = rbuf + (size_t)k * (size_t)TBL_TLZ_BLOCK_MAX;
+            jobs[k].skip = (z->ent[b + k].raw_off < start) ? (size_t)(start - z->ent[b + k].raw_off) : 0U;
+        }
+        tbl_thread_run(nb, tbl_audit_zjob_worker, jobs);
+
+        for (k = 0UL; k < nb; ++k) {
+            const tbl_audit_chunk_t *c = &jobs[k].c;
+            unsigned long bad;
+            int code;
+
+            if (jobs[k].damaged) {
+                tbl_audit_seterr(err, errsz, "audit integrity: compressed block damaged");
+                rc = TBLX_EXIT_INTEGRITY;
+                break;
+            }
+            bad = 0UL;
+            code = TBL_AUDIT_E_NONE;
+            if (c->err_line == 1UL && c->err_code < TBL_AUDIT_E_PREV) {
+                bad = 1UL;
+                code = c->err_code;
+            } else if (c->have_first && !tbl_streq(c->first_prev, head)) {
+                bad = 1UL;
+                code = TBL_AUDIT_E_PREV;
+            } else if (c->err_line != 0UL) {
+                bad = c->err_line;
+                code = c->err_code;
+            }
+            if (bad != 0UL) {
+                *bad_line = *lines + bad;
+                *bad_code = code;
+                rc = TBLX_EXIT_INTEGRITY;
+                break;
+            }
+
+            *lines += c->nlines;
+            *off += (unsigned long)c->len;
+            (void)tbl_strlcpy(head, c->last_hash, 65);
+        }
+        b += nb;
+    }
+
+    free(cbuf);
+    free(rbuf);
+    return rc;
+}
+
+/* ---- segments ---- */
+
+/* "ops.NNNNNN.log" (at least 6 digits) */
+static int tbl_audit_seg_name(unsigned long seq, char *out, size_t outsz)
+{
+    char nbuf[32];
+    size_t n;
+
+    if (!tbl_ul_to_dec_ok(seq, nbuf, sizeof(nbuf))) return 0;
+    if (!tbl_strlcpy_ok(out, "ops.", outsz)) return 0;
+    for (n = strlen(nbuf); n < 6U; ++n) {
+        if (!tbl_strlcat_ok(out, "0", outsz)) return 0;
+    }
+    if (!tbl_strlcat_ok(out, nbuf, outsz)) return 0;
+    return tbl_strlcat_ok(out, ".log", outsz);
+}
+
+/* Also accepts the compressed form "ops.NNNNNN.log.tlz". */
+static int tbl_audit_seg_parse_name(const char *name, unsigned long *out_seq)
+{
+    const char *p;
+    size_t nd;
+
+    if (!tbl_str_starts_with(name, "ops.")) return 0;
+    p = name + 4;
+    nd = 0;
+    while (p[nd] >= '0' && p[nd] <= '9') nd++;
+    if (nd < 6U || nd > 9U || (strcmp(p + nd, ".log") != 0 && strcmp(p + nd, ".log.tlz") != 0)) return 0;
+    *out_seq = 0UL;
+    while (nd-- > 0U) *out_seq = *out_seq * 10UL + (unsigned long)(*p++ - '0');
+    return *out_seq > 0UL;
+}
+
+typedef struct tbl_audit_segs_s {
+    unsigned long *seq;
+    unsigned long n;
+    unsigned long cap;
+    int oom;
+} tbl_audit_segs_t;
+
+static int tbl_audit_segs_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_audit_segs_t *sg = (tbl_audit_segs_t *)ud;
+    unsigned long seq;
+
+    (void)full;
+    if (is_dir || !tbl_audit_seg_parse_name(name, &seq)) return 0;
+    if (sg->n == sg->cap) {
+        unsigned long ncap = sg->cap ? sg->cap * 2UL : 64UL;
+        unsigned long *ns = (unsigned long *)realloc(sg->seq, (size_t)ncap * sizeof(*ns));
+        if (!ns) { sg->oom = 1; return 1; }
+        sg->seq = ns;
+        sg->cap = ncap;
+    }
+    sg->seq[sg->n++] = seq;
+    return 0;
+}
+
+static int tbl_audit_cmp_ul(const void *a, const void *b)
+{
+    unsigned long x = *(const unsigned long *)a;
+    unsigned long y = *(const unsigned long *)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/* Sort; a segment listed twice (plain and .tlz while it is being
+ * compressed) counts once. */
+static void tbl_audit_segs_sort(tbl_audit_segs_t *sg)
+{
+    unsigned long i;
+    unsigned long n;
+
+    if (sg->n < 2UL) return;
+    qsort(sg->seq, (size_t)sg->n, sizeof(*sg->seq), tbl_audit_cmp_ul);
+    n = 1UL;
+    for (i = 1UL; i < sg->n; ++i) {
+        if (sg->seq[i] != sg->seq[n - 1UL]) sg->seq[n++] = sg->seq[i];
+    }
+    sg->n = n;
+}
+
+/* Unsigned value of " key=" in a canonical line. */
+static int tbl_audit_canon_ul(const char *canonical, const char *key, unsigned long *out)
+{
+    const char *p;
+    size_t kl;
+
+    kl = strlen(key);
+    for (p = strchr(canonical, ' '); p; p = strchr(p + 1, ' ')) {
+        if (strncmp(p + 1, key, kl) == 0 && p[1 + kl] == '=') {
+            p += 2 + kl;
+            if (!(*p >= '0' && *p <= '9')) return 0;
+            *out = 0UL;
+            while (*p >= '0' && *p <= '9') *out = *out * 10UL + (unsigned long)(*p++ - '0');
+            return (*p == ' ' || *p == '\0') ? 1 : 0;
+        }
+    }
+    return 0;
+}
+
+/* Read the header of segment seq (first line, event=audit.segment seg=seq)
+ * and return its lines= value. From fp (rewound) or, if z is set, from the
+ * compressed segment. 1 = ok, 0 = bad, -1 = empty. */
+static int tbl_audit_seg_header(FILE *fp, tbl_tlz_t *z, unsigned long seq, unsigned long *out_base)
+{
+    char buf[TBL_AUDIT_LINE_MAX];
+    char prev[65];
+    char hash[65];
+    const char *canonical;
+    unsigned long v;
+    size_t n;
+    int ok;
+
+    if (z) {
+        char *lf;
+
+        if (z->raw_size == 0UL) return -1;
+        n = (z->raw_size < (unsigned long)sizeof(buf) - 1UL) ? (size_t)z->raw_size : sizeof(buf) - 1U;
+        if (!tbl_tlz_pread_ok(z, 0UL, buf, n)) return 0;
+        buf[n] = '\0';
+        lf = (char *)memchr(buf, '\n', n);
+        if (lf) lf[1] = '\0';
+    } else {
+        if (fgets(buf, (int)sizeof(buf), fp) == NULL) {
+            return (fseek(fp, 0L, SEEK_SET) == 0 && !ferror(fp)) ? -1 : 0;
+        }
+        if (fseek(fp, 0L, SEEK_SET) != 0) return 0;
+    }
+
+    n = strlen(buf);
+    if (n == 0 || buf[n - 1] != '\n') return 0;
+    buf[n - 1] = '\0';
+
+    canonical = NULL;
+    ok = tbl_audit_parse_line(buf, prev, hash, &canonical) &&
+         strstr(canonical, " event=audit.segment") != NULL &&
+         tbl_audit_canon_ul(canonical, "seg", &v) && v == seq &&
+         tbl_audit_canon_ul(canonical, "lines", out_base);
+    return ok ? 1 : 0;
+}
+
+static int tbl_audit_ops_path(const char *repo_root, const char *name, char *out, size_t outsz,
+                              char *err, size_t errsz)
+{
+    char audit_dir[1024];
+
+    if (!tbl_path_join2(audit_dir, sizeof(audit_dir), repo_root, "audit") ||
+        !tbl_path_join2(out, outsz, audit_dir, name)) {
+        tbl_audit_seterr(err, errsz, "audit path too long");
+        return 0;
+    }
+    return 1;
+}
+
+unsigned long tbl_audit_sealed_count(const char *repo_root)
 {
     char audit_dir[1024];
-    char audit_path[1024];
+    tbl_audit_segs_t sg;
+    int ex;
+
+    if (!repo_root || !tbl_path_join2(audit_dir, sizeof(audit_dir), repo_root, "audit")) return 0UL;
+    (void)memset(&sg, 0, sizeof(sg));
+    ex = 0;
+    (void)tbl_fs_is_dir(audit_dir, &ex);
+    if (ex) (void)tbl_fs_list_dir(audit_dir, tbl_audit_segs_cb, &sg);
+    tbl_audit_segs_sort(&sg);
+    free(sg.seq);
+    return sg.n;
+}
+
+int tbl_audit_chain_path_ok(const char *repo_root, unsigned long seq, unsigned long sealed,
+                            char *out, size_t outsz)
+{
+    char name[32];
     int ex;
+
+    if (!repo_root || seq < 1UL) return 0;
+    if (seq > sealed) {
+        (void)tbl_strlcpy(name, "ops.log", sizeof(name));
+    } else if (!tbl_audit_seg_name(seq, name, sizeof(name))) {
+        return 0;
+    }
+    if (!tbl_audit_ops_path(repo_root, name, out, outsz, NULL, 0)) return 0;
+    if (seq > sealed) return 1;
+
+    /* compressed (plain wins while both exist) */
+    ex = 0;
+    if (tbl_fs_exists(out, &ex) == 0 && ex) return 1;
+    if (!tbl_strlcat_ok(out, ".tlz", outsz)) return 0;
+    ex = 0;
+    if (tbl_fs_exists(out, &ex) == 0 && ex) return 1;
+    out[strlen(out) - 4U] = '\0';
+    return 1;
+}
+
+int tbl_audit_path_tlz_ok(const char *path)
+{
+    return path && tbl_str_ends_with(path, ".tlz");
+}
+
+/* Open sealed segment seq: plain into *fp, else compressed into z
+ * (*is_z = 1). Plain is tried first, then the .tlz, so a segment being
+ * compressed meanwhile is found either way. Returns 1 ok. */
+static int tbl_audit_seg_open_ok(const char *audit_dir, unsigned long seq,
+                                 FILE **fp, tbl_tlz_t *z, int *is_z)
+{
+    char name[40];
+    char path[1100];
+
+    *fp = NULL;
+    *is_z = 0;
+    if (!tbl_audit_seg_name(seq, name, sizeof(name)) ||
+        !tbl_path_join2(path, sizeof(path), audit_dir, name)) {
+        return 0;
+    }
+    *fp = fopen(path, "rb");
+    if (*fp) return 1;
+    if (!tbl_strlcat_ok(path, ".tlz", sizeof(path)) || tbl_tlz_open(z, path, NULL, 0) != 0) return 0;
+    *is_z = 1;
+    return 1;
+}
+
+/* ---- checkpoint ---- */
+
+static int tbl_audit_parse_ul(const char *s, unsigned long *out)
+{
+    char *end = 0;
+    unsigned long v;
+
+    if (!s || !out) return 0;
+    if (!(s[0] >= '0' && s[0] <= '9')) return 0;
+
+    v = strtoul(s, &end, 10);
+    if (!end || *end != '\0') return 0;
+    *out = v;
+    return 1;
+}
+
+/* Digest of the TBL_AUDIT_ANCHOR_BYTES before off (in fp, or in the
+ * compressed segment z if set); also checks that the line ending at off
+ * carries hash=head. Returns 1 if both match. */
+static int tbl_audit_cp_anchor(FILE *fp, tbl_tlz_t *z, unsigned long off, const char head[65], char out64[65])
+{
+    char *buf;
+    size_t n;
+    unsigned long from;
+    tbl_sha256_t st;
+    unsigned char dig[32];
+    int ok;
+
+    from = (off > TBL_AUDIT_ANCHOR_BYTES) ? off - TBL_AUDIT_ANCHOR_BYTES : 0UL;
+    n = (size_t)(off - from);
+
+    buf = (char *)malloc(n ? n : 1U);
+    if (!buf) return 0;
+
+    ok = 1;
+    if (n > 0 && z) {
+        ok = tbl_tlz_pread_ok(z, from, buf, n);
+    } else if (n > 0) {
+        if (!fp || from > (unsigned long)LONG_MAX || fseek(fp, (long)from, SEEK_SET) != 0) ok = 0;
+        if (ok && fread(buf, 1, n, fp) != n) ok = 0;
+    }
+
+    if (ok) {
+        tbl_sha256_init(&st);
+        tbl_sha256_update(&st, buf, n);
+        tbl_sha256_final(&st, dig);
+        (void)tbl_sha256_hex_ok(dig, out64, 65);
+    }
+
+    /* last verified line: "prev=<64> hash=<64> ..." */
+    if (ok && n > 0) {
+        size_t ls;
+
+        ok = (buf[n - 1] == '\n') ? 1 : 0;
+        ls = n - 1U;
+        while (ls > 0 && buf[ls - 1] != '\n') ls--;
+        if (ok && (ls > 0 || from == 0UL) && n - ls > 139U &&
+            memcmp(buf + ls + 69, " hash=", 6) == 0) {
+            ok = (memcmp(buf + ls + 75, head, 64) == 0) ? 1 : 0;
+        } else {
+            ok = 0;
+        }
+    }
+
+    free(buf);
+    return ok;
+}
+
+typedef struct tbl_audit_cp_s {
+    unsigned long seg;      /* segment holding offset (active ops.log = last sealed + 1) */
+    unsigned long offset;
+    unsigned long lines;
+    char head[65];
+    char anchor[65];
+} tbl_audit_cp_t;
+
+/* Read <audit>/ops.checkpoint. Returns 1 on a well-formed file. */
+static int tbl_audit_cp_read(const char *path, tbl_audit_cp_t *cp)
+{
     FILE *fp;
-    char buf[4096];
-    unsigned long line_no;
-    char expected_prev[65];
+    char line[256];
+    int have;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    cp->seg = 1UL; /* checkpoints from before segmentation */
+    have = 0;
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        size_t n;
+        char *v;
+
+        n = strlen(line);
+        if (n == 0 || line[n - 1] != '\n') { have = -1; break; }
+        line[n - 1] = '\0';
+        v = strchr(line, '=');
+        if (!v) { have = -1; break; }
+        *v++ = '\0';
+
+        if (tbl_streq(line, "segment") && tbl_audit_parse_ul(v, &cp->seg) && cp->seg > 0UL) {
+            continue;
+        } else if (tbl_streq(line, "offset") && tbl_audit_parse_ul(v, &cp->offset)) {
+            have |= 1;
+        } else if (tbl_streq(line, "lines") && tbl_audit_parse_ul(v, &cp->lines)) {
+            have |= 2;
+        } else if (tbl_streq(line, "head") && tbl_audit_is_hex64(v)) {
+            (void)tbl_strlcpy(cp->head, v, sizeof(cp->head));
+            have |= 4;
+        } else if (tbl_streq(line, "anchor") && tbl_audit_is_hex64(v)) {
+            (void)tbl_strlcpy(cp->anchor, v, sizeof(cp->anchor));
+            have |= 8;
+        } else {
+            have = -1;
+            break;
+        }
+    }
+    fclose(fp);
+    return (have == 15) ? 1 : 0;
+}
+
+static int tbl_audit_cp_write(const char *path, const tbl_audit_cp_t *cp)
+{
+    char tmp[1100];
+    char buf[512];
+    char nbuf[32];
+
+    buf[0] = '\0';
+    if (!tbl_ul_to_dec_ok(cp->seg, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(buf, "segment=", sizeof(buf));
+    (void)tbl_strlcat(buf, nbuf, sizeof(buf));
+    if (!tbl_ul_to_dec_ok(cp->offset, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(buf, "\noffset=", sizeof(buf));
+    (void)tbl_strlcat(buf, nbuf, sizeof(buf));
+    if (!tbl_ul_to_dec_ok(cp->lines, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(buf, "\nlines=", sizeof(buf));
+    (void)tbl_strlcat(buf, nbuf, sizeof(buf));
+    (void)tbl_strlcat(buf, "\nhead=", sizeof(buf));
+    (void)tbl_strlcat(buf, cp->head, sizeof(buf));
+    (void)tbl_strlcat(buf, "\nanchor=", sizeof(buf));
+    (void)tbl_strlcat(buf, cp->anchor, sizeof(buf));
+    (void)tbl_strlcat(buf, "\n", sizeof(buf));
+
+    if (!tbl_strlcpy_ok(tmp, path, sizeof(tmp)) || !tbl_strlcat_ok(tmp, ".tmp", sizeof(tmp))) return 0;
+    if (tbl_fs_write_file(tmp, buf, strlen(buf)) != 0) return 0;
+    if (tbl_fs_rename_atomic(tmp, path, 1) != 0) {
+        (void)tbl_fs_remove_file(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+/* ---- chain walk ---- */
+
+/* Verify the chain from pos (resume != 0: a checkpoint, re-validated
+ * first) through all sealed segments and ops.log. On success pos holds the
+ * end of the chain (segment = active ops.log). */
+static int tbl_audit_walk(const char *repo_root, unsigned long nw, tbl_audit_cp_t *pos, int resume,
+                          char *err, size_t errsz)
+{
+    char audit_dir[1024];
+    char path[1024];
+    char name[32];
+    tbl_audit_segs_t sg;
+    unsigned long active;
+    unsigned long seq;
+    unsigned long i;
+    FILE *afp;
+    long asize;
+    int ex;
+    int rc;
 
-    if (err && errsz) err[0] = '\0';
     if (!repo_root || !repo_root[0]) {
         tbl_audit_seterr(err, errsz, "invalid args");
         return TBLX_EXIT_IO;
     }
-
-    if (!tbl_path_join2(audit_dir, sizeof(audit_dir), repo_root, "audit") ||
-        !tbl_path_join2(audit_path, sizeof(audit_path), audit_dir, "ops.log")) {
+    if (!tbl_path_join2(audit_dir, sizeof(audit_dir), repo_root, "audit")) {
         tbl_audit_seterr(err, errsz, "audit path too long");
         return TBLX_EXIT_IO;
     }
 
+    /* Snapshot under the append lock: segment list, ops.log handle and
+     * size. Writers may go on appending or seal ops.log meanwhile; the
+     * open handle and the size keep the walk on what was complete here. */
+    (void)memset(&sg, 0, sizeof(sg));
     ex = 0;
-    (void)tbl_fs_exists(audit_path, &ex);
-    if (!ex) {
+    (void)tbl_fs_is_dir(audit_dir, &ex);
+    afp = NULL;
+    asize = 0L;
+    if (ex) {
+        tbl_fs_lock_t lk;
+        int locked;
+
+        locked = (tbl_path_join2(path, sizeof(path), audit_dir, "ops.lock") &&
+                  tbl_fs_lock_open(&lk, path) == 0) ? 1 : 0;
+        if (locked && tbl_fs_lock_acquire(&lk) != 0) {
+            (void)tbl_fs_lock_close(&lk);
+            locked = 0;
+        }
+        (void)tbl_fs_list_dir(audit_dir, tbl_audit_segs_cb, &sg);
+        if (tbl_path_join2(path, sizeof(path), audit_dir, "ops.log")) afp = fopen(path, "rb");
+        if (afp && (fseek(afp, 0L, SEEK_END) != 0 || (asize = ftell(afp)) < 0L ||
+                    fseek(afp, 0L, SEEK_SET) != 0)) {
+            fclose(afp);
+            afp = NULL;
+            asize = 0L;
+        }
+        if (locked) (void)tbl_fs_lock_close(&lk);
+    }
+    if (sg.oom) {
+        if (afp) fclose(afp);
+        free(sg.seq);
+        tbl_audit_seterr(err, errsz, "out of memory");
+        return TBLX_EXIT_IO;
+    }
+    tbl_audit_segs_sort(&sg);
+
+    /* sealed segments must be 1..n without gaps */
+    for (i = 0UL; i < sg.n; ++i) {
+        if (sg.seq[i] != i + 1UL) {
+            char msg[128];
+            (void)tbl_audit_seg_name(i + 1UL, name, sizeof(name));
+            (void)tbl_strlcpy(msg, "audit integrity: missing segment ", sizeof(msg));
+            (void)tbl_strlcat(msg, name, sizeof(msg));
+            if (afp) fclose(afp);
+            free(sg.seq);
+            tbl_audit_seterr(err, errsz, msg);
+            return TBLX_EXIT_INTEGRITY;
+        }
+    }
+    active = sg.n + 1UL;
+    free(sg.seq);
+
+    if (!afp && active == 1UL) {
         tbl_audit_seterr(err, errsz, "audit log not found");
         return TBLX_EXIT_NOTFOUND;
     }
 
-    fp = fopen(audit_path, "rb");
-    if (!fp) {
-        tbl_audit_seterr(err, errsz, "cannot open audit log");
-        return TBLX_EXIT_IO;
+    if (resume && (pos->seg < 1UL || pos->seg > active)) {
+        if (afp) fclose(afp);
+        tbl_audit_seterr(err, errsz, "audit integrity: checkpoint does not match log (run with --full)");
+        return TBLX_EXIT_INTEGRITY;
+    }
+    if (!resume) {
+        pos->seg = 1UL;
+        pos->offset = 0UL;
+        pos->lines = 0UL;
+        tbl_audit_zero64(pos->head);
     }
 
-    tbl_audit_zero64(expected_prev);
-    line_no = 0UL;
+    rc = TBLX_EXIT_OK;
+    for (seq = pos->seg; seq <= active; ++seq) {
+        FILE *fp;
+        tbl_tlz_t zs;
+        tbl_tlz_t *z;
+        unsigned long base;
+        unsigned long bad_line;
+        int bad_code;
+        int first;
+        int is_z;
 
-    while (fgets(buf, (int)sizeof(buf), fp) != NULL) {
-        size_t len;
-        char prev[65];
-        char hash[65];
-        const char *canonical;
-        char calc[65];
+        first = (resume && seq == pos->seg) ? 1 : 0;
 
-        line_no++;
-
-        /* reject CR anywhere (LF-only). */
-        if (strchr(buf, '\r') != NULL) {
-            fclose(fp);
-            tbl_audit_seterr_line(err, errsz, line_no, "CR found");
-            return TBLX_EXIT_INTEGRITY;
+        if (seq == active) {
+            (void)tbl_strlcpy(name, "ops.log", sizeof(name));
+        } else {
+            (void)tbl_audit_seg_name(seq, name, sizeof(name));
         }
-
-        len = strlen(buf);
-        if (len == 0) continue;
-        if (buf[len - 1] != '\n') {
-            fclose(fp);
-            tbl_audit_seterr_line(err, errsz, line_no, "missing LF or line too long");
-            return TBLX_EXIT_INTEGRITY;
+        is_z = 0;
+        if (seq == active) {
+            /* snapshot handle; missing or empty: sealed, next segment not
+             * started yet */
+            fp = afp;
+            afp = NULL;
+            if (fp && asize == 0L) {
+                fclose(fp);
+                fp = NULL;
+            }
+        } else if (!tbl_audit_seg_open_ok(audit_dir, seq, &fp, &zs, &is_z)) {
+            tbl_audit_seterr(err, errsz, "cannot open audit log");
+            rc = TBLX_EXIT_IO;
+            break;
         }
-        buf[len - 1] = '\0';
+        z = is_z ? &zs : NULL;
+        if (z) (void)tbl_strlcat(name, ".tlz", sizeof(name));
 
-        if (buf[0] == '\0') {
-            fclose(fp);
-            tbl_audit_seterr_line(err, errsz, line_no, "empty line");
-            return TBLX_EXIT_INTEGRITY;
+        /* segment header: previous final hash (prev=) and line count */
+        base = 0UL;
+        if ((fp || z) && seq > 1UL) {
+            int h = tbl_audit_seg_header(fp, z, seq, &base);
+            if (h == 0 || (h < 0 && seq != active) ||
+                (h > 0 && !(first && pos->offset > 0UL) && base != pos->lines)) {
+                if (fp) fclose(fp);
+                if (z) tbl_tlz_close(z);
+                tbl_audit_seterr_line(err, errsz, name, 1UL, (h > 0) ? "segment header line count mismatch"
+                                                                     : "segment header missing or malformed");
+                rc = TBLX_EXIT_INTEGRITY;
+                break;
+            }
         }
 
-        canonical = NULL;
-        if (!tbl_audit_parse_line(buf, prev, hash, &canonical)) {
-            fclose(fp);
-            tbl_audit_seterr_line(err, errsz, line_no, "invalid format");
-            return TBLX_EXIT_INTEGRITY;
+        if (first) {
+            char anchor[65];
+
+            if (pos->offset > (unsigned long)LONG_MAX ||
+                (z && pos->offset > z->raw_size) ||
+                !tbl_audit_cp_anchor(fp, z, pos->offset, pos->head, anchor) ||
+                !tbl_streq(anchor, pos->anchor) ||
+                (fp && fseek(fp, (long)pos->offset, SEEK_SET) != 0)) {
+                if (fp) fclose(fp);
+                if (z) tbl_tlz_close(z);
+                tbl_audit_seterr(err, errsz, "audit integrity: checkpoint does not match log (run with --full)");
+                rc = TBLX_EXIT_INTEGRITY;
+                break;
+            }
+        } else {
+            pos->offset = 0UL;
         }
+        pos->seg = seq;
+        if (!fp && !z) break;
 
-        if (!tbl_audit_is_hex64(prev) || !tbl_audit_is_hex64(hash)) {
+        bad_line = 0UL;
+        bad_code = TBL_AUDIT_E_NONE;
+        if (z) {
+            rc = tbl_audit_scan_tlz(z, pos->offset, nw, pos->head, &pos->lines, &pos->offset, &bad_line, &bad_code, err, errsz);
+            tbl_tlz_close(z);
+        } else {
+            rc = tbl_audit_scan(fp, (seq == active) ? asize : -1L, nw, pos->head, &pos->lines, &pos->offset, &bad_line, &bad_code, err, errsz);
             fclose(fp);
-            tbl_audit_seterr_line(err, errsz, line_no, "invalid hex");
-            return TBLX_EXIT_INTEGRITY;
         }
+        if (rc == TBLX_EXIT_INTEGRITY && bad_line != 0UL) {
+            tbl_audit_seterr_line(err, errsz, (active > 1UL) ? name : NULL,
+                                  bad_line - base, tbl_audit_reason(bad_code));
+        }
+        if (rc != TBLX_EXIT_OK) break;
+    }
+    if (afp) fclose(afp);
+    return rc;
+}
 
-        if (!tbl_streq(prev, expected_prev)) {
-            fclose(fp);
-            tbl_audit_seterr_line(err, errsz, line_no, "prev mismatch");
-            return TBLX_EXIT_INTEGRITY;
+int tbl_audit_verify_ops(const char *repo_root, char *err, size_t errsz)
+{
+    return tbl_audit_verify_ops_ex(repo_root, 1UL, err, errsz);
+}
+
+int tbl_audit_verify_ops_ex(const char *repo_root, unsigned long nthreads, char *err, size_t errsz)
+{
+    tbl_audit_cp_t pos;
+
+    if (err && errsz) err[0] = '\0';
+    return tbl_audit_walk(repo_root, tbl_thread_workers(nthreads), &pos, 0, err, errsz);
+}
+
+int tbl_audit_verify_ops_incr(const char *repo_root, unsigned long nthreads, int full,
+                              unsigned long *out_resumed, unsigned long *out_lines,
+                              char *err, size_t errsz)
+{
+    char cp_path[1024];
+    char ops_path[1024];
+    char lock_path[1024];
+    tbl_audit_cp_t cp;
+    int resume;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_resumed) *out_resumed = 0UL;
+    if (out_lines) *out_lines = 0UL;
+
+    if (!repo_root || !repo_root[0]) {
+        tbl_audit_seterr(err, errsz, "invalid args");
+        return TBLX_EXIT_IO;
+    }
+    if (!tbl_audit_ops_path(repo_root, "ops.checkpoint", cp_path, sizeof(cp_path), err, errsz) ||
+        !tbl_audit_ops_path(repo_root, "ops.lock", lock_path, sizeof(lock_path), err, errsz)) {
+        return TBLX_EXIT_IO;
+    }
+
+    /* a missing or unreadable checkpoint means a full run; one that no
+     * longer matches the log means the verified prefix was changed */
+    resume = (!full && tbl_audit_cp_read(cp_path, &cp)) ? 1 : 0;
+    if (out_resumed && resume) *out_resumed = cp.lines;
+
+    rc = tbl_audit_walk(repo_root, tbl_thread_workers(nthreads), &cp, resume, err, errsz);
+    if (out_lines) *out_lines = cp.lines;
+
+    if (rc == TBLX_EXIT_OK) {
+        FILE *fp;
+        tbl_tlz_t z;
+        int is_z;
+        int ok;
+
+        /* the verified file may have been sealed (or compressed) since
+         * the walk */
+        fp = NULL;
+        is_z = 0;
+        if (cp.offset > 0UL) {
+            tbl_fs_lock_t lk;
+            int locked;
+
+            locked = (tbl_fs_lock_open(&lk, lock_path) == 0) ? 1 : 0;
+            if (locked && tbl_fs_lock_acquire(&lk) != 0) {
+                (void)tbl_fs_lock_close(&lk);
+                locked = 0;
+            }
+            if (tbl_audit_chain_path_ok(repo_root, cp.seg, tbl_audit_sealed_count(repo_root),
+                                        ops_path, sizeof(ops_path))) {
+                if (tbl_audit_path_tlz_ok(ops_path)) {
+                    is_z = (tbl_tlz_open(&z, ops_path, NULL, 0) == 0) ? 1 : 0;
+                } else {
+                    fp = fopen(ops_path, "rb");
+                }
+            }
+            if (locked) (void)tbl_fs_lock_close(&lk);
         }
+        ok = (cp.offset == 0UL || fp || is_z) &&
+             tbl_audit_cp_anchor(fp, is_z ? &z : NULL, cp.offset, cp.head, cp.anchor) &&
+             tbl_audit_cp_write(cp_path, &cp);
+        if (fp) fclose(fp);
+        if (is_z) tbl_tlz_close(&z);
+        if (!ok) {
+            tbl_audit_seterr(err, errsz, "cannot write audit checkpoint");
+            rc = TBLX_EXIT_IO;
+        }
+    }
+    return rc;
+}
 
-        /* Optional sanity check: canonical begins with ts= and contains event= */
-        if (!tbl_str_starts_with(canonical, "ts=") || strstr(canonical, " event=") == NULL) {
-            fclose(fp);
-            tbl_audit_seterr_line(err, errsz, line_no, "canonical malformed");
-            return TBLX_EXIT_INTEGRITY;
+/* ---- archival ---- */
+
+static void tbl_audit_seterr_mismatch(char *err, size_t errsz, const char *name)
+{
+    char msg[128];
+
+    (void)tbl_strlcpy(msg, "audit integrity: ", sizeof(msg));
+    (void)tbl_strlcat(msg, name, sizeof(msg));
+    (void)tbl_strlcat(msg, ": compressed copy does not match", sizeof(msg));
+    tbl_audit_seterr(err, errsz, msg);
+}
+
+/* SHA-256 of a plain file, or of the raw content of a .tlz frame. */
+static int tbl_audit_digest_ok(const char *path, int is_z, unsigned char out[32])
+{
+    tbl_sha256_t st;
+    char *buf;
+    int ok;
+
+    buf = (char *)malloc((size_t)TBL_TLZ_BLOCK_MAX);
+    if (!buf) return 0;
+    tbl_sha256_init(&st);
+    ok = 1;
+    if (is_z) {
+        tbl_tlz_t z;
+        unsigned long b;
+
+        if (tbl_tlz_open(&z, path, NULL, 0) != 0) {
+            free(buf);
+            return 0;
+        }
+        for (b = 0UL; b < z.nblocks && ok; ++b) {
+            ok = tbl_tlz_pread_ok(&z, z.ent[b].raw_off, buf, (size_t)z.ent[b].raw_len);
+            if (ok) tbl_sha256_update(&st, buf, (size_t)z.ent[b].raw_len);
         }
+        tbl_tlz_close(&z);
+    } else {
+        FILE *fp = fopen(path, "rb");
+        size_t n;
 
-        tbl_audit_hash_chain(prev, canonical, calc);
-        if (!tbl_streq(calc, hash)) {
-            fclose(fp);
-            tbl_audit_seterr_line(err, errsz, line_no, "hash mismatch");
-            return TBLX_EXIT_INTEGRITY;
+        if (!fp) {
+            free(buf);
+            return 0;
         }
+        while ((n = fread(buf, 1, (size_t)TBL_TLZ_BLOCK_MAX, fp)) > 0) tbl_sha256_update(&st, buf, n);
+        if (ferror(fp)) ok = 0;
+        fclose(fp);
+    }
+    free(buf);
+    if (ok) tbl_sha256_final(&st, out);
+    return ok;
+}
 
-        (void)tbl_strlcpy(expected_prev, hash, sizeof(expected_prev));
+int tbl_audit_compress_segments(const char *repo_root, unsigned long keep, unsigned long nthreads,
+                                unsigned long *out_segs, unsigned long *out_raw,
+                                unsigned long *out_comp, char *err, size_t errsz)
+{
+    char audit_dir[1024];
+    char name[40];
+    char plain[1100];
+    char zpath[1100];
+    char tmp[1100];
+    tbl_audit_segs_t sg;
+    unsigned long i;
+    int ex;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_segs) *out_segs = 0UL;
+    if (out_raw) *out_raw = 0UL;
+    if (out_comp) *out_comp = 0UL;
+    if (!repo_root || !repo_root[0]) {
+        tbl_audit_seterr(err, errsz, "invalid args");
+        return TBLX_EXIT_IO;
+    }
+    if (!tbl_path_join2(audit_dir, sizeof(audit_dir), repo_root, "audit")) {
+        tbl_audit_seterr(err, errsz, "audit path too long");
+        return TBLX_EXIT_IO;
     }
+    if (keep < 1UL) keep = 1UL; /* the writer chains onto the newest one */
 
-    if (ferror(fp)) {
-        fclose(fp);
-        tbl_audit_seterr(err, errsz, "read error");
+    (void)memset(&sg, 0, sizeof(sg));
+    ex = 0;
+    (void)tbl_fs_is_dir(audit_dir, &ex);
+    if (ex) (void)tbl_fs_list_dir(audit_dir, tbl_audit_segs_cb, &sg);
+    if (sg.oom) {
+        free(sg.seq);
+        tbl_audit_seterr(err, errsz, "out of memory");
         return TBLX_EXIT_IO;
     }
+    tbl_audit_segs_sort(&sg);
 
-    fclose(fp);
-    return TBLX_EXIT_OK;
+    rc = TBLX_EXIT_OK;
+    for (i = 0UL; i + keep < sg.n && rc == TBLX_EXIT_OK; ++i) {
+        unsigned char d0[32];
+        unsigned char d1[32];
+        unsigned long raw;
+        unsigned long comp;
+        int has_plain;
+        int has_z;
+
+        if (!tbl_audit_seg_name(sg.seq[i], name, sizeof(name)) ||
+            !tbl_path_join2(plain, sizeof(plain), audit_dir, name) ||
+            !tbl_strlcpy_ok(zpath, plain, sizeof(zpath)) || !tbl_strlcat_ok(zpath, ".tlz", sizeof(zpath)) ||
+            !tbl_strlcpy_ok(tmp, zpath, sizeof(tmp)) || !tbl_strlcat_ok(tmp, ".tmp", sizeof(tmp))) {
+            tbl_audit_seterr(err, errsz, "audit path too long");
+            rc = TBLX_EXIT_IO;
+            break;
+        }
+        has_plain = 0;
+        has_z = 0;
+        (void)tbl_fs_exists(plain, &has_plain);
+        (void)tbl_fs_exists(zpath, &has_z);
+        if (!has_plain) continue; /* already compressed */
+
+        if (!tbl_audit_digest_ok(plain, 0, d0)) {
+            tbl_audit_seterr(err, errsz, "cannot read audit segment");
+            rc = TBLX_EXIT_IO;
+            break;
+        }
+        if (has_z) {
+            /* interrupted after the rename: the frame is complete */
+            if (!tbl_audit_digest_ok(zpath, 1, d1) || memcmp(d0, d1, 32) != 0) {
+                tbl_audit_seterr_mismatch(err, errsz, name);
+                rc = TBLX_EXIT_INTEGRITY;
+                break;
+            }
+            (void)tbl_fs_remove_file(plain);
+            continue;
+        }
+
+        if (tbl_tlz_compress_file(plain, tmp, nthreads, &raw, &comp, err, errsz) != 0) {
+            rc = TBLX_EXIT_IO;
+            break;
+        }
+        /* read back before the original goes away */
+        if (!tbl_audit_digest_ok(tmp, 1, d1) || memcmp(d0, d1, 32) != 0) {
+            (void)tbl_fs_remove_file(tmp);
+            tbl_audit_seterr_mismatch(err, errsz, name);
+            rc = TBLX_EXIT_INTEGRITY;
+            break;
+        }
+        if (tbl_fs_rename_atomic(tmp, zpath, 0) != 0) {
+            (void)tbl_fs_remove_file(tmp);
+            tbl_audit_seterr(err, errsz, "cannot rename compressed segment");
+            rc = TBLX_EXIT_IO;
+            break;
+        }
+        (void)tbl_fs_set_readonly(zpath);
+        if (tbl_fs_remove_file(plain) != 0) {
+            tbl_audit_seterr(err, errsz, "cannot remove compressed segment original");
+            rc = TBLX_EXIT_IO;
+            break;
+        }
+        if (out_segs) (*out_segs)++;
+        if (out_raw) *out_raw += raw;
+        if (out_comp) *out_comp += comp;
+    }
+    free(sg.seq);
+    return rc;
 }
 
 #endif /* TBL_AUDIT_IMPLEMENTATION */
@@ -0,0 +1,2 @@
+#define TBL_COLSNAP_IMPLEMENTATION
+#include "core/colsnap.h"
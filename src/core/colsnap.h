@@ -0,0 +1,823 @@
+#ifndef TBL_CORE_COLSNAP_H
+#define TBL_CORE_COLSNAP_H
+
+#include <limits.h>
+#include <stddef.h>
+
+/* Columnar snapshot of all records for analytic scans (`tablinum index
+   --snapshot`, read by `tablinum stats`).
+   <repo_root>/index/records.col, little-endian, every section starting on
+   a 64-byte boundary so a column can be used (or mapped) as it is:
+   - header (64 bytes)  "TBLCOL1\n", u32 n, u32 ndict, u32 dict_len,
+                        u32 first_day, u32 last_day (UTC days of the
+                        oldest / newest dated record), u32 0, u32 FNV-1a
+                        over the 32 bytes before and the dictionary
+   - dictionary         ndict reason texts, each NUL terminated
+   - u32 stored_at[n]   unix seconds (0 = undated)
+   - u32 bytes[n]
+   - u8  status[n]      1 ok, 2 fail, 3 other
+   - u8  uniq[n]        1 = first ok record of its sha256 (dedup)
+   - u32 reason[n]      1-based dictionary index, 0 = no reason
+   - u8  sha256[n][32]  binary, all zero = none
+   Derived from the records like the other indexes; rebuilt whole (tmp +
+   rename). A record written after the build is not in it.
+*/
+
+#define TBL_COLSNAP_HDR 64UL
+#define TBL_COLSNAP_ALIGN 64UL
+
+/* distinct reason texts kept; the rest share the last entry "(other)" */
+#ifndef TBL_COLSNAP_DICT_MAX
+#define TBL_COLSNAP_DICT_MAX 4096UL
+#endif
+
+/* per-day breakdown only up to this many days between first and last */
+#define TBL_COLSNAP_DAYS_MAX 36600UL
+
+#define TBL_COLSNAP_OK 1
+#define TBL_COLSNAP_FAIL 2
+#define TBL_COLSNAP_OTHER 3
+
+#if UINT_MAX >= 0xffffffffUL
+typedef unsigned int tbl_colsnap_u32;
+#else
+typedef unsigned long tbl_colsnap_u32;
+#endif
+
+/* Loaded snapshot: one array per column. */
+typedef struct tbl_colsnap_s {
+    unsigned long n;
+    unsigned long ndict;
+    unsigned long first_day;
+    unsigned long last_day;
+    char *dict;                 /* ndict NUL-terminated texts */
+    const char **reasons;       /* [1..ndict] into dict; [0] = "" */
+    tbl_colsnap_u32 *stored_at;
+    tbl_colsnap_u32 *bytes;
+    unsigned char *status;
+    unsigned char *uniq;
+    tbl_colsnap_u32 *reason;
+    unsigned char *sha256;      /* NULL unless loaded with_sha */
+} tbl_colsnap_t;
+
+/* Filter for tbl_colsnap_stats(); zero = everything. */
+typedef struct tbl_colsnap_q_s {
+    unsigned long since;        /* stored_at >= since, if since_set */
+    unsigned long until;        /* stored_at < until, if until_set */
+    int since_set;
+    int until_set;
+    int status;                 /* 0 or TBL_COLSNAP_OK/FAIL/OTHER */
+} tbl_colsnap_q_t;
+
+typedef struct tbl_colsnap_stats_s {
+    unsigned long n[4];         /* [0] all matching, [code] by status */
+    unsigned long bytes[4];
+    unsigned long uniq_n;       /* distinct sha256 among ok records */
+    unsigned long uniq_bytes;
+    unsigned long undated;
+    unsigned long day0;         /* first day of the arrays below */
+    unsigned long ndays;        /* 0 = no per-day breakdown */
+    unsigned long *day_n;
+    unsigned long *day_fail;
+    unsigned long *day_bytes;
+    unsigned long *reason_n;    /* [ndict + 1]: fail records per reason */
+} tbl_colsnap_stats_t;
+
+/* Rebuild index/records.col from all stored records. Returns 0 ok, 2 error. */
+int tbl_colsnap_build(const char *repo_root, unsigned long *out_n, char *err, size_t errsz);
+
+/* Load index/records.col (the sha256 column only if with_sha).
+   Returns 0 ok, 1 no snapshot, 2 error (damaged). */
+int tbl_colsnap_load(tbl_colsnap_t *cs, const char *repo_root, int with_sha, char *err, size_t errsz);
+void tbl_colsnap_free(tbl_colsnap_t *cs);
+
+/* Status code of a status text (ok/fail/anything else). */
+int tbl_colsnap_code(const char *status);
+
+/* Aggregate over cs on nthreads workers (0 = one per CPU).
+   Returns 0 ok, 2 out of memory. */
+int tbl_colsnap_stats(const tbl_colsnap_t *cs, const tbl_colsnap_q_t *q, unsigned long nthreads,
+                      tbl_colsnap_stats_t *out, char *err, size_t errsz);
+void tbl_colsnap_stats_free(tbl_colsnap_stats_t *st);
+
+/* UTC day number -> "YYYY-MM-DD". Returns 1/0. */
+int tbl_colsnap_day_str(unsigned long day, char *buf, size_t bufsz);
+
+#ifdef TBL_COLSNAP_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/record.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+#include "os/thread.h"
+
+static void tbl_colsnap_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "colsnap error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static void tbl_colsnap_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+static unsigned long tbl_colsnap_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) |
+           ((unsigned long)p[3] << 24);
+}
+
+static unsigned long tbl_colsnap_fnv(unsigned long h, const void *data, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        h ^= (unsigned long)p[i];
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+    return h;
+}
+
+static unsigned long tbl_colsnap_pad(unsigned long len)
+{
+    return (TBL_COLSNAP_ALIGN - len % TBL_COLSNAP_ALIGN) % TBL_COLSNAP_ALIGN;
+}
+
+/* host stores tbl_colsnap_u32 as 4 little-endian bytes: columns load with one fread */
+static int tbl_colsnap_native_ok(void)
+{
+    tbl_colsnap_u32 v = (tbl_colsnap_u32)0x04030201UL;
+    const unsigned char *p = (const unsigned char *)&v;
+
+    return sizeof(v) == 4U && p[0] == 1 && p[1] == 2 && p[2] == 3 && p[3] == 4;
+}
+
+static int tbl_colsnap_paths(const char *repo_root, char *path, char *tmp, size_t sz)
+{
+    return tbl_path_join2(path, sz, repo_root, "index/records.col") &&
+           tbl_path_join2(tmp, sz, repo_root, "index/records.col.tmp");
+}
+
+int tbl_colsnap_code(const char *status)
+{
+    if (tbl_streq(status, "ok")) return TBL_COLSNAP_OK;
+    if (tbl_streq(status, "fail")) return TBL_COLSNAP_FAIL;
+    return TBL_COLSNAP_OTHER;
+}
+
+static int tbl_colsnap_hex(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* ---- build ---- */
+
+typedef struct tbl_colsnap_b_s {
+    unsigned long n;
+    unsigned long cap;
+    tbl_colsnap_u32 *stored_at;
+    tbl_colsnap_u32 *bytes;
+    unsigned char *status;
+    tbl_colsnap_u32 *reason;
+    unsigned char *sha256;
+    /* reason dictionary: open addressing over 1-based entry numbers */
+    unsigned long ndict;
+    unsigned long *doff;        /* [1..ndict] offsets into dict */
+    unsigned long *dslot;
+    unsigned long dslots;
+    char *dict;
+    unsigned long dict_len;
+    unsigned long dict_cap;
+    unsigned long first_at;
+    unsigned long last_at;
+    int failed;
+} tbl_colsnap_b_t;
+
+static void *tbl_colsnap_grow(void *p, unsigned long cap, size_t elem)
+{
+    size_t bytes;
+
+    if (!tbl_size_mul_ok((size_t)cap, elem, &bytes)) return 0;
+    return realloc(p, bytes ? bytes : 1U);
+}
+
+static int tbl_colsnap_b_reserve(tbl_colsnap_b_t *b)
+{
+    unsigned long cap;
+    void *p;
+
+    if (b->n < b->cap) return 1;
+    cap = b->cap ? b->cap * 2UL : 1024UL;
+    if (cap <= b->cap || cap > 0xffffffffUL) return 0;
+    if (!(p = tbl_colsnap_grow(b->stored_at, cap, sizeof(tbl_colsnap_u32)))) return 0;
+    b->stored_at = (tbl_colsnap_u32 *)p;
+    if (!(p = tbl_colsnap_grow(b->bytes, cap, sizeof(tbl_colsnap_u32)))) return 0;
+    b->bytes = (tbl_colsnap_u32 *)p;
+    if (!(p = tbl_colsnap_grow(b->status, cap, 1U))) return 0;
+    b->status = (unsigned char *)p;
+    if (!(p = tbl_colsnap_grow(b->reason, cap, sizeof(tbl_colsnap_u32)))) return 0;
+    b->reason = (tbl_colsnap_u32 *)p;
+    if (!(p = tbl_colsnap_grow(b->sha256, cap, 32U))) return 0;
+    b->sha256 = (unsigned char *)p;
+    b->cap = cap;
+    return 1;
+}
+
+static unsigned long tbl_colsnap_dict_add_text(tbl_colsnap_b_t *b, const char *s)
+{
+    unsigned long len = (unsigned long)strlen(s) + 1UL;
+    void *p;
+
+    if (b->dict_len + len > b->dict_cap) {
+        unsigned long cap = b->dict_cap ? b->dict_cap : 4096UL;
+        while (cap < b->dict_len + len) cap *= 2UL;
+        if (!(p = realloc(b->dict, (size_t)cap))) return 0UL;
+        b->dict = (char *)p;
+        b->dict_cap = cap;
+    }
+    (void)memcpy(b->dict + b->dict_len, s, (size_t)len);
+    b->ndict++;
+    b->doff[b->ndict] = b->dict_len;
+    b->dict_len += len;
+    return b->ndict;
+}
+
+/* 1-based dictionary entry of reason s; 0 on out of memory */
+static unsigned long tbl_colsnap_dict_id(tbl_colsnap_b_t *b, const char *s)
+{
+    unsigned long h;
+    unsigned long i;
+    unsigned long id;
+
+    if (!b->doff) {
+        b->dslots = 1024UL;
+        while (b->dslots < TBL_COLSNAP_DICT_MAX * 2UL) b->dslots *= 2UL;
+        b->doff = (unsigned long *)calloc((size_t)TBL_COLSNAP_DICT_MAX + 1U, sizeof(unsigned long));
+        b->dslot = (unsigned long *)calloc((size_t)b->dslots, sizeof(unsigned long));
+        if (!b->doff || !b->dslot) return 0UL;
+    }
+    h = tbl_colsnap_fnv(2166136261UL, s, strlen(s));
+    for (i = h & (b->dslots - 1UL);; i = (i + 1UL) & (b->dslots - 1UL)) {
+        id = b->dslot[i];
+        if (id == 0UL) break;
+        if (tbl_streq(b->dict + b->doff[id], s)) return id;
+    }
+    if (b->ndict + 1UL >= TBL_COLSNAP_DICT_MAX) {
+        /* full: everything new shares the last entry */
+        if (b->ndict + 1UL == TBL_COLSNAP_DICT_MAX) return tbl_colsnap_dict_add_text(b, "(other)");
+        return b->ndict;
+    }
+    id = tbl_colsnap_dict_add_text(b, s);
+    if (id != 0UL) b->dslot[i] = id;
+    return id;
+}
+
+static int tbl_colsnap_build_cb(void *ud, const tbl_record_t *rec)
+{
+    tbl_colsnap_b_t *b = (tbl_colsnap_b_t *)ud;
+    unsigned char *sha;
+    unsigned long at = rec->stored_at & 0xffffffffUL;
+    unsigned long id = 0UL;
+    size_t i;
+
+    if (!tbl_colsnap_b_reserve(b)) {
+        b->failed = 1;
+        return 1;
+    }
+    if (rec->reason[0]) {
+        id = tbl_colsnap_dict_id(b, rec->reason);
+        if (id == 0UL) {
+            b->failed = 1;
+            return 1;
+        }
+    }
+    b->stored_at[b->n] = (tbl_colsnap_u32)at;
+    b->bytes[b->n] = (tbl_colsnap_u32)(rec->bytes & 0xffffffffUL);
+    b->status[b->n] = (unsigned char)tbl_colsnap_code(rec->status);
+    b->reason[b->n] = (tbl_colsnap_u32)id;
+    sha = b->sha256 + (size_t)b->n * 32U;
+    (void)memset(sha, 0, 32U);
+    if (strlen(rec->sha256) == 64U) {
+        for (i = 0; i < 32U; ++i) {
+            int hi = tbl_colsnap_hex(rec->sha256[2U * i]);
+            int lo = tbl_colsnap_hex(rec->sha256[2U * i + 1U]);
+            if (hi < 0 || lo < 0) break;
+            sha[i] = (unsigned char)((hi << 4) | lo);
+        }
+        if (i < 32U) (void)memset(sha, 0, 32U);
+    }
+    if (at != 0UL) {
+        if (b->first_at == 0UL || at < b->first_at) b->first_at = at;
+        if (at > b->last_at) b->last_at = at;
+    }
+    b->n++;
+    return 0;
+}
+
+static const unsigned char *g_colsnap_sort_sha;
+
+/* by sha256, then by position: the first of a run is the first stored */
+static int tbl_colsnap_cmp_sha(const void *x, const void *y)
+{
+    tbl_colsnap_u32 a = *(const tbl_colsnap_u32 *)x;
+    tbl_colsnap_u32 b = *(const tbl_colsnap_u32 *)y;
+    int c = memcmp(g_colsnap_sort_sha + (size_t)a * 32U, g_colsnap_sort_sha + (size_t)b * 32U, 32U);
+
+    if (c != 0) return c;
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+/* uniq[i] = 1 for the first ok record of every sha256 */
+static int tbl_colsnap_mark_uniq(const tbl_colsnap_b_t *b, unsigned char *uniq)
+{
+    static const unsigned char zero[32];
+    tbl_colsnap_u32 *ix;
+    unsigned long m = 0UL;
+    unsigned long i;
+
+    (void)memset(uniq, 0, (size_t)(b->n ? b->n : 1UL));
+    ix = (tbl_colsnap_u32 *)malloc((size_t)(b->n ? b->n : 1UL) * sizeof(tbl_colsnap_u32));
+    if (!ix) return 0;
+    for (i = 0UL; i < b->n; ++i) {
+        if (b->status[i] == TBL_COLSNAP_OK && memcmp(b->sha256 + (size_t)i * 32U, zero, 32U) != 0) {
+            ix[m++] = (tbl_colsnap_u32)i;
+        }
+    }
+    g_colsnap_sort_sha = b->sha256;
+    qsort(ix, (size_t)m, sizeof(ix[0]), tbl_colsnap_cmp_sha);
+    for (i = 0UL; i < m; ++i) {
+        if (i == 0UL || memcmp(b->sha256 + (size_t)ix[i] * 32U, b->sha256 + (size_t)ix[i - 1UL] * 32U, 32U) != 0) {
+            uniq[ix[i]] = 1;
+        }
+    }
+    free(ix);
+    return 1;
+}
+
+static int tbl_colsnap_write_pad(FILE *fp, unsigned long len)
+{
+    static const unsigned char zero[TBL_COLSNAP_ALIGN];
+    size_t k = (size_t)tbl_colsnap_pad(len);
+
+    return k == 0U || fwrite(zero, 1, k, fp) == k;
+}
+
+static int tbl_colsnap_write_u32s(FILE *fp, const tbl_colsnap_u32 *v, unsigned long n)
+{
+    unsigned char buf[4096];
+    unsigned long i = 0UL;
+
+    if (tbl_colsnap_native_ok()) {
+        if (n > 0UL && fwrite(v, 4U, (size_t)n, fp) != (size_t)n) return 0;
+    } else {
+        while (i < n) {
+            size_t k = 0;
+            while (i < n && k + 4U <= sizeof(buf)) {
+                tbl_colsnap_put32(buf + k, (unsigned long)v[i++]);
+                k += 4U;
+            }
+            if (fwrite(buf, 1, k, fp) != k) return 0;
+        }
+    }
+    return tbl_colsnap_write_pad(fp, n * 4UL);
+}
+
+static int tbl_colsnap_write_u8s(FILE *fp, const unsigned char *v, unsigned long n)
+{
+    if (n > 0UL && fwrite(v, 1, (size_t)n, fp) != (size_t)n) return 0;
+    return tbl_colsnap_write_pad(fp, n);
+}
+
+static int tbl_colsnap_write(const tbl_colsnap_b_t *b, const unsigned char *uniq, const char *path,
+                             const char *tmp)
+{
+    unsigned char h[TBL_COLSNAP_HDR];
+    unsigned long fnv;
+    FILE *fp;
+    int ok;
+
+    (void)memset(h, 0, sizeof(h));
+    (void)memcpy(h, "TBLCOL1\n", 8U);
+    tbl_colsnap_put32(h + 8, b->n);
+    tbl_colsnap_put32(h + 12, b->ndict);
+    tbl_colsnap_put32(h + 16, b->dict_len);
+    tbl_colsnap_put32(h + 20, b->first_at / 86400UL);
+    tbl_colsnap_put32(h + 24, b->last_at / 86400UL);
+    fnv = tbl_colsnap_fnv(2166136261UL, h, 32U);
+    if (b->dict_len) fnv = tbl_colsnap_fnv(fnv, b->dict, (size_t)b->dict_len);
+    tbl_colsnap_put32(h + 32, fnv);
+
+    fp = fopen(tmp, "wb");
+    if (!fp) return 0;
+    ok = fwrite(h, 1, sizeof(h), fp) == sizeof(h) &&
+         (b->dict_len == 0UL || fwrite(b->dict, 1, (size_t)b->dict_len, fp) == (size_t)b->dict_len) &&
+         tbl_colsnap_write_pad(fp, b->dict_len) &&
+         tbl_colsnap_write_u32s(fp, b->stored_at, b->n) &&
+         tbl_colsnap_write_u32s(fp, b->bytes, b->n) &&
+         tbl_colsnap_write_u8s(fp, b->status, b->n) &&
+         tbl_colsnap_write_u8s(fp, uniq, b->n) &&
+         tbl_colsnap_write_u32s(fp, b->reason, b->n) &&
+         (b->n == 0UL || fwrite(b->sha256, 32U, (size_t)b->n, fp) == (size_t)b->n);
+    if (fclose(fp) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(tmp, path, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(tmp);
+    return ok;
+}
+
+static void tbl_colsnap_b_free(tbl_colsnap_b_t *b)
+{
+    free(b->stored_at);
+    free(b->bytes);
+    free(b->status);
+    free(b->reason);
+    free(b->sha256);
+    free(b->doff);
+    free(b->dslot);
+    free(b->dict);
+}
+
+int tbl_colsnap_build(const char *repo_root, unsigned long *out_n, char *err, size_t errsz)
+{
+    tbl_colsnap_b_t b;
+    char path[1024];
+    char tmp[1024];
+    char dir[1024];
+    unsigned char *uniq;
+    int rc = 0;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_n) *out_n = 0UL;
+    if (!repo_root || !repo_root[0]) {
+        tbl_colsnap_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_colsnap_paths(repo_root, path, tmp, sizeof(path)) ||
+        !tbl_path_join2(dir, sizeof(dir), repo_root, "index")) {
+        tbl_colsnap_seterr(err, errsz, "snapshot path too long");
+        return 2;
+    }
+    if (tbl_fs_mkdir_p(dir) != 0) {
+        tbl_colsnap_seterr(err, errsz, "cannot create index dir");
+        return 2;
+    }
+
+    (void)memset(&b, 0, sizeof(b));
+    if (tbl_record_each(repo_root, tbl_colsnap_build_cb, &b, err, errsz) != 0) {
+        if (err && errsz && !err[0]) tbl_colsnap_seterr(err, errsz, "cannot read records");
+        rc = 2;
+    }
+    if (rc == 0 && b.failed) {
+        tbl_colsnap_seterr(err, errsz, "out of memory");
+        rc = 2;
+    }
+    uniq = 0;
+    if (rc == 0) {
+        uniq = (unsigned char *)malloc((size_t)(b.n ? b.n : 1UL));
+        if (!uniq || !tbl_colsnap_mark_uniq(&b, uniq)) {
+            tbl_colsnap_seterr(err, errsz, "out of memory");
+            rc = 2;
+        }
+    }
+    if (rc == 0 && !tbl_colsnap_write(&b, uniq, path, tmp)) {
+        tbl_colsnap_seterr(err, errsz, "cannot write records.col");
+        rc = 2;
+    }
+    if (rc == 0 && out_n) *out_n = b.n;
+    free(uniq);
+    tbl_colsnap_b_free(&b);
+    return rc;
+}
+
+/* ---- load ---- */
+
+void tbl_colsnap_free(tbl_colsnap_t *cs)
+{
+    if (!cs) return;
+    free(cs->dict);
+    free((void *)cs->reasons);
+    free(cs->stored_at);
+    free(cs->bytes);
+    free(cs->status);
+    free(cs->uniq);
+    free(cs->reason);
+    free(cs->sha256);
+    (void)memset(cs, 0, sizeof(*cs));
+}
+
+static int tbl_colsnap_skip_pad(FILE *fp, unsigned long len)
+{
+    unsigned char pad[TBL_COLSNAP_ALIGN];
+    size_t k = (size_t)tbl_colsnap_pad(len);
+
+    return k == 0U || fread(pad, 1, k, fp) == k;
+}
+
+static int tbl_colsnap_read_u32s(FILE *fp, tbl_colsnap_u32 **out, unsigned long n)
+{
+    unsigned char buf[4096];
+    unsigned long i = 0UL;
+
+    *out = (tbl_colsnap_u32 *)malloc((size_t)(n ? n : 1UL) * sizeof(tbl_colsnap_u32));
+    if (!*out) return 0;
+    if (tbl_colsnap_native_ok()) {
+        if (n > 0UL && fread(*out, 4U, (size_t)n, fp) != (size_t)n) return 0;
+    } else {
+        while (i < n) {
+            size_t want = (size_t)((n - i) * 4UL > (unsigned long)sizeof(buf) ? sizeof(buf) : (n - i) * 4UL);
+            size_t k;
+
+            if (fread(buf, 1, want, fp) != want) return 0;
+            for (k = 0; k < want; k += 4U) (*out)[i++] = (tbl_colsnap_u32)tbl_colsnap_get32(buf + k);
+        }
+    }
+    return tbl_colsnap_skip_pad(fp, n * 4UL);
+}
+
+static int tbl_colsnap_read_u8s(FILE *fp, unsigned char **out, unsigned long n, unsigned long elem)
+{
+    *out = (unsigned char *)malloc((size_t)(n ? n * elem : 1UL));
+    if (!*out) return 0;
+    if (n > 0UL && fread(*out, (size_t)elem, (size_t)n, fp) != (size_t)n) return 0;
+    return tbl_colsnap_skip_pad(fp, n * elem);
+}
+
+int tbl_colsnap_load(tbl_colsnap_t *cs, const char *repo_root, int with_sha, char *err, size_t errsz)
+{
+    unsigned char h[TBL_COLSNAP_HDR];
+    char path[1024];
+    char tmp[1024];
+    unsigned long dict_len;
+    unsigned long fnv;
+    unsigned long i;
+    unsigned long off;
+    FILE *fp;
+    int ok;
+
+    if (err && errsz) err[0] = '\0';
+    if (!cs || !repo_root || !repo_root[0]) {
+        tbl_colsnap_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    (void)memset(cs, 0, sizeof(*cs));
+    if (!tbl_colsnap_paths(repo_root, path, tmp, sizeof(path))) {
+        tbl_colsnap_seterr(err, errsz, "snapshot path too long");
+        return 2;
+    }
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+
+    ok = fread(h, 1, sizeof(h), fp) == sizeof(h) && memcmp(h, "TBLCOL1\n", 8U) == 0;
+    if (ok) {
+        cs->n = tbl_colsnap_get32(h + 8);
+        cs->ndict = tbl_colsnap_get32(h + 12);
+        dict_len = tbl_colsnap_get32(h + 16);
+        cs->first_day = tbl_colsnap_get32(h + 20);
+        cs->last_day = tbl_colsnap_get32(h + 24);
+        ok = cs->ndict <= TBL_COLSNAP_DICT_MAX && dict_len < 0x10000000UL;
+    }
+    if (ok) {
+        cs->dict = (char *)malloc((size_t)dict_len + 1U);
+        cs->reasons = (const char **)malloc(((size_t)cs->ndict + 1U) * sizeof(const char *));
+        ok = cs->dict && cs->reasons && fread(cs->dict, 1, (size_t)dict_len, fp) == (size_t)dict_len &&
+             tbl_colsnap_skip_pad(fp, dict_len);
+    }
+    if (ok) {
+        fnv = tbl_colsnap_fnv(2166136261UL, h, 32U);
+        fnv = tbl_colsnap_fnv(fnv, cs->dict, (size_t)dict_len);
+        ok = fnv == tbl_colsnap_get32(h + 32);
+    }
+    if (ok) {
+        /* every text NUL terminated, exactly ndict of them */
+        cs->dict[dict_len] = '\0';
+        cs->reasons[0] = "";
+        off = 0UL;
+        for (i = 1UL; ok && i <= cs->ndict; ++i) {
+            const char *e = (const char *)memchr(cs->dict + off, '\0', (size_t)(dict_len - off));
+            if (off >= dict_len || !e) {
+                ok = 0;
+                break;
+            }
+            cs->reasons[i] = cs->dict + off;
+            off = (unsigned long)(e - cs->dict) + 1UL;
+        }
+        if (off != dict_len) ok = 0;
+    }
+    ok = ok && tbl_colsnap_read_u32s(fp, &cs->stored_at, cs->n) && tbl_colsnap_read_u32s(fp, &cs->bytes, cs->n) &&
+         tbl_colsnap_read_u8s(fp, &cs->status, cs->n, 1UL) && tbl_colsnap_read_u8s(fp, &cs->uniq, cs->n, 1UL) &&
+         tbl_colsnap_read_u32s(fp, &cs->reason, cs->n);
+    if (ok && with_sha) {
+        ok = tbl_colsnap_read_u8s(fp, &cs->sha256, cs->n, 32UL);
+    }
+    fclose(fp);
+    for (i = 0UL; ok && i < cs->n; ++i) {
+        if (cs->status[i] < TBL_COLSNAP_OK || cs->status[i] > TBL_COLSNAP_OTHER || cs->uniq[i] > 1 ||
+            (unsigned long)cs->reason[i] > cs->ndict) {
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        tbl_colsnap_free(cs);
+        tbl_colsnap_seterr(err, errsz, "records.col damaged (run index --snapshot)");
+        return 2;
+    }
+    return 0;
+}
+
+/* ---- stats ---- */
+
+typedef struct tbl_colsnap_part_s {
+    const tbl_colsnap_t *cs;
+    const tbl_colsnap_q_t *q;
+    unsigned long lo;
+    unsigned long hi;
+    tbl_colsnap_stats_t st;
+} tbl_colsnap_part_t;
+
+static void tbl_colsnap_worker(void *ud, unsigned long worker)
+{
+    tbl_colsnap_part_t *pt = (tbl_colsnap_part_t *)ud + worker;
+    const tbl_colsnap_t *cs = pt->cs;
+    const tbl_colsnap_u32 *at = cs->stored_at;
+    const tbl_colsnap_u32 *by = cs->bytes;
+    const unsigned char *st = cs->status;
+    const unsigned char *un = cs->uniq;
+    const tbl_colsnap_u32 *rs = cs->reason;
+    unsigned long since = pt->q->since_set ? pt->q->since : 0UL;
+    unsigned long until = pt->q->until_set ? pt->q->until : 0UL;
+    int code = pt->q->status;
+    tbl_colsnap_stats_t *s = &pt->st;
+    unsigned long i;
+
+    for (i = pt->lo; i < pt->hi; ++i) {
+        unsigned long t = (unsigned long)at[i];
+        unsigned long b = (unsigned long)by[i];
+        int c = (int)st[i];
+
+        if (t < since || (until != 0UL && t >= until) || (code != 0 && c != code)) continue;
+        s->n[c]++;
+        s->bytes[c] += b;
+        s->uniq_n += (unsigned long)un[i];
+        s->uniq_bytes += b & (0UL - (unsigned long)un[i]);
+        if (c == TBL_COLSNAP_FAIL) s->reason_n[rs[i]]++;
+        if (t == 0UL) {
+            s->undated++;
+        } else if (s->ndays != 0UL) {
+            unsigned long d = t / 86400UL - s->day0;
+            s->day_n[d]++;
+            s->day_bytes[d] += b;
+            s->day_fail[d] += (c == TBL_COLSNAP_FAIL) ? 1UL : 0UL;
+        }
+    }
+}
+
+void tbl_colsnap_stats_free(tbl_colsnap_stats_t *st)
+{
+    if (!st) return;
+    free(st->day_n);
+    free(st->day_fail);
+    free(st->day_bytes);
+    free(st->reason_n);
+    st->day_n = 0;
+    st->day_fail = 0;
+    st->day_bytes = 0;
+    st->reason_n = 0;
+}
+
+static int tbl_colsnap_stats_alloc(tbl_colsnap_stats_t *st, unsigned long day0, unsigned long ndays,
+                                   unsigned long ndict)
+{
+    (void)memset(st, 0, sizeof(*st));
+    st->day0 = day0;
+    st->ndays = ndays;
+    st->reason_n = (unsigned long *)calloc((size_t)ndict + 1U, sizeof(unsigned long));
+    if (!st->reason_n) return 0;
+    if (ndays == 0UL) return 1;
+    st->day_n = (unsigned long *)calloc((size_t)ndays, sizeof(unsigned long));
+    st->day_fail = (unsigned long *)calloc((size_t)ndays, sizeof(unsigned long));
+    st->day_bytes = (unsigned long *)calloc((size_t)ndays, sizeof(unsigned long));
+    return st->day_n && st->day_fail && st->day_bytes;
+}
+
+int tbl_colsnap_stats(const tbl_colsnap_t *cs, const tbl_colsnap_q_t *q, unsigned long nthreads,
+                      tbl_colsnap_stats_t *out, char *err, size_t errsz)
+{
+    tbl_colsnap_part_t *pt;
+    unsigned long nw;
+    unsigned long ndays = 0UL;
+    unsigned long w;
+    unsigned long i;
+    int ok = 1;
+
+    if (err && errsz) err[0] = '\0';
+    if (!cs || !q || !out) {
+        tbl_colsnap_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    (void)memset(out, 0, sizeof(*out));
+    if (cs->first_day != 0UL && cs->last_day >= cs->first_day &&
+        cs->last_day - cs->first_day < TBL_COLSNAP_DAYS_MAX) {
+        ndays = cs->last_day - cs->first_day + 1UL;
+    }
+
+    /* one contiguous slice per worker, none smaller than 64k rows */
+    nw = tbl_thread_workers(nthreads);
+    while (nw > 1UL && cs->n / nw < 65536UL) nw--;
+    pt = (tbl_colsnap_part_t *)calloc((size_t)nw, sizeof(*pt));
+    if (!pt) {
+        tbl_colsnap_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    for (w = 0UL; w < nw; ++w) {
+        pt[w].cs = cs;
+        pt[w].q = q;
+        pt[w].lo = cs->n / nw * w;
+        pt[w].hi = (w + 1UL == nw) ? cs->n : cs->n / nw * (w + 1UL);
+        if (!tbl_colsnap_stats_alloc(&pt[w].st, cs->first_day, ndays, cs->ndict)) ok = 0;
+    }
+    if (ok) tbl_thread_run(nw, tbl_colsnap_worker, pt);
+
+    /* worker 0 collects the rest */
+    for (w = 1UL; ok && w < nw; ++w) {
+        tbl_colsnap_stats_t *a = &pt[0].st;
+        const tbl_colsnap_stats_t *b = &pt[w].st;
+
+        for (i = 1UL; i < 4UL; ++i) {
+            a->n[i] += b->n[i];
+            a->bytes[i] += b->bytes[i];
+        }
+        a->uniq_n += b->uniq_n;
+        a->uniq_bytes += b->uniq_bytes;
+        a->undated += b->undated;
+        for (i = 0UL; i < ndays; ++i) {
+            a->day_n[i] += b->day_n[i];
+            a->day_fail[i] += b->day_fail[i];
+            a->day_bytes[i] += b->day_bytes[i];
+        }
+        for (i = 0UL; i <= cs->ndict; ++i) a->reason_n[i] += b->reason_n[i];
+    }
+    if (ok) {
+        *out = pt[0].st;
+        for (i = 1UL; i < 4UL; ++i) {
+            out->n[0] += out->n[i];
+            out->bytes[0] += out->bytes[i];
+        }
+        pt[0].st.day_n = 0;
+        pt[0].st.day_fail = 0;
+        pt[0].st.day_bytes = 0;
+        pt[0].st.reason_n = 0;
+    }
+    for (w = 0UL; w < nw; ++w) tbl_colsnap_stats_free(&pt[w].st);
+    free(pt);
+    if (!ok) {
+        tbl_colsnap_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    return 0;
+}
+
+/* days since 1970-01-01 -> civil date (proleptic Gregorian) */
+int tbl_colsnap_day_str(unsigned long day, char *buf, size_t bufsz)
+{
+    unsigned long z = day + 719468UL;
+    unsigned long era = z / 146097UL;
+    unsigned long doe = z - era * 146097UL;
+    unsigned long yoe = (doe - doe / 1460UL + doe / 36524UL - doe / 146096UL) / 365UL;
+    unsigned long doy = doe - (365UL * yoe + yoe / 4UL - yoe / 100UL);
+    unsigned long mp = (5UL * doy + 2UL) / 153UL;
+    unsigned long d = doy - (153UL * mp + 2UL) / 5UL + 1UL;
+    unsigned long m = (mp < 10UL) ? mp + 3UL : mp - 9UL;
+    unsigned long y = yoe + era * 400UL + ((m <= 2UL) ? 1UL : 0UL);
+
+    if (!buf || bufsz < 11U || y > 9999UL) return 0;
+    buf[0] = (char)('0' + (int)(y / 1000UL));
+    buf[1] = (char)('0' + (int)(y / 100UL % 10UL));
+    buf[2] = (char)('0' + (int)(y / 10UL % 10UL));
+    buf[3] = (char)('0' + (int)(y % 10UL));
+    buf[4] = '-';
+    buf[5] = (char)('0' + (int)(m / 10UL));
+    buf[6] = (char)('0' + (int)(m % 10UL));
+    buf[7] = '-';
+    buf[8] = (char)('0' + (int)(d / 10UL));
+    buf[9] = (char)('0' + (int)(d % 10UL));
+    buf[10] = '\0';
+    return 1;
+}
+
+#endif /* TBL_COLSNAP_IMPLEMENTATION */
+
+#endif /* TBL_CORE_COLSNAP_H */
@@ -20,6 +20,27 @@ typedef struct tbl_cfg_s {
     unsigned long ingest_poll_seconds; /* exists already */
     unsigned long ingest_once;         /* 0|1 */
     unsigned long ingest_max_jobs;     /* 0 = unlimited */
+
+    /* spool */
+    unsigned long spool_date_buckets;  /* 0|1: commit into out|fail/YYYY/MM/DD/ */
+    unsigned long spool_prune_threads; /* 0 = auto (cpu count) */
+
+    /* events (group commit) */
+    unsigned long events_batch;        /* <= 1 = write through, else events per flush */
+    unsigned long events_fsync;        /* 0|1: fsync each events file per flush */
+    unsigned long events_job_buckets;  /* 0|1: job_store = dirs|buckets */
+    unsigned long events_async;        /* 0|1: write events on a background thread */
+
+    /* records */
+    unsigned long records_journal;     /* 0|1: store = files|journal */
+    unsigned long records_ini_view;    /* 0|1: journal also writes records/<ab>/<jobid>.ini */
+
+    /* audit */
+    unsigned long audit_verify_threads; /* 0 = auto (cpu count) */
+    unsigned long audit_segment_max_bytes; /* 0 = single ops.log, else seal at this size */
+
+    /* verify */
+    unsigned long verify_threads;      /* verify-all workers, 0 = auto (cpu count) */
 } tbl_cfg_t;
 
 void tbl_cfg_defaults(tbl_cfg_t *cfg);
@@ -61,6 +82,22 @@ void tbl_cfg_defaults(tbl_cfg_t *cfg)
     cfg->ingest_poll_seconds = 2UL;
     cfg->ingest_once = 0UL;
     cfg->ingest_max_jobs = 0UL;
+
+    cfg->spool_date_buckets = 0UL;
+    cfg->spool_prune_threads = 0UL;
+
+    cfg->events_batch = 1UL;
+    cfg->events_fsync = 0UL;
+    cfg->events_job_buckets = 0UL;
+    cfg->events_async = 0UL;
+
+    cfg->records_journal = 0UL;
+    cfg->records_ini_view = 0UL;
+
+    cfg->audit_verify_threads = 0UL;
+    cfg->audit_segment_max_bytes = 0UL;
+
+    cfg->verify_threads = 0UL;
 }
 
 typedef struct tbl_cfg_ctx_s {
@@ -160,6 +197,169 @@ static int tbl_cfg_on_kv(void *ud, const char *section, const char *key, const c
         return 1;
     }
 
+    if (strcmp(section, "spool") == 0) {
+        if (strcmp(key, "date_buckets") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid date_buckets");
+                return 1;
+            }
+            if (v > 1UL) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "date_buckets must be 0 or 1");
+                return 1;
+            }
+            ctx->cfg->spool_date_buckets = v;
+            return 0;
+        }
+
+        if (strcmp(key, "prune_threads") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid prune_threads");
+                return 1;
+            }
+            ctx->cfg->spool_prune_threads = v;
+            return 0;
+        }
+
+        tbl_cfg_seterr(ctx->err, ctx->errsz, "unknown key in [spool]");
+        return 1;
+    }
+
+    if (strcmp(section, "events") == 0) {
+        if (strcmp(key, "batch") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid batch");
+                return 1;
+            }
+            if (v > 4096UL) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "batch must be <= 4096");
+                return 1;
+            }
+            ctx->cfg->events_batch = v;
+            return 0;
+        }
+
+        if (strcmp(key, "fsync") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid fsync");
+                return 1;
+            }
+            if (v > 1UL) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "fsync must be 0 or 1");
+                return 1;
+            }
+            ctx->cfg->events_fsync = v;
+            return 0;
+        }
+
+        if (strcmp(key, "async") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid async");
+                return 1;
+            }
+            if (v > 1UL) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "async must be 0 or 1");
+                return 1;
+            }
+            ctx->cfg->events_async = v;
+            return 0;
+        }
+
+        if (strcmp(key, "job_store") == 0) {
+            if (strcmp(value, "dirs") == 0) {
+                ctx->cfg->events_job_buckets = 0UL;
+            } else if (strcmp(value, "buckets") == 0) {
+                ctx->cfg->events_job_buckets = 1UL;
+            } else {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "job_store must be dirs or buckets");
+                return 1;
+            }
+            return 0;
+        }
+
+        tbl_cfg_seterr(ctx->err, ctx->errsz, "unknown key in [events]");
+        return 1;
+    }
+
+    if (strcmp(section, "records") == 0) {
+        if (strcmp(key, "store") == 0) {
+            if (strcmp(value, "files") == 0) {
+                ctx->cfg->records_journal = 0UL;
+            } else if (strcmp(value, "journal") == 0) {
+                ctx->cfg->records_journal = 1UL;
+            } else {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "store must be files or journal");
+                return 1;
+            }
+            return 0;
+        }
+
+        if (strcmp(key, "ini_view") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid ini_view");
+                return 1;
+            }
+            if (v > 1UL) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "ini_view must be 0 or 1");
+                return 1;
+            }
+            ctx->cfg->records_ini_view = v;
+            return 0;
+        }
+
+        tbl_cfg_seterr(ctx->err, ctx->errsz, "unknown key in [records]");
+        return 1;
+    }
+
+    if (strcmp(section, "audit") == 0) {
+        if (strcmp(key, "verify_threads") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid verify_threads");
+                return 1;
+            }
+            ctx->cfg->audit_verify_threads = v;
+            return 0;
+        }
+
+        if (strcmp(key, "segment_max_bytes") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid segment_max_bytes");
+                return 1;
+            }
+            if (v != 0UL && v < 65536UL) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "segment_max_bytes must be 0 or >= 65536");
+                return 1;
+            }
+            ctx->cfg->audit_segment_max_bytes = v;
+            return 0;
+        }
+
+        tbl_cfg_seterr(ctx->err, ctx->errsz, "unknown key in [audit]");
+        return 1;
+    }
+
+    if (strcmp(section, "verify") == 0) {
+        if (strcmp(key, "threads") == 0) {
+            unsigned long v;
+            if (!tbl_parse_u32_ok(value, &v)) {
+                tbl_cfg_seterr(ctx->err, ctx->errsz, "invalid threads");
+                return 1;
+            }
+            ctx->cfg->verify_threads = v;
+            return 0;
+        }
+
+        tbl_cfg_seterr(ctx->err, ctx->errsz, "unknown key in [verify]");
+        return 1;
+    }
+
     tbl_cfg_seterr(ctx->err, ctx->errsz, "unknown section");
     return 1;
 }
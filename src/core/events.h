@@ -4,14 +4,25 @@
 #include <stddef.h>
 #include <time.h>
 
+#include "os/fs.h"
+
 /* Events (Reference v1)
    - Legacy combined stream: <repo_root>/events.log
-   - Exportable job stream:  <repo_root>/jobs/<jobid>/events.log
+   - Exportable job stream:  <repo_root>/jobs/<jobid>/events.log, or the
+     bucket <repo_root>/jobstore/NNN.log once the job store exists
+     (see core/jobstore.h)
    - Ops audit (hash-chain): <repo_root>/audit/ops.log
+     With segmentation the active segment is ops.log and sealed segments are
+     audit/ops.NNNNNN.log (read-only). Every segment after the first starts
+     with a chained header line
+       ts=<t> event=audit.segment seg=<n> lines=<lines before this segment>
+     whose prev= is the final hash of the previous segment.
 
    Lines are key=value pairs separated by spaces (no quoting).
    NOTE: This remains best-effort; primary operations must not fail solely
-   because logging failed.
+   because logging failed. A damaged or unreadable ops.log only stops the
+   hash chain: the legacy and job streams are still written (see
+   tbl_events_writer_audit_ok).
 */
 
 int tbl_events_append(const char *repo_root,
@@ -22,9 +33,139 @@ int tbl_events_append(const char *repo_root,
                       const char *reason_or_empty,
                       char *err, size_t errsz);
 
+/* Persistent writer (one per repo per process).
+   Keeps the append handles open and the ops chain head in memory, so an
+   event costs one write per stream instead of open/seek/read/close cycles.
+   open() verifies the last ops.log line (LF-terminated, hash recomputes)
+   before anything is chained onto it. If it does not verify (or ops.log
+   cannot be opened), the writer still opens: events go to the legacy and
+   job streams, their ops.log lines are dropped and counted, and every
+   later lock retries ops.log. The job stream handle is cached for
+   the most recent job. tbl_events_append() is a one-shot open/append/close.
+
+   Group commit (tbl_events_writer_set_batch): appends are chained in order
+   into an in-memory batch and written at flush time with one write per
+   target file (legacy, ops, and each job stream), optionally followed by one
+   fsync per file. A batch flushes when full, on tbl_events_writer_flush()
+   and on close; until then its events are not on disk.
+
+   Legacy job index: while <repo_root>/events.idx exists (or events.log is
+   still empty) every legacy line is also noted in events.idx.tail as
+   "<jobid|-> <offset> <len>" (see core/evidx.h).
+
+   Segmentation (tbl_events_writer_set_segment_max): once ops.log reaches
+   max_bytes after a write, it is sealed as the next ops.NNNNNN.log, made
+   read-only, and a new ops.log is started with a segment header.
+
+   Several processes: every write (a flush, a write-through event, sealing)
+   runs under the advisory lock <repo_root>/audit/ops.lock (see os/fs.h).
+   Under the lock the writer first checks whether ops.log grew or was
+   sealed since its own last write; if so it reloads the head and chains
+   its batch onto the new head before writing. Lock waits and hold times
+   are counted in lock_stats. */
+#define TBL_EVENTS_BATCH_MAX 4096UL
+
+/* Microseconds (tbl_time_us); totals wrap on 32-bit longs. */
+typedef struct tbl_events_lock_stats_s {
+    unsigned long count;       /* lock acquisitions */
+    unsigned long wait_us;     /* total time waiting for the lock */
+    unsigned long hold_us;     /* total time holding it */
+    unsigned long hold_max_us; /* longest single hold */
+    unsigned long reloads;     /* head reloaded: another process appended */
+} tbl_events_lock_stats_t;
+
+typedef struct tbl_events_pending_s {
+    size_t off;    /* line offset in the batch line buffer */
+    size_t len;
+    char job[128]; /* "" = no job stream */
+} tbl_events_pending_t;
+
+typedef struct tbl_events_writer_s {
+    char repo_root[1024];
+    char jobs_dir[1024];
+    tbl_fs_afile_t legacy; /* <repo>/events.log */
+    tbl_fs_afile_t ops;    /* <repo>/audit/ops.log */
+    tbl_fs_afile_t job;    /* <repo>/jobs/<job_id>/events.log or its bucket */
+    tbl_fs_afile_t idx;    /* <repo>/events.idx.tail (not open: no index kept) */
+    unsigned long legacy_bytes; /* current size of events.log */
+    char job_id[128];      /* job of the cached stream ("" = none) */
+    char job_path[1024];   /* file of the cached stream */
+    int job_rec;           /* cached stream is a bucket: lines get "<jobid> " */
+    int job_buckets;       /* <repo>/jobstore/ exists */
+    char head[65];         /* hash of the last ops.log line (64x '0' if empty) */
+    int is_open;
+    int ops_ok;                /* 0: ops chain unavailable, see ops_err */
+    char ops_err[128];         /* last reason it was: damaged head, cannot open ops.log */
+    unsigned long ops_dropped; /* events written without their ops.log line */
+
+    /* segmentation */
+    char audit_dir[1024];
+    unsigned long seg_max;   /* 0: never rotate */
+    unsigned long ops_bytes; /* current size of ops.log */
+
+    /* group commit */
+    unsigned long batch_max; /* <= 1: write through */
+    int do_fsync;            /* 1: fsync each written file per flush/append */
+    char pending_head[65];   /* head including batched, unwritten lines */
+    char *lbuf;              /* batched canonical lines (legacy + job streams) */
+    size_t llen;
+    size_t lcap;
+    char *obuf;              /* batched ops.log lines */
+    size_t olen;
+    size_t ocap;
+    char *jbuf;              /* scratch: one job's lines per flush */
+    size_t jcap;
+    char *rbuf;              /* scratch: bucket records for one write */
+    size_t rcap;
+    tbl_events_pending_t *pend;
+    unsigned long npend;
+    unsigned long cappend;
+
+    /* cross-process appends */
+    tbl_fs_lock_t lock;      /* <repo>/audit/ops.lock */
+    unsigned long lock_t0;   /* tbl_time_us() when the lock was taken */
+    tbl_events_lock_stats_t lock_stats;
+} tbl_events_writer_t;
+
+int tbl_events_writer_open(tbl_events_writer_t *w, const char *repo_root, char *err, size_t errsz);
+int tbl_events_writer_append(tbl_events_writer_t *w,
+                             const char *event,
+                             const char *jobid,
+                             const char *status,
+                             const char *sha256_or_empty,
+                             const char *reason_or_empty,
+                             char *err, size_t errsz);
+/* Same with the event time given (ts = seconds since epoch), e.g. for
+   events recorded earlier and written later (core/evlog.h). */
+int tbl_events_writer_append_ts(tbl_events_writer_t *w,
+                                unsigned long ts,
+                                const char *event,
+                                const char *jobid,
+                                const char *status,
+                                const char *sha256_or_empty,
+                                const char *reason_or_empty,
+                                char *err, size_t errsz);
+void tbl_events_writer_close(tbl_events_writer_t *w); /* flushes */
+
+/* 1 if events are chained into ops.log; 0: only the legacy and job
+   streams are written, err says why (ops_dropped counts the events). */
+int tbl_events_writer_audit_ok(const tbl_events_writer_t *w, char *err, size_t errsz);
+
+/* max_events <= 1 disables batching; values above TBL_EVENTS_BATCH_MAX are clamped.
+   Flushes anything pending before switching. */
+int tbl_events_writer_set_batch(tbl_events_writer_t *w, unsigned long max_events, int do_fsync,
+                                char *err, size_t errsz);
+int tbl_events_writer_flush(tbl_events_writer_t *w, char *err, size_t errsz);
+
+/* max_bytes == 0 disables rotation. Rotates right away if ops.log is already
+   at or above the limit. */
+int tbl_events_writer_set_segment_max(tbl_events_writer_t *w, unsigned long max_bytes,
+                                      char *err, size_t errsz);
+
 #ifdef TBL_EVENTS_IMPLEMENTATION
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -32,7 +173,8 @@ int tbl_events_append(const char *repo_root,
 #include "core/str.h"
 #include "core/path.h"
 #include "core/sha256.h"
-#include "os/fs.h"
+#include "core/jobstore.h"
+#include "os/time.h"
 
 static void tbl_events_seterr(char *err, size_t errsz, const char *msg)
 {
@@ -63,77 +205,111 @@ static void tbl_events_zero64(char out64[65])
     out64[64] = '\0';
 }
 
-static int tbl_events_read_last_hash(const char *path, char out64[65])
+static void tbl_events_hash_chain(const char prev64[65], const char *canonical, char out64[65])
+{
+    tbl_sha256_t st;
+    unsigned char dig[32];
+    tbl_sha256_init(&st);
+    tbl_sha256_update(&st, prev64, 64);
+    tbl_sha256_update(&st, "\n", 1);
+    tbl_sha256_update(&st, canonical, strlen(canonical));
+    tbl_sha256_final(&st, dig);
+    (void)tbl_sha256_hex_ok(dig, out64, 65);
+}
+
+/* "prev=<prev> hash=<cur> <canonical>\n" with cur chained from prev. */
+static int tbl_events_audit_line(const char prev[65], const char *canonical, char cur[65],
+                                 char *out, size_t outsz)
+{
+    tbl_events_hash_chain(prev, canonical, cur);
+    return tbl_strlcpy_ok(out, "prev=", outsz) &&
+           tbl_strlcat_ok(out, prev, outsz) &&
+           tbl_strlcat_ok(out, " hash=", outsz) &&
+           tbl_strlcat_ok(out, cur, outsz) &&
+           tbl_strlcat_ok(out, " ", outsz) &&
+           tbl_strlcat_ok(out, canonical, outsz) &&
+           tbl_strlcat_ok(out, "\n", outsz);
+}
+
+/* Load and verify the chain head: the last ops.log line must be
+   LF-terminated and its hash must recompute from prev + canonical. */
+static int tbl_events_read_head(const char *path, char out64[65], unsigned long *out_size,
+                                char *err, size_t errsz)
 {
     FILE *fp;
     long endpos;
     long startpos;
-    unsigned char buf[4096];
+    char buf[4096 + 1];
     size_t n;
-    int i;
-    int end_i;
-    int line_start;
-    const char *p;
+    size_t i;
+    size_t line_start;
+    char prev[65];
+    char hash[65];
+    char calc[65];
+    const char *canonical;
 
     tbl_events_zero64(out64);
+    if (out_size) *out_size = 0UL;
 
     fp = fopen(path, "rb");
-    if (!fp) return 0;
+    if (!fp) return 0; /* no log yet: genesis */
 
-    if (fseek(fp, 0, SEEK_END) != 0) { fclose(fp); return 0; }
+    if (fseek(fp, 0, SEEK_END) != 0) { fclose(fp); tbl_events_seterr(err, errsz, "ops.log: seek failed"); return 2; }
     endpos = ftell(fp);
-    if (endpos <= 0) { fclose(fp); return 0; }
+    if (endpos < 0) { fclose(fp); tbl_events_seterr(err, errsz, "ops.log: tell failed"); return 2; }
+    if (endpos == 0) { fclose(fp); return 0; }
+    if (out_size) *out_size = (unsigned long)endpos;
 
-    startpos = endpos - (long)sizeof(buf);
+    startpos = endpos - (long)(sizeof(buf) - 1U);
     if (startpos < 0) startpos = 0;
-    if (fseek(fp, startpos, SEEK_SET) != 0) { fclose(fp); return 0; }
+    if (fseek(fp, startpos, SEEK_SET) != 0) { fclose(fp); tbl_events_seterr(err, errsz, "ops.log: seek failed"); return 2; }
 
-    n = fread(buf, 1, sizeof(buf), fp);
+    n = fread(buf, 1, sizeof(buf) - 1U, fp);
     fclose(fp);
-    if (n == 0) return 0;
-
-    /* find end of last non-empty line */
-    end_i = (int)n - 1;
-    while (end_i >= 0 && (buf[end_i] == '\n' || buf[end_i] == '\r')) end_i--;
-
-    /* find start of that line */
-    line_start = 0;
-    i = end_i;
-    while (i >= 0) {
-        if (buf[i] == '\n') { line_start = i + 1; break; }
-        i--;
-    }
-
-    /* locate "hash=" in last line */
-    p = (const char *)(buf + line_start);
-    {
-        const char *h = strstr(p, "hash=");
-        if (h) {
-            char tmp[65];
-            int k;
-            h += 5; /* after "hash=" */
-            for (k = 0; k < 64; ++k) {
-                char c = h[k];
-                if (!c) break;
-                tmp[k] = c;
-            }
-            tmp[64] = '\0';
-            if (tbl_events_is_hex64(tmp)) {
-                (void)tbl_strlcpy(out64, tmp, 65);
-            }
-        }
+    if (n == 0) { tbl_events_seterr(err, errsz, "ops.log: read failed"); return 2; }
+    buf[n] = '\0';
+
+    if (buf[n - 1] != '\n') {
+        tbl_events_seterr(err, errsz, "ops.log: last line not LF-terminated");
+        return 2;
     }
+    buf[n - 1] = '\0';
 
-    return 0;
-}
+    i = n - 1;
+    while (i > 0 && buf[i - 1] != '\n') i--;
+    if (i == 0 && startpos > 0) {
+        tbl_events_seterr(err, errsz, "ops.log: last line too long");
+        return 2;
+    }
+    line_start = i;
 
-static int tbl_events_append_line(const char *path, const char *line_with_nl)
-{
-    FILE *fp;
-    fp = fopen(path, "ab");
-    if (!fp) return 2;
-    if (fputs(line_with_nl, fp) == EOF) { fclose(fp); return 2; }
-    if (fclose(fp) != 0) return 2;
+    if (strlen(buf + line_start) != (n - 1) - line_start ||
+        strncmp(buf + line_start, "prev=", 5) != 0 ||
+        strlen(buf + line_start) < 5 + 64 + 6 + 64 + 1 ||
+        strncmp(buf + line_start + 69, " hash=", 6) != 0 ||
+        buf[line_start + 139] != ' ') {
+        tbl_events_seterr(err, errsz, "ops.log: last line malformed");
+        return 2;
+    }
+
+    (void)memcpy(prev, buf + line_start + 5, 64);
+    prev[64] = '\0';
+    (void)memcpy(hash, buf + line_start + 75, 64);
+    hash[64] = '\0';
+    canonical = buf + line_start + 140;
+
+    if (!tbl_events_is_hex64(prev) || !tbl_events_is_hex64(hash)) {
+        tbl_events_seterr(err, errsz, "ops.log: last line malformed");
+        return 2;
+    }
+
+    tbl_events_hash_chain(prev, canonical, calc);
+    if (strcmp(calc, hash) != 0) {
+        tbl_events_seterr(err, errsz, "ops.log: head hash mismatch");
+        return 2;
+    }
+
+    (void)tbl_strlcpy(out64, hash, 65);
     return 0;
 }
 
@@ -165,25 +341,739 @@ static void tbl_events_build_canonical(char out[2048],
     if (rs && rs[0]) { (void)tbl_strlcat(out, " reason=", 2048); (void)tbl_strlcat(out, rs, 2048); }
 }
 
-static void tbl_events_hash_chain(const char prev64[65], const char *canonical, char out64[65])
+/* ---- segments ---- */
+
+/* "ops.NNNNNN.log" (at least 6 digits) */
+static int tbl_events_seg_name(unsigned long seq, char *out, size_t outsz)
 {
-    tbl_sha256_t st;
-    unsigned char dig[32];
-    tbl_sha256_init(&st);
-    tbl_sha256_update(&st, prev64, 64);
-    tbl_sha256_update(&st, "\n", 1);
-    tbl_sha256_update(&st, canonical, strlen(canonical));
-    tbl_sha256_final(&st, dig);
-    (void)tbl_sha256_hex_ok(dig, out64, 65);
+    char nbuf[32];
+    size_t n;
+
+    if (!tbl_ul_to_dec_ok(seq, nbuf, sizeof(nbuf))) return 0;
+    if (!tbl_strlcpy_ok(out, "ops.", outsz)) return 0;
+    for (n = strlen(nbuf); n < 6U; ++n) {
+        if (!tbl_strlcat_ok(out, "0", outsz)) return 0;
+    }
+    if (!tbl_strlcat_ok(out, nbuf, outsz)) return 0;
+    return tbl_strlcat_ok(out, ".log", outsz);
 }
 
-int tbl_events_append(const char *repo_root,
-                      const char *event,
-                      const char *jobid,
-                      const char *status,
-                      const char *sha256_or_empty,
-                      const char *reason_or_empty,
-                      char *err, size_t errsz)
+/* "ops.NNNNNN.log", or ".log.tlz" once compressed (see core/audit.h) */
+static int tbl_events_seg_parse_name(const char *name, unsigned long *out_seq)
+{
+    const char *p;
+    size_t nd;
+
+    if (!tbl_str_starts_with(name, "ops.")) return 0;
+    p = name + 4;
+    nd = 0;
+    while (p[nd] >= '0' && p[nd] <= '9') nd++;
+    if (nd < 6U || nd > 9U || (strcmp(p + nd, ".log") != 0 && strcmp(p + nd, ".log.tlz") != 0)) return 0;
+    *out_seq = 0UL;
+    while (nd-- > 0U) *out_seq = *out_seq * 10UL + (unsigned long)(*p++ - '0');
+    return *out_seq > 0UL;
+}
+
+static int tbl_events_seg_max_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    unsigned long seq;
+    unsigned long *mx = (unsigned long *)ud;
+
+    (void)full;
+    if (!is_dir && tbl_events_seg_parse_name(name, &seq) && seq > *mx) *mx = seq;
+    return 0;
+}
+
+static int tbl_events_seg_path(const tbl_events_writer_t *w, unsigned long seq, char *out, size_t outsz)
+{
+    char name[32];
+    if (!tbl_events_seg_name(seq, name, sizeof(name))) return 0;
+    return tbl_path_join2(out, outsz, w->audit_dir, name);
+}
+
+/* Unsigned value of " key=" in a canonical line. */
+static int tbl_events_canon_ul(const char *canonical, const char *key, unsigned long *out)
+{
+    const char *p;
+    size_t kl;
+
+    kl = strlen(key);
+    for (p = strchr(canonical, ' '); p; p = strchr(p + 1, ' ')) {
+        if (strncmp(p + 1, key, kl) == 0 && p[1 + kl] == '=') {
+            p += 2 + kl;
+            if (!(*p >= '0' && *p <= '9')) return 0;
+            *out = 0UL;
+            while (*p >= '0' && *p <= '9') *out = *out * 10UL + (unsigned long)(*p++ - '0');
+            return (*p == ' ' || *p == '\0' || *p == '\n') ? 1 : 0;
+        }
+    }
+    return 0;
+}
+
+/* Chain position after the segment at path: lines= from its header (0 for
+   the first segment) plus the lines in the file. */
+static int tbl_events_seg_lines_end(const char *path, unsigned long *out_lines)
+{
+    FILE *fp;
+    char buf[4096];
+    size_t n;
+    size_t i;
+
+    *out_lines = 0UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    if (fgets(buf, (int)sizeof(buf), fp) != NULL) {
+        unsigned long base;
+        if (strlen(buf) > 140U && strstr(buf + 140, " event=audit.segment") != NULL &&
+            tbl_events_canon_ul(buf + 140, "lines", &base)) {
+            *out_lines = base;
+        }
+    }
+    if (fseek(fp, 0L, SEEK_SET) != 0) { fclose(fp); return 0; }
+
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        for (i = 0; i < n; ++i) {
+            if (buf[i] == '\n') (*out_lines)++;
+        }
+    }
+    if (ferror(fp)) { fclose(fp); return 0; }
+    fclose(fp);
+    return 1;
+}
+
+/* Append the segment header for segment seq onto the current head. */
+static int tbl_events_writer_put_header(tbl_events_writer_t *w, unsigned long seq, unsigned long lines)
+{
+    char canonical[256];
+    char line[512];
+    char cur[65];
+    char nbuf[32];
+
+    if (!tbl_ul_to_dec_ok((unsigned long)time(0), nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcpy(canonical, "ts=", sizeof(canonical));
+    (void)tbl_strlcat(canonical, nbuf, sizeof(canonical));
+    (void)tbl_strlcat(canonical, " event=audit.segment seg=", sizeof(canonical));
+    if (!tbl_ul_to_dec_ok(seq, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(canonical, nbuf, sizeof(canonical));
+    (void)tbl_strlcat(canonical, " lines=", sizeof(canonical));
+    if (!tbl_ul_to_dec_ok(lines, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(canonical, nbuf, sizeof(canonical));
+
+    if (!tbl_events_audit_line(w->head, canonical, cur, line, sizeof(line))) return 0;
+    if (tbl_fs_afile_write(&w->ops, line, strlen(line)) != 0) return 0;
+    if (w->do_fsync) (void)tbl_fs_afile_sync(&w->ops);
+    (void)tbl_strlcpy(w->head, cur, sizeof(w->head));
+    (void)tbl_strlcpy(w->pending_head, cur, sizeof(w->pending_head));
+    w->ops_bytes += (unsigned long)strlen(line);
+    return 1;
+}
+
+/* Seal ops.log as the next ops.NNNNNN.log and start a new segment.
+   Only called with nothing pending and the lock held. */
+static int tbl_events_writer_rotate(tbl_events_writer_t *w, char *err, size_t errsz)
+{
+    char ops_path[1024];
+    char seg_path[1024];
+    unsigned long seq;
+    unsigned long lines;
+
+    if (!tbl_path_join2(ops_path, sizeof(ops_path), w->audit_dir, "ops.log")) {
+        tbl_events_seterr(err, errsz, "events path too long");
+        return 2;
+    }
+
+    seq = 0UL;
+    (void)tbl_fs_list_dir(w->audit_dir, tbl_events_seg_max_cb, &seq);
+    seq++;
+
+    if (!tbl_events_seg_lines_end(ops_path, &lines) ||
+        !tbl_events_seg_path(w, seq, seg_path, sizeof(seg_path))) {
+        tbl_events_seterr(err, errsz, "cannot seal ops.log");
+        return 2;
+    }
+
+    (void)tbl_fs_afile_close(&w->ops);
+    if (tbl_fs_rename_atomic(ops_path, seg_path, 0) != 0) {
+        (void)tbl_fs_afile_open(&w->ops, ops_path);
+        tbl_events_seterr(err, errsz, "cannot seal ops.log");
+        return 2;
+    }
+    (void)tbl_fs_set_readonly(seg_path);
+
+    w->ops_bytes = 0UL;
+    if (tbl_fs_afile_open(&w->ops, ops_path) != 0 ||
+        !tbl_events_writer_put_header(w, seq + 1UL, lines)) {
+        tbl_events_seterr(err, errsz, "cannot start ops.log segment");
+        return 2;
+    }
+    return 0;
+}
+
+/* (Re)open ops.log and load its head. An empty ops.log after a sealed
+   segment (e.g. crash right after sealing) chains onto the sealed segment
+   and gets the missing header. Called with the lock held. */
+static int tbl_events_writer_load_ops(tbl_events_writer_t *w, char *err, size_t errsz)
+{
+    char path[1024];
+    unsigned long seq;
+
+    (void)tbl_fs_afile_close(&w->ops);
+    if (!tbl_path_join2(path, sizeof(path), w->audit_dir, "ops.log")) {
+        tbl_events_seterr(err, errsz, "events path too long");
+        return 2;
+    }
+    if (tbl_events_read_head(path, w->head, &w->ops_bytes, err, errsz) != 0) return 2;
+    if (tbl_fs_afile_open(&w->ops, path) != 0) {
+        tbl_events_seterr(err, errsz, "cannot open ops.log");
+        return 2;
+    }
+
+    seq = 0UL;
+    if (w->ops_bytes == 0UL) (void)tbl_fs_list_dir(w->audit_dir, tbl_events_seg_max_cb, &seq);
+    if (seq > 0UL) {
+        unsigned long lines;
+
+        if (!tbl_events_seg_path(w, seq, path, sizeof(path)) ||
+            tbl_events_read_head(path, w->head, 0, err, errsz) != 0 ||
+            !tbl_events_seg_lines_end(path, &lines) ||
+            !tbl_events_writer_put_header(w, seq + 1UL, lines)) {
+            if (err && errsz && !err[0]) tbl_events_seterr(err, errsz, "cannot start ops.log segment");
+            (void)tbl_fs_afile_close(&w->ops);
+            return 2;
+        }
+    }
+    return 0;
+}
+
+/* Under the lock: pick up what other processes appended since our last
+   write. ops.log unchanged (same file, same size) keeps the head. */
+static int tbl_events_writer_sync(tbl_events_writer_t *w, char *err, size_t errsz)
+{
+    char path[1024];
+    char old[65];
+    char msg[128];
+    unsigned long sz;
+
+    if (w->legacy.is_open && tbl_fs_afile_size(&w->legacy, &sz) == 0) w->legacy_bytes = sz;
+
+    if (!tbl_path_join2(path, sizeof(path), w->audit_dir, "ops.log")) {
+        tbl_events_seterr(err, errsz, "events path too long");
+        return 2;
+    }
+    if (tbl_fs_afile_same_ok(&w->ops, path) &&
+        tbl_fs_afile_size(&w->ops, &sz) == 0 && sz == w->ops_bytes) {
+        return 0;
+    }
+
+    /* nothing is chained onto a head that does not verify; the other
+       streams go on (retried at every lock) */
+    (void)tbl_strlcpy(old, w->head, sizeof(old));
+    msg[0] = '\0';
+    if (tbl_events_writer_load_ops(w, msg, sizeof(msg)) != 0) {
+        (void)tbl_fs_afile_close(&w->ops);
+        tbl_events_zero64(w->head);
+        w->ops_ok = 0;
+        (void)tbl_strlcpy(w->ops_err, msg[0] ? msg : "cannot load ops.log", sizeof(w->ops_err));
+        return 0;
+    }
+    if (w->is_open && w->ops_ok && strcmp(old, w->head) != 0) w->lock_stats.reloads++;
+    w->ops_ok = 1;
+    return 0;
+}
+
+static void tbl_events_writer_unlock(tbl_events_writer_t *w)
+{
+    unsigned long held;
+
+    held = tbl_time_us() - w->lock_t0;
+    (void)tbl_fs_lock_release(&w->lock);
+    w->lock_stats.hold_us += held;
+    if (held > w->lock_stats.hold_max_us) w->lock_stats.hold_max_us = held;
+}
+
+static int tbl_events_writer_lock(tbl_events_writer_t *w, char *err, size_t errsz)
+{
+    unsigned long t0;
+
+    t0 = tbl_time_us();
+    if (tbl_fs_lock_acquire(&w->lock) != 0) {
+        tbl_events_seterr(err, errsz, "cannot lock audit/ops.lock");
+        return 2;
+    }
+    w->lock_t0 = tbl_time_us();
+    w->lock_stats.count++;
+    w->lock_stats.wait_us += w->lock_t0 - t0;
+
+    if (tbl_events_writer_sync(w, err, errsz) != 0) {
+        tbl_events_writer_unlock(w);
+        return 2;
+    }
+    return 0;
+}
+
+int tbl_events_writer_set_segment_max(tbl_events_writer_t *w, unsigned long max_bytes,
+                                      char *err, size_t errsz)
+{
+    if (!w || !w->is_open) {
+        tbl_events_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    w->seg_max = max_bytes;
+    if (w->seg_max > 0UL && w->ops_bytes >= w->seg_max && w->npend == 0UL) {
+        int rc;
+
+        if (tbl_events_writer_lock(w, err, errsz) != 0) return 2;
+        rc = 0;
+        if (w->ops_ok && w->ops_bytes >= w->seg_max) rc = tbl_events_writer_rotate(w, err, errsz);
+        tbl_events_writer_unlock(w);
+        return rc;
+    }
+    return 0;
+}
+
+/* Keep the legacy job index tail only where it can start without a gap:
+   an index exists already, or events.log is empty (best effort). */
+static void tbl_events_writer_idx_open(tbl_events_writer_t *w, const char *legacy_path)
+{
+    char path[1100];
+    FILE *fp;
+    long n;
+    int ex;
+
+    w->legacy_bytes = 0UL;
+    fp = fopen(legacy_path, "rb");
+    if (fp) {
+        n = (fseek(fp, 0L, SEEK_END) == 0) ? ftell(fp) : -1L;
+        fclose(fp);
+        if (n < 0L) return;
+        w->legacy_bytes = (unsigned long)n;
+    }
+
+    ex = (w->legacy_bytes == 0UL) ? 1 : 0;
+    if (!ex && tbl_path_join2(path, sizeof(path), w->repo_root, "events.idx")) (void)tbl_fs_exists(path, &ex);
+    if (!ex && tbl_path_join2(path, sizeof(path), w->repo_root, "events.idx.tail")) (void)tbl_fs_exists(path, &ex);
+    if (!ex) return;
+
+    if (tbl_path_join2(path, sizeof(path), w->repo_root, "events.idx.tail")) {
+        (void)tbl_fs_afile_open(&w->idx, path);
+    }
+}
+
+/* "<jobid|-> <offset> <len>\n" */
+static int tbl_events_idx_line(char *out, size_t outsz, const char *jobid,
+                               unsigned long off, unsigned long len)
+{
+    char nbuf[32];
+
+    if (!tbl_strlcpy_ok(out, (jobid && jobid[0]) ? jobid : "-", outsz)) return 0;
+    if (!tbl_ul_to_dec_ok(off, nbuf, sizeof(nbuf))) return 0;
+    if (!tbl_strlcat_ok(out, " ", outsz) || !tbl_strlcat_ok(out, nbuf, outsz)) return 0;
+    if (!tbl_ul_to_dec_ok(len, nbuf, sizeof(nbuf))) return 0;
+    if (!tbl_strlcat_ok(out, " ", outsz) || !tbl_strlcat_ok(out, nbuf, outsz)) return 0;
+    return tbl_strlcat_ok(out, "\n", outsz);
+}
+
+/* Note data written to events.log at legacy_bytes; a failed write stops
+   the tail, since later offsets are unknown. */
+static void tbl_events_writer_idx_write(tbl_events_writer_t *w, const char *data, size_t len)
+{
+    if (!w->idx.is_open) return;
+    if (tbl_fs_afile_write(&w->idx, data, len) != 0) (void)tbl_fs_afile_close(&w->idx);
+}
+
+int tbl_events_writer_open(tbl_events_writer_t *w, const char *repo_root, char *err, size_t errsz)
+{
+    char path[1024];
+
+    if (err && errsz) err[0] = '\0';
+    if (!w || !repo_root || !repo_root[0]) {
+        tbl_events_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+
+    (void)memset(w, 0, sizeof(*w));
+    tbl_events_zero64(w->head);
+
+    if (tbl_strlcpy(w->repo_root, repo_root, sizeof(w->repo_root)) >= sizeof(w->repo_root) ||
+        !tbl_path_join2(w->jobs_dir, sizeof(w->jobs_dir), repo_root, "jobs") ||
+        !tbl_path_join2(w->audit_dir, sizeof(w->audit_dir), repo_root, "audit")) {
+        tbl_events_seterr(err, errsz, "events path too long");
+        return 2;
+    }
+
+    /* directories once per writer, not per event */
+    w->job_buckets = tbl_jobstore_active_ok(repo_root);
+    if (!w->job_buckets) (void)tbl_fs_mkdir_p(w->jobs_dir);
+    (void)tbl_fs_mkdir_p(w->audit_dir);
+
+    if (!tbl_path_join2(path, sizeof(path), w->audit_dir, "ops.lock") ||
+        tbl_fs_lock_open(&w->lock, path) != 0) {
+        tbl_events_seterr(err, errsz, "cannot open audit/ops.lock");
+        return 2;
+    }
+
+    /* the head is loaded under the lock (the first sync opens ops.log) */
+    if (tbl_events_writer_lock(w, err, errsz) != 0) {
+        (void)tbl_fs_afile_close(&w->ops);
+        (void)tbl_fs_lock_close(&w->lock);
+        return 2;
+    }
+    tbl_events_writer_unlock(w);
+    (void)tbl_strlcpy(w->pending_head, w->head, sizeof(w->pending_head));
+
+    if (!tbl_path_join2(path, sizeof(path), repo_root, "events.log") ||
+        tbl_fs_afile_open(&w->legacy, path) != 0) {
+        (void)tbl_fs_afile_close(&w->ops);
+        (void)tbl_fs_lock_close(&w->lock);
+        tbl_events_seterr(err, errsz, "cannot open legacy events");
+        return 2;
+    }
+    tbl_events_writer_idx_open(w, path);
+
+    w->is_open = 1;
+    return 0;
+}
+
+int tbl_events_writer_audit_ok(const tbl_events_writer_t *w, char *err, size_t errsz)
+{
+    if (err && errsz) err[0] = '\0';
+    if (!w || !w->is_open) {
+        tbl_events_seterr(err, errsz, "invalid args");
+        return 0;
+    }
+    if (w->ops_ok) return 1;
+    tbl_events_seterr(err, errsz, w->ops_err[0] ? w->ops_err : "ops.log unavailable");
+    return 0;
+}
+
+void tbl_events_writer_close(tbl_events_writer_t *w)
+{
+    if (!w) return;
+    if (w->is_open) (void)tbl_events_writer_flush(w, 0, 0);
+    free(w->lbuf);
+    free(w->obuf);
+    free(w->jbuf);
+    free(w->rbuf);
+    free(w->pend);
+    w->lbuf = 0;
+    w->obuf = 0;
+    w->jbuf = 0;
+    w->rbuf = 0;
+    w->pend = 0;
+    w->llen = w->lcap = w->olen = w->ocap = w->jcap = w->rcap = 0;
+    w->npend = w->cappend = 0UL;
+    (void)tbl_fs_afile_close(&w->job);
+    (void)tbl_fs_afile_close(&w->ops);
+    (void)tbl_fs_afile_close(&w->legacy);
+    (void)tbl_fs_afile_close(&w->idx);
+    (void)tbl_fs_lock_close(&w->lock);
+    w->job_id[0] = '\0';
+    w->job_path[0] = '\0';
+    w->is_open = 0;
+}
+
+static int tbl_events_buf_put_ok(char **buf, size_t *len, size_t *cap, const char *data, size_t n);
+
+/* Switch the cached job stream to jobid (best effort). With the job store,
+   jobs that still have a per-job file keep it; all others go to their
+   bucket, whose handle is shared by every job hashed there. */
+static int tbl_events_writer_job_ok(tbl_events_writer_t *w, const char *jobid)
+{
+    char job_dir[1024];
+    char job_path[1024];
+    int in_dir;
+
+    if (w->job.is_open && strcmp(w->job_id, jobid) == 0) return 1;
+
+    if (!tbl_path_join2(job_dir, sizeof(job_dir), w->jobs_dir, jobid) ||
+        !tbl_path_join2(job_path, sizeof(job_path), job_dir, "events.log")) {
+        return 0;
+    }
+    in_dir = 1;
+    if (w->job_buckets) {
+        in_dir = 0;
+        (void)tbl_fs_exists(job_path, &in_dir);
+        if (!in_dir && (!tbl_jobstore_jobid_ok(jobid) || !tbl_jobstore_bucket_path_ok(w->repo_root, jobid, job_path, sizeof(job_path)))) {
+            return 0;
+        }
+    }
+
+    if (!w->job.is_open || strcmp(w->job_path, job_path) != 0) {
+        (void)tbl_fs_afile_close(&w->job);
+        w->job_id[0] = '\0';
+        if (in_dir) (void)tbl_fs_mkdir_one(job_dir);
+        if (tbl_fs_afile_open(&w->job, job_path) != 0) return 0;
+        (void)tbl_strlcpy(w->job_path, job_path, sizeof(w->job_path));
+    }
+
+    (void)tbl_strlcpy(w->job_id, jobid, sizeof(w->job_id));
+    w->job_rec = in_dir ? 0 : 1;
+    return 1;
+}
+
+/* Write lines to jobid's stream (best effort); fsync if configured. */
+static void tbl_events_writer_job_write(tbl_events_writer_t *w, const char *jobid,
+                                        const char *data, size_t len)
+{
+    if (!tbl_events_writer_job_ok(w, jobid)) return;
+
+    /* bucket: "<jobid> <line>" per line, still one write */
+    if (w->job_rec) {
+        size_t rlen = 0;
+        size_t jl = strlen(jobid);
+        size_t i = 0;
+
+        while (i < len) {
+            size_t j = i;
+            while (j < len && data[j] != '\n') j++;
+            if (j < len) j++;
+            if (!tbl_events_buf_put_ok(&w->rbuf, &rlen, &w->rcap, jobid, jl) ||
+                !tbl_events_buf_put_ok(&w->rbuf, &rlen, &w->rcap, " ", 1) ||
+                !tbl_events_buf_put_ok(&w->rbuf, &rlen, &w->rcap, data + i, j - i)) {
+                return;
+            }
+            i = j;
+        }
+        data = w->rbuf;
+        len = rlen;
+    }
+
+    if (tbl_fs_afile_write(&w->job, data, len) != 0) {
+        (void)tbl_fs_afile_close(&w->job);
+        w->job_id[0] = '\0';
+        w->job_path[0] = '\0';
+        return;
+    }
+    if (w->do_fsync) (void)tbl_fs_afile_sync(&w->job);
+}
+
+static int tbl_events_buf_put_ok(char **buf, size_t *len, size_t *cap, const char *data, size_t n)
+{
+    if (*len + n > *cap) {
+        size_t ncap;
+        char *nb;
+
+        ncap = *cap ? *cap : 8192U;
+        while (ncap < *len + n) {
+            if (ncap > ((size_t)-1) / 2U) return 0;
+            ncap *= 2U;
+        }
+        nb = (char *)realloc(*buf, ncap);
+        if (!nb) return 0;
+        *buf = nb;
+        *cap = ncap;
+    }
+    (void)memcpy(*buf + *len, data, n);
+    *len += n;
+    return 1;
+}
+
+/* Chain the batch onto w->head again: another process appended since it
+   was queued. The batched legacy lines are the canonical lines + LF. */
+static int tbl_events_writer_rechain(tbl_events_writer_t *w)
+{
+    char canonical[2048];
+    char line[2200];
+    char prev[65];
+    char cur[65];
+    unsigned long i;
+
+    w->olen = 0;
+    (void)tbl_strlcpy(prev, w->head, sizeof(prev));
+    for (i = 0UL; i < w->npend; ++i) {
+        size_t n = w->pend[i].len - 1U;
+
+        if (n >= sizeof(canonical)) return 0;
+        (void)memcpy(canonical, w->lbuf + w->pend[i].off, n);
+        canonical[n] = '\0';
+        if (!tbl_events_audit_line(prev, canonical, cur, line, sizeof(line)) ||
+            !tbl_events_buf_put_ok(&w->obuf, &w->olen, &w->ocap, line, strlen(line))) {
+            return 0;
+        }
+        (void)tbl_strlcpy(prev, cur, sizeof(prev));
+    }
+    (void)tbl_strlcpy(w->pending_head, prev, sizeof(w->pending_head));
+    return 1;
+}
+
+int tbl_events_writer_flush(tbl_events_writer_t *w, char *err, size_t errsz)
+{
+    unsigned long i;
+    unsigned long j;
+    int rc;
+
+    if (!w || !w->is_open) {
+        tbl_events_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (w->npend == 0UL) return 0;
+
+    /* no lock: the batch is dropped, like a failed write */
+    if (tbl_events_writer_lock(w, err, errsz) != 0) {
+        w->llen = 0;
+        w->olen = 0;
+        w->npend = 0UL;
+        (void)tbl_strlcpy(w->pending_head, w->head, sizeof(w->pending_head));
+        return 2;
+    }
+
+    rc = 0;
+    if (w->ops_ok && (w->olen < 69U || memcmp(w->obuf + 5, w->head, 64) != 0)) {
+        if (!tbl_events_writer_rechain(w)) {
+            tbl_events_seterr(err, errsz, "out of memory");
+            w->olen = 0;
+            rc = 2;
+        }
+    }
+
+    /* legacy: one write for the whole batch */
+    if (tbl_fs_afile_write(&w->legacy, w->lbuf, w->llen) != 0) {
+        tbl_events_seterr(err, errsz, "cannot append legacy events");
+        (void)tbl_fs_afile_close(&w->idx);
+        rc = 2;
+    } else {
+        if (w->do_fsync) (void)tbl_fs_afile_sync(&w->legacy);
+
+        /* index tail: one write for the batch (jbuf is free until below) */
+        if (w->idx.is_open) {
+            size_t ilen = 0;
+            char iline[200];
+
+            for (i = 0UL; i < w->npend; ++i) {
+                if (!tbl_events_idx_line(iline, sizeof(iline), w->pend[i].job,
+                                         w->legacy_bytes + (unsigned long)w->pend[i].off,
+                                         (unsigned long)w->pend[i].len) ||
+                    !tbl_events_buf_put_ok(&w->jbuf, &ilen, &w->jcap, iline, strlen(iline))) {
+                    (void)tbl_fs_afile_close(&w->idx);
+                    break;
+                }
+            }
+            tbl_events_writer_idx_write(w, w->jbuf, ilen);
+        }
+        w->legacy_bytes += (unsigned long)w->llen;
+    }
+
+    /* job streams: one write per distinct job, in first-seen order */
+    for (i = 0UL; i < w->npend; ++i) {
+        size_t jlen;
+        char job[128];
+
+        if (!w->pend[i].job[0]) continue;
+        (void)tbl_strlcpy(job, w->pend[i].job, sizeof(job));
+
+        jlen = 0;
+        for (j = i; j < w->npend; ++j) {
+            if (strcmp(w->pend[j].job, job) != 0) continue;
+            if (!tbl_events_buf_put_ok(&w->jbuf, &jlen, &w->jcap, w->lbuf + w->pend[j].off, w->pend[j].len)) {
+                jlen = 0;
+                break;
+            }
+            w->pend[j].job[0] = '\0';
+        }
+        if (jlen > 0) tbl_events_writer_job_write(w, job, w->jbuf, jlen);
+    }
+
+    /* ops audit: one write; on failure the batch's chain is dropped */
+    if (w->ops_ok && w->olen > 0 && tbl_fs_afile_write(&w->ops, w->obuf, w->olen) == 0) {
+        (void)tbl_strlcpy(w->head, w->pending_head, sizeof(w->head));
+        if (w->do_fsync) (void)tbl_fs_afile_sync(&w->ops);
+        w->ops_bytes += (unsigned long)w->olen;
+    } else {
+        w->ops_dropped += w->npend;
+        (void)tbl_strlcpy(w->pending_head, w->head, sizeof(w->pending_head));
+    }
+
+    w->llen = 0;
+    w->olen = 0;
+    w->npend = 0UL;
+
+    if (w->ops_ok && w->seg_max > 0UL && w->ops_bytes >= w->seg_max) {
+        if (tbl_events_writer_rotate(w, err, errsz) != 0) rc = 2;
+    }
+    tbl_events_writer_unlock(w);
+    return rc;
+}
+
+static int tbl_events_writer_queue(tbl_events_writer_t *w,
+                                   const char *line, size_t n, const char *jobid,
+                                   const char *audit_line, const char cur[65],
+                                   char *err, size_t errsz)
+{
+    tbl_events_pending_t *pe;
+    size_t off;
+
+    if (w->npend == w->cappend) {
+        unsigned long ncap;
+        tbl_events_pending_t *np;
+
+        ncap = w->cappend ? w->cappend * 2UL : 64UL;
+        if (ncap > TBL_EVENTS_BATCH_MAX) ncap = TBL_EVENTS_BATCH_MAX;
+        np = (tbl_events_pending_t *)realloc(w->pend, (size_t)ncap * sizeof(*np));
+        if (!np) { tbl_events_seterr(err, errsz, "out of memory"); return 2; }
+        w->pend = np;
+        w->cappend = ncap;
+    }
+
+    off = w->llen;
+    if (!tbl_events_buf_put_ok(&w->lbuf, &w->llen, &w->lcap, line, n)) {
+        tbl_events_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    if (!tbl_events_buf_put_ok(&w->obuf, &w->olen, &w->ocap, audit_line, strlen(audit_line))) {
+        w->llen = off;
+        tbl_events_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+
+    pe = &w->pend[w->npend++];
+    pe->off = off;
+    pe->len = n;
+    (void)tbl_strlcpy(pe->job, jobid ? jobid : "", sizeof(pe->job));
+    (void)tbl_strlcpy(w->pending_head, cur, sizeof(w->pending_head));
+
+    if (w->npend >= w->batch_max) return tbl_events_writer_flush(w, err, errsz);
+    return 0;
+}
+
+int tbl_events_writer_set_batch(tbl_events_writer_t *w, unsigned long max_events, int do_fsync,
+                                char *err, size_t errsz)
+{
+    int rc;
+
+    if (!w || !w->is_open) {
+        tbl_events_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+
+    rc = tbl_events_writer_flush(w, err, errsz);
+
+    if (max_events > TBL_EVENTS_BATCH_MAX) max_events = TBL_EVENTS_BATCH_MAX;
+    w->batch_max = max_events;
+    w->do_fsync = do_fsync ? 1 : 0;
+    return rc;
+}
+
+int tbl_events_writer_append(tbl_events_writer_t *w,
+                             const char *event,
+                             const char *jobid,
+                             const char *status,
+                             const char *sha256_or_empty,
+                             const char *reason_or_empty,
+                             char *err, size_t errsz)
+{
+    return tbl_events_writer_append_ts(w, (unsigned long)time(0), event, jobid, status,
+                                       sha256_or_empty, reason_or_empty, err, errsz);
+}
+
+int tbl_events_writer_append_ts(tbl_events_writer_t *w,
+                                unsigned long ts,
+                                const char *event,
+                                const char *jobid,
+                                const char *status,
+                                const char *sha256_or_empty,
+                                const char *reason_or_empty,
+                                char *err, size_t errsz)
 {
     char ev[128];
     char jb[128];
@@ -191,20 +1081,14 @@ int tbl_events_append(const char *repo_root,
     char sh[80];
     char rs[512];
 
-    char legacy_path[1024];
-    char jobs_dir[1024];
-    char job_dir[1024];
-    char job_path[1024];
-    char audit_dir[1024];
-    char audit_path[1024];
-
-    unsigned long ts;
     char canonical[2048];
     char line[2100];
-
+    char audit_line[2200];
+    char cur[65];
+    size_t n;
     int rc;
 
-    if (!repo_root || !repo_root[0] || !event || !event[0]) {
+    if (!w || !w->is_open || !event || !event[0]) {
         tbl_events_seterr(err, errsz, "invalid args");
         return 2;
     }
@@ -221,57 +1105,83 @@ int tbl_events_append(const char *repo_root,
     if (sha256_or_empty) (void)tbl_strlcpy(sh, sha256_or_empty, sizeof(sh));
     if (reason_or_empty) (void)tbl_strlcpy(rs, reason_or_empty, sizeof(rs));
 
-    ts = (unsigned long)time(0);
     tbl_events_build_canonical(canonical, ts, ev, jb, st, sh, rs);
 
-    /* legacy: <repo_root>/events.log (kept for compatibility) */
-    if (!tbl_path_join2(legacy_path, sizeof(legacy_path), repo_root, "events.log")) {
-        tbl_events_seterr(err, errsz, "events path too long");
-        return 2;
-    }
     (void)tbl_strlcpy(line, canonical, sizeof(line));
     (void)tbl_strlcat(line, "\n", sizeof(line));
-    rc = tbl_events_append_line(legacy_path, line);
-    if (rc != 0) {
+    n = strlen(line);
+
+    /* batched: the ops line chains onto the pending head (batched lines
+       included); flush chains it again if the head moved meanwhile */
+    if (w->batch_max > 1UL) {
+        (void)tbl_events_audit_line(w->pending_head, canonical, cur, audit_line, sizeof(audit_line));
+        return tbl_events_writer_queue(w, line, n, jb, audit_line, cur, err, errsz);
+    }
+
+    /* write through, under the lock */
+    if (tbl_events_writer_lock(w, err, errsz) != 0) return 2;
+
+    /* legacy: <repo_root>/events.log (kept for compatibility) */
+    if (tbl_fs_afile_write(&w->legacy, line, n) != 0) {
+        (void)tbl_fs_afile_close(&w->idx);
+        tbl_events_writer_unlock(w);
         tbl_events_seterr(err, errsz, "cannot append legacy events");
         return 2;
     }
-
-    /* exportable job stream: <repo_root>/jobs/<jobid>/events.log (best effort) */
-    if (jb[0]) {
-        if (tbl_path_join2(jobs_dir, sizeof(jobs_dir), repo_root, "jobs") &&
-            tbl_path_join2(job_dir, sizeof(job_dir), jobs_dir, jb) &&
-            tbl_path_join2(job_path, sizeof(job_path), job_dir, "events.log")) {
-            (void)tbl_fs_mkdir_p(job_dir);
-            (void)tbl_events_append_line(job_path, line);
+    if (w->do_fsync) (void)tbl_fs_afile_sync(&w->legacy);
+    if (w->idx.is_open) {
+        char iline[200];
+        if (tbl_events_idx_line(iline, sizeof(iline), jb, w->legacy_bytes, (unsigned long)n)) {
+            tbl_events_writer_idx_write(w, iline, strlen(iline));
+        } else {
+            (void)tbl_fs_afile_close(&w->idx);
         }
     }
+    w->legacy_bytes += (unsigned long)n;
 
-    /* ops audit: <repo_root>/audit/ops.log (hash-chained, best effort) */
-    if (tbl_path_join2(audit_dir, sizeof(audit_dir), repo_root, "audit") &&
-        tbl_path_join2(audit_path, sizeof(audit_path), audit_dir, "ops.log")) {
-        char prev[65];
-        char cur[65];
-        char audit_line[2200];
+    /* exportable job stream: per-job file or job store bucket (best effort) */
+    if (jb[0]) tbl_events_writer_job_write(w, jb, line, n);
 
-        (void)tbl_fs_mkdir_p(audit_dir);
+    /* ops audit: <repo_root>/audit/ops.log (hash-chained, best effort);
+       advance the head only once the line is on file */
+    if (w->ops_ok && tbl_events_audit_line(w->head, canonical, cur, audit_line, sizeof(audit_line)) &&
+        tbl_fs_afile_write(&w->ops, audit_line, strlen(audit_line)) == 0) {
+        (void)tbl_strlcpy(w->head, cur, sizeof(w->head));
+        if (w->do_fsync) (void)tbl_fs_afile_sync(&w->ops);
+        w->ops_bytes += (unsigned long)strlen(audit_line);
+    } else {
+        w->ops_dropped++;
+    }
+    (void)tbl_strlcpy(w->pending_head, w->head, sizeof(w->pending_head));
 
-        (void)tbl_events_read_last_hash(audit_path, prev);
-        tbl_events_hash_chain(prev, canonical, cur);
+    rc = 0;
+    if (w->ops_ok && w->seg_max > 0UL && w->ops_bytes >= w->seg_max) {
+        rc = tbl_events_writer_rotate(w, err, errsz);
+    }
+    tbl_events_writer_unlock(w);
+    return rc;
+}
 
-        audit_line[0] = '\0';
-        (void)tbl_strlcpy(audit_line, "prev=", sizeof(audit_line));
-        (void)tbl_strlcat(audit_line, prev, sizeof(audit_line));
-        (void)tbl_strlcat(audit_line, " hash=", sizeof(audit_line));
-        (void)tbl_strlcat(audit_line, cur, sizeof(audit_line));
-        (void)tbl_strlcat(audit_line, " ", sizeof(audit_line));
-        (void)tbl_strlcat(audit_line, canonical, sizeof(audit_line));
-        (void)tbl_strlcat(audit_line, "\n", sizeof(audit_line));
+int tbl_events_append(const char *repo_root,
+                      const char *event,
+                      const char *jobid,
+                      const char *status,
+                      const char *sha256_or_empty,
+                      const char *reason_or_empty,
+                      char *err, size_t errsz)
+{
+    tbl_events_writer_t w;
+    int rc;
 
-        (void)tbl_events_append_line(audit_path, audit_line);
+    if (!repo_root || !repo_root[0] || !event || !event[0]) {
+        tbl_events_seterr(err, errsz, "invalid args");
+        return 2;
     }
 
-    return 0;
+    if (tbl_events_writer_open(&w, repo_root, err, errsz) != 0) return 2;
+    rc = tbl_events_writer_append(&w, event, jobid, status, sha256_or_empty, reason_or_empty, err, errsz);
+    tbl_events_writer_close(&w);
+    return rc;
 }
 
 
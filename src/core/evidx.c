@@ -0,0 +1,2 @@
+#define TBL_EVIDX_IMPLEMENTATION
+#include "core/evidx.h"
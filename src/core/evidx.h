@@ -0,0 +1,603 @@
+#ifndef TBL_CORE_EVIDX_H
+#define TBL_CORE_EVIDX_H
+
+#include <stddef.h>
+
+/* Job index for the legacy combined stream <repo_root>/events.log.
+   - events.idx       "covered=<bytes>" header, then "<jobid> <offset> <len>"
+                      lines sorted by jobid, then offset (built offline)
+   - events.idx.tail  "<jobid|-> <offset> <len>" for every legacy line,
+                      appended by the events writer in file order
+   A lookup binary-searches events.idx, takes the tail while it continues
+   the covered bytes without gaps, and scans only the legacy bytes after
+   that. Each indexed line is re-checked (line start, exact job= token)
+   before use; a stale index falls back to a full scan. A tail larger than
+   TBL_EVIDX_TAIL_MAX is merged into events.idx on the next lookup.
+*/
+
+#ifndef TBL_EVIDX_TAIL_MAX
+#define TBL_EVIDX_TAIL_MAX 1048576UL
+#endif
+
+/* Per-line callback: line as stored (LF included), 0 = continue, else stop. */
+typedef int (*tbl_evidx_line_fn)(void *ud, const char *line, size_t len);
+
+/* Write events.idx and drop the tail. full != 0 rescans the whole legacy
+   stream; otherwise events.idx and the tail are merged and only the legacy
+   bytes they do not cover are scanned. Returns 0 ok, 2 error. */
+int tbl_evidx_build(const char *repo_root, int full, unsigned long *out_entries,
+                    char *err, size_t errsz);
+
+/* Call fn for every legacy line with job=<jobid>, in file order.
+   out_scanned: legacy bytes read sequentially (0 when fully indexed).
+   A missing events.log is not an error. Returns 0 ok, 2 error. */
+int tbl_evidx_each(const char *repo_root, const char *jobid, tbl_evidx_line_fn fn, void *ud,
+                   unsigned long *out_scanned, char *err, size_t errsz);
+
+#ifdef TBL_EVIDX_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_EVIDX_LINE_MAX 4096
+
+typedef struct tbl_evidx_paths_s {
+    char legacy[1024];
+    char base[1024];
+    char tail[1024];
+} tbl_evidx_paths_t;
+
+/* index entries as "<jobid> <offset> <len>" strings in one arena */
+typedef struct tbl_evidx_vec_s {
+    char *arena;
+    size_t alen;
+    size_t acap;
+    size_t *rec;
+    unsigned long n;
+    unsigned long cap;
+} tbl_evidx_vec_t;
+
+static void tbl_evidx_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "events index error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_evidx_paths(const char *repo_root, tbl_evidx_paths_t *p)
+{
+    return tbl_path_join2(p->legacy, sizeof(p->legacy), repo_root, "events.log") &&
+           tbl_path_join2(p->base, sizeof(p->base), repo_root, "events.idx") &&
+           tbl_path_join2(p->tail, sizeof(p->tail), repo_root, "events.idx.tail");
+}
+
+/* Value of the job= token ("job=" first or " job=" later; 0 if none). */
+static int tbl_evidx_line_job(const char *line, const char **out, size_t *outlen)
+{
+    const char *p;
+    size_t n;
+
+    if (strncmp(line, "job=", 4) == 0) {
+        p = line + 4;
+    } else {
+        p = strstr(line, " job=");
+        if (!p) return 0;
+        p += 5;
+    }
+    n = strcspn(p, " \r\n");
+    if (n == 0) return 0;
+    *out = p;
+    *outlen = n;
+    return 1;
+}
+
+static int tbl_evidx_line_is_job(const char *line, const char *jobid)
+{
+    const char *j;
+    size_t jl;
+
+    if (!tbl_evidx_line_job(line, &j, &jl)) return 0;
+    return (jl == strlen(jobid) && memcmp(j, jobid, jl) == 0) ? 1 : 0;
+}
+
+/* Compare the key (up to the first space) of an index line with jobid. */
+static int tbl_evidx_keycmp(const char *line, const char *jobid)
+{
+    size_t kl;
+    size_t jl;
+    int c;
+
+    kl = strcspn(line, " \n");
+    jl = strlen(jobid);
+    c = memcmp(line, jobid, (kl < jl) ? kl : jl);
+    if (c != 0) return c;
+    return (kl < jl) ? -1 : (kl > jl) ? 1 : 0;
+}
+
+/* "<key> <offset> <len>" -> offset, len */
+static int tbl_evidx_parse_rec(const char *line, unsigned long *off, unsigned long *len)
+{
+    const char *p;
+    char *end = 0;
+
+    p = strchr(line, ' ');
+    if (!p || !(p[1] >= '0' && p[1] <= '9')) return 0;
+    *off = strtoul(p + 1, &end, 10);
+    if (!end || *end != ' ' || !(end[1] >= '0' && end[1] <= '9')) return 0;
+    p = end + 1;
+    *len = strtoul(p, &end, 10);
+    return (end && (*end == '\n' || *end == '\0') && *len > 0UL) ? 1 : 0;
+}
+
+/* Read one line; buf keeps its first bufsz-1 bytes, *len is the full
+   length including LF. Returns 1 for an LF-terminated line. */
+static int tbl_evidx_getline(FILE *fp, char *buf, size_t bufsz, unsigned long *len)
+{
+    size_t n;
+    int c;
+
+    if (fgets(buf, (int)bufsz, fp) == NULL) return 0;
+    n = strlen(buf);
+    *len = (unsigned long)n;
+    if (n > 0 && buf[n - 1] == '\n') return 1;
+    while ((c = fgetc(fp)) != EOF) {
+        (*len)++;
+        if (c == '\n') return 1;
+    }
+    return 0;
+}
+
+static int tbl_evidx_seek(FILE *fp, unsigned long off)
+{
+    if (off > (unsigned long)LONG_MAX) return 0;
+    return (fseek(fp, (long)off, SEEK_SET) == 0) ? 1 : 0;
+}
+
+static int tbl_evidx_file_size(FILE *fp, unsigned long *out)
+{
+    long n;
+
+    if (fseek(fp, 0L, SEEK_END) != 0) return 0;
+    n = ftell(fp);
+    if (n < 0L) return 0;
+    *out = (unsigned long)n;
+    return 1;
+}
+
+/* events.idx header; leaves fp at the first record. */
+static int tbl_evidx_read_header(FILE *fp, unsigned long *covered, unsigned long *hdr_end)
+{
+    char line[128];
+    char *end = 0;
+    size_t n;
+
+    if (fgets(line, (int)sizeof(line), fp) == NULL) return 0;
+    n = strlen(line);
+    if (n == 0 || line[n - 1] != '\n' || strncmp(line, "covered=", 8) != 0) return 0;
+    if (!(line[8] >= '0' && line[8] <= '9')) return 0;
+    *covered = strtoul(line + 8, &end, 10);
+    if (!end || *end != '\n') return 0;
+    *hdr_end = (unsigned long)n;
+    return 1;
+}
+
+/* ---- entry vectors ---- */
+
+static int tbl_evidx_vec_add(tbl_evidx_vec_t *v, const char *job, size_t jl,
+                             unsigned long off, unsigned long len)
+{
+    char obuf[32];
+    char lbuf[32];
+    size_t need;
+
+    if (!tbl_ul_to_dec_ok(off, obuf, sizeof(obuf)) || !tbl_ul_to_dec_ok(len, lbuf, sizeof(lbuf))) return 0;
+    need = jl + 1U + strlen(obuf) + 1U + strlen(lbuf) + 1U;
+
+    if (v->alen + need > v->acap) {
+        size_t ncap = v->acap ? v->acap : 65536U;
+        char *na;
+        while (ncap < v->alen + need) {
+            if (ncap > ((size_t)-1) / 2U) return 0;
+            ncap *= 2U;
+        }
+        na = (char *)realloc(v->arena, ncap);
+        if (!na) return 0;
+        v->arena = na;
+        v->acap = ncap;
+    }
+    if (v->n == v->cap) {
+        unsigned long ncap = v->cap ? v->cap * 2UL : 1024UL;
+        size_t *nr = (size_t *)realloc(v->rec, (size_t)ncap * sizeof(*nr));
+        if (!nr) return 0;
+        v->rec = nr;
+        v->cap = ncap;
+    }
+
+    v->rec[v->n++] = v->alen;
+    (void)memcpy(v->arena + v->alen, job, jl);
+    v->arena[v->alen + jl] = ' ';
+    v->alen += jl + 1U;
+    (void)memcpy(v->arena + v->alen, obuf, strlen(obuf));
+    v->alen += strlen(obuf);
+    v->arena[v->alen++] = ' ';
+    (void)memcpy(v->arena + v->alen, lbuf, strlen(lbuf));
+    v->alen += strlen(lbuf);
+    v->arena[v->alen++] = '\0';
+    return 1;
+}
+
+static void tbl_evidx_vec_free(tbl_evidx_vec_t *v)
+{
+    free(v->arena);
+    free(v->rec);
+    (void)memset(v, 0, sizeof(*v));
+}
+
+static int tbl_evidx_cmp_rec(const void *a, const void *b)
+{
+    const char *x = *(const char * const *)a;
+    const char *y = *(const char * const *)b;
+    size_t xl = strcspn(x, " ");
+    size_t yl = strcspn(y, " ");
+    unsigned long xo;
+    unsigned long yo;
+    int c;
+
+    c = memcmp(x, y, (xl < yl) ? xl : yl);
+    if (c != 0) return c;
+    if (xl != yl) return (xl < yl) ? -1 : 1;
+    xo = strtoul(x + xl + 1, 0, 10);
+    yo = strtoul(y + yl + 1, 0, 10);
+    return (xo < yo) ? -1 : (xo > yo) ? 1 : 0;
+}
+
+/* Scan legacy lines from *pos to the last complete line: every job line
+   goes to v, lines of only_job to offs. Advances *pos; counts bytes read
+   in *scanned. */
+static int tbl_evidx_scan(FILE *fp, unsigned long *pos, const char *only_job,
+                          tbl_evidx_vec_t *v, unsigned long **offs, unsigned long *noffs,
+                          unsigned long *capoffs, unsigned long *scanned)
+{
+    char buf[TBL_EVIDX_LINE_MAX];
+    unsigned long len;
+
+    if (!tbl_evidx_seek(fp, *pos)) return 0;
+    while (tbl_evidx_getline(fp, buf, sizeof(buf), &len)) {
+        const char *j;
+        size_t jl;
+
+        if (tbl_evidx_line_job(buf, &j, &jl)) {
+            if (v && !tbl_evidx_vec_add(v, j, jl, *pos, len)) return 0;
+            if (only_job && jl == strlen(only_job) && memcmp(j, only_job, jl) == 0) {
+                if (*noffs == *capoffs) {
+                    unsigned long ncap = *capoffs ? *capoffs * 2UL : 64UL;
+                    unsigned long *no = (unsigned long *)realloc(*offs, (size_t)ncap * sizeof(*no));
+                    if (!no) return 0;
+                    *offs = no;
+                    *capoffs = ncap;
+                }
+                (*offs)[(*noffs)++] = *pos;
+            }
+        }
+        *pos += len;
+        if (scanned) *scanned += len;
+    }
+    return ferror(fp) ? 0 : 1;
+}
+
+int tbl_evidx_build(const char *repo_root, int full, unsigned long *out_entries,
+                    char *err, size_t errsz)
+{
+    tbl_evidx_paths_t p;
+    tbl_evidx_vec_t v;
+    char line[512];
+    char tmp[1100];
+    char nbuf[32];
+    char **sorted;
+    unsigned long covered;
+    unsigned long end;
+    unsigned long i;
+    FILE *fp;
+    FILE *out;
+    int ok;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_entries) *out_entries = 0UL;
+    if (!repo_root || !repo_root[0] || !tbl_evidx_paths(repo_root, &p)) {
+        tbl_evidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+
+    (void)memset(&v, 0, sizeof(v));
+    ok = 1;
+    covered = 0UL;
+    end = 0UL;
+
+    if (!full) {
+        unsigned long hdr_end;
+
+        /* merge: events.idx, then the tail while it stays contiguous */
+        fp = fopen(p.base, "rb");
+        if (fp) {
+            if (tbl_evidx_read_header(fp, &covered, &hdr_end)) {
+                while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+                    unsigned long off;
+                    unsigned long len;
+                    size_t kl = strcspn(line, " ");
+                    if (!tbl_evidx_parse_rec(line, &off, &len)) { ok = 0; break; }
+                    if (!tbl_evidx_vec_add(&v, line, kl, off, len)) ok = 0;
+                }
+            } else {
+                ok = 0;
+            }
+            fclose(fp);
+        }
+        if (!ok) {
+            /* unreadable index: start over */
+            tbl_evidx_vec_free(&v);
+            covered = 0UL;
+            ok = 1;
+        }
+        end = covered;
+
+        fp = fopen(p.tail, "rb");
+        if (fp) {
+            while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+                unsigned long off;
+                unsigned long len;
+                size_t kl = strcspn(line, " ");
+                if (!tbl_evidx_parse_rec(line, &off, &len)) break;
+                if (off < end) continue;
+                if (off > end) break;
+                if (!(kl == 1U && line[0] == '-') && !tbl_evidx_vec_add(&v, line, kl, off, len)) ok = 0;
+                end += len;
+            }
+            fclose(fp);
+        }
+    }
+
+    /* legacy bytes not covered yet */
+    if (ok) {
+        fp = fopen(p.legacy, "rb");
+        if (fp) {
+            unsigned long size = 0UL;
+            if (!tbl_evidx_file_size(fp, &size) || end > size) {
+                /* index ran past the log: rebuild from scratch */
+                tbl_evidx_vec_free(&v);
+                end = 0UL;
+            }
+            if (!tbl_evidx_scan(fp, &end, 0, &v, 0, 0, 0, 0)) ok = 0;
+            fclose(fp);
+        } else {
+            tbl_evidx_vec_free(&v);
+            end = 0UL;
+        }
+    }
+    if (!ok) {
+        tbl_evidx_vec_free(&v);
+        tbl_evidx_seterr(err, errsz, "cannot read events index input");
+        return 2;
+    }
+
+    sorted = (v.n > 0UL) ? (char **)malloc((size_t)v.n * sizeof(*sorted)) : 0;
+    if (v.n > 0UL && !sorted) {
+        tbl_evidx_vec_free(&v);
+        tbl_evidx_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    for (i = 0UL; i < v.n; ++i) sorted[i] = v.arena + v.rec[i];
+    if (v.n > 1UL) qsort(sorted, (size_t)v.n, sizeof(*sorted), tbl_evidx_cmp_rec);
+
+    /* events.idx via tmp + rename, then drop the merged tail */
+    if (!tbl_strlcpy_ok(tmp, p.base, sizeof(tmp)) || !tbl_strlcat_ok(tmp, ".tmp", sizeof(tmp)) ||
+        !tbl_ul_to_dec_ok(end, nbuf, sizeof(nbuf))) {
+        ok = 0;
+    }
+    out = ok ? fopen(tmp, "wb") : 0;
+    if (!out) ok = 0;
+    if (ok && !tbl_fputs3_ok(out, "covered=", nbuf, "\n")) ok = 0;
+    for (i = 0UL; ok && i < v.n; ++i) {
+        if (!tbl_fputs2_ok(out, sorted[i], "\n")) ok = 0;
+    }
+    if (out && fclose(out) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(tmp, p.base, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(tmp);
+
+    free(sorted);
+    if (out_entries) *out_entries = v.n;
+    tbl_evidx_vec_free(&v);
+    if (!ok) {
+        tbl_evidx_seterr(err, errsz, "cannot write events.idx");
+        return 2;
+    }
+    (void)tbl_fs_remove_file(p.tail);
+    return 0;
+}
+
+/* First record with key >= jobid in [lo, hi); lo must be a line start. */
+static int tbl_evidx_lower_bound(FILE *fp, unsigned long lo, unsigned long hi, const char *jobid,
+                                 unsigned long *out)
+{
+    char buf[512];
+
+    while (lo < hi) {
+        unsigned long mid;
+        unsigned long s;
+        size_t n;
+
+        mid = lo + (hi - lo) / 2UL;
+        s = lo;
+        if (mid > lo) {
+            int c = EOF;
+            if (!tbl_evidx_seek(fp, mid - 1UL)) return 0;
+            s = mid - 1UL;
+            while ((c = fgetc(fp)) != EOF) {
+                s++;
+                if (c == '\n') break;
+            }
+            if (c == EOF) s = hi;
+        }
+        if (s >= hi) s = lo; /* no record starts in [mid, hi) */
+
+        if (!tbl_evidx_seek(fp, s) || fgets(buf, (int)sizeof(buf), fp) == NULL) return 0;
+        n = strlen(buf);
+        if (n == 0 || buf[n - 1] != '\n') return 0;
+        if (tbl_evidx_keycmp(buf, jobid) < 0) lo = s + (unsigned long)n;
+        else hi = s;
+    }
+    *out = lo;
+    return 1;
+}
+
+/* Line at off starts a line and carries job=<jobid>. */
+static int tbl_evidx_check(FILE *fp, unsigned long off, const char *jobid, char *buf, size_t bufsz)
+{
+    unsigned long len;
+
+    if (off > 0UL) {
+        if (!tbl_evidx_seek(fp, off - 1UL) || fgetc(fp) != '\n') return 0;
+    } else if (!tbl_evidx_seek(fp, 0UL)) {
+        return 0;
+    }
+    if (!tbl_evidx_getline(fp, buf, bufsz, &len)) return 0;
+    return tbl_evidx_line_is_job(buf, jobid);
+}
+
+int tbl_evidx_each(const char *repo_root, const char *jobid, tbl_evidx_line_fn fn, void *ud,
+                   unsigned long *out_scanned, char *err, size_t errsz)
+{
+    tbl_evidx_paths_t p;
+    char buf[TBL_EVIDX_LINE_MAX];
+    unsigned long *offs;
+    unsigned long noffs;
+    unsigned long capoffs;
+    unsigned long covered;
+    unsigned long end;
+    unsigned long tail_bytes;
+    unsigned long scanned;
+    unsigned long i;
+    FILE *fp;
+    FILE *lg;
+    int stale;
+    int ok;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_scanned) *out_scanned = 0UL;
+    if (!repo_root || !repo_root[0] || !jobid || !jobid[0] || !fn || !tbl_evidx_paths(repo_root, &p)) {
+        tbl_evidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+
+    lg = fopen(p.legacy, "rb");
+    if (!lg) return 0;
+
+    offs = 0;
+    noffs = 0UL;
+    capoffs = 0UL;
+    covered = 0UL;
+    stale = 0;
+    ok = 1;
+
+    /* events.idx: binary search for the job's records */
+    fp = fopen(p.base, "rb");
+    if (fp) {
+        unsigned long hdr_end;
+        unsigned long size;
+        unsigned long pos;
+
+        if (!tbl_evidx_read_header(fp, &covered, &hdr_end) || !tbl_evidx_file_size(fp, &size) ||
+            !tbl_evidx_lower_bound(fp, hdr_end, size, jobid, &pos) || !tbl_evidx_seek(fp, pos)) {
+            covered = 0UL;
+        } else {
+            while (fgets(buf, (int)sizeof(buf), fp) != NULL && tbl_evidx_keycmp(buf, jobid) == 0) {
+                unsigned long off;
+                unsigned long len;
+                if (!tbl_evidx_parse_rec(buf, &off, &len) || off >= covered) { stale = 1; break; }
+                if (noffs == capoffs) {
+                    unsigned long ncap = capoffs ? capoffs * 2UL : 64UL;
+                    unsigned long *no = (unsigned long *)realloc(offs, (size_t)ncap * sizeof(*no));
+                    if (!no) { ok = 0; break; }
+                    offs = no;
+                    capoffs = ncap;
+                }
+                offs[noffs++] = off;
+            }
+        }
+        fclose(fp);
+    }
+
+    /* tail: appended in file order, used while contiguous */
+    end = covered;
+    tail_bytes = 0UL;
+    fp = ok ? fopen(p.tail, "rb") : 0;
+    if (fp) {
+        while (ok && fgets(buf, (int)sizeof(buf), fp) != NULL) {
+            unsigned long off;
+            unsigned long len;
+
+            tail_bytes += (unsigned long)strlen(buf);
+            if (!tbl_evidx_parse_rec(buf, &off, &len)) break;
+            if (off < end) continue;
+            if (off > end) break;
+            end += len;
+            if (tbl_evidx_keycmp(buf, jobid) != 0) continue;
+            if (noffs == capoffs) {
+                unsigned long ncap = capoffs ? capoffs * 2UL : 64UL;
+                unsigned long *no = (unsigned long *)realloc(offs, (size_t)ncap * sizeof(*no));
+                if (!no) { ok = 0; break; }
+                offs = no;
+                capoffs = ncap;
+            }
+            offs[noffs++] = off;
+        }
+        fclose(fp);
+    }
+
+    /* the rest of the legacy stream */
+    scanned = 0UL;
+    if (ok && !tbl_evidx_scan(lg, &end, jobid, 0, &offs, &noffs, &capoffs, &scanned)) ok = 0;
+
+    /* re-check every indexed line; stale -> full scan */
+    for (i = 0UL; ok && !stale && i < noffs; ++i) {
+        if (!tbl_evidx_check(lg, offs[i], jobid, buf, sizeof(buf))) stale = 1;
+    }
+    if (ok && stale) {
+        noffs = 0UL;
+        end = 0UL;
+        scanned = 0UL;
+        if (!tbl_evidx_scan(lg, &end, jobid, 0, &offs, &noffs, &capoffs, &scanned)) ok = 0;
+    }
+
+    for (i = 0UL; ok && i < noffs; ++i) {
+        unsigned long len;
+        if (!tbl_evidx_seek(lg, offs[i]) || !tbl_evidx_getline(lg, buf, sizeof(buf), &len)) {
+            ok = 0;
+            break;
+        }
+        if (fn(ud, buf, strlen(buf)) != 0) break;
+    }
+
+    fclose(lg);
+    free(offs);
+    if (out_scanned) *out_scanned = scanned;
+    if (!ok) {
+        tbl_evidx_seterr(err, errsz, "cannot read legacy events");
+        return 2;
+    }
+
+    /* fold a long tail into events.idx (best effort) */
+    if (tail_bytes > TBL_EVIDX_TAIL_MAX) (void)tbl_evidx_build(repo_root, 0, 0, 0, 0);
+    return 0;
+}
+
+#endif /* TBL_EVIDX_IMPLEMENTATION */
+
+#endif /* TBL_CORE_EVIDX_H */
@@ -0,0 +1,2 @@
+#define TBL_EVLOG_IMPLEMENTATION
+#include "core/evlog.h"
@@ -0,0 +1,261 @@
+#ifndef TBL_CORE_EVLOG_H
+#define TBL_CORE_EVLOG_H
+
+#include <stddef.h>
+
+#include "core/events.h"
+#include "os/thread.h"
+
+/* Asynchronous event logger ([events] async = 1).
+   The caller hands events to a bounded ring of fixed-size slots; one
+   background thread takes them in order and writes them through the events
+   writer (legacy stream, job stream, ops chain), so the caller's path does
+   no event I/O. The event time is taken when the event is appended.
+   - ring full: append waits for a free slot (back pressure, nothing dropped)
+   - tbl_evlog_barrier(): returns once every event appended before it is
+     written and the writer's batch is flushed
+   - tbl_evlog_close(): drains the ring, joins the thread, closes the writer
+     (which flushes)
+   One producer thread. Configure the writer (l->w: batch, segments) before
+   tbl_evlog_start_ok(). Not started, or without threads (Plan 9,
+   TBL_NO_THREADS=1), append writes through the writer directly.
+   Write errors on the thread are only counted (errors): event logging is
+   best effort. */
+
+#define TBL_EVLOG_SLOTS_DEFAULT 1024UL
+
+typedef struct tbl_evlog_slot_s {
+    unsigned long ts;
+    char event[128];
+    char jobid[128];
+    char status[64];
+    char sha[80];
+    char reason[512];
+} tbl_evlog_slot_t;
+
+typedef struct tbl_evlog_s {
+    tbl_events_writer_t w;
+    int async;               /* background thread running */
+    tbl_evlog_slot_t *ring;
+    unsigned long nslots;
+    unsigned long head;      /* events appended (wraps) */
+    unsigned long tail;      /* events written */
+    unsigned long flushed;   /* tail at the last barrier flush */
+    int flush_req;
+    int stop;
+    unsigned long full_waits; /* appends that waited for a free slot */
+    unsigned long errors;     /* failed writes on the thread */
+    tbl_mutex_t mu;
+    tbl_cond_t cv_work;      /* thread: slot filled, flush or stop requested */
+    tbl_cond_t cv_done;      /* producer: slot freed, flush done */
+    tbl_thread_t th;
+} tbl_evlog_t;
+
+/* Opens the writer (a damaged ops.log head only stops the chain, see
+   tbl_events_writer_audit_ok in core/events.h).
+   Returns 0 ok, 2 error. */
+int tbl_evlog_open(tbl_evlog_t *l, const char *repo_root, char *err, size_t errsz);
+
+/* Start the background thread with nslots ring slots (0 = default).
+   Returns 1 if it runs; 0 = the logger stays synchronous. */
+int tbl_evlog_start_ok(tbl_evlog_t *l, unsigned long nslots);
+
+/* Queue one event (synchronous: write it). Returns 0 ok, 2 error. */
+int tbl_evlog_append(tbl_evlog_t *l,
+                     const char *event,
+                     const char *jobid,
+                     const char *status,
+                     const char *sha256_or_empty,
+                     const char *reason_or_empty);
+
+/* Wait until everything appended so far is written and flushed.
+   Returns 0 ok, 2 if the flush failed. */
+int tbl_evlog_barrier(tbl_evlog_t *l);
+
+void tbl_evlog_close(tbl_evlog_t *l);
+
+#ifdef TBL_EVLOG_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/safe.h"
+
+static void tbl_evlog_main(void *ud, unsigned long worker)
+{
+    tbl_evlog_t *l = (tbl_evlog_t *)ud;
+
+    (void)worker;
+    tbl_mutex_lock(&l->mu);
+    for (;;) {
+        while (l->tail == l->head && !l->flush_req && !l->stop) tbl_cond_wait(&l->cv_work, &l->mu);
+
+        if (l->tail != l->head) {
+            /* the slot stays put until tail moves: write it unlocked */
+            const tbl_evlog_slot_t *s = &l->ring[l->tail % l->nslots];
+            int rc;
+
+            tbl_mutex_unlock(&l->mu);
+            rc = tbl_events_writer_append_ts(&l->w, s->ts, s->event, s->jobid, s->status,
+                                             s->sha, s->reason, 0, 0);
+            tbl_mutex_lock(&l->mu);
+            if (rc != 0) l->errors++;
+            l->tail++;
+            tbl_cond_broadcast(&l->cv_done);
+            continue;
+        }
+
+        /* ring drained */
+        if (l->flush_req) {
+            unsigned long upto = l->tail;
+            int rc;
+
+            tbl_mutex_unlock(&l->mu);
+            rc = tbl_events_writer_flush(&l->w, 0, 0);
+            tbl_mutex_lock(&l->mu);
+            if (rc != 0) l->errors++;
+            l->flushed = upto;
+            l->flush_req = 0;
+            tbl_cond_broadcast(&l->cv_done);
+        }
+        if (l->stop) break;
+    }
+    tbl_mutex_unlock(&l->mu);
+}
+
+int tbl_evlog_open(tbl_evlog_t *l, const char *repo_root, char *err, size_t errsz)
+{
+    if (!l) return 2;
+    (void)memset(l, 0, sizeof(*l));
+    return tbl_events_writer_open(&l->w, repo_root, err, errsz);
+}
+
+int tbl_evlog_start_ok(tbl_evlog_t *l, unsigned long nslots)
+{
+    if (!l || !l->w.is_open || l->async) return 0;
+    if (!TBL_HAVE_THREADS) return 0;
+    if (nslots == 0UL) nslots = TBL_EVLOG_SLOTS_DEFAULT;
+
+    l->ring = (tbl_evlog_slot_t *)malloc((size_t)nslots * sizeof(*l->ring));
+    if (!l->ring) return 0;
+    l->nslots = nslots;
+    l->head = l->tail = l->flushed = 0UL;
+    l->flush_req = 0;
+    l->stop = 0;
+
+    if (!tbl_mutex_init_ok(&l->mu)) {
+        free(l->ring);
+        l->ring = 0;
+        return 0;
+    }
+    if (!tbl_cond_init_ok(&l->cv_work)) {
+        tbl_mutex_destroy(&l->mu);
+        free(l->ring);
+        l->ring = 0;
+        return 0;
+    }
+    if (!tbl_cond_init_ok(&l->cv_done)) {
+        tbl_cond_destroy(&l->cv_work);
+        tbl_mutex_destroy(&l->mu);
+        free(l->ring);
+        l->ring = 0;
+        return 0;
+    }
+    if (!tbl_thread_start_ok(&l->th, tbl_evlog_main, l)) {
+        tbl_cond_destroy(&l->cv_done);
+        tbl_cond_destroy(&l->cv_work);
+        tbl_mutex_destroy(&l->mu);
+        free(l->ring);
+        l->ring = 0;
+        return 0;
+    }
+    l->async = 1;
+    return 1;
+}
+
+int tbl_evlog_append(tbl_evlog_t *l,
+                     const char *event,
+                     const char *jobid,
+                     const char *status,
+                     const char *sha256_or_empty,
+                     const char *reason_or_empty)
+{
+    tbl_evlog_slot_t *s;
+    unsigned long ts;
+
+    if (!l || !event || !event[0]) return 2;
+    ts = (unsigned long)time(0);
+    if (!l->async) {
+        return tbl_events_writer_append_ts(&l->w, ts, event, jobid, status,
+                                           sha256_or_empty, reason_or_empty, 0, 0);
+    }
+
+    tbl_mutex_lock(&l->mu);
+    if (l->head - l->tail >= l->nslots) {
+        l->full_waits++;
+        while (l->head - l->tail >= l->nslots) tbl_cond_wait(&l->cv_done, &l->mu);
+    }
+    s = &l->ring[l->head % l->nslots];
+    tbl_mutex_unlock(&l->mu);
+
+    /* only this thread fills slots: copy unlocked, then publish */
+    s->ts = ts;
+    (void)tbl_strlcpy(s->event, event, sizeof(s->event));
+    (void)tbl_strlcpy(s->jobid, jobid ? jobid : "", sizeof(s->jobid));
+    (void)tbl_strlcpy(s->status, status ? status : "", sizeof(s->status));
+    (void)tbl_strlcpy(s->sha, sha256_or_empty ? sha256_or_empty : "", sizeof(s->sha));
+    (void)tbl_strlcpy(s->reason, reason_or_empty ? reason_or_empty : "", sizeof(s->reason));
+
+    tbl_mutex_lock(&l->mu);
+    l->head++;
+    tbl_cond_signal(&l->cv_work);
+    tbl_mutex_unlock(&l->mu);
+    return 0;
+}
+
+int tbl_evlog_barrier(tbl_evlog_t *l)
+{
+    unsigned long target;
+    unsigned long errs;
+
+    if (!l) return 2;
+    if (!l->async) return tbl_events_writer_flush(&l->w, 0, 0);
+
+    tbl_mutex_lock(&l->mu);
+    errs = l->errors;
+    target = l->head;
+    l->flush_req = 1;
+    tbl_cond_signal(&l->cv_work);
+    /* flushed only moves forward; it may pass target */
+    while (l->flushed != target && target - l->flushed < 0x80000000UL) {
+        tbl_cond_wait(&l->cv_done, &l->mu);
+    }
+    errs = l->errors - errs;
+    tbl_mutex_unlock(&l->mu);
+    return (errs == 0UL) ? 0 : 2;
+}
+
+void tbl_evlog_close(tbl_evlog_t *l)
+{
+    if (!l) return;
+    if (l->async) {
+        tbl_mutex_lock(&l->mu);
+        l->stop = 1;
+        tbl_cond_signal(&l->cv_work);
+        tbl_mutex_unlock(&l->mu);
+        tbl_thread_join(&l->th);
+
+        tbl_cond_destroy(&l->cv_done);
+        tbl_cond_destroy(&l->cv_work);
+        tbl_mutex_destroy(&l->mu);
+        free(l->ring);
+        l->ring = 0;
+        l->async = 0;
+    }
+    tbl_events_writer_close(&l->w);
+}
+
+#endif /* TBL_EVLOG_IMPLEMENTATION */
+
+#endif /* TBL_CORE_EVLOG_H */
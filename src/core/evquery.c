@@ -0,0 +1,2 @@
+#define TBL_EVQUERY_IMPLEMENTATION
+#include "core/evquery.h"
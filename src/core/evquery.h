@@ -0,0 +1,876 @@
+#ifndef TBL_CORE_EVQUERY_H
+#define TBL_CORE_EVQUERY_H
+
+#include <stddef.h>
+
+/* Event queries over the legacy combined stream <repo_root>/events.log.
+   - events.tsidx  sparse time index, one "<offset> <len> <min_ts> <max_ts>"
+                   line per block of TBL_EVQ_BLOCK_LINES lines, contiguous
+                   from offset 0 (derived, rebuilt when it does not fit)
+   A query first appends index lines for complete blocks written since the
+   last query, then reads only the byte range the time filter can match:
+   from the first block whose running maximum reaches --since, up to the
+   first block from which every later line is at or after --until. Lines
+   are matched in the read buffer, key=value tokens are compared in place.
+   With a job filter the lookup goes through the job index (core/evidx.h).
+
+   Follow (tail): tbl_evq_follow() streams complete lines from a byte offset
+   on and, when following, waits for new ones (os/watch.h: inotify on Linux,
+   polling elsewhere). A named consumer keeps its position in
+   <repo_root>/cursors/<name> ("offset=N", replaced atomically after fsync);
+   the cursor moves after each batch has been handed to the consumer, so a
+   restart resumes without gaps and without rescanning the log.
+*/
+
+#ifndef TBL_EVQ_BLOCK_LINES
+#define TBL_EVQ_BLOCK_LINES 1024UL
+#endif
+
+typedef struct tbl_evq_s {
+    unsigned long since;  /* ts >= since (if since_set) */
+    unsigned long until;  /* ts <  until (if until_set) */
+    int since_set;
+    int until_set;
+    const char *event;    /* exact name or dotted prefix ("verify" -> verify.*); NULL = any */
+    const char *status;   /* exact; NULL = any */
+    const char *job;      /* exact; NULL = any */
+} tbl_evq_t;
+
+/* Per-line callback: line as stored (LF included), 0 = continue, else stop. */
+typedef int (*tbl_evq_line_fn)(void *ud, const char *line, size_t len);
+
+/* Parse a time for --since/--until:
+   - unix seconds              "1760745600"
+   - relative to now (ago)     "90s" "30m" "1h" "2d"
+   - UTC date / date-time      "2026-10-17" "2026-10-17T08:30" "2026-10-17T08:30:00Z"
+   Returns 1 ok, 0 invalid. */
+int tbl_evq_parse_time_ok(const char *s, unsigned long now, unsigned long *out);
+
+/* 1 if the event line matches every filter of q. */
+int tbl_evq_match_ok(const tbl_evq_t *q, const char *line, size_t len);
+
+/* Call fn for every matching line in file order.
+   out_scanned: events.log bytes read for the query (index upkeep excluded).
+   A missing events.log is not an error. Returns 0 ok, 2 error. */
+int tbl_evq_run(const char *repo_root, const tbl_evq_t *q, tbl_evq_line_fn fn, void *ud,
+                unsigned long *out_scanned, char *err, size_t errsz);
+
+#define TBL_EVQ_FROM_END 4294967295UL /* follow: start at the current end */
+
+#ifndef TBL_EVQ_POLL_MS
+#define TBL_EVQ_POLL_MS 250UL
+#endif
+
+typedef struct tbl_evq_follow_s {
+    unsigned long from;     /* start offset (a line start) or TBL_EVQ_FROM_END */
+    const char *cursor;     /* consumer name: a stored cursor wins over from,
+                               progress is stored back; NULL = none */
+    int follow;             /* 1 = wait for new lines, 0 = stop at the end */
+    unsigned long poll_ms;  /* longest wait between checks (0 = TBL_EVQ_POLL_MS) */
+    int (*flush)(void *ud); /* before the cursor moves (NULL = none); nonzero = error */
+} tbl_evq_follow_t;
+
+/* Consumer cursor <repo_root>/cursors/<name>; name = [A-Za-z0-9._-], at
+   most 64 chars, not starting with '.'.
+   load: *out_found = 0 (and *out_off = 0) when none is stored yet.
+   Returns 0 ok, 2 error. */
+int tbl_evq_cursor_load(const char *repo_root, const char *name, unsigned long *out_off, int *out_found,
+                        char *err, size_t errsz);
+int tbl_evq_cursor_store(const char *repo_root, const char *name, unsigned long off, char *err, size_t errsz);
+
+/* Call fn for every matching complete line from the start offset on (q may
+   be NULL: every line). Returns once fn returns nonzero, or at the end of
+   the log when not following. out_off: offset after the last line read.
+   The start offset must be a line start within events.log; a log shorter
+   than the position (replaced or truncated) is an error.
+   Returns 0 ok, 2 error. */
+int tbl_evq_follow(const char *repo_root, const tbl_evq_t *q, const tbl_evq_follow_t *f,
+                   tbl_evq_line_fn fn, void *ud, unsigned long *out_off, char *err, size_t errsz);
+
+#ifdef TBL_EVQUERY_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/evidx.h"
+#include "core/path.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+#include "os/watch.h"
+
+#define TBL_EVQ_CHUNK   65536U
+#define TBL_EVQ_TS_NONE 4294967295UL /* block without any ts= */
+
+typedef struct tbl_evq_blk_s {
+    unsigned long off;
+    unsigned long len;
+    unsigned long min_ts;
+    unsigned long max_ts;
+} tbl_evq_blk_t;
+
+typedef struct tbl_evq_idx_s {
+    tbl_evq_blk_t *b;
+    unsigned long n;
+    unsigned long cap;
+    unsigned long covered;  /* bytes covered by full blocks */
+    unsigned long rem_min;  /* smallest ts after covered */
+} tbl_evq_idx_t;
+
+static void tbl_evq_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "event query error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+/* ---- time parsing ---- */
+
+static int tbl_evq_digits(const char *s, size_t n, unsigned long *out)
+{
+    size_t i;
+    unsigned long v;
+
+    v = 0UL;
+    for (i = 0; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9') return 0;
+        v = v * 10UL + (unsigned long)(s[i] - '0');
+    }
+    *out = v;
+    return 1;
+}
+
+/* days since 1970-01-01 for a proleptic Gregorian date */
+static long tbl_evq_days_from_civil(long y, unsigned long m, unsigned long d)
+{
+    long era;
+    unsigned long yoe;
+    unsigned long doy;
+    unsigned long doe;
+
+    y -= (m <= 2UL) ? 1L : 0L;
+    era = (y >= 0L ? y : y - 399L) / 400L;
+    yoe = (unsigned long)(y - era * 400L);
+    doy = (153UL * (m > 2UL ? m - 3UL : m + 9UL) + 2UL) / 5UL + d - 1UL;
+    doe = yoe * 365UL + yoe / 4UL - yoe / 100UL + doy;
+    return era * 146097L + (long)doe - 719468L;
+}
+
+int tbl_evq_parse_time_ok(const char *s, unsigned long now, unsigned long *out)
+{
+    size_t n;
+    unsigned long v;
+
+    if (!s || !out) return 0;
+    n = strlen(s);
+    if (n == 0 || n > 20U) return 0;
+
+    /* unix seconds */
+    if (tbl_evq_digits(s, n, &v)) {
+        if (n > 10U) return 0;
+        *out = v;
+        return 1;
+    }
+
+    /* relative: <n>s|m|h|d before now */
+    if (n >= 2U && n <= 9U && tbl_evq_digits(s, n - 1U, &v)) {
+        unsigned long mul;
+
+        switch (s[n - 1U]) {
+            case 's': mul = 1UL; break;
+            case 'm': mul = 60UL; break;
+            case 'h': mul = 3600UL; break;
+            case 'd': mul = 86400UL; break;
+            default: return 0;
+        }
+        if (v > 4294967295UL / mul) return 0;
+        v *= mul;
+        *out = (v < now) ? now - v : 0UL;
+        return 1;
+    }
+
+    /* YYYY-MM-DD[THH:MM[:SS]][Z] (UTC) */
+    if (n >= 10U && s[4] == '-' && s[7] == '-') {
+        unsigned long y, mo, d, hh, mi, ss;
+        long days;
+
+        hh = mi = ss = 0UL;
+        if (!tbl_evq_digits(s, 4, &y) || !tbl_evq_digits(s + 5, 2, &mo) || !tbl_evq_digits(s + 8, 2, &d)) return 0;
+        if (y < 1970UL || mo < 1UL || mo > 12UL || d < 1UL || d > 31UL) return 0;
+        if (n > 10U && s[n - 1U] == 'Z') n--;
+        if (n > 10U) {
+            if ((s[10] != 'T' && s[10] != ' ') || (n != 16U && n != 19U) || s[13] != ':') return 0;
+            if (!tbl_evq_digits(s + 11, 2, &hh) || !tbl_evq_digits(s + 14, 2, &mi)) return 0;
+            if (n == 19U && (s[16] != ':' || !tbl_evq_digits(s + 17, 2, &ss))) return 0;
+            if (hh > 23UL || mi > 59UL || ss > 60UL) return 0;
+        }
+        days = tbl_evq_days_from_civil((long)y, mo, d);
+        if (days < 0L || (unsigned long)days > 49710UL) return 0; /* stays within 32 bits */
+        *out = (unsigned long)days * 86400UL + hh * 3600UL + mi * 60UL + ss;
+        return 1;
+    }
+    return 0;
+}
+
+/* ---- matching (in place) ---- */
+
+/* Find key=value in a space separated line; value is not copied. */
+static int tbl_evq_field(const char *line, size_t len, const char *key, const char **v, size_t *vl)
+{
+    size_t kl;
+    size_t i;
+
+    kl = strlen(key);
+    i = 0;
+    while (i < len) {
+        size_t j = i;
+        while (j < len && line[j] != ' ' && line[j] != '\n' && line[j] != '\r') j++;
+        if (j - i > kl && memcmp(line + i, key, kl) == 0 && line[i + kl] == '=') {
+            *v = line + i + kl + 1U;
+            *vl = j - i - kl - 1U;
+            return 1;
+        }
+        i = j + 1U;
+    }
+    return 0;
+}
+
+static int tbl_evq_line_ts(const char *line, size_t len, unsigned long *ts)
+{
+    const char *v;
+    size_t vl;
+
+    if (!tbl_evq_field(line, len, "ts", &v, &vl) || vl == 0 || vl > 10U) return 0;
+    return tbl_evq_digits(v, vl, ts);
+}
+
+static int tbl_evq_value_is(const char *line, size_t len, const char *key, const char *want)
+{
+    const char *v;
+    size_t vl;
+
+    if (!tbl_evq_field(line, len, key, &v, &vl)) return 0;
+    return (vl == strlen(want) && memcmp(v, want, vl) == 0) ? 1 : 0;
+}
+
+int tbl_evq_match_ok(const tbl_evq_t *q, const char *line, size_t len)
+{
+    if (!q || !line) return 0;
+
+    if (q->since_set || q->until_set) {
+        unsigned long ts;
+        if (!tbl_evq_line_ts(line, len, &ts)) return 0;
+        if (q->since_set && ts < q->since) return 0;
+        if (q->until_set && ts >= q->until) return 0;
+    }
+    if (q->event && q->event[0]) {
+        const char *v;
+        size_t vl;
+        size_t el = strlen(q->event);
+
+        if (!tbl_evq_field(line, len, "event", &v, &vl)) return 0;
+        if (vl < el || memcmp(v, q->event, el) != 0) return 0;
+        if (vl > el && v[el] != '.') return 0;
+    }
+    if (q->status && q->status[0] && !tbl_evq_value_is(line, len, "status", q->status)) return 0;
+    if (q->job && q->job[0] && !tbl_evq_value_is(line, len, "job", q->job)) return 0;
+    return 1;
+}
+
+/* ---- chunked line scan ---- */
+
+typedef int (*tbl_evq_scan_fn)(void *ud, const char *line, size_t len, unsigned long off);
+
+/* Call fn for every LF-terminated line in [start, end) of fp; a torn last
+   line is left alone. Lines longer than the buffer are skipped. */
+static int tbl_evq_scan(FILE *fp, char *buf, unsigned long start, unsigned long end,
+                        tbl_evq_scan_fn fn, void *ud, unsigned long *out_read)
+{
+    unsigned long pos;  /* file offset of buf[0] */
+    size_t have;
+    int skipping;
+
+    if (out_read) *out_read = 0UL;
+    if (start >= end) return 1;
+    if (start > (unsigned long)LONG_MAX || fseek(fp, (long)start, SEEK_SET) != 0) return 0;
+
+    pos = start;
+    have = 0;
+    skipping = 0;
+    while (pos + (unsigned long)have < end) {
+        size_t want;
+        size_t got;
+        size_t i;
+        size_t ls;
+
+        want = TBL_EVQ_CHUNK - have;
+        if ((unsigned long)want > end - pos - (unsigned long)have) want = (size_t)(end - pos - (unsigned long)have);
+        got = fread(buf + have, 1, want, fp);
+        if (got == 0) break;
+        if (out_read) *out_read += (unsigned long)got;
+        have += got;
+
+        ls = 0;
+        for (i = 0; i < have; ++i) {
+            if (buf[i] != '\n') continue;
+            if (!skipping && fn(ud, buf + ls, i + 1U - ls, pos + (unsigned long)ls) != 0) return 1;
+            skipping = 0;
+            ls = i + 1U;
+        }
+        if (ls == 0 && have == TBL_EVQ_CHUNK) {
+            /* overlong line: drop what we have, skip to its end */
+            skipping = 1;
+            ls = have;
+        }
+        if (ls > 0) {
+            (void)memmove(buf, buf + ls, have - ls);
+            pos += (unsigned long)ls;
+            have -= ls;
+        }
+    }
+    return ferror(fp) ? 0 : 1;
+}
+
+/* ---- sparse index ---- */
+
+static int tbl_evq_idx_push(tbl_evq_idx_t *ix, const tbl_evq_blk_t *b)
+{
+    if (ix->n == ix->cap) {
+        unsigned long ncap = ix->cap ? ix->cap * 2UL : 256UL;
+        tbl_evq_blk_t *nb = (tbl_evq_blk_t *)realloc(ix->b, (size_t)ncap * sizeof(*nb));
+        if (!nb) return 0;
+        ix->b = nb;
+        ix->cap = ncap;
+    }
+    ix->b[ix->n++] = *b;
+    return 1;
+}
+
+/* Load events.tsidx; anything that does not line up yields an empty index. */
+static void tbl_evq_idx_load(tbl_evq_idx_t *ix, const char *path, FILE *log, unsigned long log_size)
+{
+    FILE *fp;
+    char line[128];
+
+    ix->n = 0UL;
+    ix->covered = 0UL;
+    fp = fopen(path, "rb");
+    if (!fp) return;
+
+    while (fgets(line, (int)sizeof(line), fp) != 0) {
+        tbl_evq_blk_t b;
+        char *p = line;
+        char *end = 0;
+        unsigned long *f[4];
+        int k;
+
+        f[0] = &b.off;
+        f[1] = &b.len;
+        f[2] = &b.min_ts;
+        f[3] = &b.max_ts;
+        for (k = 0; k < 4; ++k) {
+            if (!(*p >= '0' && *p <= '9')) break;
+            *f[k] = strtoul(p, &end, 10);
+            if (!end || *end != (k < 3 ? ' ' : '\n')) break;
+            p = end + 1;
+        }
+        if (k < 4 || b.off != ix->covered || b.len == 0UL || b.off + b.len > log_size ||
+            !tbl_evq_idx_push(ix, &b)) {
+            ix->n = 0UL;
+            ix->covered = 0UL;
+            break;
+        }
+        ix->covered = b.off + b.len;
+    }
+    fclose(fp);
+
+    /* the covered range must still end on a line boundary */
+    if (ix->covered > 0UL) {
+        int c = EOF;
+        if (ix->covered - 1UL <= (unsigned long)LONG_MAX && fseek(log, (long)(ix->covered - 1UL), SEEK_SET) == 0) {
+            c = fgetc(log);
+        }
+        if (c != '\n') {
+            ix->n = 0UL;
+            ix->covered = 0UL;
+        }
+    }
+}
+
+typedef struct tbl_evq_sync_s {
+    tbl_evq_idx_t *ix;
+    tbl_evq_blk_t cur;   /* block being filled */
+    unsigned long lines;
+    int oom;
+} tbl_evq_sync_t;
+
+static int tbl_evq_sync_cb(void *ud, const char *line, size_t len, unsigned long off)
+{
+    tbl_evq_sync_t *s = (tbl_evq_sync_t *)ud;
+    unsigned long ts;
+
+    if (s->lines == 0UL) {
+        s->cur.off = off;
+        s->cur.len = 0UL;
+        s->cur.min_ts = TBL_EVQ_TS_NONE;
+        s->cur.max_ts = 0UL;
+    }
+    s->cur.len += (unsigned long)len;
+    if (tbl_evq_line_ts(line, len, &ts)) {
+        if (ts < s->cur.min_ts) s->cur.min_ts = ts;
+        if (ts > s->cur.max_ts) s->cur.max_ts = ts;
+    }
+    if (++s->lines == TBL_EVQ_BLOCK_LINES) {
+        if (!tbl_evq_idx_push(s->ix, &s->cur)) {
+            s->oom = 1;
+            return 1;
+        }
+        s->ix->covered = s->cur.off + s->cur.len;
+        s->lines = 0UL;
+    }
+    return 0;
+}
+
+static int tbl_evq_idx_line(char *out, size_t outsz, const tbl_evq_blk_t *b)
+{
+    char nbuf[32];
+
+    out[0] = '\0';
+    if (!tbl_ul_to_dec_ok(b->off, nbuf, sizeof(nbuf)) || !tbl_strlcat_ok(out, nbuf, outsz)) return 0;
+    if (!tbl_ul_to_dec_ok(b->len, nbuf, sizeof(nbuf)) || !tbl_strlcat_ok(out, " ", outsz) || !tbl_strlcat_ok(out, nbuf, outsz)) return 0;
+    if (!tbl_ul_to_dec_ok(b->min_ts, nbuf, sizeof(nbuf)) || !tbl_strlcat_ok(out, " ", outsz) || !tbl_strlcat_ok(out, nbuf, outsz)) return 0;
+    if (!tbl_ul_to_dec_ok(b->max_ts, nbuf, sizeof(nbuf)) || !tbl_strlcat_ok(out, " ", outsz) || !tbl_strlcat_ok(out, nbuf, outsz)) return 0;
+    return tbl_strlcat_ok(out, "\n", outsz);
+}
+
+/* Store blocks [from, n): append, or rewrite the file when from == 0
+   (best effort: a read-only repo still gets its answer). */
+static void tbl_evq_idx_store(const tbl_evq_idx_t *ix, unsigned long from, const char *path)
+{
+    char tmp[1100];
+    char line[128];
+    FILE *fp;
+    unsigned long i;
+    int ok;
+
+    if (from >= ix->n) return;
+    if (from == 0UL) {
+        if (!tbl_strlcpy_ok(tmp, path, sizeof(tmp)) || !tbl_strlcat_ok(tmp, ".tmp", sizeof(tmp))) return;
+        fp = fopen(tmp, "wb");
+    } else {
+        fp = fopen(path, "ab");
+    }
+    if (!fp) return;
+
+    ok = 1;
+    for (i = from; i < ix->n && ok; ++i) {
+        ok = tbl_evq_idx_line(line, sizeof(line), &ix->b[i]) && fputs(line, fp) != EOF;
+    }
+    if (fclose(fp) != 0) ok = 0;
+    if (from == 0UL) {
+        if (ok) (void)tbl_fs_rename_atomic(tmp, path, 1);
+        else (void)tbl_fs_remove_file(tmp);
+    }
+}
+
+/* ---- query ---- */
+
+typedef struct tbl_evq_ctx_s {
+    const tbl_evq_t *q;
+    tbl_evq_line_fn fn;
+    void *ud;
+    int stopped;
+} tbl_evq_ctx_t;
+
+static int tbl_evq_scan_cb(void *ud, const char *line, size_t len, unsigned long off)
+{
+    tbl_evq_ctx_t *c = (tbl_evq_ctx_t *)ud;
+
+    (void)off;
+    if (!tbl_evq_match_ok(c->q, line, len)) return 0;
+    if (c->fn(c->ud, line, len) != 0) {
+        c->stopped = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int tbl_evq_job_cb(void *ud, const char *line, size_t len)
+{
+    return tbl_evq_scan_cb(ud, line, len, 0UL);
+}
+
+int tbl_evq_run(const char *repo_root, const tbl_evq_t *q, tbl_evq_line_fn fn, void *ud,
+                unsigned long *out_scanned, char *err, size_t errsz)
+{
+    char legacy[1024];
+    char idx_path[1024];
+    tbl_evq_ctx_t ctx;
+    tbl_evq_idx_t ix;
+    tbl_evq_sync_t sy;
+    FILE *fp;
+    char *buf;
+    long sz;
+    unsigned long size;
+    unsigned long had;
+    unsigned long start;
+    unsigned long end;
+    unsigned long got;
+    int ok;
+
+    if (out_scanned) *out_scanned = 0UL;
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !q || !fn) {
+        tbl_evq_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+
+    ctx.q = q;
+    ctx.fn = fn;
+    ctx.ud = ud;
+    ctx.stopped = 0;
+
+    /* one job: its lines come straight from the job index */
+    if (q->job && q->job[0]) {
+        return tbl_evidx_each(repo_root, q->job, tbl_evq_job_cb, &ctx, out_scanned, err, errsz);
+    }
+
+    if (!tbl_path_join2(legacy, sizeof(legacy), repo_root, "events.log") ||
+        !tbl_path_join2(idx_path, sizeof(idx_path), repo_root, "events.tsidx")) {
+        tbl_evq_seterr(err, errsz, "events path too long");
+        return 2;
+    }
+
+    fp = fopen(legacy, "rb");
+    if (!fp) return 0;
+    sz = (fseek(fp, 0L, SEEK_END) == 0) ? ftell(fp) : -1L;
+    if (sz < 0L) {
+        fclose(fp);
+        tbl_evq_seterr(err, errsz, "cannot size events.log");
+        return 2;
+    }
+    size = (unsigned long)sz;
+
+    buf = (char *)malloc(TBL_EVQ_CHUNK);
+    if (!buf) {
+        fclose(fp);
+        tbl_evq_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+
+    (void)memset(&ix, 0, sizeof(ix));
+    tbl_evq_idx_load(&ix, idx_path, fp, size);
+    had = ix.n;
+
+    /* index the complete blocks written since the last query; the partial
+       block at the end only contributes its smallest ts */
+    (void)memset(&sy, 0, sizeof(sy));
+    sy.ix = &ix;
+    ok = tbl_evq_scan(fp, buf, ix.covered, size, tbl_evq_sync_cb, &sy, 0);
+    if (!ok || sy.oom) {
+        free(buf);
+        free(ix.b);
+        fclose(fp);
+        tbl_evq_seterr(err, errsz, sy.oom ? "out of memory" : "events.log read error");
+        return 2;
+    }
+    ix.rem_min = (sy.lines > 0UL) ? sy.cur.min_ts : TBL_EVQ_TS_NONE;
+    tbl_evq_idx_store(&ix, had, idx_path);
+
+    /* byte range the time filter can match */
+    start = 0UL;
+    end = size;
+    if (q->since_set) {
+        unsigned long i;
+        unsigned long run_max = 0UL;
+
+        start = ix.covered;
+        for (i = 0UL; i < ix.n; ++i) {
+            if (ix.b[i].max_ts > run_max) run_max = ix.b[i].max_ts;
+            if (run_max >= q->since) { start = ix.b[i].off; break; }
+        }
+    }
+    if (q->until_set) {
+        unsigned long i;
+        unsigned long suf_min = ix.rem_min;
+
+        if (suf_min >= q->until) end = ix.covered;
+        for (i = ix.n; i > 0UL; --i) {
+            if (ix.b[i - 1UL].min_ts < suf_min) suf_min = ix.b[i - 1UL].min_ts;
+            if (suf_min < q->until) break;
+            end = ix.b[i - 1UL].off;
+        }
+        if (end < start) end = start;
+    }
+
+    ok = tbl_evq_scan(fp, buf, start, end, tbl_evq_scan_cb, &ctx, &got);
+    if (out_scanned) *out_scanned = got;
+
+    free(buf);
+    free(ix.b);
+    fclose(fp);
+    if (!ok) {
+        tbl_evq_seterr(err, errsz, "events.log read error");
+        return 2;
+    }
+    return 0;
+}
+
+/* ---- follow ---- */
+
+static int tbl_evq_cursor_path(char *out, size_t outsz, const char *repo_root, const char *name)
+{
+    char dir[1024];
+    size_t i;
+    size_t n;
+
+    if (!repo_root || !repo_root[0] || !name) return 0;
+    n = strlen(name);
+    if (n == 0 || n > 64U || name[0] == '.') return 0;
+    for (i = 0; i < n; ++i) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '.' || c == '_' || c == '-')) {
+            return 0;
+        }
+    }
+    return tbl_path_join2(dir, sizeof(dir), repo_root, "cursors") &&
+           tbl_path_join2(out, outsz, dir, name);
+}
+
+int tbl_evq_cursor_load(const char *repo_root, const char *name, unsigned long *out_off, int *out_found,
+                        char *err, size_t errsz)
+{
+    char path[1100];
+    char line[64];
+    FILE *fp;
+    size_t n;
+
+    if (out_off) *out_off = 0UL;
+    if (out_found) *out_found = 0;
+    if (err && errsz) err[0] = '\0';
+    if (!out_off || !out_found || !tbl_evq_cursor_path(path, sizeof(path), repo_root, name)) {
+        tbl_evq_seterr(err, errsz, "invalid cursor name");
+        return 2;
+    }
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+    n = fread(line, 1, sizeof(line) - 1U, fp);
+    fclose(fp);
+    line[n] = '\0';
+    if (n < 9U || strncmp(line, "offset=", 7) != 0 || line[n - 1U] != '\n') {
+        tbl_evq_seterr(err, errsz, "cursor file is damaged");
+        return 2;
+    }
+    line[n - 1U] = '\0';
+    if (!tbl_parse_u32_ok(line + 7, out_off)) {
+        tbl_evq_seterr(err, errsz, "cursor file is damaged");
+        return 2;
+    }
+    *out_found = 1;
+    return 0;
+}
+
+int tbl_evq_cursor_store(const char *repo_root, const char *name, unsigned long off, char *err, size_t errsz)
+{
+    char path[1100];
+    char tmp[1100];
+    char dir[1024];
+    char line[64];
+    char nbuf[32];
+    tbl_fs_afile_t af;
+    int ok;
+
+    if (err && errsz) err[0] = '\0';
+    if (!tbl_evq_cursor_path(path, sizeof(path), repo_root, name)) {
+        tbl_evq_seterr(err, errsz, "invalid cursor name");
+        return 2;
+    }
+    if (!tbl_path_join2(dir, sizeof(dir), repo_root, "cursors") || tbl_fs_mkdir_p(dir) != 0) {
+        tbl_evq_seterr(err, errsz, "cannot create cursors directory");
+        return 2;
+    }
+    if (!tbl_strlcpy_ok(tmp, path, sizeof(tmp)) || !tbl_strlcat_ok(tmp, ".tmp", sizeof(tmp)) ||
+        !tbl_ul_to_dec_ok(off, nbuf, sizeof(nbuf)) ||
+        !tbl_strlcpy_ok(line, "offset=", sizeof(line)) || !tbl_strlcat_ok(line, nbuf, sizeof(line)) ||
+        !tbl_strlcat_ok(line, "\n", sizeof(line))) {
+        tbl_evq_seterr(err, errsz, "cursor path too long");
+        return 2;
+    }
+
+    /* fresh temp file, synced, then swapped in */
+    (void)tbl_fs_remove_file(tmp);
+    if (tbl_fs_afile_open(&af, tmp) != 0) {
+        tbl_evq_seterr(err, errsz, "cannot write cursor");
+        return 2;
+    }
+    ok = (tbl_fs_afile_write(&af, line, strlen(line)) == 0 && tbl_fs_afile_sync(&af) == 0);
+    if (tbl_fs_afile_close(&af) != 0) ok = 0;
+    if (!ok || tbl_fs_rename_atomic(tmp, path, 1) != 0) {
+        (void)tbl_fs_remove_file(tmp);
+        tbl_evq_seterr(err, errsz, "cannot write cursor");
+        return 2;
+    }
+    return 0;
+}
+
+/* 1 if off is 0 or the byte before it is LF */
+static int tbl_evq_at_line_start(FILE *fp, unsigned long off)
+{
+    if (off == 0UL) return 1;
+    if (off - 1UL > (unsigned long)LONG_MAX || fseek(fp, (long)(off - 1UL), SEEK_SET) != 0) return 0;
+    return (fgetc(fp) == '\n') ? 1 : 0;
+}
+
+typedef struct tbl_evq_tail_s {
+    const tbl_evq_t *q;
+    tbl_evq_line_fn fn;
+    void *ud;
+    unsigned long next;  /* offset after the last complete line seen */
+    int stopped;
+} tbl_evq_tail_t;
+
+static int tbl_evq_tail_cb(void *ud, const char *line, size_t len, unsigned long off)
+{
+    tbl_evq_tail_t *t = (tbl_evq_tail_t *)ud;
+
+    t->next = off + (unsigned long)len;
+    if (t->q && !tbl_evq_match_ok(t->q, line, len)) return 0;
+    if (t->fn(t->ud, line, len) != 0) {
+        t->stopped = 1;
+        return 1;
+    }
+    return 0;
+}
+
+int tbl_evq_follow(const char *repo_root, const tbl_evq_t *q, const tbl_evq_follow_t *f,
+                   tbl_evq_line_fn fn, void *ud, unsigned long *out_off, char *err, size_t errsz)
+{
+    char legacy[1024];
+    tbl_evq_tail_t t;
+    tbl_watch_t w;
+    FILE *fp;
+    char *buf;
+    unsigned long pos;
+    unsigned long poll_ms;
+    int checked;
+    int rc;
+
+    if (out_off) *out_off = 0UL;
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !f || !fn) {
+        tbl_evq_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_path_join2(legacy, sizeof(legacy), repo_root, "events.log")) {
+        tbl_evq_seterr(err, errsz, "events path too long");
+        return 2;
+    }
+
+    pos = f->from;
+    if (f->cursor) {
+        unsigned long stored;
+        int found;
+
+        if (tbl_evq_cursor_load(repo_root, f->cursor, &stored, &found, err, errsz) != 0) return 2;
+        if (found) pos = stored;
+    }
+    poll_ms = f->poll_ms ? f->poll_ms : TBL_EVQ_POLL_MS;
+
+    buf = (char *)malloc(TBL_EVQ_CHUNK);
+    if (!buf) {
+        tbl_evq_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    if (f->follow) (void)tbl_watch_open(&w, repo_root, "events.log");
+
+    (void)memset(&t, 0, sizeof(t));
+    t.q = q;
+    t.fn = fn;
+    t.ud = ud;
+    fp = 0;
+    checked = 0;
+    rc = 0;
+    for (;;) {
+        unsigned long size;
+        long sz;
+
+        if (!fp) fp = fopen(legacy, "rb");
+        if (fp) {
+            sz = (fseek(fp, 0L, SEEK_END) == 0) ? ftell(fp) : -1L;
+            if (sz < 0L) {
+                tbl_evq_seterr(err, errsz, "cannot size events.log");
+                rc = 2;
+                break;
+            }
+            size = (unsigned long)sz;
+
+            if (!checked) {
+                if (pos == TBL_EVQ_FROM_END) {
+                    /* back up over a line still being written */
+                    pos = size;
+                    while (pos > 0UL && !tbl_evq_at_line_start(fp, pos)) pos--;
+                } else if (pos > size || !tbl_evq_at_line_start(fp, pos)) {
+                    tbl_evq_seterr(err, errsz, (pos > size) ? "offset beyond the end of events.log"
+                                                            : "offset is not at a line start");
+                    rc = 2;
+                    break;
+                }
+                checked = 1;
+            }
+            if (size < pos) {
+                tbl_evq_seterr(err, errsz, "events.log is shorter than the read position");
+                rc = 2;
+                break;
+            }
+
+            if (size > pos) {
+                t.next = pos;
+                if (!tbl_evq_scan(fp, buf, pos, size, tbl_evq_tail_cb, &t, 0)) {
+                    tbl_evq_seterr(err, errsz, "events.log read error");
+                    rc = 2;
+                    break;
+                }
+                if (t.next != pos) {
+                    pos = t.next;
+                    if (f->flush && f->flush(ud) != 0) {
+                        tbl_evq_seterr(err, errsz, "cannot deliver events");
+                        rc = 2;
+                        break;
+                    }
+                    if (f->cursor && tbl_evq_cursor_store(repo_root, f->cursor, pos, err, errsz) != 0) {
+                        rc = 2;
+                        break;
+                    }
+                }
+                if (t.stopped) break;
+            }
+        } else if (!checked) {
+            /* no log yet: it starts at 0 */
+            if (pos == TBL_EVQ_FROM_END) pos = 0UL;
+            if (pos != 0UL) {
+                tbl_evq_seterr(err, errsz, "offset beyond the end of events.log");
+                rc = 2;
+                break;
+            }
+            checked = 1;
+        }
+
+        if (!f->follow) break;
+        tbl_watch_wait(&w, poll_ms);
+    }
+
+    if (fp) fclose(fp);
+    if (f->follow) tbl_watch_close(&w);
+    free(buf);
+    if (out_off) *out_off = (pos == TBL_EVQ_FROM_END) ? 0UL : pos;
+    return rc;
+}
+
+#endif /* TBL_EVQUERY_IMPLEMENTATION */
+
+#endif /* TBL_CORE_EVQUERY_H */
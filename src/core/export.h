@@ -4,7 +4,7 @@
 #include <stddef.h>
 
 /* Export a job (DIP-light):
-   - reads <repo_root>/records/<jobid>.ini
+   - reads the record (index/records.idx, else the record store via tbl_record_read_repo)
    - locates CAS object by sha256
    - writes payload to <out_dir>/<payload>
    - copies record to <out_dir>/record.ini
@@ -26,6 +26,7 @@ int tbl_export_job(const char *repo_root,
 #include "core/path.h"
 #include "core/cas.h"
 #include "core/record.h"
+#include "core/recidx.h"
 #include "core/events.h"
 #include "core/sha256.h"
 #include "os/fs.h"
@@ -175,7 +176,6 @@ int tbl_export_job(const char *repo_root,
     char out_payload[1024];
     char out_record[1024];
     char out_manifest[1024];
-    char record_path[1024];
     char payload_sha[65];
     char record_sha[65];
     int rc;
@@ -193,7 +193,7 @@ int tbl_export_job(const char *repo_root,
         return 2;
     }
 
-    rc = tbl_record_read_repo(repo_root, jobid, &rec, err, errsz);
+    rc = tbl_recidx_read(repo_root, jobid, &rec, err, errsz);
     if (rc != 0) {
         (void)tbl_events_append(repo_root, "export.error", jobid, "error", "", err && err[0] ? err : "record read failed", 0, 0);
         return 2;
@@ -232,17 +232,12 @@ int tbl_export_job(const char *repo_root,
     }
 
     /* copy record file */
-    if (!tbl_record_path(repo_root, jobid, record_path, sizeof(record_path))) {
-        tbl_export_seterr(err, errsz, "record path too long");
-        return 2;
-    }
-
     if (!tbl_path_join2(out_record, sizeof(out_record), out_dir, "record.ini")) {
         tbl_export_seterr(err, errsz, "record output path too long");
         return 2;
     }
 
-    rc = tbl_export_copy_file(record_path, out_record, err, errsz);
+    rc = tbl_record_copy_to(repo_root, jobid, out_record, err, errsz);
     if (rc != 0) {
         (void)tbl_events_append(repo_root, "export.error", jobid, "error", rec.sha256, err && err[0] ? err : "copy record failed", 0, 0);
         return 2;
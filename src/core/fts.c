@@ -0,0 +1,2 @@
+#define TBL_FTS_IMPLEMENTATION
+#include "core/fts.h"
@@ -0,0 +1,1866 @@
+#ifndef TBL_CORE_FTS_H
+#define TBL_CORE_FTS_H
+
+#include <stddef.h>
+
+/* Full-text index over the records: record fields and text payloads.
+   - A document is a job: the tokens of its record fields job, status,
+     payload and reason (each also as "<field>:<token>") and, when the CAS
+     payload is UTF-8 text, those of its first TBL_FTS_TEXT_MAX bytes.
+   - Tokens are runs of ASCII letters and digits and of non-ASCII code
+     points outside the punctuation blocks; ASCII, Latin-1, Greek and
+     Cyrillic are lowercased. Invalid UTF-8 separates tokens, tokens longer
+     than TBL_FTS_TOKEN_MAX bytes are dropped.
+   - index/fts.<n>.seg   immutable segment, little-endian:
+       header (64 bytes)  "TBLFTS1\n", u32 ndocs, nterms, tokens, offsets
+                          of docs, jobs, terms and term text, file length,
+                          FNV-1a over header[0..40) + docs + jobs
+       postings           per term (doc delta, tf) varint pairs, the first
+                          delta absolute
+       docs               per document (ordered by job id): u32 job offset,
+                          u32 token count
+       jobs               NUL-terminated job ids
+       terms              per term (ordered bytewise): u32 text offset,
+                          u32 df, u32 postings offset, u32 postings length
+       term text          NUL-terminated terms
+   - index/fts.manifest  "next=<n>" and "seg=<n> <docs>" lines, oldest
+                         segment first, replaced atomically
+   - index/fts.lock      held by writers (add, merge, reset)
+   The index role feeds it from events.log (tbl_fts_update): it follows the
+   consumer cursor cursors/fts (core/evquery.h), collects the jobs of
+   ingest.ok, ingest-package.ok and ingest.fail lines and indexes their
+   current records as one new segment per batch of at most
+   TBL_FTS_BATCH_MAX jobs; the cursor moves once the segment is in the
+   manifest. Segments are then merged while the newest holds at least as
+   many documents as the one before it (as the secidx runs), which keeps
+   O(log n) of them; a merge keeps the newest version of every job.
+   A search binary-searches each segment's term table on disk, decodes only
+   the postings of the query terms and ranks the matches by BM25 (k1 1.2,
+   b 0.75); a document shadowed by a newer segment is skipped.
+*/
+
+#ifndef TBL_FTS_TEXT_MAX
+#define TBL_FTS_TEXT_MAX 4194304UL
+#endif
+
+#ifndef TBL_FTS_BATCH_MAX
+#define TBL_FTS_BATCH_MAX 4096UL
+#endif
+
+#define TBL_FTS_TOKEN_MAX 48
+#define TBL_FTS_TERM_MAX  64 /* token plus a field prefix */
+#define TBL_FTS_MAX_SEGS  32UL
+#define TBL_FTS_QTERMS    32
+#define TBL_FTS_QGROUPS   16
+
+/* Per-token callback: normalized token (not NUL-terminated), 0 = continue. */
+typedef int (*tbl_fts_tok_fn)(void *ud, const char *tok, size_t len);
+
+/* Call fn for every token of s[0..n). Returns 0, or fn's nonzero result. */
+int tbl_fts_tokenize(const char *s, size_t n, tbl_fts_tok_fn fn, void *ud);
+
+/* 1 if s[0..n) is UTF-8 text (no NUL, valid sequences); with cut set a
+   sequence cut off at the end is allowed. */
+int tbl_fts_text_ok(const unsigned char *s, size_t n, int cut);
+
+/* Query: terms ANDed within a group, groups ORed. */
+typedef struct tbl_fts_query_s {
+    unsigned long nterms;
+    char term[TBL_FTS_QTERMS][TBL_FTS_TERM_MAX + 1];
+    unsigned long ngroups;
+    unsigned long group[TBL_FTS_QGROUPS]; /* bit i: term i required */
+} tbl_fts_query_t;
+
+/* "invoice 2026 OR rechnung status:ok": words are ANDed, OR starts a new
+   group, AND is allowed; job:, status:, payload:, reason: restrict a word
+   to that field. Returns 1 ok, 0 empty or too many terms/groups. */
+int tbl_fts_query_parse_ok(tbl_fts_query_t *q, const char *text);
+
+typedef struct tbl_fts_hit_s {
+    char job[256];
+    unsigned long score; /* BM25 x 1000 */
+} tbl_fts_hit_t;
+
+/* Best k matches into hits[0..*out_n), highest score first (ties by job
+   id); out_total: all matches. No index yet means no matches.
+   Returns 0 ok, 2 error. */
+int tbl_fts_search(const char *repo_root, const tbl_fts_query_t *q, tbl_fts_hit_t *hits, unsigned long k,
+                   unsigned long *out_n, unsigned long *out_total, char *err, size_t errsz);
+
+/* Index the current records of jobs[0..n) as one new segment, then merge.
+   Jobs without a record are skipped. Returns 0 ok, 2 error. */
+int tbl_fts_add(const char *repo_root, const char *const *jobs, unsigned long n, unsigned long *out_docs,
+                char *err, size_t errsz);
+
+typedef struct tbl_fts_stats_s {
+    unsigned long docs;     /* documents written */
+    unsigned long batches;  /* segments added */
+    unsigned long segments; /* segments in the manifest afterwards */
+    unsigned long offset;   /* events.log offset reached */
+} tbl_fts_stats_t;
+
+/* Consume events.log from cursors/fts on (full: drop the index and start
+   at offset 0). With follow it waits for new events and only returns on
+   an error. Returns 0 ok, 2 error. */
+int tbl_fts_update(const char *repo_root, int full, int follow, tbl_fts_stats_t *st, char *err, size_t errsz);
+
+#ifdef TBL_FTS_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/cas.h"
+#include "core/evquery.h"
+#include "core/path.h"
+#include "core/record.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_FTS_HDR    64UL
+#define TBL_FTS_U32    0xffffffffUL
+#define TBL_FTS_BAD    0xffffffffUL /* invalid UTF-8 */
+#define TBL_FTS_CURSOR "fts"
+#define TBL_FTS_K1     1.2
+#define TBL_FTS_B      0.75
+
+typedef struct tbl_fts_paths_s {
+    char dir[1024];
+    char man[1024];
+    char mantmp[1024];
+    char lock[1024];
+} tbl_fts_paths_t;
+
+typedef struct tbl_fts_man_s {
+    unsigned long next;
+    unsigned long nsegs;
+    unsigned long seq[TBL_FTS_MAX_SEGS];
+    unsigned long n[TBL_FTS_MAX_SEGS];
+} tbl_fts_man_t;
+
+typedef struct tbl_fts_buf_s {
+    unsigned char *p;
+    unsigned long len;
+    unsigned long cap;
+} tbl_fts_buf_t;
+
+static void tbl_fts_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "full-text index error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_fts_paths(const char *repo_root, tbl_fts_paths_t *p)
+{
+    return tbl_path_join2(p->dir, sizeof(p->dir), repo_root, "index") &&
+           tbl_path_join2(p->man, sizeof(p->man), p->dir, "fts.manifest") &&
+           tbl_path_join2(p->mantmp, sizeof(p->mantmp), p->dir, "fts.manifest.tmp") &&
+           tbl_path_join2(p->lock, sizeof(p->lock), p->dir, "fts.lock");
+}
+
+/* index/fts.<seq>.seg (tmp: .seg.tmp) */
+static int tbl_fts_seg_path(const tbl_fts_paths_t *p, unsigned long seq, int tmp, char *out, size_t outsz)
+{
+    char name[64];
+    char nbuf[32];
+
+    if (!tbl_ul_to_dec_ok(seq, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcpy(name, "fts.", sizeof(name));
+    (void)tbl_strlcat(name, nbuf, sizeof(name));
+    (void)tbl_strlcat(name, tmp ? ".seg.tmp" : ".seg", sizeof(name));
+    return tbl_path_join2(out, outsz, p->dir, name);
+}
+
+static void tbl_fts_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+static unsigned long tbl_fts_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static unsigned long tbl_fts_fnv(unsigned long h, const void *data, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        h ^= (unsigned long)p[i];
+        h = (h * 16777619UL) & TBL_FTS_U32;
+    }
+    return h;
+}
+
+static int tbl_fts_buf_put(tbl_fts_buf_t *b, const void *data, unsigned long n)
+{
+    if (b->len + n < b->len) return 0;
+    if (b->len + n > b->cap) {
+        unsigned long cap = b->cap ? b->cap : 64UL;
+        void *p;
+
+        while (cap < b->len + n) {
+            if (cap * 2UL < cap) return 0;
+            cap *= 2UL;
+        }
+        p = realloc(b->p, (size_t)cap);
+        if (!p) return 0;
+        b->p = (unsigned char *)p;
+        b->cap = cap;
+    }
+    if (n > 0UL && data) (void)memcpy(b->p + b->len, data, (size_t)n); /* data NULL: reserve */
+    b->len += n;
+    return 1;
+}
+
+static int tbl_fts_buf_varint(tbl_fts_buf_t *b, unsigned long v)
+{
+    unsigned char tmp[8];
+    unsigned long n = 0UL;
+
+    v &= TBL_FTS_U32;
+    do {
+        tmp[n] = (unsigned char)(v & 0x7fUL);
+        v >>= 7;
+        if (v) tmp[n] |= 0x80;
+        n++;
+    } while (v);
+    return tbl_fts_buf_put(b, tmp, n);
+}
+
+static int tbl_fts_buf_u32(tbl_fts_buf_t *b, unsigned long v)
+{
+    unsigned char tmp[4];
+
+    tbl_fts_put32(tmp, v);
+    return tbl_fts_buf_put(b, tmp, 4UL);
+}
+
+/* Next LEB128 varint of p[*i..len). Returns 1/0. */
+static int tbl_fts_varint(const unsigned char *p, unsigned long len, unsigned long *i, unsigned long *out)
+{
+    unsigned long v = 0UL;
+    unsigned int shift = 0;
+
+    for (;;) {
+        if (*i >= len || shift > 28U) return 0;
+        v |= ((unsigned long)(p[*i] & 0x7f)) << shift;
+        shift += 7U;
+        if (!(p[(*i)++] & 0x80)) break;
+    }
+    *out = v & TBL_FTS_U32;
+    return 1;
+}
+
+/* ---- tokens ---- */
+
+/* code point at s[0..n), *adv bytes; TBL_FTS_BAD (adv 1) if invalid */
+static unsigned long tbl_fts_cp(const unsigned char *s, size_t n, size_t *adv)
+{
+    unsigned long cp;
+    size_t k;
+    size_t i;
+
+    *adv = 1;
+    if (s[0] < 0x80) return (unsigned long)s[0];
+    if (s[0] >= 0xc2 && s[0] <= 0xdf) {
+        k = 1;
+        cp = (unsigned long)(s[0] & 0x1f);
+    } else if (s[0] >= 0xe0 && s[0] <= 0xef) {
+        k = 2;
+        cp = (unsigned long)(s[0] & 0x0f);
+    } else if (s[0] >= 0xf0 && s[0] <= 0xf4) {
+        k = 3;
+        cp = (unsigned long)(s[0] & 0x07);
+    } else {
+        return TBL_FTS_BAD;
+    }
+    if (n <= k) return TBL_FTS_BAD;
+    for (i = 1; i <= k; ++i) {
+        if ((s[i] & 0xc0) != 0x80) return TBL_FTS_BAD;
+        cp = (cp << 6) | (unsigned long)(s[i] & 0x3f);
+    }
+    if ((k == 2 && cp < 0x800UL) || (k == 3 && (cp < 0x10000UL || cp > 0x10ffffUL)) ||
+        (cp >= 0xd800UL && cp <= 0xdfffUL)) {
+        return TBL_FTS_BAD;
+    }
+    *adv = k + 1;
+    return cp;
+}
+
+static int tbl_fts_word_cp(unsigned long cp)
+{
+    if (cp < 0x80UL) {
+        return (cp >= '0' && cp <= '9') || (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z');
+    }
+    if (cp < 0xc0UL) return cp == 0xaaUL || cp == 0xb5UL || cp == 0xbaUL; /* ª µ º */
+    if (cp == 0xd7UL || cp == 0xf7UL) return 0;                          /* × ÷ */
+    if (cp >= 0x2000UL && cp <= 0x206fUL) return 0;                      /* general punctuation */
+    if (cp >= 0x20a0UL && cp <= 0x20cfUL) return 0;                      /* currency signs */
+    if (cp >= 0x3000UL && cp <= 0x303fUL) return 0;                      /* CJK punctuation */
+    return cp != 0xfeffUL;
+}
+
+static unsigned long tbl_fts_lower(unsigned long cp)
+{
+    if (cp >= 'A' && cp <= 'Z') return cp + 32UL;
+    if (cp < 0xc0UL) return cp;
+    if (cp <= 0xdeUL && cp != 0xd7UL) return cp + 0x20UL;                 /* Latin-1 */
+    if (cp >= 0x391UL && cp <= 0x3a9UL && cp != 0x3a2UL) return cp + 0x20UL; /* Greek */
+    if (cp >= 0x410UL && cp <= 0x42fUL) return cp + 0x20UL;                /* Cyrillic */
+    if (cp >= 0x400UL && cp <= 0x40fUL) return cp + 0x50UL;
+    return cp;
+}
+
+static size_t tbl_fts_put_cp(char *out, unsigned long cp)
+{
+    if (cp < 0x80UL) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800UL) {
+        out[0] = (char)(0xc0UL | (cp >> 6));
+        out[1] = (char)(0x80UL | (cp & 0x3fUL));
+        return 2;
+    }
+    if (cp < 0x10000UL) {
+        out[0] = (char)(0xe0UL | (cp >> 12));
+        out[1] = (char)(0x80UL | ((cp >> 6) & 0x3fUL));
+        out[2] = (char)(0x80UL | (cp & 0x3fUL));
+        return 3;
+    }
+    out[0] = (char)(0xf0UL | (cp >> 18));
+    out[1] = (char)(0x80UL | ((cp >> 12) & 0x3fUL));
+    out[2] = (char)(0x80UL | ((cp >> 6) & 0x3fUL));
+    out[3] = (char)(0x80UL | (cp & 0x3fUL));
+    return 4;
+}
+
+int tbl_fts_tokenize(const char *s, size_t n, tbl_fts_tok_fn fn, void *ud)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    char tok[TBL_FTS_TOKEN_MAX + 4];
+    size_t tl = 0;
+    size_t i = 0;
+    size_t adv;
+    unsigned long cp;
+    int over = 0;
+    int rc;
+
+    if (!s || !fn) return 0;
+    if (n >= 3U && p[0] == 0xef && p[1] == 0xbb && p[2] == 0xbf) i = 3U; /* BOM */
+    for (;;) {
+        cp = TBL_FTS_BAD;
+        adv = 1;
+        if (i < n) {
+            if (p[i] < 0x80) cp = (unsigned long)p[i];
+            else cp = tbl_fts_cp(p + i, n - i, &adv);
+        }
+        if (cp != TBL_FTS_BAD && tbl_fts_word_cp(cp)) {
+            char enc[4];
+            size_t el = tbl_fts_put_cp(enc, tbl_fts_lower(cp));
+
+            if (tl + el > (size_t)TBL_FTS_TOKEN_MAX) {
+                over = 1;
+            } else if (!over) {
+                (void)memcpy(tok + tl, enc, el);
+                tl += el;
+            }
+        } else {
+            if (tl > 0U && !over) {
+                rc = fn(ud, tok, tl);
+                if (rc != 0) return rc;
+            }
+            tl = 0;
+            over = 0;
+            if (i >= n) break;
+        }
+        i += adv;
+    }
+    return 0;
+}
+
+int tbl_fts_text_ok(const unsigned char *s, size_t n, int cut)
+{
+    size_t i = 0;
+    size_t adv;
+
+    while (i < n) {
+        if (s[i] == 0) return 0;
+        if (s[i] < 0x80) {
+            i++;
+            continue;
+        }
+        if (tbl_fts_cp(s + i, n - i, &adv) == TBL_FTS_BAD) return (cut && n - i < 4U) ? 1 : 0;
+        i += adv;
+    }
+    return 1;
+}
+
+/* ---- manifest ---- */
+
+static int tbl_fts_ul(const char **s, unsigned long *out)
+{
+    unsigned long v = 0UL;
+    const char *p = *s;
+
+    if (*p < '0' || *p > '9') return 0;
+    while (*p >= '0' && *p <= '9') {
+        unsigned long d = (unsigned long)(*p - '0');
+        if (v > (TBL_FTS_U32 - d) / 10UL) return 0;
+        v = v * 10UL + d;
+        p++;
+    }
+    *out = v;
+    *s = p;
+    return 1;
+}
+
+/* A missing manifest is empty. Returns 1 ok, 0 damaged. */
+static int tbl_fts_man_read(const char *path, tbl_fts_man_t *man)
+{
+    char line[128];
+    FILE *fp;
+    int ok = 1;
+
+    (void)memset(man, 0, sizeof(*man));
+    man->next = 1UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+        const char *p = line;
+
+        if (strncmp(p, "next=", 5) == 0) {
+            p += 5;
+            if (!tbl_fts_ul(&p, &man->next) || *p != '\n') ok = 0;
+        } else if (strncmp(p, "seg=", 4) == 0) {
+            p += 4;
+            if (man->nsegs == TBL_FTS_MAX_SEGS || !tbl_fts_ul(&p, &man->seq[man->nsegs]) || *p++ != ' ' ||
+                !tbl_fts_ul(&p, &man->n[man->nsegs]) || *p != '\n') {
+                ok = 0;
+            } else {
+                man->nsegs++;
+            }
+        } else {
+            ok = 0;
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+static int tbl_fts_man_write(const tbl_fts_paths_t *p, const tbl_fts_man_t *man)
+{
+    char nbuf[32];
+    FILE *fp;
+    unsigned long i;
+    int ok;
+
+    fp = fopen(p->mantmp, "wb");
+    if (!fp) return 0;
+    ok = tbl_ul_to_dec_ok(man->next, nbuf, sizeof(nbuf)) && tbl_fputs3_ok(fp, "next=", nbuf, "\n");
+    for (i = 0UL; ok && i < man->nsegs; ++i) {
+        ok = tbl_ul_to_dec_ok(man->seq[i], nbuf, sizeof(nbuf)) && tbl_fputs3_ok(fp, "seg=", nbuf, " ") &&
+             tbl_ul_to_dec_ok(man->n[i], nbuf, sizeof(nbuf)) && tbl_fputs2_ok(fp, nbuf, "\n");
+    }
+    if (fclose(fp) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(p->mantmp, p->man, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(p->mantmp);
+    return ok;
+}
+
+static int tbl_fts_lock(const tbl_fts_paths_t *p, tbl_fs_lock_t *lk, char *err, size_t errsz)
+{
+    if (tbl_fs_mkdir_p(p->dir) != 0) {
+        tbl_fts_seterr(err, errsz, "cannot create index dir");
+        return 0;
+    }
+    if (tbl_fs_lock_open(lk, p->lock) != 0) {
+        tbl_fts_seterr(err, errsz, "cannot open fts.lock");
+        return 0;
+    }
+    if (tbl_fs_lock_acquire(lk) != 0) {
+        (void)tbl_fs_lock_close(lk);
+        tbl_fts_seterr(err, errsz, "cannot lock fts.lock");
+        return 0;
+    }
+    return 1;
+}
+
+/* ---- segment writer ---- */
+
+typedef struct tbl_fts_w_s {
+    FILE *fp;
+    unsigned long off;
+    unsigned long nterms;
+    tbl_fts_buf_t terms;
+    tbl_fts_buf_t text;
+    int ok;
+} tbl_fts_w_t;
+
+static int tbl_fts_w_open(tbl_fts_w_t *w, const char *path)
+{
+    static const unsigned char zero[TBL_FTS_HDR];
+
+    (void)memset(w, 0, sizeof(*w));
+    w->fp = fopen(path, "wb");
+    if (!w->fp) return 0;
+    w->ok = (fwrite(zero, 1, sizeof(zero), w->fp) == sizeof(zero)) ? 1 : 0;
+    w->off = TBL_FTS_HDR;
+    return w->ok;
+}
+
+/* terms in ascending byte order; post holds df encoded postings */
+static void tbl_fts_w_term(tbl_fts_w_t *w, const char *term, size_t tl, unsigned long df,
+                           const unsigned char *post, unsigned long plen)
+{
+    if (!w->ok) return;
+    if (w->off + plen < w->off || w->off + plen > TBL_FTS_U32 ||
+        (plen > 0UL && fwrite(post, 1, (size_t)plen, w->fp) != (size_t)plen) ||
+        !tbl_fts_buf_u32(&w->terms, w->text.len) || !tbl_fts_buf_u32(&w->terms, df) ||
+        !tbl_fts_buf_u32(&w->terms, w->off) || !tbl_fts_buf_u32(&w->terms, plen) ||
+        !tbl_fts_buf_put(&w->text, term, (unsigned long)tl) || !tbl_fts_buf_put(&w->text, "", 1UL)) {
+        w->ok = 0;
+        return;
+    }
+    w->off += plen;
+    w->nterms++;
+}
+
+/* docs, jobs, terms, header; closes the file. Returns 1/0. */
+static int tbl_fts_w_finish(tbl_fts_w_t *w, const char *const *jobs, const unsigned long *lens,
+                            unsigned long ndocs, unsigned long tokens)
+{
+    unsigned char h[TBL_FTS_HDR];
+    unsigned char ent[8];
+    unsigned long jobs_len = 0UL;
+    unsigned long jo = 0UL;
+    unsigned long fnv;
+    unsigned long i;
+    int ok = w->ok;
+
+    for (i = 0UL; i < ndocs; ++i) jobs_len += (unsigned long)strlen(jobs[i]) + 1UL;
+    (void)memset(h, 0, sizeof(h));
+    (void)memcpy(h, "TBLFTS1\n", 8U);
+    tbl_fts_put32(h + 8, ndocs);
+    tbl_fts_put32(h + 12, w->nterms);
+    tbl_fts_put32(h + 16, tokens & TBL_FTS_U32);
+    tbl_fts_put32(h + 20, w->off);
+    tbl_fts_put32(h + 24, w->off + ndocs * 8UL);
+    tbl_fts_put32(h + 28, w->off + ndocs * 8UL + jobs_len);
+    tbl_fts_put32(h + 32, w->off + ndocs * 8UL + jobs_len + w->terms.len);
+    tbl_fts_put32(h + 36, w->off + ndocs * 8UL + jobs_len + w->terms.len + w->text.len);
+    if (ndocs > TBL_FTS_U32 / 16UL || w->off + ndocs * 8UL + jobs_len + w->terms.len + w->text.len > TBL_FTS_U32) {
+        ok = 0;
+    }
+    fnv = tbl_fts_fnv(2166136261UL, h, 40U);
+    for (i = 0UL; ok && i < ndocs; ++i) {
+        tbl_fts_put32(ent, jo);
+        tbl_fts_put32(ent + 4, lens[i]);
+        jo += (unsigned long)strlen(jobs[i]) + 1UL;
+        fnv = tbl_fts_fnv(fnv, ent, 8U);
+        if (fwrite(ent, 1, 8U, w->fp) != 8U) ok = 0;
+    }
+    for (i = 0UL; ok && i < ndocs; ++i) {
+        size_t l = strlen(jobs[i]) + 1U;
+
+        fnv = tbl_fts_fnv(fnv, jobs[i], l);
+        if (fwrite(jobs[i], 1, l, w->fp) != l) ok = 0;
+    }
+    tbl_fts_put32(h + 40, fnv);
+    if (ok && w->terms.len > 0UL && fwrite(w->terms.p, 1, (size_t)w->terms.len, w->fp) != (size_t)w->terms.len) ok = 0;
+    if (ok && w->text.len > 0UL && fwrite(w->text.p, 1, (size_t)w->text.len, w->fp) != (size_t)w->text.len) ok = 0;
+    if (ok && (fseek(w->fp, 0L, SEEK_SET) != 0 || fwrite(h, 1, sizeof(h), w->fp) != sizeof(h))) ok = 0;
+    if (fclose(w->fp) != 0) ok = 0;
+    w->fp = 0;
+    free(w->terms.p);
+    free(w->text.p);
+    return ok;
+}
+
+static void tbl_fts_w_abort(tbl_fts_w_t *w, const char *path)
+{
+    if (w->fp) fclose(w->fp);
+    w->fp = 0;
+    free(w->terms.p);
+    free(w->text.p);
+    w->terms.p = 0;
+    w->text.p = 0;
+    (void)tbl_fs_remove_file(path);
+}
+
+/* ---- segment reader ---- */
+
+typedef struct tbl_fts_seg_s {
+    FILE *fp;
+    unsigned long ndocs;
+    unsigned long nterms;
+    unsigned long tokens;
+    unsigned long docs_off;
+    unsigned long jobs_off;
+    unsigned long terms_off;
+    unsigned long text_off;
+    unsigned long file_len;
+    unsigned char *docs;  /* docs + jobs, loaded */
+    const char *jobs;
+    unsigned char *terms; /* terms + term text, loaded for merges only */
+    const char *text;
+} tbl_fts_seg_t;
+
+static int tbl_fts_pread_ok(FILE *fp, unsigned long off, void *buf, size_t n)
+{
+    if (off > 0x7fffffffUL || fseek(fp, (long)off, SEEK_SET) != 0) return 0;
+    return n == 0U || fread(buf, 1, n, fp) == n;
+}
+
+static void tbl_fts_seg_close(tbl_fts_seg_t *s)
+{
+    if (s->fp) fclose(s->fp);
+    free(s->docs);
+    free(s->terms);
+    (void)memset(s, 0, sizeof(*s));
+}
+
+/* Returns 0 ok, 1 missing, 2 damaged. */
+static int tbl_fts_seg_open(tbl_fts_seg_t *s, const char *path)
+{
+    unsigned char h[TBL_FTS_HDR];
+    unsigned long len;
+    unsigned long i;
+    long sz;
+
+    (void)memset(s, 0, sizeof(*s));
+    s->fp = fopen(path, "rb");
+    if (!s->fp) return 1;
+    if (!tbl_fts_pread_ok(s->fp, 0UL, h, sizeof(h)) || memcmp(h, "TBLFTS1\n", 8U) != 0) goto bad;
+    s->ndocs = tbl_fts_get32(h + 8);
+    s->nterms = tbl_fts_get32(h + 12);
+    s->tokens = tbl_fts_get32(h + 16);
+    s->docs_off = tbl_fts_get32(h + 20);
+    s->jobs_off = tbl_fts_get32(h + 24);
+    s->terms_off = tbl_fts_get32(h + 28);
+    s->text_off = tbl_fts_get32(h + 32);
+    s->file_len = tbl_fts_get32(h + 36);
+    if (s->docs_off < TBL_FTS_HDR || s->ndocs > TBL_FTS_U32 / 16UL || s->nterms > TBL_FTS_U32 / 16UL ||
+        s->jobs_off - s->docs_off != s->ndocs * 8UL || s->jobs_off > s->terms_off ||
+        s->text_off < s->terms_off || s->text_off - s->terms_off != s->nterms * 16UL ||
+        s->file_len < s->text_off || (s->ndocs > 0UL && s->terms_off == s->jobs_off) ||
+        (s->nterms > 0UL && s->file_len == s->text_off)) {
+        goto bad;
+    }
+    sz = (fseek(s->fp, 0L, SEEK_END) == 0) ? ftell(s->fp) : -1L;
+    if (sz < 0L || (unsigned long)sz != s->file_len) goto bad;
+    len = s->terms_off - s->docs_off;
+    s->docs = (unsigned char *)malloc((size_t)(len ? len : 1UL));
+    if (!s->docs || !tbl_fts_pread_ok(s->fp, s->docs_off, s->docs, (size_t)len)) goto bad;
+    if (tbl_fts_fnv(tbl_fts_fnv(2166136261UL, h, 40U), s->docs, (size_t)len) != tbl_fts_get32(h + 40)) goto bad;
+    s->jobs = (const char *)s->docs + s->ndocs * 8UL;
+    len = s->terms_off - s->jobs_off;
+    if (len > 0UL && s->jobs[len - 1UL] != '\0') goto bad;
+    for (i = 0UL; i < s->ndocs; ++i) {
+        if (tbl_fts_get32(s->docs + i * 8UL) >= len) goto bad;
+    }
+    return 0;
+bad:
+    tbl_fts_seg_close(s);
+    return 2;
+}
+
+static const char *tbl_fts_seg_job(const tbl_fts_seg_t *s, unsigned long d)
+{
+    return s->jobs + tbl_fts_get32(s->docs + d * 8UL);
+}
+
+static unsigned long tbl_fts_seg_len(const tbl_fts_seg_t *s, unsigned long d)
+{
+    return tbl_fts_get32(s->docs + d * 8UL + 4UL);
+}
+
+/* 1 if job is a document of s */
+static int tbl_fts_seg_has(const tbl_fts_seg_t *s, const char *job)
+{
+    unsigned long lo = 0UL;
+    unsigned long hi = s->ndocs;
+
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        int c = strcmp(tbl_fts_seg_job(s, mid), job);
+
+        if (c == 0) return 1;
+        if (c < 0) lo = mid + 1UL;
+        else hi = mid;
+    }
+    return 0;
+}
+
+static int tbl_fts_ent_ok(const tbl_fts_seg_t *s, unsigned long df, unsigned long poff, unsigned long plen)
+{
+    return df > 0UL && df <= s->ndocs && poff >= TBL_FTS_HDR && poff <= s->docs_off && plen <= s->docs_off - poff &&
+           plen >= 2UL * df;
+}
+
+/* Term lookup by binary search on disk. Returns 1 found, 0 not, -1 error. */
+static int tbl_fts_seg_term(const tbl_fts_seg_t *s, const char *term, unsigned long *df, unsigned long *poff,
+                            unsigned long *plen)
+{
+    unsigned char ent[16];
+    char buf[TBL_FTS_TERM_MAX + 2];
+    unsigned long lo = 0UL;
+    unsigned long hi = s->nterms;
+    unsigned long tlen = s->file_len - s->text_off;
+
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        unsigned long to;
+        size_t n;
+        int c;
+
+        if (!tbl_fts_pread_ok(s->fp, s->terms_off + mid * 16UL, ent, sizeof(ent))) return -1;
+        to = tbl_fts_get32(ent);
+        if (to >= tlen) return -1;
+        n = (size_t)((tlen - to < (unsigned long)sizeof(buf) - 1UL) ? tlen - to : (unsigned long)sizeof(buf) - 1UL);
+        if (!tbl_fts_pread_ok(s->fp, s->text_off + to, buf, n)) return -1;
+        buf[n] = '\0';
+        c = strcmp(buf, term);
+        if (c == 0) {
+            *df = tbl_fts_get32(ent + 4);
+            *poff = tbl_fts_get32(ent + 8);
+            *plen = tbl_fts_get32(ent + 12);
+            return tbl_fts_ent_ok(s, *df, *poff, *plen) ? 1 : -1;
+        }
+        if (c < 0) lo = mid + 1UL;
+        else hi = mid;
+    }
+    return 0;
+}
+
+/* Read and decode one posting list (df pairs). Returns 1/0. */
+static int tbl_fts_seg_post(const tbl_fts_seg_t *s, unsigned long df, unsigned long poff, unsigned long plen,
+                            tbl_fts_buf_t *scratch, unsigned long *docs, unsigned long *tfs)
+{
+    unsigned long i = 0UL;
+    unsigned long j;
+    unsigned long d = 0UL;
+
+    scratch->len = 0UL;
+    if (!tbl_fts_buf_put(scratch, 0, plen) || !tbl_fts_pread_ok(s->fp, poff, scratch->p, (size_t)plen)) return 0;
+    for (j = 0UL; j < df; ++j) {
+        unsigned long dl;
+
+        if (!tbl_fts_varint(scratch->p, plen, &i, &dl) || !tbl_fts_varint(scratch->p, plen, &i, &tfs[j])) return 0;
+        if (j > 0UL && dl == 0UL) return 0;
+        d = (j == 0UL) ? dl : d + dl;
+        if (d >= s->ndocs || tfs[j] == 0UL) return 0;
+        docs[j] = d;
+    }
+    return i == plen;
+}
+
+/* terms table and text into memory (merges) */
+static int tbl_fts_seg_load_terms(tbl_fts_seg_t *s)
+{
+    unsigned long len = s->file_len - s->terms_off;
+    unsigned long tlen = s->file_len - s->text_off;
+    unsigned long i;
+
+    s->terms = (unsigned char *)malloc((size_t)(len ? len : 1UL));
+    if (!s->terms || !tbl_fts_pread_ok(s->fp, s->terms_off, s->terms, (size_t)len)) return 0;
+    s->text = (const char *)s->terms + s->nterms * 16UL;
+    if (tlen > 0UL && s->text[tlen - 1UL] != '\0') return 0;
+    for (i = 0UL; i < s->nterms; ++i) {
+        const unsigned char *e = s->terms + i * 16UL;
+
+        if (tbl_fts_get32(e) >= tlen ||
+            !tbl_fts_ent_ok(s, tbl_fts_get32(e + 4), tbl_fts_get32(e + 8), tbl_fts_get32(e + 12))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ---- merge ---- */
+
+typedef struct tbl_fts_pair_s {
+    unsigned long doc;
+    unsigned long tf;
+} tbl_fts_pair_t;
+
+static int tbl_fts_cmp_pair(const void *a, const void *b)
+{
+    unsigned long x = ((const tbl_fts_pair_t *)a)->doc;
+    unsigned long y = ((const tbl_fts_pair_t *)b)->doc;
+
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/* segments man[from..] (oldest first) -> one segment <seq>; the newest
+   version of a job wins. *out_n: documents. */
+static int tbl_fts_merge(const tbl_fts_paths_t *p, const tbl_fts_man_t *man, unsigned long from, unsigned long seq,
+                         unsigned long *out_n)
+{
+    tbl_fts_seg_t segs[TBL_FTS_MAX_SEGS];
+    unsigned long *map[TBL_FTS_MAX_SEGS];
+    unsigned long dpos[TBL_FTS_MAX_SEGS];
+    unsigned long tpos[TBL_FTS_MAX_SEGS];
+    unsigned long k = man->nsegs - from;
+    const char **jobs = 0;
+    unsigned long *lens = 0;
+    unsigned long ndocs = 0UL;
+    unsigned long tokens = 0UL;
+    unsigned long cap = 0UL;
+    unsigned long *docs = 0;
+    unsigned long *tfs = 0;
+    unsigned long dcap = 0UL;
+    tbl_fts_pair_t *pairs = 0;
+    unsigned long pcap = 0UL;
+    tbl_fts_buf_t scratch;
+    tbl_fts_buf_t out;
+    tbl_fts_w_t w;
+    char path[1100];
+    char dst[1100];
+    unsigned long i;
+    int ok = 1;
+
+    (void)memset(&w, 0, sizeof(w));
+    (void)memset(&scratch, 0, sizeof(scratch));
+    (void)memset(&out, 0, sizeof(out));
+    for (i = 0UL; i < k; ++i) {
+        (void)memset(&segs[i], 0, sizeof(segs[i]));
+        map[i] = 0;
+        dpos[i] = 0UL;
+        tpos[i] = 0UL;
+    }
+    for (i = 0UL; ok && i < k; ++i) {
+        if (!tbl_fts_seg_path(p, man->seq[from + i], 0, path, sizeof(path)) ||
+            tbl_fts_seg_open(&segs[i], path) != 0 || !tbl_fts_seg_load_terms(&segs[i])) {
+            ok = 0;
+        } else {
+            cap += segs[i].ndocs;
+            map[i] = (unsigned long *)malloc((size_t)(segs[i].ndocs ? segs[i].ndocs : 1UL) * sizeof(unsigned long));
+            if (!map[i]) ok = 0;
+        }
+    }
+    if (ok) {
+        jobs = (const char **)malloc((size_t)(cap ? cap : 1UL) * sizeof(const char *));
+        lens = (unsigned long *)malloc((size_t)(cap ? cap : 1UL) * sizeof(unsigned long));
+        if (!jobs || !lens) ok = 0;
+    }
+
+    /* documents: k-way merge by job id, the newest segment wins */
+    while (ok) {
+        const char *best = 0;
+        unsigned long win = 0UL;
+
+        for (i = 0UL; i < k; ++i) {
+            if (dpos[i] < segs[i].ndocs) {
+                const char *j = tbl_fts_seg_job(&segs[i], dpos[i]);
+                if (!best || strcmp(j, best) <= 0) {
+                    best = j;
+                    win = i;
+                }
+            }
+        }
+        if (!best) break;
+        for (i = 0UL; i < k; ++i) {
+            if (dpos[i] < segs[i].ndocs && strcmp(tbl_fts_seg_job(&segs[i], dpos[i]), best) == 0) {
+                map[i][dpos[i]] = (i == win) ? ndocs : TBL_FTS_U32;
+                if (i != win) dpos[i]++;
+            }
+        }
+        jobs[ndocs] = best;
+        lens[ndocs] = tbl_fts_seg_len(&segs[win], dpos[win]);
+        tokens += lens[ndocs];
+        ndocs++;
+        dpos[win]++;
+    }
+
+    if (ok && (!tbl_fts_seg_path(p, seq, 1, path, sizeof(path)) || !tbl_fts_seg_path(p, seq, 0, dst, sizeof(dst)) ||
+               !tbl_fts_w_open(&w, path))) {
+        tbl_fts_w_abort(&w, path);
+        ok = 0;
+    }
+
+    /* terms: k-way merge, postings remapped and concatenated in doc order */
+    while (ok) {
+        const char *best = 0;
+        unsigned long np = 0UL;
+        unsigned long prev = 0UL;
+        int sorted = 1;
+
+        for (i = 0UL; i < k; ++i) {
+            if (tpos[i] < segs[i].nterms) {
+                const char *t = segs[i].text + tbl_fts_get32(segs[i].terms + tpos[i] * 16UL);
+                if (!best || strcmp(t, best) < 0) best = t;
+            }
+        }
+        if (!best) break;
+        for (i = 0UL; ok && i < k; ++i) {
+            const unsigned char *e;
+            unsigned long df;
+            unsigned long j;
+
+            if (tpos[i] >= segs[i].nterms) continue;
+            e = segs[i].terms + tpos[i] * 16UL;
+            if (strcmp(segs[i].text + tbl_fts_get32(e), best) != 0) continue;
+            df = tbl_fts_get32(e + 4);
+            if (df > dcap) {
+                free(docs);
+                free(tfs);
+                dcap = df;
+                docs = (unsigned long *)malloc((size_t)dcap * sizeof(unsigned long));
+                tfs = (unsigned long *)malloc((size_t)dcap * sizeof(unsigned long));
+            }
+            if (np + df > pcap) {
+                void *q;
+                pcap = (np + df) * 2UL;
+                q = realloc(pairs, (size_t)pcap * sizeof(tbl_fts_pair_t));
+                if (!q) {
+                    ok = 0;
+                    break;
+                }
+                pairs = (tbl_fts_pair_t *)q;
+            }
+            if (!docs || !tfs ||
+                !tbl_fts_seg_post(&segs[i], df, tbl_fts_get32(e + 8), tbl_fts_get32(e + 12), &scratch, docs, tfs)) {
+                ok = 0;
+                break;
+            }
+            for (j = 0UL; j < df; ++j) {
+                unsigned long nd = map[i][docs[j]];
+
+                if (nd == TBL_FTS_U32) continue;
+                if (np > 0UL && nd < prev) sorted = 0;
+                prev = nd;
+                pairs[np].doc = nd;
+                pairs[np].tf = tfs[j];
+                np++;
+            }
+            tpos[i]++;
+        }
+        if (!ok) break;
+        if (np == 0UL) continue;
+        if (!sorted) qsort(pairs, (size_t)np, sizeof(pairs[0]), tbl_fts_cmp_pair);
+        out.len = 0UL;
+        for (i = 0UL; ok && i < np; ++i) {
+            ok = tbl_fts_buf_varint(&out, (i == 0UL) ? pairs[i].doc : pairs[i].doc - pairs[i - 1UL].doc) &&
+                 tbl_fts_buf_varint(&out, pairs[i].tf);
+        }
+        if (ok) tbl_fts_w_term(&w, best, strlen(best), np, out.p, out.len);
+    }
+    if (w.fp) {
+        if (ok && tbl_fts_w_finish(&w, jobs, lens, ndocs, tokens) && tbl_fs_rename_atomic(path, dst, 1) == 0) {
+            *out_n = ndocs;
+        } else {
+            tbl_fts_w_abort(&w, path);
+            ok = 0;
+        }
+    }
+    for (i = 0UL; i < k; ++i) {
+        tbl_fts_seg_close(&segs[i]);
+        free(map[i]);
+    }
+    free(jobs);
+    free(lens);
+    free(docs);
+    free(tfs);
+    free(pairs);
+    free(scratch.p);
+    free(out.p);
+    return ok;
+}
+
+/* ---- batch build ---- */
+
+typedef struct tbl_fts_bt_s {
+    unsigned long toff;  /* term text in the arena */
+    unsigned long tlen;
+    unsigned long df;
+    unsigned long cur;   /* doc + 1 of the pending posting */
+    unsigned long tf;
+    unsigned long last;  /* doc + 1 of the last encoded posting, 0 = none */
+    tbl_fts_buf_t post;
+} tbl_fts_bt_t;
+
+typedef struct tbl_fts_b_s {
+    tbl_fts_bt_t *t;
+    unsigned long nt;
+    unsigned long tcap;
+    unsigned long *slot;  /* term index + 1, 0 = free */
+    unsigned long nslots;
+    tbl_fts_buf_t arena;
+    unsigned long doc;
+    unsigned long doclen;
+    const char *field;    /* NULL = payload text */
+    int failed;
+} tbl_fts_b_t;
+
+static int tbl_fts_b_emit(tbl_fts_bt_t *t)
+{
+    unsigned long d = t->cur - 1UL;
+    int ok = tbl_fts_buf_varint(&t->post, t->last ? d - (t->last - 1UL) : d) && tbl_fts_buf_varint(&t->post, t->tf);
+
+    t->last = t->cur;
+    return ok;
+}
+
+static int tbl_fts_b_rehash(tbl_fts_b_t *b)
+{
+    unsigned long n = b->nslots ? b->nslots * 2UL : 4096UL;
+    unsigned long *slot = (unsigned long *)calloc((size_t)n, sizeof(unsigned long));
+    unsigned long i;
+
+    if (!slot) return 0;
+    for (i = 0UL; i < b->nt; ++i) {
+        unsigned long h = tbl_fts_fnv(2166136261UL, b->arena.p + b->t[i].toff, (size_t)b->t[i].tlen) & (n - 1UL);
+        while (slot[h] != 0UL) h = (h + 1UL) & (n - 1UL);
+        slot[h] = i + 1UL;
+    }
+    free(b->slot);
+    b->slot = slot;
+    b->nslots = n;
+    return 1;
+}
+
+static int tbl_fts_b_add(tbl_fts_b_t *b, const char *term, size_t len)
+{
+    tbl_fts_bt_t *t;
+    unsigned long h;
+
+    if ((b->nt + 1UL) * 2UL > b->nslots && !tbl_fts_b_rehash(b)) return 0;
+    h = tbl_fts_fnv(2166136261UL, term, len) & (b->nslots - 1UL);
+    for (;;) {
+        unsigned long id = b->slot[h];
+
+        if (id == 0UL) break;
+        t = &b->t[id - 1UL];
+        if (t->tlen == (unsigned long)len && memcmp(b->arena.p + t->toff, term, len) == 0) goto found;
+        h = (h + 1UL) & (b->nslots - 1UL);
+    }
+    if (b->nt == b->tcap) {
+        unsigned long cap = b->tcap ? b->tcap * 2UL : 1024UL;
+        void *p = realloc(b->t, (size_t)cap * sizeof(tbl_fts_bt_t));
+
+        if (!p) return 0;
+        b->t = (tbl_fts_bt_t *)p;
+        b->tcap = cap;
+    }
+    t = &b->t[b->nt];
+    (void)memset(t, 0, sizeof(*t));
+    t->toff = b->arena.len;
+    t->tlen = (unsigned long)len;
+    if (!tbl_fts_buf_put(&b->arena, term, (unsigned long)len)) return 0;
+    b->slot[h] = ++b->nt;
+found:
+    if (t->cur != b->doc + 1UL) {
+        if (t->cur != t->last && !tbl_fts_b_emit(t)) return 0;
+        t->cur = b->doc + 1UL;
+        t->tf = 1UL;
+        t->df++;
+    } else {
+        t->tf++;
+    }
+    return 1;
+}
+
+static void tbl_fts_b_free(tbl_fts_b_t *b)
+{
+    unsigned long i;
+
+    for (i = 0UL; i < b->nt; ++i) free(b->t[i].post.p);
+    free(b->t);
+    free(b->slot);
+    free(b->arena.p);
+}
+
+/* every token once as is, record fields also as "<field>:<token>" */
+static int tbl_fts_b_tok(void *ud, const char *tok, size_t len)
+{
+    tbl_fts_b_t *b = (tbl_fts_b_t *)ud;
+    char term[TBL_FTS_TERM_MAX + 1];
+    size_t fl;
+
+    if (!tbl_fts_b_add(b, tok, len)) {
+        b->failed = 1;
+        return 1;
+    }
+    b->doclen++;
+    if (b->field) {
+        fl = strlen(b->field);
+        (void)memcpy(term, b->field, fl);
+        term[fl] = ':';
+        (void)memcpy(term + fl + 1U, tok, len);
+        if (!tbl_fts_b_add(b, term, fl + 1U + len)) {
+            b->failed = 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static const tbl_fts_b_t *g_fts_sort_b;
+
+static int tbl_fts_cmp_bt(const void *x, const void *y)
+{
+    const tbl_fts_bt_t *a = &g_fts_sort_b->t[*(const unsigned long *)x];
+    const tbl_fts_bt_t *b = &g_fts_sort_b->t[*(const unsigned long *)y];
+    unsigned long n = (a->tlen < b->tlen) ? a->tlen : b->tlen;
+    int c = memcmp(g_fts_sort_b->arena.p + a->toff, g_fts_sort_b->arena.p + b->toff, (size_t)n);
+
+    if (c != 0) return c;
+    return (a->tlen < b->tlen) ? -1 : (a->tlen > b->tlen) ? 1 : 0;
+}
+
+static int tbl_fts_cmp_str(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* payload text into buf; 0 = not text (or not readable) */
+static int tbl_fts_read_text(const char *repo_root, const char *sha, char *buf, size_t cap, size_t *out_n)
+{
+    char path[1024];
+    FILE *fp;
+    size_t n;
+    int more;
+
+    *out_n = 0;
+    if (!tbl_cas_object_path(repo_root, sha, path, sizeof(path))) return 0;
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+    n = fread(buf, 1, cap, fp);
+    more = (n == cap && fgetc(fp) != EOF) ? 1 : 0;
+    fclose(fp);
+    if (!tbl_fts_text_ok((const unsigned char *)buf, n, more)) return 0;
+    *out_n = n;
+    return 1;
+}
+
+static int tbl_fts_field_ok(tbl_fts_b_t *b, const char *field, const char *value)
+{
+    b->field = field;
+    (void)tbl_fts_tokenize(value, strlen(value), tbl_fts_b_tok, b);
+    b->field = 0;
+    return !b->failed;
+}
+
+/* Segment from the records of jobs (sorted, unique) under the lock.
+   Returns 1 ok (*out_docs may be 0: nothing written), 0 error. */
+static int tbl_fts_build_seg(const tbl_fts_paths_t *p, const char *repo_root, const char **jobs, unsigned long n,
+                             unsigned long seq, unsigned long *out_docs, char *err, size_t errsz)
+{
+    tbl_fts_b_t b;
+    tbl_fts_w_t w;
+    tbl_record_t rec;
+    const char **dj;
+    unsigned long *lens;
+    unsigned long *order = 0;
+    unsigned long ndocs = 0UL;
+    unsigned long tokens = 0UL;
+    unsigned long i;
+    char tmp[1100];
+    char dst[1100];
+    char *text;
+    size_t tl;
+    int ok = 1;
+
+    *out_docs = 0UL;
+    (void)memset(&b, 0, sizeof(b));
+    dj = (const char **)malloc((size_t)(n ? n : 1UL) * sizeof(const char *));
+    lens = (unsigned long *)malloc((size_t)(n ? n : 1UL) * sizeof(unsigned long));
+    text = (char *)malloc((size_t)TBL_FTS_TEXT_MAX);
+    if (!dj || !lens || !text) ok = 0;
+    for (i = 0UL; ok && i < n; ++i) {
+        if (tbl_record_read_repo(repo_root, jobs[i], &rec, 0, 0) != 0) continue;
+        b.doc = ndocs;
+        b.doclen = 0UL;
+        ok = tbl_fts_field_ok(&b, "job", rec.job) && tbl_fts_field_ok(&b, "status", rec.status) &&
+             tbl_fts_field_ok(&b, "payload", rec.payload) && tbl_fts_field_ok(&b, "reason", rec.reason);
+        if (ok && tbl_streq(rec.status, "ok") &&
+            tbl_fts_read_text(repo_root, rec.sha256, text, (size_t)TBL_FTS_TEXT_MAX, &tl)) {
+            (void)tbl_fts_tokenize(text, tl, tbl_fts_b_tok, &b);
+            ok = !b.failed;
+        }
+        dj[ndocs] = jobs[i];
+        lens[ndocs] = b.doclen;
+        tokens += b.doclen;
+        ndocs++;
+    }
+    free(text);
+    if (!ok) {
+        tbl_fts_seterr(err, errsz, "out of memory");
+    } else if (ndocs > 0UL) {
+        order = (unsigned long *)malloc((size_t)(b.nt ? b.nt : 1UL) * sizeof(unsigned long));
+        ok = order != 0;
+        for (i = 0UL; ok && i < b.nt; ++i) {
+            order[i] = i;
+            if (b.t[i].cur != b.t[i].last && !tbl_fts_b_emit(&b.t[i])) ok = 0;
+        }
+        if (ok) {
+            g_fts_sort_b = &b;
+            qsort(order, (size_t)b.nt, sizeof(order[0]), tbl_fts_cmp_bt);
+        }
+        if (ok && tbl_fts_seg_path(p, seq, 1, tmp, sizeof(tmp)) && tbl_fts_seg_path(p, seq, 0, dst, sizeof(dst)) &&
+            tbl_fts_w_open(&w, tmp)) {
+            for (i = 0UL; i < b.nt; ++i) {
+                const tbl_fts_bt_t *t = &b.t[order[i]];
+                tbl_fts_w_term(&w, (const char *)b.arena.p + t->toff, (size_t)t->tlen, t->df, t->post.p, t->post.len);
+            }
+            ok = tbl_fts_w_finish(&w, dj, lens, ndocs, tokens) && tbl_fs_rename_atomic(tmp, dst, 1) == 0;
+            if (!ok) tbl_fts_w_abort(&w, tmp);
+        } else {
+            if (ok) tbl_fts_w_abort(&w, tmp);
+            ok = 0;
+        }
+        if (!ok) tbl_fts_seterr(err, errsz, "cannot write fts segment");
+    }
+    if (ok) *out_docs = ndocs;
+    free(order);
+    free(dj);
+    free(lens);
+    tbl_fts_b_free(&b);
+    return ok;
+}
+
+/* add one segment, then merge while the newest is at least as large as the
+   one before it (or the manifest is full). Caller holds the lock. */
+static int tbl_fts_add_locked(const tbl_fts_paths_t *p, const char *repo_root, const char **jobs, unsigned long n,
+                              unsigned long *out_docs, char *err, size_t errsz)
+{
+    tbl_fts_man_t man;
+    unsigned long gone[2UL * TBL_FTS_MAX_SEGS];
+    unsigned long ngone = 0UL;
+    unsigned long docs;
+    unsigned long m;
+    unsigned long i;
+    int ok;
+
+    if (!tbl_fts_man_read(p->man, &man)) {
+        tbl_fts_seterr(err, errsz, "fts.manifest damaged (run tablinum index --reset-cursor)");
+        return 0;
+    }
+    if (!tbl_fts_build_seg(p, repo_root, jobs, n, man.next, &docs, err, errsz)) return 0;
+    *out_docs = docs;
+    if (docs == 0UL) return 1;
+    if (man.nsegs == TBL_FTS_MAX_SEGS) {
+        tbl_fts_seterr(err, errsz, "fts.manifest full");
+        return 0;
+    }
+    man.seq[man.nsegs] = man.next++;
+    man.n[man.nsegs++] = docs;
+    ok = 1;
+    while (man.nsegs >= 2UL &&
+           (man.n[man.nsegs - 1UL] >= man.n[man.nsegs - 2UL] || man.nsegs + 1UL >= TBL_FTS_MAX_SEGS)) {
+        ok = tbl_fts_merge(p, &man, man.nsegs - 2UL, man.next, &m);
+        if (!ok) break;
+        gone[ngone++] = man.seq[man.nsegs - 2UL];
+        gone[ngone++] = man.seq[man.nsegs - 1UL];
+        man.nsegs--;
+        man.seq[man.nsegs - 1UL] = man.next++;
+        man.n[man.nsegs - 1UL] = m;
+    }
+    if (!ok || !tbl_fts_man_write(p, &man)) {
+        tbl_fts_seterr(err, errsz, ok ? "cannot write fts.manifest" : "cannot merge fts segments");
+        return 0;
+    }
+    for (i = 0UL; i < ngone; ++i) {
+        char path[1100];
+        if (tbl_fts_seg_path(p, gone[i], 0, path, sizeof(path))) (void)tbl_fs_remove_file(path);
+    }
+    return 1;
+}
+
+int tbl_fts_add(const char *repo_root, const char *const *jobs, unsigned long n, unsigned long *out_docs,
+                char *err, size_t errsz)
+{
+    tbl_fts_paths_t p;
+    tbl_fs_lock_t lk;
+    const char **sorted;
+    unsigned long m = 0UL;
+    unsigned long docs = 0UL;
+    unsigned long i;
+    int ok;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_docs) *out_docs = 0UL;
+    if (!repo_root || !repo_root[0] || (!jobs && n > 0UL)) {
+        tbl_fts_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_fts_paths(repo_root, &p)) {
+        tbl_fts_seterr(err, errsz, "fts path too long");
+        return 2;
+    }
+    sorted = (const char **)malloc((size_t)(n ? n : 1UL) * sizeof(const char *));
+    if (!sorted) {
+        tbl_fts_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    for (i = 0UL; i < n; ++i) {
+        if (tbl_record_is_safe_id(jobs[i])) sorted[m++] = jobs[i];
+    }
+    qsort(sorted, (size_t)m, sizeof(sorted[0]), tbl_fts_cmp_str);
+    for (i = 0UL, n = 0UL; i < m; ++i) {
+        if (n == 0UL || strcmp(sorted[n - 1UL], sorted[i]) != 0) sorted[n++] = sorted[i];
+    }
+    if (!tbl_fts_lock(&p, &lk, err, errsz)) {
+        free(sorted);
+        return 2;
+    }
+    ok = tbl_fts_add_locked(&p, repo_root, sorted, n, &docs, err, errsz);
+    (void)tbl_fs_lock_close(&lk);
+    free(sorted);
+    if (out_docs) *out_docs = docs;
+    return ok ? 0 : 2;
+}
+
+/* ---- event feed ---- */
+
+typedef struct tbl_fts_feed_s {
+    const char *repo_root;
+    char (*job)[256];
+    const char **ptr;
+    unsigned long n;
+    int full;             /* batch full: the scan stopped */
+    int failed;
+    tbl_fts_stats_t *st;
+    char err[256];
+} tbl_fts_feed_t;
+
+/* value of key=... in an event line */
+static int tbl_fts_ev_field(const char *line, size_t len, const char *key, const char **v, size_t *vl)
+{
+    size_t kl = strlen(key);
+    size_t i = 0;
+
+    while (i < len) {
+        size_t s = i;
+
+        while (i < len && line[i] != ' ' && line[i] != '\n') ++i;
+        if (i - s > kl && memcmp(line + s, key, kl) == 0 && line[s + kl] == '=') {
+            *v = line + s + kl + 1U;
+            *vl = i - s - kl - 1U;
+            return 1;
+        }
+        ++i;
+    }
+    return 0;
+}
+
+static int tbl_fts_ev_is(const char *v, size_t vl, const char *name)
+{
+    return strlen(name) == vl && memcmp(v, name, vl) == 0;
+}
+
+static int tbl_fts_feed_line(void *ud, const char *line, size_t len)
+{
+    tbl_fts_feed_t *fd = (tbl_fts_feed_t *)ud;
+    const char *v;
+    size_t vl;
+
+    if (!tbl_fts_ev_field(line, len, "event", &v, &vl)) return 0;
+    if (!tbl_fts_ev_is(v, vl, "ingest.ok") && !tbl_fts_ev_is(v, vl, "ingest-package.ok") &&
+        !tbl_fts_ev_is(v, vl, "ingest.fail")) {
+        return 0;
+    }
+    if (!tbl_fts_ev_field(line, len, "job", &v, &vl) || vl == 0U || vl >= sizeof(fd->job[0])) return 0;
+    (void)memcpy(fd->job[fd->n], v, vl);
+    fd->job[fd->n][vl] = '\0';
+    fd->ptr[fd->n] = fd->job[fd->n];
+    fd->n++;
+    if (fd->n < TBL_FTS_BATCH_MAX) return 0;
+    fd->full = 1;
+    return 1;
+}
+
+/* before the cursor moves: the batch becomes a segment */
+static int tbl_fts_feed_flush(void *ud)
+{
+    tbl_fts_feed_t *fd = (tbl_fts_feed_t *)ud;
+    unsigned long docs;
+
+    if (fd->n == 0UL) return 0;
+    if (tbl_fts_add(fd->repo_root, fd->ptr, fd->n, &docs, fd->err, sizeof(fd->err)) != 0) {
+        fd->failed = 1;
+        return 1;
+    }
+    fd->n = 0UL;
+    if (docs > 0UL) {
+        fd->st->docs += docs;
+        fd->st->batches++;
+    }
+    return 0;
+}
+
+/* drop every fts.*.seg / fts.*.seg.tmp */
+static int tbl_fts_sweep_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    (void)ud;
+    if (is_dir || strncmp(name, "fts.", 4) != 0) return 0;
+    if (!tbl_str_ends_with(name, ".seg") && !tbl_str_ends_with(name, ".seg.tmp")) return 0;
+    (void)tbl_fs_remove_file(full);
+    return 0;
+}
+
+static int tbl_fts_reset(const char *repo_root, const tbl_fts_paths_t *p, char *err, size_t errsz)
+{
+    tbl_fs_lock_t lk;
+    int ok;
+
+    if (!tbl_fts_lock(p, &lk, err, errsz)) return 0;
+    ok = tbl_evq_cursor_store(repo_root, TBL_FTS_CURSOR, 0UL, err, errsz) == 0;
+    if (ok) {
+        (void)tbl_fs_remove_file(p->man);
+        (void)tbl_fs_list_dir(p->dir, tbl_fts_sweep_cb, 0);
+    }
+    (void)tbl_fs_lock_close(&lk);
+    return ok;
+}
+
+int tbl_fts_update(const char *repo_root, int full, int follow, tbl_fts_stats_t *st, char *err, size_t errsz)
+{
+    tbl_fts_paths_t p;
+    tbl_fts_feed_t fd;
+    tbl_fts_man_t man;
+    tbl_evq_follow_t f;
+    tbl_fts_stats_t local;
+    unsigned long off = 0UL;
+    int rc = 0;
+
+    if (err && errsz) err[0] = '\0';
+    if (!st) st = &local;
+    (void)memset(st, 0, sizeof(*st));
+    if (!repo_root || !repo_root[0]) {
+        tbl_fts_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_fts_paths(repo_root, &p)) {
+        tbl_fts_seterr(err, errsz, "fts path too long");
+        return 2;
+    }
+    if (full && !tbl_fts_reset(repo_root, &p, err, errsz)) return 2;
+
+    (void)memset(&fd, 0, sizeof(fd));
+    fd.repo_root = repo_root;
+    fd.st = st;
+    fd.job = (char (*)[256])malloc((size_t)TBL_FTS_BATCH_MAX * sizeof(fd.job[0]));
+    fd.ptr = (const char **)malloc((size_t)TBL_FTS_BATCH_MAX * sizeof(const char *));
+    if (!fd.job || !fd.ptr) {
+        free(fd.job);
+        free((void *)fd.ptr);
+        tbl_fts_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    (void)memset(&f, 0, sizeof(f));
+    f.cursor = TBL_FTS_CURSOR;
+    f.follow = follow;
+    f.flush = tbl_fts_feed_flush;
+    for (;;) {
+        fd.full = 0;
+        if (tbl_evq_follow(repo_root, 0, &f, tbl_fts_feed_line, &fd, &off, err, errsz) != 0) {
+            if (fd.failed) tbl_fts_seterr(err, errsz, fd.err);
+            rc = 2;
+            break;
+        }
+        if (!fd.full) break;
+    }
+    free(fd.job);
+    free((void *)fd.ptr);
+    st->offset = off;
+    if (rc == 0 && tbl_fts_man_read(p.man, &man)) st->segments = man.nsegs;
+    return rc;
+}
+
+/* ---- query ---- */
+
+typedef struct tbl_fts_qctx_s {
+    tbl_fts_query_t *q;
+    const char *field;
+    unsigned long mask;
+    int bad;
+} tbl_fts_qctx_t;
+
+static int tbl_fts_q_tok(void *ud, const char *tok, size_t len)
+{
+    tbl_fts_qctx_t *c = (tbl_fts_qctx_t *)ud;
+    char term[TBL_FTS_TERM_MAX + 1];
+    size_t fl = 0;
+    unsigned long i;
+
+    if (c->field) {
+        fl = strlen(c->field);
+        (void)memcpy(term, c->field, fl);
+        term[fl++] = ':';
+    }
+    (void)memcpy(term + fl, tok, len);
+    term[fl + len] = '\0';
+    for (i = 0UL; i < c->q->nterms; ++i) {
+        if (tbl_streq(c->q->term[i], term)) break;
+    }
+    if (i == c->q->nterms) {
+        if (i == (unsigned long)TBL_FTS_QTERMS) {
+            c->bad = 1;
+            return 1;
+        }
+        (void)tbl_strlcpy(c->q->term[i], term, sizeof(c->q->term[i]));
+        c->q->nterms++;
+    }
+    c->mask |= 1UL << i;
+    return 0;
+}
+
+int tbl_fts_query_parse_ok(tbl_fts_query_t *q, const char *text)
+{
+    static const char *const fields[4] = { "job", "status", "payload", "reason" };
+    tbl_fts_qctx_t c;
+    const char *s = text;
+
+    if (!q || !text) return 0;
+    (void)memset(q, 0, sizeof(*q));
+    (void)memset(&c, 0, sizeof(c));
+    c.q = q;
+    for (;;) {
+        const char *w;
+        size_t wl;
+        size_t k;
+
+        while (*s == ' ' || *s == '\t') ++s;
+        if (!*s) break;
+        w = s;
+        while (*s && *s != ' ' && *s != '\t') ++s;
+        wl = (size_t)(s - w);
+        if (wl == 2U && memcmp(w, "OR", 2U) == 0) {
+            if (c.mask == 0UL || q->ngroups + 1UL >= (unsigned long)TBL_FTS_QGROUPS) return 0;
+            q->group[q->ngroups++] = c.mask;
+            c.mask = 0UL;
+            continue;
+        }
+        if (wl == 3U && memcmp(w, "AND", 3U) == 0) continue;
+        c.field = 0;
+        for (k = 0; k < 4U; ++k) {
+            size_t fl = strlen(fields[k]);
+            if (wl > fl && memcmp(w, fields[k], fl) == 0 && w[fl] == ':') {
+                c.field = fields[k];
+                w += fl + 1U;
+                wl -= fl + 1U;
+                break;
+            }
+        }
+        (void)tbl_fts_tokenize(w, wl, tbl_fts_q_tok, &c);
+        if (c.bad) return 0;
+    }
+    if (c.mask == 0UL) return 0;
+    q->group[q->ngroups++] = c.mask;
+    return 1;
+}
+
+/* ---- search ---- */
+
+/* natural logarithm (no libm) */
+static double tbl_fts_ln(double x)
+{
+    double y;
+    double y2;
+    double t;
+    double s = 0.0;
+    int k = 0;
+    int i;
+
+    if (x <= 0.0) return 0.0;
+    while (x > 2.0) {
+        x /= 2.0;
+        k++;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        k--;
+    }
+    y = (x - 1.0) / (x + 1.0);
+    y2 = y * y;
+    t = y;
+    for (i = 1; i < 40; i += 2) {
+        s += t / (double)i;
+        t *= y2;
+    }
+    return 2.0 * s + (double)k * 0.69314718055994530942;
+}
+
+typedef struct tbl_fts_top_s {
+    tbl_fts_hit_t *hits;
+    unsigned long k;
+    unsigned long n;
+    unsigned long worst;
+} tbl_fts_top_t;
+
+/* 1 if hit a ranks before b */
+static int tbl_fts_before(unsigned long as, const char *aj, unsigned long bs, const char *bj)
+{
+    if (as != bs) return as > bs;
+    return strcmp(aj, bj) < 0;
+}
+
+static void tbl_fts_top_add(tbl_fts_top_t *t, const char *job, unsigned long score)
+{
+    unsigned long i;
+
+    if (t->k == 0UL) return;
+    if (t->n == t->k) {
+        tbl_fts_hit_t *w = &t->hits[t->worst];
+        if (!tbl_fts_before(score, job, w->score, w->job)) return;
+        (void)tbl_strlcpy(w->job, job, sizeof(w->job));
+        w->score = score;
+    } else {
+        (void)tbl_strlcpy(t->hits[t->n].job, job, sizeof(t->hits[t->n].job));
+        t->hits[t->n].score = score;
+        t->n++;
+    }
+    t->worst = 0UL;
+    for (i = 1UL; i < t->n; ++i) {
+        if (tbl_fts_before(t->hits[t->worst].score, t->hits[t->worst].job, t->hits[i].score, t->hits[i].job)) {
+            t->worst = i;
+        }
+    }
+}
+
+static int tbl_fts_cmp_hit(const void *x, const void *y)
+{
+    const tbl_fts_hit_t *a = (const tbl_fts_hit_t *)x;
+    const tbl_fts_hit_t *b = (const tbl_fts_hit_t *)y;
+
+    if (tbl_fts_before(a->score, a->job, b->score, b->job)) return -1;
+    if (tbl_fts_before(b->score, b->job, a->score, a->job)) return 1;
+    return 0;
+}
+
+typedef struct tbl_fts_qe_s {
+    unsigned long df;
+    unsigned long poff;
+    unsigned long plen;
+} tbl_fts_qe_t;
+
+typedef struct tbl_fts_sctx_s {
+    const tbl_fts_query_t *q;
+    tbl_fts_seg_t *segs;  /* newest first */
+    unsigned long nsegs;
+    tbl_fts_qe_t (*ent)[TBL_FTS_QTERMS];
+    double idf[TBL_FTS_QTERMS];
+    double avgdl;
+    tbl_fts_top_t *top;
+    unsigned long total;
+    tbl_fts_buf_t scratch;
+} tbl_fts_sctx_t;
+
+/* matches of one segment into the top list. Returns 1/0. */
+static int tbl_fts_search_seg(tbl_fts_sctx_t *c, unsigned long s)
+{
+    const tbl_fts_seg_t *seg = &c->segs[s];
+    unsigned long *docs[TBL_FTS_QTERMS];
+    unsigned long *tfs[TBL_FTS_QTERMS];
+    unsigned long nd = seg->ndocs;
+    unsigned char *cnt = 0;
+    unsigned char *cand = 0;
+    double *sc = 0;
+    unsigned long u;
+    unsigned long g;
+    unsigned long d;
+    unsigned long j;
+    int ok = 1;
+
+    for (u = 0UL; u < c->q->nterms; ++u) {
+        docs[u] = 0;
+        tfs[u] = 0;
+    }
+    if (nd == 0UL) return 1;
+    for (u = 0UL; ok && u < c->q->nterms; ++u) {
+        const tbl_fts_qe_t *e = &c->ent[s][u];
+
+        if (e->df == 0UL) continue;
+        docs[u] = (unsigned long *)malloc((size_t)e->df * sizeof(unsigned long));
+        tfs[u] = (unsigned long *)malloc((size_t)e->df * sizeof(unsigned long));
+        if (!docs[u] || !tfs[u] || !tbl_fts_seg_post(seg, e->df, e->poff, e->plen, &c->scratch, docs[u], tfs[u])) {
+            ok = 0;
+        }
+    }
+    if (ok) {
+        cnt = (unsigned char *)calloc((size_t)nd, 1U);
+        cand = (unsigned char *)calloc((size_t)nd, 1U);
+        sc = (double *)calloc((size_t)nd, sizeof(double));
+        if (!cnt || !cand || !sc) ok = 0;
+    }
+    /* a document matches when it holds every term of one group */
+    for (g = 0UL; ok && g < c->q->ngroups; ++g) {
+        unsigned long m = c->q->group[g];
+        unsigned long need = 0UL;
+        unsigned long first = 0UL;
+        int all = 1;
+
+        for (u = 0UL; u < c->q->nterms; ++u) {
+            if (!(m & (1UL << u))) continue;
+            if (c->ent[s][u].df == 0UL) all = 0;
+            if (need++ == 0UL) first = u;
+        }
+        if (!all) continue;
+        for (u = 0UL; u < c->q->nterms; ++u) {
+            if (!(m & (1UL << u))) continue;
+            for (j = 0UL; j < c->ent[s][u].df; ++j) cnt[docs[u][j]]++;
+        }
+        for (j = 0UL; j < c->ent[s][first].df; ++j) {
+            if (cnt[docs[first][j]] == (unsigned char)need) cand[docs[first][j]] = 1;
+        }
+        for (u = 0UL; u < c->q->nterms; ++u) {
+            if (!(m & (1UL << u))) continue;
+            for (j = 0UL; j < c->ent[s][u].df; ++j) cnt[docs[u][j]] = 0;
+        }
+    }
+    for (u = 0UL; ok && u < c->q->nterms; ++u) {
+        for (j = 0UL; j < c->ent[s][u].df; ++j) {
+            double tf = (double)tfs[u][j];
+            double dl;
+
+            d = docs[u][j];
+            if (!cand[d]) continue;
+            dl = (double)tbl_fts_seg_len(seg, d);
+            sc[d] += c->idf[u] * tf * (TBL_FTS_K1 + 1.0) /
+                     (tf + TBL_FTS_K1 * (1.0 - TBL_FTS_B + TBL_FTS_B * dl / c->avgdl));
+        }
+    }
+    for (d = 0UL; ok && d < nd; ++d) {
+        const char *job;
+        unsigned long t;
+
+        if (!cand[d]) continue;
+        job = tbl_fts_seg_job(seg, d);
+        for (t = 0UL; t < s; ++t) {
+            if (tbl_fts_seg_has(&c->segs[t], job)) break;
+        }
+        if (t < s) continue;
+        c->total++;
+        tbl_fts_top_add(c->top, job, (unsigned long)(sc[d] * 1000.0 + 0.5));
+    }
+    for (u = 0UL; u < c->q->nterms; ++u) {
+        free(docs[u]);
+        free(tfs[u]);
+    }
+    free(cnt);
+    free(cand);
+    free(sc);
+    return ok;
+}
+
+/* Returns 0 ok, 1 a segment went away (merged meanwhile), 2 error. */
+static int tbl_fts_search_once(const tbl_fts_paths_t *p, const tbl_fts_query_t *q, tbl_fts_top_t *top,
+                               unsigned long *out_total, char *err, size_t errsz)
+{
+    tbl_fts_man_t man;
+    tbl_fts_sctx_t c;
+    double n = 0.0;
+    double tokens = 0.0;
+    unsigned long s;
+    unsigned long u;
+    int rc = 0;
+
+    if (!tbl_fts_man_read(p->man, &man)) {
+        tbl_fts_seterr(err, errsz, "fts.manifest damaged (run tablinum index --reset-cursor)");
+        return 2;
+    }
+    (void)memset(&c, 0, sizeof(c));
+    c.q = q;
+    c.top = top;
+    top->n = 0UL;
+    top->worst = 0UL;
+    if (man.nsegs == 0UL) return 0;
+    c.segs = (tbl_fts_seg_t *)calloc((size_t)man.nsegs, sizeof(tbl_fts_seg_t));
+    c.ent = (tbl_fts_qe_t (*)[TBL_FTS_QTERMS])calloc((size_t)man.nsegs, sizeof(c.ent[0]));
+    if (!c.segs || !c.ent) {
+        free(c.segs);
+        free(c.ent);
+        tbl_fts_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    for (s = 0UL; rc == 0 && s < man.nsegs; ++s) {
+        char path[1100];
+        int r;
+
+        if (!tbl_fts_seg_path(p, man.seq[man.nsegs - 1UL - s], 0, path, sizeof(path))) {
+            rc = 2;
+            break;
+        }
+        r = tbl_fts_seg_open(&c.segs[s], path);
+        if (r != 0) {
+            rc = r;
+            break;
+        }
+        c.nsegs++;
+        n += (double)c.segs[s].ndocs;
+        tokens += (double)c.segs[s].tokens;
+    }
+    for (s = 0UL; rc == 0 && s < c.nsegs; ++s) {
+        for (u = 0UL; u < q->nterms; ++u) {
+            tbl_fts_qe_t *e = &c.ent[s][u];
+            if (tbl_fts_seg_term(&c.segs[s], q->term[u], &e->df, &e->poff, &e->plen) < 0) rc = 2;
+        }
+    }
+    if (rc == 0) {
+        c.avgdl = (n > 0.0 && tokens > 0.0) ? tokens / n : 1.0;
+        for (u = 0UL; u < q->nterms; ++u) {
+            double df = 0.0;
+            for (s = 0UL; s < c.nsegs; ++s) df += (double)c.ent[s][u].df;
+            c.idf[u] = tbl_fts_ln(1.0 + (n - df + 0.5) / (df + 0.5));
+        }
+        for (s = 0UL; rc == 0 && s < c.nsegs; ++s) {
+            if (!tbl_fts_search_seg(&c, s)) rc = 2;
+        }
+    }
+    if (rc == 2) tbl_fts_seterr(err, errsz, "fts segment damaged (run tablinum index --reset-cursor)");
+    for (s = 0UL; s < c.nsegs; ++s) tbl_fts_seg_close(&c.segs[s]);
+    free(c.segs);
+    free(c.ent);
+    free(c.scratch.p);
+    *out_total = c.total;
+    return rc;
+}
+
+int tbl_fts_search(const char *repo_root, const tbl_fts_query_t *q, tbl_fts_hit_t *hits, unsigned long k,
+                   unsigned long *out_n, unsigned long *out_total, char *err, size_t errsz)
+{
+    tbl_fts_paths_t p;
+    tbl_fts_top_t top;
+    unsigned long total = 0UL;
+    int attempt;
+    int rc = 1;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_n) *out_n = 0UL;
+    if (out_total) *out_total = 0UL;
+    if (!repo_root || !repo_root[0] || !q || q->ngroups == 0UL || (!hits && k > 0UL)) {
+        tbl_fts_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_fts_paths(repo_root, &p)) {
+        tbl_fts_seterr(err, errsz, "fts path too long");
+        return 2;
+    }
+    top.hits = hits;
+    top.k = k;
+    for (attempt = 0; attempt < 3 && rc == 1; ++attempt) rc = tbl_fts_search_once(&p, q, &top, &total, err, errsz);
+    if (rc == 1) {
+        tbl_fts_seterr(err, errsz, "fts segments keep changing");
+        rc = 2;
+    }
+    if (rc != 0) return 2;
+    qsort(hits, (size_t)top.n, sizeof(hits[0]), tbl_fts_cmp_hit);
+    if (out_n) *out_n = top.n;
+    if (out_total) *out_total = total;
+    return 0;
+}
+
+#endif /* TBL_FTS_IMPLEMENTATION */
+
+#endif /* TBL_CORE_FTS_H */
@@ -4,14 +4,20 @@
 #include <stddef.h>
 #include <time.h>
 #include "core/config.h"
+#include "core/events.h"
 
 /* Ingest role (SIP-light jobdir -> AIP-light CAS + records):
    - claims next DIRECTORY from spool/inbox -> spool/claim
    - requires: <jobdir>/payload.bin
+   - optional: <jobdir>/tags.ini, key = value lines (top level or [tags])
+     that become the record's tags; a tags.ini that does not parse or
+     holds an invalid tag fails the job
    - stores payload in repo CAS (sha256)
    - writes <jobdir>/job.meta (moves with directory)
-   - writes <repo>/records/<jobid>.ini (durable record)
-   - appends to <repo>/events.log
+   - stores the durable record and its index entries (core/recstore.h:
+     records.idx slot, reverse, ordered, trigram and tag indexes)
+   - appends events through one persistent writer per run (core/events.h);
+     with [events] async = 1 a background thread writes them (core/evlog.h)
    - commits jobdir to spool/out or spool/fail
 
    jobs_done counts ok + fail.
@@ -21,6 +27,22 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
                       unsigned long *out_jobs_done,
                       char *err, size_t errsz);
 
+/* Event logging counters of one run. */
+typedef struct tbl_ingest_stats_s {
+    tbl_events_lock_stats_t lock;    /* audit lock of the run's events writer */
+    int events_async;                /* events were written on a background thread */
+    unsigned long events_full_waits; /* async: appends that waited for a free slot */
+    unsigned long events_errors;     /* async: failed event writes */
+    unsigned long audit_dropped;     /* events written without their ops.log line */
+    char audit_err[128];             /* why (damaged ops.log head, ...) */
+} tbl_ingest_stats_t;
+
+/* Same, also returning the event logging counters (out_stats may be NULL). */
+int tbl_ingest_run_stats(const tbl_cfg_t *cfg,
+                         unsigned long *out_jobs_done,
+                         tbl_ingest_stats_t *out_stats,
+                         char *err, size_t errsz);
+
 /* Convenience wrapper (ignore jobs_done). */
 int tbl_ingest_run(const tbl_cfg_t *cfg, char *err, size_t errsz);
 
@@ -36,7 +58,12 @@ int tbl_ingest_run(const tbl_cfg_t *cfg, char *err, size_t errsz);
 #include "core/spool.h"
 #include "core/cas.h"
 #include "core/record.h"
+#include "core/recjournal.h"
+#include "core/recstore.h"
+#include "core/ini.h"
 #include "core/events.h"
+#include "core/evlog.h"
+#include "core/jobstore.h"
 #include "os/fs.h"
 #include "os/time.h"
 
@@ -165,13 +192,50 @@ static int tbl_ingest_commit_fail(tbl_spool_t *sp, const char *jobid, char *err,
     return 0;
 }
 
+static int tbl_ingest_tag_cb(void *ud, const char *section, const char *key, const char *value, int line_no)
+{
+    (void)line_no;
+    if (section[0] && !tbl_streq(section, "tags")) return 1;
+    return (tbl_record_tag_set((tbl_record_t *)ud, key, value) == 0) ? 0 : 1;
+}
+
+/* <jobdir>/tags.ini -> tags (nothing if the file is missing).
+   Returns 0 ok, 2 invalid (reason set). */
+static int tbl_ingest_read_tags(const char *jobdir, char *tags, size_t tagssz, char *reason, size_t reasonsz)
+{
+    tbl_record_t tr;
+    char path[1024];
+    char err[192];
+    int ex;
+
+    tags[0] = '\0';
+    if (!tbl_path_join2(path, sizeof(path), jobdir, "tags.ini")) {
+        tbl_ingest_seterr(reason, reasonsz, "tags.ini path too long");
+        return 2;
+    }
+    ex = 0;
+    (void)tbl_fs_exists(path, &ex);
+    if (!ex) return 0;
+
+    (void)memset(&tr, 0, sizeof(tr));
+    err[0] = '\0';
+    if (tbl_ini_parse_file(path, tbl_ingest_tag_cb, &tr, err, sizeof(err)) != TBL_INI_OK) {
+        tbl_ingest_seterr(reason, reasonsz, "invalid tags.ini: ");
+        (void)tbl_strlcat(reason, err[0] ? err : "parse error", reasonsz);
+        return 2;
+    }
+    (void)tbl_strlcpy(tags, tr.tags, tagssz);
+    return 0;
+}
+
 static void tbl_ingest_fill_record(tbl_record_t *rec,
                                   const char *jobid,
                                   const char *status,
                                   const char *payload_name,
                                   const char *sha256_or_empty,
                                   unsigned long bytes,
-                                  const char *reason_or_empty)
+                                  const char *reason_or_empty,
+                                  const char *tags)
 {
     unsigned long ts;
 
@@ -187,15 +251,19 @@ static void tbl_ingest_fill_record(tbl_record_t *rec,
     rec->stored_at = ts;
 
     if (reason_or_empty) (void)tbl_strlcpy(rec->reason, reason_or_empty, sizeof(rec->reason));
+    (void)tbl_strlcpy(rec->tags, tags, sizeof(rec->tags));
 }
 
-int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
-                      unsigned long *out_jobs_done,
-                      char *err, size_t errsz)
+/* the record and its index entries (best effort) */
+static void tbl_ingest_store_record(const char *repo_root, const tbl_record_t *rec)
+{
+    (void)tbl_recstore_write(repo_root, rec, 0, 0);
+}
+
+static int tbl_ingest_loop(const tbl_cfg_t *cfg, tbl_spool_t *spp, const char *repo_root,
+                           tbl_evlog_t *ev, unsigned long *out_jobs_done,
+                           char *err, size_t errsz)
 {
-    tbl_spool_t sp;
-    char spool_root[1024];
-    char repo_root[1024];
     char name[256];
     char jobdir[1024];
     char payload[1024];
@@ -204,37 +272,10 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
     int once;
     unsigned long max_jobs;
 
-    if (err && errsz) err[0] = '\0';
-    if (out_jobs_done) *out_jobs_done = 0UL;
-
-    if (!cfg) {
-        tbl_ingest_seterr(err, errsz, "cfg is NULL");
-        return 2;
-    }
-
     jobs_done = 0UL;
     once = (cfg->ingest_once != 0UL) ? 1 : 0;
     max_jobs = cfg->ingest_max_jobs;
 
-    if (!tbl_ingest_resolve_root(spool_root, sizeof(spool_root), cfg->root, cfg->spool)) {
-        tbl_ingest_seterr(err, errsz, "spool path resolve failed");
-        return 2;
-    }
-    if (!tbl_ingest_resolve_root(repo_root, sizeof(repo_root), cfg->root, cfg->repo)) {
-        tbl_ingest_seterr(err, errsz, "repo path resolve failed");
-        return 2;
-    }
-
-    if (tbl_fs_mkdir_p(repo_root) != 0) {
-        tbl_ingest_seterr(err, errsz, "cannot create repo root");
-        return 2;
-    }
-
-    if (tbl_spool_init(&sp, spool_root, err, errsz) != TBL_SPOOL_OK) {
-        if (err && errsz && err[0] == '\0') tbl_ingest_seterr(err, errsz, "spool init failed");
-        return 2;
-    }
-
     /* poll interval (seconds -> ms), clamp to avoid overflow */
     if (cfg->ingest_poll_seconds == 0UL) {
         poll_ms = 2000UL;
@@ -248,6 +289,8 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
         int rc;
         int ex;
         char sha[65];
+        char tags[TBL_RECORD_TAGS_MAX];
+        char tag_reason[256];
         unsigned long bytes;
         tbl_record_t rec;
 
@@ -255,9 +298,11 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
         name[0] = '\0';
 
         /* claim DIRECTORY jobs (jobid is directory name) */
-        rc = tbl_spool_claim_next_dir(&sp, name, sizeof(name), err, errsz);
+        rc = tbl_spool_claim_next_dir(spp, name, sizeof(name), err, errsz);
         if (rc == TBL_SPOOL_ENOJOB) {
             if (once) break;
+            /* idle: commit boundary for batched / queued events */
+            (void)tbl_evlog_barrier(ev);
             tbl_sleep_ms(poll_ms);
             continue;
         }
@@ -266,8 +311,8 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
             return 2;
         }
 
-        /* jobdir = <sp.claim>/<jobid> */
-        if (!tbl_path_join2(jobdir, sizeof(jobdir), sp.claim, name)) {
+        /* jobdir = <spp->claim>/<jobid> */
+        if (!tbl_path_join2(jobdir, sizeof(jobdir), spp->claim, name)) {
             tbl_ingest_seterr(err, errsz, "jobdir path too long");
             return 2;
         }
@@ -284,11 +329,11 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
             /* missing payload -> fail */
             (void)tbl_ingest_write_job_meta(jobdir, "fail", name, "payload.bin", "", "missing payload.bin", err, errsz);
 
-            tbl_ingest_fill_record(&rec, name, "fail", "payload.bin", "", 0UL, "missing payload.bin");
-            (void)tbl_record_write_repo(repo_root, &rec, 0, 0);
-            (void)tbl_events_append(repo_root, "ingest.fail", name, "fail", "", "missing payload.bin", 0, 0);
+            tbl_ingest_fill_record(&rec, name, "fail", "payload.bin", "", 0UL, "missing payload.bin", "");
+            tbl_ingest_store_record(repo_root, &rec);
+            (void)tbl_evlog_append(ev, "ingest.fail", name, "fail", "", "missing payload.bin");
 
-            if (tbl_ingest_commit_fail(&sp, name, err, errsz) != 0) return 2;
+            if (tbl_ingest_commit_fail(spp, name, err, errsz) != 0) return 2;
 
             jobs_done++;
             if (max_jobs > 0UL && jobs_done >= max_jobs) break;
@@ -297,15 +342,31 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
 
         bytes = tbl_ingest_file_size_ul(payload);
 
+        /* tags.ini: submitted metadata must be valid, else the job fails */
+        if (tbl_ingest_read_tags(jobdir, tags, sizeof(tags), tag_reason, sizeof(tag_reason)) != 0) {
+            (void)tbl_ingest_write_job_meta(jobdir, "fail", name, "payload.bin", "", tag_reason, err, errsz);
+
+            tbl_ingest_fill_record(&rec, name, "fail", "payload.bin", "", bytes, tag_reason, "");
+            tbl_ingest_store_record(repo_root, &rec);
+            (void)tbl_evlog_append(ev, "ingest.fail", name, "fail", "", tag_reason);
+
+            if (tbl_ingest_commit_fail(spp, name, err, errsz) != 0) return 2;
+
+            jobs_done++;
+            if (max_jobs > 0UL && jobs_done >= max_jobs) break;
+            continue;
+        }
+
         sha[0] = '\0';
         if (tbl_cas_put_file(repo_root, payload, sha, sizeof(sha), err, errsz) != 0) {
             (void)tbl_ingest_write_job_meta(jobdir, "fail", name, "payload.bin", "", err && err[0] ? err : "cas put failed", err, errsz);
 
-            tbl_ingest_fill_record(&rec, name, "fail", "payload.bin", "", bytes, err && err[0] ? err : "cas put failed");
-            (void)tbl_record_write_repo(repo_root, &rec, 0, 0);
-            (void)tbl_events_append(repo_root, "ingest.fail", name, "fail", "", rec.reason, 0, 0);
+            tbl_ingest_fill_record(&rec, name, "fail", "payload.bin", "", bytes, err && err[0] ? err : "cas put failed",
+                                   tags);
+            tbl_ingest_store_record(repo_root, &rec);
+            (void)tbl_evlog_append(ev, "ingest.fail", name, "fail", "", rec.reason);
 
-            if (tbl_ingest_commit_fail(&sp, name, err, errsz) != 0) return 2;
+            if (tbl_ingest_commit_fail(spp, name, err, errsz) != 0) return 2;
 
             jobs_done++;
             if (max_jobs > 0UL && jobs_done >= max_jobs) break;
@@ -314,20 +375,20 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
 
         if (tbl_ingest_write_job_meta(jobdir, "ok", name, "payload.bin", sha, "", err, errsz) != 0) {
             /* try to move to fail to avoid clogging claim */
-            (void)tbl_events_append(repo_root, "ingest.error", name, "error", sha, "job.meta write failed", 0, 0);
-            (void)tbl_ingest_commit_fail(&sp, name, err, errsz);
+            (void)tbl_evlog_append(ev, "ingest.error", name, "error", sha, "job.meta write failed");
+            (void)tbl_ingest_commit_fail(spp, name, err, errsz);
             return 2;
         }
 
         /* durable record + event */
-        tbl_ingest_fill_record(&rec, name, "ok", "payload.bin", sha, bytes, "");
-        (void)tbl_record_write_repo(repo_root, &rec, 0, 0);
-        (void)tbl_events_append(repo_root, "ingest.ok", name, "ok", sha, "", 0, 0);
+        tbl_ingest_fill_record(&rec, name, "ok", "payload.bin", sha, bytes, "", tags);
+        tbl_ingest_store_record(repo_root, &rec);
+        (void)tbl_evlog_append(ev, "ingest.ok", name, "ok", sha, "");
 
-        rc = tbl_spool_commit_out(&sp, name, err, errsz);
+        rc = tbl_spool_commit_out(spp, name, err, errsz);
         if (rc != TBL_SPOOL_OK) {
             if (err && errsz && err[0] == '\0') tbl_ingest_seterr(err, errsz, "commit_out failed");
-            (void)tbl_events_append(repo_root, "ingest.error", name, "error", sha, "commit_out failed", 0, 0);
+            (void)tbl_evlog_append(ev, "ingest.error", name, "error", sha, "commit_out failed");
             return 2;
         }
 
@@ -335,10 +396,92 @@ int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
         if (max_jobs > 0UL && jobs_done >= max_jobs) break;
     }
 
-    if (out_jobs_done) *out_jobs_done = jobs_done;
+    *out_jobs_done = jobs_done;
     return 0;
 }
 
+int tbl_ingest_run_ex(const tbl_cfg_t *cfg,
+                      unsigned long *out_jobs_done,
+                      char *err, size_t errsz)
+{
+    return tbl_ingest_run_stats(cfg, out_jobs_done, 0, err, errsz);
+}
+
+int tbl_ingest_run_stats(const tbl_cfg_t *cfg,
+                         unsigned long *out_jobs_done,
+                         tbl_ingest_stats_t *out_stats,
+                         char *err, size_t errsz)
+{
+    tbl_spool_t sp;
+    tbl_evlog_t ev;
+    char spool_root[1024];
+    char repo_root[1024];
+    unsigned long jobs_done;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_jobs_done) *out_jobs_done = 0UL;
+    if (out_stats) (void)memset(out_stats, 0, sizeof(*out_stats));
+
+    if (!cfg) {
+        tbl_ingest_seterr(err, errsz, "cfg is NULL");
+        return 2;
+    }
+
+    if (!tbl_ingest_resolve_root(spool_root, sizeof(spool_root), cfg->root, cfg->spool)) {
+        tbl_ingest_seterr(err, errsz, "spool path resolve failed");
+        return 2;
+    }
+    if (!tbl_ingest_resolve_root(repo_root, sizeof(repo_root), cfg->root, cfg->repo)) {
+        tbl_ingest_seterr(err, errsz, "repo path resolve failed");
+        return 2;
+    }
+
+    if (tbl_fs_mkdir_p(repo_root) != 0) {
+        tbl_ingest_seterr(err, errsz, "cannot create repo root");
+        return 2;
+    }
+
+    if (tbl_spool_init(&sp, spool_root, err, errsz) != TBL_SPOOL_OK) {
+        if (err && errsz && err[0] == '\0') tbl_ingest_seterr(err, errsz, "spool init failed");
+        return 2;
+    }
+    sp.date_buckets = cfg->spool_date_buckets ? 1 : 0;
+
+    /* job_store = buckets: the store is picked up by every writer once it exists */
+    if (cfg->events_job_buckets && tbl_jobstore_create(repo_root, err, errsz) != 0) return 2;
+
+    /* store = journal: likewise, create recjournal/ up front (writers would on first use) */
+    if (cfg->records_journal && tbl_recjournal_create(repo_root, cfg->records_ini_view ? 1 : 0, err, errsz) != 0) {
+        return 2;
+    }
+
+    /* a damaged ops.log head is not chained onto; the other streams go on
+       and the dropped ops lines are reported in out_stats */
+    if (tbl_evlog_open(&ev, repo_root, err, errsz) != 0) {
+        if (err && errsz && err[0] == '\0') tbl_ingest_seterr(err, errsz, "events writer open failed");
+        return 2;
+    }
+    (void)tbl_events_writer_set_batch(&ev.w, cfg->events_batch, cfg->events_fsync ? 1 : 0, 0, 0);
+    (void)tbl_events_writer_set_segment_max(&ev.w, cfg->audit_segment_max_bytes, 0, 0);
+    if (cfg->events_async) (void)tbl_evlog_start_ok(&ev, 0UL);
+
+    jobs_done = 0UL;
+    rc = tbl_ingest_loop(cfg, &sp, repo_root, &ev, &jobs_done, err, errsz);
+    if (out_stats) out_stats->events_async = ev.async;
+    tbl_evlog_close(&ev);
+    if (out_stats) {
+        out_stats->lock = ev.w.lock_stats;
+        out_stats->events_full_waits = ev.full_waits;
+        out_stats->events_errors = ev.errors;
+        out_stats->audit_dropped = ev.w.ops_dropped;
+        (void)tbl_strlcpy(out_stats->audit_err, ev.w.ops_err, sizeof(out_stats->audit_err));
+    }
+
+    if (out_jobs_done) *out_jobs_done = jobs_done;
+    return rc;
+}
+
 int tbl_ingest_run(const tbl_cfg_t *cfg, char *err, size_t errsz)
 {
     return tbl_ingest_run_ex(cfg, 0, err, errsz);
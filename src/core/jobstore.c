@@ -0,0 +1,2 @@
+#define TBL_JOBSTORE_IMPLEMENTATION
+#include "core/jobstore.h"
@@ -0,0 +1,523 @@
+#ifndef TBL_CORE_JOBSTORE_H
+#define TBL_CORE_JOBSTORE_H
+
+#include <stddef.h>
+
+/* Bucketed job event store (instead of one directory per job).
+   - <repo_root>/jobstore/NNN.log   4096 append-only buckets, NNN = 3 hex
+                                    digits of FNV-1a(jobid) & 0xfff
+   - records: "<jobid> <event line>\n" (the event line as in events.log)
+   A job's events are found by reading its bucket only (~1/4096 of the job
+   history), without one inode per job.
+
+   The store is active once <repo_root>/jobstore/ exists. A job that still
+   has <repo_root>/jobs/<jobid>/events.log keeps writing there until it is
+   migrated, so every job lives in exactly one place.
+   tbl_jobstore_migrate() moves the per-job files into the buckets; an
+   interrupted run is resumed from jobstore/migrate.pending.
+*/
+
+#define TBL_JOBSTORE_BUCKETS 4096UL
+
+/* Per-line callback: event line without the jobid prefix (LF included),
+   0 = continue, else stop. */
+typedef int (*tbl_jobstore_line_fn)(void *ud, const char *line, size_t len);
+
+/* 1 if <repo_root>/jobstore/ exists. */
+int tbl_jobstore_active_ok(const char *repo_root);
+
+/* Create <repo_root>/jobstore/ (ok if it exists). Returns 0 ok, 2 error. */
+int tbl_jobstore_create(const char *repo_root, char *err, size_t errsz);
+
+unsigned long tbl_jobstore_bucket(const char *jobid);
+/* 1 if jobid can be a record prefix (1..127 bytes, no blanks/control bytes). */
+int tbl_jobstore_jobid_ok(const char *jobid);
+int tbl_jobstore_bucket_path_ok(const char *repo_root, const char *jobid, char *out, size_t outsz);
+
+/* Call fn for every event of jobid in its bucket, in file order.
+   A missing bucket (or a jobid the store cannot hold) is not an error. Returns 0 ok, 2 error. */
+int tbl_jobstore_each(const char *repo_root, const char *jobid, tbl_jobstore_line_fn fn, void *ud,
+                      unsigned long *out_lines, char *err, size_t errsz);
+
+/* Move every <repo_root>/jobs/<jobid>/events.log into its bucket and remove
+   the per-job file and directory. Offline tool: no concurrent writers.
+   Returns 0 ok, 2 error. */
+int tbl_jobstore_migrate(const char *repo_root, unsigned long *out_jobs, unsigned long *out_lines,
+                         char *err, size_t errsz);
+
+#ifdef TBL_JOBSTORE_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_JOBSTORE_LINE_MAX 4096
+
+static void tbl_jobstore_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "job store error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static void tbl_jobstore_seterr2(char *err, size_t errsz, const char *a, const char *b)
+{
+    if (!err || errsz == 0) return;
+    (void)tbl_strlcpy(err, a, errsz);
+    (void)tbl_strlcat(err, b, errsz);
+}
+
+int tbl_jobstore_active_ok(const char *repo_root)
+{
+    char dir[1024];
+    int is_dir;
+
+    if (!repo_root || !repo_root[0]) return 0;
+    if (!tbl_path_join2(dir, sizeof(dir), repo_root, "jobstore")) return 0;
+    is_dir = 0;
+    if (tbl_fs_is_dir(dir, &is_dir) != 0) return 0;
+    return is_dir ? 1 : 0;
+}
+
+int tbl_jobstore_create(const char *repo_root, char *err, size_t errsz)
+{
+    char dir[1024];
+
+    if (!repo_root || !repo_root[0] || !tbl_path_join2(dir, sizeof(dir), repo_root, "jobstore")) {
+        tbl_jobstore_seterr(err, errsz, "job store path too long");
+        return 2;
+    }
+    if (tbl_fs_mkdir_p(dir) != 0) {
+        tbl_jobstore_seterr(err, errsz, "cannot create jobstore directory");
+        return 2;
+    }
+    return 0;
+}
+
+unsigned long tbl_jobstore_bucket(const char *jobid)
+{
+    unsigned long h;
+    const unsigned char *p;
+
+    /* FNV-1a, 32 bit */
+    h = 2166136261UL;
+    for (p = (const unsigned char *)(jobid ? jobid : ""); *p; ++p) {
+        h ^= (unsigned long)*p;
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+    return h % TBL_JOBSTORE_BUCKETS;
+}
+
+int tbl_jobstore_bucket_path_ok(const char *repo_root, const char *jobid, char *out, size_t outsz)
+{
+    static const char hex[] = "0123456789abcdef";
+    char name[16];
+    char dir[1024];
+    unsigned long b;
+
+    if (!repo_root || !repo_root[0] || !jobid || !jobid[0] || !out || outsz == 0) return 0;
+    b = tbl_jobstore_bucket(jobid);
+    name[0] = hex[(b >> 8) & 0xfUL];
+    name[1] = hex[(b >> 4) & 0xfUL];
+    name[2] = hex[b & 0xfUL];
+    name[3] = '\0';
+    if (!tbl_strlcat_ok(name, ".log", sizeof(name))) return 0;
+    return tbl_path_join2(dir, sizeof(dir), repo_root, "jobstore") &&
+           tbl_path_join2(out, outsz, dir, name);
+}
+
+int tbl_jobstore_jobid_ok(const char *jobid)
+{
+    size_t i;
+
+    if (!jobid || !jobid[0]) return 0;
+    for (i = 0; jobid[i]; ++i) {
+        unsigned char c = (unsigned char)jobid[i];
+        if (c <= ' ' || c == 0x7f) return 0;
+        if (i >= 127U) return 0;
+    }
+    return 1;
+}
+
+int tbl_jobstore_each(const char *repo_root, const char *jobid, tbl_jobstore_line_fn fn, void *ud,
+                      unsigned long *out_lines, char *err, size_t errsz)
+{
+    char path[1024];
+    char line[TBL_JOBSTORE_LINE_MAX];
+    FILE *fp;
+    size_t jl;
+    unsigned long n;
+    int skipping;
+
+    if (out_lines) *out_lines = 0UL;
+    if (!repo_root || !repo_root[0] || !jobid || !jobid[0] || !fn) {
+        tbl_jobstore_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_jobstore_jobid_ok(jobid)) return 0; /* cannot be in the store */
+    if (!tbl_jobstore_bucket_path_ok(repo_root, jobid, path, sizeof(path))) {
+        tbl_jobstore_seterr(err, errsz, "job store path too long");
+        return 2;
+    }
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    jl = strlen(jobid);
+    n = 0UL;
+    skipping = 0;
+    while (fgets(line, (int)sizeof(line), fp) != 0) {
+        size_t len = strlen(line);
+        int whole = (len > 0 && line[len - 1] == '\n') ? 1 : 0;
+
+        /* rest of an overlong record: not ours to parse */
+        if (skipping) {
+            if (whole) skipping = 0;
+            continue;
+        }
+        if (!whole && !feof(fp)) skipping = 1;
+
+        if (len > jl + 1U && memcmp(line, jobid, jl) == 0 && line[jl] == ' ') {
+            n++;
+            if (fn(ud, line + jl + 1U, len - jl - 1U) != 0) break;
+        }
+    }
+    if (ferror(fp)) {
+        fclose(fp);
+        tbl_jobstore_seterr2(err, errsz, "read error: ", path);
+        return 2;
+    }
+    fclose(fp);
+
+    if (out_lines) *out_lines = n;
+    return 0;
+}
+
+/* ---- migration ---- */
+
+typedef struct tbl_jobstore_mig_s {
+    const char *repo_root;
+    char jobs_dir[1024];
+    char pending[1024];
+    unsigned long jobs;
+    unsigned long lines;
+    int failed;
+    char *err;
+    size_t errsz;
+} tbl_jobstore_mig_t;
+
+static int tbl_jobstore_size_ok(const char *path, unsigned long *out)
+{
+    FILE *fp;
+    long n;
+
+    *out = 0UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 1; /* missing: empty */
+    n = (fseek(fp, 0L, SEEK_END) == 0) ? ftell(fp) : -1L;
+    fclose(fp);
+    if (n < 0L) return 0;
+    *out = (unsigned long)n;
+    return 1;
+}
+
+/* Read a per-job events.log and turn it into bucket records.
+   A torn last line gets its LF so the bucket stays line-framed. */
+static int tbl_jobstore_load_records(const char *path, const char *jobid,
+                                     char **out, size_t *out_len, unsigned long *out_lines)
+{
+    FILE *fp;
+    char line[TBL_JOBSTORE_LINE_MAX];
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t jl;
+    unsigned long n;
+    int at_start;
+
+    *out = 0;
+    *out_len = 0;
+    *out_lines = 0UL;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    jl = strlen(jobid);
+    buf = 0;
+    len = 0;
+    cap = 0;
+    n = 0UL;
+    at_start = 1;
+    while (fgets(line, (int)sizeof(line), fp) != 0) {
+        size_t ll = strlen(line);
+        size_t need;
+
+        if (at_start && (ll == 0 || line[0] == '\n')) continue;
+        need = len + (at_start ? jl + 1U : 0U) + ll + 1U;
+        if (need > cap) {
+            size_t ncap = cap ? cap : 4096U;
+            char *nb;
+
+            while (ncap < need) {
+                if (ncap > ((size_t)-1) / 2U) { free(buf); fclose(fp); return 0; }
+                ncap *= 2U;
+            }
+            nb = (char *)realloc(buf, ncap);
+            if (!nb) { free(buf); fclose(fp); return 0; }
+            buf = nb;
+            cap = ncap;
+        }
+        if (at_start) {
+            (void)memcpy(buf + len, jobid, jl);
+            len += jl;
+            buf[len++] = ' ';
+            n++;
+        }
+        (void)memcpy(buf + len, line, ll);
+        len += ll;
+        at_start = (line[ll - 1] == '\n') ? 1 : 0;
+    }
+    if (ferror(fp)) {
+        free(buf);
+        fclose(fp);
+        return 0;
+    }
+    fclose(fp);
+    if (!at_start) buf[len++] = '\n';
+
+    *out = buf;
+    *out_len = len;
+    *out_lines = n;
+    return 1;
+}
+
+/* 1 if the bucket holds exactly data at offset off (through EOF). */
+static int tbl_jobstore_tail_is(const char *path, unsigned long off, const char *data, size_t len)
+{
+    FILE *fp;
+    char buf[4096];
+    size_t pos;
+    size_t got;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+    if (off > (unsigned long)LONG_MAX || fseek(fp, (long)off, SEEK_SET) != 0) {
+        fclose(fp);
+        return 0;
+    }
+    pos = 0;
+    while ((got = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        if (got > len - pos || memcmp(buf, data + pos, got) != 0) {
+            fclose(fp);
+            return 0;
+        }
+        pos += got;
+    }
+    fclose(fp);
+    return (pos == len) ? 1 : 0;
+}
+
+static void tbl_jobstore_drop_source(const char *job_path, const char *job_dir)
+{
+    (void)tbl_fs_remove_file(job_path);
+    (void)tbl_fs_remove_dir(job_dir); /* only if empty */
+}
+
+static int tbl_jobstore_write_pending(const char *path, const char *jobid, unsigned long off)
+{
+    char tmp[1100];
+    char buf[200];
+    char nbuf[32];
+
+    if (!tbl_strlcpy_ok(tmp, path, sizeof(tmp)) || !tbl_strlcat_ok(tmp, ".tmp", sizeof(tmp))) return 0;
+    if (!tbl_ul_to_dec_ok(off, nbuf, sizeof(nbuf))) return 0;
+    if (!tbl_strlcpy_ok(buf, jobid, sizeof(buf)) ||
+        !tbl_strlcat_ok(buf, " ", sizeof(buf)) ||
+        !tbl_strlcat_ok(buf, nbuf, sizeof(buf)) ||
+        !tbl_strlcat_ok(buf, "\n", sizeof(buf))) {
+        return 0;
+    }
+    if (tbl_fs_write_file(tmp, buf, strlen(buf)) != 0) return 0;
+    return (tbl_fs_rename_atomic(tmp, path, 1) == 0) ? 1 : 0;
+}
+
+/* Move one job. resume_off != (unsigned long)-1: a previous run may have
+   appended the records at that bucket offset already. */
+static int tbl_jobstore_migrate_one(tbl_jobstore_mig_t *m, const char *jobid, unsigned long resume_off)
+{
+    char job_dir[1024];
+    char job_path[1024];
+    char bucket[1024];
+    char *rec;
+    size_t rlen;
+    unsigned long nlines;
+    unsigned long off;
+    tbl_fs_afile_t af;
+    int ex;
+
+    if (!tbl_jobstore_jobid_ok(jobid)) {
+        tbl_jobstore_seterr2(m->err, m->errsz, "invalid job directory name: ", jobid);
+        return 0;
+    }
+    if (!tbl_path_join2(job_dir, sizeof(job_dir), m->jobs_dir, jobid) ||
+        !tbl_path_join2(job_path, sizeof(job_path), job_dir, "events.log") ||
+        !tbl_jobstore_bucket_path_ok(m->repo_root, jobid, bucket, sizeof(bucket))) {
+        tbl_jobstore_seterr(m->err, m->errsz, "job store path too long");
+        return 0;
+    }
+
+    ex = 0;
+    (void)tbl_fs_exists(job_path, &ex);
+    if (!ex) {
+        (void)tbl_fs_remove_dir(job_dir);
+        return 1;
+    }
+
+    if (!tbl_jobstore_load_records(job_path, jobid, &rec, &rlen, &nlines)) {
+        tbl_jobstore_seterr2(m->err, m->errsz, "cannot read ", job_path);
+        return 0;
+    }
+    if (!tbl_jobstore_size_ok(bucket, &off)) {
+        free(rec);
+        tbl_jobstore_seterr2(m->err, m->errsz, "cannot stat ", bucket);
+        return 0;
+    }
+
+    if (resume_off != (unsigned long)-1) {
+        if (off > resume_off) {
+            if (!tbl_jobstore_tail_is(bucket, resume_off, rec, rlen)) {
+                free(rec);
+                tbl_jobstore_seterr2(m->err, m->errsz,
+                                     "interrupted migration left a partial record in ", bucket);
+                return 0;
+            }
+            /* appended before the interruption: only the source is left */
+            free(rec);
+            tbl_jobstore_drop_source(job_path, job_dir);
+            m->jobs++;
+            m->lines += nlines;
+            return 1;
+        }
+    }
+
+    if (rlen > 0) {
+        if (!tbl_jobstore_write_pending(m->pending, jobid, off)) {
+            free(rec);
+            tbl_jobstore_seterr(m->err, m->errsz, "cannot write migrate.pending");
+            return 0;
+        }
+        if (tbl_fs_afile_open(&af, bucket) != 0) {
+            free(rec);
+            tbl_jobstore_seterr2(m->err, m->errsz, "cannot open ", bucket);
+            return 0;
+        }
+        if (tbl_fs_afile_write(&af, rec, rlen) != 0 || tbl_fs_afile_sync(&af) != 0) {
+            (void)tbl_fs_afile_close(&af);
+            free(rec);
+            tbl_jobstore_seterr2(m->err, m->errsz, "cannot append to ", bucket);
+            return 0;
+        }
+        (void)tbl_fs_afile_close(&af);
+    }
+    free(rec);
+
+    tbl_jobstore_drop_source(job_path, job_dir);
+    m->jobs++;
+    m->lines += nlines;
+    return 1;
+}
+
+static int tbl_jobstore_mig_cb(void *ud, const char *name, const char *fullpath, int is_dir)
+{
+    tbl_jobstore_mig_t *m = (tbl_jobstore_mig_t *)ud;
+
+    (void)fullpath;
+    if (!is_dir) return 0;
+    if (!tbl_jobstore_migrate_one(m, name, (unsigned long)-1)) {
+        m->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/* Finish the job named in migrate.pending ("<jobid> <bucket offset>"). */
+static int tbl_jobstore_resume(tbl_jobstore_mig_t *m)
+{
+    FILE *fp;
+    char buf[200];
+    char *sp;
+    size_t n;
+    unsigned long off;
+
+    fp = fopen(m->pending, "rb");
+    if (!fp) return 1;
+    n = fread(buf, 1, sizeof(buf) - 1U, fp);
+    fclose(fp);
+    buf[n] = '\0';
+    if (n > 0 && buf[n - 1] == '\n') buf[--n] = '\0';
+
+    sp = strchr(buf, ' ');
+    if (!sp || !tbl_parse_u32_ok(sp + 1, &off)) {
+        tbl_jobstore_seterr(m->err, m->errsz, "invalid migrate.pending");
+        return 0;
+    }
+    *sp = '\0';
+    return tbl_jobstore_migrate_one(m, buf, off);
+}
+
+int tbl_jobstore_migrate(const char *repo_root, unsigned long *out_jobs, unsigned long *out_lines,
+                         char *err, size_t errsz)
+{
+    tbl_jobstore_mig_t m;
+    char dir[1024];
+    int is_dir;
+
+    if (out_jobs) *out_jobs = 0UL;
+    if (out_lines) *out_lines = 0UL;
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0]) {
+        tbl_jobstore_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+
+    (void)memset(&m, 0, sizeof(m));
+    m.repo_root = repo_root;
+    m.err = err;
+    m.errsz = errsz;
+    if (!tbl_path_join2(m.jobs_dir, sizeof(m.jobs_dir), repo_root, "jobs") ||
+        !tbl_path_join2(dir, sizeof(dir), repo_root, "jobstore") ||
+        !tbl_path_join2(m.pending, sizeof(m.pending), dir, "migrate.pending")) {
+        tbl_jobstore_seterr(err, errsz, "job store path too long");
+        return 2;
+    }
+    if (tbl_jobstore_create(repo_root, err, errsz) != 0) return 2;
+
+    if (!tbl_jobstore_resume(&m)) return 2;
+
+    is_dir = 0;
+    (void)tbl_fs_is_dir(m.jobs_dir, &is_dir);
+    if (is_dir) {
+        if (tbl_fs_list_dir(m.jobs_dir, tbl_jobstore_mig_cb, &m) != 0 && !m.failed) {
+            tbl_jobstore_seterr(err, errsz, "cannot list jobs directory");
+            return 2;
+        }
+        if (m.failed) return 2;
+        (void)tbl_fs_remove_dir(m.jobs_dir); /* only if empty */
+    }
+    (void)tbl_fs_remove_file(m.pending);
+
+    if (out_jobs) *out_jobs = m.jobs;
+    if (out_lines) *out_lines = m.lines;
+    return 0;
+}
+
+#endif /* TBL_JOBSTORE_IMPLEMENTATION */
+
+#endif /* TBL_CORE_JOBSTORE_H */
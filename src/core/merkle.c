@@ -0,0 +1,2 @@
+#define TBL_MERKLE_IMPLEMENTATION
+#include "core/merkle.h"
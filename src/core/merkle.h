@@ -0,0 +1,864 @@
+#ifndef TBL_CORE_MERKLE_H
+#define TBL_CORE_MERKLE_H
+
+#include <stddef.h>
+
+/* Merkle tree over the ops audit chain (RFC 6962 / RFC 9162 layout).
+ *   leaf i = SHA-256(0x00 || line i of the chain, without LF)
+ *   node   = SHA-256(0x01 || left || right)
+ * Leaves are numbered across segments: leaf 0 is the first line of
+ * ops.000001.log (or of ops.log without segmentation).
+ *
+ * Kept incrementally under <repo_root>/audit/merkle/:
+ *   level.NN   complete subtree hashes of height NN, 32 raw bytes each
+ *   state      size=, segment=, offset= (chain position consumed so far)
+ *   roots.log  one "size=<n> root=<hex> ts=<t>" line per sync that grew
+ * Level files are only appended; a sync hashes just the new lines and
+ * proofs read O(log n) stored nodes. Level files that disagree with the
+ * state (interrupted sync) are dropped and rebuilt from the log.
+ */
+
+/* Upper bound for proof lengths (tree height). */
+#define TBL_MERKLE_MAX_PATH 64
+
+/* Per-line callback for tbl_merkle_each_line(): return 0 to continue,
+ * 1 to stop, 2 on error. len excludes the LF. */
+typedef int (*tbl_merkle_line_fn)(void *ud, unsigned long leaf, const char *line, size_t len);
+
+/* Append all complete chain lines not yet in the tree, then checkpoint
+ * the root in roots.log. out_size/out_root (64 hex) describe the tree.
+ * Returns 0 ok, 2 error. */
+int tbl_merkle_sync(const char *repo_root, unsigned long *out_size, char out_root[65],
+                    char *err, size_t errsz);
+
+/* Root of the first size leaves (size <= synced size). 0 ok, 2 error. */
+int tbl_merkle_root(const char *repo_root, unsigned long size, unsigned char out[32],
+                    char *err, size_t errsz);
+
+/* Inclusion proof for leaf in the tree of the first size leaves.
+ * path is ordered bottom-up; *out_n <= TBL_MERKLE_MAX_PATH. 0 ok, 2 error. */
+int tbl_merkle_inclusion(const char *repo_root, unsigned long leaf, unsigned long size,
+                         unsigned char path[][32], unsigned long *out_n,
+                         char *err, size_t errsz);
+
+/* Consistency proof between the trees of old_size and size leaves
+ * (0 < old_size <= size). 0 ok, 2 error. */
+int tbl_merkle_consistency(const char *repo_root, unsigned long old_size, unsigned long size,
+                           unsigned char path[][32], unsigned long *out_n,
+                           char *err, size_t errsz);
+
+/* Walk the chain lines in leaf order. 0 ok (end or stopped), 2 error. */
+int tbl_merkle_each_line(const char *repo_root, tbl_merkle_line_fn fn, void *ud,
+                         char *err, size_t errsz);
+
+void tbl_merkle_leaf_hash(const char *line, size_t len, unsigned char out[32]);
+
+/* Proof checks (RFC 9162 2.1.3.2 / 2.1.4.2); need no repository. */
+int tbl_merkle_verify_inclusion_ok(unsigned long leaf, unsigned long size,
+                                   const unsigned char leaf_hash[32],
+                                   unsigned char path[][32], unsigned long n,
+                                   const unsigned char root[32]);
+int tbl_merkle_verify_consistency_ok(unsigned long old_size, unsigned long size,
+                                     const unsigned char old_root[32], const unsigned char root[32],
+                                     unsigned char path[][32], unsigned long n);
+
+#ifdef TBL_MERKLE_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/audit.h"
+#include "core/path.h"
+#include "core/safe.h"
+#include "core/sha256.h"
+#include "core/str.h"
+#include "core/tlz.h"
+#include "os/fs.h"
+
+typedef struct tbl_merkle_s {
+    char dir[1024];
+    unsigned long size;
+    unsigned long seg;      /* chain file holding offset */
+    unsigned long off;
+    unsigned char front[TBL_MERKLE_MAX_PATH][32]; /* unpaired node per level */
+    FILE *ap[TBL_MERKLE_MAX_PATH];                /* append handles (sync) */
+    FILE *rd[TBL_MERKLE_MAX_PATH];                /* read handles (proofs) */
+} tbl_merkle_t;
+
+static void tbl_merkle_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "merkle error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+void tbl_merkle_leaf_hash(const char *line, size_t len, unsigned char out[32])
+{
+    tbl_sha256_t st;
+    unsigned char pfx = 0;
+
+    tbl_sha256_init(&st);
+    tbl_sha256_update(&st, &pfx, 1);
+    tbl_sha256_update(&st, line, len);
+    tbl_sha256_final(&st, out);
+}
+
+/* out may alias l or r */
+static void tbl_merkle_node(const unsigned char l[32], const unsigned char r[32], unsigned char out[32])
+{
+    tbl_sha256_t st;
+    unsigned char pfx = 1;
+
+    tbl_sha256_init(&st);
+    tbl_sha256_update(&st, &pfx, 1);
+    tbl_sha256_update(&st, l, 32);
+    tbl_sha256_update(&st, r, 32);
+    tbl_sha256_final(&st, out);
+}
+
+/* Largest power of two below n (n >= 2). */
+static unsigned long tbl_merkle_split(unsigned long n)
+{
+    unsigned long k = 1UL;
+    while (k * 2UL < n) k *= 2UL;
+    return k;
+}
+
+static void tbl_merkle_reverse(unsigned char path[][32], unsigned long n)
+{
+    unsigned char t[32];
+    unsigned long i;
+
+    for (i = 0UL; i < n / 2UL; ++i) {
+        (void)memcpy(t, path[i], 32);
+        (void)memcpy(path[i], path[n - 1UL - i], 32);
+        (void)memcpy(path[n - 1UL - i], t, 32);
+    }
+}
+
+/* ---- storage ---- */
+
+static int tbl_merkle_level_path(const tbl_merkle_t *m, unsigned long lvl, char *out, size_t outsz)
+{
+    char name[16];
+
+    (void)tbl_strlcpy(name, "level.00", sizeof(name));
+    name[6] = (char)('0' + (int)(lvl / 10UL));
+    name[7] = (char)('0' + (int)(lvl % 10UL));
+    return tbl_path_join2(out, outsz, m->dir, name);
+}
+
+/* Size of a file in bytes; a missing file counts as empty. */
+static int tbl_merkle_file_size(const char *path, unsigned long *out)
+{
+    FILE *fp;
+    long n;
+
+    *out = 0UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    n = (fseek(fp, 0L, SEEK_END) == 0) ? ftell(fp) : -1L;
+    fclose(fp);
+    if (n < 0L) return 0;
+    *out = (unsigned long)n;
+    return 1;
+}
+
+static int tbl_merkle_get(tbl_merkle_t *m, unsigned long lvl, unsigned long idx, unsigned char out[32])
+{
+    char p[1100];
+
+    if (lvl >= (unsigned long)TBL_MERKLE_MAX_PATH) return 0;
+    if (!m->rd[lvl]) {
+        if (!tbl_merkle_level_path(m, lvl, p, sizeof(p))) return 0;
+        m->rd[lvl] = fopen(p, "rb");
+        if (!m->rd[lvl]) return 0;
+    }
+    if (idx > (unsigned long)LONG_MAX / 32UL) return 0;
+    if (fseek(m->rd[lvl], (long)(idx * 32UL), SEEK_SET) != 0) return 0;
+    return (fread(out, 1, 32, m->rd[lvl]) == 32U) ? 1 : 0;
+}
+
+static int tbl_merkle_put(tbl_merkle_t *m, unsigned long lvl, const unsigned char h[32])
+{
+    char p[1100];
+
+    if (lvl >= (unsigned long)TBL_MERKLE_MAX_PATH) return 0;
+    if (!m->ap[lvl]) {
+        if (!tbl_merkle_level_path(m, lvl, p, sizeof(p))) return 0;
+        m->ap[lvl] = fopen(p, "ab");
+        if (!m->ap[lvl]) return 0;
+    }
+    return (fwrite(h, 1, 32, m->ap[lvl]) == 32U) ? 1 : 0;
+}
+
+/* Close all handles; 0 if a buffered append failed. */
+static int tbl_merkle_close(tbl_merkle_t *m)
+{
+    unsigned long i;
+    int ok = 1;
+
+    for (i = 0UL; i < (unsigned long)TBL_MERKLE_MAX_PATH; ++i) {
+        if (m->ap[i] && fclose(m->ap[i]) != 0) ok = 0;
+        if (m->rd[i]) fclose(m->rd[i]);
+        m->ap[i] = NULL;
+        m->rd[i] = NULL;
+    }
+    return ok;
+}
+
+static int tbl_merkle_parse_ul(const char *s, unsigned long *out)
+{
+    char *end = 0;
+    unsigned long v;
+
+    if (!s || !(*s >= '0' && *s <= '9')) return 0;
+    v = strtoul(s, &end, 10);
+    if (!end || *end != '\0') return 0;
+    *out = v;
+    return 1;
+}
+
+/* Load the state file; a missing or malformed one means an empty tree. */
+static int tbl_merkle_open(tbl_merkle_t *m, const char *repo_root, char *err, size_t errsz)
+{
+    char p[1100];
+    FILE *fp;
+
+    (void)memset(m, 0, sizeof(*m));
+    m->seg = 1UL;
+    if (!repo_root || !repo_root[0]) {
+        tbl_merkle_seterr(err, errsz, "invalid args");
+        return 0;
+    }
+    if (!tbl_path_join2(m->dir, sizeof(m->dir), repo_root, "audit/merkle") ||
+        !tbl_path_join2(p, sizeof(p), m->dir, "state")) {
+        tbl_merkle_seterr(err, errsz, "merkle path too long");
+        return 0;
+    }
+
+    fp = fopen(p, "rb");
+    if (fp) {
+        char line[128];
+        unsigned long size = 0UL, seg = 0UL, off = 0UL;
+        int have = 0;
+
+        while (fgets(line, (int)sizeof(line), fp) != NULL) {
+            size_t n;
+            char *v;
+
+            n = strlen(line);
+            if (n == 0 || line[n - 1] != '\n') { have = -1; break; }
+            line[n - 1] = '\0';
+            v = strchr(line, '=');
+            if (!v) { have = -1; break; }
+            *v++ = '\0';
+            if (tbl_streq(line, "size") && tbl_merkle_parse_ul(v, &size)) have |= 1;
+            else if (tbl_streq(line, "segment") && tbl_merkle_parse_ul(v, &seg) && seg > 0UL) have |= 2;
+            else if (tbl_streq(line, "offset") && tbl_merkle_parse_ul(v, &off)) have |= 4;
+            else if (tbl_streq(line, "root")) continue;
+            else { have = -1; break; }
+        }
+        fclose(fp);
+        if (have == 7) {
+            m->size = size;
+            m->seg = seg;
+            m->off = off;
+        }
+    }
+    return 1;
+}
+
+/* Level file NN must hold exactly size >> NN nodes; reload the frontier. */
+static int tbl_merkle_check_levels(tbl_merkle_t *m)
+{
+    char p[1100];
+    unsigned long lvl;
+    unsigned long cnt;
+    unsigned long bytes;
+
+    cnt = m->size;
+    for (lvl = 0UL; lvl < (unsigned long)TBL_MERKLE_MAX_PATH; ++lvl) {
+        if (!tbl_merkle_level_path(m, lvl, p, sizeof(p))) return 0;
+        if (!tbl_merkle_file_size(p, &bytes)) return 0;
+        if (cnt > ULONG_MAX / 32UL || bytes != cnt * 32UL) return 0;
+        if (cnt & 1UL) {
+            if (!tbl_merkle_get(m, lvl, cnt - 1UL, m->front[lvl])) return 0;
+        }
+        cnt >>= 1;
+    }
+    return 1;
+}
+
+static int tbl_merkle_reset(tbl_merkle_t *m)
+{
+    char p[1100];
+    unsigned long lvl;
+    int ex;
+
+    (void)tbl_merkle_close(m);
+    for (lvl = 0UL; lvl < (unsigned long)TBL_MERKLE_MAX_PATH; ++lvl) {
+        if (!tbl_merkle_level_path(m, lvl, p, sizeof(p))) return 0;
+        ex = 0;
+        (void)tbl_fs_exists(p, &ex);
+        if (ex && tbl_fs_remove_file(p) != 0) return 0;
+    }
+    m->size = 0UL;
+    m->seg = 1UL;
+    m->off = 0UL;
+    return 1;
+}
+
+static int tbl_merkle_write_state(tbl_merkle_t *m, const char root_hex[65])
+{
+    char p[1100];
+    char tmp[1100];
+    char buf[256];
+    char nbuf[32];
+
+    buf[0] = '\0';
+    if (!tbl_ul_to_dec_ok(m->size, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(buf, "size=", sizeof(buf));
+    (void)tbl_strlcat(buf, nbuf, sizeof(buf));
+    if (!tbl_ul_to_dec_ok(m->seg, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(buf, "\nsegment=", sizeof(buf));
+    (void)tbl_strlcat(buf, nbuf, sizeof(buf));
+    if (!tbl_ul_to_dec_ok(m->off, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(buf, "\noffset=", sizeof(buf));
+    (void)tbl_strlcat(buf, nbuf, sizeof(buf));
+    (void)tbl_strlcat(buf, "\nroot=", sizeof(buf));
+    (void)tbl_strlcat(buf, root_hex, sizeof(buf));
+    (void)tbl_strlcat(buf, "\n", sizeof(buf));
+
+    if (!tbl_path_join2(p, sizeof(p), m->dir, "state")) return 0;
+    if (!tbl_strlcpy_ok(tmp, p, sizeof(tmp)) || !tbl_strlcat_ok(tmp, ".tmp", sizeof(tmp))) return 0;
+    if (tbl_fs_write_file(tmp, buf, strlen(buf)) != 0) return 0;
+    if (tbl_fs_rename_atomic(tmp, p, 1) != 0) {
+        (void)tbl_fs_remove_file(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+static int tbl_merkle_log_root(tbl_merkle_t *m, const char root_hex[65])
+{
+    char p[1100];
+    char line[256];
+    char nbuf[32];
+    FILE *fp;
+    int ok;
+
+    line[0] = '\0';
+    if (!tbl_ul_to_dec_ok(m->size, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(line, "size=", sizeof(line));
+    (void)tbl_strlcat(line, nbuf, sizeof(line));
+    (void)tbl_strlcat(line, " root=", sizeof(line));
+    (void)tbl_strlcat(line, root_hex, sizeof(line));
+    if (!tbl_ul_to_dec_ok((unsigned long)time(0), nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcat(line, " ts=", sizeof(line));
+    (void)tbl_strlcat(line, nbuf, sizeof(line));
+    (void)tbl_strlcat(line, "\n", sizeof(line));
+
+    if (!tbl_path_join2(p, sizeof(p), m->dir, "roots.log")) return 0;
+    fp = fopen(p, "ab");
+    if (!fp) return 0;
+    ok = (fputs(line, fp) != EOF) ? 1 : 0;
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+/* ---- tree ---- */
+
+/* Append leaf m->size: climb while it completes a right child. */
+static int tbl_merkle_add(tbl_merkle_t *m, const unsigned char leaf[32])
+{
+    unsigned char cur[32];
+    unsigned long idx;
+    unsigned long lvl;
+
+    (void)memcpy(cur, leaf, 32);
+    idx = m->size;
+    for (lvl = 0UL; lvl < (unsigned long)TBL_MERKLE_MAX_PATH; ++lvl) {
+        if (!tbl_merkle_put(m, lvl, cur)) return 0;
+        if ((idx & 1UL) == 0UL) {
+            (void)memcpy(m->front[lvl], cur, 32);
+            break;
+        }
+        tbl_merkle_node(m->front[lvl], cur, cur);
+        idx >>= 1;
+    }
+    m->size++;
+    return 1;
+}
+
+/* Hash of leaves [a, b) (b > a): stored node if aligned, else split. */
+static int tbl_merkle_mth(tbl_merkle_t *m, unsigned long a, unsigned long b, unsigned char out[32])
+{
+    unsigned char l[32];
+    unsigned char r[32];
+    unsigned long n;
+    unsigned long w;
+    unsigned long lvl;
+    unsigned long k;
+
+    n = b - a;
+    w = 1UL;
+    lvl = 0UL;
+    while (w < n) { w *= 2UL; lvl++; }
+    if (w == n && a % n == 0UL) return tbl_merkle_get(m, lvl, a / n, out);
+
+    k = tbl_merkle_split(n);
+    if (!tbl_merkle_mth(m, a, a + k, l) || !tbl_merkle_mth(m, a + k, b, r)) return 0;
+    tbl_merkle_node(l, r, out);
+    return 1;
+}
+
+static int tbl_merkle_root_of(tbl_merkle_t *m, unsigned long size, unsigned char out[32])
+{
+    if (size == 0UL) {
+        tbl_sha256_t st;
+        tbl_sha256_init(&st);
+        tbl_sha256_final(&st, out);
+        return 1;
+    }
+    return tbl_merkle_mth(m, 0UL, size, out);
+}
+
+/* ---- chain reader ---- */
+
+/* Lines of a compressed (sealed) segment from *off on, block by block. */
+static int tbl_merkle_read_tlz(const char *path, unsigned long *off, unsigned long *leaf,
+                               tbl_merkle_line_fn fn, void *ud, char *err, size_t errsz)
+{
+    tbl_tlz_t z;
+    char *buf;
+    int rc;
+
+    if (tbl_tlz_open(&z, path, err, errsz) != 0) return 2;
+    if (*off > z.raw_size) {
+        tbl_tlz_close(&z);
+        tbl_merkle_seterr(err, errsz, "merkle state does not match log");
+        return 3;
+    }
+    buf = (char *)malloc((size_t)TBL_TLZ_BLOCK_MAX);
+    if (!buf) {
+        tbl_tlz_close(&z);
+        tbl_merkle_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+
+    rc = 0;
+    while (rc == 0 && *off < z.raw_size) {
+        const tbl_tlz_ent_t *e = &z.ent[tbl_tlz_block_at(&z, *off)];
+        size_t n = (size_t)(e->raw_off + e->raw_len - *off);
+        size_t i;
+
+        if (!tbl_tlz_pread_ok(&z, *off, buf, n)) {
+            tbl_merkle_seterr(err, errsz, "cannot read audit log");
+            rc = 2;
+            break;
+        }
+        i = 0;
+        while (i < n) {
+            const char *lf = (const char *)memchr(buf + i, '\n', n - i);
+            size_t len;
+
+            if (!lf) {
+                /* blocks hold whole lines */
+                tbl_merkle_seterr(err, errsz, "audit line too long or without LF");
+                rc = 2;
+                break;
+            }
+            len = (size_t)(lf - (buf + i));
+            rc = fn(ud, *leaf, buf + i, len);
+            if (rc != 0) break;
+            (*leaf)++;
+            *off += (unsigned long)len + 1UL;
+            i += len + 1U;
+        }
+    }
+    free(buf);
+    tbl_tlz_close(&z);
+    return rc;
+}
+
+/* Feed complete lines from (*seg, *off) on; advances the position past
+ * every line handed to fn (fn returning 1 stops before advancing).
+ * Returns 0 ok, 2 error, 3 position not in the log. */
+static int tbl_merkle_read(const char *repo_root, unsigned long *seg, unsigned long *off,
+                           unsigned long leaf, tbl_merkle_line_fn fn, void *ud,
+                           char *err, size_t errsz)
+{
+    char buf[TBL_AUDIT_LINE_MAX];
+    char p[1100];
+    unsigned long sealed;
+    unsigned long end;
+
+    sealed = tbl_audit_sealed_count(repo_root);
+    if (*seg > sealed + 1UL) {
+        tbl_merkle_seterr(err, errsz, "merkle state does not match log");
+        return 3;
+    }
+
+    for (;;) {
+        FILE *fp;
+        int active;
+        int rc;
+
+        active = (*seg > sealed) ? 1 : 0;
+        if (!tbl_audit_chain_path_ok(repo_root, *seg, sealed, p, sizeof(p))) {
+            tbl_merkle_seterr(err, errsz, "audit path too long");
+            return 2;
+        }
+        if (!active && tbl_audit_path_tlz_ok(p)) {
+            rc = tbl_merkle_read_tlz(p, off, &leaf, fn, ud, err, errsz);
+            if (rc != 0) return (rc == 1) ? 0 : rc;
+            *seg += 1UL;
+            *off = 0UL;
+            continue;
+        }
+        fp = fopen(p, "rb");
+        if (!fp && active) return 0; /* sealed, next segment not started yet */
+        if (!fp) {
+            tbl_merkle_seterr(err, errsz, "cannot open audit log");
+            return 2;
+        }
+        if (!tbl_merkle_file_size(p, &end) || *off > end || *off > (unsigned long)LONG_MAX ||
+            fseek(fp, (long)*off, SEEK_SET) != 0) {
+            fclose(fp);
+            tbl_merkle_seterr(err, errsz, "merkle state does not match log");
+            return 3;
+        }
+
+        rc = 0;
+        while (fgets(buf, (int)sizeof(buf), fp) != NULL) {
+            size_t n = strlen(buf);
+
+            if (n == 0 || buf[n - 1] != '\n') {
+                if (!feof(fp) || !active) {
+                    tbl_merkle_seterr(err, errsz, "audit line too long or without LF");
+                    rc = 2;
+                }
+                break; /* torn tail of the active log: not part of the tree yet */
+            }
+            rc = fn(ud, leaf, buf, n - 1U);
+            if (rc != 0) break;
+            leaf++;
+            *off += (unsigned long)n;
+        }
+        if (rc == 0 && ferror(fp)) {
+            tbl_merkle_seterr(err, errsz, "cannot read audit log");
+            rc = 2;
+        }
+        fclose(fp);
+        if (rc == 2) return 2;
+        if (rc != 0 || active) return 0;
+        *seg += 1UL;
+        *off = 0UL;
+    }
+}
+
+static int tbl_merkle_add_cb(void *ud, unsigned long leaf, const char *line, size_t len)
+{
+    tbl_merkle_t *m = (tbl_merkle_t *)ud;
+    unsigned char h[32];
+
+    (void)leaf;
+    tbl_merkle_leaf_hash(line, len, h);
+    return tbl_merkle_add(m, h) ? 0 : 2;
+}
+
+/* ---- public ---- */
+
+int tbl_merkle_sync(const char *repo_root, unsigned long *out_size, char out_root[65],
+                    char *err, size_t errsz)
+{
+    tbl_merkle_t m;
+    unsigned char root[32];
+    char hex[65];
+    unsigned long before;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_size) *out_size = 0UL;
+    if (out_root) out_root[0] = '\0';
+
+    if (!tbl_merkle_open(&m, repo_root, err, errsz)) return 2;
+    if (tbl_fs_mkdir_p(m.dir) != 0) {
+        tbl_merkle_seterr(err, errsz, "cannot create audit/merkle");
+        return 2;
+    }
+
+    /* interrupted sync: level files ran ahead of the state */
+    if (!tbl_merkle_check_levels(&m) && !tbl_merkle_reset(&m)) {
+        tbl_merkle_seterr(err, errsz, "cannot reset merkle levels");
+        return 2;
+    }
+    (void)tbl_merkle_close(&m);
+
+    before = m.size;
+    rc = tbl_merkle_read(repo_root, &m.seg, &m.off, m.size, tbl_merkle_add_cb, &m, err, errsz);
+    if (rc == 3) {
+        /* log was rebuilt underneath the tree: start over */
+        if (!tbl_merkle_reset(&m)) {
+            tbl_merkle_seterr(err, errsz, "cannot reset merkle levels");
+            return 2;
+        }
+        before = 0UL;
+        rc = tbl_merkle_read(repo_root, &m.seg, &m.off, 0UL, tbl_merkle_add_cb, &m, err, errsz);
+    }
+    if (!tbl_merkle_close(&m) && rc == 0) {
+        tbl_merkle_seterr(err, errsz, "cannot write merkle levels");
+        rc = 2;
+    }
+    if (rc != 0) {
+        if (err && errsz && err[0] == '\0') tbl_merkle_seterr(err, errsz, "cannot write merkle levels");
+        return 2;
+    }
+
+    if (!tbl_merkle_root_of(&m, m.size, root)) {
+        (void)tbl_merkle_close(&m);
+        tbl_merkle_seterr(err, errsz, "cannot read merkle levels");
+        return 2;
+    }
+    (void)tbl_merkle_close(&m);
+    (void)tbl_sha256_hex_ok(root, hex, sizeof(hex));
+
+    /* state after the levels: a crash in between is caught on the next open */
+    if (!tbl_merkle_write_state(&m, hex)) {
+        tbl_merkle_seterr(err, errsz, "cannot write merkle state");
+        return 2;
+    }
+    if (m.size != before && !tbl_merkle_log_root(&m, hex)) {
+        tbl_merkle_seterr(err, errsz, "cannot append merkle roots.log");
+        return 2;
+    }
+
+    if (out_size) *out_size = m.size;
+    if (out_root) (void)tbl_strlcpy(out_root, hex, 65);
+    return 0;
+}
+
+int tbl_merkle_root(const char *repo_root, unsigned long size, unsigned char out[32],
+                    char *err, size_t errsz)
+{
+    tbl_merkle_t m;
+    int ok;
+
+    if (err && errsz) err[0] = '\0';
+    if (!tbl_merkle_open(&m, repo_root, err, errsz)) return 2;
+    if (size > m.size) {
+        tbl_merkle_seterr(err, errsz, "tree size out of range");
+        return 2;
+    }
+    ok = tbl_merkle_root_of(&m, size, out);
+    (void)tbl_merkle_close(&m);
+    if (!ok) {
+        tbl_merkle_seterr(err, errsz, "cannot read merkle levels");
+        return 2;
+    }
+    return 0;
+}
+
+int tbl_merkle_inclusion(const char *repo_root, unsigned long leaf, unsigned long size,
+                         unsigned char path[][32], unsigned long *out_n,
+                         char *err, size_t errsz)
+{
+    tbl_merkle_t m;
+    unsigned long a;
+    unsigned long b;
+    unsigned long n;
+    int ok;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_n) *out_n = 0UL;
+    if (!path || !out_n) {
+        tbl_merkle_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_merkle_open(&m, repo_root, err, errsz)) return 2;
+    if (size > m.size || leaf >= size) {
+        tbl_merkle_seterr(err, errsz, "leaf out of range");
+        return 2;
+    }
+
+    /* PATH(m, D[a:b]), collected top-down */
+    a = 0UL;
+    b = size;
+    n = 0UL;
+    ok = 1;
+    while (ok && b - a > 1UL) {
+        unsigned long k = tbl_merkle_split(b - a);
+        if (leaf < a + k) {
+            ok = tbl_merkle_mth(&m, a + k, b, path[n]);
+            b = a + k;
+        } else {
+            ok = tbl_merkle_mth(&m, a, a + k, path[n]);
+            a += k;
+        }
+        n++;
+    }
+    (void)tbl_merkle_close(&m);
+    if (!ok) {
+        tbl_merkle_seterr(err, errsz, "cannot read merkle levels");
+        return 2;
+    }
+    tbl_merkle_reverse(path, n);
+    *out_n = n;
+    return 0;
+}
+
+int tbl_merkle_consistency(const char *repo_root, unsigned long old_size, unsigned long size,
+                           unsigned char path[][32], unsigned long *out_n,
+                           char *err, size_t errsz)
+{
+    tbl_merkle_t m;
+    unsigned long a;
+    unsigned long b;
+    unsigned long mm;
+    unsigned long n;
+    int whole;
+    int ok;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_n) *out_n = 0UL;
+    if (!path || !out_n) {
+        tbl_merkle_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_merkle_open(&m, repo_root, err, errsz)) return 2;
+    if (size > m.size || old_size == 0UL || old_size > size) {
+        tbl_merkle_seterr(err, errsz, "tree size out of range");
+        return 2;
+    }
+    if (old_size == size) return 0;
+
+    /* SUBPROOF(mm, D[a:b], whole), collected top-down */
+    a = 0UL;
+    b = size;
+    mm = old_size;
+    whole = 1;
+    n = 0UL;
+    ok = 1;
+    while (ok) {
+        unsigned long k;
+
+        if (mm == b - a) {
+            if (!whole) ok = tbl_merkle_mth(&m, a, b, path[n++]);
+            break;
+        }
+        k = tbl_merkle_split(b - a);
+        if (mm <= k) {
+            ok = tbl_merkle_mth(&m, a + k, b, path[n++]);
+            b = a + k;
+        } else {
+            ok = tbl_merkle_mth(&m, a, a + k, path[n++]);
+            mm -= k;
+            a += k;
+            whole = 0;
+        }
+    }
+    (void)tbl_merkle_close(&m);
+    if (!ok) {
+        tbl_merkle_seterr(err, errsz, "cannot read merkle levels");
+        return 2;
+    }
+    tbl_merkle_reverse(path, n);
+    *out_n = n;
+    return 0;
+}
+
+int tbl_merkle_each_line(const char *repo_root, tbl_merkle_line_fn fn, void *ud,
+                         char *err, size_t errsz)
+{
+    unsigned long seg = 1UL;
+    unsigned long off = 0UL;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !fn) {
+        tbl_merkle_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    return (tbl_merkle_read(repo_root, &seg, &off, 0UL, fn, ud, err, errsz) == 0) ? 0 : 2;
+}
+
+int tbl_merkle_verify_inclusion_ok(unsigned long leaf, unsigned long size,
+                                   const unsigned char leaf_hash[32],
+                                   unsigned char path[][32], unsigned long n,
+                                   const unsigned char root[32])
+{
+    unsigned char r[32];
+    unsigned long fn;
+    unsigned long sn;
+    unsigned long i;
+
+    if (leaf >= size || n > (unsigned long)TBL_MERKLE_MAX_PATH) return 0;
+    fn = leaf;
+    sn = size - 1UL;
+    (void)memcpy(r, leaf_hash, 32);
+
+    for (i = 0UL; i < n; ++i) {
+        if (sn == 0UL) return 0;
+        if ((fn & 1UL) || fn == sn) {
+            tbl_merkle_node(path[i], r, r);
+            while (!(fn & 1UL) && fn != 0UL) { fn >>= 1; sn >>= 1; }
+        } else {
+            tbl_merkle_node(r, path[i], r);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+    return (sn == 0UL && memcmp(r, root, 32) == 0) ? 1 : 0;
+}
+
+int tbl_merkle_verify_consistency_ok(unsigned long old_size, unsigned long size,
+                                     const unsigned char old_root[32], const unsigned char root[32],
+                                     unsigned char path[][32], unsigned long n)
+{
+    unsigned char fr[32];
+    unsigned char sr[32];
+    unsigned long fn;
+    unsigned long sn;
+    unsigned long i;
+
+    if (old_size == 0UL || old_size > size || n > (unsigned long)TBL_MERKLE_MAX_PATH) return 0;
+    if (old_size == size) return (n == 0UL && memcmp(old_root, root, 32) == 0) ? 1 : 0;
+
+    /* an old tree of 2^k leaves is a subtree of the new one: its root
+     * is the implicit first proof element */
+    i = 0UL;
+    if ((old_size & (old_size - 1UL)) == 0UL) {
+        (void)memcpy(fr, old_root, 32);
+    } else {
+        if (n == 0UL) return 0;
+        (void)memcpy(fr, path[0], 32);
+        i = 1UL;
+    }
+    (void)memcpy(sr, fr, 32);
+
+    fn = old_size - 1UL;
+    sn = size - 1UL;
+    while (fn & 1UL) { fn >>= 1; sn >>= 1; }
+
+    for (; i < n; ++i) {
+        if (sn == 0UL) return 0;
+        if ((fn & 1UL) || fn == sn) {
+            tbl_merkle_node(path[i], fr, fr);
+            tbl_merkle_node(path[i], sr, sr);
+            while (!(fn & 1UL) && fn != 0UL) { fn >>= 1; sn >>= 1; }
+        } else {
+            tbl_merkle_node(sr, path[i], sr);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+    return (sn == 0UL && memcmp(fr, old_root, 32) == 0 && memcmp(sr, root, 32) == 0) ? 1 : 0;
+}
+
+#endif /* TBL_MERKLE_IMPLEMENTATION */
+
+#endif /* TBL_CORE_MERKLE_H */
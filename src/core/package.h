@@ -41,7 +41,10 @@ int tbl_package_job(const char *repo_root,
 #include "core/path.h"
 #include "core/cas.h"
 #include "core/record.h"
+#include "core/recidx.h"
 #include "core/events.h"
+#include "core/evidx.h"
+#include "core/jobstore.h"
 #include "core/sha256.h"
 #include "os/fs.h"
 
@@ -144,6 +147,40 @@ static int tbl_pkg_hash_file_hex(const char *path, char out_hex[65], char *err,
     return 0;
 }
 
+/* Write one event line, normalized to LF-only for deterministic packages. */
+static int tbl_pkg_put_event(FILE *out, const char *line)
+{
+    char clean[4096];
+    size_t i, j;
+
+    j = 0;
+    for (i = 0; line[i] && j + 1 < sizeof(clean); ++i) {
+        if (line[i] == '\r') continue;
+        clean[j++] = line[i];
+    }
+    clean[j] = '\0';
+    return (fputs(clean, out) == EOF) ? 0 : 1;
+}
+
+typedef struct tbl_pkg_events_s {
+    FILE *out;
+    unsigned long nlines;
+    int failed;
+} tbl_pkg_events_t;
+
+static int tbl_pkg_event_cb(void *ud, const char *line, size_t len)
+{
+    tbl_pkg_events_t *pe = (tbl_pkg_events_t *)ud;
+
+    (void)len;
+    if (!tbl_pkg_put_event(pe->out, line)) {
+        pe->failed = 1;
+        return 1;
+    }
+    pe->nlines++;
+    return 0;
+}
+
 static int tbl_pkg_extract_events(const char *repo_root,
                                  const char *jobid,
                                  const char *out_path,
@@ -151,17 +188,13 @@ static int tbl_pkg_extract_events(const char *repo_root,
                                  int *out_is_job_stream,
                                  char *err, size_t errsz)
 {
-    char legacy_path[1024];
     char jobs_dir[1024];
     char job_dir[1024];
     char job_path[1024];
 
     FILE *in;
-    int is_job_stream;
     FILE *out;
     char line[2048];
-    char needle1[512];
-    char needle2[512];
     unsigned long nlines;
 
     if (out_lines) *out_lines = 0UL;
@@ -181,64 +214,66 @@ static int tbl_pkg_extract_events(const char *repo_root,
 
     /* Prefer per-job events: <repo_root>/jobs/<jobid>/events.log */
     in = 0;
-    is_job_stream = 0;
     if (tbl_path_join2(jobs_dir, sizeof(jobs_dir), repo_root, "jobs") &&
         tbl_path_join2(job_dir, sizeof(job_dir), jobs_dir, jobid) &&
         tbl_path_join2(job_path, sizeof(job_path), job_dir, "events.log")) {
         in = fopen(job_path, "rb");
-        if (in) { is_job_stream = 1; if (out_is_job_stream) *out_is_job_stream = 1; }
     }
 
-    /* Fallback legacy combined stream: <repo_root>/events.log filtered by job=<jobid> */
-    if (!in) {
-        if (!tbl_path_join2(legacy_path, sizeof(legacy_path), repo_root, "events.log")) {
+    /* Then the job store bucket: <repo_root>/jobstore/NNN.log */
+    if (!in && tbl_jobstore_active_ok(repo_root)) {
+        tbl_pkg_events_t pe;
+
+        pe.out = out;
+        pe.nlines = 0UL;
+        pe.failed = 0;
+        if (tbl_jobstore_each(repo_root, jobid, tbl_pkg_event_cb, &pe, 0, err, errsz) != 0 || pe.failed) {
             fclose(out);
-            tbl_pkg_seterr(err, errsz, "events path too long");
+            if (pe.failed) tbl_pkg_seterr(err, errsz, "events write error");
             return 2;
         }
-        in = fopen(legacy_path, "rb");
+        if (pe.nlines > 0UL) {
+            if (fclose(out) != 0) {
+                tbl_pkg_seterr(err, errsz, "events flush error");
+                return 2;
+            }
+            if (out_lines) *out_lines = pe.nlines;
+            if (out_is_job_stream) *out_is_job_stream = 1;
+            return 0;
+        }
     }
 
-    /* If no source exists, keep empty file. */
+    /* Fallback legacy combined stream: <repo_root>/events.log, lines with
+       job=<jobid> found through the events.idx job index */
     if (!in) {
-        (void)fclose(out);
+        tbl_pkg_events_t pe;
+
+        pe.out = out;
+        pe.nlines = 0UL;
+        pe.failed = 0;
+        if (tbl_evidx_each(repo_root, jobid, tbl_pkg_event_cb, &pe, 0, err, errsz) != 0 || pe.failed) {
+            fclose(out);
+            if (pe.failed) tbl_pkg_seterr(err, errsz, "events write error");
+            return 2;
+        }
+        if (fclose(out) != 0) {
+            tbl_pkg_seterr(err, errsz, "events flush error");
+            return 2;
+        }
+        if (out_lines) *out_lines = pe.nlines;
         return 0;
     }
-
-    needle1[0] = '\0';
-    needle2[0] = '\0';
-    (void)tbl_strlcpy(needle1, " job=", sizeof(needle1));
-    (void)tbl_strlcat(needle1, jobid, sizeof(needle1));
-    (void)tbl_strlcpy(needle2, "job=", sizeof(needle2));
-    (void)tbl_strlcat(needle2, jobid, sizeof(needle2));
+    if (out_is_job_stream) *out_is_job_stream = 1;
 
     nlines = 0UL;
     while (fgets(line, (int)sizeof(line), in) != 0) {
-        int match = 1;
-
-        if (!is_job_stream) {
-            match = (strstr(line, needle1) != 0) || (strstr(line, needle2) != 0);
-        }
-
-        if (match) {
-            /* normalize to LF-only for deterministic packages */
-            char clean[2048];
-            size_t i, j;
-            j = 0;
-            for (i = 0; line[i] && j + 1 < sizeof(clean); ++i) {
-                if (line[i] == '\r') continue;
-                clean[j++] = line[i];
-            }
-            clean[j] = '\0';
-
-            if (fputs(clean, out) == EOF) {
-                fclose(in);
-                fclose(out);
-                tbl_pkg_seterr(err, errsz, "events write error");
-                return 2;
-            }
-            nlines++;
+        if (!tbl_pkg_put_event(out, line)) {
+            fclose(in);
+            fclose(out);
+            tbl_pkg_seterr(err, errsz, "events write error");
+            return 2;
         }
+        nlines++;
     }
 
     fclose(in);
@@ -363,7 +398,6 @@ int tbl_package_job(const char *repo_root,
 {
     tbl_record_t rec;
     char objpath[1024];
-    char record_path[1024];
 
     char meta_dir[1024];
     char rep_data_dir[1024];
@@ -415,7 +449,7 @@ int tbl_package_job(const char *repo_root,
     }
 
     /* read durable record */
-    rc = tbl_record_read_repo(repo_root, jobid, &rec, err, errsz);
+    rc = tbl_recidx_read(repo_root, jobid, &rec, err, errsz);
     if (rc != 0) {
         (void)0; /* package: no repo side effects */
         return 2;
@@ -442,11 +476,6 @@ int tbl_package_job(const char *repo_root,
         return 2;
     }
 
-    if (!tbl_record_path(repo_root, jobid, record_path, sizeof(record_path))) {
-        tbl_pkg_seterr(err, errsz, "record path too long");
-        return 2;
-    }
-
     /* create directories */
     if (!tbl_path_join2(meta_dir, sizeof(meta_dir), out_dir, "metadata")) {
         tbl_pkg_seterr(err, errsz, "metadata path too long");
@@ -484,7 +513,7 @@ int tbl_package_job(const char *repo_root,
         return 2;
     }
 
-    rc = tbl_pkg_copy_file(record_path, out_record, err, errsz);
+    rc = tbl_record_copy_to(repo_root, jobid, out_record, err, errsz);
     if (rc != 0) {
         (void)0; /* package: no repo side effects */
         return 2;
@@ -29,6 +29,7 @@ int tbl_ingest_package_dir(const char *repo_root, const char *pkg_dir, char *err
 #include "core/str.h"
 #include "core/ini.h"
 #include "core/record.h"
+#include "core/recstore.h"
 #include "core/cas.h"
 #include "core/events.h"
 #include "core/sha256.h"
@@ -590,10 +591,11 @@ int tbl_ingest_package_dir(const char *repo_root, const char *pkg_dir, char *err
         }
     }
 
-    /* Write record into repo */
-    if (tbl_record_write_repo(repo_root, &rec, err, errsz) != 0) {
+    /* Write record into repo; a failed index update only costs lookups */
+    if (tbl_recstore_write(repo_root, &rec, err, errsz) == 2) {
         return TBLX_EXIT_IO;
     }
+    if (err && errsz) err[0] = '\0';
 
     /* Append event */
     (void)tbl_events_append(repo_root, "ingest-package.ok", rec.job, rec.status, rec.sha256, "", 0, 0);
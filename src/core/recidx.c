@@ -0,0 +1,2 @@
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
@@ -0,0 +1,891 @@
+#ifndef TBL_CORE_RECIDX_H
+#define TBL_CORE_RECIDX_H
+
+#include <stddef.h>
+
+#include "core/record.h"
+
+/* Job index for the durable records, whichever engine stores them
+   (core/record.h: sharded records/<ab>/<jobid>.ini, flat legacy files,
+   or the record journal).
+   <repo_root>/index/records.idx is an open-addressing hash table with a
+   fixed little-endian layout, so the file can be mapped as it is:
+   - header (64 bytes)  "TBLRIX1\n", u32 nslots (power of two), u32 used
+                        slots, u32 heap_len, u32 heap_cap, zero padding
+   - nslots slots of 72 bytes, linear probing from FNV-1a(jobid):
+       u32 hash (0 = free), u32 str_off, u16 jobid_len, u8 status
+       (0 = not indexed, 1 ok, 2 fail, 3 unknown), u8 flags (1 = sha256),
+       u16 reason_len, u8 payload_len, u8 0, sha256[32] (binary),
+       u64 bytes, u64 stored_at, u16 tags_len, u16 0, u32 FNV-1a of the
+       68 bytes before
+   - string heap        jobid, payload, reason and tags back to back at
+                        str_off (the reason text at str_off + jobid_len +
+                        payload_len, the "key=value\n" tag lines after it)
+   A lookup reads the header, the probed slots and one heap run; the
+   record store is not touched. Ingest updates the table in place under
+   index/records.lock: strings first, then the header, then the slot. A
+   slot whose checksum or heap range does not hold is skipped, so readers
+   take no lock. Past 70 % load or with a full heap the table is written
+   anew at twice the size (tmp + rename).
+   The record store stays the truth: a miss, or a record the table cannot
+   hold exactly (another status, a non-hex sha256), falls back to
+   tbl_record_read_repo(), and `tablinum index --rebuild` rebuilds the
+   table from tbl_record_each().
+   Writers mark the job's slot as not indexed before the record is
+   rewritten (tbl_recidx_invalidate), so a put that fails afterwards leaves
+   a fallback, not the previous record. Where even that fails,
+   index/records.stale is written and readers ignore the whole table until
+   the next rebuild.
+*/
+
+typedef struct tbl_recidx_hdr_s {
+    unsigned long nslots;
+    unsigned long used;
+    unsigned long heap_len;
+    unsigned long heap_cap;
+} tbl_recidx_hdr_t;
+
+/* Open table for many lookups (batch verify/export). It sees the table as
+   of open plus in-place updates; records added later are misses. */
+typedef struct tbl_recidx_s {
+    void *fp;               /* FILE * */
+    tbl_recidx_hdr_t h;
+} tbl_recidx_t;
+
+/* Returns 0 ok, 1 no index (or marked stale), 2 error (bad header). */
+int tbl_recidx_open(tbl_recidx_t *x, const char *repo_root, char *err, size_t errsz);
+void tbl_recidx_close(tbl_recidx_t *x);
+
+/* Returns 0 found, 1 not indexed, 2 read error. */
+int tbl_recidx_lookup(tbl_recidx_t *x, const char *jobid, tbl_record_t *out_rec);
+
+/* One lookup (open, lookup, close). Returns 0 found, 1 not indexed (or no
+   index), 2 error. */
+int tbl_recidx_get(const char *repo_root, const char *jobid, tbl_record_t *out_rec,
+                   char *err, size_t errsz);
+
+/* Mark jobid as not indexed; call it before the record is rewritten. If
+   the slot cannot be marked, index/records.stale is written instead (or,
+   failing that, records.idx removed). Returns 0 ok, 2 error (the table
+   may still hold the old record). */
+int tbl_recidx_invalidate(const char *repo_root, const char *jobid, char *err, size_t errsz);
+
+/* Insert or replace rec once the record is written. A record the table
+   cannot hold exactly is marked as not indexed. Returns 0 ok, 2 error. */
+int tbl_recidx_put(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz);
+
+/* tbl_record_read_repo() with the index in front. Returns 0 ok, 2 error. */
+int tbl_recidx_read(const char *repo_root, const char *jobid, tbl_record_t *out_rec,
+                    char *err, size_t errsz);
+
+/* Write records.idx anew from every stored record (tbl_record_each) and
+   drop records.stale. out_entries: records in the table. Returns 0 ok,
+   2 error. */
+int tbl_recidx_build(const char *repo_root, unsigned long *out_entries, char *err, size_t errsz);
+
+#ifdef TBL_RECIDX_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_RECIDX_HDR 64UL
+#define TBL_RECIDX_SLOT 72UL
+#define TBL_RECIDX_MIN_SLOTS 1024UL
+#define TBL_RECIDX_MAX_SLOTS 0x8000000UL
+#define TBL_RECIDX_HEAP_MIN 65536UL
+#define TBL_RECIDX_STR_MAX 1200
+
+typedef struct tbl_recidx_paths_s {
+    char dir[1024];
+    char idx[1024];
+    char tmp[1024];
+    char lock[1024];
+    char stale[1024];
+} tbl_recidx_paths_t;
+
+/* whole table in memory (rebuild and growth) */
+typedef struct tbl_recidx_mem_s {
+    unsigned char *slots;
+    unsigned long nslots;
+    unsigned long used;
+    unsigned char *heap;
+    unsigned long heap_len;
+    unsigned long heap_cap;
+} tbl_recidx_mem_t;
+
+static void tbl_recidx_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "record index error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_recidx_paths(const char *repo_root, tbl_recidx_paths_t *p)
+{
+    return tbl_path_join2(p->dir, sizeof(p->dir), repo_root, "index") &&
+           tbl_path_join2(p->idx, sizeof(p->idx), p->dir, "records.idx") &&
+           tbl_path_join2(p->tmp, sizeof(p->tmp), p->dir, "records.idx.tmp") &&
+           tbl_path_join2(p->lock, sizeof(p->lock), p->dir, "records.lock") &&
+           tbl_path_join2(p->stale, sizeof(p->stale), p->dir, "records.stale");
+}
+
+static void tbl_recidx_put16(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+}
+
+static void tbl_recidx_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+/* unsigned long may be 32 bit: the high word is shifted in two steps */
+static void tbl_recidx_put64(unsigned char *p, unsigned long v)
+{
+    tbl_recidx_put32(p, v & 0xffffffffUL);
+    tbl_recidx_put32(p + 4, ((v >> 16) >> 16) & 0xffffffffUL);
+}
+
+static unsigned long tbl_recidx_get16(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8);
+}
+
+static unsigned long tbl_recidx_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static int tbl_recidx_get64_ok(const unsigned char *p, unsigned long *out)
+{
+    unsigned long hi = tbl_recidx_get32(p + 4);
+
+    if (hi != 0UL && ULONG_MAX == 0xffffffffUL) return 0;
+    *out = ((hi << 16) << 16) | tbl_recidx_get32(p);
+    return 1;
+}
+
+/* FNV-1a, 32 bit */
+static unsigned long tbl_recidx_fnv(const unsigned char *p, size_t n)
+{
+    unsigned long h = 2166136261UL;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        h ^= (unsigned long)p[i];
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+    return h;
+}
+
+static unsigned long tbl_recidx_hash(const char *key, size_t n)
+{
+    unsigned long h = tbl_recidx_fnv((const unsigned char *)key, n);
+    return h ? h : 1UL;
+}
+
+static void tbl_recidx_seal(unsigned char *slot)
+{
+    tbl_recidx_put32(slot + 68, tbl_recidx_fnv(slot, 68));
+}
+
+static unsigned long tbl_recidx_slot_strlen(const unsigned char *slot)
+{
+    return tbl_recidx_get16(slot + 8) + (unsigned long)slot[14] + tbl_recidx_get16(slot + 12) +
+           tbl_recidx_get16(slot + 64);
+}
+
+/* checksum holds and the strings lie inside the used heap */
+static int tbl_recidx_slot_ok(const unsigned char *slot, unsigned long heap_len)
+{
+    unsigned long off = tbl_recidx_get32(slot + 4);
+    unsigned long n = tbl_recidx_slot_strlen(slot);
+
+    if (tbl_recidx_get32(slot + 68) != tbl_recidx_fnv(slot, 68)) return 0;
+    if (n > TBL_RECIDX_STR_MAX) return 0;
+    return (off <= heap_len && n <= heap_len - off) ? 1 : 0;
+}
+
+static int tbl_recidx_seek(FILE *fp, unsigned long off)
+{
+    if (off > (unsigned long)LONG_MAX) return 0;
+    return (fseek(fp, (long)off, SEEK_SET) == 0) ? 1 : 0;
+}
+
+static int tbl_recidx_pread_ok(FILE *fp, unsigned long off, void *buf, size_t n)
+{
+    if (n == 0) return 1;
+    return (tbl_recidx_seek(fp, off) && fread(buf, 1, n, fp) == n) ? 1 : 0;
+}
+
+static int tbl_recidx_pwrite_ok(FILE *fp, unsigned long off, const void *buf, size_t n)
+{
+    if (n == 0) return 1;
+    return (tbl_recidx_seek(fp, off) && fwrite(buf, 1, n, fp) == n) ? 1 : 0;
+}
+
+static unsigned long tbl_recidx_slot_pos(unsigned long i)
+{
+    return TBL_RECIDX_HDR + i * TBL_RECIDX_SLOT;
+}
+
+static unsigned long tbl_recidx_heap_pos(const tbl_recidx_hdr_t *h, unsigned long off)
+{
+    return TBL_RECIDX_HDR + h->nslots * TBL_RECIDX_SLOT + off;
+}
+
+static int tbl_recidx_read_hdr_ok(FILE *fp, tbl_recidx_hdr_t *h)
+{
+    unsigned char b[TBL_RECIDX_HDR];
+
+    if (!tbl_recidx_pread_ok(fp, 0UL, b, sizeof(b))) return 0;
+    if (memcmp(b, "TBLRIX1\n", 8) != 0) return 0;
+    h->nslots = tbl_recidx_get32(b + 8);
+    h->used = tbl_recidx_get32(b + 12);
+    h->heap_len = tbl_recidx_get32(b + 16);
+    h->heap_cap = tbl_recidx_get32(b + 20);
+    if (h->nslots < TBL_RECIDX_MIN_SLOTS || h->nslots > TBL_RECIDX_MAX_SLOTS) return 0;
+    if ((h->nslots & (h->nslots - 1UL)) != 0UL) return 0;
+    return (h->used <= h->nslots && h->heap_len <= h->heap_cap) ? 1 : 0;
+}
+
+static void tbl_recidx_hdr_bytes(const tbl_recidx_hdr_t *h, unsigned char b[TBL_RECIDX_HDR])
+{
+    (void)memset(b, 0, TBL_RECIDX_HDR);
+    (void)memcpy(b, "TBLRIX1\n", 8);
+    tbl_recidx_put32(b + 8, h->nslots);
+    tbl_recidx_put32(b + 12, h->used);
+    tbl_recidx_put32(b + 16, h->heap_len);
+    tbl_recidx_put32(b + 20, h->heap_cap);
+}
+
+static int tbl_recidx_status_code(const char *s)
+{
+    if (!s[0] || tbl_streq(s, "unknown")) return 3;
+    if (tbl_streq(s, "ok")) return 1;
+    if (tbl_streq(s, "fail")) return 2;
+    return 0;
+}
+
+static int tbl_recidx_hexval(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* A value the record format gives back unchanged: one line, no trailing blanks. */
+static int tbl_recidx_value_ok(const char *s, size_t n)
+{
+    if (strcspn(s, "\r\n") != n) return 0;
+    return (n == 0 || (s[n - 1] != ' ' && s[n - 1] != '\t')) ? 1 : 0;
+}
+
+/* Slot fields (without str_off and checksum) and the string run of rec.
+   Returns 0 if the table cannot hold rec exactly. */
+static int tbl_recidx_pack(const tbl_record_t *rec, unsigned char *slot, char *strs, size_t *out_n)
+{
+    size_t kl;
+    size_t pl;
+    size_t rl;
+    size_t tl;
+    size_t i;
+    int st;
+
+    kl = strlen(rec->job);
+    pl = strlen(rec->payload);
+    rl = strlen(rec->reason);
+    tl = strlen(rec->tags);
+    st = tbl_recidx_status_code(rec->status);
+    if (!tbl_record_is_safe_id(rec->job) || st == 0 || kl > 255U || pl > 255U || rl > 65535U ||
+        kl + pl + rl + tl > (size_t)TBL_RECIDX_STR_MAX) {
+        return 0;
+    }
+    if (!tbl_recidx_value_ok(rec->job, kl) || !tbl_recidx_value_ok(rec->payload, pl) ||
+        !tbl_recidx_value_ok(rec->reason, rl)) {
+        return 0;
+    }
+
+    (void)memset(slot, 0, TBL_RECIDX_SLOT);
+    tbl_recidx_put32(slot, tbl_recidx_hash(rec->job, kl));
+    tbl_recidx_put16(slot + 8, (unsigned long)kl);
+    slot[10] = (unsigned char)st;
+    tbl_recidx_put16(slot + 12, (unsigned long)rl);
+    slot[14] = (unsigned char)pl;
+    if (rec->sha256[0]) {
+        if (strlen(rec->sha256) != 64U) return 0;
+        for (i = 0; i < 32U; ++i) {
+            int hi = tbl_recidx_hexval((unsigned char)rec->sha256[2U * i]);
+            int lo = tbl_recidx_hexval((unsigned char)rec->sha256[2U * i + 1U]);
+            if (hi < 0 || lo < 0) return 0;
+            slot[16U + i] = (unsigned char)((hi << 4) | lo);
+        }
+        slot[11] = 1;
+    }
+    tbl_recidx_put64(slot + 48, rec->bytes);
+    tbl_recidx_put64(slot + 56, rec->stored_at);
+    tbl_recidx_put16(slot + 64, (unsigned long)tl);
+
+    (void)memcpy(strs, rec->job, kl);
+    (void)memcpy(strs + kl, rec->payload, pl);
+    (void)memcpy(strs + kl + pl, rec->reason, rl);
+    (void)memcpy(strs + kl + pl + rl, rec->tags, tl);
+    *out_n = kl + pl + rl + tl;
+    return 1;
+}
+
+/* Record from a found slot and its string run. Returns 0 if it does not fit. */
+static int tbl_recidx_unpack(const unsigned char *slot, const char *strs, tbl_record_t *rec)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned long kl = tbl_recidx_get16(slot + 8);
+    unsigned long pl = (unsigned long)slot[14];
+    unsigned long rl = tbl_recidx_get16(slot + 12);
+    unsigned long tl = tbl_recidx_get16(slot + 64);
+    size_t i;
+
+    if (kl >= sizeof(rec->job) || pl >= sizeof(rec->payload) || rl >= sizeof(rec->reason) ||
+        tl >= sizeof(rec->tags)) {
+        return 0;
+    }
+    (void)memset(rec, 0, sizeof(*rec));
+    (void)memcpy(rec->job, strs, (size_t)kl);
+    (void)memcpy(rec->payload, strs + kl, (size_t)pl);
+    (void)memcpy(rec->reason, strs + kl + pl, (size_t)rl);
+    (void)memcpy(rec->tags, strs + kl + pl + rl, (size_t)tl);
+    (void)tbl_strlcpy(rec->status, slot[10] == 1 ? "ok" : (slot[10] == 2 ? "fail" : "unknown"),
+                      sizeof(rec->status));
+    if (slot[11] & 1) {
+        for (i = 0; i < 32U; ++i) {
+            rec->sha256[2U * i] = hex[slot[16U + i] >> 4];
+            rec->sha256[2U * i + 1U] = hex[slot[16U + i] & 15];
+        }
+        rec->sha256[64] = '\0';
+    }
+    return (tbl_recidx_get64_ok(slot + 48, &rec->bytes) && tbl_recidx_get64_ok(slot + 56, &rec->stored_at)) ? 1 : 0;
+}
+
+/* Probe for key. *out_found = 1 with its slot and strings, else *out_at is
+   the first free slot (nslots if none). Returns 0 on a read error. */
+static int tbl_recidx_find(FILE *fp, const tbl_recidx_hdr_t *h, const char *key, size_t kl,
+                           unsigned char *slot, char *strs, unsigned long *out_at, int *out_found)
+{
+    unsigned long hash = tbl_recidx_hash(key, kl);
+    unsigned long mask = h->nslots - 1UL;
+    unsigned long i;
+    unsigned long n;
+
+    *out_found = 0;
+    *out_at = h->nslots;
+    i = hash & mask;
+    for (n = 0UL; n < h->nslots; ++n, i = (i + 1UL) & mask) {
+        unsigned long sh;
+
+        if (!tbl_recidx_pread_ok(fp, tbl_recidx_slot_pos(i), slot, TBL_RECIDX_SLOT)) return 0;
+        sh = tbl_recidx_get32(slot);
+        if (sh == 0UL) {
+            *out_at = i;
+            return 1;
+        }
+        if (sh != hash || tbl_recidx_get16(slot + 8) != (unsigned long)kl ||
+            !tbl_recidx_slot_ok(slot, h->heap_len)) {
+            continue;
+        }
+        if (!tbl_recidx_pread_ok(fp, tbl_recidx_heap_pos(h, tbl_recidx_get32(slot + 4)), strs,
+                                 (size_t)tbl_recidx_slot_strlen(slot))) {
+            return 0;
+        }
+        if (memcmp(strs, key, kl) == 0) {
+            *out_at = i;
+            *out_found = 1;
+            return 1;
+        }
+    }
+    return 1;
+}
+
+int tbl_recidx_open(tbl_recidx_t *x, const char *repo_root, char *err, size_t errsz)
+{
+    tbl_recidx_paths_t p;
+    FILE *fp;
+    int stale = 0;
+
+    if (err && errsz) err[0] = '\0';
+    if (!x || !repo_root || !repo_root[0]) {
+        tbl_recidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    x->fp = 0;
+    if (!tbl_recidx_paths(repo_root, &p)) {
+        tbl_recidx_seterr(err, errsz, "record index path too long");
+        return 2;
+    }
+    fp = fopen(p.idx, "rb");
+    if (!fp) return 1;
+    /* an invalidation that could not be recorded: the table may lie */
+    if (tbl_fs_exists(p.stale, &stale) != 0 || stale) {
+        fclose(fp);
+        return 1;
+    }
+    /* a few small positioned reads per lookup: no 4 KiB refill per seek */
+    (void)setvbuf(fp, 0, _IONBF, 0);
+    if (!tbl_recidx_read_hdr_ok(fp, &x->h)) {
+        fclose(fp);
+        tbl_recidx_seterr(err, errsz, "records.idx: bad header");
+        return 2;
+    }
+    x->fp = (void *)fp;
+    return 0;
+}
+
+void tbl_recidx_close(tbl_recidx_t *x)
+{
+    if (!x || !x->fp) return;
+    fclose((FILE *)x->fp);
+    x->fp = 0;
+}
+
+int tbl_recidx_lookup(tbl_recidx_t *x, const char *jobid, tbl_record_t *out_rec)
+{
+    unsigned char slot[TBL_RECIDX_SLOT];
+    char strs[TBL_RECIDX_STR_MAX];
+    unsigned long at;
+    int found;
+
+    if (!x || !x->fp || !out_rec || !tbl_record_is_safe_id(jobid) || strlen(jobid) > 255U) return 1;
+    if (!tbl_recidx_find((FILE *)x->fp, &x->h, jobid, strlen(jobid), slot, strs, &at, &found)) return 2;
+    return (found && slot[10] != 0 && tbl_recidx_unpack(slot, strs, out_rec)) ? 0 : 1;
+}
+
+int tbl_recidx_get(const char *repo_root, const char *jobid, tbl_record_t *out_rec,
+                   char *err, size_t errsz)
+{
+    tbl_recidx_t x;
+    int rc;
+
+    rc = tbl_recidx_open(&x, repo_root, err, errsz);
+    if (rc != 0) return rc;
+    rc = tbl_recidx_lookup(&x, jobid, out_rec);
+    if (rc == 2) tbl_recidx_seterr(err, errsz, "records.idx: read failed");
+    tbl_recidx_close(&x);
+    return rc;
+}
+
+int tbl_recidx_read(const char *repo_root, const char *jobid, tbl_record_t *out_rec,
+                    char *err, size_t errsz)
+{
+    if (tbl_recidx_get(repo_root, jobid, out_rec, 0, 0) == 0) {
+        if (err && errsz) err[0] = '\0';
+        return 0;
+    }
+    return tbl_record_read_repo(repo_root, jobid, out_rec, err, errsz);
+}
+
+static void tbl_recidx_mem_free(tbl_recidx_mem_t *m)
+{
+    free(m->slots);
+    free(m->heap);
+    (void)memset(m, 0, sizeof(*m));
+}
+
+static int tbl_recidx_mem_init(tbl_recidx_mem_t *m, unsigned long nslots, unsigned long heap_cap)
+{
+    (void)memset(m, 0, sizeof(*m));
+    m->slots = (unsigned char *)calloc((size_t)nslots, (size_t)TBL_RECIDX_SLOT);
+    m->heap = (unsigned char *)malloc((size_t)heap_cap);
+    if (!m->slots || !m->heap) {
+        tbl_recidx_mem_free(m);
+        return 0;
+    }
+    m->nslots = nslots;
+    m->heap_cap = heap_cap;
+    return 1;
+}
+
+/* double the slots; positions follow from the stored hashes */
+static int tbl_recidx_mem_grow(tbl_recidx_mem_t *m)
+{
+    unsigned char *ns;
+    unsigned long nn = m->nslots * 2UL;
+    unsigned long i;
+
+    if (nn > TBL_RECIDX_MAX_SLOTS) return 0;
+    ns = (unsigned char *)calloc((size_t)nn, (size_t)TBL_RECIDX_SLOT);
+    if (!ns) return 0;
+    for (i = 0UL; i < m->nslots; ++i) {
+        const unsigned char *s = m->slots + i * TBL_RECIDX_SLOT;
+        unsigned long j;
+
+        if (tbl_recidx_get32(s) == 0UL) continue;
+        j = tbl_recidx_get32(s) & (nn - 1UL);
+        while (tbl_recidx_get32(ns + j * TBL_RECIDX_SLOT) != 0UL) j = (j + 1UL) & (nn - 1UL);
+        (void)memcpy(ns + j * TBL_RECIDX_SLOT, s, TBL_RECIDX_SLOT);
+    }
+    free(m->slots);
+    m->slots = ns;
+    m->nslots = nn;
+    return 1;
+}
+
+/* Insert or replace a packed slot with its string run. Returns 1/0. */
+static int tbl_recidx_mem_add(tbl_recidx_mem_t *m, const unsigned char *tmpl, const char *strs, size_t n)
+{
+    unsigned long hash = tbl_recidx_get32(tmpl);
+    unsigned long kl = tbl_recidx_get16(tmpl + 8);
+    unsigned long i;
+    unsigned char *s;
+
+    if ((m->used + 1UL) * 10UL > m->nslots * 7UL && !tbl_recidx_mem_grow(m)) return 0;
+    if ((unsigned long)n > 0xffffffffUL - m->heap_len) return 0;
+    if (m->heap_len + (unsigned long)n > m->heap_cap) {
+        unsigned long nc = m->heap_cap * 2UL;
+        unsigned char *nh;
+
+        if (nc < m->heap_len + (unsigned long)n) nc = m->heap_len + (unsigned long)n;
+        nh = (unsigned char *)realloc(m->heap, (size_t)nc);
+        if (!nh) return 0;
+        m->heap = nh;
+        m->heap_cap = nc;
+    }
+
+    i = hash & (m->nslots - 1UL);
+    for (;;) {
+        s = m->slots + i * TBL_RECIDX_SLOT;
+        if (tbl_recidx_get32(s) == 0UL) {
+            m->used++;
+            break;
+        }
+        if (tbl_recidx_get32(s) == hash && tbl_recidx_get16(s + 8) == kl &&
+            memcmp(m->heap + tbl_recidx_get32(s + 4), strs, (size_t)kl) == 0) {
+            break;
+        }
+        i = (i + 1UL) & (m->nslots - 1UL);
+    }
+    (void)memcpy(m->heap + m->heap_len, strs, n);
+    (void)memcpy(s, tmpl, TBL_RECIDX_SLOT);
+    tbl_recidx_put32(s + 4, m->heap_len);
+    tbl_recidx_seal(s);
+    m->heap_len += (unsigned long)n;
+    return 1;
+}
+
+/* Live entries of an open index into m (strings compacted). Returns 1/0. */
+static int tbl_recidx_mem_load(tbl_recidx_mem_t *m, FILE *fp, const tbl_recidx_hdr_t *h)
+{
+    unsigned char *slots;
+    unsigned char *heap;
+    unsigned long i;
+    int ok;
+
+    slots = (unsigned char *)malloc((size_t)(h->nslots * TBL_RECIDX_SLOT));
+    heap = (unsigned char *)malloc((size_t)(h->heap_len ? h->heap_len : 1UL));
+    ok = (slots && heap &&
+          tbl_recidx_pread_ok(fp, TBL_RECIDX_HDR, slots, (size_t)(h->nslots * TBL_RECIDX_SLOT)) &&
+          tbl_recidx_pread_ok(fp, tbl_recidx_heap_pos(h, 0UL), heap, (size_t)h->heap_len)) ? 1 : 0;
+    for (i = 0UL; ok && i < h->nslots; ++i) {
+        const unsigned char *s = slots + i * TBL_RECIDX_SLOT;
+
+        if (tbl_recidx_get32(s) == 0UL || s[10] == 0 || !tbl_recidx_slot_ok(s, h->heap_len)) continue;
+        if (!tbl_recidx_mem_add(m, s, (const char *)heap + tbl_recidx_get32(s + 4),
+                                (size_t)tbl_recidx_slot_strlen(s))) {
+            ok = 0;
+        }
+    }
+    free(slots);
+    free(heap);
+    return ok;
+}
+
+/* records.idx from m via tmp + rename, with room for more strings */
+static int tbl_recidx_mem_write(const tbl_recidx_mem_t *m, const tbl_recidx_paths_t *p)
+{
+    static const unsigned char zero[4096];
+    unsigned char b[TBL_RECIDX_HDR];
+    tbl_recidx_hdr_t h;
+    unsigned long pad;
+    FILE *fp;
+    int ok;
+
+    h.nslots = m->nslots;
+    h.used = m->used;
+    h.heap_len = m->heap_len;
+    pad = m->heap_len / 2UL + TBL_RECIDX_HEAP_MIN;
+    if (pad > 0xffffffffUL - m->heap_len) pad = 0xffffffffUL - m->heap_len;
+    h.heap_cap = m->heap_len + pad;
+    tbl_recidx_hdr_bytes(&h, b);
+
+    fp = fopen(p->tmp, "wb");
+    if (!fp) return 0;
+    ok = (fwrite(b, 1, sizeof(b), fp) == sizeof(b) &&
+          fwrite(m->slots, (size_t)TBL_RECIDX_SLOT, (size_t)m->nslots, fp) == (size_t)m->nslots &&
+          fwrite(m->heap, 1, (size_t)m->heap_len, fp) == (size_t)m->heap_len) ? 1 : 0;
+    while (ok && pad > 0UL) {
+        size_t k = (pad > (unsigned long)sizeof(zero)) ? sizeof(zero) : (size_t)pad;
+        if (fwrite(zero, 1, k, fp) != k) ok = 0;
+        pad -= (unsigned long)k;
+    }
+    if (fclose(fp) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(p->tmp, p->idx, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(p->tmp);
+    return ok;
+}
+
+/* In-place update of an open index. Returns 1 done, 0 needs a rewrite, -1 I/O error. */
+static int tbl_recidx_put_inplace(FILE *fp, tbl_recidx_hdr_t *h, const unsigned char *tmpl, int indexable,
+                                  const char *key, size_t kl, const char *strs, size_t n)
+{
+    unsigned char slot[TBL_RECIDX_SLOT];
+    unsigned char b[TBL_RECIDX_HDR];
+    char old[TBL_RECIDX_STR_MAX];
+    unsigned long at;
+    int found;
+
+    if (!tbl_recidx_find(fp, h, key, kl, slot, old, &at, &found)) return -1;
+    if (!indexable) {
+        /* tombstone: lookups fall back to the record store */
+        if (!found) return 1;
+        slot[10] = 0;
+        tbl_recidx_seal(slot);
+        return tbl_recidx_pwrite_ok(fp, tbl_recidx_slot_pos(at), slot, TBL_RECIDX_SLOT) ? 1 : -1;
+    }
+    if (at >= h->nslots) return 0;
+    if (!found && (h->used + 1UL) * 10UL > h->nslots * 7UL) return 0;
+    if ((unsigned long)n > h->heap_cap - h->heap_len) return 0;
+
+    (void)memcpy(slot, tmpl, TBL_RECIDX_SLOT);
+    tbl_recidx_put32(slot + 4, h->heap_len);
+    tbl_recidx_seal(slot);
+    if (!tbl_recidx_pwrite_ok(fp, tbl_recidx_heap_pos(h, h->heap_len), strs, n)) return -1;
+    h->heap_len += (unsigned long)n;
+    if (!found) h->used++;
+    tbl_recidx_hdr_bytes(h, b);
+    if (!tbl_recidx_pwrite_ok(fp, 0UL, b, sizeof(b))) return -1;
+    if (!tbl_recidx_pwrite_ok(fp, tbl_recidx_slot_pos(at), slot, TBL_RECIDX_SLOT)) return -1;
+    return 1;
+}
+
+static int tbl_recidx_lock(const tbl_recidx_paths_t *p, tbl_fs_lock_t *lk, char *err, size_t errsz)
+{
+    if (tbl_fs_mkdir_p(p->dir) != 0) {
+        tbl_recidx_seterr(err, errsz, "cannot create index dir");
+        return 0;
+    }
+    if (tbl_fs_lock_open(lk, p->lock) != 0) {
+        tbl_recidx_seterr(err, errsz, "cannot open records.lock");
+        return 0;
+    }
+    if (tbl_fs_lock_acquire(lk) != 0) {
+        (void)tbl_fs_lock_close(lk);
+        tbl_recidx_seterr(err, errsz, "cannot lock records.lock");
+        return 0;
+    }
+    return 1;
+}
+
+int tbl_recidx_invalidate(const char *repo_root, const char *jobid, char *err, size_t errsz)
+{
+    tbl_recidx_paths_t p;
+    tbl_recidx_hdr_t h;
+    tbl_fs_lock_t lk;
+    unsigned char tmpl[TBL_RECIDX_SLOT];
+    int r = -1;
+    FILE *fp;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !tbl_record_is_safe_id(jobid) || strlen(jobid) > 255U) {
+        tbl_recidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_recidx_paths(repo_root, &p)) {
+        tbl_recidx_seterr(err, errsz, "record index path too long");
+        return 2;
+    }
+    fp = fopen(p.idx, "rb");
+    if (!fp) return 0;
+    fclose(fp);
+
+    (void)memset(tmpl, 0, sizeof(tmpl));
+    if (tbl_recidx_lock(&p, &lk, err, errsz)) {
+        fp = fopen(p.idx, "r+b");
+        if (!fp) {
+            r = 1;
+        } else {
+            /* a bad header is already ignored by readers */
+            r = tbl_recidx_read_hdr_ok(fp, &h) ? tbl_recidx_put_inplace(fp, &h, tmpl, 0, jobid, strlen(jobid), 0, 0)
+                                               : 1;
+            if (fclose(fp) != 0) r = -1;
+        }
+        (void)tbl_fs_lock_close(&lk);
+    }
+    if (r > 0) return 0;
+
+    if (tbl_fs_write_file(p.stale, "", 0) == 0 || tbl_fs_remove_file(p.idx) == 0) return 0;
+    tbl_recidx_seterr(err, errsz, "cannot invalidate records.idx");
+    return 2;
+}
+
+int tbl_recidx_put(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz)
+{
+    tbl_recidx_paths_t p;
+    tbl_recidx_hdr_t h;
+    tbl_recidx_mem_t m;
+    tbl_fs_lock_t lk;
+    unsigned char tmpl[TBL_RECIDX_SLOT];
+    char strs[TBL_RECIDX_STR_MAX];
+    size_t n = 0;
+    int indexable;
+    int have;
+    int rc;
+    FILE *fp;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !rec || !tbl_record_is_safe_id(rec->job)) {
+        tbl_recidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_recidx_paths(repo_root, &p)) {
+        tbl_recidx_seterr(err, errsz, "record index path too long");
+        return 2;
+    }
+    indexable = tbl_recidx_pack(rec, tmpl, strs, &n);
+    if (!tbl_recidx_lock(&p, &lk, err, errsz)) return 2;
+
+    rc = 0;
+    fp = fopen(p.idx, "r+b");
+    have = (fp && tbl_recidx_read_hdr_ok(fp, &h)) ? 1 : 0;
+    if (have) {
+        int r = tbl_recidx_put_inplace(fp, &h, tmpl, indexable, rec->job, strlen(rec->job), strs, n);
+        if (r < 0) {
+            tbl_recidx_seterr(err, errsz, "cannot update records.idx");
+            rc = 2;
+        }
+        if (r != 0) {
+            if (fclose(fp) != 0 && rc == 0) {
+                tbl_recidx_seterr(err, errsz, "cannot update records.idx");
+                rc = 2;
+            }
+            (void)tbl_fs_lock_close(&lk);
+            return rc;
+        }
+    }
+
+    /* no (usable) index yet, or full: write it anew */
+    if (indexable || have) {
+        if (!tbl_recidx_mem_init(&m, have ? h.nslots : TBL_RECIDX_MIN_SLOTS,
+                                 have && h.heap_len > TBL_RECIDX_HEAP_MIN ? h.heap_len : TBL_RECIDX_HEAP_MIN)) {
+            tbl_recidx_seterr(err, errsz, "out of memory");
+            rc = 2;
+        } else {
+            if ((have && !tbl_recidx_mem_load(&m, fp, &h)) ||
+                (indexable && !tbl_recidx_mem_add(&m, tmpl, strs, n))) {
+                tbl_recidx_seterr(err, errsz, "cannot read records.idx");
+                rc = 2;
+            }
+            if (fp) {
+                fclose(fp);
+                fp = 0;
+            }
+            if (rc == 0 && !tbl_recidx_mem_write(&m, &p)) {
+                tbl_recidx_seterr(err, errsz, "cannot write records.idx");
+                rc = 2;
+            }
+            tbl_recidx_mem_free(&m);
+        }
+    }
+    if (fp) fclose(fp);
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+typedef struct tbl_recidx_build_s {
+    tbl_recidx_mem_t *m;
+    int failed;
+} tbl_recidx_build_t;
+
+static int tbl_recidx_build_cb(void *ud, const tbl_record_t *rec)
+{
+    tbl_recidx_build_t *b = (tbl_recidx_build_t *)ud;
+    unsigned char tmpl[TBL_RECIDX_SLOT];
+    char strs[TBL_RECIDX_STR_MAX];
+    size_t n;
+
+    if (!tbl_recidx_pack(rec, tmpl, strs, &n)) return 0;
+    if (!tbl_recidx_mem_add(b->m, tmpl, strs, n)) {
+        b->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+int tbl_recidx_build(const char *repo_root, unsigned long *out_entries, char *err, size_t errsz)
+{
+    tbl_recidx_paths_t p;
+    tbl_recidx_mem_t m;
+    tbl_recidx_build_t b;
+    tbl_fs_lock_t lk;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_entries) *out_entries = 0UL;
+    if (!repo_root || !repo_root[0]) {
+        tbl_recidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_recidx_paths(repo_root, &p)) {
+        tbl_recidx_seterr(err, errsz, "record index path too long");
+        return 2;
+    }
+    if (!tbl_recidx_mem_init(&m, TBL_RECIDX_MIN_SLOTS, TBL_RECIDX_HEAP_MIN)) {
+        tbl_recidx_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    if (!tbl_recidx_lock(&p, &lk, err, errsz)) {
+        tbl_recidx_mem_free(&m);
+        return 2;
+    }
+
+    rc = 0;
+    b.m = &m;
+    b.failed = 0;
+    if (tbl_record_each(repo_root, tbl_recidx_build_cb, &b, 0, 0) != 0) {
+        tbl_recidx_seterr(err, errsz, "cannot read records");
+        rc = 2;
+    }
+    if (rc == 0 && b.failed) {
+        tbl_recidx_seterr(err, errsz, "records.idx too large");
+        rc = 2;
+    }
+    if (rc == 0 && !tbl_recidx_mem_write(&m, &p)) {
+        tbl_recidx_seterr(err, errsz, "cannot write records.idx");
+        rc = 2;
+    }
+    if (rc == 0 && tbl_fs_remove_file(p.stale) != 0) {
+        int ex = 1;
+
+        if (tbl_fs_exists(p.stale, &ex) != 0 || ex) {
+            tbl_recidx_seterr(err, errsz, "cannot remove records.stale");
+            rc = 2;
+        }
+    }
+    if (rc == 0 && out_entries) *out_entries = m.used;
+    (void)tbl_fs_lock_close(&lk);
+    tbl_recidx_mem_free(&m);
+    return rc;
+}
+
+#endif /* TBL_RECIDX_IMPLEMENTATION */
+
+#endif /* TBL_CORE_RECIDX_H */
@@ -0,0 +1,2 @@
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
@@ -0,0 +1,1181 @@
+#ifndef TBL_CORE_RECJOURNAL_H
+#define TBL_CORE_RECJOURNAL_H
+
+#include <stddef.h>
+
+/* Record journal: append-only record storage instead of one
+   records/<ab>/<jobid>.ini per job ([records] store = journal).
+   - recjournal/journal.log  one frame per record write, appended under
+                             recjournal/lock:
+                             "\nTBLRJ1 <len> <fnv> <jobid>\n" + <len> bytes
+                             of the record's .ini text; fnv = FNV-1a (8 hex)
+                             over "<jobid>\n<text>"
+   - recjournal/snap.<n>     immutable snapshot: "TBLRJS1\n", frames sorted
+                             by jobid (one per job), a u32 offset pair (lo,
+                             hi) for every block of TBL_RECJOURNAL_BLOCK
+                             frames, a 32-byte footer (count, blocks, index
+                             offset, FNV-1a, "TBLRSZ1\n")
+   - recjournal/manifest     "next=<n>" and "snap=<n> <records>" lines,
+                             oldest snapshot first, replaced atomically
+   - recjournal/ini_view     if present, writers also keep the .ini files
+   A journal larger than TBL_RECJOURNAL_MAX is folded into a new snapshot by
+   the writer that crossed the limit; snapshots are then merged while the
+   newest is at least as large as the one before it (O(log n) snapshots).
+   A lookup scans the journal (last frame wins), then binary-searches the
+   snapshots newest first. A torn frame (crash mid-append) fails its
+   checksum; readers skip it and resync at the next frame header.
+
+   [records] store decides the engine (tbl_record_set_store): with
+   store = journal every record writer appends here and creates recjournal/
+   on first use; with store = files an existing journal is not read.
+   Without a configured store (tools, tests) it is active once recjournal/
+   exists.
+*/
+
+#ifndef TBL_RECJOURNAL_MAX
+#define TBL_RECJOURNAL_MAX 262144UL
+#endif
+
+#ifndef TBL_RECJOURNAL_BLOCK
+#define TBL_RECJOURNAL_BLOCK 32UL
+#endif
+
+#define TBL_RECJOURNAL_MAX_SNAPS 32UL
+#define TBL_RECJOURNAL_BODY_MAX 4096
+
+/* Per-record callback of tbl_recjournal_each(): jobid and its newest text.
+   0 = continue, else stop. */
+typedef int (*tbl_recjournal_fn)(void *ud, const char *jobid, const char *body, size_t len);
+
+/* 1 if <repo_root>/recjournal/ exists. */
+int tbl_recjournal_active_ok(const char *repo_root);
+
+/* 1 if the journal is active and writers keep the .ini view. */
+int tbl_recjournal_view_ok(const char *repo_root);
+
+/* Create <repo_root>/recjournal/ (ok if it exists) and set or clear the
+   .ini view marker. Returns 0 ok, 2 error. */
+int tbl_recjournal_create(const char *repo_root, int ini_view, char *err, size_t errsz);
+
+/* Append the record text of jobid (1..TBL_RECJOURNAL_BODY_MAX bytes, LF
+   terminated); folds the journal into a snapshot once it is full.
+   Returns 0 ok, 2 error. */
+int tbl_recjournal_put(const char *repo_root, const char *jobid, const char *body, size_t len,
+                       char *err, size_t errsz);
+
+/* Newest text of jobid into body (NUL terminated).
+   Returns 0 found, 1 not stored, 2 error. */
+int tbl_recjournal_get(const char *repo_root, const char *jobid, char *body, size_t bodysz,
+                       size_t *out_len, char *err, size_t errsz);
+
+/* Call fn once per stored job, in jobid order, with its newest text.
+   Returns 0 ok, 2 error. */
+int tbl_recjournal_each(const char *repo_root, tbl_recjournal_fn fn, void *ud, unsigned long *out_n,
+                        char *err, size_t errsz);
+
+#ifdef TBL_RECJOURNAL_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_RECJOURNAL_FOOT 32UL
+#define TBL_RECJOURNAL_HDR_MAX 320
+#define TBL_RECJOURNAL_U32 0xffffffffUL
+
+typedef struct tbl_recjournal_paths_s {
+    char dir[1024];
+    char log[1024];
+    char man[1024];
+    char mantmp[1024];
+    char lock[1024];
+    char view[1024];
+} tbl_recjournal_paths_t;
+
+typedef struct tbl_recjournal_man_s {
+    unsigned long next;
+    unsigned long nsnaps;
+    unsigned long seq[TBL_RECJOURNAL_MAX_SNAPS];
+    unsigned long n[TBL_RECJOURNAL_MAX_SNAPS];
+} tbl_recjournal_man_t;
+
+typedef struct tbl_recjournal_frame_s {
+    char job[256];
+    char body[TBL_RECJOURNAL_BODY_MAX + 1];
+    size_t len;
+} tbl_recjournal_frame_t;
+
+/* journal frame held in memory; job and body point into the arena once
+   loading is done */
+typedef struct tbl_recjournal_row_s {
+    unsigned long seq;
+    unsigned long joff;
+    unsigned long boff;
+    size_t len;
+    const char *job;
+    const char *body;
+} tbl_recjournal_row_t;
+
+typedef struct tbl_recjournal_mem_s {
+    tbl_recjournal_row_t *v;
+    unsigned long n;
+    unsigned long cap;
+    char *arena;
+    unsigned long alen;
+    unsigned long acap;
+} tbl_recjournal_mem_t;
+
+typedef struct tbl_recjournal_snap_s {
+    FILE *fp;
+    unsigned long n;
+    unsigned long nb;
+    unsigned long *bidx;
+} tbl_recjournal_snap_t;
+
+/* position in one jobid-ordered source: a snapshot or journal rows */
+typedef struct tbl_recjournal_cur_s {
+    tbl_recjournal_snap_t *snap;
+    unsigned long left;
+    const tbl_recjournal_row_t *rows;
+    unsigned long nrows;
+    unsigned long ri;
+    tbl_recjournal_frame_t f;
+    int valid;
+    int bad;
+} tbl_recjournal_cur_t;
+
+typedef struct tbl_recjournal_w_s {
+    FILE *fp;
+    unsigned long off;
+    unsigned long n;
+    unsigned long *bidx;
+    unsigned long nb;
+    unsigned long bcap;
+    int ok;
+} tbl_recjournal_w_t;
+
+static void tbl_recjournal_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "record journal error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_recjournal_paths(const char *repo_root, tbl_recjournal_paths_t *p)
+{
+    return tbl_path_join2(p->dir, sizeof(p->dir), repo_root, "recjournal") &&
+           tbl_path_join2(p->log, sizeof(p->log), p->dir, "journal.log") &&
+           tbl_path_join2(p->man, sizeof(p->man), p->dir, "manifest") &&
+           tbl_path_join2(p->mantmp, sizeof(p->mantmp), p->dir, "manifest.tmp") &&
+           tbl_path_join2(p->lock, sizeof(p->lock), p->dir, "lock") &&
+           tbl_path_join2(p->view, sizeof(p->view), p->dir, "ini_view");
+}
+
+/* recjournal/snap.<seq> (tmp: snap.<seq>.tmp) */
+static int tbl_recjournal_snap_path(const tbl_recjournal_paths_t *p, unsigned long seq, int tmp,
+                                    char *out, size_t outsz)
+{
+    char name[64];
+    char nbuf[32];
+
+    if (!tbl_ul_to_dec_ok(seq, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcpy(name, "snap.", sizeof(name));
+    (void)tbl_strlcat(name, nbuf, sizeof(name));
+    if (tmp) (void)tbl_strlcat(name, ".tmp", sizeof(name));
+    return tbl_path_join2(out, outsz, p->dir, name);
+}
+
+static void tbl_recjournal_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+static unsigned long tbl_recjournal_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* lo/hi u32 pair -> unsigned long; 0 if it does not fit */
+static int tbl_recjournal_get64(const unsigned char *p, unsigned long *out)
+{
+    unsigned long hi = tbl_recjournal_get32(p + 4);
+
+    if (hi != 0UL && ((ULONG_MAX >> 16) >> 16) == 0UL) return 0;
+    *out = tbl_recjournal_get32(p) | ((hi << 16) << 16);
+    return 1;
+}
+
+/* upper 32 bits of an unsigned long of any width */
+static unsigned long tbl_recjournal_hi32(unsigned long v)
+{
+    return ((v >> 16) >> 16) & TBL_RECJOURNAL_U32;
+}
+
+static unsigned long tbl_recjournal_fnv(unsigned long h, const void *data, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        h ^= (unsigned long)p[i];
+        h = (h * 16777619UL) & TBL_RECJOURNAL_U32;
+    }
+    return h;
+}
+
+static unsigned long tbl_recjournal_frame_fnv(const char *job, const char *body, size_t len)
+{
+    unsigned long h = 2166136261UL;
+
+    h = tbl_recjournal_fnv(h, job, strlen(job));
+    h = tbl_recjournal_fnv(h, "\n", 1);
+    return tbl_recjournal_fnv(h, body, len);
+}
+
+static int tbl_recjournal_job_ok(const char *jobid)
+{
+    size_t i;
+
+    if (!jobid || !jobid[0]) return 0;
+    for (i = 0; jobid[i]; ++i) {
+        if ((unsigned char)jobid[i] <= 0x20) return 0;
+        if (i >= 255U) return 0;
+    }
+    return 1;
+}
+
+static int tbl_recjournal_seek(FILE *fp, unsigned long off)
+{
+    if (off > (unsigned long)LONG_MAX) return 0;
+    return (fseek(fp, (long)off, SEEK_SET) == 0) ? 1 : 0;
+}
+
+/* decimal unsigned long; *s moves past the digits. Returns 1/0. */
+static int tbl_recjournal_ul(const char **s, unsigned long *out)
+{
+    const char *p = *s;
+    unsigned long v = 0UL;
+
+    if (*p < '0' || *p > '9') return 0;
+    while (*p >= '0' && *p <= '9') {
+        unsigned long d = (unsigned long)(*p - '0');
+        if (v > (ULONG_MAX - d) / 10UL) return 0;
+        v = v * 10UL + d;
+        p++;
+    }
+    *s = p;
+    *out = v;
+    return 1;
+}
+
+/* "\nTBLRJ1 <len> <fnv> <jobid>\n" */
+static int tbl_recjournal_hdr(const char *job, const char *body, size_t len, char *out, size_t outsz)
+{
+    static const char hex[] = "0123456789abcdef";
+    char nbuf[32];
+    char fbuf[9];
+    unsigned long h;
+    int i;
+
+    h = tbl_recjournal_frame_fnv(job, body, len);
+    for (i = 7; i >= 0; --i) {
+        fbuf[i] = hex[h & 0xfUL];
+        h >>= 4;
+    }
+    fbuf[8] = '\0';
+    if (!tbl_ul_to_dec_ok((unsigned long)len, nbuf, sizeof(nbuf))) return 0;
+    out[0] = '\0';
+    return tbl_strlcat_ok(out, "\nTBLRJ1 ", outsz) && tbl_strlcat_ok(out, nbuf, outsz) &&
+           tbl_strlcat_ok(out, " ", outsz) && tbl_strlcat_ok(out, fbuf, outsz) &&
+           tbl_strlcat_ok(out, " ", outsz) && tbl_strlcat_ok(out, job, outsz) &&
+           tbl_strlcat_ok(out, "\n", outsz);
+}
+
+/* header line (without the leading newline) -> len, fnv, job */
+static int tbl_recjournal_parse_hdr(const char *line, size_t *len, unsigned long *fnv, char *job, size_t jobsz)
+{
+    const char *p = line;
+    unsigned long v;
+    unsigned long h = 0UL;
+    size_t jl;
+    int i;
+
+    if (strncmp(p, "TBLRJ1 ", 7) != 0) return 0;
+    p += 7;
+    if (!tbl_recjournal_ul(&p, &v) || *p++ != ' ' || v == 0UL || v > (unsigned long)TBL_RECJOURNAL_BODY_MAX) return 0;
+    for (i = 0; i < 8; ++i, ++p) {
+        unsigned long d;
+        if (*p >= '0' && *p <= '9') d = (unsigned long)(*p - '0');
+        else if (*p >= 'a' && *p <= 'f') d = (unsigned long)(*p - 'a' + 10);
+        else return 0;
+        h = (h << 4) | d;
+    }
+    if (*p++ != ' ') return 0;
+    jl = strlen(p);
+    if (jl < 2U || p[jl - 1U] != '\n' || jl > jobsz) return 0;
+    (void)memcpy(job, p, jl - 1U);
+    job[jl - 1U] = '\0';
+    if (!tbl_recjournal_job_ok(job)) return 0;
+    *len = (size_t)v;
+    *fnv = h;
+    return 1;
+}
+
+/* Next intact frame of fp into f: 1 frame, 0 end of file. Blank lines are
+   frame separators; anything else that is not an intact frame counts in
+   *bad and is skipped up to the next header line. */
+static int tbl_recjournal_next(FILE *fp, tbl_recjournal_frame_t *f, unsigned long *bad)
+{
+    char line[TBL_RECJOURNAL_HDR_MAX];
+    unsigned long fnv;
+    long pos;
+
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        if (line[0] == '\n' && line[1] == '\0') continue;
+        if (!tbl_recjournal_parse_hdr(line, &f->len, &fnv, f->job, sizeof(f->job))) {
+            (*bad)++;
+            continue;
+        }
+        pos = ftell(fp);
+        if (fread(f->body, 1, f->len, fp) == f->len) {
+            f->body[f->len] = '\0';
+            if (f->body[f->len - 1U] == '\n' && tbl_recjournal_frame_fnv(f->job, f->body, f->len) == fnv) return 1;
+        }
+        /* torn frame: the next header may sit inside what was read */
+        (*bad)++;
+        if (pos < 0L || fseek(fp, pos, SEEK_SET) != 0) return 0;
+    }
+    return 0;
+}
+
+/* ---- journal memtable ---- */
+
+static void tbl_recjournal_mem_free(tbl_recjournal_mem_t *m)
+{
+    free(m->v);
+    free(m->arena);
+    (void)memset(m, 0, sizeof(*m));
+}
+
+static int tbl_recjournal_mem_add(tbl_recjournal_mem_t *m, const tbl_recjournal_frame_t *f)
+{
+    size_t jl = strlen(f->job) + 1U;
+    tbl_recjournal_row_t *r;
+
+    if (m->n == m->cap) {
+        unsigned long nc = m->cap ? m->cap * 2UL : 256UL;
+        tbl_recjournal_row_t *nv = (tbl_recjournal_row_t *)realloc(m->v, (size_t)nc * sizeof(*nv));
+        if (!nv) return 0;
+        m->v = nv;
+        m->cap = nc;
+    }
+    while (m->alen + (unsigned long)jl + (unsigned long)f->len + 1UL > m->acap) {
+        unsigned long nc = m->acap ? m->acap * 2UL : 65536UL;
+        char *na = (char *)realloc(m->arena, (size_t)nc);
+        if (!na) return 0;
+        m->arena = na;
+        m->acap = nc;
+    }
+    r = &m->v[m->n];
+    r->seq = m->n;
+    r->joff = m->alen;
+    (void)memcpy(m->arena + m->alen, f->job, jl);
+    m->alen += (unsigned long)jl;
+    r->boff = m->alen;
+    r->len = f->len;
+    (void)memcpy(m->arena + m->alen, f->body, f->len);
+    m->alen += (unsigned long)f->len;
+    m->arena[m->alen++] = '\0';
+    m->n++;
+    return 1;
+}
+
+static int tbl_recjournal_cmp_row(const void *a, const void *b)
+{
+    const tbl_recjournal_row_t *x = (const tbl_recjournal_row_t *)a;
+    const tbl_recjournal_row_t *y = (const tbl_recjournal_row_t *)b;
+    int c = strcmp(x->job, y->job);
+
+    if (c != 0) return c;
+    return (x->seq < y->seq) ? -1 : (x->seq > y->seq) ? 1 : 0;
+}
+
+/* every intact frame of the journal, sorted by jobid, last frame per job */
+static int tbl_recjournal_mem_load(tbl_recjournal_mem_t *m, const char *path)
+{
+    tbl_recjournal_frame_t *f;
+    unsigned long bad = 0UL;
+    unsigned long i;
+    unsigned long k;
+    FILE *fp;
+    int ok = 1;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    f = (tbl_recjournal_frame_t *)malloc(sizeof(*f));
+    if (!f) ok = 0;
+    while (ok && tbl_recjournal_next(fp, f, &bad)) {
+        if (!tbl_recjournal_mem_add(m, f)) ok = 0;
+    }
+    fclose(fp);
+    free(f);
+    if (!ok) return 0;
+
+    for (i = 0UL; i < m->n; ++i) {
+        m->v[i].job = m->arena + m->v[i].joff;
+        m->v[i].body = m->arena + m->v[i].boff;
+    }
+    if (m->n > 1UL) qsort(m->v, (size_t)m->n, sizeof(m->v[0]), tbl_recjournal_cmp_row);
+    for (i = 0UL, k = 0UL; i < m->n; ++i) {
+        if (i + 1UL < m->n && strcmp(m->v[i].job, m->v[i + 1UL].job) == 0) continue;
+        m->v[k++] = m->v[i];
+    }
+    m->n = k;
+    return 1;
+}
+
+/* ---- manifest ---- */
+
+static int tbl_recjournal_man_read(const char *path, tbl_recjournal_man_t *man)
+{
+    char line[128];
+    FILE *fp;
+    int ok = 1;
+
+    (void)memset(man, 0, sizeof(*man));
+    man->next = 1UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+        const char *p = line;
+
+        if (strncmp(p, "next=", 5) == 0) {
+            p += 5;
+            if (!tbl_recjournal_ul(&p, &man->next) || *p != '\n') ok = 0;
+        } else if (strncmp(p, "snap=", 5) == 0) {
+            p += 5;
+            if (man->nsnaps == TBL_RECJOURNAL_MAX_SNAPS ||
+                !tbl_recjournal_ul(&p, &man->seq[man->nsnaps]) || *p++ != ' ' ||
+                !tbl_recjournal_ul(&p, &man->n[man->nsnaps]) || *p != '\n') {
+                ok = 0;
+            } else {
+                man->nsnaps++;
+            }
+        } else {
+            ok = 0;
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+static int tbl_recjournal_man_write(const tbl_recjournal_paths_t *p, const tbl_recjournal_man_t *man)
+{
+    char nbuf[32];
+    FILE *fp;
+    unsigned long i;
+    int ok;
+
+    fp = fopen(p->mantmp, "wb");
+    if (!fp) return 0;
+    ok = tbl_ul_to_dec_ok(man->next, nbuf, sizeof(nbuf)) && tbl_fputs_ok(fp, "next=") &&
+         tbl_fputs_ok(fp, nbuf) && tbl_fputs_ok(fp, "\n");
+    for (i = 0UL; ok && i < man->nsnaps; ++i) {
+        ok = tbl_ul_to_dec_ok(man->seq[i], nbuf, sizeof(nbuf)) && tbl_fputs_ok(fp, "snap=") &&
+             tbl_fputs_ok(fp, nbuf) && tbl_fputs_ok(fp, " ") &&
+             tbl_ul_to_dec_ok(man->n[i], nbuf, sizeof(nbuf)) && tbl_fputs_ok(fp, nbuf) &&
+             tbl_fputs_ok(fp, "\n");
+    }
+    if (fclose(fp) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(p->mantmp, p->man, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(p->mantmp);
+    return ok;
+}
+
+/* ---- snapshot writer ---- */
+
+static int tbl_recjournal_w_open(tbl_recjournal_w_t *w, const char *path)
+{
+    (void)memset(w, 0, sizeof(*w));
+    w->fp = fopen(path, "wb");
+    if (!w->fp) return 0;
+    w->ok = (fwrite("TBLRJS1\n", 1, 8, w->fp) == 8U) ? 1 : 0;
+    w->off = 8UL;
+    return w->ok;
+}
+
+static void tbl_recjournal_w_add(tbl_recjournal_w_t *w, const char *job, const char *body, size_t len)
+{
+    char hdr[TBL_RECJOURNAL_HDR_MAX];
+    size_t hl;
+
+    if (!w->ok) return;
+    if (w->n % TBL_RECJOURNAL_BLOCK == 0UL) {
+        if (w->nb == w->bcap) {
+            unsigned long nc = w->bcap ? w->bcap * 2UL : 64UL;
+            unsigned long *nv = (unsigned long *)realloc(w->bidx, (size_t)nc * sizeof(*nv));
+            if (!nv) {
+                w->ok = 0;
+                return;
+            }
+            w->bidx = nv;
+            w->bcap = nc;
+        }
+        w->bidx[w->nb++] = w->off;
+    }
+    if (!tbl_recjournal_hdr(job, body, len, hdr, sizeof(hdr))) {
+        w->ok = 0;
+        return;
+    }
+    hl = strlen(hdr);
+    if (fwrite(hdr, 1, hl, w->fp) != hl || fwrite(body, 1, len, w->fp) != len) {
+        w->ok = 0;
+        return;
+    }
+    w->off += (unsigned long)(hl + len);
+    w->n++;
+}
+
+/* block index + footer; closes the file. Returns 1/0. */
+static int tbl_recjournal_w_finish(tbl_recjournal_w_t *w)
+{
+    unsigned char foot[TBL_RECJOURNAL_FOOT];
+    unsigned char e[8];
+    unsigned long h = 2166136261UL;
+    unsigned long i;
+    int ok = w->ok;
+
+    for (i = 0UL; ok && i < w->nb; ++i) {
+        tbl_recjournal_put32(e, w->bidx[i]);
+        tbl_recjournal_put32(e + 4, tbl_recjournal_hi32(w->bidx[i]));
+        h = tbl_recjournal_fnv(h, e, sizeof(e));
+        if (fwrite(e, 1, sizeof(e), w->fp) != sizeof(e)) ok = 0;
+    }
+    (void)memset(foot, 0, sizeof(foot));
+    tbl_recjournal_put32(foot, w->n);
+    tbl_recjournal_put32(foot + 4, w->nb);
+    tbl_recjournal_put32(foot + 8, w->off);
+    tbl_recjournal_put32(foot + 12, tbl_recjournal_hi32(w->off));
+    h = tbl_recjournal_fnv(h, foot, 16U);
+    tbl_recjournal_put32(foot + 16, h);
+    (void)memcpy(foot + 24, "TBLRSZ1\n", 8);
+    if (ok && fwrite(foot, 1, sizeof(foot), w->fp) != sizeof(foot)) ok = 0;
+    if (fclose(w->fp) != 0) ok = 0;
+    w->fp = 0;
+    free(w->bidx);
+    w->bidx = 0;
+    return ok;
+}
+
+/* ---- snapshot reader ---- */
+
+static void tbl_recjournal_snap_close(tbl_recjournal_snap_t *s)
+{
+    if (s->fp) fclose(s->fp);
+    free(s->bidx);
+    (void)memset(s, 0, sizeof(*s));
+}
+
+/* Returns 0 ok, 1 missing, 2 damaged. */
+static int tbl_recjournal_snap_open(tbl_recjournal_snap_t *s, const char *path)
+{
+    unsigned char foot[TBL_RECJOURNAL_FOOT];
+    unsigned char e[8];
+    unsigned long h = 2166136261UL;
+    unsigned long ioff;
+    unsigned long i;
+    long size;
+
+    (void)memset(s, 0, sizeof(*s));
+    s->fp = fopen(path, "rb");
+    if (!s->fp) return 1;
+    if (fseek(s->fp, 0L, SEEK_END) != 0 || (size = ftell(s->fp)) < (long)(8UL + TBL_RECJOURNAL_FOOT) ||
+        fseek(s->fp, size - (long)TBL_RECJOURNAL_FOOT, SEEK_SET) != 0 ||
+        fread(foot, 1, sizeof(foot), s->fp) != sizeof(foot) || memcmp(foot + 24, "TBLRSZ1\n", 8) != 0) {
+        tbl_recjournal_snap_close(s);
+        return 2;
+    }
+    s->n = tbl_recjournal_get32(foot);
+    s->nb = tbl_recjournal_get32(foot + 4);
+    if (!tbl_recjournal_get64(foot + 8, &ioff) || s->nb != (s->n + TBL_RECJOURNAL_BLOCK - 1UL) / TBL_RECJOURNAL_BLOCK ||
+        ioff + s->nb * 8UL + TBL_RECJOURNAL_FOOT != (unsigned long)size || !tbl_recjournal_seek(s->fp, ioff)) {
+        tbl_recjournal_snap_close(s);
+        return 2;
+    }
+    s->bidx = (unsigned long *)malloc((size_t)(s->nb ? s->nb : 1UL) * sizeof(unsigned long));
+    if (!s->bidx) {
+        tbl_recjournal_snap_close(s);
+        return 2;
+    }
+    for (i = 0UL; i < s->nb; ++i) {
+        if (fread(e, 1, sizeof(e), s->fp) != sizeof(e) || !tbl_recjournal_get64(e, &s->bidx[i])) {
+            tbl_recjournal_snap_close(s);
+            return 2;
+        }
+        h = tbl_recjournal_fnv(h, e, sizeof(e));
+        if (s->bidx[i] < 8UL || s->bidx[i] >= ioff || (i > 0UL && s->bidx[i] <= s->bidx[i - 1UL])) {
+            tbl_recjournal_snap_close(s);
+            return 2;
+        }
+    }
+    h = tbl_recjournal_fnv(h, foot, 16U);
+    if (h != tbl_recjournal_get32(foot + 16)) {
+        tbl_recjournal_snap_close(s);
+        return 2;
+    }
+    return 0;
+}
+
+/* next frame of a snapshot; inside a snapshot any damage is an error */
+static int tbl_recjournal_snap_frame(tbl_recjournal_snap_t *s, tbl_recjournal_frame_t *f)
+{
+    unsigned long bad = 0UL;
+    return tbl_recjournal_next(s->fp, f, &bad) && bad == 0UL;
+}
+
+/* Returns 0 found, 1 not in this snapshot, 2 damaged. */
+static int tbl_recjournal_snap_find(tbl_recjournal_snap_t *s, const char *jobid, tbl_recjournal_frame_t *f)
+{
+    unsigned long lo = 0UL;
+    unsigned long hi = s->nb;
+    unsigned long b;
+    unsigned long k;
+    unsigned long i;
+
+    if (s->nb == 0UL) return 1;
+    /* last block whose first jobid <= jobid */
+    while (hi - lo > 1UL) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        if (!tbl_recjournal_seek(s->fp, s->bidx[mid]) || !tbl_recjournal_snap_frame(s, f)) return 2;
+        if (strcmp(f->job, jobid) <= 0) lo = mid;
+        else hi = mid;
+    }
+    b = lo;
+    k = s->n - b * TBL_RECJOURNAL_BLOCK;
+    if (k > TBL_RECJOURNAL_BLOCK) k = TBL_RECJOURNAL_BLOCK;
+    if (!tbl_recjournal_seek(s->fp, s->bidx[b])) return 2;
+    for (i = 0UL; i < k; ++i) {
+        int c;
+
+        if (!tbl_recjournal_snap_frame(s, f)) return 2;
+        c = strcmp(f->job, jobid);
+        if (c == 0) return 0;
+        if (c > 0) return 1;
+    }
+    return 1;
+}
+
+/* ---- merge cursors ---- */
+
+static void tbl_recjournal_cur_next(tbl_recjournal_cur_t *c)
+{
+    c->valid = 0;
+    if (c->snap) {
+        if (c->left == 0UL) return;
+        if (!tbl_recjournal_snap_frame(c->snap, &c->f)) {
+            c->bad = 1;
+            return;
+        }
+        c->left--;
+        c->valid = 1;
+        return;
+    }
+    if (c->ri >= c->nrows) return;
+    (void)tbl_strlcpy(c->f.job, c->rows[c->ri].job, sizeof(c->f.job));
+    (void)memcpy(c->f.body, c->rows[c->ri].body, c->rows[c->ri].len);
+    c->f.len = c->rows[c->ri].len;
+    c->f.body[c->f.len] = '\0';
+    c->ri++;
+    c->valid = 1;
+}
+
+static void tbl_recjournal_cur_snap(tbl_recjournal_cur_t *c, tbl_recjournal_snap_t *s)
+{
+    (void)memset(c, 0, sizeof(*c));
+    c->snap = s;
+    c->left = s->n;
+    if (s->n > 0UL && !tbl_recjournal_seek(s->fp, s->bidx[0])) {
+        c->bad = 1;
+        return;
+    }
+    tbl_recjournal_cur_next(c);
+}
+
+static void tbl_recjournal_cur_rows(tbl_recjournal_cur_t *c, const tbl_recjournal_mem_t *m)
+{
+    (void)memset(c, 0, sizeof(*c));
+    c->rows = m->v;
+    c->nrows = m->n;
+    tbl_recjournal_cur_next(c);
+}
+
+/* smallest jobid over k cursors; the newest source (highest index) wins a
+   tie and the older ones skip it. Returns the cursor index or -1. */
+static int tbl_recjournal_pick(tbl_recjournal_cur_t **cs, int k)
+{
+    int best = -1;
+    int i;
+
+    for (i = 0; i < k; ++i) {
+        int c;
+
+        if (!cs[i]->valid) continue;
+        if (best < 0) {
+            best = i;
+            continue;
+        }
+        c = strcmp(cs[i]->f.job, cs[best]->f.job);
+        if (c < 0) {
+            best = i;
+        } else if (c == 0) {
+            tbl_recjournal_cur_next(cs[best]);
+            best = i;
+        }
+    }
+    return best;
+}
+
+/* ---- writers: flush, merge ---- */
+
+static int tbl_recjournal_lock(const tbl_recjournal_paths_t *p, tbl_fs_lock_t *lk, char *err, size_t errsz)
+{
+    if (tbl_fs_lock_open(lk, p->lock) != 0) {
+        tbl_recjournal_seterr(err, errsz, "cannot open recjournal lock");
+        return 0;
+    }
+    if (tbl_fs_lock_acquire(lk) != 0) {
+        (void)tbl_fs_lock_close(lk);
+        tbl_recjournal_seterr(err, errsz, "cannot lock recjournal");
+        return 0;
+    }
+    return 1;
+}
+
+/* sources (oldest first) -> snapshot <seq> (tmp + rename) */
+static int tbl_recjournal_write_merged(const tbl_recjournal_paths_t *p, tbl_recjournal_cur_t **cs, int k,
+                                       unsigned long seq, unsigned long *out_n)
+{
+    char tmp[1100];
+    char dst[1100];
+    tbl_recjournal_w_t w;
+    int ok;
+    int i;
+
+    if (!tbl_recjournal_snap_path(p, seq, 1, tmp, sizeof(tmp)) ||
+        !tbl_recjournal_snap_path(p, seq, 0, dst, sizeof(dst))) return 0;
+    if (!tbl_recjournal_w_open(&w, tmp)) {
+        if (w.fp) fclose(w.fp);
+        (void)tbl_fs_remove_file(tmp);
+        return 0;
+    }
+    for (;;) {
+        int b = tbl_recjournal_pick(cs, k);
+
+        if (b < 0) break;
+        tbl_recjournal_w_add(&w, cs[b]->f.job, cs[b]->f.body, cs[b]->f.len);
+        tbl_recjournal_cur_next(cs[b]);
+    }
+    for (i = 0; i < k; ++i) {
+        if (cs[i]->bad) w.ok = 0;
+    }
+    *out_n = w.n;
+    ok = tbl_recjournal_w_finish(&w);
+    if (ok && tbl_fs_rename_atomic(tmp, dst, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(tmp);
+    return ok;
+}
+
+/* snapshots man[from..] (+ rows m, newest) -> one snapshot <seq> */
+static int tbl_recjournal_merge(const tbl_recjournal_paths_t *p, const tbl_recjournal_man_t *man,
+                                unsigned long from, const tbl_recjournal_mem_t *m,
+                                unsigned long seq, unsigned long *out_n)
+{
+    tbl_recjournal_snap_t snaps[TBL_RECJOURNAL_MAX_SNAPS];
+    tbl_recjournal_cur_t *cs[TBL_RECJOURNAL_MAX_SNAPS + 1UL];
+    char path[1100];
+    unsigned long k = man->nsnaps - from;
+    unsigned long i;
+    int ok = 1;
+
+    for (i = 0UL; i <= k; ++i) cs[i] = 0;
+    for (i = 0UL; i < k; ++i) snaps[i].fp = 0;
+    for (i = 0UL; ok && i <= k; ++i) {
+        cs[i] = (tbl_recjournal_cur_t *)malloc(sizeof(tbl_recjournal_cur_t));
+        if (!cs[i]) ok = 0;
+    }
+    for (i = 0UL; ok && i < k; ++i) {
+        if (!tbl_recjournal_snap_path(p, man->seq[from + i], 0, path, sizeof(path)) ||
+            tbl_recjournal_snap_open(&snaps[i], path) != 0) {
+            ok = 0;
+        } else {
+            tbl_recjournal_cur_snap(cs[i], &snaps[i]);
+        }
+    }
+    if (ok) {
+        if (m) tbl_recjournal_cur_rows(cs[k], m);
+        ok = tbl_recjournal_write_merged(p, cs, (int)(m ? k + 1UL : k), seq, out_n);
+    }
+    for (i = 0UL; i < k; ++i) {
+        if (snaps[i].fp) tbl_recjournal_snap_close(&snaps[i]);
+    }
+    for (i = 0UL; i <= k; ++i) free(cs[i]);
+    return ok;
+}
+
+/* journal -> new snapshot, then merge while the newest snapshot is at least
+   as large as the one before it (or the manifest is full). Caller holds the
+   lock. */
+static int tbl_recjournal_flush(const tbl_recjournal_paths_t *p, char *err, size_t errsz)
+{
+    tbl_recjournal_mem_t m;
+    tbl_recjournal_man_t man;
+    unsigned long gone[2UL * TBL_RECJOURNAL_MAX_SNAPS];
+    unsigned long ngone = 0UL;
+    unsigned long n;
+    unsigned long i;
+    int ok;
+
+    (void)memset(&m, 0, sizeof(m));
+    if (!tbl_recjournal_man_read(p->man, &man)) {
+        tbl_recjournal_seterr(err, errsz, "recjournal manifest damaged");
+        return 0;
+    }
+    ok = tbl_recjournal_mem_load(&m, p->log);
+    if (ok && m.n > 0UL) {
+        tbl_recjournal_man_t none;
+
+        (void)memset(&none, 0, sizeof(none));
+        ok = tbl_recjournal_merge(p, &none, 0UL, &m, man.next, &n);
+        if (ok) {
+            if (man.nsnaps == TBL_RECJOURNAL_MAX_SNAPS) ok = 0;
+            else {
+                man.seq[man.nsnaps] = man.next++;
+                man.n[man.nsnaps++] = n;
+            }
+        }
+        while (ok && man.nsnaps >= 2UL &&
+               (man.n[man.nsnaps - 1UL] >= man.n[man.nsnaps - 2UL] || man.nsnaps + 1UL >= TBL_RECJOURNAL_MAX_SNAPS)) {
+            ok = tbl_recjournal_merge(p, &man, man.nsnaps - 2UL, 0, man.next, &n);
+            if (!ok) break;
+            gone[ngone++] = man.seq[man.nsnaps - 2UL];
+            gone[ngone++] = man.seq[man.nsnaps - 1UL];
+            man.nsnaps--;
+            man.seq[man.nsnaps - 1UL] = man.next++;
+            man.n[man.nsnaps - 1UL] = n;
+        }
+        if (ok) ok = tbl_recjournal_man_write(p, &man);
+    }
+    tbl_recjournal_mem_free(&m);
+    if (!ok) {
+        tbl_recjournal_seterr(err, errsz, "cannot fold journal into a snapshot");
+        return 0;
+    }
+    /* the snapshot is in the manifest now: readers no longer need the frames */
+    (void)tbl_fs_write_file(p->log, "", 0);
+    for (i = 0UL; i < ngone; ++i) {
+        char path[1100];
+        if (tbl_recjournal_snap_path(p, gone[i], 0, path, sizeof(path))) (void)tbl_fs_remove_file(path);
+    }
+    return 1;
+}
+
+/* ---- public ---- */
+
+int tbl_recjournal_active_ok(const char *repo_root)
+{
+    char dir[1024];
+    int is_dir;
+
+    if (!repo_root || !repo_root[0]) return 0;
+    if (!tbl_path_join2(dir, sizeof(dir), repo_root, "recjournal")) return 0;
+    is_dir = 0;
+    if (tbl_fs_is_dir(dir, &is_dir) != 0) return 0;
+    return is_dir ? 1 : 0;
+}
+
+int tbl_recjournal_view_ok(const char *repo_root)
+{
+    tbl_recjournal_paths_t p;
+    int ex;
+
+    if (!repo_root || !repo_root[0] || !tbl_recjournal_paths(repo_root, &p)) return 0;
+    ex = 0;
+    (void)tbl_fs_exists(p.view, &ex);
+    return ex ? 1 : 0;
+}
+
+int tbl_recjournal_create(const char *repo_root, int ini_view, char *err, size_t errsz)
+{
+    tbl_recjournal_paths_t p;
+    int ex;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !tbl_recjournal_paths(repo_root, &p)) {
+        tbl_recjournal_seterr(err, errsz, "record journal path too long");
+        return 2;
+    }
+    if (tbl_fs_mkdir_p(p.dir) != 0) {
+        tbl_recjournal_seterr(err, errsz, "cannot create recjournal directory");
+        return 2;
+    }
+    ex = 0;
+    (void)tbl_fs_exists(p.view, &ex);
+    if (ini_view && !ex && tbl_fs_write_file(p.view, "", 0) != 0) {
+        tbl_recjournal_seterr(err, errsz, "cannot write recjournal/ini_view");
+        return 2;
+    }
+    if (!ini_view && ex && tbl_fs_remove_file(p.view) != 0) {
+        tbl_recjournal_seterr(err, errsz, "cannot remove recjournal/ini_view");
+        return 2;
+    }
+    return 0;
+}
+
+int tbl_recjournal_put(const char *repo_root, const char *jobid, const char *body, size_t len,
+                       char *err, size_t errsz)
+{
+    tbl_recjournal_paths_t p;
+    tbl_fs_afile_t af;
+    tbl_fs_lock_t lk;
+    char frame[TBL_RECJOURNAL_HDR_MAX + TBL_RECJOURNAL_BODY_MAX];
+    unsigned long size = 0UL;
+    size_t hl;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !tbl_recjournal_job_ok(jobid) || !body || len == 0 ||
+        len > (size_t)TBL_RECJOURNAL_BODY_MAX || body[len - 1U] != '\n') {
+        tbl_recjournal_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_recjournal_paths(repo_root, &p) || !tbl_recjournal_hdr(jobid, body, len, frame, TBL_RECJOURNAL_HDR_MAX)) {
+        tbl_recjournal_seterr(err, errsz, "record journal path too long");
+        return 2;
+    }
+    hl = strlen(frame);
+    (void)memcpy(frame + hl, body, len);
+
+    if (!tbl_recjournal_lock(&p, &lk, err, errsz)) return 2;
+    rc = 0;
+    if (tbl_fs_afile_open(&af, p.log) != 0) {
+        tbl_recjournal_seterr(err, errsz, "cannot open journal.log");
+        rc = 2;
+    } else {
+        /* one write per frame: a crash leaves at most one torn frame */
+        if (tbl_fs_afile_write(&af, frame, hl + len) != 0 || tbl_fs_afile_size(&af, &size) != 0) {
+            tbl_recjournal_seterr(err, errsz, "cannot append journal.log");
+            rc = 2;
+        }
+        if (tbl_fs_afile_close(&af) != 0 && rc == 0) {
+            tbl_recjournal_seterr(err, errsz, "cannot append journal.log");
+            rc = 2;
+        }
+    }
+    if (rc == 0 && size > TBL_RECJOURNAL_MAX && !tbl_recjournal_flush(&p, err, errsz)) rc = 2;
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+/* newest journal frame of jobid. Returns 1 found, 0 not. */
+static int tbl_recjournal_scan_log(const char *path, const char *jobid, tbl_recjournal_frame_t *f,
+                                   tbl_recjournal_frame_t *hit)
+{
+    unsigned long bad = 0UL;
+    int found = 0;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+    while (tbl_recjournal_next(fp, f, &bad)) {
+        if (strcmp(f->job, jobid) != 0) continue;
+        (void)memcpy(hit, f, sizeof(*hit));
+        found = 1;
+    }
+    fclose(fp);
+    return found;
+}
+
+int tbl_recjournal_get(const char *repo_root, const char *jobid, char *body, size_t bodysz,
+                       size_t *out_len, char *err, size_t errsz)
+{
+    tbl_recjournal_paths_t p;
+    tbl_recjournal_frame_t *f;
+    tbl_recjournal_frame_t *hit;
+    int attempt;
+    int rc = 1;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_len) *out_len = 0;
+    if (!repo_root || !repo_root[0] || !jobid || !body || bodysz == 0) {
+        tbl_recjournal_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_recjournal_job_ok(jobid)) return 1;
+    if (!tbl_recjournal_paths(repo_root, &p)) {
+        tbl_recjournal_seterr(err, errsz, "record journal path too long");
+        return 2;
+    }
+    f = (tbl_recjournal_frame_t *)malloc(2U * sizeof(*f));
+    if (!f) {
+        tbl_recjournal_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    hit = f + 1;
+
+    /* journal before manifest: a concurrent fold only moves frames into a
+       snapshot the manifest already names; a merged-away snapshot retries */
+    for (attempt = 0; attempt < 3; ++attempt) {
+        tbl_recjournal_man_t man;
+        unsigned long i;
+        int vanished = 0;
+
+        if (tbl_recjournal_scan_log(p.log, jobid, f, hit)) {
+            rc = 0;
+            break;
+        }
+        if (!tbl_recjournal_man_read(p.man, &man)) {
+            tbl_recjournal_seterr(err, errsz, "recjournal manifest damaged");
+            rc = 2;
+            break;
+        }
+        rc = 1;
+        for (i = man.nsnaps; i > 0UL && rc == 1 && !vanished; --i) {
+            tbl_recjournal_snap_t s;
+            char path[1100];
+            int orc;
+
+            if (!tbl_recjournal_snap_path(&p, man.seq[i - 1UL], 0, path, sizeof(path))) {
+                rc = 2;
+                break;
+            }
+            orc = tbl_recjournal_snap_open(&s, path);
+            if (orc == 1) {
+                vanished = 1;
+                break;
+            }
+            if (orc != 0) {
+                tbl_recjournal_seterr(err, errsz, "recjournal snapshot damaged");
+                rc = 2;
+                break;
+            }
+            rc = tbl_recjournal_snap_find(&s, jobid, hit);
+            tbl_recjournal_snap_close(&s);
+            if (rc == 2) tbl_recjournal_seterr(err, errsz, "recjournal snapshot damaged");
+        }
+        if (!vanished) break;
+        rc = 2;
+        tbl_recjournal_seterr(err, errsz, "recjournal snapshot vanished");
+    }
+    if (rc == 0) {
+        if (hit->len >= bodysz) {
+            tbl_recjournal_seterr(err, errsz, "record buffer too small");
+            rc = 2;
+        } else {
+            (void)memcpy(body, hit->body, hit->len);
+            body[hit->len] = '\0';
+            if (out_len) *out_len = hit->len;
+        }
+    }
+    free(f);
+    return rc;
+}
+
+int tbl_recjournal_each(const char *repo_root, tbl_recjournal_fn fn, void *ud, unsigned long *out_n,
+                        char *err, size_t errsz)
+{
+    tbl_recjournal_paths_t p;
+    tbl_recjournal_man_t man;
+    tbl_recjournal_mem_t m;
+    tbl_recjournal_snap_t snaps[TBL_RECJOURNAL_MAX_SNAPS];
+    tbl_recjournal_cur_t *cs[TBL_RECJOURNAL_MAX_SNAPS + 1UL];
+    tbl_fs_lock_t lk;
+    unsigned long n = 0UL;
+    unsigned long i;
+    int rc = 0;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_n) *out_n = 0UL;
+    if (!repo_root || !repo_root[0] || !fn) {
+        tbl_recjournal_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_recjournal_active_ok(repo_root)) return 0;
+    if (!tbl_recjournal_paths(repo_root, &p)) {
+        tbl_recjournal_seterr(err, errsz, "record journal path too long");
+        return 2;
+    }
+
+    /* manifest, snapshots and journal from one moment; the walk itself
+       runs on the open files without the lock */
+    (void)memset(&m, 0, sizeof(m));
+    for (i = 0UL; i < TBL_RECJOURNAL_MAX_SNAPS; ++i) snaps[i].fp = 0;
+    for (i = 0UL; i <= TBL_RECJOURNAL_MAX_SNAPS; ++i) cs[i] = 0;
+    if (!tbl_recjournal_lock(&p, &lk, err, errsz)) return 2;
+    if (!tbl_recjournal_man_read(p.man, &man)) {
+        tbl_recjournal_seterr(err, errsz, "recjournal manifest damaged");
+        rc = 2;
+    }
+    for (i = 0UL; rc == 0 && i < man.nsnaps; ++i) {
+        char path[1100];
+
+        if (!tbl_recjournal_snap_path(&p, man.seq[i], 0, path, sizeof(path)) ||
+            tbl_recjournal_snap_open(&snaps[i], path) != 0) {
+            tbl_recjournal_seterr(err, errsz, "recjournal snapshot damaged");
+            rc = 2;
+        }
+    }
+    if (rc == 0 && !tbl_recjournal_mem_load(&m, p.log)) {
+        tbl_recjournal_seterr(err, errsz, "out of memory");
+        rc = 2;
+    }
+    (void)tbl_fs_lock_close(&lk);
+
+    for (i = 0UL; rc == 0 && i <= man.nsnaps; ++i) {
+        cs[i] = (tbl_recjournal_cur_t *)malloc(sizeof(tbl_recjournal_cur_t));
+        if (!cs[i]) {
+            tbl_recjournal_seterr(err, errsz, "out of memory");
+            rc = 2;
+        } else if (i < man.nsnaps) {
+            tbl_recjournal_cur_snap(cs[i], &snaps[i]);
+        } else {
+            tbl_recjournal_cur_rows(cs[i], &m);
+        }
+    }
+    while (rc == 0) {
+        int b = tbl_recjournal_pick(cs, (int)man.nsnaps + 1);
+
+        if (b < 0) break;
+        n++;
+        if (fn(ud, cs[b]->f.job, cs[b]->f.body, cs[b]->f.len) != 0) break;
+        tbl_recjournal_cur_next(cs[b]);
+    }
+    for (i = 0UL; rc == 0 && i < man.nsnaps; ++i) {
+        if (cs[i]->bad) {
+            tbl_recjournal_seterr(err, errsz, "recjournal snapshot damaged");
+            rc = 2;
+        }
+    }
+
+    for (i = 0UL; i < TBL_RECJOURNAL_MAX_SNAPS; ++i) {
+        if (snaps[i].fp) tbl_recjournal_snap_close(&snaps[i]);
+    }
+    for (i = 0UL; i <= TBL_RECJOURNAL_MAX_SNAPS; ++i) free(cs[i]);
+    tbl_recjournal_mem_free(&m);
+    if (rc == 0 && out_n) *out_n = n;
+    return rc;
+}
+
+#endif /* TBL_RECJOURNAL_IMPLEMENTATION */
+
+#endif /* TBL_CORE_RECJOURNAL_H */
@@ -4,11 +4,37 @@
 #include <stddef.h>
 
 /* Repo record (INI-ish key=value lines).
-   Path: <repo_root>/records/<jobid>.ini
+   Path: <repo_root>/records/<ab>/<jobid>.ini
+         <ab> = 2 hex digits of FNV-1a(jobid) & 0xff (256 shards, so a
+         million records keep every directory at a few thousand entries)
+
+   Records of older repos still lie flat in <repo_root>/records/<jobid>.ini.
+   Reads look in the shard first, then in the flat layout; writes always go
+   to the shard and drop a flat copy. tbl_record_migrate() moves the flat
+   files into their shards.
+
+   With the record journal active (core/recjournal.h, [records] store =
+   journal) writes append to it instead and reads look there first; the
+   .ini files are then only written as a view (ini_view) and read for jobs
+   the journal does not hold yet. Which engine is active is set once per
+   process from the config (tbl_record_set_store); left at AUTO it follows
+   the repo (journal once recjournal/ exists).
+
+   User tags (the job's tags.ini, see core/ingest.h) are kept as
+   "tag.<key>=<value>" lines, so they travel with the record text into
+   packages and back.
 
    This is the durable "truth" (AIP-light metadata) independent of spool/out retention.
 */
 
+#define TBL_RECORD_SHARDS 256UL
+
+/* tags: keys of [a-z0-9_.-], values of printable bytes without blanks at
+   either end; all "key=value\n" lines of a record together below TAGS_MAX */
+#define TBL_RECORD_TAGS_MAX 512
+#define TBL_RECORD_TAG_KEY_MAX 32
+#define TBL_RECORD_TAG_VALUE_MAX 128
+
 typedef struct tbl_record_s {
     char job[256];        /* job id (directory name) */
     char status[16];      /* "ok" or "fail" */
@@ -17,23 +43,83 @@ typedef struct tbl_record_s {
     unsigned long bytes;  /* payload size (best effort) */
     unsigned long stored_at; /* unix epoch seconds (best effort) */
     char reason[256];     /* optional error reason */
+    char tags[TBL_RECORD_TAGS_MAX]; /* "key=value\n" lines sorted by key, "" = none */
 } tbl_record_t;
 
 /* Safe job id: no path separators, no "..", no control chars. */
 int tbl_record_is_safe_id(const char *jobid);
 
-/* Compute <repo_root>/records/<jobid>.ini (no filesystem access). Returns 1/0. */
+/* Per-tag callback of tbl_record_tag_each(): 0 = continue, else stop. */
+typedef int (*tbl_record_tag_fn)(void *ud, const char *key, const char *value);
+
+/* 1 if key / value may be stored as a tag. */
+int tbl_record_tag_key_ok(const char *key);
+int tbl_record_tag_value_ok(const char *value);
+
+/* Set (or replace) tag key (A-Z folded to a-z) to value.
+   Returns 0 ok, 2 invalid key/value or no room left in rec->tags. */
+int tbl_record_tag_set(tbl_record_t *rec, const char *key, const char *value);
+
+/* Value of tag key into out. Returns 1 found, 0 not. */
+int tbl_record_tag_get_ok(const tbl_record_t *rec, const char *key, char *out, size_t outsz);
+
+/* Call fn for every tag in key order. Returns 0, or what fn stopped with. */
+int tbl_record_tag_each(const tbl_record_t *rec, tbl_record_tag_fn fn, void *ud);
+
+/* Per-record callback of tbl_record_each(): 0 = continue, else stop. */
+typedef int (*tbl_record_fn)(void *ud, const tbl_record_t *rec);
+
+unsigned long tbl_record_shard(const char *jobid);
+
+/* Compute <repo_root>/records/<ab>/<jobid>.ini (no filesystem access). Returns 1/0. */
 int tbl_record_path(const char *repo_root, const char *jobid, char *out_path, size_t out_path_sz);
 
-/* Write record to repo path, creating <repo_root>/records as needed. Returns 0 on success. */
+/* Compute the flat <repo_root>/records/<jobid>.ini (no filesystem access). Returns 1/0. */
+int tbl_record_flat_path(const char *repo_root, const char *jobid, char *out_path, size_t out_path_sz);
+
+/* Path of the stored record: the shard, else a not yet migrated flat file;
+   the shard path if there is neither. Returns 1/0. */
+int tbl_record_find_path(const char *repo_root, const char *jobid, char *out_path, size_t out_path_sz);
+
+/* Write record to its shard, creating <repo_root>/records/<ab> as needed. Returns 0 on success. */
 int tbl_record_write_repo(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz);
 
-/* Read record from repo path. Returns 0 on success. */
+/* Record engine for this process ([records] store), set before any
+   record I/O and before threads start:
+   - AUTO (default): the journal once recjournal/ exists, else files
+   - FILES: the .ini files only; an existing recjournal/ is ignored
+   - JOURNAL: the journal; the first write creates recjournal/, ini_view
+     keeps the .ini files as a view (the repo's ini_view marker is not read) */
+#define TBL_RECORD_STORE_AUTO 0
+#define TBL_RECORD_STORE_FILES 1
+#define TBL_RECORD_STORE_JOURNAL 2
+void tbl_record_set_store(int store, int ini_view);
+
+/* Read record from repo path (shard, then flat). Returns 0 on success. */
 int tbl_record_read_repo(const char *repo_root, const char *jobid, tbl_record_t *out_rec, char *err, size_t errsz);
 
 /* Read record from an explicit file path (used by package verify/ingest). Returns 0 on success. */
 int tbl_record_read_file(const char *path, tbl_record_t *out_rec, char *err, size_t errsz);
 
+/* 1 if jobid has a stored record (journal or .ini). */
+int tbl_record_exists_ok(const char *repo_root, const char *jobid);
+
+/* Copy the stored record text of jobid to dst (the .ini, or its journal
+   text). Returns 0 on success. */
+int tbl_record_copy_to(const char *repo_root, const char *jobid, const char *dst, char *err, size_t errsz);
+
+/* Call fn for every stored record: the journal's if it is active, else
+   every .ini in both layouts (a flat file that also has a shard copy is
+   skipped). Order is unspecified. Returns 0 ok, 2 error. */
+int tbl_record_each(const char *repo_root, tbl_record_fn fn, void *ud, char *err, size_t errsz);
+
+/* Move flat records into their shards; with the journal active, append
+   every .ini it does not hold yet instead (and remove the file unless the
+   .ini view is kept). A flat file whose shard copy exists already is older
+   and removed. Safe to rerun; run it while ingest is idle.
+   Returns 0 ok, 2 error. */
+int tbl_record_migrate(const char *repo_root, unsigned long *out_moved, char *err, size_t errsz);
+
 #ifdef TBL_RECORD_IMPLEMENTATION
 
 #include <stdio.h>
@@ -44,6 +130,7 @@ int tbl_record_read_file(const char *path, tbl_record_t *out_rec, char *err, siz
 #include "core/safe.h"
 #include "core/str.h"
 #include "core/path.h"
+#include "core/recjournal.h"
 #include "os/fs.h"
 
 static void tbl_record_seterr(char *err, size_t errsz, const char *msg)
@@ -54,6 +141,37 @@ static void tbl_record_seterr(char *err, size_t errsz, const char *msg)
     (void)tbl_strlcpy(err, msg, errsz);
 }
 
+static int tbl_record_store = TBL_RECORD_STORE_AUTO;
+static int tbl_record_store_view = 0;
+
+void tbl_record_set_store(int store, int ini_view)
+{
+    tbl_record_store = (store == TBL_RECORD_STORE_FILES || store == TBL_RECORD_STORE_JOURNAL) ? store
+                                                                                              : TBL_RECORD_STORE_AUTO;
+    tbl_record_store_view = ini_view ? 1 : 0;
+}
+
+/* the journal is read while it is the engine and exists (a configured
+   journal without recjournal/ holds nothing yet) */
+static int tbl_record_journal_ok(const char *repo_root)
+{
+    if (tbl_record_store == TBL_RECORD_STORE_FILES) return 0;
+    return tbl_recjournal_active_ok(repo_root);
+}
+
+static int tbl_record_view_ok(const char *repo_root)
+{
+    if (tbl_record_store == TBL_RECORD_STORE_JOURNAL) return tbl_record_store_view;
+    return tbl_recjournal_view_ok(repo_root);
+}
+
+/* before a write: a configured journal is created on first use */
+static int tbl_record_journal_prepare(const char *repo_root, char *err, size_t errsz)
+{
+    if (tbl_record_store != TBL_RECORD_STORE_JOURNAL || tbl_recjournal_active_ok(repo_root)) return 0;
+    return tbl_recjournal_create(repo_root, tbl_record_store_view, err, errsz);
+}
+
 int tbl_record_is_safe_id(const char *jobid)
 {
     size_t i;
@@ -73,7 +191,181 @@ int tbl_record_is_safe_id(const char *jobid)
     return 1;
 }
 
+int tbl_record_tag_key_ok(const char *key)
+{
+    size_t i;
+
+    if (!key || !key[0]) return 0;
+    for (i = 0; key[i]; ++i) {
+        char c = key[i];
+
+        if (i >= (size_t)TBL_RECORD_TAG_KEY_MAX) return 0;
+        if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '.' || c == '-')) return 0;
+    }
+    return 1;
+}
+
+int tbl_record_tag_value_ok(const char *value)
+{
+    size_t n;
+    size_t i;
+
+    if (!value || !value[0]) return 0;
+    n = strlen(value);
+    if (n > (size_t)TBL_RECORD_TAG_VALUE_MAX) return 0;
+    if (value[0] == ' ' || value[n - 1] == ' ') return 0;
+    for (i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)value[i];
+        if (c < 0x20 || c == 0x7f) return 0;
+    }
+    return 1;
+}
+
+/* next "key=value\n" line of tags at *pos: key and value NUL-terminated in kv */
+static int tbl_record_tag_next(const char *tags, size_t *pos, char *kv, size_t kvsz, const char **val)
+{
+    size_t n = 0;
+    char *eq;
+
+    if (!tags[*pos]) return 0;
+    while (tags[*pos] && tags[*pos] != '\n') {
+        if (n + 1U < kvsz) kv[n++] = tags[*pos];
+        (*pos)++;
+    }
+    if (tags[*pos] == '\n') (*pos)++;
+    kv[n] = '\0';
+    eq = strchr(kv, '=');
+    if (!eq) {
+        *val = kv + n;
+        return 1;
+    }
+    *eq = '\0';
+    *val = eq + 1;
+    return 1;
+}
+
+static int tbl_record_tag_line_ok(char *out, size_t outsz, const char *key, const char *value)
+{
+    return tbl_strlcat(out, key, outsz) < outsz && tbl_strlcat(out, "=", outsz) < outsz &&
+           tbl_strlcat(out, value, outsz) < outsz && tbl_strlcat(out, "\n", outsz) < outsz;
+}
+
+int tbl_record_tag_set(tbl_record_t *rec, const char *key, const char *value)
+{
+    char lkey[TBL_RECORD_TAG_KEY_MAX + 1];
+    char out[TBL_RECORD_TAGS_MAX];
+    char kv[TBL_RECORD_TAG_KEY_MAX + TBL_RECORD_TAG_VALUE_MAX + 2];
+    const char *v;
+    size_t pos = 0;
+    size_t i;
+    int placed = 0;
+
+    if (!rec || !key || !value) return 2;
+    for (i = 0; key[i] && i < sizeof(lkey) - 1U; ++i) {
+        lkey[i] = (char)((key[i] >= 'A' && key[i] <= 'Z') ? key[i] - 'A' + 'a' : key[i]);
+    }
+    lkey[i] = '\0';
+    if (key[i] || !tbl_record_tag_key_ok(lkey) || !tbl_record_tag_value_ok(value)) return 2;
+
+    /* rebuild in key order: the new line goes before the first larger key */
+    out[0] = '\0';
+    while (tbl_record_tag_next(rec->tags, &pos, kv, sizeof(kv), &v)) {
+        int c = strcmp(kv, lkey);
+
+        if (c == 0) continue;
+        if (c > 0 && !placed) {
+            if (!tbl_record_tag_line_ok(out, sizeof(out), lkey, value)) return 2;
+            placed = 1;
+        }
+        if (!tbl_record_tag_line_ok(out, sizeof(out), kv, v)) return 2;
+    }
+    if (!placed && !tbl_record_tag_line_ok(out, sizeof(out), lkey, value)) return 2;
+    (void)memcpy(rec->tags, out, sizeof(out));
+    return 0;
+}
+
+int tbl_record_tag_get_ok(const tbl_record_t *rec, const char *key, char *out, size_t outsz)
+{
+    char kv[TBL_RECORD_TAG_KEY_MAX + TBL_RECORD_TAG_VALUE_MAX + 2];
+    const char *v;
+    size_t pos = 0;
+
+    if (!rec || !key) return 0;
+    while (tbl_record_tag_next(rec->tags, &pos, kv, sizeof(kv), &v)) {
+        if (!tbl_streq(kv, key)) continue;
+        if (out && outsz) (void)tbl_strlcpy(out, v, outsz);
+        return 1;
+    }
+    return 0;
+}
+
+int tbl_record_tag_each(const tbl_record_t *rec, tbl_record_tag_fn fn, void *ud)
+{
+    char kv[TBL_RECORD_TAG_KEY_MAX + TBL_RECORD_TAG_VALUE_MAX + 2];
+    const char *v;
+    size_t pos = 0;
+
+    if (!rec || !fn) return 0;
+    while (tbl_record_tag_next(rec->tags, &pos, kv, sizeof(kv), &v)) {
+        int rc = fn(ud, kv, v);
+        if (rc != 0) return rc;
+    }
+    return 0;
+}
+
+unsigned long tbl_record_shard(const char *jobid)
+{
+    unsigned long h;
+    const unsigned char *p;
+
+    /* FNV-1a, 32 bit */
+    h = 2166136261UL;
+    for (p = (const unsigned char *)(jobid ? jobid : ""); *p; ++p) {
+        h ^= (unsigned long)*p;
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+    return h % TBL_RECORD_SHARDS;
+}
+
+static int tbl_record_shard_dir(const char *repo_root, const char *jobid, char *out, size_t outsz)
+{
+    static const char hex[] = "0123456789abcdef";
+    char records_dir[1024];
+    char name[3];
+    unsigned long b;
+
+    if (!tbl_path_join2(records_dir, sizeof(records_dir), repo_root, "records")) return 0;
+    b = tbl_record_shard(jobid);
+    name[0] = hex[(b >> 4) & 0xfUL];
+    name[1] = hex[b & 0xfUL];
+    name[2] = '\0';
+    return tbl_path_join2(out, outsz, records_dir, name);
+}
+
+static int tbl_record_fname(const char *jobid, char *fname, size_t fnamesz)
+{
+    fname[0] = '\0';
+    if (tbl_strlcpy(fname, jobid, fnamesz) >= fnamesz) return 0;
+    if (tbl_strlcat(fname, ".ini", fnamesz) >= fnamesz) return 0;
+    return 1;
+}
+
 int tbl_record_path(const char *repo_root, const char *jobid, char *out_path, size_t out_path_sz)
+{
+    char shard_dir[1024];
+    char fname[300];
+
+    if (!repo_root || !repo_root[0] || !out_path || out_path_sz == 0) return 0;
+    if (!tbl_record_is_safe_id(jobid)) return 0;
+
+    if (!tbl_record_shard_dir(repo_root, jobid, shard_dir, sizeof(shard_dir))) return 0;
+    if (!tbl_record_fname(jobid, fname, sizeof(fname))) return 0;
+
+    if (!tbl_path_join2(out_path, out_path_sz, shard_dir, fname)) return 0;
+    return 1;
+}
+
+int tbl_record_flat_path(const char *repo_root, const char *jobid, char *out_path, size_t out_path_sz)
 {
     char records_dir[1024];
     char fname[300];
@@ -82,56 +374,65 @@ int tbl_record_path(const char *repo_root, const char *jobid, char *out_path, si
     if (!tbl_record_is_safe_id(jobid)) return 0;
 
     if (!tbl_path_join2(records_dir, sizeof(records_dir), repo_root, "records")) return 0;
-
-    fname[0] = '\0';
-    if (tbl_strlcpy(fname, jobid, sizeof(fname)) >= sizeof(fname)) return 0;
-    if (tbl_strlcat(fname, ".ini", sizeof(fname)) >= sizeof(fname)) return 0;
+    if (!tbl_record_fname(jobid, fname, sizeof(fname))) return 0;
 
     if (!tbl_path_join2(out_path, out_path_sz, records_dir, fname)) return 0;
     return 1;
 }
 
-static int tbl_record_write_path(const char *path, const tbl_record_t *rec, char *err, size_t errsz)
+int tbl_record_find_path(const char *repo_root, const char *jobid, char *out_path, size_t out_path_sz)
 {
-    char buf[2048];
-    char num[32];
+    char flat[1024];
+    int ex;
+
+    if (!tbl_record_path(repo_root, jobid, out_path, out_path_sz)) return 0;
+    ex = 0;
+    (void)tbl_fs_exists(out_path, &ex);
+    if (ex) return 1;
+
+    if (!tbl_record_flat_path(repo_root, jobid, flat, sizeof(flat))) return 1;
+    ex = 0;
+    (void)tbl_fs_exists(flat, &ex);
+    if (ex && tbl_strlcpy(out_path, flat, out_path_sz) >= out_path_sz) return 0;
+    return 1;
+}
 
-    if (!path || !path[0] || !rec) {
-        tbl_record_seterr(err, errsz, "invalid args");
-        return 2;
-    }
+/* record -> .ini text (LF-only, what records/<ab>/<jobid>.ini holds) */
+static int tbl_record_format(const tbl_record_t *rec, char *buf, size_t bufsz, char *err, size_t errsz)
+{
+    char num[32];
 
     buf[0] = '\0';
 
-    if (tbl_strlcat(buf, "status=", sizeof(buf)) >= sizeof(buf) ||
-        tbl_strlcat(buf, rec->status[0] ? rec->status : "unknown", sizeof(buf)) >= sizeof(buf) ||
-        tbl_strlcat(buf, "\n", sizeof(buf)) >= sizeof(buf)) {
+    if (tbl_strlcat(buf, "status=", bufsz) >= bufsz ||
+        tbl_strlcat(buf, rec->status[0] ? rec->status : "unknown", bufsz) >= bufsz ||
+        tbl_strlcat(buf, "\n", bufsz) >= bufsz) {
         tbl_record_seterr(err, errsz, "record buffer too small");
         return 2;
     }
 
     if (rec->job[0]) {
-        if (tbl_strlcat(buf, "job=", sizeof(buf)) >= sizeof(buf) ||
-            tbl_strlcat(buf, rec->job, sizeof(buf)) >= sizeof(buf) ||
-            tbl_strlcat(buf, "\n", sizeof(buf)) >= sizeof(buf)) {
+        if (tbl_strlcat(buf, "job=", bufsz) >= bufsz ||
+            tbl_strlcat(buf, rec->job, bufsz) >= bufsz ||
+            tbl_strlcat(buf, "\n", bufsz) >= bufsz) {
             tbl_record_seterr(err, errsz, "record buffer too small");
             return 2;
         }
     }
 
     if (rec->payload[0]) {
-        if (tbl_strlcat(buf, "payload=", sizeof(buf)) >= sizeof(buf) ||
-            tbl_strlcat(buf, rec->payload, sizeof(buf)) >= sizeof(buf) ||
-            tbl_strlcat(buf, "\n", sizeof(buf)) >= sizeof(buf)) {
+        if (tbl_strlcat(buf, "payload=", bufsz) >= bufsz ||
+            tbl_strlcat(buf, rec->payload, bufsz) >= bufsz ||
+            tbl_strlcat(buf, "\n", bufsz) >= bufsz) {
             tbl_record_seterr(err, errsz, "record buffer too small");
             return 2;
         }
     }
 
     if (rec->sha256[0]) {
-        if (tbl_strlcat(buf, "sha256=", sizeof(buf)) >= sizeof(buf) ||
-            tbl_strlcat(buf, rec->sha256, sizeof(buf)) >= sizeof(buf) ||
-            tbl_strlcat(buf, "\n", sizeof(buf)) >= sizeof(buf)) {
+        if (tbl_strlcat(buf, "sha256=", bufsz) >= bufsz ||
+            tbl_strlcat(buf, rec->sha256, bufsz) >= bufsz ||
+            tbl_strlcat(buf, "\n", bufsz) >= bufsz) {
             tbl_record_seterr(err, errsz, "record buffer too small");
             return 2;
         }
@@ -141,9 +442,9 @@ static int tbl_record_write_path(const char *path, const tbl_record_t *rec, char
         tbl_record_seterr(err, errsz, "bytes conv failed");
         return 2;
     }
-    if (tbl_strlcat(buf, "bytes=", sizeof(buf)) >= sizeof(buf) ||
-        tbl_strlcat(buf, num, sizeof(buf)) >= sizeof(buf) ||
-        tbl_strlcat(buf, "\n", sizeof(buf)) >= sizeof(buf)) {
+    if (tbl_strlcat(buf, "bytes=", bufsz) >= bufsz ||
+        tbl_strlcat(buf, num, bufsz) >= bufsz ||
+        tbl_strlcat(buf, "\n", bufsz) >= bufsz) {
         tbl_record_seterr(err, errsz, "record buffer too small");
         return 2;
     }
@@ -152,22 +453,56 @@ static int tbl_record_write_path(const char *path, const tbl_record_t *rec, char
         tbl_record_seterr(err, errsz, "stored_at conv failed");
         return 2;
     }
-    if (tbl_strlcat(buf, "stored_at=", sizeof(buf)) >= sizeof(buf) ||
-        tbl_strlcat(buf, num, sizeof(buf)) >= sizeof(buf) ||
-        tbl_strlcat(buf, "\n", sizeof(buf)) >= sizeof(buf)) {
+    if (tbl_strlcat(buf, "stored_at=", bufsz) >= bufsz ||
+        tbl_strlcat(buf, num, bufsz) >= bufsz ||
+        tbl_strlcat(buf, "\n", bufsz) >= bufsz) {
         tbl_record_seterr(err, errsz, "record buffer too small");
         return 2;
     }
 
     if (rec->reason[0]) {
-        if (tbl_strlcat(buf, "reason=", sizeof(buf)) >= sizeof(buf) ||
-            tbl_strlcat(buf, rec->reason, sizeof(buf)) >= sizeof(buf) ||
-            tbl_strlcat(buf, "\n", sizeof(buf)) >= sizeof(buf)) {
+        if (tbl_strlcat(buf, "reason=", bufsz) >= bufsz ||
+            tbl_strlcat(buf, rec->reason, bufsz) >= bufsz ||
+            tbl_strlcat(buf, "\n", bufsz) >= bufsz) {
             tbl_record_seterr(err, errsz, "record buffer too small");
             return 2;
         }
     }
 
+    /* tags: one "tag.<key>=<value>" line each, in key order */
+    {
+        size_t i = 0;
+
+        while (rec->tags[i]) {
+            size_t e = i;
+            size_t bl;
+
+            while (rec->tags[e] && rec->tags[e] != '\n') e++;
+            if (tbl_strlcat(buf, "tag.", bufsz) >= bufsz || (bl = strlen(buf)) + (e - i) + 2U > bufsz) {
+                tbl_record_seterr(err, errsz, "record buffer too small");
+                return 2;
+            }
+            (void)memcpy(buf + bl, rec->tags + i, e - i);
+            buf[bl + (e - i)] = '\n';
+            buf[bl + (e - i) + 1U] = '\0';
+            i = rec->tags[e] ? e + 1U : e;
+        }
+    }
+
+    return 0;
+}
+
+static int tbl_record_write_path(const char *path, const tbl_record_t *rec, char *err, size_t errsz)
+{
+    char buf[2048];
+
+    if (!path || !path[0] || !rec) {
+        tbl_record_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+
+    if (tbl_record_format(rec, buf, sizeof(buf), err, errsz) != 0) return 2;
+
     if (tbl_fs_write_file(path, buf, (size_t)tbl_strlen(buf)) != 0) {
         tbl_record_seterr(err, errsz, "cannot write record file");
         return 2;
@@ -178,8 +513,11 @@ static int tbl_record_write_path(const char *path, const tbl_record_t *rec, char
 
 int tbl_record_write_repo(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz)
 {
-    char records_dir[1024];
+    char shard_dir[1024];
     char path[1024];
+    char flat[1024];
+    int ex;
+    int rc;
 
     if (err && errsz) err[0] = '\0';
     if (!repo_root || !repo_root[0] || !rec) {
@@ -191,21 +529,42 @@ int tbl_record_write_repo(const char *repo_root, const tbl_record_t *rec, char *
         return 2;
     }
 
-    if (!tbl_path_join2(records_dir, sizeof(records_dir), repo_root, "records")) {
+    /* journal engine: one sequential append; the .ini only as a view */
+    if (tbl_record_journal_prepare(repo_root, err, errsz) != 0) return 2;
+    if (tbl_record_journal_ok(repo_root)) {
+        char buf[2048];
+
+        if (tbl_record_format(rec, buf, sizeof(buf), err, errsz) != 0) return 2;
+        if (tbl_recjournal_put(repo_root, rec->job, buf, strlen(buf), err, errsz) != 0) return 2;
+        if (!tbl_record_view_ok(repo_root)) return 0;
+    }
+
+    if (!tbl_record_shard_dir(repo_root, rec->job, shard_dir, sizeof(shard_dir))) {
         tbl_record_seterr(err, errsz, "records dir path too long");
         return 2;
     }
-    if (tbl_fs_mkdir_p(records_dir) != 0) {
+    if (tbl_fs_mkdir_p(shard_dir) != 0) {
         tbl_record_seterr(err, errsz, "cannot create records dir");
         return 2;
     }
 
-    if (!tbl_record_path(repo_root, rec->job, path, sizeof(path))) {
+    if (!tbl_record_path(repo_root, rec->job, path, sizeof(path)) ||
+        !tbl_record_flat_path(repo_root, rec->job, flat, sizeof(flat))) {
         tbl_record_seterr(err, errsz, "record path too long");
         return 2;
     }
 
-    return tbl_record_write_path(path, rec, err, errsz);
+    rc = tbl_record_write_path(path, rec, err, errsz);
+    if (rc != 0) return rc;
+
+    /* the shard copy is the truth now; a flat one would only be stale */
+    ex = 0;
+    (void)tbl_fs_exists(flat, &ex);
+    if (ex && tbl_fs_remove_file(flat) != 0) {
+        tbl_record_seterr(err, errsz, "cannot remove flat record");
+        return 2;
+    }
+    return 0;
 }
 
 static void tbl_record_init(tbl_record_t *r)
@@ -241,6 +600,63 @@ static int tbl_record_parse_ul(const char *s, unsigned long *out)
     return 1;
 }
 
+/* one "key=value" line into out_rec (unknown keys and comments ignored) */
+static void tbl_record_parse_line(char *line, tbl_record_t *out_rec)
+{
+    char *eq;
+    char *key;
+    char *val;
+
+    tbl_record_trim(line);
+    if (line[0] == '\0') return;
+    if (line[0] == '#') return;
+
+    eq = strchr(line, '=');
+    if (!eq) return;
+
+    *eq = '\0';
+    key = line;
+    val = eq + 1;
+
+    if (strcmp(key, "status") == 0) {
+        (void)tbl_strlcpy(out_rec->status, val, sizeof(out_rec->status));
+    } else if (strcmp(key, "job") == 0) {
+        (void)tbl_strlcpy(out_rec->job, val, sizeof(out_rec->job));
+    } else if (strcmp(key, "payload") == 0) {
+        (void)tbl_strlcpy(out_rec->payload, val, sizeof(out_rec->payload));
+    } else if (strcmp(key, "sha256") == 0) {
+        (void)tbl_strlcpy(out_rec->sha256, val, sizeof(out_rec->sha256));
+    } else if (strcmp(key, "bytes") == 0) {
+        (void)tbl_record_parse_ul(val, &out_rec->bytes);
+    } else if (strcmp(key, "stored_at") == 0) {
+        (void)tbl_record_parse_ul(val, &out_rec->stored_at);
+    } else if (strcmp(key, "reason") == 0) {
+        (void)tbl_strlcpy(out_rec->reason, val, sizeof(out_rec->reason));
+    } else if (strncmp(key, "tag.", 4) == 0) {
+        (void)tbl_record_tag_set(out_rec, key + 4, val);
+    }
+}
+
+/* record text (as stored in the journal) -> out_rec, line by line like a file */
+static void tbl_record_parse_text(const char *text, size_t len, tbl_record_t *out_rec)
+{
+    char line[512];
+    size_t i = 0;
+
+    while (i < len) {
+        size_t n = 0;
+
+        while (i < len && n + 1U < sizeof(line)) {
+            char c = text[i++];
+            line[n++] = c;
+            if (c == '\n') break;
+        }
+        line[n] = '\0';
+        tbl_record_parse_line(line, out_rec);
+    }
+    if (out_rec->status[0] == '\0') (void)tbl_strlcpy(out_rec->status, "unknown", sizeof(out_rec->status));
+}
+
 int tbl_record_read_repo(const char *repo_root, const char *jobid, tbl_record_t *out_rec, char *err, size_t errsz)
 {
     char path[1024];
@@ -256,7 +672,24 @@ int tbl_record_read_repo(const char *repo_root, const char *jobid, tbl_record_t
         tbl_record_seterr(err, errsz, "unsafe job id");
         return 2;
     }
-    if (!tbl_record_path(repo_root, jobid, path, sizeof(path))) {
+
+    /* journal engine; a job not in it yet still has its .ini */
+    if (tbl_record_journal_ok(repo_root)) {
+        char body[TBL_RECJOURNAL_BODY_MAX + 1];
+        size_t len;
+        int rc;
+
+        rc = tbl_recjournal_get(repo_root, jobid, body, sizeof(body), &len, err, errsz);
+        if (rc == 2) return 2;
+        if (rc == 0) {
+            tbl_record_init(out_rec);
+            (void)tbl_strlcpy(out_rec->job, jobid, sizeof(out_rec->job));
+            tbl_record_parse_text(body, len, out_rec);
+            return 0;
+        }
+    }
+
+    if (!tbl_record_find_path(repo_root, jobid, path, sizeof(path))) {
         tbl_record_seterr(err, errsz, "record path too long");
         return 2;
     }
@@ -270,38 +703,7 @@ int tbl_record_read_repo(const char *repo_root, const char *jobid, tbl_record_t
     tbl_record_init(out_rec);
     (void)tbl_strlcpy(out_rec->job, jobid, sizeof(out_rec->job));
 
-    while (fgets(line, (int)sizeof(line), fp)) {
-        char *eq;
-        char *key;
-        char *val;
-
-        tbl_record_trim(line);
-        if (line[0] == '\0') continue;
-        if (line[0] == '#') continue;
-
-        eq = strchr(line, '=');
-        if (!eq) continue;
-
-        *eq = '\0';
-        key = line;
-        val = eq + 1;
-
-        if (strcmp(key, "status") == 0) {
-            (void)tbl_strlcpy(out_rec->status, val, sizeof(out_rec->status));
-        } else if (strcmp(key, "job") == 0) {
-            (void)tbl_strlcpy(out_rec->job, val, sizeof(out_rec->job));
-        } else if (strcmp(key, "payload") == 0) {
-            (void)tbl_strlcpy(out_rec->payload, val, sizeof(out_rec->payload));
-        } else if (strcmp(key, "sha256") == 0) {
-            (void)tbl_strlcpy(out_rec->sha256, val, sizeof(out_rec->sha256));
-        } else if (strcmp(key, "bytes") == 0) {
-            (void)tbl_record_parse_ul(val, &out_rec->bytes);
-        } else if (strcmp(key, "stored_at") == 0) {
-            (void)tbl_record_parse_ul(val, &out_rec->stored_at);
-        } else if (strcmp(key, "reason") == 0) {
-            (void)tbl_strlcpy(out_rec->reason, val, sizeof(out_rec->reason));
-        }
-    }
+    while (fgets(line, (int)sizeof(line), fp)) tbl_record_parse_line(line, out_rec);
 
     fclose(fp);
 
@@ -329,38 +731,7 @@ int tbl_record_read_file(const char *path, tbl_record_t *out_rec, char *err, siz
 
     tbl_record_init(out_rec);
 
-    while (fgets(line, (int)sizeof(line), fp)) {
-        char *eq;
-        char *key;
-        char *val;
-
-        tbl_record_trim(line);
-        if (line[0] == '\0') continue;
-        if (line[0] == '#') continue;
-
-        eq = strchr(line, '=');
-        if (!eq) continue;
-
-        *eq = '\0';
-        key = line;
-        val = eq + 1;
-
-        if (strcmp(key, "status") == 0) {
-            (void)tbl_strlcpy(out_rec->status, val, sizeof(out_rec->status));
-        } else if (strcmp(key, "job") == 0) {
-            (void)tbl_strlcpy(out_rec->job, val, sizeof(out_rec->job));
-        } else if (strcmp(key, "payload") == 0) {
-            (void)tbl_strlcpy(out_rec->payload, val, sizeof(out_rec->payload));
-        } else if (strcmp(key, "sha256") == 0) {
-            (void)tbl_strlcpy(out_rec->sha256, val, sizeof(out_rec->sha256));
-        } else if (strcmp(key, "bytes") == 0) {
-            (void)tbl_record_parse_ul(val, &out_rec->bytes);
-        } else if (strcmp(key, "stored_at") == 0) {
-            (void)tbl_record_parse_ul(val, &out_rec->stored_at);
-        } else if (strcmp(key, "reason") == 0) {
-            (void)tbl_strlcpy(out_rec->reason, val, sizeof(out_rec->reason));
-        }
-    }
+    while (fgets(line, (int)sizeof(line), fp)) tbl_record_parse_line(line, out_rec);
 
     fclose(fp);
 
@@ -368,6 +739,330 @@ int tbl_record_read_file(const char *path, tbl_record_t *out_rec, char *err, siz
     return 0;
 }
 
+int tbl_record_exists_ok(const char *repo_root, const char *jobid)
+{
+    char path[1024];
+    int ex;
+
+    if (!repo_root || !repo_root[0] || !tbl_record_is_safe_id(jobid)) return 0;
+    if (tbl_record_journal_ok(repo_root)) {
+        char body[TBL_RECJOURNAL_BODY_MAX + 1];
+        if (tbl_recjournal_get(repo_root, jobid, body, sizeof(body), 0, 0, 0) == 0) return 1;
+    }
+    if (!tbl_record_find_path(repo_root, jobid, path, sizeof(path))) return 0;
+    ex = 0;
+    (void)tbl_fs_exists(path, &ex);
+    return ex ? 1 : 0;
+}
+
+int tbl_record_copy_to(const char *repo_root, const char *jobid, const char *dst, char *err, size_t errsz)
+{
+    char path[1024];
+    unsigned char buf[4096];
+    FILE *in;
+    FILE *out;
+    size_t rd;
+    int rc = 0;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !dst || !dst[0] || !tbl_record_is_safe_id(jobid)) {
+        tbl_record_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (tbl_record_journal_ok(repo_root)) {
+        char body[TBL_RECJOURNAL_BODY_MAX + 1];
+        size_t len;
+
+        rc = tbl_recjournal_get(repo_root, jobid, body, sizeof(body), &len, err, errsz);
+        if (rc == 2) return 2;
+        if (rc == 0) {
+            if (tbl_fs_write_file(dst, body, len) != 0) {
+                tbl_record_seterr(err, errsz, "cannot create destination");
+                return 2;
+            }
+            return 0;
+        }
+    }
+    if (!tbl_record_find_path(repo_root, jobid, path, sizeof(path))) {
+        tbl_record_seterr(err, errsz, "record path too long");
+        return 2;
+    }
+
+    in = fopen(path, "rb");
+    if (!in) {
+        tbl_record_seterr(err, errsz, "cannot open record");
+        return 2;
+    }
+    out = fopen(dst, "wb");
+    if (!out) {
+        fclose(in);
+        tbl_record_seterr(err, errsz, "cannot create destination");
+        return 2;
+    }
+    rc = 0;
+    while ((rd = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, rd, out) != rd) {
+            tbl_record_seterr(err, errsz, "write error");
+            rc = 2;
+            break;
+        }
+    }
+    if (rc == 0 && ferror(in)) {
+        tbl_record_seterr(err, errsz, "read error");
+        rc = 2;
+    }
+    fclose(in);
+    if (fclose(out) != 0 && rc == 0) {
+        tbl_record_seterr(err, errsz, "flush error");
+        rc = 2;
+    }
+    return rc;
+}
+
+typedef struct tbl_record_walk_s {
+    const char *repo_root;
+    tbl_record_fn fn;
+    void *ud;
+    int flat;      /* listing records/ itself, not a shard */
+    int journal;   /* journal engine: import files it does not hold yet */
+    int view;
+    int stopped;
+    int failed;
+    unsigned long moved;
+    char *err;
+    size_t errsz;
+} tbl_record_walk_t;
+
+/* jobid of a record file name, 0 if it is none */
+static int tbl_record_stem_ok(const char *name, char *stem, size_t stemsz)
+{
+    size_t nl;
+
+    if (!tbl_str_ends_with(name, ".ini")) return 0;
+    nl = strlen(name) - 4U;
+    if (nl == 0 || nl >= stemsz) return 0;
+    (void)memcpy(stem, name, nl);
+    stem[nl] = '\0';
+    return tbl_record_is_safe_id(stem);
+}
+
+static int tbl_record_is_shard_name(const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < 2U; ++i) {
+        char c = name[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return 0;
+    }
+    return name[2] == '\0';
+}
+
+static int tbl_record_walk_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_record_walk_t *w = (tbl_record_walk_t *)ud;
+    tbl_record_t rec;
+    char stem[256];
+
+    if (is_dir) {
+        if (!w->flat || !tbl_record_is_shard_name(name)) return 0;
+        w->flat = 0;
+        if (tbl_fs_list_dir(full, tbl_record_walk_cb, w) != 0 && !w->stopped && !w->failed) {
+            tbl_record_seterr(w->err, w->errsz, "cannot list records shard");
+            w->failed = 1;
+        }
+        w->flat = 1;
+        return (w->stopped || w->failed) ? 1 : 0;
+    }
+    if (!tbl_record_stem_ok(name, stem, sizeof(stem))) return 0;
+    if (w->flat) {
+        char shard[1024];
+        int ex = 0;
+
+        if (tbl_record_path(w->repo_root, stem, shard, sizeof(shard))) (void)tbl_fs_exists(shard, &ex);
+        if (ex) return 0; /* shadowed by the shard copy */
+    }
+    /* only what tbl_record_read_repo() would give for this jobid */
+    if (tbl_record_read_file(full, &rec, 0, 0) != 0) return 0;
+    if (!rec.job[0]) (void)tbl_strlcpy(rec.job, stem, sizeof(rec.job));
+    if (!tbl_streq(rec.job, stem)) return 0;
+    if (w->fn(w->ud, &rec) != 0) {
+        w->stopped = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int tbl_record_journal_cb(void *ud, const char *jobid, const char *body, size_t len)
+{
+    tbl_record_walk_t *w = (tbl_record_walk_t *)ud;
+    tbl_record_t rec;
+
+    tbl_record_init(&rec);
+    (void)tbl_strlcpy(rec.job, jobid, sizeof(rec.job));
+    tbl_record_parse_text(body, len, &rec);
+    if (!tbl_streq(rec.job, jobid)) return 0;
+    return w->fn(w->ud, &rec);
+}
+
+int tbl_record_each(const char *repo_root, tbl_record_fn fn, void *ud, char *err, size_t errsz)
+{
+    tbl_record_walk_t w;
+    char records_dir[1024];
+    int is_dir;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !fn) {
+        tbl_record_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    (void)memset(&w, 0, sizeof(w));
+    w.repo_root = repo_root;
+    w.fn = fn;
+    w.ud = ud;
+    w.flat = 1;
+    w.err = err;
+    w.errsz = errsz;
+    if (tbl_record_journal_ok(repo_root)) {
+        return tbl_recjournal_each(repo_root, tbl_record_journal_cb, &w, 0, err, errsz) == 0 ? 0 : 2;
+    }
+
+    if (!tbl_path_join2(records_dir, sizeof(records_dir), repo_root, "records")) {
+        tbl_record_seterr(err, errsz, "records dir path too long");
+        return 2;
+    }
+    is_dir = 0;
+    (void)tbl_fs_is_dir(records_dir, &is_dir);
+    if (!is_dir) return 0;
+
+    if (tbl_fs_list_dir(records_dir, tbl_record_walk_cb, &w) != 0 && !w.stopped && !w.failed) {
+        tbl_record_seterr(err, errsz, "cannot list records directory");
+        return 2;
+    }
+    return w.failed ? 2 : 0;
+}
+
+/* journal engine: append a stored .ini the journal does not hold yet;
+   without the .ini view the file goes once it is in the journal */
+static int tbl_record_import(tbl_record_walk_t *w, const char *stem, const char *full)
+{
+    char body[TBL_RECJOURNAL_BODY_MAX + 1];
+    tbl_record_t rec;
+    int rc;
+
+    rc = tbl_recjournal_get(w->repo_root, stem, body, sizeof(body), 0, w->err, w->errsz);
+    if (rc == 1) {
+        if (tbl_record_read_file(full, &rec, w->err, w->errsz) != 0) return 0;
+        if (!rec.job[0]) (void)tbl_strlcpy(rec.job, stem, sizeof(rec.job));
+        if (!tbl_streq(rec.job, stem)) return 1; /* not this job's record */
+        if (tbl_record_format(&rec, body, sizeof(body), w->err, w->errsz) != 0 ||
+            tbl_recjournal_put(w->repo_root, stem, body, strlen(body), w->err, w->errsz) != 0) {
+            return 0;
+        }
+        w->moved++;
+    } else if (rc != 0) {
+        return 0;
+    }
+    if (!w->view && tbl_fs_remove_file(full) != 0) {
+        tbl_record_seterr(w->err, w->errsz, "cannot remove imported record");
+        return 0;
+    }
+    return 1;
+}
+
+static int tbl_record_mig_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_record_walk_t *w = (tbl_record_walk_t *)ud;
+    char stem[256];
+    char shard_dir[1024];
+    char dst[1024];
+    int ex;
+
+    if (is_dir) {
+        if (!w->journal || !w->flat || !tbl_record_is_shard_name(name)) return 0;
+        w->flat = 0;
+        if (tbl_fs_list_dir(full, tbl_record_mig_cb, w) != 0 && !w->failed) {
+            tbl_record_seterr(w->err, w->errsz, "cannot list records shard");
+            w->failed = 1;
+        }
+        w->flat = 1;
+        if (!w->failed && !w->view) (void)tbl_fs_remove_dir(full); /* only if empty */
+        return w->failed ? 1 : 0;
+    }
+    if (!tbl_record_stem_ok(name, stem, sizeof(stem))) return 0;
+    if (w->journal) {
+        if (!tbl_record_import(w, stem, full)) {
+            w->failed = 1;
+            return 1;
+        }
+        return 0;
+    }
+    if (!tbl_record_shard_dir(w->repo_root, stem, shard_dir, sizeof(shard_dir)) ||
+        !tbl_record_path(w->repo_root, stem, dst, sizeof(dst))) {
+        tbl_record_seterr(w->err, w->errsz, "record path too long");
+        w->failed = 1;
+        return 1;
+    }
+    ex = 0;
+    (void)tbl_fs_exists(dst, &ex);
+    if (ex) {
+        /* written again after the layout switch: the flat file is older */
+        if (tbl_fs_remove_file(full) != 0) {
+            tbl_record_seterr(w->err, w->errsz, "cannot remove flat record");
+            w->failed = 1;
+            return 1;
+        }
+        return 0;
+    }
+    if (tbl_fs_mkdir_p(shard_dir) != 0) {
+        tbl_record_seterr(w->err, w->errsz, "cannot create records dir");
+        w->failed = 1;
+        return 1;
+    }
+    if (tbl_fs_rename_atomic(full, dst, 0) != 0) {
+        tbl_record_seterr(w->err, w->errsz, "cannot move record into shard");
+        w->failed = 1;
+        return 1;
+    }
+    w->moved++;
+    return 0;
+}
+
+int tbl_record_migrate(const char *repo_root, unsigned long *out_moved, char *err, size_t errsz)
+{
+    tbl_record_walk_t w;
+    char records_dir[1024];
+    int is_dir;
+
+    if (out_moved) *out_moved = 0UL;
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0]) {
+        tbl_record_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_path_join2(records_dir, sizeof(records_dir), repo_root, "records")) {
+        tbl_record_seterr(err, errsz, "records dir path too long");
+        return 2;
+    }
+    is_dir = 0;
+    (void)tbl_fs_is_dir(records_dir, &is_dir);
+    if (!is_dir) return 0;
+
+    (void)memset(&w, 0, sizeof(w));
+    w.repo_root = repo_root;
+    w.flat = 1;
+    if (tbl_record_journal_prepare(repo_root, err, errsz) != 0) return 2;
+    w.journal = tbl_record_journal_ok(repo_root);
+    w.view = w.journal && tbl_record_view_ok(repo_root);
+    w.err = err;
+    w.errsz = errsz;
+    if (tbl_fs_list_dir(records_dir, tbl_record_mig_cb, &w) != 0 && !w.failed) {
+        tbl_record_seterr(err, errsz, "cannot list records directory");
+        return 2;
+    }
+    if (out_moved) *out_moved = w.moved;
+    return w.failed ? 2 : 0;
+}
+
 #endif /* TBL_RECORD_IMPLEMENTATION */
 
 #endif /* TBL_CORE_RECORD_H */
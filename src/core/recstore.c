@@ -0,0 +1,2 @@
+#define TBL_RECSTORE_IMPLEMENTATION
+#include "core/recstore.h"
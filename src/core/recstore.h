@@ -0,0 +1,90 @@
+#ifndef TBL_CORE_RECSTORE_H
+#define TBL_CORE_RECSTORE_H
+
+#include <stddef.h>
+
+#include "core/record.h"
+
+/* Record write with its index maintenance, shared by every path that
+   stores a record (ingest, ingest-package):
+   1. tbl_recidx_invalidate: the job's records.idx slot is dropped first,
+      so an index update that fails below leaves a miss, not the old record
+   2. tbl_record_write_repo: the record itself (the truth)
+   3. tbl_recidx_put, tbl_refidx_add (stored digest only), tbl_secidx_put,
+      tbl_tgidx_add, tbl_tagidx_add
+   An index that fails in step 3 is left behind as it is: its readers check
+   every candidate against the current record, and `tablinum index
+   --rebuild` writes them all anew. A new derived index belongs here, not
+   in one of the callers. */
+
+/* Returns 0 ok, 1 record written but an index update failed (err names
+   the first), 2 record not written. */
+int tbl_recstore_write(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz);
+
+#ifdef TBL_RECSTORE_IMPLEMENTATION
+
+#include "core/safe.h"
+#include "core/str.h"
+#include "core/recidx.h"
+#include "core/refidx.h"
+#include "core/secidx.h"
+#include "core/tgidx.h"
+#include "core/tagidx.h"
+
+static void tbl_recstore_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg || !msg[0]) msg = "index update failed";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+/* the first index failure is reported */
+static void tbl_recstore_fail(int *rc, const char *msg, char *first, size_t firstsz)
+{
+    if (*rc != 0) return;
+    *rc = 1;
+    tbl_recstore_seterr(first, firstsz, msg);
+}
+
+int tbl_recstore_write(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz)
+{
+    char ierr[256];
+    char first[256];
+    int rc = 0;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !rec) {
+        tbl_recstore_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    first[0] = '\0';
+
+    ierr[0] = '\0';
+    if (tbl_recidx_invalidate(repo_root, rec->job, ierr, sizeof(ierr)) != 0) {
+        tbl_recstore_fail(&rc, ierr, first, sizeof(first));
+    }
+    if (tbl_record_write_repo(repo_root, rec, err, errsz) != 0) return 2;
+
+    ierr[0] = '\0';
+    if (tbl_recidx_put(repo_root, rec, ierr, sizeof(ierr)) != 0) tbl_recstore_fail(&rc, ierr, first, sizeof(first));
+    ierr[0] = '\0';
+    if (rec->sha256[0] && tbl_refidx_add(repo_root, rec->sha256, rec->job, ierr, sizeof(ierr)) != 0) {
+        tbl_recstore_fail(&rc, ierr, first, sizeof(first));
+    }
+    ierr[0] = '\0';
+    if (tbl_secidx_put(repo_root, rec, ierr, sizeof(ierr)) != 0) tbl_recstore_fail(&rc, ierr, first, sizeof(first));
+    ierr[0] = '\0';
+    if (tbl_tgidx_add(repo_root, rec->job, rec->payload, ierr, sizeof(ierr)) != 0) {
+        tbl_recstore_fail(&rc, ierr, first, sizeof(first));
+    }
+    ierr[0] = '\0';
+    if (tbl_tagidx_add(repo_root, rec, ierr, sizeof(ierr)) != 0) tbl_recstore_fail(&rc, ierr, first, sizeof(first));
+
+    if (rc != 0) tbl_recstore_seterr(err, errsz, first);
+    return rc;
+}
+
+#endif /* TBL_RECSTORE_IMPLEMENTATION */
+
+#endif /* TBL_CORE_RECSTORE_H */
@@ -0,0 +1,2 @@
+#define TBL_REFIDX_IMPLEMENTATION
+#include "core/refidx.h"
@@ -0,0 +1,783 @@
+#ifndef TBL_CORE_REFIDX_H
+#define TBL_CORE_REFIDX_H
+
+#include <stddef.h>
+
+/* Reverse index from CAS digest to the jobs whose record names it.
+   - index/refs.idx       built by `tablinum index --rebuild` or by merging the tail:
+       header (32 bytes)  "TBLREF1\n", u32 ndigests, u32 njobs, u32 post_off,
+                          u32 jobtab_off, u32 jobheap_off, u32 file_len
+       digests            ndigests x (sha256[32], u32 post_rel, u32 post_len),
+                          sorted by digest (binary search)
+       postings           per digest the job ordinals, ascending, as LEB128
+                          varint deltas (the first one absolute)
+       jobs               (njobs + 1) x u32 offsets into the job heap, which
+                          holds the jobids sorted: ordinal = rank
+   - index/refs.idx.tail  "<sha256 hex> <jobid>" lines appended by ingest and
+                          ingest-package under index/refs.lock
+   A lookup binary-searches refs.idx, scans the tail and checks every
+   candidate against its current record (index/records.idx, else the .ini),
+   so a job re-ingested with another payload drops out. A tail larger than
+   TBL_REFIDX_TAIL_MAX is merged into refs.idx on the next lookup.
+*/
+
+#ifndef TBL_REFIDX_TAIL_MAX
+#define TBL_REFIDX_TAIL_MAX 4194304UL
+#endif
+
+/* Per-job callback, 0 = continue, else stop. */
+typedef int (*tbl_refidx_job_fn)(void *ud, const char *jobid);
+
+/* Append sha256_hex (64 hex) -> jobid to the tail. Returns 0 ok, 2 error. */
+int tbl_refidx_add(const char *repo_root, const char *sha256_hex, const char *jobid,
+                   char *err, size_t errsz);
+
+/* Call fn for every job whose record names sha256_hex (64 hex, any case),
+   in jobid order. Missing index files are not an error.
+   Returns 0 ok, 2 error. */
+int tbl_refidx_each(const char *repo_root, const char *sha256_hex, tbl_refidx_job_fn fn, void *ud,
+                    unsigned long *out_jobs, char *err, size_t errsz);
+
+/* Write refs.idx anew from every stored record (tbl_record_each) and drop the tail.
+   out_objects: distinct digests, out_refs: (digest, job) pairs.
+   Returns 0 ok, 2 error. */
+int tbl_refidx_build(const char *repo_root, unsigned long *out_objects, unsigned long *out_refs,
+                     char *err, size_t errsz);
+
+#ifdef TBL_REFIDX_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/recidx.h"
+#include "core/record.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_REFIDX_HDR 32UL
+#define TBL_REFIDX_DIG 40UL
+#define TBL_REFIDX_LINE_MAX 512
+
+typedef struct tbl_refidx_paths_s {
+    char dir[1024];
+    char base[1024];
+    char tail[1024];
+    char tmp[1024];
+    char lock[1024];
+} tbl_refidx_paths_t;
+
+typedef struct tbl_refidx_hdr_s {
+    unsigned long ndig;
+    unsigned long njobs;
+    unsigned long post_off;
+    unsigned long jobtab_off;
+    unsigned long jobheap_off;
+    unsigned long file_len;
+} tbl_refidx_hdr_t;
+
+typedef struct tbl_refidx_pair_s {
+    unsigned char sha[32];
+    unsigned long job; /* arena offset, then ordinal */
+} tbl_refidx_pair_t;
+
+/* (digest, jobid) pairs, jobids NUL-terminated in one arena */
+typedef struct tbl_refidx_set_s {
+    tbl_refidx_pair_t *v;
+    unsigned long n;
+    unsigned long cap;
+    char *arena;
+    unsigned long alen;
+    unsigned long acap;
+} tbl_refidx_set_t;
+
+static void tbl_refidx_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "refs index error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_refidx_paths(const char *repo_root, tbl_refidx_paths_t *p)
+{
+    return tbl_path_join2(p->dir, sizeof(p->dir), repo_root, "index") &&
+           tbl_path_join2(p->base, sizeof(p->base), p->dir, "refs.idx") &&
+           tbl_path_join2(p->tail, sizeof(p->tail), p->dir, "refs.idx.tail") &&
+           tbl_path_join2(p->tmp, sizeof(p->tmp), p->dir, "refs.idx.tmp") &&
+           tbl_path_join2(p->lock, sizeof(p->lock), p->dir, "refs.lock");
+}
+
+static void tbl_refidx_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+static unsigned long tbl_refidx_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static int tbl_refidx_hexval(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* exactly 64 hex digits (stops at s[64]) */
+static int tbl_refidx_sha_ok(const char *s, unsigned char out[32])
+{
+    size_t i;
+
+    for (i = 0; i < 32U; ++i) {
+        int hi;
+        int lo;
+
+        if (!s[2U * i] || !s[2U * i + 1U]) return 0;
+        hi = tbl_refidx_hexval((unsigned char)s[2U * i]);
+        lo = tbl_refidx_hexval((unsigned char)s[2U * i + 1U]);
+        if (hi < 0 || lo < 0) return 0;
+        out[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return 1;
+}
+
+static int tbl_refidx_seek(FILE *fp, unsigned long off)
+{
+    if (off > (unsigned long)LONG_MAX) return 0;
+    return (fseek(fp, (long)off, SEEK_SET) == 0) ? 1 : 0;
+}
+
+static int tbl_refidx_pread_ok(FILE *fp, unsigned long off, void *buf, size_t n)
+{
+    if (n == 0) return 1;
+    return (tbl_refidx_seek(fp, off) && fread(buf, 1, n, fp) == n) ? 1 : 0;
+}
+
+static int tbl_refidx_hdr_ok(const unsigned char *b, tbl_refidx_hdr_t *h)
+{
+    if (memcmp(b, "TBLREF1\n", 8) != 0) return 0;
+    h->ndig = tbl_refidx_get32(b + 8);
+    h->njobs = tbl_refidx_get32(b + 12);
+    h->post_off = tbl_refidx_get32(b + 16);
+    h->jobtab_off = tbl_refidx_get32(b + 20);
+    h->jobheap_off = tbl_refidx_get32(b + 24);
+    h->file_len = tbl_refidx_get32(b + 28);
+    if (h->ndig > (0xffffffffUL - TBL_REFIDX_HDR) / TBL_REFIDX_DIG) return 0;
+    if (h->njobs >= 0xffffffffUL / 4UL - 1UL) return 0;
+    if (h->post_off != TBL_REFIDX_HDR + h->ndig * TBL_REFIDX_DIG || h->jobtab_off < h->post_off) return 0;
+    if (h->jobtab_off > 0xffffffffUL - (h->njobs + 1UL) * 4UL) return 0;
+    if (h->jobheap_off != h->jobtab_off + (h->njobs + 1UL) * 4UL) return 0;
+    return (h->file_len >= h->jobheap_off) ? 1 : 0;
+}
+
+static void tbl_refidx_set_free(tbl_refidx_set_t *s)
+{
+    free(s->v);
+    free(s->arena);
+    (void)memset(s, 0, sizeof(*s));
+}
+
+static int tbl_refidx_set_add(tbl_refidx_set_t *s, const unsigned char *sha, const char *job, size_t jl)
+{
+    if (s->n == s->cap) {
+        unsigned long nc = s->cap ? s->cap * 2UL : 256UL;
+        tbl_refidx_pair_t *nv = (tbl_refidx_pair_t *)realloc(s->v, (size_t)nc * sizeof(*nv));
+        if (!nv) return 0;
+        s->v = nv;
+        s->cap = nc;
+    }
+    if (s->alen + (unsigned long)jl + 1UL > s->acap) {
+        unsigned long nc = s->acap ? s->acap * 2UL : 4096UL;
+        char *na;
+        while (nc < s->alen + (unsigned long)jl + 1UL) nc *= 2UL;
+        na = (char *)realloc(s->arena, (size_t)nc);
+        if (!na) return 0;
+        s->arena = na;
+        s->acap = nc;
+    }
+    if (sha) (void)memcpy(s->v[s->n].sha, sha, 32);
+    else (void)memset(s->v[s->n].sha, 0, 32);
+    s->v[s->n].job = s->alen;
+    s->n++;
+    (void)memcpy(s->arena + s->alen, job, jl);
+    s->arena[s->alen + (unsigned long)jl] = '\0';
+    s->alen += (unsigned long)jl + 1UL;
+    return 1;
+}
+
+/* "<64 hex> <jobid>\n" -> digest, jobid (NUL-terminated in place) */
+static int tbl_refidx_parse_line(char *line, unsigned char sha[32], const char **job)
+{
+    size_t n = strlen(line);
+
+    if (n > 0 && line[n - 1] == '\n') line[--n] = '\0';
+    if (n < 66U || line[64] != ' ' || !tbl_refidx_sha_ok(line, sha)) return 0;
+    if (!tbl_record_is_safe_id(line + 65)) return 0;
+    *job = line + 65;
+    return 1;
+}
+
+/* Every tail line into s; out_bytes: tail size read. A missing tail is empty. */
+static int tbl_refidx_load_tail(tbl_refidx_set_t *s, const char *path, const unsigned char *only,
+                                unsigned long *out_bytes)
+{
+    char line[TBL_REFIDX_LINE_MAX];
+    FILE *fp;
+    int ok = 1;
+
+    if (out_bytes) *out_bytes = 0UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+        unsigned char sha[32];
+        const char *job;
+
+        if (out_bytes) *out_bytes += (unsigned long)strlen(line);
+        if (!tbl_refidx_parse_line(line, sha, &job)) continue;
+        if (only && memcmp(sha, only, 32) != 0) continue;
+        if (!tbl_refidx_set_add(s, sha, job, strlen(job))) ok = 0;
+    }
+    fclose(fp);
+    return ok;
+}
+
+/* Next LEB128 varint of p[*i..len). Returns 1/0. */
+static int tbl_refidx_varint(const unsigned char *p, unsigned long len, unsigned long *i, unsigned long *out)
+{
+    unsigned long v = 0UL;
+    unsigned int shift = 0;
+
+    for (;;) {
+        if (*i >= len || shift > 28U) return 0;
+        v |= ((unsigned long)(p[*i] & 0x7f)) << shift;
+        shift += 7U;
+        if (!(p[(*i)++] & 0x80)) break;
+    }
+    *out = v & 0xffffffffUL;
+    return 1;
+}
+
+/* Decode one posting list; jobs are looked up in jobtab/heap (in memory). */
+static int tbl_refidx_decode_post(tbl_refidx_set_t *s, const unsigned char *sha,
+                                  const unsigned char *post, unsigned long len,
+                                  const unsigned char *jobtab, unsigned long njobs,
+                                  const char *heap, unsigned long heap_len)
+{
+    unsigned long i = 0UL;
+    unsigned long ord = 0UL;
+
+    while (i < len) {
+        unsigned long d;
+        unsigned long a;
+        unsigned long b;
+
+        if (!tbl_refidx_varint(post, len, &i, &d)) return 0;
+        ord += d;
+        if (ord >= njobs) return 0;
+        a = tbl_refidx_get32(jobtab + ord * 4UL);
+        b = tbl_refidx_get32(jobtab + ord * 4UL + 4UL);
+        if (a > b || b > heap_len) return 0;
+        if (!tbl_refidx_set_add(s, sha, heap + a, (size_t)(b - a))) return 0;
+    }
+    return 1;
+}
+
+/* All pairs of refs.idx into s. A missing file is empty; a bad one is 0. */
+static int tbl_refidx_load_base(tbl_refidx_set_t *s, const char *path)
+{
+    tbl_refidx_hdr_t h;
+    unsigned char *buf;
+    unsigned long i;
+    long sz = 0L;
+    FILE *fp;
+    int ok;
+
+    (void)memset(&h, 0, sizeof(h));
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    ok = (fseek(fp, 0L, SEEK_END) == 0 && (sz = ftell(fp)) >= (long)TBL_REFIDX_HDR &&
+          fseek(fp, 0L, SEEK_SET) == 0) ? 1 : 0;
+    buf = ok ? (unsigned char *)malloc((size_t)sz) : 0;
+    if (!buf || fread(buf, 1, (size_t)sz, fp) != (size_t)sz) ok = 0;
+    fclose(fp);
+    if (ok && (!tbl_refidx_hdr_ok(buf, &h) || h.file_len != (unsigned long)sz)) ok = 0;
+    for (i = 0UL; ok && i < h.ndig; ++i) {
+        const unsigned char *d = buf + TBL_REFIDX_HDR + i * TBL_REFIDX_DIG;
+        unsigned long rel = tbl_refidx_get32(d + 32);
+        unsigned long len = tbl_refidx_get32(d + 36);
+
+        if (rel > h.jobtab_off - h.post_off || len > h.jobtab_off - h.post_off - rel ||
+            !tbl_refidx_decode_post(s, d, buf + h.post_off + rel, len, buf + h.jobtab_off, h.njobs,
+                                    (const char *)buf + h.jobheap_off, h.file_len - h.jobheap_off)) {
+            ok = 0;
+        }
+    }
+    free(buf);
+    return ok;
+}
+
+static int tbl_refidx_cmp_str(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static int tbl_refidx_cmp_pair(const void *a, const void *b)
+{
+    const tbl_refidx_pair_t *x = (const tbl_refidx_pair_t *)a;
+    const tbl_refidx_pair_t *y = (const tbl_refidx_pair_t *)b;
+    int c = memcmp(x->sha, y->sha, 32);
+
+    if (c != 0) return c;
+    return (x->job < y->job) ? -1 : (x->job > y->job) ? 1 : 0;
+}
+
+/* Sorted unique jobids of s (pointers into the arena); *out_n entries. */
+static const char **tbl_refidx_jobs_sorted(const tbl_refidx_set_t *s, unsigned long *out_n)
+{
+    const char **jp;
+    unsigned long i;
+    unsigned long n;
+
+    jp = (const char **)malloc((size_t)(s->n ? s->n : 1UL) * sizeof(*jp));
+    if (!jp) return 0;
+    for (i = 0UL; i < s->n; ++i) jp[i] = s->arena + s->v[i].job;
+    if (s->n > 1UL) qsort(jp, (size_t)s->n, sizeof(*jp), tbl_refidx_cmp_str);
+    n = 0UL;
+    for (i = 0UL; i < s->n; ++i) {
+        if (n == 0UL || strcmp(jp[n - 1UL], jp[i]) != 0) jp[n++] = jp[i];
+    }
+    *out_n = n;
+    return jp;
+}
+
+static unsigned long tbl_refidx_rank(const char **jp, unsigned long n, const char *job)
+{
+    unsigned long lo = 0UL;
+    unsigned long hi = n;
+
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        if (strcmp(jp[mid], job) < 0) lo = mid + 1UL;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* refs.idx from s via tmp + rename. Sorts and dedupes s. */
+static int tbl_refidx_write(tbl_refidx_set_t *s, const tbl_refidx_paths_t *p,
+                            unsigned long *out_objects, unsigned long *out_refs)
+{
+    const char **jp;
+    unsigned char *dig = 0;
+    unsigned char *post = 0;
+    unsigned char *jobtab = 0;
+    unsigned char hdr[TBL_REFIDX_HDR];
+    unsigned long njobs = 0UL;
+    unsigned long ndig = 0UL;
+    unsigned long plen = 0UL;
+    unsigned long hlen = 0UL;
+    unsigned long total;
+    unsigned long i;
+    unsigned long k;
+    FILE *fp;
+    int ok;
+
+    jp = tbl_refidx_jobs_sorted(s, &njobs);
+    if (!jp) return 0;
+    for (i = 0UL; i < njobs; ++i) hlen += (unsigned long)strlen(jp[i]);
+
+    /* jobid -> ordinal, then (digest, ordinal) order without duplicates */
+    for (i = 0UL; i < s->n; ++i) s->v[i].job = tbl_refidx_rank(jp, njobs, s->arena + s->v[i].job);
+    if (s->n > 1UL) qsort(s->v, (size_t)s->n, sizeof(*s->v), tbl_refidx_cmp_pair);
+    k = 0UL;
+    for (i = 0UL; i < s->n; ++i) {
+        if (k > 0UL && tbl_refidx_cmp_pair(&s->v[k - 1UL], &s->v[i]) == 0) continue;
+        s->v[k++] = s->v[i];
+        if (k == 1UL || memcmp(s->v[k - 2UL].sha, s->v[k - 1UL].sha, 32) != 0) ndig++;
+    }
+    s->n = k;
+
+    ok = (ndig <= (0xffffffffUL - TBL_REFIDX_HDR) / TBL_REFIDX_DIG && s->n <= 0x30000000UL) ? 1 : 0;
+    dig = ok ? (unsigned char *)malloc((size_t)(ndig ? ndig * TBL_REFIDX_DIG : 1UL)) : 0;
+    post = ok ? (unsigned char *)malloc((size_t)(s->n ? s->n * 5UL : 1UL)) : 0;
+    jobtab = ok ? (unsigned char *)malloc((size_t)((njobs + 1UL) * 4UL)) : 0;
+    if (!dig || !post || !jobtab) ok = 0;
+
+    /* digests and their delta-coded posting lists */
+    for (i = 0UL, k = 0UL; ok && i < s->n; ++i) {
+        unsigned long d;
+
+        if (i == 0UL || memcmp(s->v[i - 1UL].sha, s->v[i].sha, 32) != 0) {
+            if (k > 0UL) tbl_refidx_put32(dig + (k - 1UL) * TBL_REFIDX_DIG + 36, plen - tbl_refidx_get32(dig + (k - 1UL) * TBL_REFIDX_DIG + 32));
+            (void)memcpy(dig + k * TBL_REFIDX_DIG, s->v[i].sha, 32);
+            tbl_refidx_put32(dig + k * TBL_REFIDX_DIG + 32, plen);
+            k++;
+            d = s->v[i].job;
+        } else {
+            d = s->v[i].job - s->v[i - 1UL].job;
+        }
+        do {
+            unsigned char c = (unsigned char)(d & 0x7fUL);
+            d >>= 7;
+            post[plen++] = (unsigned char)(d ? (c | 0x80) : c);
+        } while (d);
+    }
+    if (ok && k > 0UL) {
+        tbl_refidx_put32(dig + (k - 1UL) * TBL_REFIDX_DIG + 36, plen - tbl_refidx_get32(dig + (k - 1UL) * TBL_REFIDX_DIG + 32));
+    }
+
+    total = 0UL;
+    if (ok) {
+        unsigned long off = 0UL;
+
+        for (i = 0UL; i < njobs; ++i) {
+            tbl_refidx_put32(jobtab + i * 4UL, off);
+            off += (unsigned long)strlen(jp[i]);
+        }
+        tbl_refidx_put32(jobtab + njobs * 4UL, off);
+        total = TBL_REFIDX_HDR + ndig * TBL_REFIDX_DIG + plen + (njobs + 1UL) * 4UL;
+        if (hlen > 0xffffffffUL - total) ok = 0;
+        total += hlen;
+    }
+    if (ok) {
+        (void)memcpy(hdr, "TBLREF1\n", 8);
+        tbl_refidx_put32(hdr + 8, ndig);
+        tbl_refidx_put32(hdr + 12, njobs);
+        tbl_refidx_put32(hdr + 16, TBL_REFIDX_HDR + ndig * TBL_REFIDX_DIG);
+        tbl_refidx_put32(hdr + 20, TBL_REFIDX_HDR + ndig * TBL_REFIDX_DIG + plen);
+        tbl_refidx_put32(hdr + 24, TBL_REFIDX_HDR + ndig * TBL_REFIDX_DIG + plen + (njobs + 1UL) * 4UL);
+        tbl_refidx_put32(hdr + 28, total);
+    }
+
+    fp = ok ? fopen(p->tmp, "wb") : 0;
+    if (!fp) ok = 0;
+    if (ok && (fwrite(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) ||
+               fwrite(dig, 1, (size_t)(ndig * TBL_REFIDX_DIG), fp) != (size_t)(ndig * TBL_REFIDX_DIG) ||
+               fwrite(post, 1, (size_t)plen, fp) != (size_t)plen ||
+               fwrite(jobtab, 1, (size_t)((njobs + 1UL) * 4UL), fp) != (size_t)((njobs + 1UL) * 4UL))) {
+        ok = 0;
+    }
+    for (i = 0UL; ok && i < njobs; ++i) {
+        if (!tbl_fputs_ok(fp, jp[i])) ok = 0;
+    }
+    if (fp && fclose(fp) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(p->tmp, p->base, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(p->tmp);
+
+    if (ok && out_objects) *out_objects = ndig;
+    if (ok && out_refs) *out_refs = s->n;
+    free(jp);
+    free(dig);
+    free(post);
+    free(jobtab);
+    return ok;
+}
+
+static int tbl_refidx_lock(const tbl_refidx_paths_t *p, tbl_fs_lock_t *lk, char *err, size_t errsz)
+{
+    if (tbl_fs_mkdir_p(p->dir) != 0) {
+        tbl_refidx_seterr(err, errsz, "cannot create index dir");
+        return 0;
+    }
+    if (tbl_fs_lock_open(lk, p->lock) != 0) {
+        tbl_refidx_seterr(err, errsz, "cannot open refs.lock");
+        return 0;
+    }
+    if (tbl_fs_lock_acquire(lk) != 0) {
+        (void)tbl_fs_lock_close(lk);
+        tbl_refidx_seterr(err, errsz, "cannot lock refs.lock");
+        return 0;
+    }
+    return 1;
+}
+
+int tbl_refidx_add(const char *repo_root, const char *sha256_hex, const char *jobid,
+                   char *err, size_t errsz)
+{
+    tbl_refidx_paths_t p;
+    tbl_fs_afile_t af;
+    tbl_fs_lock_t lk;
+    unsigned char sha[32];
+    char line[TBL_REFIDX_LINE_MAX];
+    size_t i;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !sha256_hex || !tbl_refidx_sha_ok(sha256_hex, sha) ||
+        sha256_hex[64] != '\0' || !tbl_record_is_safe_id(jobid) || strlen(jobid) > 255U) {
+        tbl_refidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_refidx_paths(repo_root, &p)) {
+        tbl_refidx_seterr(err, errsz, "refs index path too long");
+        return 2;
+    }
+    (void)tbl_strlcpy(line, sha256_hex, sizeof(line));
+    for (i = 0; i < 64U; ++i) {
+        if (line[i] >= 'A' && line[i] <= 'F') line[i] = (char)(line[i] - 'A' + 'a');
+    }
+    (void)tbl_strlcat(line, " ", sizeof(line));
+    (void)tbl_strlcat(line, jobid, sizeof(line));
+    (void)tbl_strlcat(line, "\n", sizeof(line));
+
+    if (!tbl_refidx_lock(&p, &lk, err, errsz)) return 2;
+    rc = 0;
+    if (tbl_fs_afile_open(&af, p.tail) != 0) {
+        tbl_refidx_seterr(err, errsz, "cannot open refs.idx.tail");
+        rc = 2;
+    } else {
+        if (tbl_fs_afile_write(&af, line, strlen(line)) != 0) {
+            tbl_refidx_seterr(err, errsz, "cannot append refs.idx.tail");
+            rc = 2;
+        }
+        if (tbl_fs_afile_close(&af) != 0 && rc == 0) {
+            tbl_refidx_seterr(err, errsz, "cannot append refs.idx.tail");
+            rc = 2;
+        }
+    }
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+/* refs.idx + tail -> refs.idx, tail dropped. Returns 1/0. */
+static int tbl_refidx_merge(const tbl_refidx_paths_t *p)
+{
+    tbl_refidx_set_t s;
+    tbl_fs_lock_t lk;
+    int ok;
+
+    if (!tbl_refidx_lock(p, &lk, 0, 0)) return 0;
+    (void)memset(&s, 0, sizeof(s));
+    ok = tbl_refidx_load_base(&s, p->base) && tbl_refidx_load_tail(&s, p->tail, 0, 0) &&
+         tbl_refidx_write(&s, p, 0, 0);
+    if (ok) (void)tbl_fs_remove_file(p->tail);
+    tbl_refidx_set_free(&s);
+    (void)tbl_fs_lock_close(&lk);
+    return ok;
+}
+
+/* Candidates for sha from refs.idx (binary search, then one posting list). */
+static int tbl_refidx_base_lookup(tbl_refidx_set_t *s, const char *path, const unsigned char sha[32])
+{
+    tbl_refidx_hdr_t h;
+    unsigned char b[TBL_REFIDX_HDR];
+    unsigned char d[TBL_REFIDX_DIG];
+    unsigned char *post;
+    unsigned long lo;
+    unsigned long hi;
+    unsigned long rel;
+    unsigned long len;
+    unsigned long ord;
+    unsigned long i;
+    FILE *fp;
+    int ok;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    (void)setvbuf(fp, 0, _IONBF, 0);
+    if (!tbl_refidx_pread_ok(fp, 0UL, b, sizeof(b)) || !tbl_refidx_hdr_ok(b, &h)) {
+        fclose(fp);
+        return 0;
+    }
+
+    lo = 0UL;
+    hi = h.ndig;
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        if (!tbl_refidx_pread_ok(fp, TBL_REFIDX_HDR + mid * TBL_REFIDX_DIG, d, sizeof(d))) {
+            fclose(fp);
+            return 0;
+        }
+        if (memcmp(d, sha, 32) < 0) lo = mid + 1UL;
+        else hi = mid;
+    }
+    if (lo >= h.ndig || !tbl_refidx_pread_ok(fp, TBL_REFIDX_HDR + lo * TBL_REFIDX_DIG, d, sizeof(d)) ||
+        memcmp(d, sha, 32) != 0) {
+        fclose(fp);
+        return 1;
+    }
+
+    rel = tbl_refidx_get32(d + 32);
+    len = tbl_refidx_get32(d + 36);
+    if (rel > h.jobtab_off - h.post_off || len > h.jobtab_off - h.post_off - rel) {
+        fclose(fp);
+        return 0;
+    }
+    post = (unsigned char *)malloc((size_t)(len ? len : 1UL));
+    ok = (post && tbl_refidx_pread_ok(fp, h.post_off + rel, post, (size_t)len)) ? 1 : 0;
+
+    /* ordinals -> jobids, two positioned reads each */
+    i = 0UL;
+    ord = 0UL;
+    while (ok && i < len) {
+        unsigned char ab[8];
+        char job[256];
+        unsigned long dlt;
+        unsigned long a;
+        unsigned long e;
+
+        if (!tbl_refidx_varint(post, len, &i, &dlt)) {
+            ok = 0;
+            break;
+        }
+        ord += dlt;
+        if (ord >= h.njobs || !tbl_refidx_pread_ok(fp, h.jobtab_off + ord * 4UL, ab, 8)) {
+            ok = 0;
+            break;
+        }
+        a = tbl_refidx_get32(ab);
+        e = tbl_refidx_get32(ab + 4);
+        if (a > e || e - a >= sizeof(job) || e > h.file_len - h.jobheap_off ||
+            !tbl_refidx_pread_ok(fp, h.jobheap_off + a, job, (size_t)(e - a)) ||
+            !tbl_refidx_set_add(s, sha, job, (size_t)(e - a))) {
+            ok = 0;
+        }
+    }
+    free(post);
+    fclose(fp);
+    return ok;
+}
+
+int tbl_refidx_each(const char *repo_root, const char *sha256_hex, tbl_refidx_job_fn fn, void *ud,
+                    unsigned long *out_jobs, char *err, size_t errsz)
+{
+    tbl_refidx_paths_t p;
+    tbl_refidx_set_t s;
+    tbl_recidx_t rx;
+    unsigned char sha[32];
+    const char **jp;
+    unsigned long tail_bytes;
+    unsigned long njobs;
+    unsigned long hits;
+    unsigned long i;
+    int have_rx;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_jobs) *out_jobs = 0UL;
+    if (!repo_root || !repo_root[0] || !sha256_hex || !tbl_refidx_sha_ok(sha256_hex, sha) ||
+        sha256_hex[64] != '\0' || !fn) {
+        tbl_refidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_refidx_paths(repo_root, &p)) {
+        tbl_refidx_seterr(err, errsz, "refs index path too long");
+        return 2;
+    }
+
+    (void)memset(&s, 0, sizeof(s));
+    if (!tbl_refidx_load_tail(&s, p.tail, sha, &tail_bytes)) {
+        tbl_refidx_set_free(&s);
+        tbl_refidx_seterr(err, errsz, "cannot read refs.idx.tail");
+        return 2;
+    }
+    if (tail_bytes > TBL_REFIDX_TAIL_MAX) (void)tbl_refidx_merge(&p);
+    if (!tbl_refidx_base_lookup(&s, p.base, sha)) {
+        tbl_refidx_set_free(&s);
+        tbl_refidx_seterr(err, errsz, "refs.idx damaged (run tablinum index --rebuild)");
+        return 2;
+    }
+
+    jp = tbl_refidx_jobs_sorted(&s, &njobs);
+    if (!jp) {
+        tbl_refidx_set_free(&s);
+        tbl_refidx_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+
+    /* a candidate counts only while its record still names the digest */
+    have_rx = (tbl_recidx_open(&rx, repo_root, 0, 0) == 0) ? 1 : 0;
+    hits = 0UL;
+    for (i = 0UL; i < njobs; ++i) {
+        tbl_record_t rec;
+        unsigned char rsha[32];
+
+        if ((!have_rx || tbl_recidx_lookup(&rx, jp[i], &rec) != 0) &&
+            tbl_record_read_repo(repo_root, jp[i], &rec, 0, 0) != 0) {
+            continue;
+        }
+        if (!tbl_refidx_sha_ok(rec.sha256, rsha) || rec.sha256[64] != '\0' || memcmp(rsha, sha, 32) != 0) continue;
+        hits++;
+        if (fn(ud, jp[i]) != 0) break;
+    }
+    if (have_rx) tbl_recidx_close(&rx);
+    free(jp);
+    tbl_refidx_set_free(&s);
+    if (out_jobs) *out_jobs = hits;
+    return 0;
+}
+
+typedef struct tbl_refidx_build_s {
+    tbl_refidx_set_t *s;
+    int failed;
+} tbl_refidx_build_t;
+
+static int tbl_refidx_build_cb(void *ud, const tbl_record_t *rec)
+{
+    tbl_refidx_build_t *b = (tbl_refidx_build_t *)ud;
+    unsigned char sha[32];
+
+    if (!tbl_refidx_sha_ok(rec->sha256, sha) || rec->sha256[64] != '\0') return 0;
+    if (!tbl_refidx_set_add(b->s, sha, rec->job, strlen(rec->job))) {
+        b->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+int tbl_refidx_build(const char *repo_root, unsigned long *out_objects, unsigned long *out_refs,
+                     char *err, size_t errsz)
+{
+    tbl_refidx_paths_t p;
+    tbl_refidx_set_t s;
+    tbl_refidx_build_t b;
+    tbl_fs_lock_t lk;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_objects) *out_objects = 0UL;
+    if (out_refs) *out_refs = 0UL;
+    if (!repo_root || !repo_root[0]) {
+        tbl_refidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_refidx_paths(repo_root, &p)) {
+        tbl_refidx_seterr(err, errsz, "refs index path too long");
+        return 2;
+    }
+    if (!tbl_refidx_lock(&p, &lk, err, errsz)) return 2;
+
+    rc = 0;
+    (void)memset(&s, 0, sizeof(s));
+    b.s = &s;
+    b.failed = 0;
+    if (tbl_record_each(repo_root, tbl_refidx_build_cb, &b, 0, 0) != 0) {
+        tbl_refidx_seterr(err, errsz, "cannot read records");
+        rc = 2;
+    }
+    if (rc == 0 && b.failed) {
+        tbl_refidx_seterr(err, errsz, "out of memory");
+        rc = 2;
+    }
+    if (rc == 0 && !tbl_refidx_write(&s, &p, out_objects, out_refs)) {
+        tbl_refidx_seterr(err, errsz, "cannot write refs.idx");
+        rc = 2;
+    }
+    if (rc == 0) (void)tbl_fs_remove_file(p.tail);
+    tbl_refidx_set_free(&s);
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+#endif /* TBL_REFIDX_IMPLEMENTATION */
+
+#endif /* TBL_CORE_REFIDX_H */
@@ -0,0 +1,2 @@
+#define TBL_SCRUB_IMPLEMENTATION
+#include "core/scrub.h"
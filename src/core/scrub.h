@@ -0,0 +1,546 @@
+#ifndef TBL_CORE_SCRUB_H
+#define TBL_CORE_SCRUB_H
+
+#include <stddef.h>
+
+/* Repository-wide verify (`tablinum verify-all`), one process for the
+   whole repo instead of one `tablinum verify` per job.
+   - TBL_SCRUB_RECORDS: every stored record (core/record.h
+     tbl_record_each) in job id order; its CAS object is rehashed and
+     compared with the record. Records with status != ok are skipped.
+   - TBL_SCRUB_OBJECTS: every object under <repo_root>/sha256/ in hash
+     order, rehashed and compared with its name; no records are read.
+   Objects are hashed on nthreads workers (0 = one per CPU); the items are
+   claimed in order, so reads stay close to the listing order.
+   Events: only problems, one per item, through a single writer for the
+   run: verify.fail (sha256 mismatch, object missing, record sha256
+   invalid) and verify.error (I/O); at the end one verify-all event with
+   the totals (status ok or fail).
+   Checkpoint <repo_root>/cursors/verify-all (mode, last item of the
+   verified prefix, totals so far), rewritten every TBL_SCRUB_CP_EVERY
+   items of that prefix: an interrupted run resumes after it (full != 0
+   starts over) and a complete pass removes it. Items added below the
+   checkpoint meanwhile wait for the next pass. */
+
+#define TBL_SCRUB_RECORDS 0
+#define TBL_SCRUB_OBJECTS 1
+
+#ifndef TBL_SCRUB_CP_EVERY
+#define TBL_SCRUB_CP_EVERY 1024UL
+#endif
+
+/* progress callback at most every this many seconds */
+#define TBL_SCRUB_PROGRESS_SECONDS 5UL
+
+typedef struct tbl_scrub_stats_s {
+    unsigned long total;        /* items in this pass */
+    unsigned long resumed;      /* verified by an earlier run (checkpoint) */
+    unsigned long done;         /* verified prefix, resumed included */
+    unsigned long ok;
+    unsigned long failed;       /* mismatch, object missing, invalid sha256 */
+    unsigned long errors;       /* I/O */
+    unsigned long skipped;      /* records with status != ok */
+    unsigned long bytes;        /* hashed by this run */
+} tbl_scrub_stats_t;
+
+/* Called from a worker (serialized); st is only valid during the call. */
+typedef void (*tbl_scrub_progress_fn)(void *ud, const tbl_scrub_stats_t *st);
+
+/* Returns 0 when the pass completed (problems are in out: failed, errors),
+   2 error (listing, events writer, checkpoint). */
+int tbl_scrub_run(const char *repo_root, int mode, unsigned long nthreads, int full,
+                  tbl_scrub_progress_fn progress, void *ud,
+                  tbl_scrub_stats_t *out, char *err, size_t errsz);
+
+#ifdef TBL_SCRUB_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/safe.h"
+#include "core/str.h"
+#include "core/path.h"
+#include "core/record.h"
+#include "core/events.h"
+#include "core/verify.h"
+#include "os/fs.h"
+#include "os/thread.h"
+
+/* item results */
+#define TBL_SCRUB_R_OK 1
+#define TBL_SCRUB_R_FAIL 2
+#define TBL_SCRUB_R_ERROR 3
+#define TBL_SCRUB_R_SKIP 4
+
+typedef struct tbl_scrub_item_s {
+    unsigned long name_off;     /* job id or object hex, in the heap */
+    unsigned long sha_off;      /* expected sha256, "" = invalid */
+    const char *name;
+    const char *sha;
+    unsigned char skip;         /* record status != ok */
+    unsigned char result;       /* 0 = not verified yet */
+} tbl_scrub_item_t;
+
+typedef struct tbl_scrub_list_s {
+    tbl_scrub_item_t *it;
+    unsigned long n;
+    unsigned long cap;
+    char *heap;
+    unsigned long len;
+    unsigned long hcap;
+    char d1[3];                 /* objects: current fan-out directory */
+    int oom;
+} tbl_scrub_list_t;
+
+typedef struct tbl_scrub_cp_s {
+    int mode;
+    char last[256];
+    tbl_scrub_stats_t st;
+} tbl_scrub_cp_t;
+
+typedef struct tbl_scrub_s {
+    const char *repo_root;
+    int mode;
+    tbl_scrub_item_t *it;
+    unsigned long n;
+    unsigned long next;         /* next item to claim */
+    unsigned long low;          /* items [0, low) verified */
+    unsigned long cp_low;       /* low at the last checkpoint */
+    unsigned long base;         /* items before it[0] (resumed) */
+    unsigned long shown;        /* time of the last progress call */
+    tbl_scrub_stats_t st;
+    tbl_events_writer_t w;
+    const char *cp_path;
+    tbl_scrub_progress_fn progress;
+    void *ud;
+    tbl_mutex_t mu;
+} tbl_scrub_t;
+
+static void tbl_scrub_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "verify-all error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_scrub_hex_ok(const char *s, size_t n)
+{
+    size_t i;
+
+    if (strlen(s) != n) return 0;
+    for (i = 0; i < n; ++i) {
+        if (!((s[i] >= '0' && s[i] <= '9') || (s[i] >= 'a' && s[i] <= 'f'))) return 0;
+    }
+    return 1;
+}
+
+static int tbl_scrub_heap_add_ok(tbl_scrub_list_t *l, const char *s, unsigned long *out_off)
+{
+    unsigned long k = (unsigned long)strlen(s) + 1UL;
+
+    if (l->len + k > l->hcap) {
+        unsigned long nc = l->hcap ? l->hcap * 2UL : 65536UL;
+        char *nh;
+
+        while (nc < l->len + k) nc *= 2UL;
+        nh = (char *)realloc(l->heap, (size_t)nc);
+        if (!nh) return 0;
+        l->heap = nh;
+        l->hcap = nc;
+    }
+    (void)memcpy(l->heap + l->len, s, (size_t)k);
+    *out_off = l->len;
+    l->len += k;
+    return 1;
+}
+
+static int tbl_scrub_add_ok(tbl_scrub_list_t *l, const char *name, const char *sha, int skip)
+{
+    tbl_scrub_item_t *t;
+
+    if (l->n == l->cap) {
+        unsigned long nc = l->cap ? l->cap * 2UL : 1024UL;
+        tbl_scrub_item_t *ni = (tbl_scrub_item_t *)realloc(l->it, (size_t)nc * sizeof(*ni));
+
+        if (!ni) return 0;
+        l->it = ni;
+        l->cap = nc;
+    }
+    t = &l->it[l->n];
+    (void)memset(t, 0, sizeof(*t));
+    if (!tbl_scrub_heap_add_ok(l, name, &t->name_off) || !tbl_scrub_heap_add_ok(l, sha, &t->sha_off)) return 0;
+    t->skip = (unsigned char)(skip ? 1 : 0);
+    l->n++;
+    return 1;
+}
+
+static void tbl_scrub_list_free(tbl_scrub_list_t *l)
+{
+    free(l->it);
+    free(l->heap);
+    (void)memset(l, 0, sizeof(*l));
+}
+
+static int tbl_scrub_rec_cb(void *ud, const tbl_record_t *rec)
+{
+    tbl_scrub_list_t *l = (tbl_scrub_list_t *)ud;
+    const char *sha = tbl_scrub_hex_ok(rec->sha256, 64U) ? rec->sha256 : "";
+
+    if (!tbl_scrub_add_ok(l, rec->job, sha, !tbl_streq(rec->status, "ok"))) {
+        l->oom = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int tbl_scrub_obj_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_scrub_list_t *l = (tbl_scrub_list_t *)ud;
+    char hex[65];
+
+    (void)full;
+    /* anything else (a copy in progress) is not an object yet */
+    if (is_dir || !tbl_scrub_hex_ok(name, 62U)) return 0;
+    hex[0] = l->d1[0];
+    hex[1] = l->d1[1];
+    (void)memcpy(hex + 2, name, 63U);
+    if (!tbl_scrub_add_ok(l, hex, hex, 0)) {
+        l->oom = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int tbl_scrub_fan_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_scrub_list_t *l = (tbl_scrub_list_t *)ud;
+
+    if (!is_dir || !tbl_scrub_hex_ok(name, 2U)) return 0;
+    l->d1[0] = name[0];
+    l->d1[1] = name[1];
+    l->d1[2] = '\0';
+    if (tbl_fs_list_dir(full, tbl_scrub_obj_cb, l) != 0 && !l->oom) return 1;
+    return l->oom ? 1 : 0;
+}
+
+static int tbl_scrub_item_cmp(const void *a, const void *b)
+{
+    return strcmp(((const tbl_scrub_item_t *)a)->name, ((const tbl_scrub_item_t *)b)->name);
+}
+
+static int tbl_scrub_list(const char *repo_root, int mode, tbl_scrub_list_t *l, char *err, size_t errsz)
+{
+    unsigned long i;
+
+    if (mode == TBL_SCRUB_OBJECTS) {
+        char dir[1024];
+        int ex = 0;
+
+        if (!tbl_path_join2(dir, sizeof(dir), repo_root, "sha256")) {
+            tbl_scrub_seterr(err, errsz, "repo path too long");
+            return 2;
+        }
+        (void)tbl_fs_exists(dir, &ex);
+        if (ex && tbl_fs_list_dir(dir, tbl_scrub_fan_cb, l) != 0 && !l->oom) {
+            tbl_scrub_seterr(err, errsz, "cannot list objects");
+            return 2;
+        }
+    } else if (tbl_record_each(repo_root, tbl_scrub_rec_cb, l, err, errsz) != 0 && !l->oom) {
+        return 2;
+    }
+    if (l->oom) {
+        tbl_scrub_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    for (i = 0UL; i < l->n; ++i) {
+        l->it[i].name = l->heap + l->it[i].name_off;
+        l->it[i].sha = l->heap + l->it[i].sha_off;
+    }
+    if (l->n > 1UL) qsort(l->it, (size_t)l->n, sizeof(*l->it), tbl_scrub_item_cmp);
+    return 0;
+}
+
+/* ---- checkpoint ---- */
+
+static const char *tbl_scrub_mode_name(int mode)
+{
+    return (mode == TBL_SCRUB_OBJECTS) ? "objects" : "records";
+}
+
+static int tbl_scrub_cp_read(const char *path, tbl_scrub_cp_t *cp)
+{
+    FILE *fp;
+    char line[512];
+    int have = 0;
+
+    (void)memset(cp, 0, sizeof(*cp));
+    fp = fopen(path, "rb");
+    if (!fp) return 0;
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        size_t n = strlen(line);
+        unsigned long *field = 0;
+        char *v;
+
+        if (n == 0 || line[n - 1] != '\n') { have = -1; break; }
+        line[n - 1] = '\0';
+        v = strchr(line, '=');
+        if (!v) { have = -1; break; }
+        *v++ = '\0';
+
+        if (tbl_streq(line, "mode")) {
+            if (tbl_streq(v, "records")) cp->mode = TBL_SCRUB_RECORDS;
+            else if (tbl_streq(v, "objects")) cp->mode = TBL_SCRUB_OBJECTS;
+            else { have = -1; break; }
+            have |= 1;
+            continue;
+        }
+        if (tbl_streq(line, "last")) {
+            if (!v[0] || !tbl_strlcpy_ok(cp->last, v, sizeof(cp->last))) { have = -1; break; }
+            have |= 2;
+            continue;
+        }
+        if (tbl_streq(line, "done")) field = &cp->st.done;
+        else if (tbl_streq(line, "ok")) field = &cp->st.ok;
+        else if (tbl_streq(line, "failed")) field = &cp->st.failed;
+        else if (tbl_streq(line, "errors")) field = &cp->st.errors;
+        else if (tbl_streq(line, "skipped")) field = &cp->st.skipped;
+        if (!field || !tbl_parse_u32_ok(v, field)) { have = -1; break; }
+        have |= 4;
+    }
+    fclose(fp);
+    return (have == 7) ? 1 : 0;
+}
+
+static int tbl_scrub_cp_write(const tbl_scrub_t *s)
+{
+    static const char *const keys[5] = { "done", "ok", "failed", "errors", "skipped" };
+    unsigned long vals[5];
+    char tmp[1100];
+    char buf[1024];
+    char nbuf[32];
+    int k;
+
+    vals[0] = s->st.done;
+    vals[1] = s->st.ok;
+    vals[2] = s->st.failed;
+    vals[3] = s->st.errors;
+    vals[4] = s->st.skipped;
+
+    (void)tbl_strlcpy(buf, "mode=", sizeof(buf));
+    (void)tbl_strlcat(buf, tbl_scrub_mode_name(s->mode), sizeof(buf));
+    (void)tbl_strlcat(buf, "\nlast=", sizeof(buf));
+    (void)tbl_strlcat(buf, s->it[s->low - 1UL].name, sizeof(buf));
+    for (k = 0; k < 5; ++k) {
+        if (!tbl_ul_to_dec_ok(vals[k], nbuf, sizeof(nbuf))) return 0;
+        (void)tbl_strlcat(buf, "\n", sizeof(buf));
+        (void)tbl_strlcat(buf, keys[k], sizeof(buf));
+        (void)tbl_strlcat(buf, "=", sizeof(buf));
+        (void)tbl_strlcat(buf, nbuf, sizeof(buf));
+    }
+    if (!tbl_strlcat_ok(buf, "\n", sizeof(buf))) return 0;
+
+    if (!tbl_strlcpy_ok(tmp, s->cp_path, sizeof(tmp)) || !tbl_strlcat_ok(tmp, ".tmp", sizeof(tmp))) return 0;
+    if (tbl_fs_write_file(tmp, buf, strlen(buf)) != 0) return 0;
+    if (tbl_fs_rename_atomic(tmp, s->cp_path, 1) != 0) {
+        (void)tbl_fs_remove_file(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+/* ---- workers ---- */
+
+/* under the lock: results in listing order into the totals */
+static void tbl_scrub_advance(tbl_scrub_t *s)
+{
+    while (s->low < s->n && s->it[s->low].result != 0) {
+        switch (s->it[s->low].result) {
+        case TBL_SCRUB_R_OK: s->st.ok++; break;
+        case TBL_SCRUB_R_FAIL: s->st.failed++; break;
+        case TBL_SCRUB_R_ERROR: s->st.errors++; break;
+        default: s->st.skipped++; break;
+        }
+        s->low++;
+    }
+    s->st.done = s->base + s->low;
+    if (s->low - s->cp_low >= TBL_SCRUB_CP_EVERY) {
+        /* best effort: a missed checkpoint only means more work on resume */
+        (void)tbl_scrub_cp_write(s);
+        s->cp_low = s->low;
+    }
+}
+
+static void tbl_scrub_worker(void *ud, unsigned long worker)
+{
+    tbl_scrub_t *s = (tbl_scrub_t *)ud;
+    tbl_scrub_item_t *t;
+    unsigned long i;
+    unsigned long bytes;
+    unsigned long now;
+    char msg[128];
+    int r;
+    int rc;
+
+    (void)worker;
+
+    for (;;) {
+        tbl_mutex_lock(&s->mu);
+        i = s->next;
+        if (i < s->n) s->next++;
+        tbl_mutex_unlock(&s->mu);
+        if (i >= s->n) break;
+
+        t = &s->it[i];
+        bytes = 0UL;
+        msg[0] = '\0';
+        if (t->skip) {
+            r = TBL_SCRUB_R_SKIP;
+        } else if (!t->sha[0]) {
+            r = TBL_SCRUB_R_FAIL;
+            (void)tbl_strlcpy(msg, "record sha256 invalid", sizeof(msg));
+        } else {
+            rc = tbl_verify_object(s->repo_root, t->sha, &bytes, msg, sizeof(msg));
+            r = (rc == 0) ? TBL_SCRUB_R_OK : (rc == 1) ? TBL_SCRUB_R_FAIL : TBL_SCRUB_R_ERROR;
+        }
+
+        tbl_mutex_lock(&s->mu);
+        s->st.bytes += bytes;
+        if (r == TBL_SCRUB_R_FAIL || r == TBL_SCRUB_R_ERROR) {
+            (void)tbl_events_writer_append(&s->w, (r == TBL_SCRUB_R_FAIL) ? "verify.fail" : "verify.error",
+                                           (s->mode == TBL_SCRUB_RECORDS) ? t->name : "",
+                                           (r == TBL_SCRUB_R_FAIL) ? "fail" : "error", t->sha,
+                                           msg[0] ? msg : "hash failed", 0, 0);
+        }
+        t->result = (unsigned char)r;
+        tbl_scrub_advance(s);
+        now = (unsigned long)time(0);
+        if (s->progress && now - s->shown >= TBL_SCRUB_PROGRESS_SECONDS) {
+            s->shown = now;
+            s->progress(s->ud, &s->st);
+        }
+        tbl_mutex_unlock(&s->mu);
+    }
+}
+
+/* "records: 10 checked, 9 ok, 1 failed, 0 errors, 0 skipped" */
+static void tbl_scrub_summary(const tbl_scrub_t *s, char *out, size_t outsz)
+{
+    static const char *const names[5] = { " checked, ", " ok, ", " failed, ", " errors, ", " skipped" };
+    unsigned long vals[5];
+    char nbuf[32];
+    int k;
+
+    vals[0] = s->st.done;
+    vals[1] = s->st.ok;
+    vals[2] = s->st.failed;
+    vals[3] = s->st.errors;
+    vals[4] = s->st.skipped;
+    (void)tbl_strlcpy(out, tbl_scrub_mode_name(s->mode), outsz);
+    (void)tbl_strlcat(out, ": ", outsz);
+    for (k = 0; k < 5; ++k) {
+        (void)tbl_ul_to_dec_ok(vals[k], nbuf, sizeof(nbuf));
+        (void)tbl_strlcat(out, nbuf, outsz);
+        (void)tbl_strlcat(out, names[k], outsz);
+    }
+}
+
+int tbl_scrub_run(const char *repo_root, int mode, unsigned long nthreads, int full,
+                  tbl_scrub_progress_fn progress, void *ud,
+                  tbl_scrub_stats_t *out, char *err, size_t errsz)
+{
+    tbl_scrub_list_t l;
+    tbl_scrub_cp_t cp;
+    tbl_scrub_t s;
+    char cur_dir[1024];
+    char cp_path[1100];
+    char reason[256];
+    unsigned long start;
+    unsigned long nw;
+    int ex;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out) (void)memset(out, 0, sizeof(*out));
+    if (!repo_root || !repo_root[0] || (mode != TBL_SCRUB_RECORDS && mode != TBL_SCRUB_OBJECTS)) {
+        tbl_scrub_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_path_join2(cur_dir, sizeof(cur_dir), repo_root, "cursors") ||
+        !tbl_path_join2(cp_path, sizeof(cp_path), cur_dir, "verify-all")) {
+        tbl_scrub_seterr(err, errsz, "repo path too long");
+        return 2;
+    }
+    if (tbl_fs_mkdir_p(cur_dir) != 0) {
+        tbl_scrub_seterr(err, errsz, "cannot create cursors dir");
+        return 2;
+    }
+
+    (void)memset(&l, 0, sizeof(l));
+    if (tbl_scrub_list(repo_root, mode, &l, err, errsz) != 0) {
+        tbl_scrub_list_free(&l);
+        return 2;
+    }
+
+    (void)memset(&s, 0, sizeof(s));
+    s.repo_root = repo_root;
+    s.mode = mode;
+    s.cp_path = cp_path;
+    s.progress = progress;
+    s.ud = ud;
+    s.shown = (unsigned long)time(0);
+
+    /* resume after the checkpoint of a pass in the same mode */
+    start = 0UL;
+    if (!full && tbl_scrub_cp_read(cp_path, &cp) && cp.mode == mode) {
+        while (start < l.n && strcmp(l.it[start].name, cp.last) <= 0) start++;
+        s.st = cp.st;
+    }
+    s.it = l.it + start;
+    s.n = l.n - start;
+    s.base = start;
+    s.st.total = l.n;
+    s.st.resumed = start;
+    s.st.done = start;
+    s.st.bytes = 0UL;
+
+    if (tbl_events_writer_open(&s.w, repo_root, err, errsz) != 0) {
+        tbl_scrub_list_free(&l);
+        return 2;
+    }
+    if (!tbl_mutex_init_ok(&s.mu)) {
+        tbl_events_writer_close(&s.w);
+        tbl_scrub_list_free(&l);
+        tbl_scrub_seterr(err, errsz, "mutex init failed");
+        return 2;
+    }
+
+    nw = tbl_thread_workers(nthreads);
+    if (nw > s.n) nw = s.n;
+    if (nw > 0UL) tbl_thread_run(nw, tbl_scrub_worker, &s);
+    tbl_mutex_destroy(&s.mu);
+
+    /* complete: the next run is a new pass */
+    rc = 0;
+    ex = 0;
+    (void)tbl_fs_exists(cp_path, &ex);
+    if (ex && tbl_fs_remove_file(cp_path) != 0) {
+        tbl_scrub_seterr(err, errsz, "cannot remove checkpoint");
+        rc = 2;
+    }
+
+    tbl_scrub_summary(&s, reason, sizeof(reason));
+    (void)tbl_events_writer_append(&s.w, "verify-all", "",
+                                   (s.st.failed || s.st.errors) ? "fail" : "ok", "", reason, 0, 0);
+    tbl_events_writer_close(&s.w);
+
+    if (out) *out = s.st;
+    tbl_scrub_list_free(&l);
+    return rc;
+}
+
+#endif /* TBL_SCRUB_IMPLEMENTATION */
+
+#endif /* TBL_CORE_SCRUB_H */
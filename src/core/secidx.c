@@ -0,0 +1,2 @@
+#define TBL_SECIDX_IMPLEMENTATION
+#include "core/secidx.h"
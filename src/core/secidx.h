@@ -0,0 +1,1380 @@
+#ifndef TBL_CORE_SECIDX_H
+#define TBL_CORE_SECIDX_H
+
+#include <stddef.h>
+
+#include "core/record.h"
+
+/* Ordered secondary indexes over the records (LSM-style), one order each:
+     by time    (stored_at, jobid)
+     by status  (status, stored_at, jobid)
+     by bytes   (bytes, jobid)
+   - index/sec.log       "<stored_at> <status code> <bytes> <jobid>" per
+                         record write, appended under index/sec.lock; this is
+                         the memtable, sorted in memory when it is flushed
+   - index/sec.<n>.run   immutable sorted run, one section per order:
+                         "TBLSEC1\n", entries (u32 key hi, u32 key lo,
+                         u8 jobid length, jobid), then per section a u32
+                         offset for every block of TBL_SECIDX_BLOCK entries,
+                         then a 64-byte footer (counts, offsets, FNV-1a,
+                         "TBLSECZ\n")
+   - index/sec.manifest  "next=<n>" and "run=<n> <entries>" lines, oldest
+                         run first, replaced atomically
+   A log larger than TBL_SECIDX_TAIL_MAX is flushed into a new run by the
+   writer that crossed the limit; runs are then merged while the newest is
+   at least as large as the one before it, which keeps O(log n) runs.
+   A scan binary-searches the block offsets of every run, merges runs and
+   log in key order and checks each hit against the current record
+   (index/records.idx, else the .ini): entries left behind by re-ingested
+   jobs drop out. Status codes: 1 ok, 2 fail, 3 any other (matched exactly).
+*/
+
+#ifndef TBL_SECIDX_TAIL_MAX
+#define TBL_SECIDX_TAIL_MAX 524288UL
+#endif
+
+#ifndef TBL_SECIDX_BLOCK
+#define TBL_SECIDX_BLOCK 64
+#endif
+
+#define TBL_SECIDX_MAX_RUNS 32UL
+
+#define TBL_SECIDX_BY_TIME   0 /* range on stored_at */
+#define TBL_SECIDX_BY_STATUS 1 /* one status, range on stored_at */
+#define TBL_SECIDX_BY_BYTES  2 /* range on bytes */
+
+typedef struct tbl_secidx_q_s {
+    int by;                  /* TBL_SECIDX_BY_* */
+    const char *status;      /* exact; required for BY_STATUS, else NULL = any */
+    unsigned long since;     /* stored_at >= since (if since_set) */
+    unsigned long until;     /* stored_at <  until (if until_set) */
+    int since_set;
+    int until_set;
+    unsigned long min_bytes; /* bytes >= min_bytes (if min_set) */
+    unsigned long max_bytes; /* bytes <= max_bytes (if max_set) */
+    int min_set;
+    int max_set;
+    int desc;                /* largest key first */
+    unsigned long limit;     /* 0 = no limit */
+} tbl_secidx_q_t;
+
+/* Per-record callback (current record), 0 = continue, else stop. */
+typedef int (*tbl_secidx_rec_fn)(void *ud, const tbl_record_t *rec);
+
+/* Append rec to the log; flushes and merges runs once the log is full.
+   Returns 0 ok, 2 error. */
+int tbl_secidx_put(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz);
+
+/* Call fn for every record matching q, in the key order of q->by
+   (descending with q->desc). Missing index files are not an error.
+   Returns 0 ok, 2 error. */
+int tbl_secidx_scan(const char *repo_root, const tbl_secidx_q_t *q, tbl_secidx_rec_fn fn, void *ud,
+                    unsigned long *out_hits, char *err, size_t errsz);
+
+/* Replace log and runs with one run built from every stored record (tbl_record_each).
+   Returns 0 ok, 2 error. */
+int tbl_secidx_build(const char *repo_root, unsigned long *out_entries, char *err, size_t errsz);
+
+#ifdef TBL_SECIDX_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/recidx.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_SECIDX_NSEC 3
+#define TBL_SECIDX_FOOT 64UL
+#define TBL_SECIDX_ENT_MAX 264UL /* 9 + 255 */
+#define TBL_SECIDX_LINE_MAX 512
+#define TBL_SECIDX_U32 0xffffffffUL
+
+typedef struct tbl_secidx_paths_s {
+    char dir[1024];
+    char log[1024];
+    char man[1024];
+    char mantmp[1024];
+    char lock[1024];
+} tbl_secidx_paths_t;
+
+typedef struct tbl_secidx_man_s {
+    unsigned long next;
+    unsigned long nruns;
+    unsigned long seq[TBL_SECIDX_MAX_RUNS];
+    unsigned long n[TBL_SECIDX_MAX_RUNS];
+} tbl_secidx_man_t;
+
+/* memtable row; job points into the arena once loading is done */
+typedef struct tbl_secidx_row_s {
+    unsigned long hi;
+    unsigned long lo;
+    unsigned long joff;
+    size_t jl;
+    const char *job;
+} tbl_secidx_row_t;
+
+typedef struct tbl_secidx_mem_s {
+    tbl_secidx_row_t *v[TBL_SECIDX_NSEC];
+    unsigned long n[TBL_SECIDX_NSEC];
+    unsigned long cap[TBL_SECIDX_NSEC];
+    char *arena;
+    unsigned long alen;
+    unsigned long acap;
+} tbl_secidx_mem_t;
+
+typedef struct tbl_secidx_run_s {
+    FILE *fp;
+    unsigned long n[TBL_SECIDX_NSEC];
+    unsigned long data_off[TBL_SECIDX_NSEC];
+    unsigned long data_end[TBL_SECIDX_NSEC];
+    unsigned long bidx_off[TBL_SECIDX_NSEC];
+} tbl_secidx_run_t;
+
+/* position in one sorted source: a run section (one block decoded) or rows */
+typedef struct tbl_secidx_cur_s {
+    const tbl_secidx_run_t *run;
+    int sec;
+    unsigned long nb;
+    unsigned long bn;
+    int cnt;
+    int pos;
+    unsigned long hi[TBL_SECIDX_BLOCK];
+    unsigned long lo[TBL_SECIDX_BLOCK];
+    unsigned int jo[TBL_SECIDX_BLOCK];
+    unsigned char jl[TBL_SECIDX_BLOCK];
+    unsigned char buf[TBL_SECIDX_BLOCK * TBL_SECIDX_ENT_MAX];
+    const tbl_secidx_row_t *rows;
+    unsigned long nrows;
+    unsigned long ri;
+    int valid;
+    int bad;
+} tbl_secidx_cur_t;
+
+typedef struct tbl_secidx_w_s {
+    FILE *fp;
+    unsigned long off;
+    int sec;
+    unsigned long n[TBL_SECIDX_NSEC];
+    unsigned long data_off[TBL_SECIDX_NSEC];
+    unsigned long data_end[TBL_SECIDX_NSEC];
+    unsigned long *bidx[TBL_SECIDX_NSEC];
+    unsigned long nb[TBL_SECIDX_NSEC];
+    unsigned long bcap[TBL_SECIDX_NSEC];
+    unsigned long lh;
+    unsigned long ll;
+    char lj[256];
+    size_t ljl;
+    int have_last;
+    int ok;
+} tbl_secidx_w_t;
+
+static void tbl_secidx_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "secondary index error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_secidx_paths(const char *repo_root, tbl_secidx_paths_t *p)
+{
+    return tbl_path_join2(p->dir, sizeof(p->dir), repo_root, "index") &&
+           tbl_path_join2(p->log, sizeof(p->log), p->dir, "sec.log") &&
+           tbl_path_join2(p->man, sizeof(p->man), p->dir, "sec.manifest") &&
+           tbl_path_join2(p->mantmp, sizeof(p->mantmp), p->dir, "sec.manifest.tmp") &&
+           tbl_path_join2(p->lock, sizeof(p->lock), p->dir, "sec.lock");
+}
+
+/* index/sec.<seq>.run (tmp: .run.tmp) */
+static int tbl_secidx_run_path(const tbl_secidx_paths_t *p, unsigned long seq, int tmp,
+                               char *out, size_t outsz)
+{
+    char name[64];
+    char nbuf[32];
+
+    if (!tbl_ul_to_dec_ok(seq, nbuf, sizeof(nbuf))) return 0;
+    (void)tbl_strlcpy(name, "sec.", sizeof(name));
+    (void)tbl_strlcat(name, nbuf, sizeof(name));
+    (void)tbl_strlcat(name, tmp ? ".run.tmp" : ".run", sizeof(name));
+    return tbl_path_join2(out, outsz, p->dir, name);
+}
+
+static void tbl_secidx_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+static unsigned long tbl_secidx_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static unsigned long tbl_secidx_fnv(const unsigned char *p, size_t n)
+{
+    unsigned long h = 2166136261UL;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        h ^= (unsigned long)p[i];
+        h = (h * 16777619UL) & TBL_SECIDX_U32;
+    }
+    return h;
+}
+
+/* upper 32 bits of an unsigned long of any width */
+static unsigned long tbl_secidx_hi32(unsigned long v)
+{
+    return ((v >> 16) >> 16) & TBL_SECIDX_U32;
+}
+
+static int tbl_secidx_code(const char *status)
+{
+    if (tbl_streq(status, "ok")) return 1;
+    if (tbl_streq(status, "fail")) return 2;
+    return 3;
+}
+
+static void tbl_secidx_keys(int sec, unsigned long stored_at, int code, unsigned long bytes,
+                            unsigned long *hi, unsigned long *lo)
+{
+    if (sec == TBL_SECIDX_BY_TIME) {
+        *hi = tbl_secidx_hi32(stored_at);
+        *lo = stored_at & TBL_SECIDX_U32;
+    } else if (sec == TBL_SECIDX_BY_STATUS) {
+        *hi = (unsigned long)code;
+        *lo = stored_at & TBL_SECIDX_U32;
+    } else {
+        *hi = tbl_secidx_hi32(bytes);
+        *lo = bytes & TBL_SECIDX_U32;
+    }
+}
+
+static int tbl_secidx_kcmp(unsigned long ah, unsigned long al, unsigned long bh, unsigned long bl)
+{
+    if (ah != bh) return (ah < bh) ? -1 : 1;
+    if (al != bl) return (al < bl) ? -1 : 1;
+    return 0;
+}
+
+static int tbl_secidx_ecmp(unsigned long ah, unsigned long al, const char *aj, size_t ajl,
+                           unsigned long bh, unsigned long bl, const char *bj, size_t bjl)
+{
+    int c = tbl_secidx_kcmp(ah, al, bh, bl);
+
+    if (c != 0) return c;
+    c = memcmp(aj, bj, (ajl < bjl) ? ajl : bjl);
+    if (c != 0) return c;
+    return (ajl < bjl) ? -1 : (ajl > bjl) ? 1 : 0;
+}
+
+static int tbl_secidx_seek(FILE *fp, unsigned long off)
+{
+    if (off > (unsigned long)LONG_MAX) return 0;
+    return (fseek(fp, (long)off, SEEK_SET) == 0) ? 1 : 0;
+}
+
+static int tbl_secidx_pread_ok(FILE *fp, unsigned long off, void *buf, size_t n)
+{
+    if (n == 0) return 1;
+    return (tbl_secidx_seek(fp, off) && fread(buf, 1, n, fp) == n) ? 1 : 0;
+}
+
+/* decimal unsigned long; *s moves past the digits. Returns 1/0. */
+static int tbl_secidx_ul(const char **s, unsigned long *out)
+{
+    const char *p = *s;
+    unsigned long v = 0UL;
+
+    if (*p < '0' || *p > '9') return 0;
+    while (*p >= '0' && *p <= '9') {
+        unsigned long d = (unsigned long)(*p - '0');
+        if (v > (ULONG_MAX - d) / 10UL) return 0;
+        v = v * 10UL + d;
+        p++;
+    }
+    *s = p;
+    *out = v;
+    return 1;
+}
+
+/* ---- memtable ---- */
+
+static void tbl_secidx_mem_free(tbl_secidx_mem_t *m)
+{
+    int s;
+
+    for (s = 0; s < TBL_SECIDX_NSEC; ++s) free(m->v[s]);
+    free(m->arena);
+    (void)memset(m, 0, sizeof(*m));
+}
+
+/* rows for one record; only < 0: every section */
+static int tbl_secidx_mem_add(tbl_secidx_mem_t *m, int only, unsigned long stored_at, int code,
+                              unsigned long bytes, const char *job, size_t jl)
+{
+    unsigned long joff;
+    int s;
+
+    if (m->alen + (unsigned long)jl > m->acap) {
+        unsigned long nc = m->acap ? m->acap * 2UL : 4096UL;
+        char *na;
+        while (nc < m->alen + (unsigned long)jl) nc *= 2UL;
+        na = (char *)realloc(m->arena, (size_t)nc);
+        if (!na) return 0;
+        m->arena = na;
+        m->acap = nc;
+    }
+    joff = m->alen;
+    (void)memcpy(m->arena + joff, job, jl);
+    m->alen += (unsigned long)jl;
+
+    for (s = 0; s < TBL_SECIDX_NSEC; ++s) {
+        tbl_secidx_row_t *r;
+
+        if (only >= 0 && s != only) continue;
+        if (m->n[s] == m->cap[s]) {
+            unsigned long nc = m->cap[s] ? m->cap[s] * 2UL : 256UL;
+            tbl_secidx_row_t *nv = (tbl_secidx_row_t *)realloc(m->v[s], (size_t)nc * sizeof(*nv));
+            if (!nv) return 0;
+            m->v[s] = nv;
+            m->cap[s] = nc;
+        }
+        r = &m->v[s][m->n[s]++];
+        tbl_secidx_keys(s, stored_at, code, bytes, &r->hi, &r->lo);
+        r->joff = joff;
+        r->jl = jl;
+        r->job = 0;
+    }
+    return 1;
+}
+
+static int tbl_secidx_cmp_row(const void *a, const void *b)
+{
+    const tbl_secidx_row_t *x = (const tbl_secidx_row_t *)a;
+    const tbl_secidx_row_t *y = (const tbl_secidx_row_t *)b;
+
+    return tbl_secidx_ecmp(x->hi, x->lo, x->job, x->jl, y->hi, y->lo, y->job, y->jl);
+}
+
+/* point rows at the (now stable) arena and sort every section */
+static void tbl_secidx_mem_sort(tbl_secidx_mem_t *m)
+{
+    unsigned long i;
+    int s;
+
+    for (s = 0; s < TBL_SECIDX_NSEC; ++s) {
+        for (i = 0UL; i < m->n[s]; ++i) m->v[s][i].job = m->arena + m->v[s][i].joff;
+        if (m->n[s] > 1UL) qsort(m->v[s], (size_t)m->n[s], sizeof(*m->v[s]), tbl_secidx_cmp_row);
+    }
+}
+
+/* "<stored_at> <code> <bytes> <jobid>\n" */
+static int tbl_secidx_parse_line(const char *line, unsigned long *stored_at, int *code,
+                                 unsigned long *bytes, const char **job, size_t *jl)
+{
+    const char *p = line;
+    unsigned long c;
+    size_t n;
+
+    if (!tbl_secidx_ul(&p, stored_at) || *p++ != ' ') return 0;
+    if (!tbl_secidx_ul(&p, &c) || c < 1UL || c > 3UL || *p++ != ' ') return 0;
+    if (!tbl_secidx_ul(&p, bytes) || *p++ != ' ') return 0;
+    n = strlen(p);
+    if (n == 0 || p[n - 1] != '\n') return 0; /* torn tail */
+    n--;
+    if (n == 0 || n > 255U) return 0;
+    *code = (int)c;
+    *job = p;
+    *jl = n;
+    return 1;
+}
+
+/* Every log line into m (only < 0: all sections). A missing log is empty. */
+static int tbl_secidx_mem_load(tbl_secidx_mem_t *m, const char *path, int only)
+{
+    char line[TBL_SECIDX_LINE_MAX];
+    FILE *fp;
+    int ok = 1;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+        unsigned long stored_at;
+        unsigned long bytes;
+        const char *job;
+        size_t jl;
+        int code;
+
+        if (!tbl_secidx_parse_line(line, &stored_at, &code, &bytes, &job, &jl)) continue;
+        if (!tbl_secidx_mem_add(m, only, stored_at, code, bytes, job, jl)) ok = 0;
+    }
+    fclose(fp);
+    if (ok) tbl_secidx_mem_sort(m);
+    return ok;
+}
+
+/* ---- manifest ---- */
+
+/* A missing manifest is empty. Returns 1 ok, 0 damaged. */
+static int tbl_secidx_man_read(const char *path, tbl_secidx_man_t *man)
+{
+    char line[128];
+    FILE *fp;
+    int ok = 1;
+
+    (void)memset(man, 0, sizeof(*man));
+    man->next = 1UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+        const char *p = line;
+
+        if (strncmp(p, "next=", 5) == 0) {
+            p += 5;
+            if (!tbl_secidx_ul(&p, &man->next) || *p != '\n') ok = 0;
+        } else if (strncmp(p, "run=", 4) == 0) {
+            p += 4;
+            if (man->nruns == TBL_SECIDX_MAX_RUNS ||
+                !tbl_secidx_ul(&p, &man->seq[man->nruns]) || *p++ != ' ' ||
+                !tbl_secidx_ul(&p, &man->n[man->nruns]) || *p != '\n') {
+                ok = 0;
+            } else {
+                man->nruns++;
+            }
+        } else {
+            ok = 0;
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+static int tbl_secidx_man_write(const tbl_secidx_paths_t *p, const tbl_secidx_man_t *man)
+{
+    char nbuf[32];
+    FILE *fp;
+    unsigned long i;
+    int ok;
+
+    fp = fopen(p->mantmp, "wb");
+    if (!fp) return 0;
+    ok = tbl_ul_to_dec_ok(man->next, nbuf, sizeof(nbuf)) && tbl_fputs_ok(fp, "next=") &&
+         tbl_fputs_ok(fp, nbuf) && tbl_fputs_ok(fp, "\n");
+    for (i = 0UL; ok && i < man->nruns; ++i) {
+        ok = tbl_ul_to_dec_ok(man->seq[i], nbuf, sizeof(nbuf)) && tbl_fputs_ok(fp, "run=") &&
+             tbl_fputs_ok(fp, nbuf) && tbl_fputs_ok(fp, " ") &&
+             tbl_ul_to_dec_ok(man->n[i], nbuf, sizeof(nbuf)) && tbl_fputs_ok(fp, nbuf) &&
+             tbl_fputs_ok(fp, "\n");
+    }
+    if (fclose(fp) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(p->mantmp, p->man, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(p->mantmp);
+    return ok;
+}
+
+/* ---- run writer ---- */
+
+static int tbl_secidx_w_open(tbl_secidx_w_t *w, const char *path)
+{
+    (void)memset(w, 0, sizeof(*w));
+    w->fp = fopen(path, "wb");
+    if (!w->fp) return 0;
+    w->ok = (fwrite("TBLSEC1\n", 1, 8, w->fp) == 8U) ? 1 : 0;
+    w->off = 8UL;
+    return w->ok;
+}
+
+static void tbl_secidx_w_section(tbl_secidx_w_t *w, int sec)
+{
+    w->sec = sec;
+    w->data_off[sec] = w->off;
+    w->data_end[sec] = w->off;
+    w->have_last = 0;
+}
+
+/* Append one entry to the open section; an exact repeat is dropped. */
+static void tbl_secidx_w_add(tbl_secidx_w_t *w, unsigned long hi, unsigned long lo,
+                             const char *job, size_t jl)
+{
+    unsigned char e[9];
+    int s = w->sec;
+
+    if (!w->ok) return;
+    if (w->have_last && tbl_secidx_ecmp(w->lh, w->ll, w->lj, w->ljl, hi, lo, job, jl) == 0) return;
+    if (jl == 0 || jl > 255U || w->off > TBL_SECIDX_U32 - TBL_SECIDX_ENT_MAX) {
+        w->ok = 0;
+        return;
+    }
+    if (w->n[s] % (unsigned long)TBL_SECIDX_BLOCK == 0UL) {
+        if (w->nb[s] == w->bcap[s]) {
+            unsigned long nc = w->bcap[s] ? w->bcap[s] * 2UL : 64UL;
+            unsigned long *nv = (unsigned long *)realloc(w->bidx[s], (size_t)nc * sizeof(*nv));
+            if (!nv) {
+                w->ok = 0;
+                return;
+            }
+            w->bidx[s] = nv;
+            w->bcap[s] = nc;
+        }
+        w->bidx[s][w->nb[s]++] = w->off;
+    }
+    tbl_secidx_put32(e, hi);
+    tbl_secidx_put32(e + 4, lo);
+    e[8] = (unsigned char)jl;
+    if (fwrite(e, 1, 9, w->fp) != 9U || fwrite(job, 1, jl, w->fp) != jl) {
+        w->ok = 0;
+        return;
+    }
+    w->off += 9UL + (unsigned long)jl;
+    w->data_end[s] = w->off;
+    w->n[s]++;
+    w->lh = hi;
+    w->ll = lo;
+    (void)memcpy(w->lj, job, jl);
+    w->ljl = jl;
+    w->have_last = 1;
+}
+
+/* Block offsets and footer; closes the file. Returns 1/0. */
+static int tbl_secidx_w_finish(tbl_secidx_w_t *w)
+{
+    unsigned char foot[TBL_SECIDX_FOOT];
+    unsigned long bidx_off[TBL_SECIDX_NSEC];
+    unsigned long i;
+    int ok = w->ok;
+    int s;
+
+    for (s = 0; ok && s < TBL_SECIDX_NSEC; ++s) {
+        bidx_off[s] = w->off;
+        if (w->nb[s] > (TBL_SECIDX_U32 - TBL_SECIDX_FOOT - w->off) / 4UL) {
+            ok = 0;
+            break;
+        }
+        for (i = 0UL; i < w->nb[s]; ++i) {
+            unsigned char b[4];
+            tbl_secidx_put32(b, w->bidx[s][i]);
+            if (fwrite(b, 1, 4, w->fp) != 4U) {
+                ok = 0;
+                break;
+            }
+        }
+        w->off += w->nb[s] * 4UL;
+    }
+    if (ok) {
+        (void)memset(foot, 0, sizeof(foot));
+        for (s = 0; s < TBL_SECIDX_NSEC; ++s) {
+            tbl_secidx_put32(foot + s * 16, w->n[s]);
+            tbl_secidx_put32(foot + s * 16 + 4, w->data_off[s]);
+            tbl_secidx_put32(foot + s * 16 + 8, w->data_end[s]);
+            tbl_secidx_put32(foot + s * 16 + 12, bidx_off[s]);
+        }
+        tbl_secidx_put32(foot + 48, tbl_secidx_fnv(foot, 48));
+        (void)memcpy(foot + 56, "TBLSECZ\n", 8);
+        if (fwrite(foot, 1, sizeof(foot), w->fp) != sizeof(foot)) ok = 0;
+    }
+    if (fclose(w->fp) != 0) ok = 0;
+    w->fp = 0;
+    for (s = 0; s < TBL_SECIDX_NSEC; ++s) free(w->bidx[s]);
+    return ok;
+}
+
+/* ---- run reader ---- */
+
+/* Returns 0 ok, 1 missing, 2 damaged. */
+static int tbl_secidx_run_open(tbl_secidx_run_t *r, const char *path)
+{
+    unsigned char foot[TBL_SECIDX_FOOT];
+    unsigned char magic[8];
+    unsigned long size;
+    long sz;
+    int s;
+
+    (void)memset(r, 0, sizeof(*r));
+    r->fp = fopen(path, "rb");
+    if (!r->fp) return 1;
+    (void)setvbuf(r->fp, 0, _IONBF, 0);
+    if (fseek(r->fp, 0L, SEEK_END) != 0 || (sz = ftell(r->fp)) < (long)(8UL + TBL_SECIDX_FOOT)) {
+        fclose(r->fp);
+        r->fp = 0;
+        return 2;
+    }
+    size = (unsigned long)sz;
+    if (!tbl_secidx_pread_ok(r->fp, 0UL, magic, 8) || memcmp(magic, "TBLSEC1\n", 8) != 0 ||
+        !tbl_secidx_pread_ok(r->fp, size - TBL_SECIDX_FOOT, foot, sizeof(foot)) ||
+        memcmp(foot + 56, "TBLSECZ\n", 8) != 0 || tbl_secidx_get32(foot + 48) != tbl_secidx_fnv(foot, 48)) {
+        fclose(r->fp);
+        r->fp = 0;
+        return 2;
+    }
+    for (s = 0; s < TBL_SECIDX_NSEC; ++s) {
+        unsigned long nb;
+
+        r->n[s] = tbl_secidx_get32(foot + s * 16);
+        r->data_off[s] = tbl_secidx_get32(foot + s * 16 + 4);
+        r->data_end[s] = tbl_secidx_get32(foot + s * 16 + 8);
+        r->bidx_off[s] = tbl_secidx_get32(foot + s * 16 + 12);
+        nb = (r->n[s] + (unsigned long)TBL_SECIDX_BLOCK - 1UL) / (unsigned long)TBL_SECIDX_BLOCK;
+        if (r->data_off[s] < 8UL || r->data_off[s] > r->data_end[s] || r->data_end[s] > r->bidx_off[s] ||
+            r->bidx_off[s] > size - TBL_SECIDX_FOOT || nb > (size - TBL_SECIDX_FOOT - r->bidx_off[s]) / 4UL) {
+            fclose(r->fp);
+            r->fp = 0;
+            return 2;
+        }
+    }
+    return 0;
+}
+
+static void tbl_secidx_run_close(tbl_secidx_run_t *r)
+{
+    if (r->fp) fclose(r->fp);
+    r->fp = 0;
+}
+
+/* first key of block b */
+static int tbl_secidx_block_first(const tbl_secidx_cur_t *c, unsigned long b,
+                                  unsigned long *hi, unsigned long *lo)
+{
+    const tbl_secidx_run_t *r = c->run;
+    unsigned char x[8];
+    unsigned long off;
+
+    if (!tbl_secidx_pread_ok(r->fp, r->bidx_off[c->sec] + b * 4UL, x, 4)) return 0;
+    off = tbl_secidx_get32(x);
+    if (off < r->data_off[c->sec] || off > r->data_end[c->sec] - 8UL ||
+        !tbl_secidx_pread_ok(r->fp, off, x, 8)) {
+        return 0;
+    }
+    *hi = tbl_secidx_get32(x);
+    *lo = tbl_secidx_get32(x + 4);
+    return 1;
+}
+
+/* decode block b into the cursor */
+static int tbl_secidx_block_load(tbl_secidx_cur_t *c, unsigned long b)
+{
+    const tbl_secidx_run_t *r = c->run;
+    unsigned char x[8];
+    unsigned long off;
+    unsigned long end;
+    unsigned long i;
+    int want;
+
+    if (!tbl_secidx_pread_ok(r->fp, r->bidx_off[c->sec] + b * 4UL, x, (b + 1UL < c->nb) ? 8U : 4U)) return 0;
+    off = tbl_secidx_get32(x);
+    end = (b + 1UL < c->nb) ? tbl_secidx_get32(x + 4) : r->data_end[c->sec];
+    if (off < r->data_off[c->sec] || end > r->data_end[c->sec] || off >= end ||
+        end - off > (unsigned long)sizeof(c->buf) || !tbl_secidx_pread_ok(r->fp, off, c->buf, (size_t)(end - off))) {
+        return 0;
+    }
+    want = (b + 1UL < c->nb) ? TBL_SECIDX_BLOCK
+                             : (int)(r->n[c->sec] - b * (unsigned long)TBL_SECIDX_BLOCK);
+    c->cnt = 0;
+    i = 0UL;
+    while (i < end - off) {
+        unsigned long jl;
+
+        if (c->cnt == TBL_SECIDX_BLOCK || end - off - i < 9UL) return 0;
+        jl = (unsigned long)c->buf[i + 8];
+        if (jl == 0UL || jl > end - off - i - 9UL) return 0;
+        c->hi[c->cnt] = tbl_secidx_get32(c->buf + i);
+        c->lo[c->cnt] = tbl_secidx_get32(c->buf + i + 4);
+        c->jo[c->cnt] = (unsigned int)(i + 9UL);
+        c->jl[c->cnt] = (unsigned char)jl;
+        c->cnt++;
+        i += 9UL + jl;
+    }
+    if (c->cnt != want) return 0;
+    c->bn = b;
+    return 1;
+}
+
+static void tbl_secidx_cur_get(const tbl_secidx_cur_t *c, unsigned long *hi, unsigned long *lo,
+                               const char **job, size_t *jl)
+{
+    if (c->run) {
+        *hi = c->hi[c->pos];
+        *lo = c->lo[c->pos];
+        *job = (const char *)c->buf + c->jo[c->pos];
+        *jl = (size_t)c->jl[c->pos];
+    } else {
+        const tbl_secidx_row_t *r = &c->rows[c->ri];
+        *hi = r->hi;
+        *lo = r->lo;
+        *job = r->job;
+        *jl = r->jl;
+    }
+}
+
+static void tbl_secidx_cur_next(tbl_secidx_cur_t *c, int desc)
+{
+    if (!c->valid) return;
+    if (!c->run) {
+        if (desc) {
+            if (c->ri == 0UL) c->valid = 0;
+            else c->ri--;
+        } else {
+            if (++c->ri >= c->nrows) c->valid = 0;
+        }
+        return;
+    }
+    if (desc) {
+        if (c->pos > 0) {
+            c->pos--;
+        } else if (c->bn == 0UL) {
+            c->valid = 0;
+        } else if (!tbl_secidx_block_load(c, c->bn - 1UL)) {
+            c->valid = 0;
+            c->bad = 1;
+        } else {
+            c->pos = c->cnt - 1;
+        }
+    } else {
+        if (c->pos + 1 < c->cnt) {
+            c->pos++;
+        } else if (c->bn + 1UL >= c->nb) {
+            c->valid = 0;
+        } else if (!tbl_secidx_block_load(c, c->bn + 1UL)) {
+            c->valid = 0;
+            c->bad = 1;
+        } else {
+            c->pos = 0;
+        }
+    }
+}
+
+/* Position on the first entry with key >= (kh, kl), or with desc on the
+   last entry with key <= (kh, kl). */
+static void tbl_secidx_cur_seek(tbl_secidx_cur_t *c, unsigned long kh, unsigned long kl, int desc)
+{
+    unsigned long lo = 0UL;
+    unsigned long hi;
+    unsigned long h;
+    unsigned long l;
+    const char *j;
+    size_t jl;
+
+    c->valid = 0;
+    if (!c->run) {
+        hi = c->nrows;
+        while (lo < hi) {
+            unsigned long mid = lo + (hi - lo) / 2UL;
+            int cmp = tbl_secidx_kcmp(c->rows[mid].hi, c->rows[mid].lo, kh, kl);
+            if (desc ? (cmp <= 0) : (cmp < 0)) lo = mid + 1UL;
+            else hi = mid;
+        }
+        if (desc) {
+            if (lo == 0UL) return;
+            c->ri = lo - 1UL;
+        } else {
+            if (lo >= c->nrows) return;
+            c->ri = lo;
+        }
+        c->valid = 1;
+        return;
+    }
+
+    /* first block whose first key is >= K (asc) or > K (desc) */
+    hi = c->nb;
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        int cmp;
+
+        if (!tbl_secidx_block_first(c, mid, &h, &l)) {
+            c->bad = 1;
+            return;
+        }
+        cmp = tbl_secidx_kcmp(h, l, kh, kl);
+        if (desc ? (cmp <= 0) : (cmp < 0)) lo = mid + 1UL;
+        else hi = mid;
+    }
+    if (desc && lo == 0UL) return;
+    if (c->nb == 0UL) return;
+    if (!tbl_secidx_block_load(c, (lo > 0UL) ? lo - 1UL : 0UL)) {
+        c->bad = 1;
+        return;
+    }
+    c->valid = 1;
+    c->pos = desc ? c->cnt - 1 : 0;
+    for (;;) {
+        int cmp;
+
+        tbl_secidx_cur_get(c, &h, &l, &j, &jl);
+        cmp = tbl_secidx_kcmp(h, l, kh, kl);
+        if (desc ? (cmp <= 0) : (cmp >= 0)) break;
+        tbl_secidx_cur_next(c, desc);
+        if (!c->valid) return;
+    }
+}
+
+static void tbl_secidx_cur_run(tbl_secidx_cur_t *c, const tbl_secidx_run_t *r, int sec)
+{
+    c->run = r;
+    c->sec = sec;
+    c->nb = (r->n[sec] + (unsigned long)TBL_SECIDX_BLOCK - 1UL) / (unsigned long)TBL_SECIDX_BLOCK;
+    c->valid = 0;
+    c->bad = 0;
+}
+
+static void tbl_secidx_cur_rows(tbl_secidx_cur_t *c, const tbl_secidx_row_t *rows, unsigned long n)
+{
+    c->run = 0;
+    c->rows = rows;
+    c->nrows = n;
+    c->valid = 0;
+    c->bad = 0;
+}
+
+/* Source with the smallest (desc: largest) current entry, or -1. */
+static int tbl_secidx_pick(tbl_secidx_cur_t **cs, int k, int desc)
+{
+    unsigned long bh = 0UL;
+    unsigned long bl = 0UL;
+    const char *bj = 0;
+    size_t bjl = 0;
+    int best = -1;
+    int i;
+
+    for (i = 0; i < k; ++i) {
+        unsigned long h;
+        unsigned long l;
+        const char *j;
+        size_t jl;
+        int cmp;
+
+        if (!cs[i]->valid) continue;
+        tbl_secidx_cur_get(cs[i], &h, &l, &j, &jl);
+        if (best >= 0) {
+            cmp = tbl_secidx_ecmp(h, l, j, jl, bh, bl, bj, bjl);
+            if (desc ? (cmp <= 0) : (cmp >= 0)) continue;
+        }
+        best = i;
+        bh = h;
+        bl = l;
+        bj = j;
+        bjl = jl;
+    }
+    return best;
+}
+
+/* ---- writers: flush, merge, build ---- */
+
+static int tbl_secidx_lock(const tbl_secidx_paths_t *p, tbl_fs_lock_t *lk, char *err, size_t errsz)
+{
+    if (tbl_fs_mkdir_p(p->dir) != 0) {
+        tbl_secidx_seterr(err, errsz, "cannot create index dir");
+        return 0;
+    }
+    if (tbl_fs_lock_open(lk, p->lock) != 0) {
+        tbl_secidx_seterr(err, errsz, "cannot open sec.lock");
+        return 0;
+    }
+    if (tbl_fs_lock_acquire(lk) != 0) {
+        (void)tbl_fs_lock_close(lk);
+        tbl_secidx_seterr(err, errsz, "cannot lock sec.lock");
+        return 0;
+    }
+    return 1;
+}
+
+/* memtable -> run <seq> (tmp + rename); *out_n: entries per section */
+static int tbl_secidx_write_mem(const tbl_secidx_paths_t *p, const tbl_secidx_mem_t *m,
+                                unsigned long seq, unsigned long *out_n)
+{
+    char tmp[1100];
+    char dst[1100];
+    tbl_secidx_w_t w;
+    unsigned long i;
+    int s;
+    int ok;
+
+    if (!tbl_secidx_run_path(p, seq, 1, tmp, sizeof(tmp)) || !tbl_secidx_run_path(p, seq, 0, dst, sizeof(dst))) return 0;
+    if (!tbl_secidx_w_open(&w, tmp)) {
+        if (w.fp) fclose(w.fp);
+        (void)tbl_fs_remove_file(tmp);
+        return 0;
+    }
+    for (s = 0; s < TBL_SECIDX_NSEC; ++s) {
+        tbl_secidx_w_section(&w, s);
+        for (i = 0UL; i < m->n[s]; ++i) tbl_secidx_w_add(&w, m->v[s][i].hi, m->v[s][i].lo, m->v[s][i].job, m->v[s][i].jl);
+    }
+    *out_n = w.n[0];
+    ok = tbl_secidx_w_finish(&w);
+    if (ok && tbl_fs_rename_atomic(tmp, dst, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(tmp);
+    return ok;
+}
+
+/* runs man[from..] -> one run <seq>; *out_n: entries per section */
+static int tbl_secidx_merge_runs(const tbl_secidx_paths_t *p, const tbl_secidx_man_t *man,
+                                 unsigned long from, unsigned long seq, unsigned long *out_n)
+{
+    tbl_secidx_run_t runs[TBL_SECIDX_MAX_RUNS];
+    tbl_secidx_cur_t *curs[TBL_SECIDX_MAX_RUNS];
+    char path[1100];
+    char dst[1100];
+    tbl_secidx_w_t w;
+    unsigned long k = man->nruns - from;
+    unsigned long i;
+    int s;
+    int ok = 1;
+
+    (void)memset(&w, 0, sizeof(w));
+    for (i = 0UL; i < k; ++i) {
+        curs[i] = 0;
+        runs[i].fp = 0;
+    }
+    for (i = 0UL; ok && i < k; ++i) {
+        curs[i] = (tbl_secidx_cur_t *)malloc(sizeof(tbl_secidx_cur_t));
+        if (!curs[i] || !tbl_secidx_run_path(p, man->seq[from + i], 0, path, sizeof(path)) ||
+            tbl_secidx_run_open(&runs[i], path) != 0) {
+            ok = 0;
+        }
+    }
+    if (ok && (!tbl_secidx_run_path(p, seq, 1, path, sizeof(path)) ||
+               !tbl_secidx_run_path(p, seq, 0, dst, sizeof(dst)) || !tbl_secidx_w_open(&w, path))) {
+        if (w.fp) fclose(w.fp);
+        ok = 0;
+    }
+    if (ok) {
+        for (s = 0; s < TBL_SECIDX_NSEC; ++s) {
+            tbl_secidx_w_section(&w, s);
+            for (i = 0UL; i < k; ++i) {
+                tbl_secidx_cur_run(curs[i], &runs[i], s);
+                tbl_secidx_cur_seek(curs[i], 0UL, 0UL, 0);
+            }
+            for (;;) {
+                unsigned long h;
+                unsigned long l;
+                const char *j;
+                size_t jl;
+                int b = tbl_secidx_pick(curs, (int)k, 0);
+
+                if (b < 0) break;
+                tbl_secidx_cur_get(curs[b], &h, &l, &j, &jl);
+                tbl_secidx_w_add(&w, h, l, j, jl);
+                tbl_secidx_cur_next(curs[b], 0);
+            }
+            for (i = 0UL; i < k; ++i) {
+                if (curs[i]->bad) w.ok = 0;
+            }
+        }
+        *out_n = w.n[0];
+        ok = tbl_secidx_w_finish(&w);
+        if (ok && tbl_fs_rename_atomic(path, dst, 1) != 0) ok = 0;
+        if (!ok) (void)tbl_fs_remove_file(path);
+    }
+    for (i = 0UL; i < k; ++i) {
+        if (runs[i].fp) tbl_secidx_run_close(&runs[i]);
+        free(curs[i]);
+    }
+    return ok;
+}
+
+/* log -> new run, then merge while the newest run is at least as large as
+   the one before it (or the manifest is full). Caller holds the lock. */
+static int tbl_secidx_flush(const tbl_secidx_paths_t *p, char *err, size_t errsz)
+{
+    tbl_secidx_mem_t m;
+    tbl_secidx_man_t man;
+    unsigned long gone[2UL * TBL_SECIDX_MAX_RUNS];
+    unsigned long ngone = 0UL;
+    unsigned long n;
+    unsigned long i;
+    int ok;
+
+    (void)memset(&m, 0, sizeof(m));
+    if (!tbl_secidx_man_read(p->man, &man)) {
+        tbl_secidx_seterr(err, errsz, "sec.manifest damaged (run tablinum index --rebuild)");
+        return 0;
+    }
+    ok = tbl_secidx_mem_load(&m, p->log, -1);
+    if (ok && m.n[0] > 0UL) {
+        ok = tbl_secidx_write_mem(p, &m, man.next, &n);
+        if (ok) {
+            if (man.nruns == TBL_SECIDX_MAX_RUNS) ok = 0;
+            else {
+                man.seq[man.nruns] = man.next++;
+                man.n[man.nruns++] = n;
+            }
+        }
+        while (ok && man.nruns >= 2UL &&
+               (man.n[man.nruns - 1UL] >= man.n[man.nruns - 2UL] || man.nruns + 1UL >= TBL_SECIDX_MAX_RUNS)) {
+            ok = tbl_secidx_merge_runs(p, &man, man.nruns - 2UL, man.next, &n);
+            if (!ok) break;
+            gone[ngone++] = man.seq[man.nruns - 2UL];
+            gone[ngone++] = man.seq[man.nruns - 1UL];
+            man.nruns--;
+            man.seq[man.nruns - 1UL] = man.next++;
+            man.n[man.nruns - 1UL] = n;
+        }
+        if (ok) ok = tbl_secidx_man_write(p, &man);
+    }
+    tbl_secidx_mem_free(&m);
+    if (!ok) {
+        tbl_secidx_seterr(err, errsz, "cannot flush sec.log");
+        return 0;
+    }
+    (void)tbl_fs_write_file(p->log, "", 0);
+    for (i = 0UL; i < ngone; ++i) {
+        char path[1100];
+        if (tbl_secidx_run_path(p, gone[i], 0, path, sizeof(path))) (void)tbl_fs_remove_file(path);
+    }
+    return 1;
+}
+
+int tbl_secidx_put(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz)
+{
+    tbl_secidx_paths_t p;
+    tbl_fs_afile_t af;
+    tbl_fs_lock_t lk;
+    char line[TBL_SECIDX_LINE_MAX];
+    char nbuf[32];
+    unsigned long size = 0UL;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !rec || !tbl_record_is_safe_id(rec->job) || strlen(rec->job) > 255U) {
+        tbl_secidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_secidx_paths(repo_root, &p)) {
+        tbl_secidx_seterr(err, errsz, "secondary index path too long");
+        return 2;
+    }
+    (void)tbl_ul_to_dec_ok(rec->stored_at, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(line, nbuf, sizeof(line));
+    (void)tbl_strlcat(line, " ", sizeof(line));
+    (void)tbl_ul_to_dec_ok((unsigned long)tbl_secidx_code(rec->status), nbuf, sizeof(nbuf));
+    (void)tbl_strlcat(line, nbuf, sizeof(line));
+    (void)tbl_strlcat(line, " ", sizeof(line));
+    (void)tbl_ul_to_dec_ok(rec->bytes, nbuf, sizeof(nbuf));
+    (void)tbl_strlcat(line, nbuf, sizeof(line));
+    (void)tbl_strlcat(line, " ", sizeof(line));
+    (void)tbl_strlcat(line, rec->job, sizeof(line));
+    (void)tbl_strlcat(line, "\n", sizeof(line));
+
+    if (!tbl_secidx_lock(&p, &lk, err, errsz)) return 2;
+    rc = 0;
+    if (tbl_fs_afile_open(&af, p.log) != 0) {
+        tbl_secidx_seterr(err, errsz, "cannot open sec.log");
+        rc = 2;
+    } else {
+        if (tbl_fs_afile_write(&af, line, strlen(line)) != 0 || tbl_fs_afile_size(&af, &size) != 0) {
+            tbl_secidx_seterr(err, errsz, "cannot append sec.log");
+            rc = 2;
+        }
+        if (tbl_fs_afile_close(&af) != 0 && rc == 0) {
+            tbl_secidx_seterr(err, errsz, "cannot append sec.log");
+            rc = 2;
+        }
+    }
+    if (rc == 0 && size > TBL_SECIDX_TAIL_MAX && !tbl_secidx_flush(&p, err, errsz)) rc = 2;
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+/* ---- scan ---- */
+
+/* key range of q in its own order; 0 if empty */
+static int tbl_secidx_range(const tbl_secidx_q_t *q, unsigned long *sh, unsigned long *sl,
+                            unsigned long *eh, unsigned long *el)
+{
+    unsigned long a = 0UL;
+    unsigned long b = ULONG_MAX;
+
+    if (q->by == TBL_SECIDX_BY_BYTES) {
+        if (q->min_set) a = q->min_bytes;
+        if (q->max_set) b = q->max_bytes;
+    } else {
+        if (q->since_set) a = q->since;
+        if (q->until_set) {
+            if (q->until == 0UL) return 0;
+            b = q->until - 1UL;
+        }
+    }
+    if (a > b) return 0;
+    if (q->by == TBL_SECIDX_BY_STATUS) {
+        if (tbl_secidx_hi32(a) != 0UL) return 0;
+        if (tbl_secidx_hi32(b) != 0UL) b = TBL_SECIDX_U32;
+        *sh = (unsigned long)tbl_secidx_code(q->status);
+        *eh = *sh;
+        *sl = a;
+        *el = b;
+    } else {
+        *sh = tbl_secidx_hi32(a);
+        *sl = a & TBL_SECIDX_U32;
+        *eh = tbl_secidx_hi32(b);
+        *el = b & TBL_SECIDX_U32;
+    }
+    return 1;
+}
+
+static int tbl_secidx_match_ok(const tbl_secidx_q_t *q, const tbl_record_t *rec)
+{
+    if (q->status && !tbl_streq(rec->status, q->status)) return 0;
+    if (q->since_set && rec->stored_at < q->since) return 0;
+    if (q->until_set && rec->stored_at >= q->until) return 0;
+    if (q->min_set && rec->bytes < q->min_bytes) return 0;
+    if (q->max_set && rec->bytes > q->max_bytes) return 0;
+    return 1;
+}
+
+int tbl_secidx_scan(const char *repo_root, const tbl_secidx_q_t *q, tbl_secidx_rec_fn fn, void *ud,
+                    unsigned long *out_hits, char *err, size_t errsz)
+{
+    tbl_secidx_paths_t p;
+    tbl_secidx_mem_t m;
+    tbl_secidx_man_t man;
+    tbl_secidx_run_t runs[TBL_SECIDX_MAX_RUNS];
+    tbl_secidx_cur_t *curs[TBL_SECIDX_MAX_RUNS + 1UL];
+    tbl_recidx_t rx;
+    unsigned long sh;
+    unsigned long sl;
+    unsigned long eh;
+    unsigned long el;
+    unsigned long nopen = 0UL;
+    unsigned long hits = 0UL;
+    unsigned long i;
+    char last[256];
+    size_t lastl = 0;
+    unsigned long lh = 0UL;
+    unsigned long ll = 0UL;
+    int have_last = 0;
+    int have_rx;
+    int attempt;
+    int rc = 0;
+    int k;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_hits) *out_hits = 0UL;
+    if (!repo_root || !repo_root[0] || !q || !fn || q->by < TBL_SECIDX_BY_TIME || q->by > TBL_SECIDX_BY_BYTES ||
+        (q->by == TBL_SECIDX_BY_STATUS && (!q->status || !q->status[0]))) {
+        tbl_secidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_secidx_paths(repo_root, &p)) {
+        tbl_secidx_seterr(err, errsz, "secondary index path too long");
+        return 2;
+    }
+    if (!tbl_secidx_range(q, &sh, &sl, &eh, &el)) return 0;
+
+    /* log before manifest: a concurrent flush then shows up at least once */
+    (void)memset(&m, 0, sizeof(m));
+    for (attempt = 0; attempt < 3; ++attempt) {
+        int st = 0;
+
+        tbl_secidx_mem_free(&m);
+        if (!tbl_secidx_mem_load(&m, p.log, q->by)) {
+            tbl_secidx_seterr(err, errsz, "cannot read sec.log");
+            return 2;
+        }
+        if (!tbl_secidx_man_read(p.man, &man)) {
+            tbl_secidx_mem_free(&m);
+            tbl_secidx_seterr(err, errsz, "sec.manifest damaged (run tablinum index --rebuild)");
+            return 2;
+        }
+        for (nopen = 0UL; nopen < man.nruns; ++nopen) {
+            char path[1100];
+
+            st = tbl_secidx_run_path(&p, man.seq[nopen], 0, path, sizeof(path)) ? tbl_secidx_run_open(&runs[nopen], path) : 2;
+            if (st != 0) break;
+        }
+        if (st == 0) break;
+        for (i = 0UL; i < nopen; ++i) tbl_secidx_run_close(&runs[i]);
+        nopen = 0UL;
+        if (st == 2) {
+            tbl_secidx_mem_free(&m);
+            tbl_secidx_seterr(err, errsz, "sec run damaged (run tablinum index --rebuild)");
+            return 2;
+        }
+        /* a run merged away under us: read the new manifest */
+    }
+    if (nopen != man.nruns) {
+        tbl_secidx_mem_free(&m);
+        tbl_secidx_seterr(err, errsz, "sec runs keep changing");
+        return 2;
+    }
+
+    k = 0;
+    for (i = 0UL; i <= nopen; ++i) {
+        curs[i] = (tbl_secidx_cur_t *)malloc(sizeof(tbl_secidx_cur_t));
+        if (!curs[i]) rc = 2;
+        else k++;
+    }
+    for (i = 0UL; rc == 0 && i <= nopen; ++i) {
+        if (i < nopen) tbl_secidx_cur_run(curs[i], &runs[i], q->by);
+        else tbl_secidx_cur_rows(curs[i], m.v[q->by], m.n[q->by]);
+        if (q->desc) tbl_secidx_cur_seek(curs[i], eh, el, 1);
+        else tbl_secidx_cur_seek(curs[i], sh, sl, 0);
+    }
+
+    have_rx = (rc == 0 && tbl_recidx_open(&rx, repo_root, 0, 0) == 0) ? 1 : 0;
+    while (rc == 0) {
+        tbl_record_t rec;
+        unsigned long h;
+        unsigned long l;
+        unsigned long rh;
+        unsigned long rl;
+        const char *j;
+        size_t jl;
+        char job[256];
+        int b = tbl_secidx_pick(curs, k, q->desc);
+
+        if (b < 0) break;
+        tbl_secidx_cur_get(curs[b], &h, &l, &j, &jl);
+        if (q->desc ? (tbl_secidx_kcmp(h, l, sh, sl) < 0) : (tbl_secidx_kcmp(h, l, eh, el) > 0)) break;
+        if (have_last && tbl_secidx_ecmp(h, l, j, jl, lh, ll, last, lastl) == 0) {
+            tbl_secidx_cur_next(curs[b], q->desc);
+            continue;
+        }
+        lh = h;
+        ll = l;
+        (void)memcpy(last, j, jl);
+        lastl = jl;
+        have_last = 1;
+        (void)memcpy(job, j, jl);
+        job[jl] = '\0';
+        tbl_secidx_cur_next(curs[b], q->desc);
+
+        /* an entry counts only while the record still has its key */
+        if ((!have_rx || tbl_recidx_lookup(&rx, job, &rec) != 0) &&
+            tbl_record_read_repo(repo_root, job, &rec, 0, 0) != 0) {
+            continue;
+        }
+        tbl_secidx_keys(q->by, rec.stored_at, tbl_secidx_code(rec.status), rec.bytes, &rh, &rl);
+        if (tbl_secidx_kcmp(rh, rl, h, l) != 0 || !tbl_streq(rec.job, job) || !tbl_secidx_match_ok(q, &rec)) continue;
+        hits++;
+        if (fn(ud, &rec) != 0) break;
+        if (q->limit && hits >= q->limit) break;
+    }
+    for (i = 0UL; i <= nopen; ++i) {
+        if (curs[i] && curs[i]->bad && rc == 0) {
+            tbl_secidx_seterr(err, errsz, "sec run damaged (run tablinum index --rebuild)");
+            rc = 2;
+        }
+    }
+    if (rc == 2 && err && errsz && !err[0]) tbl_secidx_seterr(err, errsz, "out of memory");
+    if (have_rx) tbl_recidx_close(&rx);
+    for (i = 0UL; i <= nopen; ++i) free(curs[i]);
+    for (i = 0UL; i < nopen; ++i) tbl_secidx_run_close(&runs[i]);
+    tbl_secidx_mem_free(&m);
+    if (out_hits) *out_hits = hits;
+    return rc;
+}
+
+/* ---- rebuild ---- */
+
+typedef struct tbl_secidx_build_s {
+    tbl_secidx_mem_t *m;
+    int failed;
+} tbl_secidx_build_t;
+
+static int tbl_secidx_build_cb(void *ud, const tbl_record_t *rec)
+{
+    tbl_secidx_build_t *b = (tbl_secidx_build_t *)ud;
+
+    if (!tbl_secidx_mem_add(b->m, -1, rec->stored_at, tbl_secidx_code(rec->status), rec->bytes, rec->job,
+                            strlen(rec->job))) {
+        b->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+typedef struct tbl_secidx_sweep_s {
+    const char *keep;
+} tbl_secidx_sweep_t;
+
+/* drop every sec.*.run / sec.*.run.tmp but the one kept */
+static int tbl_secidx_sweep_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_secidx_sweep_t *sw = (tbl_secidx_sweep_t *)ud;
+
+    if (is_dir || strncmp(name, "sec.", 4) != 0) return 0;
+    if (!tbl_str_ends_with(name, ".run") && !tbl_str_ends_with(name, ".run.tmp")) return 0;
+    if (sw->keep && tbl_streq(full, sw->keep)) return 0;
+    (void)tbl_fs_remove_file(full);
+    return 0;
+}
+
+int tbl_secidx_build(const char *repo_root, unsigned long *out_entries, char *err, size_t errsz)
+{
+    tbl_secidx_paths_t p;
+    tbl_secidx_mem_t m;
+    tbl_secidx_man_t man;
+    tbl_secidx_build_t b;
+    tbl_secidx_sweep_t sw;
+    tbl_fs_lock_t lk;
+    char keep[1100];
+    unsigned long n = 0UL;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_entries) *out_entries = 0UL;
+    if (!repo_root || !repo_root[0]) {
+        tbl_secidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_secidx_paths(repo_root, &p)) {
+        tbl_secidx_seterr(err, errsz, "secondary index path too long");
+        return 2;
+    }
+    if (!tbl_secidx_lock(&p, &lk, err, errsz)) return 2;
+
+    rc = 0;
+    (void)memset(&m, 0, sizeof(m));
+    b.m = &m;
+    b.failed = 0;
+    if (tbl_record_each(repo_root, tbl_secidx_build_cb, &b, 0, 0) != 0) {
+        tbl_secidx_seterr(err, errsz, "cannot read records");
+        rc = 2;
+    }
+    if (rc == 0 && b.failed) {
+        tbl_secidx_seterr(err, errsz, "out of memory");
+        rc = 2;
+    }
+    if (rc == 0) {
+        /* a damaged manifest only loses its run numbering */
+        if (!tbl_secidx_man_read(p.man, &man)) {
+            (void)memset(&man, 0, sizeof(man));
+            man.next = 1UL;
+        }
+        man.nruns = 0UL;
+        tbl_secidx_mem_sort(&m);
+        if (!tbl_secidx_write_mem(&p, &m, man.next, &n) ||
+            !tbl_secidx_run_path(&p, man.next, 0, keep, sizeof(keep))) {
+            tbl_secidx_seterr(err, errsz, "cannot write sec run");
+            rc = 2;
+        } else {
+            man.seq[0] = man.next++;
+            man.n[0] = n;
+            man.nruns = 1UL;
+            if (!tbl_secidx_man_write(&p, &man)) {
+                tbl_secidx_seterr(err, errsz, "cannot write sec.manifest");
+                rc = 2;
+            }
+        }
+    }
+    if (rc == 0) {
+        (void)tbl_fs_write_file(p.log, "", 0);
+        sw.keep = keep;
+        (void)tbl_fs_list_dir(p.dir, tbl_secidx_sweep_cb, &sw);
+        if (out_entries) *out_entries = n;
+    }
+    tbl_secidx_mem_free(&m);
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+#endif /* TBL_SECIDX_IMPLEMENTATION */
+
+#endif /* TBL_CORE_SECIDX_H */
@@ -9,6 +9,7 @@ typedef struct tbl_spool_s {
     char claim[1024];
     char out[1024];
     char fail[1024];
+    int date_buckets; /* 1: commit into out|fail/YYYY/MM/DD/ (UTC), 0: flat (default) */
 } tbl_spool_t;
 
 enum {
@@ -33,13 +34,26 @@ int tbl_spool_claim_next_dir(tbl_spool_t *sp, char *out_name, size_t out_namesz,
 int tbl_spool_commit_out(tbl_spool_t *sp, const char *name, char *err, size_t errsz);
 int tbl_spool_commit_fail(tbl_spool_t *sp, const char *name, char *err, size_t errsz);
 
+/* Retention sweep over out/ and fail/ (both layouts):
+   - date buckets YYYY/MM/DD expire as a whole once the bucket day ended at or
+     before cutoff (seconds since epoch, UTC); emptied month/year dirs are removed.
+     Only a YYYY dir holding nothing but MM/DD dirs is a bucket.
+   - flat entries expire by mtime < cutoff (one stat per job, none per file)
+   Job trees are deleted by nthreads workers (0 = cpu count) via tbl_fs_rm_tree.
+   out_removed counts removed jobs. Returns OK or EIO (err names the first failure). */
+int tbl_spool_prune(tbl_spool_t *sp, unsigned long cutoff, unsigned long nthreads,
+                    unsigned long *out_removed, char *err, size_t errsz);
+
 #ifdef TBL_SPOOL_IMPLEMENTATION
 
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "core/safe.h"
 #include "core/path.h"
 #include "os/fs.h"
+#include "os/thread.h"
 
 static void tbl_spool_seterr(char *err, size_t errsz, const char *msg)
 {
@@ -170,17 +184,61 @@ int tbl_spool_claim_next_dir(tbl_spool_t *sp, char *out_name, size_t out_namesz,
     return tbl_spool_claim_next_impl(sp, 1, out_name, out_namesz, err, errsz);
 }
 
+static void tbl_spool_put2(char *p, int v)
+{
+    p[0] = (char)('0' + (v / 10) % 10);
+    p[1] = (char)('0' + v % 10);
+}
+
+/* out|fail/YYYY/MM/DD for "now" (UTC); created if missing. */
+static int tbl_spool_bucket_dir(const char *base, char *out, size_t outsz,
+                                char *err, size_t errsz)
+{
+    time_t now;
+    struct tm *tmv;
+    char rel[16];
+    int year;
+
+    now = time(NULL);
+    tmv = gmtime(&now);
+    if (!tmv) { tbl_spool_seterr(err, errsz, "gmtime failed"); return TBL_SPOOL_EIO; }
+
+    year = tmv->tm_year + 1900;
+    if (year < 1970 || year > 9999) { tbl_spool_seterr(err, errsz, "clock out of range"); return TBL_SPOOL_EIO; }
+
+    tbl_spool_put2(rel, year / 100);
+    tbl_spool_put2(rel + 2, year % 100);
+    rel[4] = '/';
+    tbl_spool_put2(rel + 5, tmv->tm_mon + 1);
+    rel[7] = '/';
+    tbl_spool_put2(rel + 8, tmv->tm_mday);
+    rel[10] = '\0';
+
+    if (!tbl_path_join2(out, outsz, base, rel)) { tbl_spool_seterr(err, errsz, "path too long"); return TBL_SPOOL_EINVAL; }
+
+    if (tbl_fs_mkdir_p(out) != 0) { tbl_spool_seterr(err, errsz, "cannot create date bucket"); return TBL_SPOOL_EIO; }
+    return TBL_SPOOL_OK;
+}
+
 static int tbl_spool_move_claimed(tbl_spool_t *sp, const char *name, const char *dst_dir,
                                   char *err, size_t errsz)
 {
     char src[1024];
     char dst[1024];
+    char bucket[1024];
+    int rc;
 
     if (!sp || !name || !name[0] || !dst_dir) {
         tbl_spool_seterr(err, errsz, "invalid args");
         return TBL_SPOOL_EINVAL;
     }
 
+    if (sp->date_buckets) {
+        rc = tbl_spool_bucket_dir(dst_dir, bucket, sizeof(bucket), err, errsz);
+        if (rc != TBL_SPOOL_OK) return rc;
+        dst_dir = bucket;
+    }
+
     if (!tbl_path_join2(src, sizeof(src), sp->claim, name)) { tbl_spool_seterr(err, errsz, "path too long"); return TBL_SPOOL_EINVAL; }
     if (!tbl_path_join2(dst, sizeof(dst), dst_dir, name))   { tbl_spool_seterr(err, errsz, "path too long"); return TBL_SPOOL_EINVAL; }
 
@@ -195,14 +253,354 @@ static int tbl_spool_move_claimed(tbl_spool_t *sp, const char *name, const char
 int tbl_spool_commit_out(tbl_spool_t *sp, const char *name, char *err, size_t errsz)
 {
     if (err && errsz) err[0] = '\0';
+    if (!sp) { tbl_spool_seterr(err, errsz, "invalid args"); return TBL_SPOOL_EINVAL; }
     return tbl_spool_move_claimed(sp, name, sp->out, err, errsz);
 }
 
 int tbl_spool_commit_fail(tbl_spool_t *sp, const char *name, char *err, size_t errsz)
 {
     if (err && errsz) err[0] = '\0';
+    if (!sp) { tbl_spool_seterr(err, errsz, "invalid args"); return TBL_SPOOL_EINVAL; }
     return tbl_spool_move_claimed(sp, name, sp->fail, err, errsz);
 }
 
+/* ---- retention sweep ---- */
+
+/* Path list backed by one string heap (jobs can number in the 100k range). */
+typedef struct tbl_spool_plist_s {
+    char *heap;
+    size_t heap_len;
+    size_t heap_cap;
+    size_t *off;
+    unsigned char *is_dir;
+    unsigned long n;
+    unsigned long cap;
+} tbl_spool_plist_t;
+
+static void tbl_spool_plist_free(tbl_spool_plist_t *l)
+{
+    if (!l) return;
+    free(l->heap);
+    free(l->off);
+    free(l->is_dir);
+    (void)memset(l, 0, sizeof(*l));
+}
+
+static int tbl_spool_plist_add_ok(tbl_spool_plist_t *l, const char *path, int is_dir)
+{
+    size_t len;
+
+    len = strlen(path) + 1U;
+
+    if (l->heap_len + len > l->heap_cap) {
+        size_t ncap;
+        char *nh;
+
+        ncap = l->heap_cap ? l->heap_cap : 4096U;
+        while (ncap < l->heap_len + len) {
+            if (ncap > ((size_t)-1) / 2U) return 0;
+            ncap *= 2U;
+        }
+        nh = (char *)realloc(l->heap, ncap);
+        if (!nh) return 0;
+        l->heap = nh;
+        l->heap_cap = ncap;
+    }
+
+    if (l->n == l->cap) {
+        unsigned long ncap;
+        size_t *no;
+        unsigned char *nd;
+
+        ncap = l->cap ? l->cap * 2UL : 64UL;
+        if (ncap < l->cap || ncap > (unsigned long)(((size_t)-1) / sizeof(size_t))) return 0;
+        no = (size_t *)realloc(l->off, (size_t)ncap * sizeof(size_t));
+        if (!no) return 0;
+        l->off = no;
+        nd = (unsigned char *)realloc(l->is_dir, (size_t)ncap);
+        if (!nd) return 0;
+        l->is_dir = nd;
+        l->cap = ncap;
+    }
+
+    (void)memcpy(l->heap + l->heap_len, path, len);
+    l->off[l->n] = l->heap_len;
+    l->is_dir[l->n] = (unsigned char)(is_dir ? 1 : 0);
+    l->heap_len += len;
+    l->n++;
+    return 1;
+}
+
+static int tbl_spool_digits_n(const char *s, size_t n, unsigned long *out)
+{
+    size_t i;
+    unsigned long v;
+
+    if (!s || strlen(s) != n) return 0;
+    v = 0UL;
+    for (i = 0; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9') return 0;
+        v = v * 10UL + (unsigned long)(s[i] - '0');
+    }
+    *out = v;
+    return 1;
+}
+
+/* Days since 1970-01-01 for a proleptic Gregorian date (y >= 1970). */
+static unsigned long tbl_spool_days_from_civil(unsigned long y, unsigned long m, unsigned long d)
+{
+    unsigned long era, yoe, doy, doe;
+
+    if (m <= 2UL) y -= 1UL;
+    era = y / 400UL;
+    yoe = y - era * 400UL;
+    doy = (153UL * (m > 2UL ? m - 3UL : m + 9UL) + 2UL) / 5UL + d - 1UL;
+    doe = yoe * 365UL + yoe / 4UL - yoe / 100UL + doy;
+    return era * 146097UL + doe - 719468UL;
+}
+
+typedef struct tbl_spool_scan_s {
+    tbl_spool_plist_t *jobs;
+    tbl_spool_plist_t *dirs; /* emptied bucket dirs, children before parents */
+    unsigned long cutoff;
+    unsigned long year;
+    unsigned long month;
+    int all_expired;         /* every child of the current bucket level expires */
+    int oom;
+} tbl_spool_scan_t;
+
+static int tbl_spool_scan_day_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_spool_scan_t *sc = (tbl_spool_scan_t *)ud;
+    (void)name;
+    if (!tbl_spool_plist_add_ok(sc->jobs, full, is_dir)) { sc->oom = 1; return 1; }
+    return 0;
+}
+
+static int tbl_spool_scan_month_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_spool_scan_t *sc = (tbl_spool_scan_t *)ud;
+    unsigned long d, end;
+
+    if (!is_dir || !tbl_spool_digits_n(name, 2U, &d) || d < 1UL || d > 31UL) {
+        sc->all_expired = 0;
+        return 0;
+    }
+
+    /* bucket covers [d 00:00, d+1 00:00) UTC */
+    end = (tbl_spool_days_from_civil(sc->year, sc->month, d) + 1UL) * 86400UL;
+    if (end > sc->cutoff) {
+        sc->all_expired = 0;
+        return 0;
+    }
+
+    if (tbl_fs_list_dir(full, tbl_spool_scan_day_cb, sc) != 0) {
+        sc->all_expired = 0;
+        return sc->oom ? 1 : 0;
+    }
+    if (sc->oom) return 1;
+    if (!tbl_spool_plist_add_ok(sc->dirs, full, 1)) { sc->oom = 1; return 1; }
+    return 0;
+}
+
+static int tbl_spool_scan_year_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_spool_scan_t *sc = (tbl_spool_scan_t *)ud;
+    unsigned long m;
+    int year_all;
+
+    if (!is_dir || !tbl_spool_digits_n(name, 2U, &m) || m < 1UL || m > 12UL) {
+        sc->all_expired = 0;
+        return 0;
+    }
+
+    year_all = sc->all_expired;
+    sc->month = m;
+    sc->all_expired = 1;
+
+    if (tbl_fs_list_dir(full, tbl_spool_scan_month_cb, sc) != 0) sc->all_expired = 0;
+    if (sc->oom) return 1;
+
+    if (sc->all_expired) {
+        if (!tbl_spool_plist_add_ok(sc->dirs, full, 1)) { sc->oom = 1; return 1; }
+    } else {
+        year_all = 0;
+    }
+    sc->all_expired = year_all;
+    return 0;
+}
+
+typedef struct tbl_spool_layout_s {
+    unsigned long n;         /* bucket children seen */
+    int bad;                 /* something that is not a bucket */
+} tbl_spool_layout_t;
+
+static int tbl_spool_layout_day_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_spool_layout_t *lay = (tbl_spool_layout_t *)ud;
+    unsigned long d;
+
+    (void)full;
+    if (!is_dir || !tbl_spool_digits_n(name, 2U, &d) || d < 1UL || d > 31UL) { lay->bad = 1; return 1; }
+    lay->n++;
+    return 0;
+}
+
+static int tbl_spool_layout_month_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_spool_layout_t *lay = (tbl_spool_layout_t *)ud;
+    tbl_spool_layout_t days;
+    unsigned long m;
+
+    if (!is_dir || !tbl_spool_digits_n(name, 2U, &m) || m < 1UL || m > 12UL) { lay->bad = 1; return 1; }
+    (void)memset(&days, 0, sizeof(days));
+    if (tbl_fs_list_dir(full, tbl_spool_layout_day_cb, &days) != 0 || days.bad) { lay->bad = 1; return 1; }
+    lay->n++;
+    return 0;
+}
+
+/* A YYYY dir is a bucket only if it holds MM/DD dirs and nothing else;
+   a flat job that happens to be named like a year is aged by mtime. */
+static int tbl_spool_is_year_bucket_ok(const char *full)
+{
+    tbl_spool_layout_t lay;
+
+    (void)memset(&lay, 0, sizeof(lay));
+    if (tbl_fs_list_dir(full, tbl_spool_layout_month_cb, &lay) != 0) return 0;
+    return !lay.bad && lay.n > 0UL;
+}
+
+static int tbl_spool_scan_top_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    tbl_spool_scan_t *sc = (tbl_spool_scan_t *)ud;
+    unsigned long y;
+    unsigned long mt;
+
+    if (is_dir && tbl_spool_digits_n(name, 4U, &y) && y >= 1970UL && tbl_spool_is_year_bucket_ok(full)) {
+        sc->year = y;
+        sc->all_expired = 1;
+        if (tbl_fs_list_dir(full, tbl_spool_scan_year_cb, sc) != 0) sc->all_expired = 0;
+        if (sc->oom) return 1;
+        if (sc->all_expired) {
+            if (!tbl_spool_plist_add_ok(sc->dirs, full, 1)) { sc->oom = 1; return 1; }
+        }
+        return 0;
+    }
+
+    /* flat layout: age by mtime */
+    if (tbl_fs_mtime(full, &mt) != 0) return 0;
+    if (mt >= sc->cutoff) return 0;
+    if (!tbl_spool_plist_add_ok(sc->jobs, full, is_dir)) { sc->oom = 1; return 1; }
+    return 0;
+}
+
+typedef struct tbl_spool_sweep_s {
+    const tbl_spool_plist_t *jobs;
+    tbl_mutex_t mu;
+    unsigned long next;
+    unsigned long removed;
+    unsigned long failed;
+    unsigned long first_failed;
+} tbl_spool_sweep_t;
+
+static void tbl_spool_sweep_worker(void *ud, unsigned long worker)
+{
+    tbl_spool_sweep_t *sw = (tbl_spool_sweep_t *)ud;
+    unsigned long i;
+    int rc;
+
+    (void)worker;
+
+    for (;;) {
+        tbl_mutex_lock(&sw->mu);
+        i = sw->next;
+        if (i < sw->jobs->n) sw->next++;
+        tbl_mutex_unlock(&sw->mu);
+
+        if (i >= sw->jobs->n) break;
+
+        rc = tbl_fs_rm_tree(sw->jobs->heap + sw->jobs->off[i], sw->jobs->is_dir[i]);
+
+        tbl_mutex_lock(&sw->mu);
+        if (rc == 0) {
+            sw->removed++;
+        } else {
+            if (sw->failed == 0UL || i < sw->first_failed) sw->first_failed = i;
+            sw->failed++;
+        }
+        tbl_mutex_unlock(&sw->mu);
+    }
+}
+
+int tbl_spool_prune(tbl_spool_t *sp, unsigned long cutoff, unsigned long nthreads,
+                    unsigned long *out_removed, char *err, size_t errsz)
+{
+    tbl_spool_plist_t jobs;
+    tbl_spool_plist_t dirs;
+    tbl_spool_scan_t sc;
+    tbl_spool_sweep_t sw;
+    const char *bases[2];
+    unsigned long i;
+    unsigned long nw;
+    int b;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_removed) *out_removed = 0UL;
+    if (!sp) { tbl_spool_seterr(err, errsz, "invalid args"); return TBL_SPOOL_EINVAL; }
+
+    (void)memset(&jobs, 0, sizeof(jobs));
+    (void)memset(&dirs, 0, sizeof(dirs));
+    (void)memset(&sc, 0, sizeof(sc));
+    sc.jobs = &jobs;
+    sc.dirs = &dirs;
+    sc.cutoff = cutoff;
+
+    bases[0] = sp->out;
+    bases[1] = sp->fail;
+    for (b = 0; b < 2; ++b) {
+        if (tbl_fs_list_dir(bases[b], tbl_spool_scan_top_cb, &sc) != 0 || sc.oom) {
+            tbl_spool_seterr(err, errsz, sc.oom ? "out of memory" : "cannot list out/fail");
+            tbl_spool_plist_free(&jobs);
+            tbl_spool_plist_free(&dirs);
+            return TBL_SPOOL_EIO;
+        }
+    }
+
+    (void)memset(&sw, 0, sizeof(sw));
+    sw.jobs = &jobs;
+    if (!tbl_mutex_init_ok(&sw.mu)) {
+        tbl_spool_seterr(err, errsz, "mutex init failed");
+        tbl_spool_plist_free(&jobs);
+        tbl_spool_plist_free(&dirs);
+        return TBL_SPOOL_EIO;
+    }
+
+    nw = tbl_thread_workers(nthreads);
+    if (nw > jobs.n) nw = jobs.n;
+    if (nw > 0UL) tbl_thread_run(nw, tbl_spool_sweep_worker, &sw);
+    tbl_mutex_destroy(&sw.mu);
+
+    /* emptied buckets (best effort: a late commit keeps its bucket alive) */
+    for (i = 0; i < dirs.n; ++i) {
+        (void)tbl_fs_remove_dir(dirs.heap + dirs.off[i]);
+    }
+
+    if (out_removed) *out_removed = sw.removed;
+
+    if (sw.failed) {
+        if (err && errsz) {
+            (void)tbl_strlcpy(err, "cannot delete: ", errsz);
+            (void)tbl_strlcat(err, jobs.heap + jobs.off[sw.first_failed], errsz);
+        }
+        tbl_spool_plist_free(&jobs);
+        tbl_spool_plist_free(&dirs);
+        return TBL_SPOOL_EIO;
+    }
+
+    tbl_spool_plist_free(&jobs);
+    tbl_spool_plist_free(&dirs);
+    return TBL_SPOOL_OK;
+}
+
 #endif /* TBL_SPOOL_IMPLEMENTATION */
 #endif /* TBL_CORE_SPOOL_H */
@@ -0,0 +1,2 @@
+#define TBL_TAGIDX_IMPLEMENTATION
+#include "core/tagidx.h"
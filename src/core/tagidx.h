@@ -0,0 +1,883 @@
+#ifndef TBL_CORE_TAGIDX_H
+#define TBL_CORE_TAGIDX_H
+
+#include <stddef.h>
+
+#include "core/record.h"
+
+/* Tag index: (key, value) -> the jobs whose record carries that tag.
+   - index/tags.idx       built by `tablinum index --rebuild` or by merging the tail:
+       header (40 bytes)  "TBLTAG1\n", u32 nslots (power of two), u32 nvalues,
+                          u32 njobs, u32 ent_off, u32 jobtab_off,
+                          u32 jobheap_off, u32 file_len, u32 0
+       slots              nslots x (u32 hash, u32 ent_rel, u32 ent_len),
+                          linear probing from FNV-1a("key=value"), hash 0 = free
+       entries            per (key, value): u8 key_len, u8 value_len, key,
+                          value, then the job ordinals ascending as LEB128
+                          varint deltas (the first one absolute)
+       jobs               (njobs + 1) x u32 offsets into the job heap, which
+                          holds the jobids sorted: ordinal = rank
+   - index/tags.idx.tail  "<jobid>\t<key>=<value>" lines appended by ingest
+                          and ingest-package under index/tags.lock
+   A lookup probes tags.idx (a few positioned reads, no scan of the records),
+   scans the tail and checks every candidate against its current record
+   (index/records.idx, else the record store), so a job stored again without the tag
+   drops out. A tail larger than TBL_TAGIDX_TAIL_MAX is merged into tags.idx
+   on the next lookup.
+*/
+
+#ifndef TBL_TAGIDX_TAIL_MAX
+#define TBL_TAGIDX_TAIL_MAX 4194304UL
+#endif
+
+/* Per-job callback, 0 = continue, else stop. */
+typedef int (*tbl_tagidx_job_fn)(void *ud, const char *jobid);
+
+/* Append every tag of rec to the tail (nothing if it has none).
+   Returns 0 ok, 2 error. */
+int tbl_tagidx_add(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz);
+
+/* Call fn for every job whose record has tag key (A-Z folded to a-z) with
+   exactly value, in jobid order. Missing index files are not an error.
+   Returns 0 ok, 2 error. */
+int tbl_tagidx_each(const char *repo_root, const char *key, const char *value, tbl_tagidx_job_fn fn, void *ud,
+                    unsigned long *out_jobs, char *err, size_t errsz);
+
+/* Write tags.idx anew from every record and drop the tail.
+   out_values: distinct (key, value) pairs, out_tags: (key, value, job)
+   entries. Returns 0 ok, 2 error. */
+int tbl_tagidx_build(const char *repo_root, unsigned long *out_values, unsigned long *out_tags,
+                     char *err, size_t errsz);
+
+#ifdef TBL_TAGIDX_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/recidx.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_TAGIDX_HDR 40UL
+#define TBL_TAGIDX_SLOT 12UL
+#define TBL_TAGIDX_MIN_SLOTS 64UL
+#define TBL_TAGIDX_LINE_MAX 512
+#define TBL_TAGIDX_KV_MAX (TBL_RECORD_TAG_KEY_MAX + TBL_RECORD_TAG_VALUE_MAX + 2)
+
+typedef struct tbl_tagidx_paths_s {
+    char dir[1024];
+    char base[1024];
+    char tail[1024];
+    char tmp[1024];
+    char lock[1024];
+} tbl_tagidx_paths_t;
+
+typedef struct tbl_tagidx_hdr_s {
+    unsigned long nslots;
+    unsigned long nvals;
+    unsigned long njobs;
+    unsigned long ent_off;
+    unsigned long jobtab_off;
+    unsigned long jobheap_off;
+    unsigned long file_len;
+} tbl_tagidx_hdr_t;
+
+typedef struct tbl_tagidx_pair_s {
+    unsigned long kv;  /* arena offset of "key=value" */
+    unsigned long job; /* arena offset, then ordinal */
+} tbl_tagidx_pair_t;
+
+/* ("key=value", jobid) pairs, strings NUL-terminated in one arena */
+typedef struct tbl_tagidx_set_s {
+    tbl_tagidx_pair_t *v;
+    unsigned long n;
+    unsigned long cap;
+    char *arena;
+    unsigned long alen;
+    unsigned long acap;
+} tbl_tagidx_set_t;
+
+static void tbl_tagidx_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "tag index error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_tagidx_paths(const char *repo_root, tbl_tagidx_paths_t *p)
+{
+    return tbl_path_join2(p->dir, sizeof(p->dir), repo_root, "index") &&
+           tbl_path_join2(p->base, sizeof(p->base), p->dir, "tags.idx") &&
+           tbl_path_join2(p->tail, sizeof(p->tail), p->dir, "tags.idx.tail") &&
+           tbl_path_join2(p->tmp, sizeof(p->tmp), p->dir, "tags.idx.tmp") &&
+           tbl_path_join2(p->lock, sizeof(p->lock), p->dir, "tags.lock");
+}
+
+static void tbl_tagidx_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+static unsigned long tbl_tagidx_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* FNV-1a, 32 bit; 0 marks a free slot */
+static unsigned long tbl_tagidx_hash(const char *kv)
+{
+    unsigned long h = 2166136261UL;
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)kv; *p; ++p) {
+        h ^= (unsigned long)*p;
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+    return h ? h : 1UL;
+}
+
+/* "key=value" of a valid tag (key folded to lower case). Returns 1/0. */
+static int tbl_tagidx_kv(const char *key, const char *value, char *out, size_t outsz)
+{
+    size_t i;
+
+    if (!key || !value || strlen(key) > (size_t)TBL_RECORD_TAG_KEY_MAX) return 0;
+    for (i = 0; key[i]; ++i) out[i] = (char)((key[i] >= 'A' && key[i] <= 'Z') ? key[i] - 'A' + 'a' : key[i]);
+    out[i] = '\0';
+    if (!tbl_record_tag_key_ok(out) || !tbl_record_tag_value_ok(value)) return 0;
+    return tbl_strlcat(out, "=", outsz) < outsz && tbl_strlcat(out, value, outsz) < outsz;
+}
+
+static int tbl_tagidx_seek(FILE *fp, unsigned long off)
+{
+    if (off > (unsigned long)LONG_MAX) return 0;
+    return (fseek(fp, (long)off, SEEK_SET) == 0) ? 1 : 0;
+}
+
+static int tbl_tagidx_pread_ok(FILE *fp, unsigned long off, void *buf, size_t n)
+{
+    if (n == 0) return 1;
+    return (tbl_tagidx_seek(fp, off) && fread(buf, 1, n, fp) == n) ? 1 : 0;
+}
+
+static int tbl_tagidx_hdr_ok(const unsigned char *b, tbl_tagidx_hdr_t *h)
+{
+    if (memcmp(b, "TBLTAG1\n", 8) != 0) return 0;
+    h->nslots = tbl_tagidx_get32(b + 8);
+    h->nvals = tbl_tagidx_get32(b + 12);
+    h->njobs = tbl_tagidx_get32(b + 16);
+    h->ent_off = tbl_tagidx_get32(b + 20);
+    h->jobtab_off = tbl_tagidx_get32(b + 24);
+    h->jobheap_off = tbl_tagidx_get32(b + 28);
+    h->file_len = tbl_tagidx_get32(b + 32);
+    if (h->nslots < TBL_TAGIDX_MIN_SLOTS || (h->nslots & (h->nslots - 1UL)) != 0UL) return 0;
+    if (h->nslots > (0xffffffffUL - TBL_TAGIDX_HDR) / TBL_TAGIDX_SLOT || h->nvals > h->nslots) return 0;
+    if (h->njobs >= 0xffffffffUL / 4UL - 1UL) return 0;
+    if (h->ent_off != TBL_TAGIDX_HDR + h->nslots * TBL_TAGIDX_SLOT || h->jobtab_off < h->ent_off) return 0;
+    if (h->jobtab_off > 0xffffffffUL - (h->njobs + 1UL) * 4UL) return 0;
+    if (h->jobheap_off != h->jobtab_off + (h->njobs + 1UL) * 4UL) return 0;
+    return (h->file_len >= h->jobheap_off) ? 1 : 0;
+}
+
+static void tbl_tagidx_set_free(tbl_tagidx_set_t *s)
+{
+    free(s->v);
+    free(s->arena);
+    (void)memset(s, 0, sizeof(*s));
+}
+
+/* copy n bytes of str into the arena, NUL-terminated; *out = offset */
+static int tbl_tagidx_set_str(tbl_tagidx_set_t *s, const char *str, size_t n, unsigned long *out)
+{
+    if (s->alen + (unsigned long)n + 1UL > s->acap) {
+        unsigned long nc = s->acap ? s->acap * 2UL : 4096UL;
+        char *na;
+        while (nc < s->alen + (unsigned long)n + 1UL) nc *= 2UL;
+        na = (char *)realloc(s->arena, (size_t)nc);
+        if (!na) return 0;
+        s->arena = na;
+        s->acap = nc;
+    }
+    *out = s->alen;
+    (void)memcpy(s->arena + s->alen, str, n);
+    s->arena[s->alen + (unsigned long)n] = '\0';
+    s->alen += (unsigned long)n + 1UL;
+    return 1;
+}
+
+static int tbl_tagidx_set_add(tbl_tagidx_set_t *s, const char *kv, size_t kl, const char *job, size_t jl)
+{
+    if (s->n == s->cap) {
+        unsigned long nc = s->cap ? s->cap * 2UL : 256UL;
+        tbl_tagidx_pair_t *nv = (tbl_tagidx_pair_t *)realloc(s->v, (size_t)nc * sizeof(*nv));
+        if (!nv) return 0;
+        s->v = nv;
+        s->cap = nc;
+    }
+    if (!tbl_tagidx_set_str(s, kv, kl, &s->v[s->n].kv) || !tbl_tagidx_set_str(s, job, jl, &s->v[s->n].job)) {
+        return 0;
+    }
+    s->n++;
+    return 1;
+}
+
+/* "<jobid>\t<key>=<value>\n" -> jobid, "key=value" (NUL-terminated in place) */
+static int tbl_tagidx_parse_line(char *line, const char **job, const char **kv)
+{
+    size_t n = strlen(line);
+    char *tab;
+    char *eq;
+
+    if (n > 0 && line[n - 1] == '\n') line[--n] = '\0';
+    tab = strchr(line, '\t');
+    if (!tab) return 0;
+    *tab = '\0';
+    eq = strchr(tab + 1, '=');
+    if (!tbl_record_is_safe_id(line) || !eq) return 0;
+    *eq = '\0';
+    if (!tbl_record_tag_key_ok(tab + 1) || !tbl_record_tag_value_ok(eq + 1)) return 0;
+    *eq = '=';
+    *job = line;
+    *kv = tab + 1;
+    return 1;
+}
+
+/* Every tail line (only those of kv if not NULL) into s; out_bytes: tail
+   size read. A missing tail is empty. */
+static int tbl_tagidx_load_tail(tbl_tagidx_set_t *s, const char *path, const char *only,
+                                unsigned long *out_bytes)
+{
+    char line[TBL_TAGIDX_LINE_MAX];
+    FILE *fp;
+    int ok = 1;
+
+    if (out_bytes) *out_bytes = 0UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+        const char *job;
+        const char *kv;
+
+        if (out_bytes) *out_bytes += (unsigned long)strlen(line);
+        if (!tbl_tagidx_parse_line(line, &job, &kv)) continue;
+        if (only && strcmp(kv, only) != 0) continue;
+        if (!tbl_tagidx_set_add(s, kv, strlen(kv), job, strlen(job))) ok = 0;
+    }
+    fclose(fp);
+    return ok;
+}
+
+/* Next LEB128 varint of p[*i..len). Returns 1/0. */
+static int tbl_tagidx_varint(const unsigned char *p, unsigned long len, unsigned long *i, unsigned long *out)
+{
+    unsigned long v = 0UL;
+    unsigned int shift = 0;
+
+    for (;;) {
+        if (*i >= len || shift > 28U) return 0;
+        v |= ((unsigned long)(p[*i] & 0x7f)) << shift;
+        shift += 7U;
+        if (!(p[(*i)++] & 0x80)) break;
+    }
+    *out = v & 0xffffffffUL;
+    return 1;
+}
+
+/* "key=value" and posting list of an entry; 0 if it does not hold */
+static int tbl_tagidx_entry(const unsigned char *e, unsigned long len, char *kv, size_t kvsz,
+                            unsigned long *out_post)
+{
+    unsigned long kl;
+    unsigned long vl;
+
+    if (len < 2UL) return 0;
+    kl = (unsigned long)e[0];
+    vl = (unsigned long)e[1];
+    if (kl == 0UL || vl == 0UL || 2UL + kl + vl > len || (size_t)(kl + vl + 2UL) > kvsz) return 0;
+    (void)memcpy(kv, e + 2, (size_t)kl);
+    kv[kl] = '=';
+    (void)memcpy(kv + kl + 1UL, e + 2UL + kl, (size_t)vl);
+    kv[kl + 1UL + vl] = '\0';
+    *out_post = 2UL + kl + vl;
+    return 1;
+}
+
+/* All pairs of tags.idx into s. A missing file is empty; a bad one is 0. */
+static int tbl_tagidx_load_base(tbl_tagidx_set_t *s, const char *path)
+{
+    tbl_tagidx_hdr_t h;
+    unsigned char *buf;
+    unsigned long i;
+    long sz = 0L;
+    FILE *fp;
+    int ok;
+
+    (void)memset(&h, 0, sizeof(h));
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    ok = (fseek(fp, 0L, SEEK_END) == 0 && (sz = ftell(fp)) >= (long)TBL_TAGIDX_HDR &&
+          fseek(fp, 0L, SEEK_SET) == 0) ? 1 : 0;
+    buf = ok ? (unsigned char *)malloc((size_t)sz) : 0;
+    if (!buf || fread(buf, 1, (size_t)sz, fp) != (size_t)sz) ok = 0;
+    fclose(fp);
+    if (ok && (!tbl_tagidx_hdr_ok(buf, &h) || h.file_len != (unsigned long)sz)) ok = 0;
+    for (i = 0UL; ok && i < h.nslots; ++i) {
+        const unsigned char *sl = buf + TBL_TAGIDX_HDR + i * TBL_TAGIDX_SLOT;
+        unsigned long rel = tbl_tagidx_get32(sl + 4);
+        unsigned long len = tbl_tagidx_get32(sl + 8);
+        unsigned long area = h.jobtab_off - h.ent_off;
+        const unsigned char *e;
+        char kv[TBL_TAGIDX_KV_MAX];
+        unsigned long at;
+        unsigned long ord = 0UL;
+
+        if (tbl_tagidx_get32(sl) == 0UL) continue;
+        e = buf + h.ent_off + rel;
+        if (rel > area || len > area - rel || !tbl_tagidx_entry(e, len, kv, sizeof(kv), &at)) {
+            ok = 0;
+            break;
+        }
+        while (ok && at < len) {
+            unsigned long d;
+            unsigned long a;
+            unsigned long b;
+
+            if (!tbl_tagidx_varint(e, len, &at, &d)) {
+                ok = 0;
+                break;
+            }
+            ord += d;
+            if (ord >= h.njobs) {
+                ok = 0;
+                break;
+            }
+            a = tbl_tagidx_get32(buf + h.jobtab_off + ord * 4UL);
+            b = tbl_tagidx_get32(buf + h.jobtab_off + ord * 4UL + 4UL);
+            if (a > b || b > h.file_len - h.jobheap_off ||
+                !tbl_tagidx_set_add(s, kv, strlen(kv), (const char *)buf + h.jobheap_off + a, (size_t)(b - a))) {
+                ok = 0;
+            }
+        }
+    }
+    free(buf);
+    return ok;
+}
+
+static int tbl_tagidx_cmp_str(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+/* Sorted unique strings of s at the given member offsets; *out_n entries. */
+static const char **tbl_tagidx_sorted(const tbl_tagidx_set_t *s, int kvs, unsigned long *out_n)
+{
+    const char **sp;
+    unsigned long i;
+    unsigned long n;
+
+    sp = (const char **)malloc((size_t)(s->n ? s->n : 1UL) * sizeof(*sp));
+    if (!sp) return 0;
+    for (i = 0UL; i < s->n; ++i) sp[i] = s->arena + (kvs ? s->v[i].kv : s->v[i].job);
+    if (s->n > 1UL) qsort(sp, (size_t)s->n, sizeof(*sp), tbl_tagidx_cmp_str);
+    n = 0UL;
+    for (i = 0UL; i < s->n; ++i) {
+        if (n == 0UL || strcmp(sp[n - 1UL], sp[i]) != 0) sp[n++] = sp[i];
+    }
+    *out_n = n;
+    return sp;
+}
+
+static unsigned long tbl_tagidx_rank(const char **sp, unsigned long n, const char *str)
+{
+    unsigned long lo = 0UL;
+    unsigned long hi = n;
+
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        if (strcmp(sp[mid], str) < 0) lo = mid + 1UL;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int tbl_tagidx_cmp_pair(const void *a, const void *b)
+{
+    const tbl_tagidx_pair_t *x = (const tbl_tagidx_pair_t *)a;
+    const tbl_tagidx_pair_t *y = (const tbl_tagidx_pair_t *)b;
+
+    if (x->kv != y->kv) return (x->kv < y->kv) ? -1 : 1;
+    return (x->job < y->job) ? -1 : (x->job > y->job) ? 1 : 0;
+}
+
+/* tags.idx from s via tmp + rename. Ranks, sorts and dedupes s. */
+static int tbl_tagidx_write(tbl_tagidx_set_t *s, const tbl_tagidx_paths_t *p,
+                            unsigned long *out_values, unsigned long *out_tags)
+{
+    const char **jp = 0;
+    const char **kp = 0;
+    unsigned char *slots = 0;
+    unsigned char *ent = 0;
+    unsigned char *jobtab = 0;
+    unsigned char hdr[TBL_TAGIDX_HDR];
+    unsigned long njobs = 0UL;
+    unsigned long nvals = 0UL;
+    unsigned long nslots;
+    unsigned long elen = 0UL;
+    unsigned long ecap;
+    unsigned long hlen = 0UL;
+    unsigned long total = 0UL;
+    unsigned long i;
+    unsigned long k;
+    unsigned char *cur;
+    FILE *fp;
+    int ok;
+
+    jp = tbl_tagidx_sorted(s, 0, &njobs);
+    kp = jp ? tbl_tagidx_sorted(s, 1, &nvals) : 0;
+    ok = (jp && kp && s->n <= 0x30000000UL) ? 1 : 0;
+    for (i = 0UL; ok && i < njobs; ++i) hlen += (unsigned long)strlen(jp[i]);
+
+    /* strings -> ranks, then (value, job) order without duplicates */
+    for (i = 0UL; ok && i < s->n; ++i) {
+        s->v[i].kv = tbl_tagidx_rank(kp, nvals, s->arena + s->v[i].kv);
+        s->v[i].job = tbl_tagidx_rank(jp, njobs, s->arena + s->v[i].job);
+    }
+    if (ok && s->n > 1UL) qsort(s->v, (size_t)s->n, sizeof(*s->v), tbl_tagidx_cmp_pair);
+    k = 0UL;
+    for (i = 0UL; ok && i < s->n; ++i) {
+        if (k > 0UL && tbl_tagidx_cmp_pair(&s->v[k - 1UL], &s->v[i]) == 0) continue;
+        s->v[k++] = s->v[i];
+    }
+    if (ok) s->n = k;
+
+    nslots = TBL_TAGIDX_MIN_SLOTS;
+    while (ok && nslots < nvals * 2UL) {
+        if (nslots > (0xffffffffUL - TBL_TAGIDX_HDR) / TBL_TAGIDX_SLOT / 2UL) ok = 0;
+        else nslots *= 2UL;
+    }
+    ecap = nvals * (unsigned long)(TBL_TAGIDX_KV_MAX + 1) + s->n * 5UL;
+    slots = ok ? (unsigned char *)calloc((size_t)nslots, (size_t)TBL_TAGIDX_SLOT) : 0;
+    ent = ok ? (unsigned char *)malloc((size_t)(ecap ? ecap : 1UL)) : 0;
+    jobtab = ok ? (unsigned char *)malloc((size_t)((njobs + 1UL) * 4UL)) : 0;
+    if (!slots || !ent || !jobtab) ok = 0;
+
+    /* one entry per value: key, value, delta-coded job ordinals */
+    cur = 0;
+    for (i = 0UL; ok && i < s->n; ++i) {
+        unsigned long d;
+
+        if (i == 0UL || s->v[i - 1UL].kv != s->v[i].kv) {
+            const char *kv = kp[s->v[i].kv];
+            const char *eq = strchr(kv, '=');
+            unsigned long kl = (unsigned long)(eq - kv);
+            unsigned long vl = (unsigned long)strlen(eq + 1);
+            unsigned long at = tbl_tagidx_hash(kv) & (nslots - 1UL);
+
+            if (cur) tbl_tagidx_put32(cur + 8, elen - tbl_tagidx_get32(cur + 4));
+            while (tbl_tagidx_get32(slots + at * TBL_TAGIDX_SLOT) != 0UL) at = (at + 1UL) & (nslots - 1UL);
+            cur = slots + at * TBL_TAGIDX_SLOT;
+            tbl_tagidx_put32(cur, tbl_tagidx_hash(kv));
+            tbl_tagidx_put32(cur + 4, elen);
+            ent[elen++] = (unsigned char)kl;
+            ent[elen++] = (unsigned char)vl;
+            (void)memcpy(ent + elen, kv, (size_t)kl);
+            (void)memcpy(ent + elen + kl, eq + 1, (size_t)vl);
+            elen += kl + vl;
+            d = s->v[i].job;
+        } else {
+            d = s->v[i].job - s->v[i - 1UL].job;
+        }
+        do {
+            unsigned char c = (unsigned char)(d & 0x7fUL);
+            d >>= 7;
+            ent[elen++] = (unsigned char)(d ? (c | 0x80) : c);
+        } while (d);
+    }
+    if (ok && cur) tbl_tagidx_put32(cur + 8, elen - tbl_tagidx_get32(cur + 4));
+
+    if (ok) {
+        unsigned long off = 0UL;
+
+        for (i = 0UL; i < njobs; ++i) {
+            tbl_tagidx_put32(jobtab + i * 4UL, off);
+            off += (unsigned long)strlen(jp[i]);
+        }
+        tbl_tagidx_put32(jobtab + njobs * 4UL, off);
+        total = TBL_TAGIDX_HDR + nslots * TBL_TAGIDX_SLOT + elen + (njobs + 1UL) * 4UL;
+        if (elen > 0xffffffffUL / 2UL || hlen > 0xffffffffUL - total) ok = 0;
+        total += hlen;
+    }
+    if (ok) {
+        (void)memset(hdr, 0, sizeof(hdr));
+        (void)memcpy(hdr, "TBLTAG1\n", 8);
+        tbl_tagidx_put32(hdr + 8, nslots);
+        tbl_tagidx_put32(hdr + 12, nvals);
+        tbl_tagidx_put32(hdr + 16, njobs);
+        tbl_tagidx_put32(hdr + 20, TBL_TAGIDX_HDR + nslots * TBL_TAGIDX_SLOT);
+        tbl_tagidx_put32(hdr + 24, TBL_TAGIDX_HDR + nslots * TBL_TAGIDX_SLOT + elen);
+        tbl_tagidx_put32(hdr + 28, TBL_TAGIDX_HDR + nslots * TBL_TAGIDX_SLOT + elen + (njobs + 1UL) * 4UL);
+        tbl_tagidx_put32(hdr + 32, total);
+    }
+
+    fp = ok ? fopen(p->tmp, "wb") : 0;
+    if (!fp) ok = 0;
+    if (ok && (fwrite(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) ||
+               fwrite(slots, (size_t)TBL_TAGIDX_SLOT, (size_t)nslots, fp) != (size_t)nslots ||
+               fwrite(ent, 1, (size_t)elen, fp) != (size_t)elen ||
+               fwrite(jobtab, 1, (size_t)((njobs + 1UL) * 4UL), fp) != (size_t)((njobs + 1UL) * 4UL))) {
+        ok = 0;
+    }
+    for (i = 0UL; ok && i < njobs; ++i) {
+        if (!tbl_fputs_ok(fp, jp[i])) ok = 0;
+    }
+    if (fp && fclose(fp) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(p->tmp, p->base, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(p->tmp);
+
+    if (ok && out_values) *out_values = nvals;
+    if (ok && out_tags) *out_tags = s->n;
+    free(jp);
+    free(kp);
+    free(slots);
+    free(ent);
+    free(jobtab);
+    return ok;
+}
+
+static int tbl_tagidx_lock(const tbl_tagidx_paths_t *p, tbl_fs_lock_t *lk, char *err, size_t errsz)
+{
+    if (tbl_fs_mkdir_p(p->dir) != 0) {
+        tbl_tagidx_seterr(err, errsz, "cannot create index dir");
+        return 0;
+    }
+    if (tbl_fs_lock_open(lk, p->lock) != 0) {
+        tbl_tagidx_seterr(err, errsz, "cannot open tags.lock");
+        return 0;
+    }
+    if (tbl_fs_lock_acquire(lk) != 0) {
+        (void)tbl_fs_lock_close(lk);
+        tbl_tagidx_seterr(err, errsz, "cannot lock tags.lock");
+        return 0;
+    }
+    return 1;
+}
+
+typedef struct tbl_tagidx_tail_s {
+    tbl_fs_afile_t af;
+    const char *job;
+    int failed;
+} tbl_tagidx_tail_t;
+
+static int tbl_tagidx_tail_cb(void *ud, const char *key, const char *value)
+{
+    tbl_tagidx_tail_t *t = (tbl_tagidx_tail_t *)ud;
+    char line[TBL_TAGIDX_LINE_MAX];
+
+    line[0] = '\0';
+    if (tbl_strlcat(line, t->job, sizeof(line)) >= sizeof(line) ||
+        tbl_strlcat(line, "\t", sizeof(line)) >= sizeof(line) ||
+        tbl_strlcat(line, key, sizeof(line)) >= sizeof(line) ||
+        tbl_strlcat(line, "=", sizeof(line)) >= sizeof(line) ||
+        tbl_strlcat(line, value, sizeof(line)) >= sizeof(line) ||
+        tbl_strlcat(line, "\n", sizeof(line)) >= sizeof(line) ||
+        tbl_fs_afile_write(&t->af, line, strlen(line)) != 0) {
+        t->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+int tbl_tagidx_add(const char *repo_root, const tbl_record_t *rec, char *err, size_t errsz)
+{
+    tbl_tagidx_paths_t p;
+    tbl_tagidx_tail_t t;
+    tbl_fs_lock_t lk;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (!repo_root || !repo_root[0] || !rec || !tbl_record_is_safe_id(rec->job) || strlen(rec->job) > 255U) {
+        tbl_tagidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!rec->tags[0]) return 0;
+    if (!tbl_tagidx_paths(repo_root, &p)) {
+        tbl_tagidx_seterr(err, errsz, "tag index path too long");
+        return 2;
+    }
+
+    if (!tbl_tagidx_lock(&p, &lk, err, errsz)) return 2;
+    rc = 0;
+    t.job = rec->job;
+    t.failed = 0;
+    if (tbl_fs_afile_open(&t.af, p.tail) != 0) {
+        tbl_tagidx_seterr(err, errsz, "cannot open tags.idx.tail");
+        rc = 2;
+    } else {
+        (void)tbl_record_tag_each(rec, tbl_tagidx_tail_cb, &t);
+        if (t.failed) {
+            tbl_tagidx_seterr(err, errsz, "cannot append tags.idx.tail");
+            rc = 2;
+        }
+        if (tbl_fs_afile_close(&t.af) != 0 && rc == 0) {
+            tbl_tagidx_seterr(err, errsz, "cannot append tags.idx.tail");
+            rc = 2;
+        }
+    }
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+/* tags.idx + tail -> tags.idx, tail dropped. Returns 1/0. */
+static int tbl_tagidx_merge(const tbl_tagidx_paths_t *p)
+{
+    tbl_tagidx_set_t s;
+    tbl_fs_lock_t lk;
+    int ok;
+
+    if (!tbl_tagidx_lock(p, &lk, 0, 0)) return 0;
+    (void)memset(&s, 0, sizeof(s));
+    ok = tbl_tagidx_load_base(&s, p->base) && tbl_tagidx_load_tail(&s, p->tail, 0, 0) &&
+         tbl_tagidx_write(&s, p, 0, 0);
+    if (ok) (void)tbl_fs_remove_file(p->tail);
+    tbl_tagidx_set_free(&s);
+    (void)tbl_fs_lock_close(&lk);
+    return ok;
+}
+
+/* Candidates for kv from tags.idx: probe the slots, then one entry. */
+static int tbl_tagidx_base_lookup(tbl_tagidx_set_t *s, const char *path, const char *kv)
+{
+    tbl_tagidx_hdr_t h;
+    unsigned char b[TBL_TAGIDX_HDR];
+    unsigned char sl[TBL_TAGIDX_SLOT];
+    unsigned char *e = 0;
+    unsigned long hash = tbl_tagidx_hash(kv);
+    unsigned long at;
+    unsigned long len = 0UL;
+    unsigned long pos = 0UL;
+    unsigned long ord = 0UL;
+    unsigned long n;
+    FILE *fp;
+    int ok = 1;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    (void)setvbuf(fp, 0, _IONBF, 0);
+    if (!tbl_tagidx_pread_ok(fp, 0UL, b, sizeof(b)) || !tbl_tagidx_hdr_ok(b, &h)) {
+        fclose(fp);
+        return 0;
+    }
+
+    at = hash & (h.nslots - 1UL);
+    for (n = 0UL; ok && n < h.nslots; ++n, at = (at + 1UL) & (h.nslots - 1UL)) {
+        char ekv[TBL_TAGIDX_KV_MAX];
+        unsigned long rel;
+
+        if (!tbl_tagidx_pread_ok(fp, TBL_TAGIDX_HDR + at * TBL_TAGIDX_SLOT, sl, sizeof(sl))) {
+            ok = 0;
+            break;
+        }
+        if (tbl_tagidx_get32(sl) == 0UL) break;
+        if (tbl_tagidx_get32(sl) != hash) continue;
+        rel = tbl_tagidx_get32(sl + 4);
+        len = tbl_tagidx_get32(sl + 8);
+        if (rel > h.jobtab_off - h.ent_off || len > h.jobtab_off - h.ent_off - rel) {
+            ok = 0;
+            break;
+        }
+        e = (unsigned char *)malloc((size_t)(len ? len : 1UL));
+        if (!e || !tbl_tagidx_pread_ok(fp, h.ent_off + rel, e, (size_t)len) ||
+            !tbl_tagidx_entry(e, len, ekv, sizeof(ekv), &pos)) {
+            ok = 0;
+            break;
+        }
+        if (strcmp(ekv, kv) == 0) break;
+        free(e);
+        e = 0;
+    }
+
+    /* ordinals -> jobids, two positioned reads each */
+    while (ok && e && pos < len) {
+        unsigned char ab[8];
+        char job[256];
+        unsigned long dlt;
+        unsigned long a;
+        unsigned long z;
+
+        if (!tbl_tagidx_varint(e, len, &pos, &dlt)) {
+            ok = 0;
+            break;
+        }
+        ord += dlt;
+        if (ord >= h.njobs || !tbl_tagidx_pread_ok(fp, h.jobtab_off + ord * 4UL, ab, 8)) {
+            ok = 0;
+            break;
+        }
+        a = tbl_tagidx_get32(ab);
+        z = tbl_tagidx_get32(ab + 4);
+        if (a > z || z - a >= sizeof(job) || z > h.file_len - h.jobheap_off ||
+            !tbl_tagidx_pread_ok(fp, h.jobheap_off + a, job, (size_t)(z - a)) ||
+            !tbl_tagidx_set_add(s, kv, strlen(kv), job, (size_t)(z - a))) {
+            ok = 0;
+        }
+    }
+    free(e);
+    fclose(fp);
+    return ok;
+}
+
+int tbl_tagidx_each(const char *repo_root, const char *key, const char *value, tbl_tagidx_job_fn fn, void *ud,
+                    unsigned long *out_jobs, char *err, size_t errsz)
+{
+    tbl_tagidx_paths_t p;
+    tbl_tagidx_set_t s;
+    tbl_recidx_t rx;
+    char kv[TBL_TAGIDX_KV_MAX];
+    const char *eq;
+    const char **jp;
+    unsigned long tail_bytes;
+    unsigned long njobs;
+    unsigned long hits;
+    unsigned long i;
+    int have_rx;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_jobs) *out_jobs = 0UL;
+    if (!repo_root || !repo_root[0] || !fn || !tbl_tagidx_kv(key, value, kv, sizeof(kv))) {
+        tbl_tagidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_tagidx_paths(repo_root, &p)) {
+        tbl_tagidx_seterr(err, errsz, "tag index path too long");
+        return 2;
+    }
+
+    (void)memset(&s, 0, sizeof(s));
+    if (!tbl_tagidx_load_tail(&s, p.tail, kv, &tail_bytes)) {
+        tbl_tagidx_set_free(&s);
+        tbl_tagidx_seterr(err, errsz, "cannot read tags.idx.tail");
+        return 2;
+    }
+    if (tail_bytes > TBL_TAGIDX_TAIL_MAX) (void)tbl_tagidx_merge(&p);
+    if (!tbl_tagidx_base_lookup(&s, p.base, kv)) {
+        tbl_tagidx_set_free(&s);
+        tbl_tagidx_seterr(err, errsz, "tags.idx damaged (run tablinum index --rebuild)");
+        return 2;
+    }
+
+    jp = tbl_tagidx_sorted(&s, 0, &njobs);
+    if (!jp) {
+        tbl_tagidx_set_free(&s);
+        tbl_tagidx_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+
+    /* a candidate counts only while its record still carries the tag */
+    eq = strchr(kv, '=');
+    kv[eq - kv] = '\0';
+    have_rx = (tbl_recidx_open(&rx, repo_root, 0, 0) == 0) ? 1 : 0;
+    hits = 0UL;
+    for (i = 0UL; i < njobs; ++i) {
+        tbl_record_t rec;
+        char v[TBL_RECORD_TAG_VALUE_MAX + 1];
+
+        if ((!have_rx || tbl_recidx_lookup(&rx, jp[i], &rec) != 0) &&
+            tbl_record_read_repo(repo_root, jp[i], &rec, 0, 0) != 0) {
+            continue;
+        }
+        if (!tbl_record_tag_get_ok(&rec, kv, v, sizeof(v)) || !tbl_streq(v, eq + 1)) continue;
+        hits++;
+        if (fn(ud, jp[i]) != 0) break;
+    }
+    if (have_rx) tbl_recidx_close(&rx);
+    free(jp);
+    tbl_tagidx_set_free(&s);
+    if (out_jobs) *out_jobs = hits;
+    return 0;
+}
+
+typedef struct tbl_tagidx_build_s {
+    tbl_tagidx_set_t *s;
+    const char *job;
+    int failed;
+} tbl_tagidx_build_t;
+
+static int tbl_tagidx_build_tag_cb(void *ud, const char *key, const char *value)
+{
+    tbl_tagidx_build_t *b = (tbl_tagidx_build_t *)ud;
+    char kv[TBL_TAGIDX_KV_MAX];
+
+    if (!tbl_tagidx_kv(key, value, kv, sizeof(kv))) return 0;
+    if (!tbl_tagidx_set_add(b->s, kv, strlen(kv), b->job, strlen(b->job))) {
+        b->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int tbl_tagidx_build_cb(void *ud, const tbl_record_t *rec)
+{
+    tbl_tagidx_build_t *b = (tbl_tagidx_build_t *)ud;
+
+    b->job = rec->job;
+    (void)tbl_record_tag_each(rec, tbl_tagidx_build_tag_cb, b);
+    return b->failed ? 1 : 0;
+}
+
+int tbl_tagidx_build(const char *repo_root, unsigned long *out_values, unsigned long *out_tags,
+                     char *err, size_t errsz)
+{
+    tbl_tagidx_paths_t p;
+    tbl_tagidx_set_t s;
+    tbl_tagidx_build_t b;
+    tbl_fs_lock_t lk;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_values) *out_values = 0UL;
+    if (out_tags) *out_tags = 0UL;
+    if (!repo_root || !repo_root[0]) {
+        tbl_tagidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_tagidx_paths(repo_root, &p)) {
+        tbl_tagidx_seterr(err, errsz, "tag index path too long");
+        return 2;
+    }
+    if (!tbl_tagidx_lock(&p, &lk, err, errsz)) return 2;
+
+    rc = 0;
+    (void)memset(&s, 0, sizeof(s));
+    b.s = &s;
+    b.job = 0;
+    b.failed = 0;
+    if (tbl_record_each(repo_root, tbl_tagidx_build_cb, &b, 0, 0) != 0 && !b.failed) {
+        tbl_tagidx_seterr(err, errsz, "cannot read records");
+        rc = 2;
+    }
+    if (rc == 0 && b.failed) {
+        tbl_tagidx_seterr(err, errsz, "out of memory");
+        rc = 2;
+    }
+    if (rc == 0 && !tbl_tagidx_write(&s, &p, out_values, out_tags)) {
+        tbl_tagidx_seterr(err, errsz, "cannot write tags.idx");
+        rc = 2;
+    }
+    if (rc == 0) (void)tbl_fs_remove_file(p.tail);
+    tbl_tagidx_set_free(&s);
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+#endif /* TBL_TAGIDX_IMPLEMENTATION */
+
+#endif /* TBL_CORE_TAGIDX_H */
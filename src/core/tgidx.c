@@ -0,0 +1,2 @@
+#define TBL_TGIDX_IMPLEMENTATION
+#include "core/tgidx.h"
@@ -0,0 +1,1001 @@
+#ifndef TBL_CORE_TGIDX_H
+#define TBL_CORE_TGIDX_H
+
+#include <stddef.h>
+
+/* Trigram index for substring search over job ids and payload names.
+   - index/trigram.idx       built by `tablinum index --rebuild` or by merging the tail:
+       header (32 bytes)      "TBLTRG1\n", u32 ngrams, u32 njobs, u32 post_off,
+                              u32 jobtab_off, u32 jobheap_off, u32 file_len
+       trigrams               ngrams x (u32 trigram, u32 post_rel, u32 post_len),
+                              sorted (binary search); a trigram is three
+                              bytes, ASCII lowercased, as b0 << 16 | b1 << 8 | b2
+       postings               per trigram the job ordinals, ascending, as
+                              LEB128 varint deltas (the first one absolute)
+       jobs                   (njobs + 1) x u32 offsets into the job heap,
+                              which holds "<jobid>\0<payload>" sorted by
+                              jobid: ordinal = rank
+   - index/trigram.idx.tail  "<jobid>\t<payload>\n" lines appended by ingest
+                             and ingest-package under index/trigram.lock
+   The trigrams of a job come from its id and its payload name separately.
+   A lookup intersects the posting lists of the fragment's trigrams
+   (shortest first) and checks every candidate for the fragment itself,
+   ignoring ASCII case; fragments shorter than three bytes scan the job
+   table instead. Tail lines override trigram.idx entries of the same job,
+   the last line wins. A tail larger than TBL_TGIDX_TAIL_MAX is merged into
+   trigram.idx on the next lookup.
+*/
+
+#ifndef TBL_TGIDX_TAIL_MAX
+#define TBL_TGIDX_TAIL_MAX 4194304UL
+#endif
+
+/* Per-match callback, 0 = continue, else stop. */
+typedef int (*tbl_tgidx_fn)(void *ud, const char *jobid, const char *payload);
+
+/* Append jobid -> payload name to the tail. Returns 0 ok, 2 error. */
+int tbl_tgidx_add(const char *repo_root, const char *jobid, const char *payload, char *err, size_t errsz);
+
+/* Call fn for every job whose id or payload name contains fragment
+   (ASCII case ignored), in jobid order. Missing index files are not an
+   error. out_n: matches delivered. Returns 0 ok, 2 error. */
+int tbl_tgidx_find(const char *repo_root, const char *fragment, tbl_tgidx_fn fn, void *ud,
+                   unsigned long *out_n, char *err, size_t errsz);
+
+/* Write trigram.idx anew from every record and drop the tail.
+   Returns 0 ok, 2 error. */
+int tbl_tgidx_build(const char *repo_root, unsigned long *out_jobs, unsigned long *out_grams,
+                    char *err, size_t errsz);
+
+#ifdef TBL_TGIDX_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/path.h"
+#include "core/record.h"
+#include "core/safe.h"
+#include "core/str.h"
+#include "os/fs.h"
+
+#define TBL_TGIDX_HDR      32UL
+#define TBL_TGIDX_ENT      12UL
+#define TBL_TGIDX_LINE_MAX 512
+#define TBL_TGIDX_JOB_MAX  256UL
+#define TBL_TGIDX_PAY_MAX  64UL
+
+typedef struct tbl_tgidx_paths_s {
+    char dir[1024];
+    char base[1024];
+    char tail[1024];
+    char tmp[1024];
+    char lock[1024];
+} tbl_tgidx_paths_t;
+
+typedef struct tbl_tgidx_hdr_s {
+    unsigned long ngrams;
+    unsigned long njobs;
+    unsigned long post_off;
+    unsigned long jobtab_off;
+    unsigned long jobheap_off;
+    unsigned long file_len;
+} tbl_tgidx_hdr_t;
+
+typedef struct tbl_tgidx_ent_s {
+    unsigned long job; /* arena offset of "<jobid>\0<payload>\0" */
+    unsigned long seq; /* insertion order: the last entry of a job wins */
+} tbl_tgidx_ent_t;
+
+/* (jobid, payload) entries in one arena */
+typedef struct tbl_tgidx_set_s {
+    tbl_tgidx_ent_t *v;
+    unsigned long n;
+    unsigned long cap;
+    char *arena;
+    unsigned long alen;
+    unsigned long acap;
+} tbl_tgidx_set_t;
+
+static void tbl_tgidx_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "trigram index error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static int tbl_tgidx_paths(const char *repo_root, tbl_tgidx_paths_t *p)
+{
+    return tbl_path_join2(p->dir, sizeof(p->dir), repo_root, "index") &&
+           tbl_path_join2(p->base, sizeof(p->base), p->dir, "trigram.idx") &&
+           tbl_path_join2(p->tail, sizeof(p->tail), p->dir, "trigram.idx.tail") &&
+           tbl_path_join2(p->tmp, sizeof(p->tmp), p->dir, "trigram.idx.tmp") &&
+           tbl_path_join2(p->lock, sizeof(p->lock), p->dir, "trigram.lock");
+}
+
+static void tbl_tgidx_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+static unsigned long tbl_tgidx_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static unsigned char tbl_tgidx_lower(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c - 'A' + 'a') : c;
+}
+
+static unsigned long tbl_tgidx_gram(const char *s)
+{
+    return ((unsigned long)tbl_tgidx_lower((unsigned char)s[0]) << 16) |
+           ((unsigned long)tbl_tgidx_lower((unsigned char)s[1]) << 8) |
+           (unsigned long)tbl_tgidx_lower((unsigned char)s[2]);
+}
+
+/* 1 if needle (already lowercased, nl > 0) occurs in s, ASCII case ignored */
+static int tbl_tgidx_contains(const char *s, const char *needle, size_t nl)
+{
+    size_t sl = strlen(s);
+    size_t i;
+    size_t j;
+
+    for (i = 0; i + nl <= sl; ++i) {
+        for (j = 0; j < nl; ++j) {
+            if (tbl_tgidx_lower((unsigned char)s[i + j]) != (unsigned char)needle[j]) break;
+        }
+        if (j == nl) return 1;
+    }
+    return 0;
+}
+
+/* payload names go into tail lines: no control characters */
+static int tbl_tgidx_payload_ok(const char *s)
+{
+    size_t i;
+
+    for (i = 0; s[i]; ++i) {
+        if ((unsigned char)s[i] < 0x20) return 0;
+    }
+    return i < TBL_TGIDX_PAY_MAX;
+}
+
+static int tbl_tgidx_seek(FILE *fp, unsigned long off)
+{
+    if (off > (unsigned long)LONG_MAX) return 0;
+    return (fseek(fp, (long)off, SEEK_SET) == 0) ? 1 : 0;
+}
+
+static int tbl_tgidx_pread_ok(FILE *fp, unsigned long off, void *buf, size_t n)
+{
+    if (n == 0) return 1;
+    return (tbl_tgidx_seek(fp, off) && fread(buf, 1, n, fp) == n) ? 1 : 0;
+}
+
+static int tbl_tgidx_hdr_ok(const unsigned char *b, tbl_tgidx_hdr_t *h)
+{
+    if (memcmp(b, "TBLTRG1\n", 8) != 0) return 0;
+    h->ngrams = tbl_tgidx_get32(b + 8);
+    h->njobs = tbl_tgidx_get32(b + 12);
+    h->post_off = tbl_tgidx_get32(b + 16);
+    h->jobtab_off = tbl_tgidx_get32(b + 20);
+    h->jobheap_off = tbl_tgidx_get32(b + 24);
+    h->file_len = tbl_tgidx_get32(b + 28);
+    if (h->ngrams > (0xffffffffUL - TBL_TGIDX_HDR) / TBL_TGIDX_ENT) return 0;
+    if (h->njobs >= 0xffffffffUL / 4UL - 1UL) return 0;
+    if (h->post_off != TBL_TGIDX_HDR + h->ngrams * TBL_TGIDX_ENT || h->jobtab_off < h->post_off) return 0;
+    if (h->jobtab_off > 0xffffffffUL - (h->njobs + 1UL) * 4UL) return 0;
+    if (h->jobheap_off != h->jobtab_off + (h->njobs + 1UL) * 4UL) return 0;
+    return (h->file_len >= h->jobheap_off) ? 1 : 0;
+}
+
+static void tbl_tgidx_set_free(tbl_tgidx_set_t *s)
+{
+    free(s->v);
+    free(s->arena);
+    (void)memset(s, 0, sizeof(*s));
+}
+
+static int tbl_tgidx_set_add(tbl_tgidx_set_t *s, const char *job, size_t jl, const char *pay, size_t pl)
+{
+    unsigned long need = (unsigned long)jl + (unsigned long)pl + 2UL;
+
+    if (s->n == s->cap) {
+        unsigned long nc = s->cap ? s->cap * 2UL : 256UL;
+        tbl_tgidx_ent_t *nv = (tbl_tgidx_ent_t *)realloc(s->v, (size_t)nc * sizeof(*nv));
+        if (!nv) return 0;
+        s->v = nv;
+        s->cap = nc;
+    }
+    if (s->alen + need > s->acap) {
+        unsigned long nc = s->acap ? s->acap * 2UL : 4096UL;
+        char *na;
+        while (nc < s->alen + need) nc *= 2UL;
+        na = (char *)realloc(s->arena, (size_t)nc);
+        if (!na) return 0;
+        s->arena = na;
+        s->acap = nc;
+    }
+    s->v[s->n].job = s->alen;
+    s->v[s->n].seq = s->n;
+    s->n++;
+    (void)memcpy(s->arena + s->alen, job, jl);
+    s->arena[s->alen + (unsigned long)jl] = '\0';
+    (void)memcpy(s->arena + s->alen + (unsigned long)jl + 1UL, pay, pl);
+    s->arena[s->alen + need - 1UL] = '\0';
+    s->alen += need;
+    return 1;
+}
+
+static const char *tbl_tgidx_job(const tbl_tgidx_set_t *s, unsigned long i)
+{
+    return s->arena + s->v[i].job;
+}
+
+static const char *tbl_tgidx_pay(const tbl_tgidx_set_t *s, unsigned long i)
+{
+    const char *j = s->arena + s->v[i].job;
+    return j + strlen(j) + 1U;
+}
+
+static const tbl_tgidx_set_t *g_tgidx_sort_set;
+
+static int tbl_tgidx_cmp_ent(const void *a, const void *b)
+{
+    const tbl_tgidx_ent_t *x = (const tbl_tgidx_ent_t *)a;
+    const tbl_tgidx_ent_t *y = (const tbl_tgidx_ent_t *)b;
+    int c = strcmp(g_tgidx_sort_set->arena + x->job, g_tgidx_sort_set->arena + y->job);
+
+    if (c != 0) return c;
+    return (x->seq < y->seq) ? -1 : (x->seq > y->seq) ? 1 : 0;
+}
+
+/* sort by jobid, keep the last entry of every job */
+static void tbl_tgidx_set_unique(tbl_tgidx_set_t *s)
+{
+    unsigned long i;
+    unsigned long k = 0UL;
+
+    g_tgidx_sort_set = s;
+    if (s->n > 1UL) qsort(s->v, (size_t)s->n, sizeof(*s->v), tbl_tgidx_cmp_ent);
+    for (i = 0UL; i < s->n; ++i) {
+        if (k > 0UL && strcmp(s->arena + s->v[k - 1UL].job, s->arena + s->v[i].job) == 0) {
+            s->v[k - 1UL] = s->v[i];
+            continue;
+        }
+        s->v[k++] = s->v[i];
+    }
+    s->n = k;
+}
+
+/* Index of job in a unique set, or s->n. */
+static unsigned long tbl_tgidx_set_find(const tbl_tgidx_set_t *s, const char *job)
+{
+    unsigned long lo = 0UL;
+    unsigned long hi = s->n;
+
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        int c = strcmp(s->arena + s->v[mid].job, job);
+
+        if (c == 0) return mid;
+        if (c < 0) lo = mid + 1UL;
+        else hi = mid;
+    }
+    return s->n;
+}
+
+/* "<jobid>\t<payload>\n" -> jobid, payload (NUL-terminated in place) */
+static int tbl_tgidx_parse_line(char *line, const char **job, const char **pay)
+{
+    size_t n = strlen(line);
+    char *tab;
+
+    if (n == 0 || line[n - 1] != '\n') return 0;
+    line[--n] = '\0';
+    tab = strchr(line, '\t');
+    if (!tab) return 0;
+    *tab = '\0';
+    if (!tbl_record_is_safe_id(line) || strlen(line) >= TBL_TGIDX_JOB_MAX || !tbl_tgidx_payload_ok(tab + 1)) {
+        return 0;
+    }
+    *job = line;
+    *pay = tab + 1;
+    return 1;
+}
+
+/* Every tail line into s; out_bytes: tail size read. A missing tail is empty. */
+static int tbl_tgidx_load_tail(tbl_tgidx_set_t *s, const char *path, unsigned long *out_bytes)
+{
+    char line[TBL_TGIDX_LINE_MAX];
+    FILE *fp;
+    int ok = 1;
+
+    if (out_bytes) *out_bytes = 0UL;
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    while (ok && fgets(line, (int)sizeof(line), fp) != NULL) {
+        const char *job;
+        const char *pay;
+
+        if (out_bytes) *out_bytes += (unsigned long)strlen(line);
+        if (!tbl_tgidx_parse_line(line, &job, &pay)) continue;
+        if (!tbl_tgidx_set_add(s, job, strlen(job), pay, strlen(pay))) ok = 0;
+    }
+    fclose(fp);
+    return ok;
+}
+
+/* Next LEB128 varint of p[*i..len). Returns 1/0. */
+static int tbl_tgidx_varint(const unsigned char *p, unsigned long len, unsigned long *i, unsigned long *out)
+{
+    unsigned long v = 0UL;
+    unsigned int shift = 0;
+
+    for (;;) {
+        if (*i >= len || shift > 28U) return 0;
+        v |= ((unsigned long)(p[*i] & 0x7f)) << shift;
+        shift += 7U;
+        if (!(p[(*i)++] & 0x80)) break;
+    }
+    *out = v & 0xffffffffUL;
+    return 1;
+}
+
+/* heap entry "<jobid>\0<payload>" of length len at buf -> job, pay */
+static int tbl_tgidx_split(char *buf, unsigned long len, const char **job, const char **pay)
+{
+    unsigned long z;
+
+    for (z = 0UL; z < len && buf[z]; ++z) {
+    }
+    if (z == 0UL || z >= len || z >= TBL_TGIDX_JOB_MAX || len - z - 1UL >= TBL_TGIDX_PAY_MAX) return 0;
+    buf[len] = '\0';
+    *job = buf;
+    *pay = buf + z + 1UL;
+    return 1;
+}
+
+/* Every job of trigram.idx into s (merges). A missing file is empty; a bad one is 0. */
+static int tbl_tgidx_load_base(tbl_tgidx_set_t *s, const char *path)
+{
+    tbl_tgidx_hdr_t h;
+    unsigned char *buf;
+    unsigned long i;
+    long sz = 0L;
+    FILE *fp;
+    int ok;
+
+    (void)memset(&h, 0, sizeof(h));
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    ok = (fseek(fp, 0L, SEEK_END) == 0 && (sz = ftell(fp)) >= (long)TBL_TGIDX_HDR &&
+          fseek(fp, 0L, SEEK_SET) == 0) ? 1 : 0;
+    buf = ok ? (unsigned char *)malloc((size_t)sz + 1U) : 0;
+    if (!buf || fread(buf, 1, (size_t)sz, fp) != (size_t)sz) ok = 0;
+    fclose(fp);
+    if (ok && (!tbl_tgidx_hdr_ok(buf, &h) || h.file_len != (unsigned long)sz)) ok = 0;
+    for (i = 0UL; ok && i < h.njobs; ++i) {
+        char ent[TBL_TGIDX_JOB_MAX + TBL_TGIDX_PAY_MAX + 2UL];
+        unsigned long a = tbl_tgidx_get32(buf + h.jobtab_off + i * 4UL);
+        unsigned long e = tbl_tgidx_get32(buf + h.jobtab_off + i * 4UL + 4UL);
+        const char *job;
+        const char *pay;
+
+        if (a > e || e > h.file_len - h.jobheap_off || e - a >= sizeof(ent)) {
+            ok = 0;
+            break;
+        }
+        (void)memcpy(ent, buf + h.jobheap_off + a, (size_t)(e - a));
+        if (!tbl_tgidx_split(ent, e - a, &job, &pay) ||
+            !tbl_tgidx_set_add(s, job, strlen(job), pay, strlen(pay))) {
+            ok = 0;
+        }
+    }
+    free(buf);
+    return ok;
+}
+
+/* ---- writer ---- */
+
+/* trigram -> slot in an open-addressing table (key + 1, 0 = free) */
+typedef struct tbl_tgidx_gmap_s {
+    unsigned long *key;
+    unsigned long *cnt;
+    unsigned long n;
+    unsigned long slots;
+} tbl_tgidx_gmap_t;
+
+static int tbl_tgidx_gmap_grow(tbl_tgidx_gmap_t *m)
+{
+    unsigned long ns = m->slots ? m->slots * 2UL : 1024UL;
+    unsigned long *nk = (unsigned long *)calloc((size_t)ns, sizeof(unsigned long));
+    unsigned long *nc = (unsigned long *)calloc((size_t)ns, sizeof(unsigned long));
+    unsigned long i;
+
+    if (!nk || !nc) {
+        free(nk);
+        free(nc);
+        return 0;
+    }
+    for (i = 0UL; i < m->slots; ++i) {
+        unsigned long h;
+
+        if (m->key[i] == 0UL) continue;
+        h = (m->key[i] * 2654435761UL) & (ns - 1UL);
+        while (nk[h] != 0UL) h = (h + 1UL) & (ns - 1UL);
+        nk[h] = m->key[i];
+        nc[h] = m->cnt[i];
+    }
+    free(m->key);
+    free(m->cnt);
+    m->key = nk;
+    m->cnt = nc;
+    m->slots = ns;
+    return 1;
+}
+
+/* slot of gram, inserted when missing; slots (ulong)-1 on error */
+static unsigned long tbl_tgidx_gmap_slot(tbl_tgidx_gmap_t *m, unsigned long gram)
+{
+    unsigned long k = gram + 1UL;
+    unsigned long h;
+
+    if ((m->n + 1UL) * 2UL > m->slots && !tbl_tgidx_gmap_grow(m)) return (unsigned long)-1;
+    h = (k * 2654435761UL) & (m->slots - 1UL);
+    while (m->key[h] != 0UL && m->key[h] != k) h = (h + 1UL) & (m->slots - 1UL);
+    if (m->key[h] == 0UL) {
+        m->key[h] = k;
+        m->n++;
+    }
+    return h;
+}
+
+static int tbl_tgidx_cmp_ul(const void *a, const void *b)
+{
+    unsigned long x = *(const unsigned long *)a;
+    unsigned long y = *(const unsigned long *)b;
+
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/* distinct trigrams of job and payload (separately) into g; count */
+static unsigned long tbl_tgidx_grams(const char *job, const char *pay, unsigned long *g)
+{
+    unsigned long n = 0UL;
+    unsigned long k = 0UL;
+    unsigned long i;
+    size_t l;
+    size_t j;
+
+    l = strlen(job);
+    for (j = 0; j + 3U <= l; ++j) g[n++] = tbl_tgidx_gram(job + j);
+    l = strlen(pay);
+    for (j = 0; j + 3U <= l; ++j) g[n++] = tbl_tgidx_gram(pay + j);
+    if (n > 1UL) qsort(g, (size_t)n, sizeof(*g), tbl_tgidx_cmp_ul);
+    for (i = 0UL; i < n; ++i) {
+        if (k == 0UL || g[k - 1UL] != g[i]) g[k++] = g[i];
+    }
+    return k;
+}
+
+/* trigram.idx from a unique, jobid-sorted s via tmp + rename */
+static int tbl_tgidx_write(const tbl_tgidx_set_t *s, const tbl_tgidx_paths_t *p, unsigned long *out_grams)
+{
+    tbl_tgidx_gmap_t m;
+    unsigned long g[TBL_TGIDX_JOB_MAX + TBL_TGIDX_PAY_MAX];
+    unsigned long *keys = 0;
+    unsigned long *start = 0;
+    unsigned long *ords = 0;
+    unsigned char *ent = 0;
+    unsigned char *post = 0;
+    unsigned char *jobtab = 0;
+    unsigned char hdr[TBL_TGIDX_HDR];
+    unsigned long npairs = 0UL;
+    unsigned long plen = 0UL;
+    unsigned long hlen = 0UL;
+    unsigned long total = 0UL;
+    unsigned long i;
+    unsigned long j;
+    unsigned long k;
+    FILE *fp;
+    int ok = 1;
+
+    (void)memset(&m, 0, sizeof(m));
+
+    /* pass 1: postings per trigram */
+    for (i = 0UL; ok && i < s->n; ++i) {
+        k = tbl_tgidx_grams(tbl_tgidx_job(s, i), tbl_tgidx_pay(s, i), g);
+        for (j = 0UL; ok && j < k; ++j) {
+            unsigned long sl = tbl_tgidx_gmap_slot(&m, g[j]);
+            if (sl == (unsigned long)-1) ok = 0;
+            else m.cnt[sl]++;
+        }
+        npairs += k;
+        hlen += (unsigned long)strlen(tbl_tgidx_job(s, i)) + 1UL + (unsigned long)strlen(tbl_tgidx_pay(s, i));
+    }
+    if (ok && (m.n > (0xffffffffUL - TBL_TGIDX_HDR) / TBL_TGIDX_ENT || npairs > 0x30000000UL)) ok = 0;
+    if (ok) {
+        keys = (unsigned long *)malloc((size_t)(m.n ? m.n : 1UL) * sizeof(unsigned long));
+        start = (unsigned long *)malloc((size_t)(m.n + 1UL) * sizeof(unsigned long));
+        ords = (unsigned long *)malloc((size_t)(npairs ? npairs : 1UL) * sizeof(unsigned long));
+        ent = (unsigned char *)malloc((size_t)(m.n ? m.n * TBL_TGIDX_ENT : 1UL));
+        post = (unsigned char *)malloc((size_t)(npairs ? npairs * 5UL : 1UL));
+        jobtab = (unsigned char *)malloc((size_t)((s->n + 1UL) * 4UL));
+        if (!keys || !start || !ords || !ent || !post || !jobtab) ok = 0;
+    }
+    if (ok) {
+        /* sorted trigrams; the count slot becomes the fill position */
+        for (i = 0UL, k = 0UL; i < m.slots; ++i) {
+            if (m.key[i] != 0UL) keys[k++] = m.key[i] - 1UL;
+        }
+        if (m.n > 1UL) qsort(keys, (size_t)m.n, sizeof(*keys), tbl_tgidx_cmp_ul);
+        start[0] = 0UL;
+        for (i = 0UL; i < m.n; ++i) {
+            unsigned long sl = tbl_tgidx_gmap_slot(&m, keys[i]);
+            start[i + 1UL] = start[i] + m.cnt[sl];
+            m.cnt[sl] = start[i];
+        }
+
+        /* pass 2: ordinals in job order, so every list comes out ascending */
+        for (i = 0UL; i < s->n; ++i) {
+            k = tbl_tgidx_grams(tbl_tgidx_job(s, i), tbl_tgidx_pay(s, i), g);
+            for (j = 0UL; j < k; ++j) ords[m.cnt[tbl_tgidx_gmap_slot(&m, g[j])]++] = i;
+        }
+
+        for (i = 0UL; i < m.n; ++i) {
+            unsigned long rel = plen;
+
+            for (j = start[i]; j < start[i + 1UL]; ++j) {
+                unsigned long d = (j == start[i]) ? ords[j] : ords[j] - ords[j - 1UL];
+                do {
+                    unsigned char c = (unsigned char)(d & 0x7fUL);
+                    d >>= 7;
+                    post[plen++] = (unsigned char)(d ? (c | 0x80) : c);
+                } while (d);
+            }
+            tbl_tgidx_put32(ent + i * TBL_TGIDX_ENT, keys[i]);
+            tbl_tgidx_put32(ent + i * TBL_TGIDX_ENT + 4UL, rel);
+            tbl_tgidx_put32(ent + i * TBL_TGIDX_ENT + 8UL, plen - rel);
+        }
+
+        for (i = 0UL, k = 0UL; i < s->n; ++i) {
+            tbl_tgidx_put32(jobtab + i * 4UL, k);
+            k += (unsigned long)strlen(tbl_tgidx_job(s, i)) + 1UL + (unsigned long)strlen(tbl_tgidx_pay(s, i));
+        }
+        tbl_tgidx_put32(jobtab + s->n * 4UL, k);
+        total = TBL_TGIDX_HDR + m.n * TBL_TGIDX_ENT + plen + (s->n + 1UL) * 4UL;
+        if (hlen > 0xffffffffUL - total) ok = 0;
+        total += hlen;
+    }
+    if (ok) {
+        (void)memcpy(hdr, "TBLTRG1\n", 8);
+        tbl_tgidx_put32(hdr + 8, m.n);
+        tbl_tgidx_put32(hdr + 12, s->n);
+        tbl_tgidx_put32(hdr + 16, TBL_TGIDX_HDR + m.n * TBL_TGIDX_ENT);
+        tbl_tgidx_put32(hdr + 20, TBL_TGIDX_HDR + m.n * TBL_TGIDX_ENT + plen);
+        tbl_tgidx_put32(hdr + 24, TBL_TGIDX_HDR + m.n * TBL_TGIDX_ENT + plen + (s->n + 1UL) * 4UL);
+        tbl_tgidx_put32(hdr + 28, total);
+    }
+
+    fp = ok ? fopen(p->tmp, "wb") : 0;
+    if (!fp) ok = 0;
+    if (ok && (fwrite(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) ||
+               fwrite(ent, 1, (size_t)(m.n * TBL_TGIDX_ENT), fp) != (size_t)(m.n * TBL_TGIDX_ENT) ||
+               fwrite(post, 1, (size_t)plen, fp) != (size_t)plen ||
+               fwrite(jobtab, 1, (size_t)((s->n + 1UL) * 4UL), fp) != (size_t)((s->n + 1UL) * 4UL))) {
+        ok = 0;
+    }
+    for (i = 0UL; ok && i < s->n; ++i) {
+        const char *job = tbl_tgidx_job(s, i);
+        size_t jl = strlen(job) + 1U; /* with its NUL */
+
+        if (fwrite(job, 1, jl, fp) != jl || !tbl_fputs_ok(fp, tbl_tgidx_pay(s, i))) ok = 0;
+    }
+    if (fp && fclose(fp) != 0) ok = 0;
+    if (ok && tbl_fs_rename_atomic(p->tmp, p->base, 1) != 0) ok = 0;
+    if (!ok) (void)tbl_fs_remove_file(p->tmp);
+
+    if (ok && out_grams) *out_grams = m.n;
+    free(m.key);
+    free(m.cnt);
+    free(keys);
+    free(start);
+    free(ords);
+    free(ent);
+    free(post);
+    free(jobtab);
+    return ok;
+}
+
+static int tbl_tgidx_lock(const tbl_tgidx_paths_t *p, tbl_fs_lock_t *lk, char *err, size_t errsz)
+{
+    if (tbl_fs_mkdir_p(p->dir) != 0) {
+        tbl_tgidx_seterr(err, errsz, "cannot create index dir");
+        return 0;
+    }
+    if (tbl_fs_lock_open(lk, p->lock) != 0) {
+        tbl_tgidx_seterr(err, errsz, "cannot open trigram.lock");
+        return 0;
+    }
+    if (tbl_fs_lock_acquire(lk) != 0) {
+        (void)tbl_fs_lock_close(lk);
+        tbl_tgidx_seterr(err, errsz, "cannot lock trigram.lock");
+        return 0;
+    }
+    return 1;
+}
+
+int tbl_tgidx_add(const char *repo_root, const char *jobid, const char *payload, char *err, size_t errsz)
+{
+    tbl_tgidx_paths_t p;
+    tbl_fs_afile_t af;
+    tbl_fs_lock_t lk;
+    char line[TBL_TGIDX_LINE_MAX];
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (!payload) payload = "";
+    if (!repo_root || !repo_root[0] || !tbl_record_is_safe_id(jobid) || strlen(jobid) >= TBL_TGIDX_JOB_MAX ||
+        !tbl_tgidx_payload_ok(payload)) {
+        tbl_tgidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_tgidx_paths(repo_root, &p)) {
+        tbl_tgidx_seterr(err, errsz, "trigram index path too long");
+        return 2;
+    }
+    (void)tbl_strlcpy(line, jobid, sizeof(line));
+    (void)tbl_strlcat(line, "\t", sizeof(line));
+    (void)tbl_strlcat(line, payload, sizeof(line));
+    (void)tbl_strlcat(line, "\n", sizeof(line));
+
+    if (!tbl_tgidx_lock(&p, &lk, err, errsz)) return 2;
+    rc = 0;
+    if (tbl_fs_afile_open(&af, p.tail) != 0) {
+        tbl_tgidx_seterr(err, errsz, "cannot open trigram.idx.tail");
+        rc = 2;
+    } else {
+        if (tbl_fs_afile_write(&af, line, strlen(line)) != 0) {
+            tbl_tgidx_seterr(err, errsz, "cannot append trigram.idx.tail");
+            rc = 2;
+        }
+        if (tbl_fs_afile_close(&af) != 0 && rc == 0) {
+            tbl_tgidx_seterr(err, errsz, "cannot append trigram.idx.tail");
+            rc = 2;
+        }
+    }
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+/* trigram.idx + tail -> trigram.idx, tail dropped. Returns 1/0. */
+static int tbl_tgidx_merge(const tbl_tgidx_paths_t *p)
+{
+    tbl_tgidx_set_t s;
+    tbl_fs_lock_t lk;
+    int ok;
+
+    if (!tbl_tgidx_lock(p, &lk, 0, 0)) return 0;
+    (void)memset(&s, 0, sizeof(s));
+    ok = tbl_tgidx_load_base(&s, p->base) && tbl_tgidx_load_tail(&s, p->tail, 0);
+    if (ok) {
+        tbl_tgidx_set_unique(&s);
+        ok = tbl_tgidx_write(&s, p, 0);
+    }
+    if (ok) (void)tbl_fs_remove_file(p->tail);
+    tbl_tgidx_set_free(&s);
+    (void)tbl_fs_lock_close(&lk);
+    return ok;
+}
+
+/* Posting list of gram: ordinals into *out (malloc'd), *out_n entries
+   (0 = gram absent). Returns 1 ok, 0 damaged. */
+static int tbl_tgidx_postings(FILE *fp, const tbl_tgidx_hdr_t *h, unsigned long gram, unsigned long **out,
+                              unsigned long *out_n)
+{
+    unsigned char e[TBL_TGIDX_ENT];
+    unsigned char *post;
+    unsigned long *v;
+    unsigned long lo = 0UL;
+    unsigned long hi = h->ngrams;
+    unsigned long rel;
+    unsigned long len;
+    unsigned long ord = 0UL;
+    unsigned long i = 0UL;
+    unsigned long n = 0UL;
+    int ok;
+
+    *out = 0;
+    *out_n = 0UL;
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        if (!tbl_tgidx_pread_ok(fp, TBL_TGIDX_HDR + mid * TBL_TGIDX_ENT, e, sizeof(e))) return 0;
+        if (tbl_tgidx_get32(e) < gram) lo = mid + 1UL;
+        else hi = mid;
+    }
+    if (lo >= h->ngrams) return 1;
+    if (!tbl_tgidx_pread_ok(fp, TBL_TGIDX_HDR + lo * TBL_TGIDX_ENT, e, sizeof(e))) return 0;
+    if (tbl_tgidx_get32(e) != gram) return 1;
+    rel = tbl_tgidx_get32(e + 4);
+    len = tbl_tgidx_get32(e + 8);
+    if (len == 0UL || rel > h->jobtab_off - h->post_off || len > h->jobtab_off - h->post_off - rel) return 0;
+
+    post = (unsigned char *)malloc((size_t)len);
+    v = (unsigned long *)malloc((size_t)len * sizeof(unsigned long)); /* at most one per byte */
+    ok = (post && v && tbl_tgidx_pread_ok(fp, h->post_off + rel, post, (size_t)len)) ? 1 : 0;
+    while (ok && i < len) {
+        unsigned long d;
+
+        if (!tbl_tgidx_varint(post, len, &i, &d) || (n > 0UL && d == 0UL)) {
+            ok = 0;
+            break;
+        }
+        ord += d;
+        if (ord >= h->njobs) ok = 0;
+        else v[n++] = ord;
+    }
+    free(post);
+    if (!ok) {
+        free(v);
+        return 0;
+    }
+    *out = v;
+    *out_n = n;
+    return 1;
+}
+
+/* a[0..*an) := the entries of a also in b (both ascending) */
+static void tbl_tgidx_intersect(unsigned long *a, unsigned long *an, const unsigned long *b, unsigned long bn)
+{
+    unsigned long i = 0UL;
+    unsigned long j = 0UL;
+    unsigned long k = 0UL;
+
+    while (i < *an && j < bn) {
+        if (a[i] < b[j]) i++;
+        else if (a[i] > b[j]) j++;
+        else {
+            a[k++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    *an = k;
+}
+
+/* matching jobs of trigram.idx (not shadowed by the tail) into hits.
+   frag: lowercased. Returns 1 ok, 0 damaged. */
+static int tbl_tgidx_base_find(tbl_tgidx_set_t *hits, const tbl_tgidx_set_t *tail, const char *path,
+                               const char *frag, size_t fl)
+{
+    tbl_tgidx_hdr_t h;
+    unsigned char b[TBL_TGIDX_HDR];
+    unsigned long grams[TBL_TGIDX_LINE_MAX];
+    unsigned long *cand = 0;
+    unsigned long ncand = 0UL;
+    unsigned long ng;
+    unsigned long i;
+    FILE *fp;
+    int scan;
+    int ok = 1;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 1;
+    (void)setvbuf(fp, 0, _IONBF, 0);
+    if (!tbl_tgidx_pread_ok(fp, 0UL, b, sizeof(b)) || !tbl_tgidx_hdr_ok(b, &h)) {
+        fclose(fp);
+        return 0;
+    }
+
+    /* candidates: the posting lists of all trigrams, shortest first */
+    scan = (fl < 3U) ? 1 : 0;
+    if (!scan) {
+        unsigned long **lists;
+        unsigned long *lens;
+        unsigned long k;
+
+        ng = tbl_tgidx_grams(frag, "", grams);
+        lists = (unsigned long **)calloc((size_t)ng, sizeof(*lists));
+        lens = (unsigned long *)calloc((size_t)ng, sizeof(*lens));
+        if (!lists || !lens) ok = 0;
+        for (i = 0UL; ok && i < ng; ++i) {
+            if (!tbl_tgidx_postings(fp, &h, grams[i], &lists[i], &lens[i])) ok = 0;
+            else if (lens[i] == 0UL) break; /* a trigram nobody has */
+        }
+        if (ok && i == ng) {
+            k = 0UL;
+            for (i = 1UL; i < ng; ++i) {
+                if (lens[i] < lens[k]) k = i;
+            }
+            cand = lists[k];
+            ncand = lens[k];
+            lists[k] = 0;
+            for (i = 0UL; i < ng && ncand > 0UL; ++i) {
+                if (lists[i]) tbl_tgidx_intersect(cand, &ncand, lists[i], lens[i]);
+            }
+        }
+        for (i = 0UL; lists && i < ng; ++i) free(lists[i]);
+        free(lists);
+        free(lens);
+    } else {
+        ncand = h.njobs;
+    }
+
+    /* ordinal -> "<jobid>\0<payload>", two positioned reads each; check */
+    for (i = 0UL; ok && i < ncand; ++i) {
+        char ent[TBL_TGIDX_JOB_MAX + TBL_TGIDX_PAY_MAX + 2UL];
+        unsigned char ab[8];
+        unsigned long ord = scan ? i : cand[i];
+        unsigned long a;
+        unsigned long e;
+        const char *job;
+        const char *pay;
+
+        if (!tbl_tgidx_pread_ok(fp, h.jobtab_off + ord * 4UL, ab, 8)) {
+            ok = 0;
+            break;
+        }
+        a = tbl_tgidx_get32(ab);
+        e = tbl_tgidx_get32(ab + 4);
+        if (a > e || e - a >= sizeof(ent) || e > h.file_len - h.jobheap_off ||
+            !tbl_tgidx_pread_ok(fp, h.jobheap_off + a, ent, (size_t)(e - a)) ||
+            !tbl_tgidx_split(ent, e - a, &job, &pay)) {
+            ok = 0;
+            break;
+        }
+        if (tbl_tgidx_set_find(tail, job) < tail->n) continue;
+        if (!tbl_tgidx_contains(job, frag, fl) && !tbl_tgidx_contains(pay, frag, fl)) continue;
+        if (!tbl_tgidx_set_add(hits, job, strlen(job), pay, strlen(pay))) ok = 0;
+    }
+    free(cand);
+    fclose(fp);
+    return ok;
+}
+
+int tbl_tgidx_find(const char *repo_root, const char *fragment, tbl_tgidx_fn fn, void *ud,
+                   unsigned long *out_n, char *err, size_t errsz)
+{
+    tbl_tgidx_paths_t p;
+    tbl_tgidx_set_t tail;
+    tbl_tgidx_set_t hits;
+    char frag[TBL_TGIDX_LINE_MAX];
+    unsigned long tail_bytes;
+    unsigned long n = 0UL;
+    unsigned long i;
+    size_t fl;
+    int rc = 0;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_n) *out_n = 0UL;
+    if (!repo_root || !repo_root[0] || !fragment || !fragment[0] || !fn ||
+        strlen(fragment) >= sizeof(frag) - 1U) {
+        tbl_tgidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_tgidx_paths(repo_root, &p)) {
+        tbl_tgidx_seterr(err, errsz, "trigram index path too long");
+        return 2;
+    }
+    for (fl = 0; fragment[fl]; ++fl) frag[fl] = (char)tbl_tgidx_lower((unsigned char)fragment[fl]);
+    frag[fl] = '\0';
+
+    (void)memset(&tail, 0, sizeof(tail));
+    (void)memset(&hits, 0, sizeof(hits));
+    if (!tbl_tgidx_load_tail(&tail, p.tail, &tail_bytes)) {
+        tbl_tgidx_set_free(&tail);
+        tbl_tgidx_seterr(err, errsz, "cannot read trigram.idx.tail");
+        return 2;
+    }
+    if (tail_bytes > TBL_TGIDX_TAIL_MAX && tbl_tgidx_merge(&p)) {
+        tbl_tgidx_set_free(&tail);
+        (void)memset(&tail, 0, sizeof(tail));
+        if (!tbl_tgidx_load_tail(&tail, p.tail, 0)) rc = 2;
+    }
+    tbl_tgidx_set_unique(&tail);
+    if (rc == 0 && !tbl_tgidx_base_find(&hits, &tail, p.base, frag, fl)) {
+        tbl_tgidx_seterr(err, errsz, "trigram.idx damaged (run tablinum index --rebuild)");
+        rc = 2;
+    }
+    for (i = 0UL; rc == 0 && i < tail.n; ++i) {
+        const char *job = tbl_tgidx_job(&tail, i);
+        const char *pay = tbl_tgidx_pay(&tail, i);
+
+        if (!tbl_tgidx_contains(job, frag, fl) && !tbl_tgidx_contains(pay, frag, fl)) continue;
+        if (!tbl_tgidx_set_add(&hits, job, strlen(job), pay, strlen(pay))) {
+            tbl_tgidx_seterr(err, errsz, "out of memory");
+            rc = 2;
+        }
+    }
+    if (rc == 0) {
+        tbl_tgidx_set_unique(&hits);
+        for (i = 0UL; i < hits.n; ++i) {
+            n++;
+            if (fn(ud, tbl_tgidx_job(&hits, i), tbl_tgidx_pay(&hits, i)) != 0) break;
+        }
+    }
+    tbl_tgidx_set_free(&tail);
+    tbl_tgidx_set_free(&hits);
+    if (out_n) *out_n = n;
+    return rc;
+}
+
+typedef struct tbl_tgidx_build_s {
+    tbl_tgidx_set_t *s;
+    int failed;
+} tbl_tgidx_build_t;
+
+static int tbl_tgidx_build_cb(void *ud, const tbl_record_t *rec)
+{
+    tbl_tgidx_build_t *b = (tbl_tgidx_build_t *)ud;
+    const char *pay = tbl_tgidx_payload_ok(rec->payload) ? rec->payload : "";
+
+    if (!tbl_record_is_safe_id(rec->job)) return 0;
+    if (!tbl_tgidx_set_add(b->s, rec->job, strlen(rec->job), pay, strlen(pay))) {
+        b->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+int tbl_tgidx_build(const char *repo_root, unsigned long *out_jobs, unsigned long *out_grams,
+                    char *err, size_t errsz)
+{
+    tbl_tgidx_paths_t p;
+    tbl_tgidx_set_t s;
+    tbl_tgidx_build_t b;
+    tbl_fs_lock_t lk;
+    int rc;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_jobs) *out_jobs = 0UL;
+    if (out_grams) *out_grams = 0UL;
+    if (!repo_root || !repo_root[0]) {
+        tbl_tgidx_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+    if (!tbl_tgidx_paths(repo_root, &p)) {
+        tbl_tgidx_seterr(err, errsz, "trigram index path too long");
+        return 2;
+    }
+    if (!tbl_tgidx_lock(&p, &lk, err, errsz)) return 2;
+
+    rc = 0;
+    (void)memset(&s, 0, sizeof(s));
+    b.s = &s;
+    b.failed = 0;
+    if (tbl_record_each(repo_root, tbl_tgidx_build_cb, &b, 0, 0) != 0) {
+        tbl_tgidx_seterr(err, errsz, "cannot read records");
+        rc = 2;
+    }
+    if (rc == 0 && b.failed) {
+        tbl_tgidx_seterr(err, errsz, "out of memory");
+        rc = 2;
+    }
+    if (rc == 0) {
+        tbl_tgidx_set_unique(&s);
+        if (!tbl_tgidx_write(&s, &p, out_grams)) {
+            tbl_tgidx_seterr(err, errsz, "cannot write trigram.idx");
+            rc = 2;
+        }
+    }
+    if (rc == 0) {
+        (void)tbl_fs_remove_file(p.tail);
+        if (out_jobs) *out_jobs = s.n;
+    }
+    tbl_tgidx_set_free(&s);
+    (void)tbl_fs_lock_close(&lk);
+    return rc;
+}
+
+#endif /* TBL_TGIDX_IMPLEMENTATION */
+
+#endif /* TBL_CORE_TGIDX_H */
@@ -0,0 +1,2 @@
+#define TBL_TLZ_IMPLEMENTATION
+#include "core/tlz.h"
@@ -0,0 +1,899 @@
+#ifndef TBL_CORE_TLZ_H
+#define TBL_CORE_TLZ_H
+
+#include <stddef.h>
+
+/* Seekable compressed frames for sealed logs ("*.tlz").
+ * Codec: byte-oriented LZ77 (LZ4-style sequences): a token byte holds the
+ * literal count (high nibble) and match length - 4 (low nibble), 15 meaning
+ * "more length bytes follow" (255 = continue); then the literals, then a
+ * 2-byte little-endian offset into the last 64 KiB. The last sequence has
+ * literals only. Decoding is bounds-checked: a damaged block is an error,
+ * never an overrun.
+ *
+ * Frame:
+ *   "TLZ1" u32 block_max
+ *   block data, back to back
+ *   table: per block u32 raw_len, u32 comp_len (bit 31: stored as is),
+ *          u32 FNV-1a of the raw bytes
+ *   footer: u32 nblocks, u32 raw_size, u32 table_off, "TLZ1"
+ * All u32 little-endian. Blocks hold whole lines (cut after the last LF
+ * within block_max), so every block can be decoded and checked on its own;
+ * the table makes any raw offset one block read away.
+ */
+
+#define TBL_TLZ_BLOCK_MAX 262144UL
+
+typedef struct tbl_tlz_ent_s {
+    unsigned long raw_off;
+    unsigned long raw_len;
+    unsigned long comp_off;
+    unsigned long comp_len;
+    unsigned long sum;
+    int stored;
+} tbl_tlz_ent_t;
+
+typedef struct tbl_tlz_s {
+    void *fp;               /* FILE * */
+    unsigned long block_max;
+    unsigned long nblocks;
+    unsigned long raw_size;
+    tbl_tlz_ent_t *ent;
+    char *cache;            /* last block read by tbl_tlz_pread() */
+    unsigned long cache_blk;
+    unsigned char *cbuf;
+} tbl_tlz_t;
+
+/* Worst-case compressed size for n input bytes. */
+size_t tbl_tlz_bound(size_t n);
+
+/* Compress one block; returns the compressed size or 0 if it does not fit
+ * into cap (store the block as is then). */
+size_t tbl_tlz_compress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap);
+
+/* Decode exactly raw_len bytes. Returns 1 ok, 0 damaged. */
+int tbl_tlz_decompress_ok(const unsigned char *src, size_t n, unsigned char *dst, size_t raw_len);
+
+unsigned long tbl_tlz_sum(const void *data, size_t n);
+
+/* Compress the file src into the frame dst (created, synced) on nthreads
+ * workers (0 = one per CPU). out_raw/out_comp: sizes. 0 ok, 2 error. */
+int tbl_tlz_compress_file(const char *src, const char *dst, unsigned long nthreads,
+                          unsigned long *out_raw, unsigned long *out_comp,
+                          char *err, size_t errsz);
+
+/* Open a frame and load its table. 0 ok, 2 error. */
+int tbl_tlz_open(tbl_tlz_t *z, const char *path, char *err, size_t errsz);
+void tbl_tlz_close(tbl_tlz_t *z);
+
+/* Read the compressed bytes of blocks [first, first+count) into buf
+ * (one read; sized by the table). Returns 1 ok. */
+int tbl_tlz_read_comp_ok(tbl_tlz_t *z, unsigned long first, unsigned long count, unsigned char *buf);
+
+/* Decode block e from its compressed bytes; checks length and sum.
+ * Thread-safe (touches no frame state). Returns 1 ok. */
+int tbl_tlz_decode_ok(const tbl_tlz_ent_t *e, const unsigned char *comp, char *raw);
+
+/* Index of the block holding raw offset off (off < raw_size). */
+unsigned long tbl_tlz_block_at(const tbl_tlz_t *z, unsigned long off);
+
+/* Random access: n raw bytes from off. Returns 1 ok. */
+int tbl_tlz_pread_ok(tbl_tlz_t *z, unsigned long off, char *buf, size_t n);
+
+#ifdef TBL_TLZ_IMPLEMENTATION
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/safe.h"
+#include "os/fs.h"
+#include "os/thread.h"
+
+#define TBL_TLZ_MIN_MATCH 4U
+#define TBL_TLZ_HASH_BITS 14
+#define TBL_TLZ_MAX_OFF   65535UL
+#define TBL_TLZ_TAIL      12U /* last bytes always literals */
+#define TBL_TLZ_STORED    0x80000000UL
+#define TBL_TLZ_HUF_MAX   11  /* longest literal code, bits */
+
+static void tbl_tlz_seterr(char *err, size_t errsz, const char *msg)
+{
+    if (!err || errsz == 0) return;
+    err[0] = '\0';
+    if (!msg) msg = "tlz error";
+    (void)tbl_strlcpy(err, msg, errsz);
+}
+
+static unsigned long tbl_tlz_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static void tbl_tlz_put32(unsigned char *p, unsigned long v)
+{
+    p[0] = (unsigned char)(v & 0xffUL);
+    p[1] = (unsigned char)((v >> 8) & 0xffUL);
+    p[2] = (unsigned char)((v >> 16) & 0xffUL);
+    p[3] = (unsigned char)((v >> 24) & 0xffUL);
+}
+
+unsigned long tbl_tlz_sum(const void *data, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    unsigned long h = 2166136261UL;
+    size_t i;
+
+    for (i = 0; i < n; ++i) {
+        h ^= (unsigned long)p[i];
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+    return h;
+}
+
+/* ---- codec ---- */
+
+size_t tbl_tlz_bound(size_t n)
+{
+    return n + n / 255U + 32U;
+}
+
+static unsigned long tbl_tlz_hash(unsigned long v)
+{
+    return ((v * 2654435761UL) & 0xffffffffUL) >> (32 - TBL_TLZ_HASH_BITS);
+}
+
+/* length continuation bytes */
+static int tbl_tlz_put_len(unsigned char *dst, size_t cap, size_t *op, size_t v)
+{
+    while (v >= 255U) {
+        if (*op >= cap) return 0;
+        dst[(*op)++] = 255;
+        v -= 255U;
+    }
+    if (*op >= cap) return 0;
+    dst[(*op)++] = (unsigned char)v;
+    return 1;
+}
+
+/* token (+ lengths, offset) into seq; the literals go to lit */
+static int tbl_tlz_put_seq(unsigned char *seq, size_t cap, size_t *op,
+                           size_t nlit, size_t off, size_t mlen)
+{
+    size_t ml = mlen ? mlen - TBL_TLZ_MIN_MATCH : 0U;
+    unsigned char tok;
+
+    tok = (unsigned char)(((nlit >= 15U) ? 15U : nlit) << 4);
+    tok |= (unsigned char)((ml >= 15U) ? 15U : ml);
+    if (*op >= cap) return 0;
+    seq[(*op)++] = tok;
+    if (nlit >= 15U && !tbl_tlz_put_len(seq, cap, op, nlit - 15U)) return 0;
+    if (mlen == 0U) return 1;
+    if (cap - *op < 2U) return 0;
+    seq[(*op)++] = (unsigned char)(off & 0xffU);
+    seq[(*op)++] = (unsigned char)((off >> 8) & 0xffU);
+    if (ml >= 15U && !tbl_tlz_put_len(seq, cap, op, ml - 15U)) return 0;
+    return 1;
+}
+
+/* Greedy parse of src into sequences and the literal stream. */
+static int tbl_tlz_parse(const unsigned char *src, size_t n,
+                         unsigned char *seq, size_t seq_cap, size_t *out_seq,
+                         unsigned char *lit, size_t *out_lit)
+{
+    unsigned long *tab;
+    size_t ip;
+    size_t anchor;
+    size_t op;
+    size_t nl;
+    size_t limit;
+
+    tab = (unsigned long *)calloc((size_t)1 << TBL_TLZ_HASH_BITS, sizeof(*tab));
+    if (!tab) return 0;
+
+    ip = 0;
+    anchor = 0;
+    op = 0;
+    nl = 0;
+    limit = (n > TBL_TLZ_TAIL) ? n - TBL_TLZ_TAIL : 0U;
+    while (ip < limit) {
+        unsigned long v = tbl_tlz_get32(src + ip);
+        unsigned long h = tbl_tlz_hash(v);
+        unsigned long ref = tab[h]; /* position + 1, 0 = empty */
+
+        tab[h] = (unsigned long)ip + 1UL;
+        if (ref != 0UL && (unsigned long)ip - (ref - 1UL) <= TBL_TLZ_MAX_OFF &&
+            tbl_tlz_get32(src + ref - 1UL) == v) {
+            size_t m = (size_t)(ref - 1UL);
+            size_t len = TBL_TLZ_MIN_MATCH;
+
+            while (ip + len < n - 5U && src[m + len] == src[ip + len]) len++;
+            (void)memcpy(lit + nl, src + anchor, ip - anchor);
+            nl += ip - anchor;
+            if (!tbl_tlz_put_seq(seq, seq_cap, &op, ip - anchor, ip - m, len)) {
+                free(tab);
+                return 0;
+            }
+            ip += len;
+            anchor = ip;
+            /* keep the table warm across the match */
+            if (ip - 2U < limit) tab[tbl_tlz_hash(tbl_tlz_get32(src + ip - 2U))] = (unsigned long)(ip - 2U) + 1UL;
+            continue;
+        }
+        ip++;
+    }
+    free(tab);
+    (void)memcpy(lit + nl, src + anchor, n - anchor);
+    nl += n - anchor;
+    if (!tbl_tlz_put_seq(seq, seq_cap, &op, n - anchor, 0U, 0U)) return 0;
+    *out_seq = op;
+    *out_lit = nl;
+    return 1;
+}
+
+/* Code lengths (1..TBL_TLZ_HUF_MAX, 0 = unused) of a Huffman code for
+ * freq; frequencies are halved until the longest code fits. */
+static void tbl_tlz_huf_lengths(const unsigned long freq[256], unsigned char len[256])
+{
+    unsigned long f[256];
+    unsigned long w[512];
+    int parent[512];
+    int live[512];
+    int nsym;
+    int i;
+
+    for (i = 0; i < 256; ++i) f[i] = freq[i];
+    for (;;) {
+        int nn;
+        int nlive;
+        int maxlen;
+
+        nsym = 0;
+        for (i = 0; i < 256; ++i) {
+            len[i] = 0;
+            w[i] = f[i];
+            parent[i] = -1;
+            live[i] = (f[i] > 0UL) ? 1 : 0;
+            if (live[i]) nsym++;
+        }
+        if (nsym == 0) return;
+        if (nsym == 1) {
+            for (i = 0; i < 256; ++i) if (f[i]) len[i] = 1;
+            return;
+        }
+
+        /* O(n^2) merge of the two lightest: 256 symbols at most */
+        nn = 256;
+        nlive = nsym;
+        while (nlive > 1) {
+            int a = -1;
+            int b = -1;
+            int k;
+
+            for (k = 0; k < nn; ++k) {
+                if (!live[k]) continue;
+                if (a < 0 || w[k] < w[a]) { b = a; a = k; }
+                else if (b < 0 || w[k] < w[b]) { b = k; }
+            }
+            w[nn] = w[a] + w[b];
+            parent[nn] = -1;
+            live[nn] = 1;
+            parent[a] = nn;
+            parent[b] = nn;
+            live[a] = 0;
+            live[b] = 0;
+            nn++;
+            nlive--;
+        }
+
+        maxlen = 0;
+        for (i = 0; i < 256; ++i) {
+            int d = 0;
+            int k;
+
+            if (!f[i]) continue;
+            for (k = i; parent[k] >= 0; k = parent[k]) d++;
+            len[i] = (unsigned char)((d > 255) ? 255 : d);
+            if (d > maxlen) maxlen = d;
+        }
+        if (maxlen <= TBL_TLZ_HUF_MAX) return;
+        for (i = 0; i < 256; ++i) if (f[i]) f[i] = (f[i] + 1UL) / 2UL;
+    }
+}
+
+/* Canonical codes from lengths. Returns 0 if the lengths are not a
+ * prefix code (over-subscribed). */
+static int tbl_tlz_huf_codes(const unsigned char len[256], unsigned long code[256])
+{
+    unsigned long count[TBL_TLZ_HUF_MAX + 1];
+    unsigned long next[TBL_TLZ_HUF_MAX + 1];
+    unsigned long c;
+    unsigned long kraft;
+    int i;
+
+    for (i = 0; i <= TBL_TLZ_HUF_MAX; ++i) count[i] = 0UL;
+    kraft = 0UL;
+    for (i = 0; i < 256; ++i) {
+        if (len[i] > TBL_TLZ_HUF_MAX) return 0;
+        if (len[i]) {
+            count[len[i]]++;
+            kraft += 1UL << (TBL_TLZ_HUF_MAX - len[i]);
+        }
+    }
+    if (kraft > (1UL << TBL_TLZ_HUF_MAX)) return 0;
+    c = 0UL;
+    next[0] = 0UL;
+    for (i = 1; i <= TBL_TLZ_HUF_MAX; ++i) {
+        c = (c + count[i - 1]) << 1;
+        next[i] = c;
+    }
+    for (i = 0; i < 256; ++i) {
+        code[i] = len[i] ? next[len[i]]++ : 0UL;
+    }
+    return 1;
+}
+
+/* Huffman-code lit[0..n) as lengths (128 bytes, two per byte), u32 byte
+ * count, MSB-first bit stream. Returns the size or 0 if it does not fit. */
+static size_t tbl_tlz_huf_encode(const unsigned char *lit, size_t n, unsigned char *dst, size_t cap)
+{
+    unsigned long freq[256];
+    unsigned long code[256];
+    unsigned char len[256];
+    unsigned long acc;
+    int nacc;
+    size_t op;
+    size_t i;
+
+    if (cap < 132U) return 0;
+    for (i = 0; i < 256U; ++i) freq[i] = 0UL;
+    for (i = 0; i < n; ++i) freq[lit[i]]++;
+    tbl_tlz_huf_lengths(freq, len);
+    if (!tbl_tlz_huf_codes(len, code)) return 0;
+    for (i = 0; i < 128U; ++i) dst[i] = (unsigned char)((len[2U * i] << 4) | len[2U * i + 1U]);
+
+    op = 132U;
+    acc = 0UL;
+    nacc = 0;
+    for (i = 0; i < n; ++i) {
+        acc = ((acc << len[lit[i]]) | code[lit[i]]) & 0xffffffUL;
+        nacc += len[lit[i]];
+        while (nacc >= 8) {
+            if (op >= cap) return 0;
+            nacc -= 8;
+            dst[op++] = (unsigned char)((acc >> nacc) & 0xffUL);
+        }
+    }
+    if (nacc > 0) {
+        if (op >= cap) return 0;
+        dst[op++] = (unsigned char)((acc << (8 - nacc)) & 0xffUL);
+    }
+    tbl_tlz_put32(dst + 128, (unsigned long)(op - 132U));
+    return op;
+}
+
+/* Decode n literals from src (as written above) into dst. */
+static int tbl_tlz_huf_decode_ok(const unsigned char *src, size_t sn, size_t *used,
+                                 unsigned char *dst, size_t n)
+{
+    unsigned char len[256];
+    unsigned long code[256];
+    unsigned short tab[1 << TBL_TLZ_HUF_MAX]; /* symbol << 4 | length, 0 = no code */
+    const unsigned char *p;
+    size_t nb;
+    size_t ip;
+    unsigned long acc;
+    int nacc;
+    size_t i;
+
+    if (sn < 132U) return 0;
+    for (i = 0; i < 128U; ++i) {
+        len[2U * i] = (unsigned char)(src[i] >> 4);
+        len[2U * i + 1U] = (unsigned char)(src[i] & 15U);
+    }
+    nb = (size_t)tbl_tlz_get32(src + 128);
+    if (nb > sn - 132U || !tbl_tlz_huf_codes(len, code)) return 0;
+    (void)memset(tab, 0, sizeof(tab));
+    for (i = 0; i < 256U; ++i) {
+        unsigned long lo;
+        unsigned long hi;
+
+        if (!len[i]) continue;
+        lo = code[i] << (TBL_TLZ_HUF_MAX - len[i]);
+        hi = (code[i] + 1UL) << (TBL_TLZ_HUF_MAX - len[i]);
+        for (; lo < hi; ++lo) tab[lo] = (unsigned short)((i << 4) | len[i]);
+    }
+
+    p = src + 132;
+    ip = 0;
+    acc = 0UL;
+    nacc = 0;
+    for (i = 0; i < n; ++i) {
+        unsigned short e;
+
+        while (nacc < TBL_TLZ_HUF_MAX) {
+            acc = ((acc << 8) | (ip < nb ? (unsigned long)p[ip] : 0UL)) & 0xffffffUL;
+            ip++;
+            nacc += 8;
+        }
+        e = tab[(acc >> (nacc - TBL_TLZ_HUF_MAX)) & ((1UL << TBL_TLZ_HUF_MAX) - 1UL)];
+        if (e == 0U) return 0;
+        dst[i] = (unsigned char)(e >> 4);
+        nacc -= (int)(e & 15U);
+    }
+    /* every code bit must come from the stream, not from the padding */
+    if (ip * 8U - (size_t)nacc > nb * 8U) return 0;
+    *used = 132U + nb;
+    return 1;
+}
+
+size_t tbl_tlz_compress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap)
+{
+    unsigned char *lit;
+    unsigned char *seq;
+    size_t seq_cap;
+    size_t nseq;
+    size_t nlit;
+    size_t op;
+    size_t h;
+
+    if (cap < 5U) return 0;
+    seq_cap = tbl_tlz_bound(n);
+    lit = (unsigned char *)malloc(n ? n : 1U);
+    seq = (unsigned char *)malloc(seq_cap);
+    if (!lit || !seq || !tbl_tlz_parse(src, n, seq, seq_cap, &nseq, lit, &nlit)) {
+        free(lit);
+        free(seq);
+        return 0;
+    }
+
+    /* flags, literal count, literals (Huffman if smaller), sequences */
+    tbl_tlz_put32(dst + 1, (unsigned long)nlit);
+    op = 5U;
+    h = (nlit >= 256U) ? tbl_tlz_huf_encode(lit, nlit, dst + op, cap - op) : 0U;
+    if (h > 0 && h < nlit) {
+        dst[0] = 1;
+        op += h;
+    } else if (cap - op >= nlit) {
+        dst[0] = 0;
+        (void)memcpy(dst + op, lit, nlit);
+        op += nlit;
+    } else {
+        op = 0;
+    }
+    if (op > 0 && cap - op >= nseq) {
+        (void)memcpy(dst + op, seq, nseq);
+        op += nseq;
+    } else {
+        op = 0;
+    }
+    free(lit);
+    free(seq);
+    return op;
+}
+
+static int tbl_tlz_get_len(const unsigned char *src, size_t n, size_t *ip, size_t *v)
+{
+    for (;;) {
+        unsigned char b;
+
+        if (*ip >= n) return 0;
+        b = src[(*ip)++];
+        if (*v > (size_t)-1 - 255U) return 0;
+        *v += (size_t)b;
+        if (b != 255) return 1;
+    }
+}
+
+/* The literals are decoded into the end of dst first; the sequences then
+ * fill dst from the front. The write position never passes the next
+ * unread literal (it trails it by the match bytes still to come), so no
+ * scratch buffer is needed. */
+int tbl_tlz_decompress_ok(const unsigned char *src, size_t n, unsigned char *dst, size_t raw_len)
+{
+    size_t nlit;
+    size_t ip;
+    size_t op;
+    size_t lp;
+
+    if (n < 5U || src[0] > 1U) return 0;
+    nlit = (size_t)tbl_tlz_get32(src + 1);
+    if (nlit > raw_len) return 0;
+    ip = 5U;
+    lp = raw_len - nlit;
+    if (src[0] == 1U) {
+        size_t used;
+        if (!tbl_tlz_huf_decode_ok(src + ip, n - ip, &used, dst + lp, nlit)) return 0;
+        ip += used;
+    } else {
+        if (nlit > n - ip) return 0;
+        (void)memcpy(dst + lp, src + ip, nlit);
+        ip += nlit;
+    }
+
+    op = 0;
+    while (ip < n) {
+        unsigned char tok = src[ip++];
+        size_t lit = (size_t)(tok >> 4);
+        size_t ml = (size_t)(tok & 15U);
+        size_t off;
+
+        if (lit == 15U && !tbl_tlz_get_len(src, n, &ip, &lit)) return 0;
+        if (lit > raw_len - lp) return 0;
+        if (op != lp) (void)memmove(dst + op, dst + lp, lit);
+        op += lit;
+        lp += lit;
+        if (ip == n) break; /* last sequence: literals only */
+
+        if (n - ip < 2U) return 0;
+        off = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2U;
+        if (ml == 15U && !tbl_tlz_get_len(src, n, &ip, &ml)) return 0;
+        ml += TBL_TLZ_MIN_MATCH;
+        if (off == 0U || off > op || ml > lp - op) return 0;
+
+        /* may overlap: byte by byte */
+        {
+            unsigned char *d = dst + op;
+            const unsigned char *s = d - off;
+            size_t k;
+            for (k = 0; k < ml; ++k) d[k] = s[k];
+        }
+        op += ml;
+    }
+    return (op == raw_len && lp == raw_len) ? 1 : 0;
+}
+
+/* ---- writer ---- */
+
+typedef struct tbl_tlz_job_s {
+    unsigned char *raw;
+    size_t raw_len;
+    unsigned char *comp;
+    size_t comp_cap;
+    size_t comp_len;    /* 0: store raw */
+    unsigned long sum;
+} tbl_tlz_job_t;
+
+static void tbl_tlz_job_worker(void *ud, unsigned long worker)
+{
+    tbl_tlz_job_t *j = (tbl_tlz_job_t *)ud + worker;
+
+    j->sum = tbl_tlz_sum(j->raw, j->raw_len);
+    j->comp_len = tbl_tlz_compress(j->raw, j->raw_len, j->comp, j->comp_cap);
+    if (j->comp_len >= j->raw_len) j->comp_len = 0;
+}
+
+int tbl_tlz_compress_file(const char *src, const char *dst, unsigned long nthreads,
+                          unsigned long *out_raw, unsigned long *out_comp,
+                          char *err, size_t errsz)
+{
+    tbl_tlz_job_t jobs[TBL_THREAD_MAX];
+    unsigned char *tbl;
+    unsigned long tcap;
+    unsigned long nblocks;
+    unsigned long raw_total;
+    unsigned long comp_off;
+    unsigned char *carry;
+    size_t ncarry;
+    unsigned long nw;
+    unsigned long k;
+    tbl_fs_afile_t af;
+    unsigned char hdr[16];
+    FILE *in;
+    int eof;
+    int rc;
+
+    if (out_raw) *out_raw = 0UL;
+    if (out_comp) *out_comp = 0UL;
+    if (err && errsz) err[0] = '\0';
+    if (!src || !dst) {
+        tbl_tlz_seterr(err, errsz, "invalid args");
+        return 2;
+    }
+
+    nw = tbl_thread_workers(nthreads);
+    (void)memset(jobs, 0, sizeof(jobs));
+    carry = (unsigned char *)malloc((size_t)TBL_TLZ_BLOCK_MAX);
+    tbl = NULL;
+    tcap = 0UL;
+    rc = carry ? 0 : 2;
+    for (k = 0UL; k < nw && rc == 0; ++k) {
+        jobs[k].raw = (unsigned char *)malloc((size_t)TBL_TLZ_BLOCK_MAX);
+        jobs[k].comp_cap = tbl_tlz_bound((size_t)TBL_TLZ_BLOCK_MAX);
+        jobs[k].comp = (unsigned char *)malloc(jobs[k].comp_cap);
+        if (!jobs[k].raw || !jobs[k].comp) rc = 2;
+    }
+    if (rc != 0) {
+        tbl_tlz_seterr(err, errsz, "out of memory");
+        goto out_mem;
+    }
+
+    in = fopen(src, "rb");
+    if (!in) {
+        tbl_tlz_seterr(err, errsz, "cannot open source");
+        rc = 2;
+        goto out_mem;
+    }
+    (void)tbl_fs_remove_file(dst);
+    if (tbl_fs_afile_open(&af, dst) != 0) {
+        fclose(in);
+        tbl_tlz_seterr(err, errsz, "cannot create frame");
+        rc = 2;
+        goto out_mem;
+    }
+
+    (void)memcpy(hdr, "TLZ1", 4);
+    tbl_tlz_put32(hdr + 4, TBL_TLZ_BLOCK_MAX);
+    if (tbl_fs_afile_write(&af, hdr, 8) != 0) rc = 2;
+    comp_off = 8UL;
+
+    nblocks = 0UL;
+    raw_total = 0UL;
+    ncarry = 0;
+    eof = 0;
+    while (rc == 0 && !(eof && ncarry == 0)) {
+        unsigned long nj = 0UL;
+
+        /* fill up to nw blocks, each cut after its last LF */
+        while (nj < nw && !(eof && ncarry == 0)) {
+            tbl_tlz_job_t *j = &jobs[nj];
+            size_t have = ncarry;
+            size_t cut;
+
+            (void)memcpy(j->raw, carry, ncarry);
+            if (!eof) {
+                size_t got = fread(j->raw + have, 1, (size_t)TBL_TLZ_BLOCK_MAX - have, in);
+                if (got < (size_t)TBL_TLZ_BLOCK_MAX - have) {
+                    if (ferror(in)) { rc = 2; break; }
+                    eof = 1;
+                }
+                have += got;
+            }
+            cut = have;
+            if (!eof || have == (size_t)TBL_TLZ_BLOCK_MAX) {
+                while (cut > 0 && j->raw[cut - 1] != '\n') cut--;
+                if (cut == 0) cut = have; /* no LF in a whole block */
+            }
+            ncarry = have - cut;
+            (void)memcpy(carry, j->raw + cut, ncarry);
+            j->raw_len = cut;
+            if (cut > 0) nj++;
+        }
+        if (rc != 0 || nj == 0UL) break;
+
+        tbl_thread_run(nj, tbl_tlz_job_worker, jobs);
+
+        for (k = 0UL; k < nj && rc == 0; ++k) {
+            tbl_tlz_job_t *j = &jobs[k];
+            unsigned long clen = j->comp_len ? (unsigned long)j->comp_len : (unsigned long)j->raw_len;
+
+            if (tbl_fs_afile_write(&af, j->comp_len ? j->comp : j->raw, (size_t)clen) != 0) {
+                rc = 2;
+                break;
+            }
+            if ((nblocks + 1UL) * 12UL > tcap) {
+                unsigned long ncap = tcap ? tcap * 2UL : 1200UL;
+                unsigned char *nt = (unsigned char *)realloc(tbl, (size_t)ncap);
+                if (!nt) { rc = 2; break; }
+                tbl = nt;
+                tcap = ncap;
+            }
+            tbl_tlz_put32(tbl + nblocks * 12UL, (unsigned long)j->raw_len);
+            tbl_tlz_put32(tbl + nblocks * 12UL + 4UL, j->comp_len ? clen : (clen | TBL_TLZ_STORED));
+            tbl_tlz_put32(tbl + nblocks * 12UL + 8UL, j->sum);
+            nblocks++;
+            raw_total += (unsigned long)j->raw_len;
+            comp_off += clen;
+        }
+    }
+    fclose(in);
+
+    if (rc == 0) {
+        if ((nblocks > 0UL && tbl_fs_afile_write(&af, tbl, (size_t)(nblocks * 12UL)) != 0)) rc = 2;
+        tbl_tlz_put32(hdr, nblocks);
+        tbl_tlz_put32(hdr + 4, raw_total);
+        tbl_tlz_put32(hdr + 8, comp_off);
+        (void)memcpy(hdr + 12, "TLZ1", 4);
+        if (rc == 0 && (tbl_fs_afile_write(&af, hdr, 16) != 0 || tbl_fs_afile_sync(&af) != 0)) rc = 2;
+    }
+    if (tbl_fs_afile_close(&af) != 0) rc = 2;
+    if (rc != 0) {
+        (void)tbl_fs_remove_file(dst);
+        tbl_tlz_seterr(err, errsz, "cannot write frame");
+    } else {
+        if (out_raw) *out_raw = raw_total;
+        if (out_comp) *out_comp = comp_off + nblocks * 12UL + 16UL;
+    }
+
+out_mem:
+    for (k = 0UL; k < nw; ++k) {
+        free(jobs[k].raw);
+        free(jobs[k].comp);
+    }
+    free(carry);
+    free(tbl);
+    return rc;
+}
+
+/* ---- reader ---- */
+
+int tbl_tlz_open(tbl_tlz_t *z, const char *path, char *err, size_t errsz)
+{
+    unsigned char ft[16];
+    unsigned char *t;
+    FILE *fp;
+    long sz;
+    unsigned long nb;
+    unsigned long toff;
+    unsigned long raw_off;
+    unsigned long comp_off;
+    unsigned long i;
+
+    if (err && errsz) err[0] = '\0';
+    if (!z) return 2;
+    (void)memset(z, 0, sizeof(*z));
+    fp = path ? fopen(path, "rb") : NULL;
+    if (!fp) {
+        tbl_tlz_seterr(err, errsz, "cannot open frame");
+        return 2;
+    }
+
+    sz = (fseek(fp, 0L, SEEK_END) == 0) ? ftell(fp) : -1L;
+    if (sz < 24L || fseek(fp, sz - 16L, SEEK_SET) != 0 || fread(ft, 1, 16, fp) != 16U ||
+        memcmp(ft + 12, "TLZ1", 4) != 0) {
+        fclose(fp);
+        tbl_tlz_seterr(err, errsz, "not a tlz frame");
+        return 2;
+    }
+    nb = tbl_tlz_get32(ft);
+    z->raw_size = tbl_tlz_get32(ft + 4);
+    toff = tbl_tlz_get32(ft + 8);
+    if (toff < 8UL || nb > ((unsigned long)sz - 24UL) / 12UL ||
+        toff + nb * 12UL + 16UL != (unsigned long)sz) {
+        fclose(fp);
+        tbl_tlz_seterr(err, errsz, "tlz frame table damaged");
+        return 2;
+    }
+
+    t = (unsigned char *)malloc((size_t)(nb * 12UL + 8UL));
+    z->ent = (tbl_tlz_ent_t *)malloc((size_t)(nb ? nb : 1UL) * sizeof(*z->ent));
+    if (!t || !z->ent) {
+        free(t);
+        free(z->ent);
+        z->ent = NULL;
+        fclose(fp);
+        tbl_tlz_seterr(err, errsz, "out of memory");
+        return 2;
+    }
+    if (fseek(fp, 0L, SEEK_SET) != 0 || fread(t, 1, 8, fp) != 8U || memcmp(t, "TLZ1", 4) != 0 ||
+        fseek(fp, (long)toff, SEEK_SET) != 0 || fread(t, 1, (size_t)(nb * 12UL), fp) != (size_t)(nb * 12UL)) {
+        free(t);
+        free(z->ent);
+        z->ent = NULL;
+        fclose(fp);
+        tbl_tlz_seterr(err, errsz, "tlz frame table damaged");
+        return 2;
+    }
+    z->block_max = TBL_TLZ_BLOCK_MAX;
+
+    raw_off = 0UL;
+    comp_off = 8UL;
+    for (i = 0UL; i < nb; ++i) {
+        tbl_tlz_ent_t *e = &z->ent[i];
+        unsigned long c = tbl_tlz_get32(t + i * 12UL + 4UL);
+
+        e->raw_off = raw_off;
+        e->raw_len = tbl_tlz_get32(t + i * 12UL);
+        e->stored = (c & TBL_TLZ_STORED) ? 1 : 0;
+        e->comp_len = c & ~TBL_TLZ_STORED;
+        e->comp_off = comp_off;
+        e->sum = tbl_tlz_get32(t + i * 12UL + 8UL);
+        if (e->raw_len == 0UL || e->raw_len > TBL_TLZ_BLOCK_MAX ||
+            e->comp_len > tbl_tlz_bound((size_t)TBL_TLZ_BLOCK_MAX) ||
+            (e->stored && e->comp_len != e->raw_len)) {
+            break;
+        }
+        raw_off += e->raw_len;
+        comp_off += e->comp_len;
+    }
+    free(t);
+    if (i < nb || raw_off != z->raw_size || comp_off != toff) {
+        free(z->ent);
+        z->ent = NULL;
+        fclose(fp);
+        tbl_tlz_seterr(err, errsz, "tlz frame table damaged");
+        return 2;
+    }
+
+    z->fp = (void *)fp;
+    z->nblocks = nb;
+    z->cache_blk = nb; /* none */
+    return 0;
+}
+
+void tbl_tlz_close(tbl_tlz_t *z)
+{
+    if (!z) return;
+    if (z->fp) fclose((FILE *)z->fp);
+    free(z->ent);
+    free(z->cache);
+    free(z->cbuf);
+    (void)memset(z, 0, sizeof(*z));
+}
+
+int tbl_tlz_read_comp_ok(tbl_tlz_t *z, unsigned long first, unsigned long count, unsigned char *buf)
+{
+    const tbl_tlz_ent_t *a;
+    const tbl_tlz_ent_t *b;
+    size_t n;
+
+    if (!z || !z->fp || count == 0UL || first + count > z->nblocks) return 0;
+    a = &z->ent[first];
+    b = &z->ent[first + count - 1UL];
+    n = (size_t)(b->comp_off + b->comp_len - a->comp_off);
+    if (a->comp_off > (unsigned long)LONG_MAX || fseek((FILE *)z->fp, (long)a->comp_off, SEEK_SET) != 0) return 0;
+    return fread(buf, 1, n, (FILE *)z->fp) == n;
+}
+
+int tbl_tlz_decode_ok(const tbl_tlz_ent_t *e, const unsigned char *comp, char *raw)
+{
+    if (e->stored) {
+        (void)memcpy(raw, comp, (size_t)e->raw_len);
+    } else if (!tbl_tlz_decompress_ok(comp, (size_t)e->comp_len, (unsigned char *)raw, (size_t)e->raw_len)) {
+        return 0;
+    }
+    return tbl_tlz_sum(raw, (size_t)e->raw_len) == e->sum;
+}
+
+unsigned long tbl_tlz_block_at(const tbl_tlz_t *z, unsigned long off)
+{
+    unsigned long lo = 0UL;
+    unsigned long hi = z->nblocks;
+
+    while (hi - lo > 1UL) {
+        unsigned long mid = lo + (hi - lo) / 2UL;
+        if (z->ent[mid].raw_off <= off) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int tbl_tlz_pread_ok(tbl_tlz_t *z, unsigned long off, char *buf, size_t n)
+{
+    if (!z || !z->fp) return 0;
+    if (n == 0) return 1;
+    if (off > z->raw_size || (unsigned long)n > z->raw_size - off) return 0;
+
+    if (!z->cache) {
+        z->cache = (char *)malloc((size_t)TBL_TLZ_BLOCK_MAX);
+        z->cbuf = (unsigned char *)malloc(tbl_tlz_bound((size_t)TBL_TLZ_BLOCK_MAX));
+        if (!z->cache || !z->cbuf) return 0;
+    }
+    while (n > 0) {
+        unsigned long b = tbl_tlz_block_at(z, off);
+        const tbl_tlz_ent_t *e = &z->ent[b];
+        size_t skip;
+        size_t take;
+
+        if (z->cache_blk != b) {
+            z->cache_blk = z->nblocks;
+            if (!tbl_tlz_read_comp_ok(z, b, 1UL, z->cbuf) || !tbl_tlz_decode_ok(e, z->cbuf, z->cache)) return 0;
+            z->cache_blk = b;
+        }
+        skip = (size_t)(off - e->raw_off);
+        take = (size_t)e->raw_len - skip;
+        if (take > n) take = n;
+        (void)memcpy(buf, z->cache + skip, take);
+        buf += take;
+        off += (unsigned long)take;
+        n -= take;
+    }
+    return 1;
+}
+
+#endif /* TBL_TLZ_IMPLEMENTATION */
+
+#endif /* TBL_CORE_TLZ_H */
@@ -14,6 +14,14 @@ int tbl_verify_job(const char *repo_root,
                    const char *jobid,
                    char *err, size_t errsz);
 
+/* Rehash the CAS object sha256hex (no events); out_bytes: bytes read.
+   Returns 0 ok, 1 integrity ("sha256 mismatch", "object missing"),
+   2 error (I/O). */
+int tbl_verify_object(const char *repo_root,
+                      const char *sha256hex,
+                      unsigned long *out_bytes,
+                      char *err, size_t errsz);
+
 #ifdef TBL_VERIFY_IMPLEMENTATION
 
 #include <stdio.h>
@@ -25,6 +33,7 @@ int tbl_verify_job(const char *repo_root,
 #include "core/sha256.h"
 #include "core/cas.h"
 #include "core/record.h"
+#include "core/recidx.h"
 #include "core/events.h"
 #include "os/fs.h"
 
@@ -36,10 +45,11 @@ static void tbl_verify_seterr(char *err, size_t errsz, const char *msg)
     (void)tbl_strlcpy(err, msg, errsz);
 }
 
-static int tbl_verify_hash_file(const char *path, char *out_hex, size_t out_hex_sz, char *err, size_t errsz)
+static int tbl_verify_hash_file(const char *path, char *out_hex, size_t out_hex_sz,
+                                unsigned long *out_bytes, char *err, size_t errsz)
 {
     FILE *fp;
-    unsigned char buf[16384];
+    unsigned char buf[65536];
     size_t rd;
     tbl_sha256_t st;
     unsigned char dig[32];
@@ -60,6 +70,7 @@ static int tbl_verify_hash_file(const char *path, char *out_hex, size_t out_hex_
     for (;;) {
         rd = fread(buf, 1, sizeof(buf), fp);
         if (rd > 0) tbl_sha256_update(&st, buf, rd);
+        if (out_bytes) *out_bytes += (unsigned long)rd;
         if (rd < sizeof(buf)) {
             if (ferror(fp)) {
                 fclose(fp);
@@ -81,15 +92,45 @@ static int tbl_verify_hash_file(const char *path, char *out_hex, size_t out_hex_
     return 0;
 }
 
+int tbl_verify_object(const char *repo_root,
+                      const char *sha256hex,
+                      unsigned long *out_bytes,
+                      char *err, size_t errsz)
+{
+    char objpath[1024];
+    char hex[65];
+    int ex;
+
+    if (err && errsz) err[0] = '\0';
+    if (out_bytes) *out_bytes = 0UL;
+    if (!tbl_cas_object_path(repo_root, sha256hex, objpath, sizeof(objpath))) {
+        tbl_verify_seterr(err, errsz, "object path too long");
+        return 2;
+    }
+
+    ex = 0;
+    (void)tbl_fs_exists(objpath, &ex);
+    if (!ex) {
+        tbl_verify_seterr(err, errsz, "object missing");
+        return 1;
+    }
+
+    hex[0] = '\0';
+    if (tbl_verify_hash_file(objpath, hex, sizeof(hex), out_bytes, err, errsz) != 0) return 2;
+
+    if (!tbl_streq(hex, sha256hex)) {
+        tbl_verify_seterr(err, errsz, "sha256 mismatch");
+        return 1;
+    }
+    return 0;
+}
+
 int tbl_verify_job(const char *repo_root,
                    const char *jobid,
                    char *err, size_t errsz)
 {
     tbl_record_t rec;
-    char objpath[1024];
-    char hex[65];
-    char recpath[1024];
-    int ex;
+    char msg[128];
     int rc;
 
     if (err && errsz) err[0] = '\0';
@@ -99,19 +140,18 @@ int tbl_verify_job(const char *repo_root,
     }
 
 
+    /* Indexed records skip records/ entirely. */
+    rc = tbl_recidx_get(repo_root, jobid, &rec, 0, 0);
+
     /* If the record does not exist yet, treat this as a "not verifiable" state,
        not a hard error. This is expected before the first ingest run. */
-    if (tbl_record_path(repo_root, jobid, recpath, sizeof(recpath))) {
-        ex = 0;
-        (void)tbl_fs_exists(recpath, &ex);
-        if (!ex) {
-            tbl_verify_seterr(err, errsz, "no record (run ingest first)");
-            (void)tbl_events_append(repo_root, "verify.skip", jobid, "norecord", "", "no record", 0, 0);
-            return 1;
-        }
+    if (rc != 0 && tbl_record_is_safe_id(jobid) && !tbl_record_exists_ok(repo_root, jobid)) {
+        tbl_verify_seterr(err, errsz, "no record (run ingest first)");
+        (void)tbl_events_append(repo_root, "verify.skip", jobid, "norecord", "", "no record", 0, 0);
+        return 1;
     }
 
-    rc = tbl_record_read_repo(repo_root, jobid, &rec, err, errsz);
+    if (rc != 0) rc = tbl_record_read_repo(repo_root, jobid, &rec, err, errsz);
     if (rc != 0) {
         (void)tbl_events_append(repo_root, "verify.error", jobid, "error", "", err && err[0] ? err : "record read failed", 0, 0);
         return 2;
@@ -129,31 +169,13 @@ int tbl_verify_job(const char *repo_root,
         return 1;
     }
 
-    if (!tbl_cas_object_path(repo_root, rec.sha256, objpath, sizeof(objpath))) {
-        tbl_verify_seterr(err, errsz, "object path too long");
-        (void)tbl_events_append(repo_root, "verify.error", jobid, "error", rec.sha256, "object path too long", 0, 0);
-        return 2;
-    }
-
-    ex = 0;
-    (void)tbl_fs_exists(objpath, &ex);
-    if (!ex) {
-        tbl_verify_seterr(err, errsz, "object missing");
-        (void)tbl_events_append(repo_root, "verify.fail", jobid, "fail", rec.sha256, "object missing", 0, 0);
-        return 2;
-    }
-
-    hex[0] = '\0';
-    rc = tbl_verify_hash_file(objpath, hex, sizeof(hex), err, errsz);
+    rc = tbl_verify_object(repo_root, rec.sha256, 0, msg, sizeof(msg));
     if (rc != 0) {
-        (void)tbl_events_append(repo_root, "verify.error", jobid, "error", rec.sha256, err && err[0] ? err : "hash failed", 0, 0);
-        return 2;
-    }
-
-    if (!tbl_streq(hex, rec.sha256)) {
-        tbl_verify_seterr(err, errsz, "sha256 mismatch");
-        (void)tbl_events_append(repo_root, "verify.fail", jobid, "fail", rec.sha256, "sha256 mismatch", 0, 0);
-        return 1;
+        tbl_verify_seterr(err, errsz, msg[0] ? msg : "hash failed");
+        (void)tbl_events_append(repo_root, (rc == 1) ? "verify.fail" : "verify.error", jobid,
+                                (rc == 1) ? "fail" : "error", rec.sha256, msg[0] ? msg : "hash failed", 0, 0);
+        /* a missing object stays a hard error here */
+        return (rc == 1 && !tbl_streq(msg, "object missing")) ? 1 : 2;
     }
 
     (void)tbl_events_append(repo_root, "verify.ok", jobid, "ok", rec.sha256, "", 0, 0);
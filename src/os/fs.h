@@ -16,6 +16,7 @@ unsigned long tbl_fs_pid_u32(void);
 /* Basic queries */
 int tbl_fs_exists(const char *path, int *out_exists);
 int tbl_fs_is_dir(const char *path, int *out_is_dir);
+int tbl_fs_mtime(const char *path, unsigned long *out_mtime); /* seconds since epoch (UTC) */
 
 /* Directory creation */
 int tbl_fs_mkdir_one(const char *path);     /* create one level (ok if exists as dir) */
@@ -27,19 +28,77 @@ int tbl_fs_rename_atomic(const char *src, const char *dst, int replace);
 
 /* File helpers */
 int tbl_fs_write_file(const char *path, const void *data, size_t len);
+int tbl_fs_set_readonly(const char *path); /* drop write permission (best effort) */
 
 /* Remove helpers */
 int tbl_fs_remove_file(const char *path);
 int tbl_fs_remove_dir(const char *path);
 int tbl_fs_rm_rf(const char *path); /* recursive delete (best effort) */
 
+/* Recursive delete that trusts is_dir from the caller and from directory listings
+   instead of probing each path again like tbl_fs_rm_rf: one stat per entry instead
+   of two. Listings that already carry the type (find data, Dir mode, d_type where
+   <dirent.h> exposes it) need none. Use for large trees. */
+int tbl_fs_rm_tree(const char *path, int is_dir);
+
 /* Directory listing (non-recursive) */
 int tbl_fs_list_dir(const char *dirpath, tbl_fs_list_cb cb, void *ud);
 
+/* Append-only file handle (kept open across writes).
+   Each tbl_fs_afile_write() is issued as one write call positioned at EOF
+   (O_APPEND / FILE_APPEND_DATA), so lines from one writer never interleave. */
+typedef struct tbl_fs_afile_s {
+#ifdef _WIN32
+    void *h;   /* HANDLE */
+#else
+    int fd;
+#endif
+    int is_open;
+} tbl_fs_afile_t;
+
+int tbl_fs_afile_open(tbl_fs_afile_t *f, const char *path); /* create if missing */
+int tbl_fs_afile_write(tbl_fs_afile_t *f, const void *data, size_t len);
+int tbl_fs_afile_sync(tbl_fs_afile_t *f);
+int tbl_fs_afile_close(tbl_fs_afile_t *f);
+int tbl_fs_afile_size(tbl_fs_afile_t *f, unsigned long *out_size);
+/* 1 if path still names the open file (not renamed away or replaced). */
+int tbl_fs_afile_same_ok(tbl_fs_afile_t *f, const char *path);
+
+/* Advisory exclusive lock shared by cooperating processes.
+   The lock file is created on open and never removed. acquire() blocks until
+   the lock is held: fcntl(F_SETLKW) write lock on POSIX, LockFileEx on
+   Windows. Where record locks are not available (Plan 9, or a file system
+   answering ENOLCK / EOPNOTSUPP) the lock falls back to the marker
+   "<path>.held", created exclusively and removed on release; a marker older
+   than TBL_FS_LOCK_STALE_SECONDS is taken as left by a crashed holder.
+   POSIX record locks belong to the process: use one lock handle per file
+   per process. */
+#ifndef TBL_FS_LOCK_STALE_SECONDS
+#define TBL_FS_LOCK_STALE_SECONDS 60UL
+#endif
+
+typedef struct tbl_fs_lock_s {
+#ifdef _WIN32
+    void *h;   /* HANDLE */
+#else
+    int fd;
+#endif
+    int is_open;
+    int is_held;
+    int use_marker;        /* fallback: "<path>.held" */
+    char marker[1100];
+} tbl_fs_lock_t;
+
+int tbl_fs_lock_open(tbl_fs_lock_t *l, const char *path);
+int tbl_fs_lock_acquire(tbl_fs_lock_t *l);
+int tbl_fs_lock_release(tbl_fs_lock_t *l);
+int tbl_fs_lock_close(tbl_fs_lock_t *l); /* releases */
+
 #ifdef TBL_FS_IMPLEMENTATION
 
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "core/safe.h"
 
@@ -52,8 +111,11 @@ int tbl_fs_list_dir(const char *dirpath, tbl_fs_list_cb cb, void *ud);
 #include <libc.h>
 #else
 #include <sys/stat.h>
+#include <sys/select.h>
+#include <sys/time.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #endif
 #endif
@@ -166,6 +228,47 @@ int tbl_fs_is_dir(const char *path, int *out_is_dir)
 #endif
 }
 
+int tbl_fs_mtime(const char *path, unsigned long *out_mtime)
+{
+    if (!out_mtime) return 1;
+    *out_mtime = 0;
+
+    if (!path || !path[0]) return 1;
+
+#ifdef _WIN32
+    {
+        WIN32_FILE_ATTRIBUTE_DATA fa;
+        ULARGE_INTEGER u;
+
+        if (!GetFileAttributesExA(path, GetFileExInfoStandard, &fa)) return 1;
+        u.LowPart = fa.ftLastWriteTime.dwLowDateTime;
+        u.HighPart = fa.ftLastWriteTime.dwHighDateTime;
+        /* FILETIME: 100ns ticks since 1601-01-01 */
+        if (u.QuadPart < 116444736000000000ULL) return 0;
+        *out_mtime = (unsigned long)((u.QuadPart - 116444736000000000ULL) / 10000000ULL);
+        return 0;
+    }
+#else
+#ifdef __PLAN9__
+    {
+        Dir *d = dirstat(path);
+        if (!d) return 1;
+        *out_mtime = (unsigned long)d->mtime;
+        free(d);
+        return 0;
+    }
+#else
+    {
+        struct stat st;
+        if (stat(path, &st) != 0) return 1;
+        if (st.st_mtime < 0) return 0;
+        *out_mtime = (unsigned long)st.st_mtime;
+        return 0;
+    }
+#endif
+#endif
+}
+
 int tbl_fs_mkdir_one(const char *path)
 {
     int isdir;
@@ -341,6 +444,33 @@ int tbl_fs_write_file(const char *path, const void *data, size_t len)
     return 0;
 }
 
+int tbl_fs_set_readonly(const char *path)
+{
+    if (!path || !path[0]) return 1;
+
+#ifdef _WIN32
+    {
+        DWORD a = GetFileAttributesA(path);
+        if (a == INVALID_FILE_ATTRIBUTES) return 1;
+        if (SetFileAttributesA(path, a | FILE_ATTRIBUTE_READONLY)) return 0;
+        return 1;
+    }
+#else
+#ifdef __PLAN9__
+    {
+        Dir d;
+        nulldir(&d);
+        d.mode = 0444;
+        if (dirwstat(path, &d) >= 0) return 0;
+        return 1;
+    }
+#else
+    if (chmod(path, 0444) == 0) return 0;
+    return 1;
+#endif
+#endif
+}
+
 int tbl_fs_remove_file(const char *path)
 {
     if (!path || !path[0]) return 1;
@@ -600,5 +730,420 @@ int tbl_fs_rm_rf(const char *path)
     return err ? 1 : 0;
 }
 
+static int tbl_fs_rm_tree_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    int *errp;
+    (void)name;
+
+    errp = (int *)ud;
+    if (tbl_fs_rm_tree(full, is_dir) != 0) *errp = 1;
+    return 0; /* keep going: delete as much as possible */
+}
+
+int tbl_fs_rm_tree(const char *path, int is_dir)
+{
+    int err;
+
+    if (!path || !path[0]) return 1;
+
+    if (!is_dir) {
+        return tbl_fs_remove_file(path);
+    }
+
+    err = 0;
+    if (tbl_fs_list_dir(path, tbl_fs_rm_tree_cb, &err) != 0) return 1;
+    if (tbl_fs_remove_dir(path) != 0) return 1;
+    return err ? 1 : 0;
+}
+
+int tbl_fs_afile_open(tbl_fs_afile_t *f, const char *path)
+{
+    if (!f) return 1;
+    f->is_open = 0;
+    if (!path || !path[0]) return 1;
+
+#ifdef _WIN32
+    {
+        HANDLE h;
+        h = CreateFileA(path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h == INVALID_HANDLE_VALUE) return 1;
+        f->h = (void *)h;
+    }
+#else
+#ifdef __PLAN9__
+    f->fd = open(path, OWRITE);
+    if (f->fd < 0) f->fd = create(path, OWRITE, 0644);
+    if (f->fd < 0) return 1;
+#else
+    f->fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (f->fd < 0) return 1;
+#endif
+#endif
+
+    f->is_open = 1;
+    return 0;
+}
+
+int tbl_fs_afile_write(tbl_fs_afile_t *f, const void *data, size_t len)
+{
+    const char *p;
+
+    if (!f || !f->is_open) return 1;
+    if (len == 0) return 0;
+    if (!data) return 1;
+
+    p = (const char *)data;
+
+#ifdef _WIN32
+    while (len > 0) {
+        DWORD chunk;
+        DWORD wr;
+        chunk = (len > 0x40000000UL) ? 0x40000000UL : (DWORD)len;
+        wr = 0;
+        if (!WriteFile((HANDLE)f->h, p, chunk, &wr, NULL) || wr == 0) return 1;
+        p += wr;
+        len -= (size_t)wr;
+    }
+    return 0;
+#else
+#ifdef __PLAN9__
+    while (len > 0) {
+        long n;
+        (void)seek(f->fd, 0, 2);
+        n = write(f->fd, p, (long)len);
+        if (n <= 0) return 1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+#else
+    while (len > 0) {
+        ssize_t n;
+        n = write(f->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        if (n == 0) return 1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+#endif
+#endif
+}
+
+int tbl_fs_afile_sync(tbl_fs_afile_t *f)
+{
+    if (!f || !f->is_open) return 1;
+
+#ifdef _WIN32
+    return FlushFileBuffers((HANDLE)f->h) ? 0 : 1;
+#else
+#ifdef __PLAN9__
+    return 0; /* writes are synchronous on the file server */
+#else
+    return (fsync(f->fd) == 0) ? 0 : 1;
+#endif
+#endif
+}
+
+int tbl_fs_afile_close(tbl_fs_afile_t *f)
+{
+    int rc;
+
+    if (!f || !f->is_open) return 0;
+    f->is_open = 0;
+
+#ifdef _WIN32
+    rc = CloseHandle((HANDLE)f->h) ? 0 : 1;
+#else
+    rc = (close(f->fd) == 0) ? 0 : 1;
+#endif
+    return rc;
+}
+
+int tbl_fs_afile_size(tbl_fs_afile_t *f, unsigned long *out_size)
+{
+    if (!out_size) return 1;
+    *out_size = 0UL;
+    if (!f || !f->is_open) return 1;
+
+#ifdef _WIN32
+    {
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx((HANDLE)f->h, &sz) || sz.QuadPart < 0) return 1;
+        *out_size = (unsigned long)sz.QuadPart;
+        return 0;
+    }
+#else
+#ifdef __PLAN9__
+    {
+        Dir *d = dirfstat(f->fd);
+        if (!d) return 1;
+        *out_size = (unsigned long)d->length;
+        free(d);
+        return 0;
+    }
+#else
+    {
+        struct stat st;
+        if (fstat(f->fd, &st) != 0 || st.st_size < 0) return 1;
+        *out_size = (unsigned long)st.st_size;
+        return 0;
+    }
+#endif
+#endif
+}
+
+int tbl_fs_afile_same_ok(tbl_fs_afile_t *f, const char *path)
+{
+    if (!f || !f->is_open || !path || !path[0]) return 0;
+
+#ifdef _WIN32
+    {
+        HANDLE h;
+        BY_HANDLE_FILE_INFORMATION a;
+        BY_HANDLE_FILE_INFORMATION b;
+        int same;
+
+        h = CreateFileA(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h == INVALID_HANDLE_VALUE) return 0;
+        same = GetFileInformationByHandle((HANDLE)f->h, &a) &&
+               GetFileInformationByHandle(h, &b) &&
+               a.dwVolumeSerialNumber == b.dwVolumeSerialNumber &&
+               a.nFileIndexHigh == b.nFileIndexHigh &&
+               a.nFileIndexLow == b.nFileIndexLow;
+        CloseHandle(h);
+        return same ? 1 : 0;
+    }
+#else
+#ifdef __PLAN9__
+    {
+        Dir *a;
+        Dir *b;
+        int same;
+
+        a = dirfstat(f->fd);
+        b = dirstat(path);
+        same = (a && b && a->qid.path == b->qid.path && a->dev == b->dev && a->type == b->type);
+        free(a);
+        free(b);
+        return same ? 1 : 0;
+    }
+#else
+    {
+        struct stat a;
+        struct stat b;
+
+        if (fstat(f->fd, &a) != 0 || stat(path, &b) != 0) return 0;
+        return (a.st_dev == b.st_dev && a.st_ino == b.st_ino) ? 1 : 0;
+    }
+#endif
+#endif
+}
+
+/* ---- advisory lock ---- */
+
+static void tbl_fs_lock_nap(void)
+{
+#ifdef _WIN32
+    Sleep(10);
+#else
+#ifdef __PLAN9__
+    sleep(10);
+#else
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 10000;
+    (void)select(0, NULL, NULL, NULL, &tv);
+#endif
+#endif
+}
+
+/* Marker fallback: exclusive create of "<path>.held". */
+static int tbl_fs_lock_marker_acquire(tbl_fs_lock_t *l)
+{
+    for (;;) {
+        unsigned long mt;
+        unsigned long now;
+        int busy;
+
+        busy = 0;
+#ifdef _WIN32
+        {
+            HANDLE h = CreateFileA(l->marker, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (h != INVALID_HANDLE_VALUE) {
+                CloseHandle(h);
+                l->is_held = 1;
+                return 0;
+            }
+            if (GetLastError() != ERROR_FILE_EXISTS) return 1;
+            busy = 1;
+        }
+#else
+#ifdef __PLAN9__
+        {
+            int fd = create(l->marker, OWRITE | OEXCL, 0644);
+            if (fd >= 0) {
+                close(fd);
+                l->is_held = 1;
+                return 0;
+            }
+            (void)tbl_fs_exists(l->marker, &busy);
+            if (!busy) return 1;
+        }
+#else
+        {
+            int fd = open(l->marker, O_WRONLY | O_CREAT | O_EXCL, 0644);
+            if (fd >= 0) {
+                (void)close(fd);
+                l->is_held = 1;
+                return 0;
+            }
+            if (errno == EINTR) continue;
+            if (errno != EEXIST) return 1;
+            busy = 1;
+        }
+#endif
+#endif
+
+        /* holds are short: an old marker was left by a crashed holder */
+        now = (unsigned long)time(0);
+        if (busy && tbl_fs_mtime(l->marker, &mt) == 0 && now > mt &&
+            now - mt > TBL_FS_LOCK_STALE_SECONDS) {
+            (void)tbl_fs_remove_file(l->marker);
+            continue;
+        }
+        tbl_fs_lock_nap();
+    }
+}
+
+int tbl_fs_lock_open(tbl_fs_lock_t *l, const char *path)
+{
+    if (!l) return 1;
+    l->is_open = 0;
+    l->is_held = 0;
+    l->use_marker = 0;
+    if (!path || !path[0] ||
+        !tbl_strlcpy_ok(l->marker, path, sizeof(l->marker)) ||
+        !tbl_strlcat_ok(l->marker, ".held", sizeof(l->marker))) {
+        return 1;
+    }
+
+#ifdef _WIN32
+    {
+        HANDLE h;
+        h = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h == INVALID_HANDLE_VALUE) return 1;
+        l->h = (void *)h;
+    }
+#else
+#ifdef __PLAN9__
+    /* no record locks: the marker is the lock */
+    l->fd = -1;
+    l->use_marker = 1;
+#else
+    l->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (l->fd < 0) return 1;
+#endif
+#endif
+
+    l->is_open = 1;
+    return 0;
+}
+
+int tbl_fs_lock_acquire(tbl_fs_lock_t *l)
+{
+    if (!l || !l->is_open) return 1;
+    if (l->is_held) return 0;
+    if (l->use_marker) return tbl_fs_lock_marker_acquire(l);
+
+#ifdef _WIN32
+    {
+        OVERLAPPED ov;
+        (void)memset(&ov, 0, sizeof(ov));
+        if (LockFileEx((HANDLE)l->h, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov)) {
+            l->is_held = 1;
+            return 0;
+        }
+    }
+#else
+#ifndef __PLAN9__
+    for (;;) {
+        struct flock fl;
+
+        (void)memset(&fl, 0, sizeof(fl));
+        fl.l_type = F_WRLCK;
+        fl.l_whence = SEEK_SET;
+        fl.l_start = 0;
+        fl.l_len = 0;
+        if (fcntl(l->fd, F_SETLKW, &fl) == 0) {
+            l->is_held = 1;
+            return 0;
+        }
+        if (errno == EINTR) continue;
+        if (errno != ENOLCK && errno != EOPNOTSUPP && errno != EINVAL) return 1;
+        break;
+    }
+#endif
+#endif
+
+    /* no record locks on this file system */
+    l->use_marker = 1;
+    return tbl_fs_lock_marker_acquire(l);
+}
+
+int tbl_fs_lock_release(tbl_fs_lock_t *l)
+{
+    int rc;
+
+    if (!l || !l->is_open || !l->is_held) return 0;
+    l->is_held = 0;
+    if (l->use_marker) return tbl_fs_remove_file(l->marker);
+
+    rc = 0;
+#ifdef _WIN32
+    {
+        OVERLAPPED ov;
+        (void)memset(&ov, 0, sizeof(ov));
+        if (!UnlockFileEx((HANDLE)l->h, 0, 1, 0, &ov)) rc = 1;
+    }
+#else
+#ifndef __PLAN9__
+    {
+        struct flock fl;
+
+        (void)memset(&fl, 0, sizeof(fl));
+        fl.l_type = F_UNLCK;
+        fl.l_whence = SEEK_SET;
+        fl.l_start = 0;
+        fl.l_len = 0;
+        if (fcntl(l->fd, F_SETLK, &fl) != 0) rc = 1;
+    }
+#endif
+#endif
+    return rc;
+}
+
+int tbl_fs_lock_close(tbl_fs_lock_t *l)
+{
+    int rc;
+
+    if (!l || !l->is_open) return 0;
+    rc = tbl_fs_lock_release(l);
+    l->is_open = 0;
+
+#ifdef _WIN32
+    if (!CloseHandle((HANDLE)l->h)) rc = 1;
+#else
+    if (l->fd >= 0 && close(l->fd) != 0) rc = 1;
+#endif
+    return rc;
+}
+
 #endif /* TBL_FS_IMPLEMENTATION */
 #endif /* TBL_OS_FS_H */
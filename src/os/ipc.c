@@ -0,0 +1,2 @@
+#define TBL_IPC_IMPLEMENTATION
+#include "os/ipc.h"
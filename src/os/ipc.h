@@ -0,0 +1,189 @@
+#ifndef TBL_OS_IPC_H
+#define TBL_OS_IPC_H
+
+#include <stddef.h>
+
+/* Local publish target for streamed lines.
+   - POSIX: a FIFO (open blocks until a reader is there) or a Unix stream
+     socket (connect to a listening consumer); SIGPIPE is ignored so a
+     consumer going away shows up as a failed write
+   - Windows: a named pipe (\\.\pipe\NAME) opened by the consumer
+   - Plan 9: any file that can be opened for writing (pipe, /srv entry)
+   A write sends all bytes or fails. */
+
+typedef struct tbl_ipc_sink_s {
+#ifdef _WIN32
+    void *h;   /* HANDLE */
+#else
+    int fd;
+#endif
+    int is_open;
+} tbl_ipc_sink_t;
+
+/* Returns 0 ok, 1 fail. */
+int tbl_ipc_sink_open(tbl_ipc_sink_t *s, const char *path);
+int tbl_ipc_sink_write(tbl_ipc_sink_t *s, const void *data, size_t len);
+void tbl_ipc_sink_close(tbl_ipc_sink_t *s);
+
+#ifdef TBL_IPC_IMPLEMENTATION
+
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+int tbl_ipc_sink_open(tbl_ipc_sink_t *s, const char *path)
+{
+    HANDLE h;
+
+    if (!s) return 1;
+    s->h = 0;
+    s->is_open = 0;
+    if (!path || !path[0]) return 1;
+
+    h = CreateFileA(path, GENERIC_WRITE, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (h == INVALID_HANDLE_VALUE) return 1;
+    if (GetFileType(h) != FILE_TYPE_PIPE) {
+        CloseHandle(h);
+        return 1;
+    }
+    s->h = (void *)h;
+    s->is_open = 1;
+    return 0;
+}
+
+int tbl_ipc_sink_write(tbl_ipc_sink_t *s, const void *data, size_t len)
+{
+    const char *p = (const char *)data;
+
+    if (!s || !s->is_open) return 1;
+    while (len > 0) {
+        DWORD put = 0;
+        DWORD chunk = (len > 0x40000000U) ? 0x40000000UL : (DWORD)len;
+
+        if (!WriteFile((HANDLE)s->h, p, chunk, &put, 0) || put == 0) return 1;
+        p += put;
+        len -= (size_t)put;
+    }
+    return 0;
+}
+
+void tbl_ipc_sink_close(tbl_ipc_sink_t *s)
+{
+    if (!s || !s->is_open) return;
+    CloseHandle((HANDLE)s->h);
+    s->h = 0;
+    s->is_open = 0;
+}
+
+#else
+#ifdef __PLAN9__
+#include <u.h>
+#include <libc.h>
+
+int tbl_ipc_sink_open(tbl_ipc_sink_t *s, const char *path)
+{
+    if (!s) return 1;
+    s->fd = -1;
+    s->is_open = 0;
+    if (!path || !path[0]) return 1;
+
+    s->fd = open(path, OWRITE);
+    if (s->fd < 0) return 1;
+    s->is_open = 1;
+    return 0;
+}
+
+int tbl_ipc_sink_write(tbl_ipc_sink_t *s, const void *data, size_t len)
+{
+    if (!s || !s->is_open) return 1;
+    return (write(s->fd, data, (long)len) == (long)len) ? 0 : 1;
+}
+
+void tbl_ipc_sink_close(tbl_ipc_sink_t *s)
+{
+    if (!s || !s->is_open) return;
+    close(s->fd);
+    s->fd = -1;
+    s->is_open = 0;
+}
+
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+int tbl_ipc_sink_open(tbl_ipc_sink_t *s, const char *path)
+{
+    struct stat st;
+    struct sockaddr_un sa;
+
+    if (!s) return 1;
+    s->fd = -1;
+    s->is_open = 0;
+    if (!path || !path[0] || stat(path, &st) != 0) return 1;
+
+    (void)signal(SIGPIPE, SIG_IGN);
+
+    if (S_ISFIFO(st.st_mode)) {
+        do {
+            s->fd = open(path, O_WRONLY);
+        } while (s->fd < 0 && errno == EINTR);
+        if (s->fd < 0) return 1;
+        s->is_open = 1;
+        return 0;
+    }
+
+    /* anything else must be a listening Unix socket */
+    if (strlen(path) >= sizeof(sa.sun_path)) return 1;
+    (void)memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    (void)memcpy(sa.sun_path, path, strlen(path) + 1U);
+
+    s->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s->fd < 0) return 1;
+    if (connect(s->fd, (struct sockaddr *)(void *)&sa, (socklen_t)sizeof(sa)) != 0) {
+        (void)close(s->fd);
+        s->fd = -1;
+        return 1;
+    }
+    s->is_open = 1;
+    return 0;
+}
+
+int tbl_ipc_sink_write(tbl_ipc_sink_t *s, const void *data, size_t len)
+{
+    const char *p = (const char *)data;
+
+    if (!s || !s->is_open) return 1;
+    while (len > 0) {
+        ssize_t n = write(s->fd, p, len);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+void tbl_ipc_sink_close(tbl_ipc_sink_t *s)
+{
+    if (!s || !s->is_open) return;
+    (void)close(s->fd);
+    s->fd = -1;
+    s->is_open = 0;
+}
+
+#endif
+#endif
+
+#endif /* TBL_IPC_IMPLEMENTATION */
+
+#endif /* TBL_OS_IPC_H */
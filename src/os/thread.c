@@ -0,0 +1,2 @@
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
@@ -0,0 +1,369 @@
+#ifndef TBL_OS_THREAD_H
+#define TBL_OS_THREAD_H
+
+/* Minimal threading layer (best effort).
+   - Windows: Win32 threads + CRITICAL_SECTION (+ CONDITION_VARIABLE, Vista+)
+   - POSIX:   pthreads
+   - Plan 9 or TBL_NO_THREADS=1: no threads; work runs sequentially on the
+     calling thread. Callers MUST NOT depend on real concurrency.
+*/
+
+#if defined(__PLAN9__) || (defined(TBL_NO_THREADS) && (TBL_NO_THREADS))
+#define TBL_HAVE_THREADS 0
+#else
+#define TBL_HAVE_THREADS 1
+#endif
+
+#if TBL_HAVE_THREADS
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
+
+/* Upper bound for tbl_thread_run() workers. */
+#define TBL_THREAD_MAX 64
+
+/* Worker entry: worker is 0..nworkers-1. */
+typedef void (*tbl_thread_fn)(void *ud, unsigned long worker);
+
+typedef struct tbl_mutex_s {
+#if TBL_HAVE_THREADS
+#ifdef _WIN32
+    CRITICAL_SECTION cs;
+#else
+    pthread_mutex_t mu;
+#endif
+#else
+    int unused;
+#endif
+} tbl_mutex_t;
+
+typedef struct tbl_cond_s {
+#if TBL_HAVE_THREADS
+#ifdef _WIN32
+    CONDITION_VARIABLE cv;
+#else
+    pthread_cond_t cv;
+#endif
+#else
+    int unused;
+#endif
+} tbl_cond_t;
+
+/* One long-running background thread (see tbl_thread_start_ok). */
+typedef struct tbl_thread_s {
+#if TBL_HAVE_THREADS
+#ifdef _WIN32
+    HANDLE h;
+#else
+    pthread_t th;
+#endif
+#endif
+    tbl_thread_fn fn;
+    void *ud;
+    int started;
+} tbl_thread_t;
+
+/* Number of online CPUs (>= 1, best effort). */
+unsigned long tbl_thread_cpu_count(void);
+
+/* Resolve a configured worker count: 0 = auto (cpu count), clamped to 1..TBL_THREAD_MAX. */
+unsigned long tbl_thread_workers(unsigned long configured);
+
+int tbl_mutex_init_ok(tbl_mutex_t *m);
+void tbl_mutex_lock(tbl_mutex_t *m);
+void tbl_mutex_unlock(tbl_mutex_t *m);
+void tbl_mutex_destroy(tbl_mutex_t *m);
+
+/* Condition variables; wait() may wake spuriously (re-check the predicate).
+   Without threads they do nothing. */
+int tbl_cond_init_ok(tbl_cond_t *c);
+void tbl_cond_wait(tbl_cond_t *c, tbl_mutex_t *m);
+void tbl_cond_signal(tbl_cond_t *c);
+void tbl_cond_broadcast(tbl_cond_t *c);
+void tbl_cond_destroy(tbl_cond_t *c);
+
+/* Start fn(ud, 0) on its own thread; join() waits for it to return.
+   Returns 0 if threads are unavailable or the thread cannot be started:
+   the caller then does the work on its own thread. */
+int tbl_thread_start_ok(tbl_thread_t *t, tbl_thread_fn fn, void *ud);
+void tbl_thread_join(tbl_thread_t *t);
+
+/* Run fn(ud, 0..nworkers-1) concurrently and join all of them.
+   Worker 0 runs on the calling thread. If threads are unavailable or a
+   thread cannot be started, that worker runs inline (sequentially). */
+void tbl_thread_run(unsigned long nworkers, tbl_thread_fn fn, void *ud);
+
+#ifdef TBL_THREAD_IMPLEMENTATION
+
+#if !defined(_WIN32) && !defined(__PLAN9__)
+#include <unistd.h>
+#endif
+
+typedef struct tbl_thread_slot_s {
+    tbl_thread_fn fn;
+    void *ud;
+    unsigned long worker;
+} tbl_thread_slot_t;
+
+unsigned long tbl_thread_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    if (si.dwNumberOfProcessors < 1) return 1UL;
+    return (unsigned long)si.dwNumberOfProcessors;
+#else
+#ifdef __PLAN9__
+    return 1UL;
+#else
+#ifdef _SC_NPROCESSORS_ONLN
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n < 1) return 1UL;
+        return (unsigned long)n;
+    }
+#else
+    return 1UL;
+#endif
+#endif
+#endif
+}
+
+unsigned long tbl_thread_workers(unsigned long configured)
+{
+    unsigned long n;
+
+    n = configured;
+    if (n == 0UL) n = tbl_thread_cpu_count();
+    if (n < 1UL) n = 1UL;
+    if (n > (unsigned long)TBL_THREAD_MAX) n = (unsigned long)TBL_THREAD_MAX;
+    return n;
+}
+
+#if TBL_HAVE_THREADS
+#ifdef _WIN32
+
+int tbl_mutex_init_ok(tbl_mutex_t *m)
+{
+    if (!m) return 0;
+    InitializeCriticalSection(&m->cs);
+    return 1;
+}
+
+void tbl_mutex_lock(tbl_mutex_t *m)    { if (m) EnterCriticalSection(&m->cs); }
+void tbl_mutex_unlock(tbl_mutex_t *m)  { if (m) LeaveCriticalSection(&m->cs); }
+void tbl_mutex_destroy(tbl_mutex_t *m) { if (m) DeleteCriticalSection(&m->cs); }
+
+int tbl_cond_init_ok(tbl_cond_t *c)
+{
+    if (!c) return 0;
+    InitializeConditionVariable(&c->cv);
+    return 1;
+}
+
+void tbl_cond_wait(tbl_cond_t *c, tbl_mutex_t *m) { if (c && m) (void)SleepConditionVariableCS(&c->cv, &m->cs, INFINITE); }
+void tbl_cond_signal(tbl_cond_t *c)    { if (c) WakeConditionVariable(&c->cv); }
+void tbl_cond_broadcast(tbl_cond_t *c) { if (c) WakeAllConditionVariable(&c->cv); }
+void tbl_cond_destroy(tbl_cond_t *c)   { (void)c; }
+
+static DWORD WINAPI tbl_thread_tramp(LPVOID p)
+{
+    tbl_thread_slot_t *s = (tbl_thread_slot_t *)p;
+    s->fn(s->ud, s->worker);
+    return 0;
+}
+
+static DWORD WINAPI tbl_thread_tramp1(LPVOID p)
+{
+    tbl_thread_t *t = (tbl_thread_t *)p;
+    t->fn(t->ud, 0UL);
+    return 0;
+}
+
+int tbl_thread_start_ok(tbl_thread_t *t, tbl_thread_fn fn, void *ud)
+{
+    if (!t || !fn) return 0;
+    t->fn = fn;
+    t->ud = ud;
+    t->h = CreateThread(NULL, 0, tbl_thread_tramp1, t, 0, NULL);
+    t->started = (t->h != NULL) ? 1 : 0;
+    return t->started;
+}
+
+void tbl_thread_join(tbl_thread_t *t)
+{
+    if (!t || !t->started) return;
+    (void)WaitForSingleObject(t->h, INFINITE);
+    CloseHandle(t->h);
+    t->started = 0;
+}
+
+void tbl_thread_run(unsigned long nworkers, tbl_thread_fn fn, void *ud)
+{
+    tbl_thread_slot_t slots[TBL_THREAD_MAX];
+    HANDLE th[TBL_THREAD_MAX];
+    unsigned long i;
+
+    if (!fn) return;
+    if (nworkers < 1UL) nworkers = 1UL;
+    if (nworkers > (unsigned long)TBL_THREAD_MAX) nworkers = (unsigned long)TBL_THREAD_MAX;
+
+    for (i = 1UL; i < nworkers; ++i) {
+        slots[i].fn = fn;
+        slots[i].ud = ud;
+        slots[i].worker = i;
+        th[i] = CreateThread(NULL, 0, tbl_thread_tramp, &slots[i], 0, NULL);
+    }
+
+    fn(ud, 0UL);
+
+    for (i = 1UL; i < nworkers; ++i) {
+        if (th[i] == NULL) {
+            fn(ud, i); /* could not start: run inline */
+            continue;
+        }
+        (void)WaitForSingleObject(th[i], INFINITE);
+        CloseHandle(th[i]);
+    }
+}
+
+#else /* POSIX */
+
+int tbl_mutex_init_ok(tbl_mutex_t *m)
+{
+    if (!m) return 0;
+    return (pthread_mutex_init(&m->mu, NULL) == 0) ? 1 : 0;
+}
+
+void tbl_mutex_lock(tbl_mutex_t *m)    { if (m) (void)pthread_mutex_lock(&m->mu); }
+void tbl_mutex_unlock(tbl_mutex_t *m)  { if (m) (void)pthread_mutex_unlock(&m->mu); }
+void tbl_mutex_destroy(tbl_mutex_t *m) { if (m) (void)pthread_mutex_destroy(&m->mu); }
+
+int tbl_cond_init_ok(tbl_cond_t *c)
+{
+    if (!c) return 0;
+    return (pthread_cond_init(&c->cv, NULL) == 0) ? 1 : 0;
+}
+
+void tbl_cond_wait(tbl_cond_t *c, tbl_mutex_t *m) { if (c && m) (void)pthread_cond_wait(&c->cv, &m->mu); }
+void tbl_cond_signal(tbl_cond_t *c)    { if (c) (void)pthread_cond_signal(&c->cv); }
+void tbl_cond_broadcast(tbl_cond_t *c) { if (c) (void)pthread_cond_broadcast(&c->cv); }
+void tbl_cond_destroy(tbl_cond_t *c)   { if (c) (void)pthread_cond_destroy(&c->cv); }
+
+static void *tbl_thread_tramp(void *p)
+{
+    tbl_thread_slot_t *s = (tbl_thread_slot_t *)p;
+    s->fn(s->ud, s->worker);
+    return NULL;
+}
+
+static void *tbl_thread_tramp1(void *p)
+{
+    tbl_thread_t *t = (tbl_thread_t *)p;
+    t->fn(t->ud, 0UL);
+    return NULL;
+}
+
+int tbl_thread_start_ok(tbl_thread_t *t, tbl_thread_fn fn, void *ud)
+{
+    if (!t || !fn) return 0;
+    t->fn = fn;
+    t->ud = ud;
+    t->started = (pthread_create(&t->th, NULL, tbl_thread_tramp1, t) == 0) ? 1 : 0;
+    return t->started;
+}
+
+void tbl_thread_join(tbl_thread_t *t)
+{
+    if (!t || !t->started) return;
+    (void)pthread_join(t->th, NULL);
+    t->started = 0;
+}
+
+void tbl_thread_run(unsigned long nworkers, tbl_thread_fn fn, void *ud)
+{
+    tbl_thread_slot_t slots[TBL_THREAD_MAX];
+    pthread_t th[TBL_THREAD_MAX];
+    int started[TBL_THREAD_MAX];
+    unsigned long i;
+
+    if (!fn) return;
+    if (nworkers < 1UL) nworkers = 1UL;
+    if (nworkers > (unsigned long)TBL_THREAD_MAX) nworkers = (unsigned long)TBL_THREAD_MAX;
+
+    for (i = 1UL; i < nworkers; ++i) {
+        slots[i].fn = fn;
+        slots[i].ud = ud;
+        slots[i].worker = i;
+        started[i] = (pthread_create(&th[i], NULL, tbl_thread_tramp, &slots[i]) == 0) ? 1 : 0;
+    }
+
+    fn(ud, 0UL);
+
+    for (i = 1UL; i < nworkers; ++i) {
+        if (!started[i]) {
+            fn(ud, i); /* could not start: run inline */
+            continue;
+        }
+        (void)pthread_join(th[i], NULL);
+    }
+}
+
+#endif
+#else /* !TBL_HAVE_THREADS */
+
+int tbl_mutex_init_ok(tbl_mutex_t *m)
+{
+    if (!m) return 0;
+    m->unused = 0;
+    return 1;
+}
+
+void tbl_mutex_lock(tbl_mutex_t *m)    { (void)m; }
+void tbl_mutex_unlock(tbl_mutex_t *m)  { (void)m; }
+void tbl_mutex_destroy(tbl_mutex_t *m) { (void)m; }
+
+int tbl_cond_init_ok(tbl_cond_t *c)
+{
+    if (!c) return 0;
+    c->unused = 0;
+    return 1;
+}
+
+void tbl_cond_wait(tbl_cond_t *c, tbl_mutex_t *m) { (void)c; (void)m; }
+void tbl_cond_signal(tbl_cond_t *c)    { (void)c; }
+void tbl_cond_broadcast(tbl_cond_t *c) { (void)c; }
+void tbl_cond_destroy(tbl_cond_t *c)   { (void)c; }
+
+int tbl_thread_start_ok(tbl_thread_t *t, tbl_thread_fn fn, void *ud)
+{
+    (void)fn;
+    (void)ud;
+    if (t) t->started = 0;
+    return 0;
+}
+
+void tbl_thread_join(tbl_thread_t *t) { (void)t; }
+
+void tbl_thread_run(unsigned long nworkers, tbl_thread_fn fn, void *ud)
+{
+    unsigned long i;
+
+    if (!fn) return;
+    if (nworkers < 1UL) nworkers = 1UL;
+    if (nworkers > (unsigned long)TBL_THREAD_MAX) nworkers = (unsigned long)TBL_THREAD_MAX;
+
+    for (i = 0UL; i < nworkers; ++i) {
+        fn(ud, i);
+    }
+}
+
+#endif /* TBL_HAVE_THREADS */
+
+#endif /* TBL_THREAD_IMPLEMENTATION */
+
+#endif /* TBL_OS_THREAD_H */
@@ -4,6 +4,10 @@
 /* Sleep for ms (best effort). */
 void tbl_sleep_ms(unsigned long ms);
 
+/* Microsecond clock for measuring short intervals (end - start, unsigned).
+   Not wall time; wraps around. */
+unsigned long tbl_time_us(void);
+
 #ifdef TBL_TIME_IMPLEMENTATION
 
 #ifdef _WIN32
@@ -15,6 +19,16 @@ void tbl_sleep_ms(unsigned long ms)
     Sleep((DWORD)ms);
 }
 
+unsigned long tbl_time_us(void)
+{
+    LARGE_INTEGER f;
+    LARGE_INTEGER c;
+
+    if (!QueryPerformanceFrequency(&f) || f.QuadPart <= 0 || !QueryPerformanceCounter(&c)) return 0UL;
+    return (unsigned long)((c.QuadPart / f.QuadPart) * 1000000 +
+                           ((c.QuadPart % f.QuadPart) * 1000000) / f.QuadPart);
+}
+
 #else
 #ifdef __PLAN9__
 #include <u.h>
@@ -26,20 +40,42 @@ void tbl_sleep_ms(unsigned long ms)
     sleep((long)ms);
 }
 
+unsigned long tbl_time_us(void)
+{
+    return (unsigned long)(nsec() / 1000);
+}
+
 #else
+#include <sys/select.h>
+#include <sys/time.h>
+#include <errno.h>
 #include <unistd.h>
 
-/* POSIX sleep granularity: seconds; we do a simple ms->sec rounding up */
+/* select() with no descriptors: millisecond sleep, restarted on signals */
 void tbl_sleep_ms(unsigned long ms)
 {
-    unsigned long sec;
+    unsigned long t0;
+    unsigned long spent;
+
+    t0 = tbl_time_us();
+    spent = 0UL;
+    while (spent < ms) {
+        struct timeval tv;
+        unsigned long left = ms - spent;
 
-    sec = ms / 1000UL;
-    if ((ms % 1000UL) != 0UL) {
-        sec++;
+        tv.tv_sec = (long)(left / 1000UL);
+        tv.tv_usec = (long)((left % 1000UL) * 1000UL);
+        if (select(0, 0, 0, 0, &tv) == 0 || errno != EINTR) break;
+        spent = (tbl_time_us() - t0) / 1000UL;
     }
-    if (sec == 0UL) sec = 1UL;
-    sleep((unsigned int)sec);
+}
+
+unsigned long tbl_time_us(void)
+{
+    struct timeval tv;
+
+    if (gettimeofday(&tv, 0) != 0) return 0UL;
+    return (unsigned long)tv.tv_sec * 1000000UL + (unsigned long)tv.tv_usec;
 }
 #endif
 #endif
@@ -0,0 +1,2 @@
+#define TBL_WATCH_IMPLEMENTATION
+#include "os/watch.h"
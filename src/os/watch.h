@@ -0,0 +1,146 @@
+#ifndef TBL_OS_WATCH_H
+#define TBL_OS_WATCH_H
+
+/* Wait for a file to change.
+   tbl_watch_wait() returns as soon as <dir>/<name> is written, created or
+   moved into place, or when the timeout runs out, whichever comes first.
+   Linux uses inotify on dir (so a file that does not exist yet is covered);
+   elsewhere, or when inotify is not available, it just sleeps for the
+   timeout (polling). Callers re-check the file after every return. */
+
+typedef struct tbl_watch_s {
+    int fd;          /* inotify descriptor, -1 = polling */
+    int wd;
+    char name[256];
+} tbl_watch_t;
+
+/* Returns 0 = notifications armed, 1 = polling only. */
+int tbl_watch_open(tbl_watch_t *w, const char *dir, const char *name);
+void tbl_watch_wait(tbl_watch_t *w, unsigned long timeout_ms);
+void tbl_watch_close(tbl_watch_t *w);
+
+#ifdef TBL_WATCH_IMPLEMENTATION
+
+#include <string.h>
+
+#include "core/safe.h"
+#include "os/time.h"
+
+#if defined(__linux__) && !defined(TBL_NO_INOTIFY)
+#include <sys/inotify.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <unistd.h>
+
+int tbl_watch_open(tbl_watch_t *w, const char *dir, const char *name)
+{
+    if (!w) return 1;
+    w->fd = -1;
+    w->wd = -1;
+    w->name[0] = '\0';
+    if (!dir || !name || !tbl_strlcpy_ok(w->name, name, sizeof(w->name))) return 1;
+
+    w->fd = inotify_init();
+    if (w->fd < 0) return 1;
+    w->wd = inotify_add_watch(w->fd, dir, IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE);
+    if (w->wd < 0) {
+        (void)close(w->fd);
+        w->fd = -1;
+        return 1;
+    }
+    return 0;
+}
+
+/* 1 if the buffer holds an event for w->name */
+static int tbl_watch_hit(const tbl_watch_t *w, const char *buf, size_t n)
+{
+    size_t off = 0;
+
+    while (off + sizeof(struct inotify_event) <= n) {
+        const struct inotify_event *ev = (const struct inotify_event *)(const void *)(buf + off);
+
+        if (ev->len > 0U && strcmp(ev->name, w->name) == 0) return 1;
+        if (ev->mask & IN_Q_OVERFLOW) return 1;
+        off += sizeof(struct inotify_event) + ev->len;
+    }
+    return 0;
+}
+
+void tbl_watch_wait(tbl_watch_t *w, unsigned long timeout_ms)
+{
+    unsigned long t0;
+    unsigned long spent_ms;
+    /* aligned for struct inotify_event */
+    union { struct inotify_event ev; char b[4096]; } buf;
+
+    if (!w || w->fd < 0) {
+        tbl_sleep_ms(timeout_ms);
+        return;
+    }
+
+    t0 = tbl_time_us();
+    for (;;) {
+        fd_set rs;
+        struct timeval tv;
+        unsigned long left;
+        int rc;
+        long n;
+
+        spent_ms = (tbl_time_us() - t0) / 1000UL;
+        if (spent_ms >= timeout_ms) return;
+        left = timeout_ms - spent_ms;
+
+        FD_ZERO(&rs);
+        FD_SET(w->fd, &rs);
+        tv.tv_sec = (long)(left / 1000UL);
+        tv.tv_usec = (long)((left % 1000UL) * 1000UL);
+        rc = select(w->fd + 1, &rs, 0, 0, &tv);
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) return;
+
+        n = (long)read(w->fd, buf.b, sizeof(buf.b));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        if (tbl_watch_hit(w, buf.b, (size_t)n)) return;
+    }
+}
+
+void tbl_watch_close(tbl_watch_t *w)
+{
+    if (!w || w->fd < 0) return;
+    (void)close(w->fd);
+    w->fd = -1;
+    w->wd = -1;
+}
+
+#else
+
+int tbl_watch_open(tbl_watch_t *w, const char *dir, const char *name)
+{
+    (void)dir;
+    (void)name;
+    if (w) {
+        w->fd = -1;
+        w->wd = -1;
+        w->name[0] = '\0';
+    }
+    return 1;
+}
+
+void tbl_watch_wait(tbl_watch_t *w, unsigned long timeout_ms)
+{
+    (void)w;
+    tbl_sleep_ms(timeout_ms);
+}
+
+void tbl_watch_close(tbl_watch_t *w)
+{
+    (void)w;
+}
+
+#endif
+
+#endif /* TBL_WATCH_IMPLEMENTATION */
+
+#endif /* TBL_OS_WATCH_H */
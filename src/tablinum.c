@@ -1,23 +1,45 @@
 /* src/tablinum.c - Tablinum entrypoint (strict C89, fail-fast, tack-typisch) */
 #include "tablinum.h"
 
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
 #include "core/args.h"
 #include "core/audit.h"
+#include "core/colsnap.h"
 #include "core/config.h"
+#include "core/events.h"
+#include "core/evidx.h"
+#include "core/evquery.h"
 #include "core/export.h"
+#include "core/fts.h"
+#include "core/jobstore.h"
 #include "core/package.h"
 #include "core/pkgverify.h"
+#include "core/recidx.h"
 #include "core/record.h"
+#include "core/recjournal.h"
+#include "core/refidx.h"
+#include "core/scrub.h"
+#include "core/secidx.h"
+#include "core/tgidx.h"
+#include "core/tagidx.h"
 #include "core/ingest.h"
 #include "core/ini.h"
 #include "core/log.h"
+#include "core/merkle.h"
 #include "core/path.h"
 #include "core/safe.h"
+#include "core/sha256.h"
 #include "core/spool.h"
 #include "core/str.h"
 #include "core/verify.h"
 #include "os/time.h"
 #include "os/fs.h"
+#include "os/ipc.h"
+#include "os/thread.h"
 
 
 static int resolve_repo_root(char *out, size_t outsz, const tbl_cfg_t *cfg)
@@ -33,6 +55,19 @@ static int resolve_repo_root(char *out, size_t outsz, const tbl_cfg_t *cfg)
     return tbl_path_join2(out, outsz, cfg->root, cfg->repo);
 }
 
+static int resolve_spool_root(char *out, size_t outsz, const tbl_cfg_t *cfg)
+{
+    if (!out || outsz == 0 || !cfg) return 0;
+    out[0] = '\0';
+
+    if (cfg->spool[0] == '\0') return 0;
+
+    if (tbl_path_is_abs(cfg->spool)) {
+        return (tbl_strlcpy(out, cfg->spool, outsz) < outsz) ? 1 : 0;
+    }
+    return tbl_path_join2(out, outsz, cfg->root, cfg->spool);
+}
+
 static int run_verify(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
 {
     char repo_root[1024];
@@ -87,6 +122,48 @@ static int run_verify(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
     return TBL_EXIT_IO;
 }
 
+static void verify_all_progress(void *ud, const tbl_scrub_stats_t *st)
+{
+    (void)ud;
+    tbl_logf(TBL_LOG_INFO, "[verify-all] %lu/%lu checked, %lu MiB hashed", st->done, st->total,
+             st->bytes / 1048576UL);
+}
+
+static int run_verify_all(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    const char *what;
+    tbl_scrub_stats_t st;
+    unsigned long t0;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[verify-all] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+    what = app->scrub_objects ? "object(s)" : "record(s)";
+
+    t0 = tbl_time_us();
+    err[0] = '\0';
+    if (tbl_scrub_run(repo_root, app->scrub_objects ? TBL_SCRUB_OBJECTS : TBL_SCRUB_RECORDS, cfg->verify_threads,
+                      app->audit_full, verify_all_progress, 0, &st, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[verify-all] ERROR: %s", err[0] ? err : "verify-all failed");
+        return TBL_EXIT_IO;
+    }
+    if (st.resumed > 0UL) {
+        tbl_logf(TBL_LOG_INFO, "[verify-all] resumed after %lu %s", st.resumed, what);
+    }
+    tbl_logf(TBL_LOG_INFO, "[verify-all] %lu %s: %lu ok, %lu skipped, %lu failed, %lu error(s)",
+             st.done, what, st.ok, st.skipped, st.failed, st.errors);
+    tbl_logf(TBL_LOG_INFO, "[verify-all] %lu MiB hashed, %lu ms", st.bytes / 1048576UL,
+             (tbl_time_us() - t0) / 1000UL);
+
+    if (st.failed > 0UL) return TBL_EXIT_INTEGRITY;
+    if (st.errors > 0UL) return TBL_EXIT_IO;
+    return TBL_EXIT_OK;
+}
+
 static int run_export(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
 {
     char repo_root[1024];
@@ -119,11 +196,8 @@ static int run_export(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
 
     /* try to distinguish missing record from other I/O */
     {
-        char recpath[1024];
-        int ex = 0;
-        if (tbl_record_path(repo_root, app->jobid, recpath, sizeof(recpath))) {
-            (void)tbl_fs_exists(recpath, &ex);
-            if (!ex) return TBL_EXIT_NOTFOUND;
+        if (tbl_record_is_safe_id(app->jobid) && !tbl_record_exists_ok(repo_root, app->jobid)) {
+            return TBL_EXIT_NOTFOUND;
         }
     }
 
@@ -166,11 +240,8 @@ static int run_package(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
 
     /* missing record => notfound */
     {
-        char recpath[1024];
-        int ex = 0;
-        if (tbl_record_path(repo_root, app->jobid, recpath, sizeof(recpath))) {
-            (void)tbl_fs_exists(recpath, &ex);
-            if (!ex) return TBL_EXIT_NOTFOUND;
+        if (tbl_record_is_safe_id(app->jobid) && !tbl_record_exists_ok(repo_root, app->jobid)) {
+            return TBL_EXIT_NOTFOUND;
         }
     }
 
@@ -251,26 +322,487 @@ static int run_verify_audit(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
 {
     char repo_root[1024];
     char err[256];
+    unsigned long resumed;
+    unsigned long lines;
     int rc;
 
-    (void)app;
-
-    if (!cfg) return TBL_EXIT_USAGE;
+    if (!app || !cfg) return TBL_EXIT_USAGE;
     if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
         tbl_logf(TBL_LOG_ERROR, "[verify-audit] repo path resolve failed");
         return TBL_EXIT_NOTFOUND;
     }
 
     err[0] = '\0';
-    rc = tbl_audit_verify_ops(repo_root, err, sizeof(err));
+    /* the checkpoint is written by every run, resumed from only on request */
+    rc = tbl_audit_verify_ops_incr(repo_root, cfg->audit_verify_threads, app->audit_incremental ? 0 : 1,
+                                   &resumed, &lines, err, sizeof(err));
     if (rc == 0) {
-        tbl_logf(TBL_LOG_INFO, "[verify-audit] OK %s/audit/ops.log", repo_root);
+        char root_hex[65];
+        unsigned long size;
+
+        tbl_logf(TBL_LOG_INFO, "[verify-audit] OK %s/audit/ops.log (%lu line(s), %lu new)",
+                 repo_root, lines, lines - resumed);
+        if (resumed > 0UL) {
+            tbl_logf(TBL_LOG_WARN, "[verify-audit] lines 1..%lu not rehashed: taken from audit/ops.checkpoint, "
+                     "only the last %lu KiB before it re-checked", resumed, TBL_AUDIT_ANCHOR_BYTES / 1024UL);
+            tbl_logf(TBL_LOG_WARN, "[verify-audit] run without --incremental to re-check them");
+        }
+
+        /* checkpoint the Merkle root over the verified chain */
+        if (tbl_merkle_sync(repo_root, &size, root_hex, err, sizeof(err)) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[verify-audit] merkle: %s", err[0] ? err : "sync failed");
+            return TBL_EXIT_IO;
+        }
+        tbl_logf(TBL_LOG_INFO, "[verify-audit] merkle root %s (%lu leaves)", root_hex, size);
         return TBL_EXIT_OK;
     }
 
     tbl_logf(TBL_LOG_ERROR, "[verify-audit] FAIL: %s", err[0] ? err : "audit verify failed");
     return rc;
 }
+typedef struct audit_proof_s {
+    const char *repo_root;
+    const char *jobid;   /* NULL: select by leaf */
+    unsigned long leaf;
+    unsigned long size;
+    unsigned char root[32];
+    char root_hex[65];
+    unsigned long found;
+    int rc;
+} audit_proof_t;
+
+static int audit_proof_hex(const unsigned char h[32], char out[65])
+{
+    return tbl_sha256_hex_ok(h, out, 65);
+}
+
+/* " job=<jobid>" as a whole token */
+static int audit_line_has_job(const char *line, const char *jobid)
+{
+    const char *p;
+    size_t jl;
+
+    jl = strlen(jobid);
+    for (p = strstr(line, " job="); p; p = strstr(p + 1, " job=")) {
+        if (strncmp(p + 5, jobid, jl) == 0 && (p[5 + jl] == ' ' || p[5 + jl] == '\0')) return 1;
+    }
+    return 0;
+}
+
+/* One stanza: line, size, root, entry, then the path bottom-up. */
+static int audit_proof_emit(audit_proof_t *ap, unsigned long leaf, const char *line)
+{
+    unsigned char path[TBL_MERKLE_MAX_PATH][32];
+    unsigned char lh[32];
+    unsigned long n;
+    unsigned long i;
+    char nbuf[32];
+    char hex[65];
+    char err[256];
+
+    err[0] = '\0';
+    if (tbl_merkle_inclusion(ap->repo_root, leaf, ap->size, path, &n, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[audit-proof] %s", err[0] ? err : "proof failed");
+        ap->rc = TBL_EXIT_IO;
+        return 0;
+    }
+    tbl_merkle_leaf_hash(line, strlen(line), lh);
+    if (!tbl_merkle_verify_inclusion_ok(leaf, ap->size, lh, path, n, ap->root)) {
+        tbl_logf(TBL_LOG_ERROR, "[audit-proof] inclusion proof for line %lu does not verify (run verify-audit)",
+                 leaf + 1UL);
+        ap->rc = TBL_EXIT_INTEGRITY;
+        return 0;
+    }
+
+    (void)tbl_ul_to_dec_ok(leaf + 1UL, nbuf, sizeof(nbuf));
+    (void)tbl_fputs3_ok(stdout, "line=", nbuf, "\n");
+    (void)tbl_ul_to_dec_ok(ap->size, nbuf, sizeof(nbuf));
+    (void)tbl_fputs3_ok(stdout, "size=", nbuf, "\n");
+    (void)tbl_fputs3_ok(stdout, "root=", ap->root_hex, "\n");
+    (void)tbl_fputs3_ok(stdout, "entry=", line, "\n");
+    for (i = 0UL; i < n; ++i) {
+        (void)audit_proof_hex(path[i], hex);
+        (void)tbl_fputs3_ok(stdout, "path=", hex, "\n");
+    }
+    (void)tbl_fputs_ok(stdout, "\n");
+    return 1;
+}
+
+static int audit_proof_cb(void *ud, unsigned long leaf, const char *line, size_t len)
+{
+    audit_proof_t *ap = (audit_proof_t *)ud;
+    char buf[TBL_AUDIT_LINE_MAX];
+
+    if (leaf >= ap->size) return 1; /* appended after the sync */
+    if (!ap->jobid && leaf != ap->leaf) return 0;
+    if (len >= sizeof(buf)) return 2;
+    (void)memcpy(buf, line, len);
+    buf[len] = '\0';
+    if (ap->jobid && !audit_line_has_job(buf, ap->jobid)) return 0;
+
+    ap->found++;
+    if (!audit_proof_emit(ap, leaf, buf)) return 2;
+    return ap->jobid ? 0 : 1;
+}
+
+static int run_audit_proof(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    audit_proof_t ap;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[audit-proof] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    (void)memset(&ap, 0, sizeof(ap));
+    ap.repo_root = repo_root;
+    err[0] = '\0';
+    if (tbl_merkle_sync(repo_root, &ap.size, ap.root_hex, err, sizeof(err)) != 0 ||
+        tbl_merkle_root(repo_root, ap.size, ap.root, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[audit-proof] merkle: %s", err[0] ? err : "sync failed");
+        return TBL_EXIT_IO;
+    }
+    if (ap.size == 0UL) {
+        tbl_logf(TBL_LOG_ERROR, "[audit-proof] audit log is empty");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    /* consistency: the tree of SIZE leaves is a prefix of the current one */
+    if (app->proof_old_set) {
+        unsigned char path[TBL_MERKLE_MAX_PATH][32];
+        unsigned char old_root[32];
+        unsigned long n;
+        unsigned long i;
+        char nbuf[32];
+        char hex[65];
+
+        if (app->proof_old_size > ap.size) {
+            tbl_logf(TBL_LOG_ERROR, "[audit-proof] log has only %lu line(s)", ap.size);
+            return TBL_EXIT_NOTFOUND;
+        }
+        if (tbl_merkle_root(repo_root, app->proof_old_size, old_root, err, sizeof(err)) != 0 ||
+            tbl_merkle_consistency(repo_root, app->proof_old_size, ap.size, path, &n, err, sizeof(err)) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[audit-proof] %s", err[0] ? err : "proof failed");
+            return TBL_EXIT_IO;
+        }
+        if (!tbl_merkle_verify_consistency_ok(app->proof_old_size, ap.size, old_root, ap.root, path, n)) {
+            tbl_logf(TBL_LOG_ERROR, "[audit-proof] consistency proof does not verify (run verify-audit)");
+            return TBL_EXIT_INTEGRITY;
+        }
+
+        (void)tbl_ul_to_dec_ok(app->proof_old_size, nbuf, sizeof(nbuf));
+        (void)tbl_fputs3_ok(stdout, "old_size=", nbuf, "\n");
+        (void)audit_proof_hex(old_root, hex);
+        (void)tbl_fputs3_ok(stdout, "old_root=", hex, "\n");
+        (void)tbl_ul_to_dec_ok(ap.size, nbuf, sizeof(nbuf));
+        (void)tbl_fputs3_ok(stdout, "size=", nbuf, "\n");
+        (void)tbl_fputs3_ok(stdout, "root=", ap.root_hex, "\n");
+        for (i = 0UL; i < n; ++i) {
+            (void)audit_proof_hex(path[i], hex);
+            (void)tbl_fputs3_ok(stdout, "path=", hex, "\n");
+        }
+        return TBL_EXIT_OK;
+    }
+
+    /* inclusion: a line number (digits) or every line of a job */
+    if (tbl_parse_u32_ok(app->proof_target, &ap.leaf)) {
+        if (ap.leaf == 0UL || ap.leaf > ap.size) {
+            tbl_logf(TBL_LOG_ERROR, "[audit-proof] line %lu out of range (log has %lu line(s))", ap.leaf, ap.size);
+            return TBL_EXIT_NOTFOUND;
+        }
+        ap.leaf--;
+    } else {
+        ap.jobid = app->proof_target;
+    }
+
+    ap.rc = TBL_EXIT_OK;
+    if (tbl_merkle_each_line(repo_root, audit_proof_cb, &ap, err, sizeof(err)) != 0 && ap.rc == TBL_EXIT_OK) {
+        tbl_logf(TBL_LOG_ERROR, "[audit-proof] %s", err[0] ? err : "cannot read audit log");
+        return TBL_EXIT_IO;
+    }
+    if (ap.rc != TBL_EXIT_OK) return ap.rc;
+    if (ap.found == 0UL) {
+        tbl_logf(TBL_LOG_ERROR, "[audit-proof] no audit line for job %s", app->proof_target);
+        return TBL_EXIT_NOTFOUND;
+    }
+    return TBL_EXIT_OK;
+}
+
+static int run_events_index(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    unsigned long entries;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[events-index] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    err[0] = '\0';
+    if (tbl_evidx_build(repo_root, app->audit_full, &entries, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[events-index] FAIL: %s", err[0] ? err : "index build failed");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[events-index] OK %s/events.idx (%lu job line(s))", repo_root, entries);
+    return TBL_EXIT_OK;
+}
+
+typedef struct events_out_s {
+    unsigned long matched;
+    int failed;
+    tbl_ipc_sink_t *sink; /* --publish; NULL = stdout */
+} events_out_t;
+
+static int events_out_cb(void *ud, const char *line, size_t len)
+{
+    events_out_t *eo = (events_out_t *)ud;
+
+    if (eo->sink ? tbl_ipc_sink_write(eo->sink, line, len) != 0 : fwrite(line, 1, len, stdout) != len) {
+        eo->failed = 1;
+        return 1;
+    }
+    eo->matched++;
+    return 0;
+}
+
+/* follow: lines must have reached the consumer before the cursor moves */
+static int events_out_flush(void *ud)
+{
+    events_out_t *eo = (events_out_t *)ud;
+
+    if (eo->failed) return 1;
+    if (!eo->sink && fflush(stdout) != 0) {
+        eo->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int run_events_follow(const tbl_app_config_t *app, const char *repo_root, const tbl_evq_t *q)
+{
+    char err[256];
+    tbl_evq_follow_t f;
+    tbl_ipc_sink_t sink;
+    events_out_t eo;
+    unsigned long off;
+    int rc;
+
+    (void)memset(&f, 0, sizeof(f));
+    f.from = app->q_follow ? TBL_EVQ_FROM_END : 0UL;
+    if (app->q_from && (!tbl_parse_u32_ok(app->q_from, &f.from) || f.from == TBL_EVQ_FROM_END)) {
+        tbl_logf(TBL_LOG_ERROR, "[events] invalid --from-offset: %s", app->q_from);
+        return TBL_EXIT_USAGE;
+    }
+    f.cursor = app->q_cursor;
+    f.follow = app->q_follow;
+    f.flush = events_out_flush;
+
+    eo.matched = 0UL;
+    eo.failed = 0;
+    eo.sink = NULL;
+    if (app->q_publish) {
+        if (tbl_ipc_sink_open(&sink, app->q_publish) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[events] cannot open %s (FIFO or listening Unix socket)", app->q_publish);
+            return TBL_EXIT_IO;
+        }
+        eo.sink = &sink;
+    }
+
+    err[0] = '\0';
+    rc = tbl_evq_follow(repo_root, q, &f, events_out_cb, &eo, &off, err, sizeof(err));
+    if (eo.sink) tbl_ipc_sink_close(eo.sink);
+    if (rc != 0) {
+        if (eo.failed) {
+            tbl_logf(TBL_LOG_ERROR, "[events] FAIL: consumer gone at offset %lu", off);
+            return TBL_EXIT_IO;
+        }
+        tbl_logf(TBL_LOG_ERROR, "[events] FAIL: %s", err[0] ? err : "follow failed");
+        if (tbl_str_starts_with(err, "invalid") || tbl_str_starts_with(err, "offset")) return TBL_EXIT_USAGE;
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[events] %lu line(s) delivered, next offset %lu", eo.matched, off);
+    return TBL_EXIT_OK;
+}
+
+static int run_events(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    tbl_evq_t q;
+    events_out_t eo;
+    unsigned long now;
+    unsigned long scanned;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+
+    (void)memset(&q, 0, sizeof(q));
+    now = (unsigned long)time(NULL);
+    if (app->q_since) {
+        if (!tbl_evq_parse_time_ok(app->q_since, now, &q.since)) {
+            tbl_logf(TBL_LOG_ERROR, "[events] invalid --since: %s", app->q_since);
+            return TBL_EXIT_USAGE;
+        }
+        q.since_set = 1;
+    }
+    if (app->q_until) {
+        if (!tbl_evq_parse_time_ok(app->q_until, now, &q.until)) {
+            tbl_logf(TBL_LOG_ERROR, "[events] invalid --until: %s", app->q_until);
+            return TBL_EXIT_USAGE;
+        }
+        q.until_set = 1;
+    }
+    q.event = app->q_event;
+    q.status = app->q_status;
+    q.job = app->q_job;
+
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[events] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    if (app->q_follow || app->q_from || app->q_cursor || app->q_publish) {
+        return run_events_follow(app, repo_root, &q);
+    }
+
+    eo.matched = 0UL;
+    eo.failed = 0;
+    eo.sink = NULL;
+    err[0] = '\0';
+    if (tbl_evq_run(repo_root, &q, events_out_cb, &eo, &scanned, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[events] FAIL: %s", err[0] ? err : "query failed");
+        return TBL_EXIT_IO;
+    }
+    if (eo.failed || fflush(stdout) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[events] FAIL: cannot write output");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[events] %lu match(es), %lu byte(s) of events.log read", eo.matched, scanned);
+    return TBL_EXIT_OK;
+}
+
+static int run_migrate_jobs(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    unsigned long jobs;
+    unsigned long lines;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[migrate-jobs] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    err[0] = '\0';
+    if (tbl_jobstore_migrate(repo_root, &jobs, &lines, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[migrate-jobs] FAIL: %s", err[0] ? err : "migration failed");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[migrate-jobs] OK %lu job(s), %lu line(s) moved", jobs, lines);
+    tbl_logf(TBL_LOG_INFO, "[migrate-jobs] job store: %s/jobstore", repo_root);
+    return TBL_EXIT_OK;
+}
+
+static int run_migrate_records(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    unsigned long moved;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[migrate-records] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    err[0] = '\0';
+    /* store = journal: import into the journal, even before the first ingest */
+    if (tbl_record_migrate(repo_root, &moved, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[migrate-records] FAIL: %s", err[0] ? err : "migration failed");
+        return TBL_EXIT_IO;
+    }
+    if (cfg->records_journal) {
+        tbl_logf(TBL_LOG_INFO, "[migrate-records] OK %lu record(s) imported into the journal", moved);
+        tbl_logf(TBL_LOG_INFO, "[migrate-records] journal: %s/recjournal", repo_root);
+        return TBL_EXIT_OK;
+    }
+    tbl_logf(TBL_LOG_INFO, "[migrate-records] OK %lu record(s) moved into shards", moved);
+    tbl_logf(TBL_LOG_INFO, "[migrate-records] records: %s/records", repo_root);
+    return TBL_EXIT_OK;
+}
+
+static int run_compress_audit(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    unsigned long segs;
+    unsigned long raw;
+    unsigned long comp;
+    int rc;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[compress-audit] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    err[0] = '\0';
+    rc = tbl_audit_compress_segments(repo_root, 1UL, cfg->audit_verify_threads,
+                                     &segs, &raw, &comp, err, sizeof(err));
+    if (rc != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[compress-audit] FAIL: %s", err[0] ? err : "compression failed");
+        return rc;
+    }
+    tbl_logf(TBL_LOG_INFO, "[compress-audit] OK %lu segment(s), %lu -> %lu byte(s)", segs, raw, comp);
+    return TBL_EXIT_OK;
+}
+
+static int run_spool_prune(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char spool_root[1024];
+    char err[256];
+    tbl_spool_t sp;
+    unsigned long now;
+    unsigned long age;
+    unsigned long cutoff;
+    unsigned long removed;
+    int rc;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+
+    if (!resolve_spool_root(spool_root, sizeof(spool_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[spool-prune] spool path resolve failed");
+        return TBL_EXIT_SCHEMA;
+    }
+
+    err[0] = '\0';
+    if (tbl_spool_init(&sp, spool_root, err, sizeof(err)) != TBL_SPOOL_OK) {
+        tbl_logf(TBL_LOG_ERROR, "[spool-prune] %s", err[0] ? err : "spool init failed");
+        return TBL_EXIT_IO;
+    }
+
+    now = (unsigned long)time(NULL);
+    /* args caps the days; clamp anyway so the product cannot wrap on 32-bit unsigned long */
+    age = (app->older_than_days > ULONG_MAX / 86400UL) ? ULONG_MAX : app->older_than_days * 86400UL;
+    cutoff = (now > age) ? (now - age) : 0UL;
+
+    removed = 0UL;
+    err[0] = '\0';
+    rc = tbl_spool_prune(&sp, cutoff, cfg->spool_prune_threads, &removed, err, sizeof(err));
+    if (rc != TBL_SPOOL_OK) {
+        tbl_logf(TBL_LOG_ERROR, "[spool-prune] FAIL after %lu job(s): %s", removed, err[0] ? err : "prune failed");
+        return TBL_EXIT_IO;
+    }
+
+    tbl_logf(TBL_LOG_INFO, "[spool-prune] OK removed %lu job(s) older than %lu day(s)", removed, app->older_than_days);
+    return TBL_EXIT_OK;
+}
+
 static int run_all(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
 {
     (void)app;
@@ -293,6 +825,7 @@ static int run_ingest(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
 {
     char err[256];
     unsigned long jobs_done;
+    tbl_ingest_stats_t st;
 
     (void)app;
 
@@ -302,22 +835,571 @@ static int run_ingest(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
     tbl_logf(TBL_LOG_INFO, "[ingest] running (spool=%s, poll=%lu s, once=%lu, max_jobs=%lu)",
              cfg->spool, cfg->ingest_poll_seconds, cfg->ingest_once, cfg->ingest_max_jobs);
 
-    if (tbl_ingest_run_ex(cfg, &jobs_done, err, sizeof(err)) != 0) {
+    if (tbl_ingest_run_stats(cfg, &jobs_done, &st, err, sizeof(err)) != 0) {
         tbl_logf(TBL_LOG_ERROR, "%s", err[0] ? err : "ingest failed");
         return 2;
     }
 
     tbl_logf(TBL_LOG_INFO, "[ingest] done (%lu job(s))", jobs_done);
+    tbl_logf(TBL_LOG_INFO, "[ingest] audit lock: %lu acquisition(s), wait %lu us, hold %lu us (max %lu us), %lu head reload(s)",
+             st.lock.count, st.lock.wait_us, st.lock.hold_us, st.lock.hold_max_us, st.lock.reloads);
+    if (st.events_async) {
+        tbl_logf(TBL_LOG_INFO, "[ingest] async events: %lu full-ring wait(s), %lu write error(s)",
+                 st.events_full_waits, st.events_errors);
+    }
+    if (st.audit_dropped > 0UL) {
+        tbl_logf(TBL_LOG_WARN, "[ingest] ops audit: %lu event(s) not chained into audit/ops.log: %s",
+                 st.audit_dropped, st.audit_err[0] ? st.audit_err : "ops.log unavailable");
+        tbl_logf(TBL_LOG_WARN, "[ingest] run verify-audit and repair audit/ops.log");
+    }
     return 0;
 }
 
 static int run_index(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
 {
-    (void)app;
-    (void)cfg;
+    char repo_root[1024];
+    char err[256];
+    unsigned long entries;
+    unsigned long objects;
+    unsigned long refs;
+    tbl_fts_stats_t fst;
 
-    tbl_logf(TBL_LOG_ERROR, "[index] not implemented yet (db=%s)", cfg->db);
-    return 2;
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[index] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    err[0] = '\0';
+    /* --rebuild: the record-derived indexes from scratch; ingest keeps them
+       current otherwise, so the default run only feeds the full-text index */
+    if (app->index_rebuild) {
+        if (tbl_recidx_build(repo_root, &entries, err, sizeof(err)) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[index] FAIL: %s", err[0] ? err : "index build failed");
+            return TBL_EXIT_IO;
+        }
+        tbl_logf(TBL_LOG_INFO, "[index] OK %s/index/records.idx (%lu record(s))", repo_root, entries);
+
+        if (tbl_refidx_build(repo_root, &objects, &refs, err, sizeof(err)) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[index] FAIL: %s", err[0] ? err : "refs index build failed");
+            return TBL_EXIT_IO;
+        }
+        tbl_logf(TBL_LOG_INFO, "[index] OK refs.idx (%lu object(s), %lu reference(s))", objects, refs);
+
+        if (tbl_secidx_build(repo_root, &entries, err, sizeof(err)) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[index] FAIL: %s", err[0] ? err : "secondary index build failed");
+            return TBL_EXIT_IO;
+        }
+        tbl_logf(TBL_LOG_INFO, "[index] OK sec runs (%lu record(s) by time, status and size)", entries);
+
+        if (tbl_tgidx_build(repo_root, &entries, &objects, err, sizeof(err)) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[index] FAIL: %s", err[0] ? err : "trigram index build failed");
+            return TBL_EXIT_IO;
+        }
+        tbl_logf(TBL_LOG_INFO, "[index] OK trigram.idx (%lu job(s), %lu trigram(s))", entries, objects);
+
+        if (tbl_tagidx_build(repo_root, &objects, &refs, err, sizeof(err)) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[index] FAIL: %s", err[0] ? err : "tag index build failed");
+            return TBL_EXIT_IO;
+        }
+        tbl_logf(TBL_LOG_INFO, "[index] OK tags.idx (%lu tag value(s), %lu tag(s))", objects, refs);
+    }
+
+    if (app->index_snapshot) {
+        if (tbl_colsnap_build(repo_root, &entries, err, sizeof(err)) != 0) {
+            tbl_logf(TBL_LOG_ERROR, "[index] FAIL: %s", err[0] ? err : "snapshot build failed");
+            return TBL_EXIT_IO;
+        }
+        tbl_logf(TBL_LOG_INFO, "[index] OK records.col (%lu record(s), columnar snapshot)", entries);
+    }
+
+    /* full-text: new ingest events since cursors/fts (--follow: keep going,
+       --reset-cursor: from offset 0) */
+    if (tbl_fts_update(repo_root, app->index_reset_cursor, app->q_follow, &fst, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[index] FAIL: %s", err[0] ? err : "full-text index update failed");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[index] OK fts (%lu document(s) in %lu batch(es), %lu segment(s))", fst.docs,
+             fst.batches, fst.segments);
+    return TBL_EXIT_OK;
+}
+
+static int refs_print_cb(void *ud, const char *jobid)
+{
+    (void)ud;
+    return tbl_fputs_ok(stdout, jobid) && tbl_fputs_ok(stdout, "\n") ? 0 : 1;
+}
+
+typedef struct records_out_s {
+    unsigned long shown;
+    int failed;
+} records_out_t;
+
+/* stored_at=<n> status=<s> bytes=<n> job=<id> [sha256=<hex>] */
+static int records_out_cb(void *ud, const tbl_record_t *rec)
+{
+    records_out_t *ro = (records_out_t *)ud;
+    char at[32];
+    char bytes[32];
+    int ok;
+
+    (void)tbl_ul_to_dec_ok(rec->stored_at, at, sizeof(at));
+    (void)tbl_ul_to_dec_ok(rec->bytes, bytes, sizeof(bytes));
+    ok = tbl_fputs3_ok(stdout, "stored_at=", at, " status=") && tbl_fputs_ok(stdout, rec->status) &&
+         tbl_fputs3_ok(stdout, " bytes=", bytes, " job=") && tbl_fputs_ok(stdout, rec->job);
+    if (ok && rec->sha256[0]) ok = tbl_fputs_ok(stdout, " sha256=") && tbl_fputs_ok(stdout, rec->sha256);
+    if (ok) ok = tbl_fputs_ok(stdout, "\n");
+    if (!ok) {
+        ro->failed = 1;
+        return 1;
+    }
+    ro->shown++;
+    return 0;
+}
+
+static int run_records(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    tbl_secidx_q_t q;
+    records_out_t ro;
+    unsigned long now;
+    unsigned long hits;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+
+    (void)memset(&q, 0, sizeof(q));
+    now = (unsigned long)time(NULL);
+    if (app->q_since) {
+        if (!tbl_evq_parse_time_ok(app->q_since, now, &q.since)) {
+            tbl_logf(TBL_LOG_ERROR, "[records] invalid --since: %s", app->q_since);
+            return TBL_EXIT_USAGE;
+        }
+        q.since_set = 1;
+    }
+    if (app->q_until) {
+        if (!tbl_evq_parse_time_ok(app->q_until, now, &q.until)) {
+            tbl_logf(TBL_LOG_ERROR, "[records] invalid --until: %s", app->q_until);
+            return TBL_EXIT_USAGE;
+        }
+        q.until_set = 1;
+    }
+    if (app->q_min_bytes) {
+        if (!tbl_parse_u32_ok(app->q_min_bytes, &q.min_bytes)) {
+            tbl_logf(TBL_LOG_ERROR, "[records] invalid --min-bytes: %s", app->q_min_bytes);
+            return TBL_EXIT_USAGE;
+        }
+        q.min_set = 1;
+    }
+    if (app->q_max_bytes) {
+        if (!tbl_parse_u32_ok(app->q_max_bytes, &q.max_bytes)) {
+            tbl_logf(TBL_LOG_ERROR, "[records] invalid --max-bytes: %s", app->q_max_bytes);
+            return TBL_EXIT_USAGE;
+        }
+        q.max_set = 1;
+    }
+    if (app->q_limit && (!tbl_parse_u32_ok(app->q_limit, &q.limit) || q.limit == 0UL)) {
+        tbl_logf(TBL_LOG_ERROR, "[records] invalid --limit: %s", app->q_limit);
+        return TBL_EXIT_USAGE;
+    }
+    q.status = app->q_status;
+    q.desc = app->q_desc;
+
+    /* the narrowest index: size when asked for, else status, else time */
+    if (app->q_by && tbl_streq(app->q_by, "bytes")) q.by = TBL_SECIDX_BY_BYTES;
+    else if (q.status) q.by = TBL_SECIDX_BY_STATUS;
+    else q.by = TBL_SECIDX_BY_TIME;
+
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[records] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    ro.shown = 0UL;
+    ro.failed = 0;
+    err[0] = '\0';
+    if (tbl_secidx_scan(repo_root, &q, records_out_cb, &ro, &hits, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[records] FAIL: %s", err[0] ? err : "scan failed");
+        return TBL_EXIT_IO;
+    }
+    if (ro.failed || fflush(stdout) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[records] FAIL: cannot write output");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[records] %lu record(s)", ro.shown);
+    return TBL_EXIT_OK;
+}
+
+static const unsigned long *g_stats_reason_n;
+
+/* most frequent first, then by dictionary order */
+static int stats_cmp_reason(const void *x, const void *y)
+{
+    unsigned long a = *(const unsigned long *)x;
+    unsigned long b = *(const unsigned long *)y;
+
+    if (g_stats_reason_n[a] != g_stats_reason_n[b]) return (g_stats_reason_n[a] > g_stats_reason_n[b]) ? -1 : 1;
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+/* "<a>/<b>" with two decimals, "-" for b = 0 */
+static void stats_ratio(unsigned long a, unsigned long b, char *out, size_t outsz)
+{
+    char ip[32];
+    char fp[4];
+    unsigned long frac;
+
+    if (b == 0UL) {
+        (void)tbl_strlcpy(out, "-", outsz);
+        return;
+    }
+    frac = (b < 0x01000000UL) ? (a % b) * 100UL / b : (a % b) / (b / 100UL);
+    (void)tbl_ul_to_dec_ok(a / b, ip, sizeof(ip));
+    fp[0] = (char)('0' + (int)(frac / 10UL));
+    fp[1] = (char)('0' + (int)(frac % 10UL));
+    fp[2] = '\0';
+    (void)tbl_strlcpy(out, ip, outsz);
+    (void)tbl_strlcat(out, ".", outsz);
+    (void)tbl_strlcat(out, fp, outsz);
+}
+
+static int stats_kv_ok(const char *key, unsigned long v)
+{
+    char nbuf[32];
+
+    (void)tbl_ul_to_dec_ok(v, nbuf, sizeof(nbuf));
+    return tbl_fputs3_ok(stdout, key, "=", nbuf);
+}
+
+#define STATS_TOP_REASONS 20UL
+
+static int stats_print_ok(const tbl_colsnap_t *cs, const tbl_colsnap_stats_t *st)
+{
+    char day[16];
+    char ratio[48];
+    unsigned long *ix;
+    unsigned long m = 0UL;
+    unsigned long i;
+    int ok;
+
+    /* records=N ok=N fail=N other=N undated=N */
+    ok = stats_kv_ok("records", st->n[0]) && stats_kv_ok(" ok", st->n[TBL_COLSNAP_OK]) &&
+         stats_kv_ok(" fail", st->n[TBL_COLSNAP_FAIL]) && stats_kv_ok(" other", st->n[TBL_COLSNAP_OTHER]) &&
+         stats_kv_ok(" undated", st->undated) && tbl_fputs_ok(stdout, "\n");
+
+    /* bytes=N ok_bytes=N unique=N unique_bytes=N dedup=R (ok bytes per unique byte) */
+    stats_ratio(st->bytes[TBL_COLSNAP_OK], st->uniq_bytes, ratio, sizeof(ratio));
+    ok = ok && stats_kv_ok("bytes", st->bytes[0]) && stats_kv_ok(" ok_bytes", st->bytes[TBL_COLSNAP_OK]) &&
+         stats_kv_ok(" unique", st->uniq_n) && stats_kv_ok(" unique_bytes", st->uniq_bytes) &&
+         tbl_fputs3_ok(stdout, " dedup=", ratio, "\n");
+
+    /* day=YYYY-MM-DD records=N fail=N bytes=N */
+    for (i = 0UL; ok && i < st->ndays; ++i) {
+        if (st->day_n[i] == 0UL) continue;
+        ok = tbl_colsnap_day_str(st->day0 + i, day, sizeof(day)) && tbl_fputs2_ok(stdout, "day=", day) &&
+             stats_kv_ok(" records", st->day_n[i]) && stats_kv_ok(" fail", st->day_fail[i]) &&
+             stats_kv_ok(" bytes", st->day_bytes[i]) && tbl_fputs_ok(stdout, "\n");
+    }
+
+    /* fail=N reason=<text>, most frequent first */
+    ix = (unsigned long *)malloc(((size_t)cs->ndict + 1U) * sizeof(unsigned long));
+    if (!ix) return 0;
+    for (i = 0UL; i <= cs->ndict; ++i) {
+        if (st->reason_n[i] != 0UL) ix[m++] = i;
+    }
+    g_stats_reason_n = st->reason_n;
+    qsort(ix, (size_t)m, sizeof(ix[0]), stats_cmp_reason);
+    for (i = 0UL; ok && i < m && i < STATS_TOP_REASONS; ++i) {
+        ok = stats_kv_ok("fail", st->reason_n[ix[i]]) &&
+             tbl_fputs3_ok(stdout, " reason=", ix[i] ? cs->reasons[ix[i]] : "-", "\n");
+    }
+    free(ix);
+    return ok;
+}
+
+static int run_stats(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    tbl_colsnap_t cs;
+    tbl_colsnap_q_t q;
+    tbl_colsnap_stats_t st;
+    unsigned long now;
+    unsigned long t0;
+    int rc;
+
+    if (!app || !cfg) return TBL_EXIT_USAGE;
+
+    (void)memset(&q, 0, sizeof(q));
+    now = (unsigned long)time(NULL);
+    if (app->q_since) {
+        if (!tbl_evq_parse_time_ok(app->q_since, now, &q.since)) {
+            tbl_logf(TBL_LOG_ERROR, "[stats] invalid --since: %s", app->q_since);
+            return TBL_EXIT_USAGE;
+        }
+        q.since_set = 1;
+    }
+    if (app->q_until) {
+        if (!tbl_evq_parse_time_ok(app->q_until, now, &q.until)) {
+            tbl_logf(TBL_LOG_ERROR, "[stats] invalid --until: %s", app->q_until);
+            return TBL_EXIT_USAGE;
+        }
+        q.until_set = 1;
+    }
+    if (app->q_status) q.status = tbl_colsnap_code(app->q_status);
+
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[stats] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    t0 = tbl_time_us();
+    err[0] = '\0';
+    rc = tbl_colsnap_load(&cs, repo_root, 0, err, sizeof(err));
+    if (rc == 1) {
+        tbl_logf(TBL_LOG_ERROR, "[stats] no index/records.col (run: tablinum index --snapshot)");
+        return TBL_EXIT_NOTFOUND;
+    }
+    if (rc != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[stats] FAIL: %s", err[0] ? err : "cannot load snapshot");
+        return TBL_EXIT_INTEGRITY;
+    }
+    if (tbl_colsnap_stats(&cs, &q, 0UL, &st, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[stats] FAIL: %s", err[0] ? err : "aggregation failed");
+        tbl_colsnap_free(&cs);
+        return TBL_EXIT_IO;
+    }
+    rc = stats_print_ok(&cs, &st) && fflush(stdout) == 0;
+    tbl_colsnap_stats_free(&st);
+    tbl_colsnap_free(&cs);
+    if (!rc) {
+        tbl_logf(TBL_LOG_ERROR, "[stats] FAIL: cannot write output");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[stats] %lu record(s), %lu ms", st.n[0],
+             (tbl_time_us() - t0) / 1000UL);
+    return TBL_EXIT_OK;
+}
+
+#define SEARCH_LIMIT_DEFAULT 20UL
+#define SEARCH_LIMIT_MAX     10000UL
+
+/* score=<n.nnn> job=<id> */
+static int search_print_ok(const tbl_fts_hit_t *h)
+{
+    char ip[32];
+    char fp[4];
+    unsigned long frac = h->score % 1000UL;
+
+    (void)tbl_ul_to_dec_ok(h->score / 1000UL, ip, sizeof(ip));
+    fp[0] = (char)('0' + (int)(frac / 100UL));
+    fp[1] = (char)('0' + (int)(frac / 10UL % 10UL));
+    fp[2] = (char)('0' + (int)(frac % 10UL));
+    fp[3] = '\0';
+    return tbl_fputs4_ok(stdout, "score=", ip, ".", fp) && tbl_fputs3_ok(stdout, " job=", h->job, "\n");
+}
+
+static int run_search(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    tbl_fts_query_t q;
+    tbl_fts_hit_t *hits;
+    unsigned long limit = SEARCH_LIMIT_DEFAULT;
+    unsigned long n;
+    unsigned long total;
+    unsigned long t0;
+    unsigned long i;
+    int ok;
+
+    if (!app || !cfg || !app->search_query) return TBL_EXIT_USAGE;
+    if (app->q_limit && (!tbl_parse_u32_ok(app->q_limit, &limit) || limit == 0UL || limit > SEARCH_LIMIT_MAX)) {
+        tbl_logf(TBL_LOG_ERROR, "[search] invalid --limit: %s", app->q_limit);
+        return TBL_EXIT_USAGE;
+    }
+    if (!tbl_fts_query_parse_ok(&q, app->search_query)) {
+        tbl_logf(TBL_LOG_ERROR, "[search] invalid query: %s", app->search_query);
+        return TBL_EXIT_USAGE;
+    }
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[search] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+    hits = (tbl_fts_hit_t *)malloc((size_t)limit * sizeof(tbl_fts_hit_t));
+    if (!hits) {
+        tbl_logf(TBL_LOG_ERROR, "[search] FAIL: out of memory");
+        return TBL_EXIT_IO;
+    }
+
+    t0 = tbl_time_us();
+    err[0] = '\0';
+    if (tbl_fts_search(repo_root, &q, hits, limit, &n, &total, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[search] FAIL: %s", err[0] ? err : "search failed");
+        free(hits);
+        return TBL_EXIT_INTEGRITY;
+    }
+    ok = 1;
+    for (i = 0UL; ok && i < n; ++i) ok = search_print_ok(&hits[i]);
+    free(hits);
+    if (!ok || fflush(stdout) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[search] FAIL: cannot write output");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[search] %lu match(es), %lu ms", total, (tbl_time_us() - t0) / 1000UL);
+    return (total > 0UL) ? TBL_EXIT_OK : TBL_EXIT_NOTFOUND;
+}
+
+typedef struct find_out_s {
+    unsigned long shown;
+    unsigned long limit;
+    int failed;
+} find_out_t;
+
+/* job=<id> payload=<name> */
+static int find_out_cb(void *ud, const char *jobid, const char *payload)
+{
+    find_out_t *fo = (find_out_t *)ud;
+
+    if (!tbl_fputs3_ok(stdout, "job=", jobid, " payload=") || !tbl_fputs2_ok(stdout, payload, "\n")) {
+        fo->failed = 1;
+        return 1;
+    }
+    fo->shown++;
+    return (fo->limit != 0UL && fo->shown >= fo->limit) ? 1 : 0;
+}
+
+static int run_find(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    find_out_t fo;
+    unsigned long n;
+    unsigned long t0;
+
+    if (!app || !cfg || !app->find_fragment) return TBL_EXIT_USAGE;
+    fo.shown = 0UL;
+    fo.limit = 0UL;
+    fo.failed = 0;
+    if (app->q_limit && (!tbl_parse_u32_ok(app->q_limit, &fo.limit) || fo.limit == 0UL)) {
+        tbl_logf(TBL_LOG_ERROR, "[find] invalid --limit: %s", app->q_limit);
+        return TBL_EXIT_USAGE;
+    }
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[find] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    t0 = tbl_time_us();
+    err[0] = '\0';
+    if (tbl_tgidx_find(repo_root, app->find_fragment, find_out_cb, &fo, &n, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[find] FAIL: %s", err[0] ? err : "lookup failed");
+        return TBL_EXIT_INTEGRITY;
+    }
+    if (fo.failed || fflush(stdout) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[find] FAIL: cannot write output");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[find] %lu job(s), %lu ms", fo.shown, (tbl_time_us() - t0) / 1000UL);
+    return (fo.shown > 0UL) ? TBL_EXIT_OK : TBL_EXIT_NOTFOUND;
+}
+
+typedef struct tagged_out_s {
+    unsigned long shown;
+    unsigned long limit;
+    int failed;
+} tagged_out_t;
+
+static int tagged_out_cb(void *ud, const char *jobid)
+{
+    tagged_out_t *to = (tagged_out_t *)ud;
+
+    if (!tbl_fputs2_ok(stdout, jobid, "\n")) {
+        to->failed = 1;
+        return 1;
+    }
+    to->shown++;
+    return (to->limit != 0UL && to->shown >= to->limit) ? 1 : 0;
+}
+
+static int run_tagged(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char key[TBL_RECORD_TAG_KEY_MAX + 1];
+    char err[256];
+    const char *eq;
+    tagged_out_t to;
+    unsigned long n;
+    unsigned long t0;
+
+    if (!app || !cfg || !app->tag_query) return TBL_EXIT_USAGE;
+    to.shown = 0UL;
+    to.limit = 0UL;
+    to.failed = 0;
+    if (app->q_limit && (!tbl_parse_u32_ok(app->q_limit, &to.limit) || to.limit == 0UL)) {
+        tbl_logf(TBL_LOG_ERROR, "[tagged] invalid --limit: %s", app->q_limit);
+        return TBL_EXIT_USAGE;
+    }
+    eq = strchr(app->tag_query, '=');
+    if (!eq || eq == app->tag_query || (size_t)(eq - app->tag_query) >= sizeof(key)) {
+        tbl_logf(TBL_LOG_ERROR, "[tagged] not KEY=VALUE: %s", app->tag_query);
+        return TBL_EXIT_USAGE;
+    }
+    for (n = 0UL; n < (unsigned long)(eq - app->tag_query); ++n) {
+        char c = app->tag_query[n];
+        key[n] = (char)((c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+    }
+    key[n] = '\0';
+    if (!tbl_record_tag_key_ok(key) || !tbl_record_tag_value_ok(eq + 1)) {
+        tbl_logf(TBL_LOG_ERROR, "[tagged] invalid tag: %s", app->tag_query);
+        return TBL_EXIT_USAGE;
+    }
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[tagged] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    t0 = tbl_time_us();
+    err[0] = '\0';
+    if (tbl_tagidx_each(repo_root, key, eq + 1, tagged_out_cb, &to, &n, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[tagged] FAIL: %s", err[0] ? err : "lookup failed");
+        return TBL_EXIT_INTEGRITY;
+    }
+    if (to.failed || fflush(stdout) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[tagged] FAIL: cannot write output");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[tagged] %lu job(s), %lu ms", to.shown, (tbl_time_us() - t0) / 1000UL);
+    return (to.shown > 0UL) ? TBL_EXIT_OK : TBL_EXIT_NOTFOUND;
+}
+
+static int run_refs(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+    char err[256];
+    unsigned long jobs;
+    size_t i;
+
+    if (!app || !cfg || !app->refs_sha) return TBL_EXIT_USAGE;
+    for (i = 0; app->refs_sha[i]; ++i) {
+        char c = app->refs_sha[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) break;
+    }
+    if (i != 64U || app->refs_sha[i] != '\0') {
+        tbl_logf(TBL_LOG_ERROR, "[refs] not a sha256 (64 hex digits): %s", app->refs_sha);
+        return TBL_EXIT_USAGE;
+    }
+    if (!resolve_repo_root(repo_root, sizeof(repo_root), cfg)) {
+        tbl_logf(TBL_LOG_ERROR, "[refs] repo path resolve failed");
+        return TBL_EXIT_NOTFOUND;
+    }
+
+    err[0] = '\0';
+    if (tbl_refidx_each(repo_root, app->refs_sha, refs_print_cb, 0, &jobs, err, sizeof(err)) != 0) {
+        tbl_logf(TBL_LOG_ERROR, "[refs] FAIL: %s", err[0] ? err : "lookup failed");
+        return TBL_EXIT_IO;
+    }
+    tbl_logf(TBL_LOG_INFO, "[refs] %lu job(s)", jobs);
+    return (jobs > 0UL) ? TBL_EXIT_OK : TBL_EXIT_NOTFOUND;
 }
 
 static int run_worker(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
@@ -329,6 +1411,20 @@ static int run_worker(const tbl_app_config_t *app, const tbl_cfg_t *cfg)
     return 2;
 }
 
+/* [records] store picks the record engine for every role; a journal the
+   config does not select is not read */
+static void apply_record_store(const tbl_cfg_t *cfg)
+{
+    char repo_root[1024];
+
+    tbl_record_set_store(cfg->records_journal ? TBL_RECORD_STORE_JOURNAL : TBL_RECORD_STORE_FILES,
+                         cfg->records_ini_view ? 1 : 0);
+    if (!cfg->records_journal && resolve_repo_root(repo_root, sizeof(repo_root), cfg) &&
+        tbl_recjournal_active_ok(repo_root)) {
+        tbl_logf(TBL_LOG_WARN, "[records] store = files: records in %s/recjournal are not read", repo_root);
+    }
+}
+
 int main(int argc, char **argv)
 {
         int rc;
@@ -379,6 +1475,7 @@ int main(int argc, char **argv)
         if (rc == TBL_INI_EIO) return TBL_EXIT_IO;
         return TBL_EXIT_SCHEMA;
     }
+    apply_record_store(&cfg);
 
     switch (app.role) {
         case TBL_ROLE_ALL:    return run_all(&app, &cfg);
@@ -392,6 +1489,20 @@ int main(int argc, char **argv)
         case TBL_ROLE_INGEST_PACKAGE:return run_ingest_package(&app, &cfg);
         case TBL_ROLE_VERIFY_PACKAGE:return run_verify_package(&app);
         case TBL_ROLE_VERIFY_AUDIT:  return run_verify_audit(&app, &cfg);
+        case TBL_ROLE_SPOOL_PRUNE:   return run_spool_prune(&app, &cfg);
+        case TBL_ROLE_AUDIT_PROOF:   return run_audit_proof(&app, &cfg);
+        case TBL_ROLE_EVENTS_INDEX:  return run_events_index(&app, &cfg);
+        case TBL_ROLE_MIGRATE_JOBS:  return run_migrate_jobs(&app, &cfg);
+        case TBL_ROLE_MIGRATE_RECORDS: return run_migrate_records(&app, &cfg);
+        case TBL_ROLE_EVENTS:        return run_events(&app, &cfg);
+        case TBL_ROLE_COMPRESS_AUDIT: return run_compress_audit(&app, &cfg);
+        case TBL_ROLE_REFS:          return run_refs(&app, &cfg);
+        case TBL_ROLE_RECORDS:       return run_records(&app, &cfg);
+        case TBL_ROLE_STATS:         return run_stats(&app, &cfg);
+        case TBL_ROLE_SEARCH:        return run_search(&app, &cfg);
+        case TBL_ROLE_FIND:          return run_find(&app, &cfg);
+        case TBL_ROLE_TAGGED:        return run_tagged(&app, &cfg);
+        case TBL_ROLE_VERIFY_ALL:    return run_verify_all(&app, &cfg);
         default: break;
     }
 
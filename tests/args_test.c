@@ -148,9 +148,392 @@ static int test_verify_audit_subcmd(void)
     T_ASSERT_EQ_INT(rc, 0);
     T_ASSERT_EQ_INT(app.role, TBL_ROLE_VERIFY_AUDIT);
     T_ASSERT_STREQ(app.config_path, "c.ini");
+    T_ASSERT_EQ_INT(app.audit_full, 0);
     return 0;
 }
 
+static int test_verify_audit_full(void)
+{
+    tbl_app_config_t app;
+    char *argv12[] = { (char*)"tablinum", (char*)"verify-audit", (char*)"--full" };
+    char *argv13[] = { (char*)"tablinum", (char*)"verify", (char*)"jobOK", (char*)"--full" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv12, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_VERIFY_AUDIT);
+    T_ASSERT_EQ_INT(app.audit_full, 1);
+
+    /* strict: only valid with verify-audit */
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv13, &app), 2);
+
+    /* resuming from the checkpoint is opt-in, not with --full */
+    {
+        char *argv14[] = { (char*)"tablinum", (char*)"verify-audit", (char*)"--incremental" };
+        char *argv15[] = { (char*)"tablinum", (char*)"verify-audit", (char*)"--incremental", (char*)"--full" };
+        char *argv16[] = { (char*)"tablinum", (char*)"verify-all", (char*)"--incremental" };
+
+        T_ASSERT_EQ_INT(tbl_args_parse(2, argv14, &app), 0);
+        T_ASSERT_EQ_INT(app.audit_incremental, 0);
+        T_ASSERT_EQ_INT(tbl_args_parse(3, argv14, &app), 0);
+        T_ASSERT_EQ_INT(app.audit_incremental, 1);
+        T_ASSERT_EQ_INT(app.audit_full, 0);
+        T_ASSERT_EQ_INT(tbl_args_parse(4, argv15, &app), 2);
+        T_ASSERT_EQ_INT(tbl_args_parse(3, argv16, &app), 2);
+    }
+    return 0;
+}
+
+static int test_spool_prune_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv9[] = { (char*)"tablinum", (char*)"spool-prune", (char*)"--older-than", (char*)"30" };
+    char *argv10[] = { (char*)"tablinum", (char*)"spool-prune" };
+    char *argv11[] = { (char*)"tablinum", (char*)"verify", (char*)"jobOK", (char*)"--older-than=3" };
+    int rc = tbl_args_parse(4, argv9, &app);
+
+    T_ASSERT_EQ_INT(rc, 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_SPOOL_PRUNE);
+    T_ASSERT_EQ_INT(app.older_than_set, 1);
+    T_ASSERT_EQ_ULONG(app.older_than_days, 30UL);
+
+    /* strict: DAYS is required, and only valid with spool-prune */
+    T_ASSERT_EQ_INT(tbl_args_parse(2, argv10, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv11, &app), 2);
+    return 0;
+}
+
+static int test_audit_proof_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv14[] = { (char*)"tablinum", (char*)"audit-proof", (char*)"42" };
+    char *argv15[] = { (char*)"tablinum", (char*)"audit-proof", (char*)"--consistency", (char*)"10" };
+    char *argv16[] = { (char*)"tablinum", (char*)"audit-proof" };
+    char *argv17[] = { (char*)"tablinum", (char*)"audit-proof", (char*)"jobA", (char*)"--consistency=3" };
+    char *argv18[] = { (char*)"tablinum", (char*)"verify-audit", (char*)"--consistency=3" };
+    char *argv19[] = { (char*)"tablinum", (char*)"audit-proof", (char*)"--consistency=0" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv14, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_AUDIT_PROOF);
+    T_ASSERT_STREQ(app.proof_target, "42");
+    T_ASSERT_EQ_INT(app.proof_old_set, 0);
+
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv15, &app), 0);
+    T_ASSERT_EQ_INT(app.proof_old_set, 1);
+    T_ASSERT_EQ_ULONG(app.proof_old_size, 10UL);
+
+    /* strict: exactly one target; --consistency only with audit-proof */
+    T_ASSERT_EQ_INT(tbl_args_parse(2, argv16, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv17, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv18, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv19, &app), 2);
+    return 0;
+}
+
+static int test_events_index_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv20[] = { (char*)"tablinum", (char*)"events-index" };
+    char *argv21[] = { (char*)"tablinum", (char*)"events-index", (char*)"--full" };
+    char *argv22[] = { (char*)"tablinum", (char*)"events-index", (char*)"jobA" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(2, argv20, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_EVENTS_INDEX);
+    T_ASSERT_EQ_INT(app.audit_full, 0);
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv21, &app), 0);
+    T_ASSERT_EQ_INT(app.audit_full, 1);
+
+    /* strict: no positional argument */
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv22, &app), 2);
+    return 0;
+}
+
+static int test_migrate_jobs_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv23[] = { (char*)"tablinum", (char*)"migrate-jobs", (char*)"--config", (char*)"c.ini" };
+    char *argv24[] = { (char*)"tablinum", (char*)"migrate-jobs", (char*)"--full" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv23, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_MIGRATE_JOBS);
+    T_ASSERT_STREQ(app.config_path, "c.ini");
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv24, &app), 2);
+    return 0;
+}
+
+static int test_migrate_records_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv43[] = { (char*)"tablinum", (char*)"migrate-records", (char*)"--config", (char*)"c.ini" };
+    char *argv44[] = { (char*)"tablinum", (char*)"migrate-records", (char*)"extra" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv43, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_MIGRATE_RECORDS);
+    T_ASSERT_STREQ(app.config_path, "c.ini");
+
+    /* strict: no positional argument */
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv44, &app), 2);
+    return 0;
+}
+
+static int test_events_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv25[] = { (char*)"tablinum", (char*)"events", (char*)"--since", (char*)"1h",
+                       (char*)"--status=fail", (char*)"--event", (char*)"verify" };
+    char *argv26[] = { (char*)"tablinum", (char*)"events", (char*)"--job" };
+    char *argv27[] = { (char*)"tablinum", (char*)"verify", (char*)"jobOK", (char*)"--since=1h" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(7, argv25, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_EVENTS);
+    T_ASSERT_STREQ(app.q_since, "1h");
+    T_ASSERT_STREQ(app.q_status, "fail");
+    T_ASSERT_STREQ(app.q_event, "verify");
+    T_ASSERT(app.q_until == NULL);
+    T_ASSERT(app.q_job == NULL);
+
+    /* strict: filters need a value and the 'events' role */
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv26, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv27, &app), 2);
+    return 0;
+}
+
+static int test_events_follow(void)
+{
+    tbl_app_config_t app;
+    char *argv28[] = { (char*)"tablinum", (char*)"events", (char*)"--follow", (char*)"--from-offset", (char*)"0",
+                       (char*)"--cursor=indexer", (char*)"--publish", (char*)"/run/tbl.sock" };
+    char *argv29[] = { (char*)"tablinum", (char*)"verify-audit", (char*)"--follow" };
+    char *argv30[] = { (char*)"tablinum", (char*)"events", (char*)"--cursor" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(8, argv28, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_EVENTS);
+    T_ASSERT_EQ_INT(app.q_follow, 1);
+    T_ASSERT_STREQ(app.q_from, "0");
+    T_ASSERT_STREQ(app.q_cursor, "indexer");
+    T_ASSERT_STREQ(app.q_publish, "/run/tbl.sock");
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv29, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv30, &app), 2);
+    return 0;
+}
+
+static int test_compress_audit_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv31[] = { (char*)"tablinum", (char*)"compress-audit", (char*)"--config", (char*)"c.ini" };
+    char *argv32[] = { (char*)"tablinum", (char*)"compress-audit", (char*)"--full" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv31, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_COMPRESS_AUDIT);
+    T_ASSERT_STREQ(app.config_path, "c.ini");
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv32, &app), 2);
+    return 0;
+}
+
+static int test_index_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv33[] = { (char*)"tablinum", (char*)"index", (char*)"--config", (char*)"c.ini" };
+    char *argv34[] = { (char*)"tablinum", (char*)"index", (char*)"jobA" };
+    char *argv71[] = { (char*)"tablinum", (char*)"index", (char*)"--rebuild" };
+    char *argv72[] = { (char*)"tablinum", (char*)"index", (char*)"--full" };
+    char *argv73[] = { (char*)"tablinum", (char*)"records", (char*)"--rebuild" };
+    char *argv74[] = { (char*)"tablinum", (char*)"verify-all", (char*)"--reset-cursor" };
+
+    /* default: only the full-text cursor is fed */
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv33, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_INDEX);
+    T_ASSERT_STREQ(app.config_path, "c.ini");
+    T_ASSERT_EQ_INT(app.index_rebuild, 0);
+    T_ASSERT_EQ_INT(app.index_reset_cursor, 0);
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv34, &app), 2);
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv71, &app), 0);
+    T_ASSERT_EQ_INT(app.index_rebuild, 1);
+    T_ASSERT_EQ_INT(app.index_reset_cursor, 0);
+
+    /* strict: --full is not an index option, --rebuild/--reset-cursor only with index */
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv72, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv73, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv74, &app), 2);
+    return 0;
+}
+
+static int test_snapshot_stats(void)
+{
+    tbl_app_config_t app;
+    char *argv45[] = { (char*)"tablinum", (char*)"index", (char*)"--snapshot" };
+    char *argv46[] = { (char*)"tablinum", (char*)"records", (char*)"--snapshot" };
+    char *argv47[] = { (char*)"tablinum", (char*)"stats", (char*)"--since", (char*)"2d", (char*)"--status=fail" };
+    char *argv48[] = { (char*)"tablinum", (char*)"stats", (char*)"--limit", (char*)"3" };
+    char *argv49[] = { (char*)"tablinum", (char*)"stats", (char*)"extra" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv45, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_INDEX);
+    T_ASSERT_EQ_INT(app.index_snapshot, 1);
+
+    /* strict: --snapshot only with index */
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv46, &app), 2);
+
+    T_ASSERT_EQ_INT(tbl_args_parse(5, argv47, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_STATS);
+    T_ASSERT_STREQ(app.q_since, "2d");
+    T_ASSERT_STREQ(app.q_status, "fail");
+    T_ASSERT_EQ_INT(app.index_snapshot, 0);
+
+    /* strict: records-only filters and positionals are rejected */
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv48, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv49, &app), 2);
+    return 0;
+}
+
+static int test_refs_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv35[] = { (char*)"tablinum", (char*)"refs", (char*)"abc123", (char*)"--config", (char*)"c.ini" };
+    char *argv36[] = { (char*)"tablinum", (char*)"refs" };
+    char *argv37[] = { (char*)"tablinum", (char*)"refs", (char*)"a", (char*)"b" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(5, argv35, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_REFS);
+    T_ASSERT_STREQ(app.refs_sha, "abc123");
+    T_ASSERT_STREQ(app.config_path, "c.ini");
+
+    T_ASSERT_EQ_INT(tbl_args_parse(2, argv36, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv37, &app), 2);
+    return 0;
+}
+
+static int test_records_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv38[] = { (char*)"tablinum", (char*)"records", (char*)"--status", (char*)"fail",
+                       (char*)"--since", (char*)"2026-10-13" };
+    char *argv39[] = { (char*)"tablinum", (char*)"records", (char*)"--by", (char*)"bytes",
+                       (char*)"--desc", (char*)"--limit=100", (char*)"--min-bytes", (char*)"10" };
+    char *argv40[] = { (char*)"tablinum", (char*)"records", (char*)"--by", (char*)"color" };
+    char *argv41[] = { (char*)"tablinum", (char*)"events", (char*)"--desc" };
+    char *argv42[] = { (char*)"tablinum", (char*)"records", (char*)"--job", (char*)"a" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(6, argv38, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_RECORDS);
+    T_ASSERT_STREQ(app.q_status, "fail");
+    T_ASSERT_STREQ(app.q_since, "2026-10-13");
+    T_ASSERT(app.q_by == NULL && !app.q_desc);
+
+    T_ASSERT_EQ_INT(tbl_args_parse(8, argv39, &app), 0);
+    T_ASSERT_STREQ(app.q_by, "bytes");
+    T_ASSERT_STREQ(app.q_limit, "100");
+    T_ASSERT_STREQ(app.q_min_bytes, "10");
+    T_ASSERT(app.q_desc);
+
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv40, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv41, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv42, &app), 2);
+    return 0;
+}
+
+static int test_search_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv50[] = { (char*)"tablinum", (char*)"search", (char*)"rechnung OR invoice", (char*)"--limit", (char*)"5" };
+    char *argv51[] = { (char*)"tablinum", (char*)"search" };
+    char *argv52[] = { (char*)"tablinum", (char*)"search", (char*)"a", (char*)"b" };
+    char *argv53[] = { (char*)"tablinum", (char*)"search", (char*)"a", (char*)"--desc" };
+    char *argv54[] = { (char*)"tablinum", (char*)"index", (char*)"--reset-cursor", (char*)"--follow" };
+    char *argv55[] = { (char*)"tablinum", (char*)"index", (char*)"--cursor", (char*)"x" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(5, argv50, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_SEARCH);
+    T_ASSERT_STREQ(app.search_query, "rechnung OR invoice");
+    T_ASSERT_STREQ(app.q_limit, "5");
+
+    /* strict: one QUERY argument, --limit is the only records option */
+    T_ASSERT_EQ_INT(tbl_args_parse(2, argv51, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv52, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv53, &app), 2);
+
+    /* index: --reset-cursor rebuilds, --follow keeps feeding the full-text index */
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv54, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_INDEX);
+    T_ASSERT(app.index_reset_cursor && app.q_follow);
+    T_ASSERT(!app.index_rebuild && !app.audit_full);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv55, &app), 2);
+    return 0;
+}
+
+static int test_find_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv56[] = { (char*)"tablinum", (char*)"find", (char*)"2026-0417", (char*)"--limit", (char*)"20" };
+    char *argv57[] = { (char*)"tablinum", (char*)"find" };
+    char *argv58[] = { (char*)"tablinum", (char*)"find", (char*)"a", (char*)"b" };
+    char *argv59[] = { (char*)"tablinum", (char*)"find", (char*)"a", (char*)"--desc" };
+    char *argv60[] = { (char*)"tablinum", (char*)"find", (char*)"a", (char*)"--full" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(5, argv56, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_FIND);
+    T_ASSERT_STREQ(app.find_fragment, "2026-0417");
+    T_ASSERT_STREQ(app.q_limit, "20");
+
+    /* strict: one FRAGMENT argument, --limit is the only option */
+    T_ASSERT_EQ_INT(tbl_args_parse(2, argv57, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv58, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv59, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv60, &app), 2);
+    return 0;
+}
+
+static int test_tagged_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv61[] = { (char*)"tablinum", (char*)"tagged", (char*)"customer=ACME GmbH", (char*)"--limit", (char*)"5" };
+    char *argv62[] = { (char*)"tablinum", (char*)"tagged" };
+    char *argv63[] = { (char*)"tablinum", (char*)"tagged", (char*)"customer" };
+    char *argv64[] = { (char*)"tablinum", (char*)"tagged", (char*)"=ACME" };
+    char *argv65[] = { (char*)"tablinum", (char*)"tagged", (char*)"a=b", (char*)"c=d" };
+    char *argv66[] = { (char*)"tablinum", (char*)"tagged", (char*)"a=b", (char*)"--desc" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(5, argv61, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_TAGGED);
+    T_ASSERT_STREQ(app.tag_query, "customer=ACME GmbH");
+    T_ASSERT_STREQ(app.q_limit, "5");
+
+    /* strict: one KEY=VALUE argument, --limit is the only option */
+    T_ASSERT_EQ_INT(tbl_args_parse(2, argv62, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv63, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv64, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv65, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv66, &app), 2);
+    return 0;
+}
+
+static int test_verify_all_subcmd(void)
+{
+    tbl_app_config_t app;
+    char *argv67[] = { (char*)"tablinum", (char*)"verify-all" };
+    char *argv68[] = { (char*)"tablinum", (char*)"verify-all", (char*)"--objects", (char*)"--full" };
+    char *argv69[] = { (char*)"tablinum", (char*)"verify", (char*)"jobA", (char*)"--objects" };
+    char *argv70[] = { (char*)"tablinum", (char*)"verify-all", (char*)"jobA" };
+
+    T_ASSERT_EQ_INT(tbl_args_parse(2, argv67, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_VERIFY_ALL);
+    T_ASSERT_EQ_INT(app.scrub_objects, 0);
+    T_ASSERT_EQ_INT(app.audit_full, 0);
+
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv68, &app), 0);
+    T_ASSERT_EQ_INT(app.role, TBL_ROLE_VERIFY_ALL);
+    T_ASSERT_EQ_INT(app.scrub_objects, 1);
+    T_ASSERT_EQ_INT(app.audit_full, 1);
+
+    /* strict: --objects only with verify-all, no job id */
+    T_ASSERT_EQ_INT(tbl_args_parse(4, argv69, &app), 2);
+    T_ASSERT_EQ_INT(tbl_args_parse(3, argv70, &app), 2);
+    return 0;
+}
 
 int main(void)
 {
@@ -164,5 +547,22 @@ int main(void)
     T_ASSERT(test_verify_package_subcmd() == 0);
     T_ASSERT(test_ingest_package_subcmd() == 0);
     T_ASSERT(test_verify_audit_subcmd() == 0);
+    T_ASSERT(test_verify_audit_full() == 0);
+    T_ASSERT(test_spool_prune_subcmd() == 0);
+    T_ASSERT(test_audit_proof_subcmd() == 0);
+    T_ASSERT(test_events_index_subcmd() == 0);
+    T_ASSERT(test_migrate_jobs_subcmd() == 0);
+    T_ASSERT(test_migrate_records_subcmd() == 0);
+    T_ASSERT(test_events_subcmd() == 0);
+    T_ASSERT(test_events_follow() == 0);
+    T_ASSERT(test_compress_audit_subcmd() == 0);
+    T_ASSERT(test_index_subcmd() == 0);
+    T_ASSERT(test_snapshot_stats() == 0);
+    T_ASSERT(test_refs_subcmd() == 0);
+    T_ASSERT(test_records_subcmd() == 0);
+    T_ASSERT(test_search_subcmd() == 0);
+    T_ASSERT(test_find_subcmd() == 0);
+    T_ASSERT(test_tagged_subcmd() == 0);
+    T_ASSERT(test_verify_all_subcmd() == 0);
     T_OK();
 }
@@ -19,6 +19,14 @@
 #define TBL_FS_IMPLEMENTATION
 #include "os/fs.h"
 
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_TLZ_IMPLEMENTATION
+#include "core/tlz.h"
+
+/* small windows so the chunked verifier crosses many window/chunk borders */
+#define TBL_AUDIT_CHUNK_BYTES 8192UL
 #define TBL_AUDIT_IMPLEMENTATION
 #include "core/audit.h"
 
@@ -42,6 +50,52 @@ static void hash_chain(const char prev64[65], const char *canonical, char out64[
     (void)tbl_sha256_hex(dig, out64, 65);
 }
 
+/* Write nlines chained entries; damage line bad (1-based) by kind:
+ * 0 none, 1 canonical tampered, 2 prev broken, 3 CR, 4 over-long line. */
+static int write_log(const char *path, unsigned long nlines, unsigned long bad, int kind)
+{
+    FILE *fp;
+    char prev[65];
+    char hash[65];
+    char canonical[2048];
+    char nbuf[32];
+    unsigned long i;
+    unsigned long pad;
+
+    fp = fopen(path, "wb");
+    if (!fp) return 0;
+
+    zero64(prev);
+    for (i = 1UL; i <= nlines; ++i) {
+        if (!tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf))) { fclose(fp); return 0; }
+        (void)tbl_strlcpy(canonical, "ts=", sizeof(canonical));
+        (void)tbl_strlcat(canonical, nbuf, sizeof(canonical));
+        (void)tbl_strlcat(canonical, " event=test job=J status=ok detail=", sizeof(canonical));
+        for (pad = 0UL; pad < (i * 7UL) % 97UL; ++pad) {
+            (void)tbl_strlcat(canonical, "x", sizeof(canonical));
+        }
+        hash_chain(prev, canonical, hash);
+
+        if (i == bad && kind == 1) (void)tbl_strlcat(canonical, "!", sizeof(canonical));
+        if (i == bad && kind == 2) prev[0] = (prev[0] == 'f') ? 'e' : 'f';
+        if (i == bad && kind == 3) (void)tbl_strlcat(canonical, "\r", sizeof(canonical));
+
+        fputs("prev=", fp);
+        fputs(prev, fp);
+        fputs(" hash=", fp);
+        fputs(hash, fp);
+        fputs(" ", fp);
+        fputs(canonical, fp);
+        if (i == bad && kind == 4) {
+            for (pad = 0UL; pad < 5000UL; ++pad) fputc('y', fp);
+        }
+        fputs("\n", fp);
+
+        (void)tbl_strlcpy(prev, hash, sizeof(prev));
+    }
+    return (fclose(fp) == 0) ? 1 : 0;
+}
+
 int main(void)
 {
     char root[256];
@@ -137,6 +191,121 @@ T_ASSERT(tbl_fs_mkdir_p(root) == 0);
     T_ASSERT_EQ_INT(rc, 5);
     T_ASSERT(err[0] != '\0');
 
+    /* parallel verifier: same verdict and first failing line for any worker count */
+    {
+        static const unsigned long threads[4] = { 1UL, 3UL, 8UL, 0UL };
+        static const unsigned long bad_lines[5] = { 1UL, 2UL, 117UL, 1500UL, 2000UL };
+        static const char *const reasons[5] = {
+            "", "hash mismatch", "prev mismatch", "CR found", "missing LF or line too long"
+        };
+        char want[256];
+        char nbuf[32];
+        unsigned long t;
+        unsigned long b;
+        int kind;
+
+        T_ASSERT(write_log(ops_path, 2000UL, 0UL, 0) == 1);
+        for (t = 0UL; t < 4UL; ++t) {
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_ex(root, threads[t], err, sizeof(err)), 0);
+        }
+
+        for (kind = 1; kind <= 4; ++kind) {
+            for (b = 0UL; b < 5UL; ++b) {
+                if (kind == 2 && bad_lines[b] == 1UL) continue; /* line 1 prev is all zeros anyway */
+                T_ASSERT(write_log(ops_path, 2000UL, bad_lines[b], kind) == 1);
+                T_ASSERT(tbl_ul_to_dec_ok(bad_lines[b], nbuf, sizeof(nbuf)));
+                (void)tbl_strlcpy(want, "audit integrity: line ", sizeof(want));
+                (void)tbl_strlcat(want, nbuf, sizeof(want));
+                (void)tbl_strlcat(want, ": ", sizeof(want));
+                (void)tbl_strlcat(want, reasons[kind], sizeof(want));
+                for (t = 0UL; t < 4UL; ++t) {
+                    err[0] = '\0';
+                    rc = tbl_audit_verify_ops_ex(root, threads[t], err, sizeof(err));
+                    T_ASSERT_EQ_INT(rc, 5);
+                    T_ASSERT_STREQ(err, want);
+                }
+            }
+        }
+
+        /* torn tail */
+        T_ASSERT(write_log(ops_path, 300UL, 0UL, 0) == 1);
+        {
+            FILE *fp = fopen(ops_path, "ab");
+            T_ASSERT(fp != NULL);
+            fputs("prev=00", fp);
+            fclose(fp);
+        }
+        for (t = 0UL; t < 4UL; ++t) {
+            rc = tbl_audit_verify_ops_ex(root, threads[t], err, sizeof(err));
+            T_ASSERT_EQ_INT(rc, 5);
+            T_ASSERT_STREQ(err, "audit integrity: line 301: missing LF or line too long");
+        }
+
+        /* checkpoint: first run is full, later runs only hash the new tail */
+        {
+            char cp_path[512];
+            unsigned long resumed;
+            unsigned long lines;
+            FILE *fp;
+
+            T_ASSERT(tbl_path_join2(cp_path, sizeof(cp_path), audit_dir, "ops.checkpoint"));
+            (void)tbl_fs_remove_file(cp_path);
+
+            T_ASSERT(write_log(ops_path, 500UL, 0UL, 0) == 1);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 2UL, 0, &resumed, &lines, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(resumed, 0UL);
+            T_ASSERT_EQ_ULONG(lines, 500UL);
+
+            /* the log grows (same chain, longer) */
+            T_ASSERT(write_log(ops_path, 800UL, 0UL, 0) == 1);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 2UL, 0, &resumed, &lines, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(resumed, 500UL);
+            T_ASSERT_EQ_ULONG(lines, 800UL);
+
+            /* nothing new */
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 0, &resumed, &lines, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(resumed, 800UL);
+            T_ASSERT_EQ_ULONG(lines, 800UL);
+
+            /* a broken new line is reported with its absolute line number */
+            T_ASSERT(write_log(ops_path, 900UL, 850UL, 1) == 1);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 3UL, 0, &resumed, &lines, err, sizeof(err)), 5);
+            T_ASSERT_STREQ(err, "audit integrity: line 850: hash mismatch");
+
+            /* history rewritten below the checkpoint: refuse to resume ... */
+            T_ASSERT(write_log(ops_path, 900UL, 799UL, 2) == 1);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 0, &resumed, &lines, err, sizeof(err)), 5);
+            T_ASSERT(strstr(err, "checkpoint") != NULL);
+            /* ... a full run finds the actual line */
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 1, &resumed, &lines, err, sizeof(err)), 5);
+            T_ASSERT_STREQ(err, "audit integrity: line 799: prev mismatch");
+
+            /* --full after repair rewrites the checkpoint */
+            T_ASSERT(write_log(ops_path, 900UL, 0UL, 0) == 1);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 1, &resumed, &lines, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(resumed, 0UL);
+            T_ASSERT_EQ_ULONG(lines, 900UL);
+
+            /* truncated log */
+            T_ASSERT(write_log(ops_path, 100UL, 0UL, 0) == 1);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 0, &resumed, &lines, err, sizeof(err)), 5);
+
+            /* malformed checkpoint: plain full run */
+            fp = fopen(cp_path, "wb");
+            T_ASSERT(fp != NULL);
+            fputs("offset=x\n", fp);
+            fclose(fp);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 0, &resumed, &lines, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(resumed, 0UL);
+            T_ASSERT_EQ_ULONG(lines, 100UL);
+            (void)tbl_fs_remove_file(cp_path);
+        }
+
+        /* empty log is valid */
+        T_ASSERT(tbl_fs_write_file(ops_path, "", 0) == 0);
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops_ex(root, 4UL, err, sizeof(err)), 0);
+    }
+
     (void)tbl_fs_rm_rf(root);
 
     T_OK();
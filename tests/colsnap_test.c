@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define T_TESTNAME "colsnap_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define TBL_COLSNAP_IMPLEMENTATION
+#include "core/colsnap.h"
+
+#define N_JOBS 900UL
+#define DAY0 19700UL
+
+static tbl_record_t g_recs[N_JOBS];
+static tbl_record_t g_walk[N_JOBS];
+static unsigned long g_nwalk;
+
+/* ok every 3rd is a duplicate payload; fail with 3 reasons; a few odd/undated */
+static void mk_rec(unsigned long i, tbl_record_t *r)
+{
+    static const char *reasons[3] = {"missing payload.bin", "sha256 mismatch", "disk full"};
+    char nbuf[32];
+    unsigned long k;
+    unsigned long j;
+
+    (void)memset(r, 0, sizeof(*r));
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(r->job, "job-", sizeof(r->job));
+    (void)tbl_strlcat(r->job, nbuf, sizeof(r->job));
+    (void)tbl_strlcpy(r->payload, "payload.bin", sizeof(r->payload));
+    r->bytes = i * 7UL;
+    r->stored_at = (i % 50UL == 0UL) ? 0UL : (DAY0 + i % 9UL) * 86400UL + i;
+    if (i % 4UL == 0UL) {
+        (void)tbl_strlcpy(r->status, "fail", sizeof(r->status));
+        (void)tbl_strlcpy(r->reason, reasons[i % 3UL], sizeof(r->reason));
+    } else if (i % 97UL == 0UL) {
+        (void)tbl_strlcpy(r->status, "pending", sizeof(r->status));
+    } else {
+        (void)tbl_strlcpy(r->status, "ok", sizeof(r->status));
+        k = i % 300UL;
+        for (j = 0UL; j < 64UL; ++j) r->sha256[j] = "0123456789abcdef"[(k >> ((j % 3UL) * 4UL)) & 0xfUL];
+        r->sha256[64] = '\0';
+    }
+}
+
+static int walk_cb(void *ud, const tbl_record_t *rec)
+{
+    (void)ud;
+    if (g_nwalk >= N_JOBS) return 1;
+    g_walk[g_nwalk++] = *rec;
+    return 0;
+}
+
+/* the same numbers the slow way, straight from the records in store order */
+static void brute(const tbl_colsnap_q_t *q, tbl_colsnap_stats_t *st)
+{
+    static unsigned char seen[N_JOBS];
+    unsigned long i;
+    unsigned long j;
+
+    (void)memset(st, 0, sizeof(*st));
+    (void)memset(seen, 0, sizeof(seen));
+    for (i = 0UL; i < N_JOBS; ++i) {
+        const tbl_record_t *r = &g_walk[i];
+        int code = tbl_colsnap_code(r->status);
+
+        if (code == TBL_COLSNAP_OK && r->sha256[0]) {
+            for (j = 0UL; j < i; ++j) {
+                if (tbl_colsnap_code(g_walk[j].status) == TBL_COLSNAP_OK && tbl_streq(g_walk[j].sha256, r->sha256)) {
+                    break;
+                }
+            }
+            seen[i] = (unsigned char)(j == i);
+        }
+        if (q->since_set && r->stored_at < q->since) continue;
+        if (q->until_set && r->stored_at >= q->until) continue;
+        if (q->status != 0 && code != q->status) continue;
+        st->n[0]++;
+        st->n[code]++;
+        st->bytes[0] += r->bytes;
+        st->bytes[code] += r->bytes;
+        if (seen[i]) {
+            st->uniq_n++;
+            st->uniq_bytes += r->bytes;
+        }
+        if (r->stored_at == 0UL) st->undated++;
+    }
+}
+
+static int stats_match_ok(const tbl_colsnap_t *cs, const tbl_colsnap_q_t *q, unsigned long nthreads)
+{
+    tbl_colsnap_stats_t a;
+    tbl_colsnap_stats_t b;
+    char err[256];
+    unsigned long sum = 0UL;
+    unsigned long i;
+    int ok;
+
+    brute(q, &b);
+    if (tbl_colsnap_stats(cs, q, nthreads, &a, err, sizeof(err)) != 0) return 0;
+    ok = a.uniq_n == b.uniq_n && a.uniq_bytes == b.uniq_bytes && a.undated == b.undated;
+    for (i = 0UL; i < 4UL; ++i) ok = ok && a.n[i] == b.n[i] && a.bytes[i] == b.bytes[i];
+    for (i = 0UL; i < a.ndays; ++i) sum += a.day_n[i];
+    ok = ok && sum + a.undated == a.n[0];
+    sum = 0UL;
+    for (i = 0UL; i <= cs->ndict; ++i) sum += a.reason_n[i];
+    ok = ok && sum == a.n[TBL_COLSNAP_FAIL];
+    tbl_colsnap_stats_free(&a);
+    return ok;
+}
+
+int main(void)
+{
+    char repo[256];
+    char p[1024];
+    char buf[32];
+    char err[256];
+    tbl_colsnap_t cs;
+    tbl_colsnap_q_t q;
+    tbl_colsnap_stats_t st;
+    unsigned long n;
+    unsigned long i;
+    FILE *fp;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_colsnap_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+
+    /* civil dates */
+    T_ASSERT(tbl_colsnap_day_str(0UL, buf, sizeof(buf)));
+    T_ASSERT_STREQ(buf, "1970-01-01");
+    T_ASSERT(tbl_colsnap_day_str(11016UL, buf, sizeof(buf)));
+    T_ASSERT_STREQ(buf, "2000-02-29");
+    T_ASSERT(tbl_colsnap_day_str(20745UL, buf, sizeof(buf)));
+    T_ASSERT_STREQ(buf, "2026-10-19");
+    T_ASSERT(!tbl_colsnap_day_str(0UL, buf, 4U));
+
+    T_ASSERT_EQ_INT(tbl_colsnap_code("ok"), TBL_COLSNAP_OK);
+    T_ASSERT_EQ_INT(tbl_colsnap_code("fail"), TBL_COLSNAP_FAIL);
+    T_ASSERT_EQ_INT(tbl_colsnap_code("queued"), TBL_COLSNAP_OTHER);
+
+    /* no snapshot yet */
+    T_ASSERT_EQ_INT(tbl_colsnap_load(&cs, repo, 0, err, sizeof(err)), 1);
+
+    /* empty repo: a valid empty snapshot */
+    T_ASSERT_EQ_INT(tbl_colsnap_build(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    T_ASSERT_EQ_INT(tbl_colsnap_load(&cs, repo, 1, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(cs.n, 0UL);
+    (void)memset(&q, 0, sizeof(q));
+    T_ASSERT_EQ_INT(tbl_colsnap_stats(&cs, &q, 4UL, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.n[0], 0UL);
+    tbl_colsnap_stats_free(&st);
+    tbl_colsnap_free(&cs);
+
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &g_recs[i]);
+        T_ASSERT(tbl_record_write_repo(repo, &g_recs[i], err, sizeof(err)) == 0);
+    }
+    T_ASSERT_EQ_INT(tbl_record_each(repo, walk_cb, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(g_nwalk, N_JOBS);
+    T_ASSERT_EQ_INT(tbl_colsnap_build(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, N_JOBS);
+    T_ASSERT_EQ_INT(tbl_colsnap_load(&cs, repo, 1, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(cs.n, N_JOBS);
+    T_ASSERT_EQ_ULONG(cs.ndict, 3UL);
+    T_ASSERT_EQ_ULONG(cs.first_day, DAY0);
+    T_ASSERT_EQ_ULONG(cs.last_day, DAY0 + 8UL);
+    T_ASSERT(cs.sha256 != 0);
+
+    /* the scan agrees with the records, single and multi threaded */
+    (void)memset(&q, 0, sizeof(q));
+    T_ASSERT(stats_match_ok(&cs, &q, 1UL));
+    T_ASSERT(stats_match_ok(&cs, &q, 4UL));
+    q.status = TBL_COLSNAP_FAIL;
+    T_ASSERT(stats_match_ok(&cs, &q, 3UL));
+    q.status = TBL_COLSNAP_OK;
+    q.since_set = 1;
+    q.since = (DAY0 + 2UL) * 86400UL;
+    q.until_set = 1;
+    q.until = (DAY0 + 6UL) * 86400UL;
+    T_ASSERT(stats_match_ok(&cs, &q, 2UL));
+
+    /* 300 distinct payloads among the ok records; fail reasons counted */
+    (void)memset(&q, 0, sizeof(q));
+    T_ASSERT_EQ_INT(tbl_colsnap_stats(&cs, &q, 0UL, &st, err, sizeof(err)), 0);
+    T_ASSERT(st.uniq_n > 0UL && st.uniq_n < st.n[TBL_COLSNAP_OK]);
+    T_ASSERT_EQ_ULONG(st.day0, DAY0);
+    T_ASSERT_EQ_ULONG(st.ndays, 9UL);
+    T_ASSERT_EQ_ULONG(st.reason_n[0], 0UL);
+    T_ASSERT_EQ_ULONG(st.reason_n[1] + st.reason_n[2] + st.reason_n[3], N_JOBS / 4UL);
+    tbl_colsnap_stats_free(&st);
+    tbl_colsnap_free(&cs);
+
+    /* without sha256 the rest still loads */
+    T_ASSERT_EQ_INT(tbl_colsnap_load(&cs, repo, 0, err, sizeof(err)), 0);
+    T_ASSERT(cs.sha256 == 0);
+    T_ASSERT(stats_match_ok(&cs, &q, 2UL));
+    tbl_colsnap_free(&cs);
+
+    /* a damaged header or a cut file is refused */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/records.col"));
+    fp = fopen(p, "r+b");
+    T_ASSERT(fp != 0);
+    T_ASSERT(fseek(fp, 64L, SEEK_SET) == 0);
+    T_ASSERT(fputc('X', fp) != EOF);
+    T_ASSERT(fclose(fp) == 0);
+    T_ASSERT_EQ_INT(tbl_colsnap_load(&cs, repo, 0, err, sizeof(err)), 2);
+    T_ASSERT(tbl_fs_write_file(p, "TBLCOL1\n", 8U) == 0);
+    T_ASSERT_EQ_INT(tbl_colsnap_load(&cs, repo, 0, err, sizeof(err)), 2);
+
+    /* rebuild replaces it */
+    T_ASSERT_EQ_INT(tbl_colsnap_build(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_colsnap_load(&cs, repo, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(cs.n, N_JOBS);
+    tbl_colsnap_free(&cs);
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
@@ -57,5 +57,126 @@ int main(void)
     T_ASSERT(rc != 0);
     T_ASSERT(err[0] != '\0');
 
+    /* [spool] retention/layout knobs */
+    ini =
+        "[spool]\n"
+        "date_buckets = 1\n"
+        "prune_threads = 4\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc == 0);
+    T_ASSERT(cfg.spool_date_buckets == 1UL);
+    T_ASSERT(cfg.spool_prune_threads == 4UL);
+
+    ini =
+        "[spool]\n"
+        "date_buckets = 2\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc != 0);
+
+    /* [events] group commit */
+    ini =
+        "[events]\n"
+        "batch = 64\n"
+        "fsync = 1\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc == 0);
+    T_ASSERT(cfg.events_batch == 64UL);
+    T_ASSERT(cfg.events_fsync == 1UL);
+    T_ASSERT(cfg.events_job_buckets == 0UL);
+    T_ASSERT(cfg.events_async == 0UL);
+
+    ini =
+        "[events]\n"
+        "async = 1\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc == 0);
+    T_ASSERT(cfg.events_async == 1UL);
+
+    ini =
+        "[events]\n"
+        "async = 2\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc != 0);
+
+    ini =
+        "[events]\n"
+        "job_store = buckets\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc == 0);
+    T_ASSERT(cfg.events_job_buckets == 1UL);
+
+    ini =
+        "[events]\n"
+        "job_store = files\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc != 0);
+
+    /* [records] */
+    T_ASSERT(cfg.records_journal == 0UL);
+    ini =
+        "[records]\n"
+        "store = journal\n"
+        "ini_view = 1\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc == 0);
+    T_ASSERT(cfg.records_journal == 1UL);
+    T_ASSERT(cfg.records_ini_view == 1UL);
+
+    ini =
+        "[records]\n"
+        "store = sqlite\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc != 0);
+
+    ini =
+        "[records]\n"
+        "ini_view = 2\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc != 0);
+
+    /* [audit] */
+    ini =
+        "[audit]\n"
+        "verify_threads = 8\n"
+        "segment_max_bytes = 1048576\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc == 0);
+    T_ASSERT(cfg.audit_verify_threads == 8UL);
+    T_ASSERT(cfg.audit_segment_max_bytes == 1048576UL);
+
+    ini =
+        "[audit]\n"
+        "segment_max_bytes = 100\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc != 0);
+
+    /* [verify] */
+    ini =
+        "[verify]\n"
+        "threads = 6\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc == 0);
+    T_ASSERT(cfg.verify_threads == 6UL);
+
+    ini =
+        "[verify]\n"
+        "workers = 2\n";
+    err[0] = '\0';
+    rc = tbl_cfg_load_buf(&cfg, ini, (size_t)strlen(ini), err, sizeof(err));
+    T_ASSERT(rc != 0);
+
         T_OK();
 }
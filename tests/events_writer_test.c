@@ -0,0 +1,389 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "events_writer_test"
+#include "test.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_SHA256_IMPLEMENTATION
+#include "core/sha256.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_TIME_IMPLEMENTATION
+#include "os/time.h"
+
+#define TBL_JOBSTORE_IMPLEMENTATION
+#include "core/jobstore.h"
+
+#define TBL_EVENTS_IMPLEMENTATION
+#include "core/events.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_TLZ_IMPLEMENTATION
+#include "core/tlz.h"
+
+#define TBL_AUDIT_IMPLEMENTATION
+#include "core/audit.h"
+
+static unsigned long count_lines(const char *path)
+{
+    FILE *fp;
+    int c;
+    unsigned long n;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0UL;
+    n = 0UL;
+    while ((c = fgetc(fp)) != EOF) {
+        if (c == '\n') n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+static int append_raw(const char *path, const char *s)
+{
+    FILE *fp;
+    fp = fopen(path, "ab");
+    if (!fp) return 0;
+    if (fputs(s, fp) == EOF) { fclose(fp); return 0; }
+    return (fclose(fp) == 0) ? 1 : 0;
+}
+
+int main(void)
+{
+    char root[256];
+    char p[512];
+    char ops_path[512];
+    char err[256];
+    char head1[65];
+    tbl_events_writer_t w;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(root, "tbl_test_evw_", sizeof(root));
+        (void)tbl_strlcat(root, nbuf, sizeof(root));
+    }
+    (void)tbl_fs_rm_rf(root);
+    T_ASSERT(tbl_fs_mkdir_p(root) == 0);
+    T_ASSERT(tbl_path_join2(ops_path, sizeof(ops_path), root, "audit/ops.log"));
+
+    /* genesis head, then three events across two jobs */
+    err[0] = '\0';
+    T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_audit_ok(&w, err, sizeof(err)), 1);
+    T_ASSERT_STREQ(w.head, "0000000000000000000000000000000000000000000000000000000000000000");
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "verify.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.fail", "jobB", "fail", "", "missing payload.bin", err, sizeof(err)), 0);
+    (void)tbl_strlcpy(head1, w.head, sizeof(head1));
+    tbl_events_writer_close(&w);
+
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "events.log"));
+    T_ASSERT_EQ_ULONG(count_lines(p), 3UL);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "jobs/jobA/events.log"));
+    T_ASSERT_EQ_ULONG(count_lines(p), 2UL);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "jobs/jobB/events.log"));
+    T_ASSERT_EQ_ULONG(count_lines(p), 1UL);
+    T_ASSERT_EQ_ULONG(count_lines(ops_path), 3UL);
+
+    /* reopen: head is loaded from (and verified against) the file */
+    T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+    T_ASSERT_STREQ(w.head, head1);
+    tbl_events_writer_close(&w);
+
+    /* one-shot wrapper chains onto the same head */
+    T_ASSERT_EQ_INT(tbl_events_append(root, "export.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(count_lines(ops_path), 4UL);
+    T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+
+    /* group commit: nothing hits the files until the batch is full/flushed */
+    T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_set_batch(&w, 3UL, 1, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobC", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobD", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(count_lines(ops_path), 4UL);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "verify.ok", "jobC", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(count_lines(ops_path), 7UL);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "jobs/jobC/events.log"));
+    T_ASSERT_EQ_ULONG(count_lines(p), 2UL);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "jobs/jobD/events.log"));
+    T_ASSERT_EQ_ULONG(count_lines(p), 1UL);
+
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "verify.ok", "jobD", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(count_lines(ops_path), 7UL);
+    T_ASSERT_EQ_INT(tbl_events_writer_flush(&w, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(count_lines(ops_path), 8UL);
+    T_ASSERT_EQ_ULONG(count_lines(p), 2UL);
+
+    /* close flushes the rest */
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "export.ok", "", "", "", "", err, sizeof(err)), 0);
+    (void)tbl_strlcpy(head1, w.pending_head, sizeof(head1));
+    tbl_events_writer_close(&w);
+    T_ASSERT_EQ_ULONG(count_lines(ops_path), 9UL);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "events.log"));
+    T_ASSERT_EQ_ULONG(count_lines(p), 9UL);
+    T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+
+    T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+    T_ASSERT_STREQ(w.head, head1);
+    tbl_events_writer_close(&w);
+
+    /* segmentation: seal ops.log at ~1 KiB, chain continues across segments */
+    {
+        char seg1[512];
+        char seg2[512];
+        unsigned long k;
+        int ex;
+
+        T_ASSERT(tbl_path_join2(seg1, sizeof(seg1), root, "audit/ops.000001.log"));
+        T_ASSERT(tbl_path_join2(seg2, sizeof(seg2), root, "audit/ops.000002.log"));
+
+        /* checkpoint inside the active ops.log, before it gets sealed */
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 0, 0, 0, err, sizeof(err)), 0);
+
+        T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_set_segment_max(&w, 1024UL, err, sizeof(err)), 0);
+        ex = 0;
+        (void)tbl_fs_exists(seg1, &ex);
+        T_ASSERT_EQ_INT(ex, 1); /* 9 lines already exceed the limit */
+        T_ASSERT_EQ_ULONG(count_lines(ops_path), 1UL); /* header only */
+
+        for (k = 0UL; k < 12UL; ++k) {
+            T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobE", "ok", "", "", err, sizeof(err)), 0);
+        }
+        tbl_events_writer_close(&w);
+        ex = 0;
+        (void)tbl_fs_exists(seg2, &ex);
+        T_ASSERT_EQ_INT(ex, 1);
+
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 2UL, 0, 0, 0, err, sizeof(err)), 0);
+
+        /* reopen chains onto the active segment */
+        T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "verify.ok", "jobE", "ok", "", "", err, sizeof(err)), 0);
+        tbl_events_writer_close(&w);
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 0, 0, 0, err, sizeof(err)), 0);
+
+        /* crash right after sealing: no ops.log yet; open writes the header */
+        T_ASSERT(tbl_fs_remove_file(ops_path) == 0);
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "verify.ok", "jobE", "ok", "", "", err, sizeof(err)), 0);
+        tbl_events_writer_close(&w);
+        T_ASSERT_EQ_ULONG(count_lines(ops_path), 2UL);
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+
+        /* archived segments: the newest sealed one stays plain, the chain
+           verifies through the compressed ones, rotation numbering goes on */
+        {
+            char z1[512];
+            unsigned long segs;
+            unsigned long raw;
+            unsigned long comp;
+            unsigned long lines;
+            unsigned long lines_z;
+            unsigned long sealed;
+            char name[32];
+
+            sealed = tbl_audit_sealed_count(root);
+            T_ASSERT(sealed >= 2UL && sealed < 9UL);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 1UL, 1, 0, &lines, err, sizeof(err)), 0);
+            T_ASSERT_EQ_INT(tbl_audit_compress_segments(root, 1UL, 2UL, &segs, &raw, &comp, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(segs, sealed - 1UL);
+            T_ASSERT(raw > 0UL && comp > 0UL);
+            T_ASSERT(tbl_path_join2(z1, sizeof(z1), root, "audit/ops.000001.log.tlz"));
+            ex = 1;
+            (void)tbl_fs_exists(seg1, &ex);
+            T_ASSERT_EQ_INT(ex, 0);
+            ex = 0;
+            (void)tbl_fs_exists(z1, &ex);
+            T_ASSERT_EQ_INT(ex, 1);
+            T_ASSERT_EQ_ULONG(tbl_audit_sealed_count(root), sealed);
+
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 3UL, 1, 0, &lines_z, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(lines_z, lines);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_ex(root, 1UL, err, sizeof(err)), 0);
+
+            /* nothing left to do */
+            T_ASSERT_EQ_INT(tbl_audit_compress_segments(root, 1UL, 2UL, &segs, &raw, &comp, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(segs, 0UL);
+
+            /* interrupted after the rename: both copies, counted once */
+            T_ASSERT(tbl_fs_write_file(seg1, "x\n", 2) == 0);
+            T_ASSERT_EQ_ULONG(tbl_audit_sealed_count(root), sealed);
+            T_ASSERT_EQ_INT(tbl_audit_compress_segments(root, 1UL, 1UL, &segs, &raw, &comp, err, sizeof(err)), 5);
+            T_ASSERT(strstr(err, "ops.000001.log: compressed copy does not match") != NULL);
+            T_ASSERT(tbl_fs_remove_file(seg1) == 0);
+
+            T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+            T_ASSERT_EQ_INT(tbl_events_writer_set_segment_max(&w, 1024UL, err, sizeof(err)), 0);
+            for (k = 0UL; k < 12UL; ++k) {
+                T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobE", "ok", "", "", err, sizeof(err)), 0);
+            }
+            tbl_events_writer_close(&w);
+            (void)tbl_strlcpy(name, "audit/ops.00000", sizeof(name));
+            name[15] = (char)('0' + (int)sealed + 1);
+            name[16] = '\0';
+            (void)tbl_strlcat(name, ".log", sizeof(name));
+            T_ASSERT(tbl_path_join2(p, sizeof(p), root, name));
+            ex = 0;
+            (void)tbl_fs_exists(p, &ex);
+            T_ASSERT_EQ_INT(ex, 1);
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops_incr(root, 2UL, 0, 0, 0, err, sizeof(err)), 0);
+
+            /* a damaged compressed segment is an integrity failure; then
+               unpack it again for the checks below */
+            {
+                static char zb[65536];
+                static char rb[65536];
+                tbl_tlz_t z;
+                FILE *fp;
+                size_t zn;
+
+                fp = fopen(z1, "rb");
+                T_ASSERT(fp != NULL);
+                zn = fread(zb, 1, sizeof(zb), fp);
+                fclose(fp);
+                T_ASSERT(zn > 64U && zn < sizeof(zb));
+                zb[20] ^= 0x20;
+                T_ASSERT(tbl_fs_remove_file(z1) == 0);
+                T_ASSERT(tbl_fs_write_file(z1, zb, zn) == 0);
+                T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 5);
+                T_ASSERT_STREQ(err, "audit integrity: compressed block damaged");
+                zb[20] ^= 0x20;
+                T_ASSERT(tbl_fs_remove_file(z1) == 0);
+                T_ASSERT(tbl_fs_write_file(z1, zb, zn) == 0);
+
+                T_ASSERT_EQ_INT(tbl_tlz_open(&z, z1, err, sizeof(err)), 0);
+                T_ASSERT(z.raw_size < sizeof(rb));
+                T_ASSERT(tbl_tlz_pread_ok(&z, 0UL, rb, (size_t)z.raw_size));
+                T_ASSERT(tbl_fs_write_file(seg1, rb, (size_t)z.raw_size) == 0);
+                tbl_tlz_close(&z);
+                T_ASSERT(tbl_fs_remove_file(z1) == 0);
+            }
+            T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+        }
+
+        /* a missing sealed segment breaks the chain */
+        T_ASSERT(tbl_path_join2(p, sizeof(p), root, "audit/ops.moved"));
+        T_ASSERT(tbl_fs_rename_atomic(seg1, p, 0) == 0);
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 5);
+        T_ASSERT(strstr(err, "missing segment ops.000001.log") != NULL);
+        T_ASSERT(tbl_fs_rename_atomic(p, seg1, 0) == 0);
+
+        /* errors in a sealed segment name the file */
+        T_ASSERT(tbl_fs_remove_file(seg1) == 0);
+        T_ASSERT(tbl_fs_write_file(seg1, "x\n", 2) == 0);
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 5);
+        T_ASSERT_STREQ(err, "audit integrity: ops.000001.log line 1: invalid format");
+
+        /* start over for the checks below */
+        (void)tbl_fs_rm_rf(root);
+        T_ASSERT(tbl_fs_mkdir_p(root) == 0);
+        T_ASSERT_EQ_INT(tbl_events_append(root, "export.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    }
+
+    /* two writers on one repo, as two processes would be: each reloads the
+       head under audit/ops.lock, also after the other one sealed ops.log */
+    {
+        tbl_events_writer_t w2;
+        tbl_fs_lock_t lk;
+        char held[512];
+        unsigned long k;
+        int ex;
+
+        T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_open(&w2, root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_set_segment_max(&w, 1024UL, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_set_batch(&w2, 4UL, 0, err, sizeof(err)), 0);
+        for (k = 0UL; k < 10UL; ++k) {
+            T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobF", "ok", "", "", err, sizeof(err)), 0);
+            T_ASSERT_EQ_INT(tbl_events_writer_append(&w2, "verify.ok", "jobG", "ok", "", "", err, sizeof(err)), 0);
+        }
+        tbl_events_writer_close(&w2);
+        tbl_events_writer_close(&w);
+
+        T_ASSERT(w2.lock_stats.count >= 4UL);
+        T_ASSERT(w2.lock_stats.reloads >= 2UL);
+        T_ASSERT(w2.lock_stats.hold_max_us <= w2.lock_stats.hold_us);
+        T_ASSERT(w.lock_stats.reloads >= 2UL);
+        T_ASSERT(tbl_path_join2(p, sizeof(p), root, "audit/ops.000001.log"));
+        ex = 0;
+        (void)tbl_fs_exists(p, &ex);
+        T_ASSERT_EQ_INT(ex, 1);
+        T_ASSERT(tbl_path_join2(p, sizeof(p), root, "events.log"));
+        T_ASSERT_EQ_ULONG(count_lines(p), 21UL);
+        T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+
+        /* marker fallback: <lock>.held exists exactly while the lock is held */
+        T_ASSERT(tbl_path_join2(p, sizeof(p), root, "audit/ops.lock"));
+        T_ASSERT(tbl_path_join2(held, sizeof(held), root, "audit/ops.lock.held"));
+        T_ASSERT(tbl_fs_lock_open(&lk, p) == 0);
+        lk.use_marker = 1;
+        T_ASSERT(tbl_fs_lock_acquire(&lk) == 0);
+        ex = 0;
+        (void)tbl_fs_exists(held, &ex);
+        T_ASSERT_EQ_INT(ex, 1);
+        T_ASSERT(tbl_fs_lock_release(&lk) == 0);
+        (void)tbl_fs_exists(held, &ex);
+        T_ASSERT_EQ_INT(ex, 0);
+        T_ASSERT(tbl_fs_lock_close(&lk) == 0);
+
+        /* start over for the checks below */
+        (void)tbl_fs_rm_rf(root);
+        T_ASSERT(tbl_fs_mkdir_p(root) == 0);
+        T_ASSERT_EQ_INT(tbl_events_append(root, "export.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    }
+
+    /* torn tail: nothing is chained onto it, the other streams go on */
+    T_ASSERT(append_raw(ops_path, "prev=00"));
+    {
+        char legacy[512];
+        unsigned long nl;
+        unsigned long no;
+
+        T_ASSERT(tbl_path_join2(legacy, sizeof(legacy), root, "events.log"));
+        nl = count_lines(legacy);
+        no = count_lines(ops_path);
+        T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_audit_ok(&w, err, sizeof(err)), 0);
+        T_ASSERT(strstr(err, "LF") != NULL);
+        T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "export.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_set_batch(&w, 4UL, 0, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "export.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+        tbl_events_writer_close(&w);
+        T_ASSERT_EQ_ULONG(w.ops_dropped, 2UL);
+        T_ASSERT_EQ_ULONG(count_lines(legacy), nl + 2UL);
+        T_ASSERT_EQ_ULONG(count_lines(ops_path), no);
+
+        /* forged head line: likewise */
+        T_ASSERT(append_raw(ops_path, "00000000000000000000000000000000000000000000000000000000000000"
+                                      " hash=1111111111111111111111111111111111111111111111111111111111111111"
+                                      " ts=1 event=x\n"));
+        no = count_lines(ops_path);
+        T_ASSERT_EQ_INT(tbl_events_append(root, "export.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_events_writer_audit_ok(&w, err, sizeof(err)), 0);
+        T_ASSERT(strstr(err, "mismatch") != NULL);
+        tbl_events_writer_close(&w);
+        T_ASSERT_EQ_ULONG(count_lines(legacy), nl + 3UL);
+        T_ASSERT_EQ_ULONG(count_lines(ops_path), no);
+    }
+
+    (void)tbl_fs_rm_rf(root);
+    T_OK();
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "evidx_test"
+#include "test.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_SHA256_IMPLEMENTATION
+#include "core/sha256.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_TIME_IMPLEMENTATION
+#include "os/time.h"
+
+#define TBL_JOBSTORE_IMPLEMENTATION
+#include "core/jobstore.h"
+
+#define TBL_EVENTS_IMPLEMENTATION
+#include "core/events.h"
+
+#define TBL_EVIDX_IMPLEMENTATION
+#include "core/evidx.h"
+
+typedef struct hits_s {
+    unsigned long n;
+    char last[256];
+} hits_t;
+
+static int hit_cb(void *ud, const char *line, size_t len)
+{
+    hits_t *h = (hits_t *)ud;
+    h->n++;
+    if (len >= sizeof(h->last)) len = sizeof(h->last) - 1U;
+    (void)memcpy(h->last, line, len);
+    h->last[len] = '\0';
+    return 0;
+}
+
+static unsigned long lookup(const char *root, const char *job, hits_t *h, unsigned long *scanned)
+{
+    char err[256];
+
+    (void)memset(h, 0, sizeof(*h));
+    err[0] = '\0';
+    *scanned = 999UL;
+    if (tbl_evidx_each(root, job, hit_cb, h, scanned, err, sizeof(err)) != 0) return 9999UL;
+    return h->n;
+}
+
+static int append_raw(const char *path, const char *s)
+{
+    FILE *fp;
+    fp = fopen(path, "ab");
+    if (!fp) return 0;
+    if (fputs(s, fp) == EOF) { fclose(fp); return 0; }
+    return (fclose(fp) == 0) ? 1 : 0;
+}
+
+int main(void)
+{
+    char root[256];
+    char legacy[512];
+    char p[512];
+    char err[256];
+    unsigned long scanned;
+    unsigned long n;
+    hits_t h;
+    tbl_events_writer_t w;
+    int ex;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(root, "tbl_test_evidx_", sizeof(root));
+        (void)tbl_strlcat(root, nbuf, sizeof(root));
+    }
+    (void)tbl_fs_rm_rf(root);
+    T_ASSERT(tbl_fs_mkdir_p(root) == 0);
+    T_ASSERT(tbl_path_join2(legacy, sizeof(legacy), root, "events.log"));
+
+    /* nothing yet */
+    T_ASSERT_EQ_ULONG(lookup(root, "jobA", &h, &scanned), 0UL);
+
+    /* pre-index history: lookups scan the whole file */
+    T_ASSERT(append_raw(legacy, "ts=1 event=ingest.ok job=jobA status=ok\n"
+                                "ts=2 event=ingest.ok job=jobAB status=ok\n"
+                                "ts=3 event=export.ok\n"
+                                "ts=4 event=verify.ok job=jobA status=ok\r\n"));
+    T_ASSERT_EQ_ULONG(lookup(root, "jobA", &h, &scanned), 2UL);
+    T_ASSERT(scanned > 0UL);
+    T_ASSERT(strstr(h.last, "ts=4 event=verify.ok") != NULL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobAB", &h, &scanned), 1UL);
+
+    /* full build: lookups no longer scan; job= is matched exactly */
+    err[0] = '\0';
+    T_ASSERT_EQ_INT(tbl_evidx_build(root, 1, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 3UL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobA", &h, &scanned), 2UL);
+    T_ASSERT_EQ_ULONG(scanned, 0UL);
+    T_ASSERT(strstr(h.last, "ts=4 event=verify.ok") != NULL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobAB", &h, &scanned), 1UL);
+    T_ASSERT_EQ_ULONG(scanned, 0UL);
+    T_ASSERT_EQ_ULONG(lookup(root, "job", &h, &scanned), 0UL);
+    T_ASSERT_EQ_ULONG(scanned, 0UL);
+
+    /* the writer keeps the tail current, both write-through and batched */
+    T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "export.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_set_batch(&w, 8UL, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobC", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "verify.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    tbl_events_writer_close(&w);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "events.idx.tail"));
+    ex = 0;
+    (void)tbl_fs_exists(p, &ex);
+    T_ASSERT_EQ_INT(ex, 1);
+
+    T_ASSERT_EQ_ULONG(lookup(root, "jobA", &h, &scanned), 4UL);
+    T_ASSERT_EQ_ULONG(scanned, 0UL);
+    T_ASSERT(strstr(h.last, "event=verify.ok job=jobA") != NULL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobC", &h, &scanned), 1UL);
+    T_ASSERT_EQ_ULONG(scanned, 0UL);
+
+    /* a line written behind the writer's back is scanned, not lost */
+    T_ASSERT(append_raw(legacy, "ts=9 event=export.ok job=jobC status=ok\n"));
+    T_ASSERT_EQ_ULONG(lookup(root, "jobC", &h, &scanned), 2UL);
+    T_ASSERT(scanned > 0UL);
+
+    /* merge build folds the tail and the remainder into events.idx */
+    T_ASSERT_EQ_INT(tbl_evidx_build(root, 0, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 7UL);
+    ex = 1;
+    (void)tbl_fs_exists(p, &ex);
+    T_ASSERT_EQ_INT(ex, 0);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobC", &h, &scanned), 2UL);
+    T_ASSERT_EQ_ULONG(scanned, 0UL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobA", &h, &scanned), 4UL);
+    T_ASSERT_EQ_ULONG(scanned, 0UL);
+
+    /* rewritten log: stale offsets are detected, results stay correct */
+    T_ASSERT(tbl_fs_remove_file(legacy) == 0);
+    T_ASSERT(append_raw(legacy, "ts=10 event=ingest.ok job=jobB status=ok\n"
+                                "ts=11 event=ingest.ok job=jobA status=ok\n"));
+    T_ASSERT_EQ_ULONG(lookup(root, "jobA", &h, &scanned), 1UL);
+    T_ASSERT(strstr(h.last, "ts=11") != NULL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobC", &h, &scanned), 0UL);
+
+    T_ASSERT_EQ_INT(tbl_evidx_build(root, 1, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 2UL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobB", &h, &scanned), 1UL);
+    T_ASSERT_EQ_ULONG(scanned, 0UL);
+
+    (void)tbl_fs_rm_rf(root);
+    T_OK();
+}
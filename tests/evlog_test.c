@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "evlog_test"
+#include "test.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_SHA256_IMPLEMENTATION
+#include "core/sha256.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_TIME_IMPLEMENTATION
+#include "os/time.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_JOBSTORE_IMPLEMENTATION
+#include "core/jobstore.h"
+
+#define TBL_EVENTS_IMPLEMENTATION
+#include "core/events.h"
+
+#define TBL_EVLOG_IMPLEMENTATION
+#include "core/evlog.h"
+
+#define TBL_TLZ_IMPLEMENTATION
+#include "core/tlz.h"
+
+#define TBL_AUDIT_IMPLEMENTATION
+#include "core/audit.h"
+
+static unsigned long count_lines(const char *path)
+{
+    FILE *fp;
+    int c;
+    unsigned long n;
+
+    fp = fopen(path, "rb");
+    if (!fp) return 0UL;
+    n = 0UL;
+    while ((c = fgetc(fp)) != EOF) {
+        if (c == '\n') n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+int main(void)
+{
+    char root[256];
+    char legacy[512];
+    char ops[512];
+    char p[512];
+    char err[256];
+    char job[32];
+    tbl_evlog_t l;
+    unsigned long k;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(root, "tbl_test_evlog_", sizeof(root));
+        (void)tbl_strlcat(root, nbuf, sizeof(root));
+    }
+    (void)tbl_fs_rm_rf(root);
+    T_ASSERT(tbl_fs_mkdir_p(root) == 0);
+    T_ASSERT(tbl_path_join2(legacy, sizeof(legacy), root, "events.log"));
+    T_ASSERT(tbl_path_join2(ops, sizeof(ops), root, "audit/ops.log"));
+
+    /* not started: append writes through */
+    err[0] = '\0';
+    T_ASSERT_EQ_INT(tbl_evlog_open(&l, root, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_evlog_append(&l, "ingest.ok", "job0", "ok", "", ""), 0);
+    T_ASSERT_EQ_ULONG(count_lines(ops), 1UL);
+    tbl_evlog_close(&l);
+
+    /* background thread, tiny ring, batched writer: everything arrives in
+       order once a barrier returns */
+    T_ASSERT_EQ_INT(tbl_evlog_open(&l, root, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_set_batch(&l.w, 16UL, 0, err, sizeof(err)), 0);
+    if (TBL_HAVE_THREADS) {
+        T_ASSERT(tbl_evlog_start_ok(&l, 4UL));
+    }
+    for (k = 0UL; k < 500UL; ++k) {
+        (void)tbl_strlcpy(job, "job", sizeof(job));
+        T_ASSERT(tbl_ul_to_dec_ok(k % 7UL, job + 3, sizeof(job) - 3));
+        T_ASSERT_EQ_INT(tbl_evlog_append(&l, "ingest.ok", job, "ok", "", (k % 2UL) ? "odd" : ""), 0);
+    }
+    T_ASSERT_EQ_INT(tbl_evlog_barrier(&l), 0);
+    T_ASSERT_EQ_ULONG(count_lines(legacy), 501UL);
+    T_ASSERT_EQ_ULONG(count_lines(ops), 501UL);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "jobs/job3/events.log"));
+    T_ASSERT_EQ_ULONG(count_lines(p), 71UL);
+    T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+
+    /* a barrier with nothing queued returns right away */
+    T_ASSERT_EQ_INT(tbl_evlog_barrier(&l), 0);
+
+    /* close drains what is still queued */
+    for (k = 0UL; k < 40UL; ++k) {
+        T_ASSERT_EQ_INT(tbl_evlog_append(&l, "verify.ok", "job1", "ok", "", ""), 0);
+    }
+    tbl_evlog_close(&l);
+    T_ASSERT_EQ_ULONG(l.errors, 0UL);
+    T_ASSERT_EQ_ULONG(count_lines(ops), 541UL);
+    T_ASSERT_EQ_INT(tbl_audit_verify_ops(root, err, sizeof(err)), 0);
+
+    /* start without an open writer is refused */
+    (void)memset(&l, 0, sizeof(l));
+    T_ASSERT(!tbl_evlog_start_ok(&l, 0UL));
+
+    (void)tbl_fs_rm_rf(root);
+    T_OK();
+}
@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "evquery_test"
+#include "test.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_TIME_IMPLEMENTATION
+#include "os/time.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_WATCH_IMPLEMENTATION
+#include "os/watch.h"
+
+#define TBL_EVIDX_IMPLEMENTATION
+#include "core/evidx.h"
+
+#define TBL_EVQUERY_IMPLEMENTATION
+#include "core/evquery.h"
+
+#define N_LINES 5000UL
+
+typedef struct hits_s {
+    unsigned long n;
+    char last[256];
+} hits_t;
+
+static int hit_cb(void *ud, const char *line, size_t len)
+{
+    hits_t *h = (hits_t *)ud;
+
+    h->n++;
+    if (len >= sizeof(h->last)) len = sizeof(h->last) - 1U;
+    (void)memcpy(h->last, line, len);
+    h->last[len] = '\0';
+    return 0;
+}
+
+static unsigned long query(const char *root, const tbl_evq_t *q, hits_t *h, unsigned long *scanned)
+{
+    char err[256];
+
+    (void)memset(h, 0, sizeof(*h));
+    if (tbl_evq_run(root, q, hit_cb, h, scanned, err, sizeof(err)) != 0) return 999999UL;
+    return h->n;
+}
+
+/* follow: stop after h->n reaches *want (if set) */
+typedef struct tail_s {
+    hits_t h;
+    unsigned long want;
+} tail_t;
+
+static int tail_cb(void *ud, const char *line, size_t len)
+{
+    tail_t *t = (tail_t *)ud;
+
+    (void)hit_cb(&t->h, line, len);
+    return (t->want && t->h.n >= t->want) ? 1 : 0;
+}
+
+static int append_text(const char *path, const char *s)
+{
+    FILE *fp = fopen(path, "ab");
+    int ok;
+
+    if (!fp) return 0;
+    ok = (fputs(s, fp) != EOF);
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+/* appender thread for the live follow */
+static void late_writer(void *ud, unsigned long worker)
+{
+    const char *path = (const char *)ud;
+    int i;
+
+    (void)worker;
+    tbl_sleep_ms(50UL);
+    (void)append_text(path, "ok job=jobT\n"); /* completes the torn line */
+    for (i = 0; i < 4; ++i) {
+        tbl_sleep_ms(20UL);
+        (void)append_text(path, (i == 2) ? "ts=7103 event=verify.fail job=jobT\n" : "ts=7102 event=ingest.ok job=jobT\n");
+    }
+}
+
+/* ts=1000+i; every 10th line is a verify.fail, line 3000 has a clock jump */
+static int write_log(const char *path)
+{
+    FILE *fp;
+    unsigned long i;
+    char nbuf[32];
+    int ok;
+
+    fp = fopen(path, "wb");
+    if (!fp) return 0;
+    ok = 1;
+    for (i = 0UL; i < N_LINES && ok; ++i) {
+        ok = tbl_ul_to_dec_ok(i == 3000UL ? 5UL : 1000UL + i, nbuf, sizeof(nbuf)) &&
+             fputs("ts=", fp) != EOF && fputs(nbuf, fp) != EOF &&
+             fputs((i % 10UL) == 0UL ? " event=verify.fail" : " event=ingest.ok", fp) != EOF &&
+             fputs((i % 10UL) == 0UL ? " job=jobV status=fail\n" : " job=jobI status=ok\n", fp) != EOF;
+    }
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+int main(void)
+{
+    char root[256];
+    char legacy[512];
+    tbl_evq_t q;
+    hits_t h;
+    unsigned long scanned;
+    unsigned long full;
+    unsigned long t;
+
+    /* time arguments */
+    T_ASSERT(tbl_evq_parse_time_ok("1760745600", 0UL, &t));
+    T_ASSERT_EQ_ULONG(t, 1760745600UL);
+    T_ASSERT(tbl_evq_parse_time_ok("1h", 10000UL, &t));
+    T_ASSERT_EQ_ULONG(t, 6400UL);
+    T_ASSERT(tbl_evq_parse_time_ok("2d", 100UL, &t));
+    T_ASSERT_EQ_ULONG(t, 0UL);
+    T_ASSERT(tbl_evq_parse_time_ok("2026-10-17", 0UL, &t));
+    T_ASSERT_EQ_ULONG(t, 1792195200UL);
+    T_ASSERT(tbl_evq_parse_time_ok("2026-10-17T08:30:05Z", 0UL, &t));
+    T_ASSERT_EQ_ULONG(t, 1792195200UL + 8UL * 3600UL + 30UL * 60UL + 5UL);
+    T_ASSERT(tbl_evq_parse_time_ok("2000-03-01T00:00", 0UL, &t));
+    T_ASSERT_EQ_ULONG(t, 951868800UL);
+    T_ASSERT(!tbl_evq_parse_time_ok("", 0UL, &t));
+    T_ASSERT(!tbl_evq_parse_time_ok("1w", 0UL, &t));
+    T_ASSERT(!tbl_evq_parse_time_ok("2026-13-01", 0UL, &t));
+    T_ASSERT(!tbl_evq_parse_time_ok("2026-10-17T8:30", 0UL, &t));
+    T_ASSERT(!tbl_evq_parse_time_ok("yesterday", 0UL, &t));
+
+    /* in-place matching */
+    (void)memset(&q, 0, sizeof(q));
+    q.event = "verify";
+    T_ASSERT(tbl_evq_match_ok(&q, "ts=1 event=verify.ok job=a\n", 27));
+    T_ASSERT(tbl_evq_match_ok(&q, "ts=1 event=verify\n", 18));
+    T_ASSERT(!tbl_evq_match_ok(&q, "ts=1 event=verifyx job=a\n", 25));
+    q.event = 0;
+    q.status = "fail";
+    T_ASSERT(!tbl_evq_match_ok(&q, "ts=1 event=x status=failed\n", 27));
+    T_ASSERT(!tbl_evq_match_ok(&q, "ts=1 event=x reason=status=fail\n", 32));
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(root, "tbl_test_evq_", sizeof(root));
+        (void)tbl_strlcat(root, nbuf, sizeof(root));
+    }
+    (void)tbl_fs_rm_rf(root);
+    T_ASSERT(tbl_fs_mkdir_p(root) == 0);
+    T_ASSERT(tbl_path_join2(legacy, sizeof(legacy), root, "events.log"));
+
+    /* no log: nothing, no error */
+    (void)memset(&q, 0, sizeof(q));
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &scanned), 0UL);
+
+    T_ASSERT(write_log(legacy));
+
+    /* unfiltered: everything, whole file */
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &full), N_LINES);
+    T_ASSERT(full > 0UL);
+
+    /* recent window: only the tail blocks are read */
+    q.since_set = 1;
+    q.since = 1000UL + 4990UL;
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &scanned), 10UL);
+    T_ASSERT(scanned < full / 4UL);
+    T_ASSERT(strstr(h.last, "ts=5999 ") != NULL);
+
+    /* failures in a window in the middle */
+    q.since = 1000UL + 2000UL;
+    q.until_set = 1;
+    q.until = 1000UL + 2100UL;
+    q.status = "fail";
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &scanned), 10UL);
+    T_ASSERT(scanned < full / 2UL);
+    T_ASSERT(strstr(h.last, "ts=3090 event=verify.fail") != NULL);
+
+    /* the out-of-order line is still found */
+    q.since_set = 0;
+    q.until = 10UL;
+    q.status = 0;
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &scanned), 1UL);
+    T_ASSERT(strncmp(h.last, "ts=5 ", 5) == 0);
+
+    /* event prefix and job filter (through the job index) */
+    (void)memset(&q, 0, sizeof(q));
+    q.event = "verify";
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &scanned), N_LINES / 10UL);
+    q.event = 0;
+    q.job = "jobV";
+    q.since_set = 1;
+    q.since = 1000UL + 4000UL;
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &scanned), 100UL);
+
+    /* new lines after the index: picked up (and indexed) by the next query */
+    {
+        FILE *fp = fopen(legacy, "ab");
+        T_ASSERT(fp != NULL);
+        T_ASSERT(fputs("ts=9000 event=export.fail job=jobX status=fail\n", fp) != EOF);
+        T_ASSERT(fclose(fp) == 0);
+    }
+    (void)memset(&q, 0, sizeof(q));
+    q.since_set = 1;
+    q.since = 8000UL;
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &scanned), 1UL);
+    T_ASSERT(strstr(h.last, "job=jobX") != NULL);
+
+    /* rewritten (shorter) log: the stale index is dropped */
+    T_ASSERT(tbl_fs_remove_file(legacy) == 0);
+    T_ASSERT(tbl_fs_write_file(legacy, "ts=7000 event=ingest.ok\nts=7001 event=verify.ok\n", 48) == 0);
+    q.since = 7001UL;
+    T_ASSERT_EQ_ULONG(query(root, &q, &h, &scanned), 1UL);
+    T_ASSERT(strncmp(h.last, "ts=7001 ", 8) == 0);
+
+    /* follow, not waiting: from an offset to the end */
+    {
+        tbl_evq_follow_t f;
+        tail_t tl;
+        unsigned long off;
+        unsigned long stored;
+        int found;
+        char err[256];
+
+        (void)memset(&f, 0, sizeof(f));
+        (void)memset(&tl, 0, sizeof(tl));
+        f.from = 24UL;
+        T_ASSERT_EQ_INT(tbl_evq_follow(root, 0, &f, tail_cb, &tl, &off, err, sizeof(err)), 0);
+        T_ASSERT_EQ_ULONG(tl.h.n, 1UL);
+        T_ASSERT_EQ_ULONG(off, 48UL);
+
+        /* the offset must be a line start inside the log */
+        f.from = 25UL;
+        T_ASSERT(tbl_evq_follow(root, 0, &f, tail_cb, &tl, &off, err, sizeof(err)) != 0);
+        f.from = 49UL;
+        T_ASSERT(tbl_evq_follow(root, 0, &f, tail_cb, &tl, &off, err, sizeof(err)) != 0);
+
+        /* cursor: first run stores the end, the next only sees new lines */
+        f.from = 0UL;
+        f.cursor = "indexer";
+        (void)memset(&tl, 0, sizeof(tl));
+        T_ASSERT_EQ_INT(tbl_evq_follow(root, 0, &f, tail_cb, &tl, &off, err, sizeof(err)), 0);
+        T_ASSERT_EQ_ULONG(tl.h.n, 2UL);
+        T_ASSERT_EQ_INT(tbl_evq_cursor_load(root, "indexer", &stored, &found, err, sizeof(err)), 0);
+        T_ASSERT(found);
+        T_ASSERT_EQ_ULONG(stored, 48UL);
+
+        T_ASSERT(append_text(legacy, "ts=7100 event=ingest.ok job=jobC\nts=7101 event=ve"));
+        (void)memset(&tl, 0, sizeof(tl));
+        T_ASSERT_EQ_INT(tbl_evq_follow(root, 0, &f, tail_cb, &tl, &off, err, sizeof(err)), 0);
+        T_ASSERT_EQ_ULONG(tl.h.n, 1UL); /* the torn line waits */
+        T_ASSERT(strstr(tl.h.last, "job=jobC") != NULL);
+        T_ASSERT_EQ_INT(tbl_evq_cursor_load(root, "indexer", &stored, &found, err, sizeof(err)), 0);
+        T_ASSERT_EQ_ULONG(stored, off);
+
+        f.cursor = "../x";
+        T_ASSERT(tbl_evq_follow(root, 0, &f, tail_cb, &tl, &off, err, sizeof(err)) != 0);
+        T_ASSERT(tbl_evq_cursor_store(root, "", 0UL, err, sizeof(err)) != 0);
+
+        /* live: lines written while following arrive; filter applies */
+        if (TBL_HAVE_THREADS) {
+            tbl_thread_t th;
+
+            (void)memset(&q, 0, sizeof(q));
+            q.job = "jobT";
+            f.cursor = "indexer";
+            f.follow = 1;
+            f.poll_ms = 100UL;
+            (void)memset(&tl, 0, sizeof(tl));
+            tl.want = 5UL;
+            T_ASSERT(tbl_thread_start_ok(&th, late_writer, legacy));
+            T_ASSERT_EQ_INT(tbl_evq_follow(root, &q, &f, tail_cb, &tl, &off, err, sizeof(err)), 0);
+            tbl_thread_join(&th);
+            T_ASSERT_EQ_ULONG(tl.h.n, 5UL);
+            T_ASSERT(strncmp(tl.h.last, "ts=7102 ", 8) == 0);
+            T_ASSERT_EQ_INT(tbl_evq_cursor_load(root, "indexer", &stored, &found, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(stored, off);
+
+            /* resume: nothing left */
+            f.follow = 0;
+            (void)memset(&tl, 0, sizeof(tl));
+            T_ASSERT_EQ_INT(tbl_evq_follow(root, 0, &f, tail_cb, &tl, &off, err, sizeof(err)), 0);
+            T_ASSERT_EQ_ULONG(tl.h.n, 0UL);
+        }
+    }
+
+    (void)tbl_fs_rm_rf(root);
+    T_OK();
+}
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define T_TESTNAME "fts_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_TIME_IMPLEMENTATION
+#include "os/time.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_WATCH_IMPLEMENTATION
+#include "os/watch.h"
+
+#define TBL_SHA256_IMPLEMENTATION
+#include "core/sha256.h"
+
+#define TBL_CAS_IMPLEMENTATION
+#include "core/cas.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define TBL_EVIDX_IMPLEMENTATION
+#include "core/evidx.h"
+
+#define TBL_EVQUERY_IMPLEMENTATION
+#include "core/evquery.h"
+
+#define TBL_FTS_BATCH_MAX 8UL /* many small segments: merges get exercised */
+#define TBL_FTS_IMPLEMENTATION
+#include "core/fts.h"
+
+#define N_JOBS 60UL
+
+typedef struct toks_s {
+    char buf[512];
+} toks_t;
+
+/* tokens joined by '|' */
+static int tok_cb(void *ud, const char *tok, size_t len)
+{
+    toks_t *t = (toks_t *)ud;
+    char one[64];
+
+    (void)memcpy(one, tok, len);
+    one[len] = '\0';
+    if (t->buf[0]) (void)tbl_strlcat(t->buf, "|", sizeof(t->buf));
+    (void)tbl_strlcat(t->buf, one, sizeof(t->buf));
+    return 0;
+}
+
+static const char *toks(const char *s)
+{
+    static toks_t t;
+
+    t.buf[0] = '\0';
+    (void)tbl_fts_tokenize(s, strlen(s), tok_cb, &t);
+    return t.buf;
+}
+
+static void job_name(unsigned long i, char *out, size_t outsz)
+{
+    char nbuf[32];
+
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(out, "doc-", outsz);
+    (void)tbl_strlcat(out, nbuf, outsz);
+}
+
+/* every job stores a text payload; every 5th one says "rechnung", every 3rd
+   is a failure with reason "sha256 mismatch" */
+static int put_job(const char *repo, unsigned long i, const char *text, const char *status)
+{
+    char src[1024];
+    char err[256];
+    tbl_record_t r;
+
+    (void)memset(&r, 0, sizeof(r));
+    job_name(i, r.job, sizeof(r.job));
+    (void)tbl_strlcpy(r.status, status, sizeof(r.status));
+    (void)tbl_strlcpy(r.payload, "payload.txt", sizeof(r.payload));
+    r.stored_at = 1700000000UL + i;
+    if (tbl_streq(status, "ok")) {
+        if (!tbl_path_join2(src, sizeof(src), repo, "tmp.txt")) return 0;
+        if (tbl_fs_write_file(src, text, strlen(text)) != 0) return 0;
+        if (tbl_cas_put_file(repo, src, r.sha256, sizeof(r.sha256), err, sizeof(err)) != 0) return 0;
+        r.bytes = (unsigned long)strlen(text);
+        (void)tbl_fs_remove_file(src);
+    } else {
+        (void)tbl_strlcpy(r.reason, "sha256 mismatch", sizeof(r.reason));
+    }
+    return tbl_record_write_repo(repo, &r, err, sizeof(err)) == 0;
+}
+
+static int append_event(const char *repo, const char *event, const char *job)
+{
+    char p[1024];
+    FILE *fp;
+    int ok;
+
+    if (!tbl_path_join2(p, sizeof(p), repo, "events.log")) return 0;
+    fp = fopen(p, "ab");
+    if (!fp) return 0;
+    ok = tbl_fputs5_ok(fp, "ts=1700000000 event=", event, " job=", job, " status=ok\n");
+    return (fclose(fp) == 0) && ok;
+}
+
+static unsigned long search_n(const char *repo, const char *text, tbl_fts_hit_t *hits, unsigned long k,
+                              unsigned long *total)
+{
+    tbl_fts_query_t q;
+    char err[256];
+    unsigned long n = 0UL;
+
+    if (!tbl_fts_query_parse_ok(&q, text)) return 9999UL;
+    if (tbl_fts_search(repo, &q, hits, k, &n, total, err, sizeof(err)) != 0) return 9999UL;
+    return n;
+}
+
+int main(void)
+{
+    char repo[256];
+    char job[64];
+    char p[1024];
+    char err[256];
+    tbl_fts_query_t q;
+    tbl_fts_hit_t hits[N_JOBS];
+    tbl_fts_stats_t st;
+    unsigned long total;
+    unsigned long n;
+    unsigned long i;
+    const char *jobs[2];
+    FILE *fp;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_fts_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+
+    /* tokenizer: case folding, UTF-8 letters, punctuation and bad bytes split */
+    T_ASSERT_STREQ(toks("Rechnung Nr. 2026-17"), "rechnung|nr|2026|17");
+    T_ASSERT_STREQ(toks("\xef\xbb\xbf" "M\xc3\x9cLLER \xc3\xa4rger"), "m\xc3\xbcller|\xc3\xa4rger");
+    T_ASSERT_STREQ(toks("\xce\x9b\xce\x9f\xce\x93\xce\x9f\xce\xa3 \xd0\x9f\xd0\xb5\xd1\x82\xd1\x80"),
+                   "\xce\xbb\xce\xbf\xce\xb3\xce\xbf\xcf\x83|\xd0\xbf\xd0\xb5\xd1\x82\xd1\x80");
+    T_ASSERT_STREQ(toks("a\xff" "b 5\xc3\x97" "3 x\xe2\x80\x94y"), "a|b|5|3|x|y");
+    T_ASSERT_STREQ(toks("ok 0123456789012345678901234567890123456789012345678 end"), "ok|end");
+    T_ASSERT(tbl_fts_text_ok((const unsigned char *)"plain \xc3\xa4", 8U, 0));
+    T_ASSERT(!tbl_fts_text_ok((const unsigned char *)"nul\0x", 5U, 0));
+    T_ASSERT(!tbl_fts_text_ok((const unsigned char *)"cut \xc3", 5U, 0));
+    T_ASSERT(tbl_fts_text_ok((const unsigned char *)"cut \xc3", 5U, 1));
+
+    /* queries */
+    T_ASSERT(tbl_fts_query_parse_ok(&q, "Invoice 2026 OR rechnung AND status:OK"));
+    T_ASSERT_EQ_ULONG(q.nterms, 4UL);
+    T_ASSERT_EQ_ULONG(q.ngroups, 2UL);
+    T_ASSERT_EQ_ULONG(q.group[0], 3UL);
+    T_ASSERT_EQ_ULONG(q.group[1], 12UL);
+    T_ASSERT_STREQ(q.term[3], "status:ok");
+    T_ASSERT(!tbl_fts_query_parse_ok(&q, "OR rechnung"));
+    T_ASSERT(!tbl_fts_query_parse_ok(&q, "a OR OR b"));
+    T_ASSERT(!tbl_fts_query_parse_ok(&q, "rechnung OR"));
+    T_ASSERT(!tbl_fts_query_parse_ok(&q, " -- "));
+
+    /* no index yet: no matches */
+    T_ASSERT_EQ_ULONG(search_n(repo, "rechnung", hits, 10UL, &total), 0UL);
+    T_ASSERT_EQ_ULONG(total, 0UL);
+
+    for (i = 0UL; i < N_JOBS; ++i) {
+        const char *text = (i % 5UL == 0UL) ? "Rechnung 2026 an M\xc3\xbcller, Rechnung bezahlt" : "Lieferschein 2026";
+        const char *status = (i % 3UL == 1UL) ? "fail" : "ok";
+
+        job_name(i, job, sizeof(job));
+        T_ASSERT(put_job(repo, i, text, status));
+        T_ASSERT(append_event(repo, tbl_streq(status, "ok") ? "ingest.ok" : "ingest.fail", job));
+        T_ASSERT(append_event(repo, "verify.ok", job));
+    }
+
+    /* the consumer indexes every job in batches of 8 and merges the segments */
+    T_ASSERT_EQ_INT(tbl_fts_update(repo, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.docs, N_JOBS);
+    T_ASSERT_EQ_ULONG(st.batches, (N_JOBS + 7UL) / 8UL);
+    T_ASSERT(st.segments >= 1UL && st.segments <= 4UL);
+    T_ASSERT(st.offset > 0UL);
+
+    /* 12 jobs say rechnung, 4 of them failed (no payload text) */
+    n = search_n(repo, "RECHNUNG", hits, N_JOBS, &total);
+    T_ASSERT_EQ_ULONG(total, 8UL);
+    T_ASSERT_EQ_ULONG(n, 8UL);
+    for (i = 1UL; i < n; ++i) {
+        T_ASSERT(hits[i - 1UL].score > hits[i].score ||
+                 (hits[i - 1UL].score == hits[i].score && strcmp(hits[i - 1UL].job, hits[i].job) < 0));
+    }
+    T_ASSERT_EQ_ULONG(search_n(repo, "rechnung", hits, 3UL, &total), 3UL);
+    T_ASSERT_EQ_ULONG(total, 8UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "m\xc3\x9cller bezahlt", hits, N_JOBS, &total), 8UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "status:fail", hits, N_JOBS, &total), N_JOBS / 3UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "reason:mismatch", hits, N_JOBS, &total), N_JOBS / 3UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "rechnung OR status:fail", hits, N_JOBS, &total), 8UL + N_JOBS / 3UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "job:doc-7", hits, N_JOBS, &total), 1UL);
+    T_ASSERT_STREQ(hits[0].job, "doc-7");
+    T_ASSERT_EQ_ULONG(search_n(repo, "rechnung lieferschein", hits, N_JOBS, &total), 0UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "status:rechnung", hits, N_JOBS, &total), 0UL);
+
+    /* nothing new: the cursor held */
+    T_ASSERT_EQ_INT(tbl_fts_update(repo, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.docs, 0UL);
+
+    /* a job stored again: only the new version is found */
+    T_ASSERT(put_job(repo, 2UL, "Mahnung zur Rechnung", "ok"));
+    T_ASSERT(append_event(repo, "ingest.ok", "doc-2"));
+    T_ASSERT_EQ_INT(tbl_fts_update(repo, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.docs, 1UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "mahnung", hits, N_JOBS, &total), 1UL);
+    /* 40 ok jobs, 8 of them rechnung, doc-2 no longer a lieferschein */
+    T_ASSERT_EQ_ULONG(search_n(repo, "lieferschein", hits, N_JOBS, &total), 31UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "rechnung", hits, N_JOBS, &total), 9UL);
+
+    /* direct adds merge too; unknown and unsafe jobs are skipped */
+    jobs[0] = "no-such-job";
+    jobs[1] = "../x";
+    T_ASSERT_EQ_INT(tbl_fts_add(repo, jobs, 2UL, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    for (i = 0UL; i < 40UL; ++i) {
+        job_name(i % 10UL, job, sizeof(job));
+        jobs[0] = job;
+        T_ASSERT_EQ_INT(tbl_fts_add(repo, jobs, 1UL, &n, err, sizeof(err)), 0);
+    }
+    T_ASSERT_EQ_ULONG(search_n(repo, "rechnung", hits, N_JOBS, &total), 9UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "2026", hits, N_JOBS, &total), N_JOBS - N_JOBS / 3UL - 1UL);
+
+    /* a damaged segment is reported, --full rebuilds from offset 0 */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/fts.manifest"));
+    fp = fopen(p, "ab");
+    T_ASSERT(fp != 0);
+    T_ASSERT(tbl_fputs_ok(fp, "bogus\n"));
+    T_ASSERT(fclose(fp) == 0);
+    T_ASSERT(tbl_fts_search(repo, &q, hits, 10UL, &n, &total, err, sizeof(err)) != 0);
+    T_ASSERT_EQ_INT(tbl_fts_update(repo, 1, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.docs, N_JOBS + 1UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "rechnung", hits, N_JOBS, &total), 9UL);
+    T_ASSERT_EQ_ULONG(search_n(repo, "mahnung", hits, N_JOBS, &total), 1UL);
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
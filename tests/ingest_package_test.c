@@ -24,15 +24,48 @@
 #define TBL_CAS_IMPLEMENTATION
 #include "core/cas.h"
 
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
 #define TBL_SPOOL_IMPLEMENTATION
 #include "core/spool.h"
 
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
 #define TBL_RECORD_IMPLEMENTATION
 #include "core/record.h"
 
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
+
+#define TBL_REFIDX_IMPLEMENTATION
+#include "core/refidx.h"
+
+#define TBL_SECIDX_IMPLEMENTATION
+#include "core/secidx.h"
+
+#define TBL_TGIDX_IMPLEMENTATION
+#include "core/tgidx.h"
+
+#define TBL_TAGIDX_IMPLEMENTATION
+#include "core/tagidx.h"
+
+#define TBL_RECSTORE_IMPLEMENTATION
+#include "core/recstore.h"
+
+#define TBL_JOBSTORE_IMPLEMENTATION
+#include "core/jobstore.h"
+
 #define TBL_EVENTS_IMPLEMENTATION
 #include "core/events.h"
 
+#define TBL_EVLOG_IMPLEMENTATION
+#include "core/evlog.h"
+
+#define TBL_INI_IMPLEMENTATION
+#include "core/ini.h"
+
 #define TBL_INGEST_IMPLEMENTATION
 #include "core/ingest.h"
 
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "jobstore_test"
+#include "test.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_SHA256_IMPLEMENTATION
+#include "core/sha256.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_TIME_IMPLEMENTATION
+#include "os/time.h"
+
+#define TBL_JOBSTORE_IMPLEMENTATION
+#include "core/jobstore.h"
+
+#define TBL_EVENTS_IMPLEMENTATION
+#include "core/events.h"
+
+typedef struct hits_s {
+    unsigned long n;
+    char first[256];
+    char last[256];
+} hits_t;
+
+static int hit_cb(void *ud, const char *line, size_t len)
+{
+    hits_t *h = (hits_t *)ud;
+
+    h->n++;
+    if (len >= sizeof(h->last)) len = sizeof(h->last) - 1U;
+    (void)memcpy(h->last, line, len);
+    h->last[len] = '\0';
+    if (h->n == 1UL) (void)tbl_strlcpy(h->first, h->last, sizeof(h->first));
+    return 0;
+}
+
+static unsigned long lookup(const char *root, const char *job, hits_t *h)
+{
+    char err[256];
+
+    (void)memset(h, 0, sizeof(*h));
+    if (tbl_jobstore_each(root, job, hit_cb, h, 0, err, sizeof(err)) != 0) return 9999UL;
+    return h->n;
+}
+
+static int append_raw(const char *path, const char *s)
+{
+    FILE *fp;
+    fp = fopen(path, "ab");
+    if (!fp) return 0;
+    if (fputs(s, fp) == EOF) { fclose(fp); return 0; }
+    return (fclose(fp) == 0) ? 1 : 0;
+}
+
+static int exists(const char *root, const char *rel)
+{
+    char p[512];
+    int ex;
+
+    if (!tbl_path_join2(p, sizeof(p), root, rel)) return -1;
+    ex = 0;
+    (void)tbl_fs_exists(p, &ex);
+    return ex;
+}
+
+static int put_job_file(const char *root, const char *job, const char *data)
+{
+    char d[512];
+    char p[512];
+
+    if (!tbl_path_join2(d, sizeof(d), root, "jobs") || !tbl_path_join2(d, sizeof(d), d, job)) return 0;
+    if (tbl_fs_mkdir_p(d) != 0) return 0;
+    if (!tbl_path_join2(p, sizeof(p), d, "events.log")) return 0;
+    return append_raw(p, data);
+}
+
+int main(void)
+{
+    char root[256];
+    char p[512];
+    char err[256];
+    unsigned long jobs;
+    unsigned long lines;
+    hits_t h;
+    tbl_events_writer_t w;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(root, "tbl_test_jobstore_", sizeof(root));
+        (void)tbl_strlcat(root, nbuf, sizeof(root));
+    }
+    (void)tbl_fs_rm_rf(root);
+    T_ASSERT(tbl_fs_mkdir_p(root) == 0);
+
+    /* buckets: stable FNV-1a placement, 3 hex digits */
+    T_ASSERT_EQ_ULONG(tbl_jobstore_bucket(""), 2166136261UL % 4096UL);
+    T_ASSERT(tbl_jobstore_bucket("jobA") < TBL_JOBSTORE_BUCKETS);
+    T_ASSERT(tbl_jobstore_bucket_path_ok("r", "a", p, sizeof(p)));
+    T_ASSERT_STREQ(p, "r/jobstore/92c.log"); /* FNV-1a("a") = 0xe40c292c */
+    T_ASSERT(tbl_jobstore_jobid_ok("job-1"));
+    T_ASSERT(!tbl_jobstore_jobid_ok("job 1"));
+    T_ASSERT(!tbl_jobstore_jobid_ok(""));
+
+    /* per-job directories until the store exists */
+    err[0] = '\0';
+    T_ASSERT_EQ_INT(tbl_events_append(root, "ingest.ok", "jobOld", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(exists(root, "jobs/jobOld/events.log"), 1);
+    T_ASSERT(!tbl_jobstore_active_ok(root));
+    T_ASSERT_EQ_ULONG(lookup(root, "jobOld", &h), 0UL);
+
+    /* store on: new jobs go to buckets, jobOld keeps its file */
+    T_ASSERT_EQ_INT(tbl_jobstore_create(root, err, sizeof(err)), 0);
+    T_ASSERT(tbl_jobstore_active_ok(root));
+    T_ASSERT_EQ_INT(tbl_events_writer_open(&w, root, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "verify.ok", "jobOld", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_set_batch(&w, 16UL, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "ingest.ok", "jobAB", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "verify.ok", "jobA", "ok", "", "", err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_events_writer_append(&w, "export.ok", "jobAB", "ok", "", "", err, sizeof(err)), 0);
+    tbl_events_writer_close(&w);
+
+    T_ASSERT_EQ_INT(exists(root, "jobs/jobA"), 0);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobA", &h), 2UL);
+    T_ASSERT(strncmp(h.first, "ts=", 3) == 0);
+    T_ASSERT(strstr(h.first, "event=ingest.ok job=jobA ") != NULL);
+    T_ASSERT(strstr(h.last, "event=verify.ok job=jobA ") != NULL);
+    T_ASSERT(h.last[strlen(h.last) - 1] == '\n');
+    T_ASSERT_EQ_ULONG(lookup(root, "jobAB", &h), 2UL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobOld", &h), 0UL);
+    T_ASSERT_EQ_ULONG(lookup(root, "job A", &h), 0UL);
+
+    /* migration moves per-job files and removes their directories */
+    T_ASSERT(put_job_file(root, "jobM", "ts=1 event=ingest.ok job=jobM\nts=2 event=verify.ok job=jobM"));
+    T_ASSERT(put_job_file(root, "jobE", ""));
+    T_ASSERT_EQ_INT(tbl_jobstore_migrate(root, &jobs, &lines, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(jobs, 3UL);
+    T_ASSERT_EQ_ULONG(lines, 4UL);
+    T_ASSERT_EQ_INT(exists(root, "jobs"), 0);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobOld", &h), 2UL);
+    T_ASSERT(strstr(h.last, "event=verify.ok job=jobOld ") != NULL);
+    T_ASSERT_EQ_ULONG(lookup(root, "jobM", &h), 2UL);
+    T_ASSERT_STREQ(h.last, "ts=2 event=verify.ok job=jobM\n"); /* torn tail framed */
+    T_ASSERT_EQ_ULONG(lookup(root, "jobA", &h), 2UL);
+
+    /* nothing left: a second run is a no-op */
+    T_ASSERT_EQ_INT(tbl_jobstore_migrate(root, &jobs, &lines, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(jobs, 0UL);
+
+    /* interrupted after the append: the source is dropped, no duplicates */
+    {
+        char bucket[512];
+        unsigned long off;
+        char nbuf[32];
+        FILE *fp;
+        long n;
+
+        T_ASSERT(tbl_jobstore_bucket_path_ok(root, "jobR", bucket, sizeof(bucket)));
+        fp = fopen(bucket, "rb");
+        off = 0UL;
+        if (fp) {
+            n = (fseek(fp, 0L, SEEK_END) == 0) ? ftell(fp) : -1L;
+            fclose(fp);
+            T_ASSERT(n >= 0L);
+            off = (unsigned long)n;
+        }
+        T_ASSERT(put_job_file(root, "jobR", "ts=5 event=ingest.ok job=jobR\n"));
+        T_ASSERT(append_raw(bucket, "jobR ts=5 event=ingest.ok job=jobR\n"));
+        T_ASSERT(tbl_ul_to_dec_ok(off, nbuf, sizeof(nbuf)));
+        T_ASSERT(tbl_path_join2(p, sizeof(p), root, "jobstore/migrate.pending"));
+        T_ASSERT(append_raw(p, "jobR "));
+        T_ASSERT(append_raw(p, nbuf));
+        T_ASSERT(append_raw(p, "\n"));
+
+        T_ASSERT_EQ_INT(tbl_jobstore_migrate(root, &jobs, &lines, err, sizeof(err)), 0);
+        T_ASSERT_EQ_ULONG(jobs, 1UL);
+        T_ASSERT_EQ_INT(exists(root, "jobs/jobR"), 0);
+        T_ASSERT_EQ_INT(exists(root, "jobstore/migrate.pending"), 0);
+        T_ASSERT_EQ_ULONG(lookup(root, "jobR", &h), 1UL);
+
+        /* a torn append is not guessed at */
+        T_ASSERT(put_job_file(root, "jobR", "ts=6 event=verify.ok job=jobR\n"));
+        fp = fopen(bucket, "rb");
+        T_ASSERT(fp != NULL);
+        n = (fseek(fp, 0L, SEEK_END) == 0) ? ftell(fp) : -1L;
+        fclose(fp);
+        T_ASSERT(tbl_ul_to_dec_ok((unsigned long)n, nbuf, sizeof(nbuf)));
+        T_ASSERT(append_raw(bucket, "jobR ts=6 eve"));
+        T_ASSERT(append_raw(p, "jobR "));
+        T_ASSERT(append_raw(p, nbuf));
+        T_ASSERT(append_raw(p, "\n"));
+        T_ASSERT_EQ_INT(tbl_jobstore_migrate(root, &jobs, &lines, err, sizeof(err)), 2);
+        T_ASSERT(strstr(err, "partial record") != NULL);
+        T_ASSERT_EQ_INT(exists(root, "jobs/jobR/events.log"), 1);
+    }
+
+    (void)tbl_fs_rm_rf(root);
+    T_OK();
+}
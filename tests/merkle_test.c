@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "merkle_test"
+#include "test.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_SHA256_IMPLEMENTATION
+#include "core/sha256.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_TLZ_IMPLEMENTATION
+#include "core/tlz.h"
+
+#define TBL_AUDIT_IMPLEMENTATION
+#include "core/audit.h"
+
+#define TBL_MERKLE_IMPLEMENTATION
+#include "core/merkle.h"
+
+#define N_MAX 40UL
+
+static char g_lines[N_MAX][32];
+
+static void mk_line(unsigned long i, char *out, size_t outsz)
+{
+    char nbuf[32];
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(out, "ts=1 event=test job=j", outsz);
+    (void)tbl_strlcat(out, nbuf, outsz);
+}
+
+/* reference: MTH(D[a:b]) straight from RFC 6962 */
+static void ref_mth(unsigned long a, unsigned long b, unsigned char out[32])
+{
+    unsigned char l[32];
+    unsigned char r[32];
+    unsigned long k;
+    tbl_sha256_t st;
+    unsigned char pfx = 1;
+
+    if (b - a == 1UL) {
+        tbl_merkle_leaf_hash(g_lines[a], strlen(g_lines[a]), out);
+        return;
+    }
+    k = 1UL;
+    while (k * 2UL < b - a) k *= 2UL;
+    ref_mth(a, a + k, l);
+    ref_mth(a + k, b, r);
+    tbl_sha256_init(&st);
+    tbl_sha256_update(&st, &pfx, 1);
+    tbl_sha256_update(&st, l, 32);
+    tbl_sha256_update(&st, r, 32);
+    tbl_sha256_final(&st, out);
+}
+
+static int append_line(const char *path, const char *s)
+{
+    FILE *fp;
+    int ok;
+
+    fp = fopen(path, "ab");
+    if (!fp) return 0;
+    ok = (fputs(s, fp) != EOF && fputc('\n', fp) != EOF) ? 1 : 0;
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+static int find_cb(void *ud, unsigned long leaf, const char *line, size_t len)
+{
+    unsigned long *hit = (unsigned long *)ud;
+    if (len == strlen(g_lines[7]) && memcmp(line, g_lines[7], len) == 0) {
+        *hit = leaf;
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    char root[256];
+    char seg1[512];
+    char ops[512];
+    char p[512];
+    char err[256];
+    char hex[65];
+    unsigned char roots[N_MAX + 1UL][32];
+    unsigned char path[TBL_MERKLE_MAX_PATH][32];
+    unsigned char want[32];
+    unsigned char lh[32];
+    unsigned long size;
+    unsigned long n;
+    unsigned long i;
+    unsigned long j;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(root, "tbl_test_merkle_", sizeof(root));
+        (void)tbl_strlcat(root, nbuf, sizeof(root));
+    }
+    (void)tbl_fs_rm_rf(root);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "audit"));
+    T_ASSERT(tbl_fs_mkdir_p(p) == 0);
+    T_ASSERT(tbl_path_join2(seg1, sizeof(seg1), root, "audit/ops.000001.log"));
+    T_ASSERT(tbl_path_join2(ops, sizeof(ops), root, "audit/ops.log"));
+
+    for (i = 0UL; i < N_MAX; ++i) mk_line(i, g_lines[i], sizeof(g_lines[i]));
+
+    /* grow one line per sync: roots match the reference tree */
+    err[0] = '\0';
+    for (i = 0UL; i < N_MAX; ++i) {
+        T_ASSERT(append_line(ops, g_lines[i]));
+        T_ASSERT_EQ_INT(tbl_merkle_sync(root, &size, hex, err, sizeof(err)), 0);
+        T_ASSERT_EQ_ULONG(size, i + 1UL);
+        ref_mth(0UL, i + 1UL, want);
+        T_ASSERT_EQ_INT(tbl_merkle_root(root, i + 1UL, roots[i + 1UL], err, sizeof(err)), 0);
+        T_ASSERT(memcmp(roots[i + 1UL], want, 32) == 0);
+    }
+
+    /* nothing new: same root */
+    T_ASSERT_EQ_INT(tbl_merkle_sync(root, &size, hex, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(size, N_MAX);
+
+    /* inclusion proofs for every leaf of every tree size */
+    for (j = 1UL; j <= N_MAX; ++j) {
+        for (i = 0UL; i < j; ++i) {
+            T_ASSERT_EQ_INT(tbl_merkle_inclusion(root, i, j, path, &n, err, sizeof(err)), 0);
+            tbl_merkle_leaf_hash(g_lines[i], strlen(g_lines[i]), lh);
+            T_ASSERT(tbl_merkle_verify_inclusion_ok(i, j, lh, path, n, roots[j]));
+            if (j > 1UL) {
+                /* wrong leaf or wrong position */
+                tbl_merkle_leaf_hash(g_lines[(i + 1UL) % j], strlen(g_lines[(i + 1UL) % j]), lh);
+                T_ASSERT(!tbl_merkle_verify_inclusion_ok(i, j, lh, path, n, roots[j]));
+            }
+        }
+    }
+    T_ASSERT(tbl_merkle_inclusion(root, N_MAX, N_MAX, path, &n, err, sizeof(err)) != 0);
+
+    /* consistency proofs between every pair of sizes */
+    for (j = 1UL; j <= N_MAX; ++j) {
+        for (i = 1UL; i <= j; ++i) {
+            T_ASSERT_EQ_INT(tbl_merkle_consistency(root, i, j, path, &n, err, sizeof(err)), 0);
+            T_ASSERT(tbl_merkle_verify_consistency_ok(i, j, roots[i], roots[j], path, n));
+            if (i < j) {
+                T_ASSERT(!tbl_merkle_verify_consistency_ok(i, j, roots[j], roots[j], path, n));
+            }
+        }
+    }
+    T_ASSERT(tbl_merkle_consistency(root, 0UL, N_MAX, path, &n, err, sizeof(err)) != 0);
+
+    /* interrupted sync: extra node in level.00 -> rebuilt from the log */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "audit/merkle/level.00"));
+    T_ASSERT(append_line(p, "0123456789012345678901234567890"));
+    T_ASSERT_EQ_INT(tbl_merkle_sync(root, &size, hex, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(size, N_MAX);
+    T_ASSERT_EQ_INT(tbl_merkle_root(root, N_MAX, want, err, sizeof(err)), 0);
+    T_ASSERT(memcmp(want, roots[N_MAX], 32) == 0);
+
+    /* sealing the active log keeps leaf numbering; torn tails wait */
+    T_ASSERT(tbl_fs_rename_atomic(ops, seg1, 0) == 0);
+    T_ASSERT(tbl_fs_write_file(ops, "ts=2 event=next\nts=3 ev", 23) == 0);
+    T_ASSERT_EQ_INT(tbl_merkle_sync(root, &size, hex, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(size, N_MAX + 1UL);
+    T_ASSERT_EQ_INT(tbl_merkle_consistency(root, N_MAX, N_MAX + 1UL, path, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_merkle_root(root, N_MAX + 1UL, want, err, sizeof(err)), 0);
+    T_ASSERT(tbl_merkle_verify_consistency_ok(N_MAX, N_MAX + 1UL, roots[N_MAX], want, path, n));
+
+    /* line walk spans segments */
+    j = 0UL;
+    T_ASSERT_EQ_INT(tbl_merkle_each_line(root, find_cb, &j, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(j, 7UL);
+
+    /* the state is gone: full rebuild gives the same tree */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "audit/merkle/state"));
+    T_ASSERT(tbl_fs_remove_file(p) == 0);
+    T_ASSERT_EQ_INT(tbl_merkle_sync(root, &size, hex, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(size, N_MAX + 1UL);
+    T_ASSERT_EQ_INT(tbl_merkle_root(root, N_MAX, lh, err, sizeof(err)), 0);
+    T_ASSERT(memcmp(lh, roots[N_MAX], 32) == 0);
+
+    /* a compressed sealed segment reads the same */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "audit/ops.000001.log.tlz"));
+    T_ASSERT_EQ_INT(tbl_tlz_compress_file(seg1, p, 2UL, 0, 0, err, sizeof(err)), 0);
+    T_ASSERT(tbl_fs_remove_file(seg1) == 0);
+    j = 0UL;
+    T_ASSERT_EQ_INT(tbl_merkle_each_line(root, find_cb, &j, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(j, 7UL);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), root, "audit/merkle/state"));
+    T_ASSERT(tbl_fs_remove_file(p) == 0);
+    T_ASSERT_EQ_INT(tbl_merkle_sync(root, &size, hex, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(size, N_MAX + 1UL);
+    T_ASSERT_EQ_INT(tbl_merkle_root(root, N_MAX, lh, err, sizeof(err)), 0);
+    T_ASSERT(memcmp(lh, roots[N_MAX], 32) == 0);
+
+    (void)tbl_fs_rm_rf(root);
+    T_OK();
+}
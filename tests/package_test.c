@@ -19,18 +19,48 @@
 #define TBL_FS_IMPLEMENTATION
 #include "os/fs.h"
 
+#define TBL_TIME_IMPLEMENTATION
+#include "os/time.h"
+
 #define TBL_INI_IMPLEMENTATION
 #include "core/ini.h"
 
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
 #define TBL_RECORD_IMPLEMENTATION
 #include "core/record.h"
 
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
+
+#define TBL_REFIDX_IMPLEMENTATION
+#include "core/refidx.h"
+
+#define TBL_SECIDX_IMPLEMENTATION
+#include "core/secidx.h"
+
+#define TBL_TGIDX_IMPLEMENTATION
+#include "core/tgidx.h"
+
+#define TBL_TAGIDX_IMPLEMENTATION
+#include "core/tagidx.h"
+
+#define TBL_RECSTORE_IMPLEMENTATION
+#include "core/recstore.h"
+
 #define TBL_CAS_IMPLEMENTATION
 #include "core/cas.h"
 
+#define TBL_JOBSTORE_IMPLEMENTATION
+#include "core/jobstore.h"
+
 #define TBL_EVENTS_IMPLEMENTATION
 #include "core/events.h"
 
+#define TBL_EVIDX_IMPLEMENTATION
+#include "core/evidx.h"
+
 #define TBL_PACKAGE_IMPLEMENTATION
 #include "core/package.h"
 
@@ -141,6 +171,21 @@ T_ASSERT(tbl_fs_mkdir_p(root) == 0);
     T_ASSERT(read_file(events_log, buf, sizeof(buf)) == 0);
     T_ASSERT(strstr(buf, "event=ingest.ok") != NULL);
 
+    /* after migrate-jobs the bucket store is the job stream */
+    err[0] = '\0';
+    T_ASSERT_EQ_INT(tbl_jobstore_migrate(repo_root, 0, 0, err, sizeof(err)), 0);
+    T_ASSERT(tbl_path_join2(pkg_dir, sizeof(pkg_dir), root, "pkg2"));
+    rc = tbl_package_job(repo_root, rec.job, pkg_dir, TBL_PKG_AIP, err, sizeof(err));
+    T_ASSERT(rc == 0);
+    T_ASSERT(tbl_path_join2(meta_dir, sizeof(meta_dir), pkg_dir, "metadata"));
+    T_ASSERT(tbl_path_join2(package_ini, sizeof(package_ini), meta_dir, "package.ini"));
+    T_ASSERT(read_file(package_ini, buf, sizeof(buf)) == 0);
+    T_ASSERT(strstr(buf, "events_source = job") != NULL);
+    T_ASSERT(tbl_path_join2(events_log, sizeof(events_log), meta_dir, "events.log"));
+    T_ASSERT(read_file(events_log, buf, sizeof(buf)) == 0);
+    T_ASSERT(strncmp(buf, "ts=", 3) == 0);
+    T_ASSERT(strstr(buf, "event=ingest.ok") != NULL);
+
     (void)tbl_fs_rm_rf(root);
 
     T_OK();
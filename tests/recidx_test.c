@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "recidx_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
+
+#define N_JOBS 3000UL
+
+static void mk_rec(unsigned long i, tbl_record_t *r)
+{
+    static const char hex[] = "0123456789abcdef";
+    char nbuf[32];
+    size_t k;
+
+    (void)memset(r, 0, sizeof(*r));
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(r->job, "job-", sizeof(r->job));
+    (void)tbl_strlcat(r->job, nbuf, sizeof(r->job));
+    (void)tbl_strlcpy(r->payload, "payload.bin", sizeof(r->payload));
+    if (i % 5UL == 0UL) {
+        (void)tbl_strlcpy(r->status, "fail", sizeof(r->status));
+        /* long reasons fill the string heap */
+        for (k = 0; k < 200U; ++k) r->reason[k] = (char)('a' + (int)((i + k) % 26UL));
+        r->reason[200] = '\0';
+    } else {
+        (void)tbl_strlcpy(r->status, "ok", sizeof(r->status));
+        for (k = 0; k < 64U; ++k) r->sha256[k] = hex[(i * 7UL + k) & 15UL];
+        r->sha256[64] = '\0';
+    }
+    r->bytes = i * 1000UL;
+    r->stored_at = 1700000000UL + i;
+}
+
+static int rec_eq(const tbl_record_t *a, const tbl_record_t *b)
+{
+    return tbl_streq(a->job, b->job) && tbl_streq(a->status, b->status) &&
+           tbl_streq(a->payload, b->payload) && tbl_streq(a->sha256, b->sha256) &&
+           a->bytes == b->bytes && a->stored_at == b->stored_at && tbl_streq(a->reason, b->reason) &&
+           tbl_streq(a->tags, b->tags);
+}
+
+static int store_ok(const char *repo, const tbl_record_t *r)
+{
+    return tbl_recidx_invalidate(repo, r->job, 0, 0) == 0 && tbl_record_write_repo(repo, r, 0, 0) == 0 &&
+           tbl_recidx_put(repo, r, 0, 0) == 0;
+}
+
+int main(void)
+{
+    char repo[256];
+    char p[512];
+    char q[512];
+    int ex;
+    char err[256];
+    tbl_record_t r;
+    tbl_record_t got;
+    tbl_record_t want;
+    unsigned long i;
+    unsigned long n;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_recidx_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/records.idx"));
+
+    /* no index yet: a miss, not an error */
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, "job-1", &got, err, sizeof(err)), 1);
+
+    /* incremental puts grow the table and its heap; lookups match the .ini */
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        T_ASSERT(store_ok(repo, &r));
+    }
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), 0);
+        T_ASSERT_EQ_INT(tbl_record_read_repo(repo, r.job, &want, err, sizeof(err)), 0);
+        T_ASSERT(rec_eq(&got, &want));
+    }
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, "job-x", &got, err, sizeof(err)), 1);
+
+    /* replace in place */
+    mk_rec(7UL, &r);
+    (void)tbl_strlcpy(r.status, "fail", sizeof(r.status));
+    (void)tbl_strlcpy(r.reason, "re-ingested", sizeof(r.reason));
+    T_ASSERT(store_ok(repo, &r));
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), 0);
+    T_ASSERT(rec_eq(&got, &r));
+
+    /* tags ride along in the string heap */
+    T_ASSERT_EQ_INT(tbl_record_tag_set(&r, "customer", "ACME GmbH"), 0);
+    T_ASSERT_EQ_INT(tbl_record_tag_set(&r, "doctype", "invoice"), 0);
+    T_ASSERT(store_ok(repo, &r));
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), 0);
+    T_ASSERT(rec_eq(&got, &r));
+    T_ASSERT_EQ_INT(tbl_record_read_repo(repo, r.job, &want, err, sizeof(err)), 0);
+    T_ASSERT(rec_eq(&got, &want));
+
+    /* a record the table cannot hold exactly falls back to the .ini */
+    mk_rec(8UL, &r);
+    (void)tbl_strlcpy(r.status, "held", sizeof(r.status));
+    (void)tbl_strlcpy(r.sha256, "ABC", sizeof(r.sha256));
+    T_ASSERT(store_ok(repo, &r));
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), 1);
+    T_ASSERT_EQ_INT(tbl_recidx_read(repo, r.job, &got, err, sizeof(err)), 0);
+    T_ASSERT_STREQ(got.status, "held");
+    T_ASSERT_STREQ(got.sha256, "ABC");
+
+    /* a damaged slot is skipped (read falls back), never misread */
+    {
+        FILE *fp;
+        unsigned long j;
+
+        fp = fopen(p, "r+b");
+        T_ASSERT(fp != NULL);
+        for (j = 0UL; j < 4096UL; ++j) {
+            unsigned char s[72];
+            T_ASSERT(fseek(fp, (long)(64UL + j * 72UL), SEEK_SET) == 0);
+            T_ASSERT(fread(s, 1, 72, fp) == 72U);
+            if ((s[0] | s[1] | s[2] | s[3]) && s[10] != 0) {
+                s[60] ^= 0x40;
+                T_ASSERT(fseek(fp, (long)(64UL + j * 72UL), SEEK_SET) == 0);
+                T_ASSERT(fwrite(s, 1, 72, fp) == 72U);
+                break;
+            }
+        }
+        T_ASSERT(fclose(fp) == 0);
+        n = 0UL;
+        for (i = 0UL; i < N_JOBS; ++i) {
+            mk_rec(i, &r);
+            if (tbl_recidx_get(repo, r.job, &got, err, sizeof(err)) != 0) {
+                n++;
+                T_ASSERT_EQ_INT(tbl_recidx_read(repo, r.job, &got, err, sizeof(err)), 0);
+            }
+            T_ASSERT_EQ_INT(tbl_record_read_repo(repo, r.job, &want, err, sizeof(err)), 0);
+            T_ASSERT(rec_eq(&got, &want));
+        }
+        T_ASSERT_EQ_ULONG(n, 2UL);
+    }
+
+    /* a put that fails after the record was rewritten (records.lock cannot
+       be opened): the slot dropped beforehand sends readers to the record */
+    T_ASSERT(tbl_path_join2(q, sizeof(q), repo, "index/records.lock"));
+    mk_rec(9UL, &r);
+    r.bytes = 999999UL;
+    T_ASSERT_EQ_INT(tbl_recidx_invalidate(repo, r.job, err, sizeof(err)), 0);
+    T_ASSERT(tbl_fs_remove_file(q) == 0);
+    T_ASSERT(tbl_fs_mkdir_p(q) == 0);
+    T_ASSERT(tbl_record_write_repo(repo, &r, 0, 0) == 0);
+    T_ASSERT_EQ_INT(tbl_recidx_put(repo, &r, err, sizeof(err)), 2);
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), 1);
+    T_ASSERT_EQ_INT(tbl_recidx_read(repo, r.job, &got, err, sizeof(err)), 0);
+    T_ASSERT(rec_eq(&got, &r));
+
+    /* the slot cannot be dropped either: records.stale hides the table */
+    mk_rec(11UL, &r);
+    r.bytes = 999999UL;
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_recidx_invalidate(repo, r.job, err, sizeof(err)), 0);
+    T_ASSERT(tbl_record_write_repo(repo, &r, 0, 0) == 0);
+    T_ASSERT_EQ_INT(tbl_recidx_put(repo, &r, err, sizeof(err)), 2);
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), 1);
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, "job-12", &got, err, sizeof(err)), 1);
+    T_ASSERT_EQ_INT(tbl_recidx_read(repo, r.job, &got, err, sizeof(err)), 0);
+    T_ASSERT(rec_eq(&got, &r));
+    T_ASSERT(tbl_fs_rm_rf(q) == 0);
+
+    /* a rebuild takes the new records and drops records.stale */
+    T_ASSERT_EQ_INT(tbl_recidx_build(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT(tbl_path_join2(q, sizeof(q), repo, "index/records.stale"));
+    ex = 1;
+    T_ASSERT(tbl_fs_exists(q, &ex) == 0);
+    T_ASSERT_EQ_INT(ex, 0);
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), 0);
+    T_ASSERT(rec_eq(&got, &r));
+
+    /* rebuild from records/: a job= that does not match its file is left out */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "records/odd.ini"));
+    T_ASSERT(tbl_fs_write_file(p, "status=ok\njob=other\n", 20) == 0);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/records.idx"));
+    T_ASSERT(tbl_fs_write_file(p, "garbage", 7) == 0);
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, "job-1", &got, err, sizeof(err)), 2);
+    T_ASSERT_EQ_INT(tbl_recidx_build(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, N_JOBS - 1UL);
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        T_ASSERT_EQ_INT(tbl_recidx_get(repo, r.job, &got, err, sizeof(err)), i == 8UL ? 1 : 0);
+    }
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, "odd", &got, err, sizeof(err)), 1);
+    T_ASSERT_EQ_INT(tbl_recidx_read(repo, "odd", &got, err, sizeof(err)), 0);
+    T_ASSERT_STREQ(got.job, "other");
+
+    /* empty repo: empty index */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "records"));
+    T_ASSERT(tbl_fs_rm_rf(p) == 0);
+    T_ASSERT_EQ_INT(tbl_recidx_build(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, "job-1", &got, err, sizeof(err)), 1);
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
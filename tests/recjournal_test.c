@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "recjournal_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+/* small journal and blocks: folds, merges and block edges all run */
+#define TBL_RECJOURNAL_MAX 4096UL
+#define TBL_RECJOURNAL_BLOCK 4UL
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define N_JOBS 900UL
+
+static unsigned long g_bytes[N_JOBS];
+
+static void mk_job(unsigned long i, char *job, size_t jobsz)
+{
+    char nbuf[32];
+
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(job, "job-", jobsz);
+    (void)tbl_strlcat(job, nbuf, jobsz);
+}
+
+static void mk_rec(unsigned long i, tbl_record_t *r)
+{
+    (void)memset(r, 0, sizeof(*r));
+    mk_job(i, r->job, sizeof(r->job));
+    (void)tbl_strlcpy(r->status, "ok", sizeof(r->status));
+    (void)tbl_strlcpy(r->payload, "payload.bin", sizeof(r->payload));
+    r->bytes = g_bytes[i];
+    r->stored_at = 1700000000UL + i;
+}
+
+static int put_ok(const char *repo, unsigned long i)
+{
+    tbl_record_t r;
+
+    mk_rec(i, &r);
+    return tbl_record_write_repo(repo, &r, 0, 0) == 0;
+}
+
+static int get_ok(const char *repo, unsigned long i)
+{
+    tbl_record_t r;
+    tbl_record_t got;
+
+    mk_rec(i, &r);
+    if (tbl_record_read_repo(repo, r.job, &got, 0, 0) != 0) return 0;
+    return tbl_streq(got.job, r.job) && tbl_streq(got.status, "ok") && got.bytes == r.bytes &&
+           got.stored_at == r.stored_at;
+}
+
+typedef struct walk_s {
+    unsigned char hit[N_JOBS];
+    unsigned long upto;
+    unsigned long n;
+    unsigned long bad;
+    char last[64];
+} walk_t;
+
+static int walk_cb(void *ud, const char *jobid, const char *body, size_t len)
+{
+    walk_t *w = (walk_t *)ud;
+    tbl_record_t got;
+    unsigned long i;
+
+    w->n++;
+    if (w->last[0] && strcmp(w->last, jobid) >= 0) w->bad++; /* sorted, once each */
+    (void)tbl_strlcpy(w->last, jobid, sizeof(w->last));
+    (void)memset(&got, 0, sizeof(got));
+    tbl_record_parse_text(body, len, &got);
+    if (strncmp(jobid, "job-", 4) != 0 || !tbl_parse_u32_ok(jobid + 4, &i) || i >= w->upto || w->hit[i] ||
+        got.bytes != g_bytes[i]) {
+        w->bad++;
+        return 0;
+    }
+    w->hit[i] = 1;
+    return 0;
+}
+
+/* every job 0..upto-1 exactly once, with its newest record */
+static int walk_ok(const char *repo, unsigned long upto)
+{
+    static walk_t w;
+    unsigned long n;
+
+    (void)memset(&w, 0, sizeof(w));
+    w.upto = upto;
+    if (tbl_recjournal_each(repo, walk_cb, &w, &n, 0, 0) != 0) return 0;
+    return n == upto && w.n == upto && w.bad == 0UL;
+}
+
+static int count_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    (void)full;
+    if (!is_dir && strncmp(name, "snap.", 5) == 0) ++*(unsigned long *)ud;
+    return 0;
+}
+
+static int rec_count_cb(void *ud, const tbl_record_t *rec)
+{
+    (void)rec;
+    ++*(unsigned long *)ud;
+    return 0;
+}
+
+static unsigned long count_files(const char *dir)
+{
+    unsigned long n = 0UL;
+    (void)tbl_fs_list_dir(dir, count_cb, &n);
+    return n;
+}
+
+static int flip_byte(const char *path, long from_end)
+{
+    FILE *fp;
+    unsigned char c;
+
+    fp = fopen(path, "r+b");
+    if (!fp) return 0;
+    if (fseek(fp, -from_end, SEEK_END) != 0 || fread(&c, 1, 1, fp) != 1U) {
+        fclose(fp);
+        return 0;
+    }
+    c ^= 0x5a;
+    if (fseek(fp, -from_end, SEEK_END) != 0 || fwrite(&c, 1, 1, fp) != 1U) {
+        fclose(fp);
+        return 0;
+    }
+    return fclose(fp) == 0;
+}
+
+int main(void)
+{
+    char repo[256];
+    char dir[512];
+    char p[1024];
+    char q[1024];
+    char body[TBL_RECJOURNAL_BODY_MAX + 1];
+    char err[256];
+    tbl_record_t r;
+    tbl_record_t got;
+    unsigned long i;
+    unsigned long n;
+    size_t len;
+    int ex;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_recjournal_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+    T_ASSERT(tbl_path_join2(dir, sizeof(dir), repo, "recjournal"));
+
+    /* a record written before the switch stays readable as .ini */
+    for (i = 0UL; i < N_JOBS; ++i) g_bytes[i] = i;
+    T_ASSERT(put_ok(repo, 0UL));
+    T_ASSERT_EQ_INT(tbl_recjournal_active_ok(repo), 0);
+
+    /* store = journal */
+    T_ASSERT_EQ_INT(tbl_recjournal_create(repo, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_recjournal_active_ok(repo), 1);
+    T_ASSERT_EQ_INT(tbl_recjournal_view_ok(repo), 0);
+    T_ASSERT(get_ok(repo, 0UL));
+    T_ASSERT_EQ_INT(tbl_recjournal_get(repo, "job-0", body, sizeof(body), &len, err, sizeof(err)), 1);
+    T_ASSERT(walk_ok(repo, 0UL));
+
+    /* writes append; the journal folds into snapshots, snapshots merge */
+    for (i = 1UL; i < N_JOBS; ++i) {
+        T_ASSERT(put_ok(repo, i));
+        if (i % 97UL == 0UL) {
+            T_ASSERT(get_ok(repo, i));
+            T_ASSERT(get_ok(repo, i / 2UL));
+            T_ASSERT(get_ok(repo, 1UL));
+        }
+    }
+    for (i = 1UL; i < N_JOBS; ++i) T_ASSERT(get_ok(repo, i));
+    n = count_files(dir);
+    T_ASSERT(n >= 1UL && n <= 12UL);
+    T_ASSERT(tbl_record_path(repo, "job-1", q, sizeof(q)));
+    ex = 1;
+    (void)tbl_fs_exists(q, &ex);
+    T_ASSERT_EQ_INT(ex, 0); /* no .ini without the view */
+
+    /* migrate imports the .ini written before the switch */
+    T_ASSERT_EQ_INT(tbl_record_migrate(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+    T_ASSERT(get_ok(repo, 0UL));
+    T_ASSERT_EQ_INT(tbl_recjournal_get(repo, "job-0", body, sizeof(body), &len, err, sizeof(err)), 0);
+    T_ASSERT(tbl_record_path(repo, "job-0", q, sizeof(q)));
+    ex = 1;
+    (void)tbl_fs_exists(q, &ex);
+    T_ASSERT_EQ_INT(ex, 0);
+    T_ASSERT_EQ_INT(tbl_record_migrate(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    T_ASSERT(walk_ok(repo, N_JOBS));
+
+    /* rewrites: the newest frame wins, in the journal and after folding */
+    for (i = 0UL; i < N_JOBS; i += 7UL) {
+        g_bytes[i] = 100000UL + i;
+        T_ASSERT(put_ok(repo, i));
+    }
+    for (i = 0UL; i < N_JOBS; ++i) T_ASSERT(get_ok(repo, i));
+    T_ASSERT(walk_ok(repo, N_JOBS));
+
+    /* record.h on top: exists, copy, each */
+    T_ASSERT_EQ_INT(tbl_record_exists_ok(repo, "job-5"), 1);
+    T_ASSERT_EQ_INT(tbl_record_exists_ok(repo, "job-x"), 0);
+    T_ASSERT(tbl_path_join2(q, sizeof(q), repo, "copy.ini"));
+    T_ASSERT_EQ_INT(tbl_record_copy_to(repo, "job-7", q, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_record_read_file(q, &got, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(got.bytes, 100007UL);
+    T_ASSERT_STREQ(got.job, "job-7");
+    T_ASSERT(tbl_record_copy_to(repo, "job-x", q, err, sizeof(err)) != 0);
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_record_each(repo, rec_count_cb, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, N_JOBS);
+
+    /* torn frame at the tail (crash mid-append): skipped, writes go on */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), dir, "journal.log"));
+    {
+        tbl_fs_afile_t af;
+        static const char torn[] = "\nTBLRJ1 40 0badf00d job-torn\nstatus=ok\nby";
+
+        T_ASSERT(tbl_fs_afile_open(&af, p) == 0);
+        T_ASSERT(tbl_fs_afile_write(&af, torn, sizeof(torn) - 1U) == 0);
+        T_ASSERT(tbl_fs_afile_close(&af) == 0);
+    }
+    g_bytes[3] = 33UL;
+    T_ASSERT(put_ok(repo, 3UL));
+    T_ASSERT(get_ok(repo, 3UL));
+    T_ASSERT_EQ_INT(tbl_recjournal_get(repo, "job-torn", body, sizeof(body), &len, err, sizeof(err)), 1);
+    T_ASSERT(walk_ok(repo, N_JOBS));
+
+    /* the .ini view: writers keep records/<ab>/<jobid>.ini as well */
+    T_ASSERT_EQ_INT(tbl_recjournal_create(repo, 1, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_recjournal_view_ok(repo), 1);
+    g_bytes[9] = 99UL;
+    T_ASSERT(put_ok(repo, 9UL));
+    T_ASSERT(tbl_record_path(repo, "job-9", q, sizeof(q)));
+    T_ASSERT_EQ_INT(tbl_record_read_file(q, &got, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(got.bytes, 99UL);
+    T_ASSERT(get_ok(repo, 9UL));
+
+    /* bad input */
+    T_ASSERT_EQ_INT(tbl_recjournal_put(repo, "job-1", "no newline", 10U, err, sizeof(err)), 2);
+    T_ASSERT_EQ_INT(tbl_recjournal_put(repo, "job 1", "a=b\n", 4U, err, sizeof(err)), 2);
+    mk_rec(1UL, &r);
+    (void)tbl_strlcpy(r.job, "a/b", sizeof(r.job));
+    T_ASSERT(tbl_record_write_repo(repo, &r, err, sizeof(err)) != 0);
+
+    /* a damaged snapshot is reported, never read around */
+    {
+        tbl_recjournal_man_t man;
+        tbl_recjournal_paths_t jp;
+
+        T_ASSERT(tbl_recjournal_paths(repo, &jp));
+        T_ASSERT(tbl_recjournal_man_read(jp.man, &man));
+        T_ASSERT(man.nsnaps >= 1UL);
+        T_ASSERT(tbl_recjournal_snap_path(&jp, man.seq[0], 0, q, sizeof(q)));
+        T_ASSERT(flip_byte(q, 200L));
+    }
+    {
+        static walk_t w;
+
+        (void)memset(&w, 0, sizeof(w));
+        w.upto = N_JOBS;
+        T_ASSERT(tbl_recjournal_each(repo, walk_cb, &w, &n, err, sizeof(err)) == 2);
+    }
+    T_ASSERT(err[0] != '\0');
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
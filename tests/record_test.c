@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "record_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_INI_IMPLEMENTATION
+#include "core/ini.h"
+
+#define TBL_CONFIG_IMPLEMENTATION
+#include "core/config.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define N_JOBS 600UL
+
+typedef struct seen_s {
+    unsigned char hit[N_JOBS];
+    unsigned long n;
+    unsigned long bad;
+} seen_t;
+
+/* applies [records] the way main() does */
+static int use_cfg_ok(const char *ini)
+{
+    tbl_cfg_t cfg;
+    char err[256];
+
+    if (tbl_cfg_load_buf(&cfg, ini, strlen(ini), err, sizeof(err)) != 0) return 0;
+    tbl_record_set_store(cfg.records_journal ? TBL_RECORD_STORE_JOURNAL : TBL_RECORD_STORE_FILES,
+                         cfg.records_ini_view ? 1 : 0);
+    return 1;
+}
+
+static void mk_rec(unsigned long i, tbl_record_t *r)
+{
+    char nbuf[32];
+
+    (void)memset(r, 0, sizeof(*r));
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(r->job, "job-", sizeof(r->job));
+    (void)tbl_strlcat(r->job, nbuf, sizeof(r->job));
+    (void)tbl_strlcpy(r->status, "ok", sizeof(r->status));
+    (void)tbl_strlcpy(r->payload, "payload.bin", sizeof(r->payload));
+    r->bytes = i;
+    r->stored_at = 1700000000UL + i;
+}
+
+static int seen_cb(void *ud, const tbl_record_t *rec)
+{
+    seen_t *s = (seen_t *)ud;
+    unsigned long i;
+
+    s->n++;
+    if (strncmp(rec->job, "job-", 4) != 0 || !tbl_parse_u32_ok(rec->job + 4, &i) || i >= N_JOBS || s->hit[i] ||
+        rec->bytes != i) {
+        s->bad++;
+        return 0;
+    }
+    s->hit[i] = 1;
+    return 0;
+}
+
+static int stop_cb(void *ud, const tbl_record_t *rec)
+{
+    (void)rec;
+    ++*(unsigned long *)ud;
+    return 1;
+}
+
+/* every job seen exactly once, whatever layout it is in */
+static int walk_ok(const char *repo)
+{
+    static seen_t s;
+    char err[256];
+
+    (void)memset(&s, 0, sizeof(s));
+    if (tbl_record_each(repo, seen_cb, &s, err, sizeof(err)) != 0) return 0;
+    return s.n == N_JOBS && s.bad == 0UL;
+}
+
+static int all_read_ok(const char *repo)
+{
+    tbl_record_t r;
+    tbl_record_t got;
+    char err[256];
+    unsigned long i;
+
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        if (tbl_record_read_repo(repo, r.job, &got, err, sizeof(err)) != 0) return 0;
+        if (!tbl_streq(got.job, r.job) || got.bytes != r.bytes || got.stored_at != r.stored_at) return 0;
+    }
+    return 1;
+}
+
+/* put a record where a repo from before the sharding would have it */
+static int write_flat_ok(const char *repo, const tbl_record_t *r)
+{
+    char shard[1024];
+    char flat[1024];
+
+    return tbl_record_write_repo(repo, r, 0, 0) == 0 &&
+           tbl_record_path(repo, r->job, shard, sizeof(shard)) &&
+           tbl_record_flat_path(repo, r->job, flat, sizeof(flat)) &&
+           tbl_fs_rename_atomic(shard, flat, 0) == 0;
+}
+
+static int tag_count_cb(void *ud, const char *key, const char *value)
+{
+    (void)key;
+    (void)value;
+    ++*(unsigned long *)ud;
+    return 0;
+}
+
+static int count_cb(void *ud, const char *name, const char *full, int is_dir)
+{
+    (void)full;
+    if (!is_dir && tbl_str_ends_with(name, ".ini")) ++*(unsigned long *)ud;
+    return 0;
+}
+
+int main(void)
+{
+    char repo[256];
+    char p[1024];
+    char q[1024];
+    char err[256];
+    tbl_record_t r;
+    tbl_record_t got;
+    unsigned long moved;
+    unsigned long n;
+    unsigned long i;
+    int ex;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_record_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+
+    /* shard = 2 hex digits of FNV-1a(jobid) & 0xff */
+    T_ASSERT_EQ_ULONG(tbl_record_shard("job-1"), 0x16UL);
+    T_ASSERT(tbl_record_path("r", "job-1", p, sizeof(p)));
+    T_ASSERT(tbl_path_join2(q, sizeof(q), "r", "records/16/job-1.ini"));
+    T_ASSERT_STREQ(p, q);
+    T_ASSERT(tbl_record_flat_path("r", "job-1", p, sizeof(p)));
+    T_ASSERT(tbl_path_join2(q, sizeof(q), "r", "records/job-1.ini"));
+    T_ASSERT_STREQ(p, q);
+    T_ASSERT(!tbl_record_path("r", "../x", p, sizeof(p)));
+
+    /* nothing stored: empty walk, nothing to migrate */
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_record_each(repo, stop_cb, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    T_ASSERT_EQ_INT(tbl_record_migrate(repo, &moved, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(moved, 0UL);
+
+    /* a repo from before: every other record lies flat; both layouts read */
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        if (i % 2UL == 0UL) {
+            T_ASSERT(write_flat_ok(repo, &r));
+        } else {
+            T_ASSERT(tbl_record_write_repo(repo, &r, err, sizeof(err)) == 0);
+        }
+    }
+    T_ASSERT(all_read_ok(repo));
+    T_ASSERT(walk_ok(repo));
+    mk_rec(4UL, &r);
+    T_ASSERT(tbl_record_find_path(repo, r.job, p, sizeof(p)));
+    T_ASSERT(tbl_record_flat_path(repo, r.job, q, sizeof(q)));
+    T_ASSERT_STREQ(p, q);
+
+    /* rewriting a flat record moves it into its shard */
+    r.bytes = 4444UL;
+    T_ASSERT(tbl_record_write_repo(repo, &r, err, sizeof(err)) == 0);
+    ex = 1;
+    (void)tbl_fs_exists(q, &ex);
+    T_ASSERT_EQ_INT(ex, 0);
+    T_ASSERT_EQ_INT(tbl_record_read_repo(repo, r.job, &got, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(got.bytes, 4444UL);
+    r.bytes = 4UL;
+    T_ASSERT(tbl_record_write_repo(repo, &r, err, sizeof(err)) == 0);
+
+    /* a stale flat copy next to the shard (crash after the write) is shadowed */
+    mk_rec(7UL, &r);
+    T_ASSERT(tbl_record_flat_path(repo, r.job, q, sizeof(q)));
+    T_ASSERT(tbl_fs_write_file(q, "status=fail\nbytes=1\n", 20) == 0);
+    T_ASSERT(all_read_ok(repo));
+    T_ASSERT(walk_ok(repo));
+
+    /* callback stops the walk */
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_record_each(repo, stop_cb, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+
+    /* migrate: flat files move, the stale one is dropped; rerun is a no-op */
+    T_ASSERT_EQ_INT(tbl_record_migrate(repo, &moved, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(moved, N_JOBS / 2UL - 1UL);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "records"));
+    n = 0UL;
+    T_ASSERT(tbl_fs_list_dir(p, count_cb, &n) == 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    T_ASSERT(all_read_ok(repo));
+    T_ASSERT(walk_ok(repo));
+    T_ASSERT_EQ_INT(tbl_record_migrate(repo, &moved, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(moved, 0UL);
+
+    /* tags: sorted by key, keys folded to lower case, a key set twice
+       keeps the last value; the .ini carries them as tag.<key> lines */
+    mk_rec(9UL, &r);
+    T_ASSERT_EQ_INT(tbl_record_tag_set(&r, "retention", "10y"), 0);
+    T_ASSERT_EQ_INT(tbl_record_tag_set(&r, "Customer", "ACME"), 0);
+    T_ASSERT_EQ_INT(tbl_record_tag_set(&r, "doc.type", "invoice = final"), 0);
+    T_ASSERT_EQ_INT(tbl_record_tag_set(&r, "customer", "ACME GmbH"), 0);
+    T_ASSERT_STREQ(r.tags, "customer=ACME GmbH\ndoc.type=invoice = final\nretention=10y\n");
+    T_ASSERT(tbl_record_tag_set(&r, "bad key", "x") != 0);
+    T_ASSERT(tbl_record_tag_set(&r, "k", "") != 0);
+    T_ASSERT(tbl_record_tag_set(&r, "k", " padded") != 0);
+    T_ASSERT(tbl_record_tag_set(&r, "k", "two\nlines") != 0);
+    T_ASSERT(tbl_record_tag_set(&r, "k012345678901234567890123456789xy", "v") != 0);
+    T_ASSERT(tbl_record_write_repo(repo, &r, err, sizeof(err)) == 0);
+    T_ASSERT(tbl_record_find_path(repo, r.job, p, sizeof(p)));
+    T_ASSERT_EQ_INT(tbl_record_read_file(p, &got, err, sizeof(err)), 0);
+    T_ASSERT_STREQ(got.tags, r.tags);
+    T_ASSERT(tbl_record_tag_get_ok(&got, "doc.type", q, sizeof(q)));
+    T_ASSERT_STREQ(q, "invoice = final");
+    T_ASSERT(!tbl_record_tag_get_ok(&got, "doc", q, sizeof(q)));
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_record_tag_each(&got, tag_count_cb, &n), 0);
+    T_ASSERT_EQ_ULONG(n, 3UL);
+    /* no room left: the tag is refused, the others stay */
+    for (i = 0UL; i < 40UL; ++i) {
+        char key[16];
+        (void)tbl_strlcpy(key, "k", sizeof(key));
+        (void)tbl_ul_to_dec_ok(i, key + 1, sizeof(key) - 1U);
+        if (tbl_record_tag_set(&got, key, "0123456789") != 0) break;
+    }
+    T_ASSERT(i < 40UL);
+    T_ASSERT(strlen(got.tags) < sizeof(got.tags));
+    T_ASSERT(tbl_record_tag_get_ok(&got, "retention", q, sizeof(q)));
+
+    /* shards stay small: 600 records over 256 directories */
+    for (i = 0UL; i < TBL_RECORD_SHARDS; ++i) {
+        static const char hex[] = "0123456789abcdef";
+        char name[3];
+
+        name[0] = hex[(i >> 4) & 0xfUL];
+        name[1] = hex[i & 0xfUL];
+        name[2] = '\0';
+        T_ASSERT(tbl_path_join2(q, sizeof(q), p, name));
+        n = 0UL;
+        (void)tbl_fs_list_dir(q, count_cb, &n);
+        T_ASSERT(n <= 12UL);
+    }
+
+    /* the engine follows [records] store alone, not whether recjournal/ exists */
+    T_ASSERT(tbl_path_join2(q, sizeof(q), repo, "cfg"));
+    T_ASSERT(tbl_fs_mkdir_p(q) == 0);
+    T_ASSERT(use_cfg_ok("[records]\nstore = journal\n"));
+    mk_rec(1UL, &r);
+    T_ASSERT(tbl_record_write_repo(q, &r, err, sizeof(err)) == 0);
+    T_ASSERT(tbl_recjournal_active_ok(q));
+    T_ASSERT(tbl_record_path(q, "job-1", p, sizeof(p)));
+    ex = 1;
+    T_ASSERT(tbl_fs_exists(p, &ex) == 0);
+    T_ASSERT(ex == 0);
+    T_ASSERT(tbl_record_read_repo(q, "job-1", &got, err, sizeof(err)) == 0);
+    T_ASSERT(got.bytes == 1UL);
+
+    /* store = files: .ini files only, the journal is left alone */
+    T_ASSERT(use_cfg_ok("[records]\nstore = files\n"));
+    T_ASSERT(tbl_record_read_repo(q, "job-1", &got, err, sizeof(err)) != 0);
+    mk_rec(2UL, &r);
+    T_ASSERT(tbl_record_write_repo(q, &r, err, sizeof(err)) == 0);
+    ex = 0;
+    T_ASSERT(tbl_record_path(q, "job-2", p, sizeof(p)));
+    T_ASSERT(tbl_fs_exists(p, &ex) == 0);
+    T_ASSERT(ex == 1);
+    T_ASSERT(tbl_record_read_repo(q, "job-2", &got, err, sizeof(err)) == 0);
+
+    /* and back: job-2 is not in the journal yet, its .ini still answers */
+    T_ASSERT(use_cfg_ok("[records]\nstore = journal\n"));
+    T_ASSERT(tbl_record_read_repo(q, "job-1", &got, err, sizeof(err)) == 0);
+    T_ASSERT(tbl_record_read_repo(q, "job-2", &got, err, sizeof(err)) == 0);
+    tbl_record_set_store(TBL_RECORD_STORE_AUTO, 0);
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "recstore_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
+
+#define TBL_REFIDX_IMPLEMENTATION
+#include "core/refidx.h"
+
+#define TBL_SECIDX_IMPLEMENTATION
+#include "core/secidx.h"
+
+#define TBL_TGIDX_IMPLEMENTATION
+#include "core/tgidx.h"
+
+#define TBL_TAGIDX_IMPLEMENTATION
+#include "core/tagidx.h"
+
+#define TBL_RECSTORE_IMPLEMENTATION
+#include "core/recstore.h"
+
+static const char *const sha_a = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+
+static int count_job_cb(void *ud, const char *jobid)
+{
+    (void)jobid;
+    (*(unsigned long *)ud)++;
+    return 0;
+}
+
+static int count_tg_cb(void *ud, const char *jobid, const char *payload)
+{
+    (void)jobid;
+    (void)payload;
+    (*(unsigned long *)ud)++;
+    return 0;
+}
+
+static int count_rec_cb(void *ud, const tbl_record_t *rec)
+{
+    (void)rec;
+    (*(unsigned long *)ud)++;
+    return 0;
+}
+
+static void mk_rec(tbl_record_t *r, const char *doctype, unsigned long bytes)
+{
+    (void)memset(r, 0, sizeof(*r));
+    (void)tbl_strlcpy(r->job, "job-1", sizeof(r->job));
+    (void)tbl_strlcpy(r->status, "ok", sizeof(r->status));
+    (void)tbl_strlcpy(r->payload, "rechnung.pdf", sizeof(r->payload));
+    (void)tbl_strlcpy(r->sha256, sha_a, sizeof(r->sha256));
+    r->bytes = bytes;
+    r->stored_at = 1700000000UL;
+    (void)tbl_record_tag_set(r, "doctype", doctype);
+}
+
+int main(void)
+{
+    char repo[256];
+    char lock[512];
+    char err[256];
+    tbl_record_t r;
+    tbl_record_t got;
+    tbl_secidx_q_t q;
+    unsigned long n;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_recstore_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+
+    mk_rec(&r, "invoice", 3UL);
+    T_ASSERT_EQ_INT(tbl_recstore_write("", &r, err, sizeof(err)), 2);
+
+    /* one call: the record and every index */
+    T_ASSERT_EQ_INT(tbl_recstore_write(repo, &r, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_record_read_repo(repo, "job-1", &got, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, "job-1", &got, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(got.bytes, 3UL);
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_refidx_each(repo, sha_a, count_job_cb, &n, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+    (void)memset(&q, 0, sizeof(q));
+    q.by = TBL_SECIDX_BY_BYTES;
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_secidx_scan(repo, &q, count_rec_cb, &n, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_tgidx_find(repo, "RECHNUNG", count_tg_cb, &n, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_tagidx_each(repo, "doctype", "invoice", count_job_cb, &n, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+
+    /* stored again while records.lock cannot be opened: the record is
+       written, the failure reported, and no index serves the old one */
+    T_ASSERT(tbl_path_join2(lock, sizeof(lock), repo, "index/records.lock"));
+    T_ASSERT(tbl_fs_remove_file(lock) == 0);
+    T_ASSERT(tbl_fs_mkdir_p(lock) == 0);
+    mk_rec(&r, "letter", 5UL);
+    err[0] = '\0';
+    T_ASSERT_EQ_INT(tbl_recstore_write(repo, &r, err, sizeof(err)), 1);
+    T_ASSERT(err[0] != '\0');
+    T_ASSERT_EQ_INT(tbl_recidx_get(repo, "job-1", &got, err, sizeof(err)), 1);
+    T_ASSERT_EQ_INT(tbl_recidx_read(repo, "job-1", &got, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(got.bytes, 5UL);
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_tagidx_each(repo, "doctype", "invoice", count_job_cb, &n, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_tagidx_each(repo, "doctype", "letter", count_job_cb, &n, 0, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
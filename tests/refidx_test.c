@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "refidx_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
+
+/* small tail: the merge path runs during the test */
+#define TBL_REFIDX_TAIL_MAX 8192UL
+#define TBL_REFIDX_IMPLEMENTATION
+#include "core/refidx.h"
+
+#define N_JOBS 500UL
+#define N_OBJS 37UL
+
+typedef struct hits_s {
+    unsigned long n;
+    char last[64];
+    int ordered;
+} hits_t;
+
+static void mk_sha(unsigned long obj, char out[65])
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t k;
+
+    for (k = 0; k < 64U; ++k) out[k] = hex[(obj * 13UL + k * (obj | 1UL)) & 15UL];
+    out[0] = hex[obj & 15UL];
+    out[1] = hex[(obj >> 4) & 15UL];
+    out[64] = '\0';
+}
+
+static void mk_rec(unsigned long i, unsigned long obj, tbl_record_t *r)
+{
+    char nbuf[32];
+
+    (void)memset(r, 0, sizeof(*r));
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(r->job, "job-", sizeof(r->job));
+    (void)tbl_strlcat(r->job, nbuf, sizeof(r->job));
+    (void)tbl_strlcpy(r->status, "ok", sizeof(r->status));
+    (void)tbl_strlcpy(r->payload, "payload.bin", sizeof(r->payload));
+    mk_sha(obj, r->sha256);
+    r->bytes = 10UL;
+    r->stored_at = 1700000000UL + i;
+}
+
+static int store_ok(const char *repo, const tbl_record_t *r)
+{
+    return tbl_record_write_repo(repo, r, 0, 0) == 0 && tbl_recidx_put(repo, r, 0, 0) == 0 &&
+           tbl_refidx_add(repo, r->sha256, r->job, 0, 0) == 0;
+}
+
+static int first_cb(void *ud, const char *jobid)
+{
+    (void)jobid;
+    ((hits_t *)ud)->n++;
+    return 1;
+}
+
+static int hits_cb(void *ud, const char *jobid)
+{
+    hits_t *h = (hits_t *)ud;
+
+    if (h->n > 0UL && strcmp(h->last, jobid) >= 0) h->ordered = 0;
+    (void)tbl_strlcpy(h->last, jobid, sizeof(h->last));
+    h->n++;
+    return 0;
+}
+
+/* jobs i < njobs with i % N_OBJS == obj (job 3 moved to object 1 below) */
+static unsigned long want_jobs(unsigned long obj, unsigned long njobs, int moved)
+{
+    unsigned long i;
+    unsigned long n = 0UL;
+
+    for (i = 0UL; i < njobs; ++i) {
+        unsigned long o = (moved && i == 3UL) ? 1UL : i % N_OBJS;
+        if (o == obj) n++;
+    }
+    return n;
+}
+
+static int check_all(const char *repo, unsigned long njobs, int moved)
+{
+    char sha[65];
+    char err[256];
+    unsigned long obj;
+
+    for (obj = 0UL; obj < N_OBJS; ++obj) {
+        hits_t h;
+        unsigned long n;
+
+        (void)memset(&h, 0, sizeof(h));
+        h.ordered = 1;
+        mk_sha(obj, sha);
+        if (tbl_refidx_each(repo, sha, hits_cb, &h, &n, err, sizeof(err)) != 0) return 0;
+        if (n != h.n || n != want_jobs(obj, njobs, moved) || !h.ordered) return 0;
+    }
+    return 1;
+}
+
+int main(void)
+{
+    char repo[256];
+    char p[512];
+    char sha[65];
+    char err[256];
+    tbl_record_t r;
+    hits_t h;
+    unsigned long objects;
+    unsigned long refs;
+    unsigned long n;
+    unsigned long i;
+    int ex;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_refidx_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+
+    /* nothing indexed yet: no jobs, no error */
+    mk_sha(1UL, sha);
+    T_ASSERT_EQ_INT(tbl_refidx_each(repo, sha, hits_cb, &h, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    T_ASSERT_EQ_INT(tbl_refidx_each(repo, "abc", hits_cb, &h, &n, err, sizeof(err)), 2);
+    T_ASSERT_EQ_INT(tbl_refidx_add(repo, "xyz", "job-1", err, sizeof(err)), 2);
+
+    /* incremental adds; the tail outgrows its limit and is merged */
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, i % N_OBJS, &r);
+        T_ASSERT(store_ok(repo, &r));
+        if (i % 97UL == 0UL) T_ASSERT(check_all(repo, i + 1UL, 0));
+    }
+    T_ASSERT(check_all(repo, N_JOBS, 0));
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/refs.idx"));
+    ex = 0;
+    T_ASSERT(tbl_fs_exists(p, &ex) == 0);
+    T_ASSERT(ex);
+
+    /* upper-case digests name the same object */
+    mk_sha(5UL, sha);
+    for (i = 0; i < 64UL; ++i) {
+        if (sha[i] >= 'a' && sha[i] <= 'f') sha[i] = (char)(sha[i] - 'a' + 'A');
+    }
+    T_ASSERT_EQ_INT(tbl_refidx_each(repo, sha, hits_cb, &h, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, want_jobs(5UL, N_JOBS, 0));
+
+    /* re-ingest with another payload: the old digest drops the job */
+    mk_rec(3UL, 1UL, &r);
+    T_ASSERT(store_ok(repo, &r));
+    T_ASSERT(check_all(repo, N_JOBS, 1));
+
+    /* the same (digest, job) twice counts once */
+    T_ASSERT(store_ok(repo, &r));
+    T_ASSERT(check_all(repo, N_JOBS, 1));
+
+    /* full rebuild from records/; the tail is gone afterwards */
+    T_ASSERT_EQ_INT(tbl_refidx_build(repo, &objects, &refs, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(objects, N_OBJS);
+    T_ASSERT_EQ_ULONG(refs, N_JOBS);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/refs.idx.tail"));
+    ex = 1;
+    T_ASSERT(tbl_fs_exists(p, &ex) == 0);
+    T_ASSERT(!ex);
+    T_ASSERT(check_all(repo, N_JOBS, 1));
+
+    /* without records.idx the candidates are checked against the .ini */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/records.idx"));
+    T_ASSERT(tbl_fs_remove_file(p) == 0);
+    T_ASSERT(check_all(repo, N_JOBS, 1));
+
+    /* the callback stops the walk */
+    mk_sha(2UL, sha);
+    (void)memset(&h, 0, sizeof(h));
+    T_ASSERT_EQ_INT(tbl_refidx_each(repo, sha, first_cb, &h, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(h.n, 1UL);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+
+    /* a damaged refs.idx is reported, a rebuild repairs it */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/refs.idx"));
+    T_ASSERT(tbl_fs_write_file(p, "TBLREF1\ngarbage-garbage-garbage!", 32) == 0);
+    T_ASSERT_EQ_INT(tbl_refidx_each(repo, sha, hits_cb, &h, &n, err, sizeof(err)), 2);
+    T_ASSERT_EQ_INT(tbl_refidx_build(repo, &objects, &refs, err, sizeof(err)), 0);
+    T_ASSERT(check_all(repo, N_JOBS, 1));
+
+    /* empty repo: empty index */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "records"));
+    T_ASSERT(tbl_fs_rm_rf(p) == 0);
+    T_ASSERT_EQ_INT(tbl_refidx_build(repo, &objects, &refs, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(objects, 0UL);
+    T_ASSERT_EQ_ULONG(refs, 0UL);
+    T_ASSERT_EQ_INT(tbl_refidx_each(repo, sha, hits_cb, &h, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "scrub_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_TIME_IMPLEMENTATION
+#include "os/time.h"
+
+#define TBL_SHA256_IMPLEMENTATION
+#include "core/sha256.h"
+
+#define TBL_CAS_IMPLEMENTATION
+#include "core/cas.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
+
+#define TBL_JOBSTORE_IMPLEMENTATION
+#include "core/jobstore.h"
+
+#define TBL_EVENTS_IMPLEMENTATION
+#include "core/events.h"
+
+#define TBL_VERIFY_IMPLEMENTATION
+#include "core/verify.h"
+
+/* small, so checkpoints are written during the runs below */
+#define TBL_SCRUB_CP_EVERY 4UL
+#define TBL_SCRUB_IMPLEMENTATION
+#include "core/scrub.h"
+
+#define N_JOBS 20UL
+
+static const char *const missing_sha = "00000000000000000000000000000000000000000000000000000000000000ff";
+
+static int put_object_ok(const char *repo, const char *content, char *sha, size_t shasz)
+{
+    char src[512];
+
+    if (!tbl_path_join2(src, sizeof(src), repo, "src.tmp")) return 0;
+    if (tbl_fs_write_file(src, content, strlen(content)) != 0) return 0;
+    if (tbl_cas_put_file(repo, src, sha, shasz, 0, 0) != 0) return 0;
+    return tbl_fs_remove_file(src) == 0;
+}
+
+static int put_rec_ok(const char *repo, unsigned long i, const char *status, const char *sha)
+{
+    tbl_record_t r;
+    char nbuf[32];
+
+    (void)memset(&r, 0, sizeof(r));
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(r.job, (i < 10UL) ? "j0" : "j", sizeof(r.job));
+    (void)tbl_strlcat(r.job, nbuf, sizeof(r.job));
+    (void)tbl_strlcpy(r.status, status, sizeof(r.status));
+    (void)tbl_strlcpy(r.sha256, sha, sizeof(r.sha256));
+    (void)tbl_strlcpy(r.payload, "payload.bin", sizeof(r.payload));
+    r.bytes = 3UL;
+    r.stored_at = 1700000000UL;
+    return tbl_record_write_repo(repo, &r, 0, 0) == 0;
+}
+
+/* occurrences of needle in <repo>/events.log */
+static unsigned long count_events(const char *repo, const char *needle)
+{
+    char path[512];
+    char line[1024];
+    unsigned long n = 0UL;
+    FILE *fp;
+
+    if (!tbl_path_join2(path, sizeof(path), repo, "events.log")) return 0xffffUL;
+    fp = fopen(path, "rb");
+    if (!fp) return 0UL;
+    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+        if (strstr(line, needle) != NULL) n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+static int cp_exists(const char *repo)
+{
+    char path[512];
+    int ex = 0;
+
+    if (!tbl_path_join2(path, sizeof(path), repo, "cursors/verify-all")) return -1;
+    (void)tbl_fs_exists(path, &ex);
+    return ex;
+}
+
+static int write_cp_ok(const char *repo, const char *text)
+{
+    char path[512];
+
+    if (!tbl_path_join2(path, sizeof(path), repo, "cursors")) return 0;
+    if (tbl_fs_mkdir_p(path) != 0) return 0;
+    if (!tbl_path_join2(path, sizeof(path), repo, "cursors/verify-all")) return 0;
+    return tbl_fs_write_file(path, text, strlen(text)) == 0;
+}
+
+int main(void)
+{
+    char repo[256];
+    char err[256];
+    char sha_a[65];
+    char sha_b[65];
+    char sha_c[65];
+    char obj[1024];
+    tbl_scrub_stats_t st;
+    unsigned long i;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_scrub_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+
+    T_ASSERT(tbl_scrub_run("", TBL_SCRUB_RECORDS, 1UL, 0, 0, 0, &st, err, sizeof(err)) == 2);
+    T_ASSERT(tbl_scrub_run(repo, 7, 1UL, 0, 0, 0, &st, err, sizeof(err)) == 2);
+
+    /* empty repo: nothing to check, still one summary */
+    T_ASSERT_EQ_INT(tbl_scrub_run(repo, TBL_SCRUB_RECORDS, 2UL, 0, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.total, 0UL);
+    T_ASSERT_EQ_ULONG(count_events(repo, "verify-all"), 1UL);
+
+    T_ASSERT(put_object_ok(repo, "aaa", sha_a, sizeof(sha_a)));
+    T_ASSERT(put_object_ok(repo, "bbb", sha_b, sizeof(sha_b)));
+    T_ASSERT(put_object_ok(repo, "ccc", sha_c, sizeof(sha_c)));
+
+    /* j01 ok, j02 corrupt object, j03 object missing, j04 skipped,
+       j05 sha256 invalid, j06..j20 ok (one shared object) */
+    T_ASSERT(put_rec_ok(repo, 1UL, "ok", sha_a));
+    T_ASSERT(put_rec_ok(repo, 2UL, "ok", sha_b));
+    T_ASSERT(put_rec_ok(repo, 3UL, "ok", missing_sha));
+    T_ASSERT(put_rec_ok(repo, 4UL, "fail", sha_c));
+    T_ASSERT(put_rec_ok(repo, 5UL, "ok", "xyz"));
+    for (i = 6UL; i <= N_JOBS; ++i) T_ASSERT(put_rec_ok(repo, i, "ok", sha_c));
+    T_ASSERT(tbl_cas_object_path(repo, sha_b, obj, sizeof(obj)) == 1);
+    T_ASSERT(tbl_fs_write_file(obj, "zzzz", 4) == 0);
+
+    T_ASSERT_EQ_INT(tbl_scrub_run(repo, TBL_SCRUB_RECORDS, 4UL, 0, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.total, N_JOBS);
+    T_ASSERT_EQ_ULONG(st.resumed, 0UL);
+    T_ASSERT_EQ_ULONG(st.done, N_JOBS);
+    T_ASSERT_EQ_ULONG(st.ok, 16UL);
+    T_ASSERT_EQ_ULONG(st.failed, 3UL);
+    T_ASSERT_EQ_ULONG(st.errors, 0UL);
+    T_ASSERT_EQ_ULONG(st.skipped, 1UL);
+    T_ASSERT_EQ_ULONG(st.bytes, 16UL * 3UL + 4UL);
+    T_ASSERT_EQ_INT(cp_exists(repo), 0);
+
+    /* problems only, plus the summary */
+    T_ASSERT_EQ_ULONG(count_events(repo, "verify.fail"), 3UL);
+    T_ASSERT_EQ_ULONG(count_events(repo, "verify.ok"), 0UL);
+    T_ASSERT_EQ_ULONG(count_events(repo, "verify-all"), 2UL);
+    T_ASSERT_EQ_ULONG(count_events(repo, "records: 20 checked, 16 ok, 3 failed, 0 errors, 1 skipped"), 1UL);
+
+    /* resume after j10 of an interrupted pass: its totals carry over */
+    T_ASSERT(write_cp_ok(repo, "mode=records\nlast=j10\ndone=10\nok=6\nfailed=3\nerrors=0\nskipped=1\n"));
+    T_ASSERT_EQ_INT(tbl_scrub_run(repo, TBL_SCRUB_RECORDS, 2UL, 0, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.resumed, 10UL);
+    T_ASSERT_EQ_ULONG(st.done, N_JOBS);
+    T_ASSERT_EQ_ULONG(st.ok, 16UL);
+    T_ASSERT_EQ_ULONG(st.failed, 3UL);
+    T_ASSERT_EQ_ULONG(st.bytes, 10UL * 3UL);
+    T_ASSERT_EQ_ULONG(count_events(repo, "verify.fail"), 3UL);
+    T_ASSERT_EQ_INT(cp_exists(repo), 0);
+
+    /* full starts over; a checkpoint of the other mode or a broken one is ignored */
+    T_ASSERT(write_cp_ok(repo, "mode=records\nlast=j10\ndone=10\nok=6\nfailed=3\nerrors=0\nskipped=1\n"));
+    T_ASSERT_EQ_INT(tbl_scrub_run(repo, TBL_SCRUB_RECORDS, 2UL, 1, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.resumed, 0UL);
+    T_ASSERT_EQ_ULONG(st.ok, 16UL);
+    T_ASSERT(write_cp_ok(repo, "mode=objects\nlast=j10\ndone=10\nok=6\nfailed=3\nerrors=0\nskipped=1\n"));
+    T_ASSERT_EQ_INT(tbl_scrub_run(repo, TBL_SCRUB_RECORDS, 1UL, 0, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.resumed, 0UL);
+    T_ASSERT(write_cp_ok(repo, "mode=records\nlast=j10\ndone=x\n"));
+    T_ASSERT_EQ_INT(tbl_scrub_run(repo, TBL_SCRUB_RECORDS, 1UL, 0, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.resumed, 0UL);
+    T_ASSERT_EQ_ULONG(st.ok, 16UL);
+
+    /* objects: rehashed against their names, no records read */
+    T_ASSERT_EQ_INT(tbl_scrub_run(repo, TBL_SCRUB_OBJECTS, 0UL, 0, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.total, 3UL);
+    T_ASSERT_EQ_ULONG(st.ok, 2UL);
+    T_ASSERT_EQ_ULONG(st.failed, 1UL);
+    T_ASSERT_EQ_ULONG(st.skipped, 0UL);
+    T_ASSERT_EQ_ULONG(st.bytes, 3UL + 3UL + 4UL);
+    T_ASSERT_EQ_ULONG(count_events(repo, "objects: 3 checked, 2 ok, 1 failed"), 1UL);
+
+    /* repaired: a clean pass */
+    T_ASSERT(tbl_fs_write_file(obj, "bbb", 3) == 0);
+    T_ASSERT_EQ_INT(tbl_scrub_run(repo, TBL_SCRUB_OBJECTS, 2UL, 0, 0, 0, &st, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(st.ok, 3UL);
+    T_ASSERT_EQ_ULONG(st.failed, 0UL);
+    T_ASSERT_EQ_INT(cp_exists(repo), 0);
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
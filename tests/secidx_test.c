@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define T_TESTNAME "secidx_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
+
+/* small log and blocks: flushes, merges and block edges all run */
+#define TBL_SECIDX_TAIL_MAX 2048UL
+#define TBL_SECIDX_BLOCK 4
+#define TBL_SECIDX_IMPLEMENTATION
+#include "core/secidx.h"
+
+#define N_JOBS 1500UL
+
+static tbl_record_t g_recs[N_JOBS];
+static int g_by;
+
+static void mk_rec(unsigned long i, tbl_record_t *r)
+{
+    char nbuf[32];
+
+    (void)memset(r, 0, sizeof(*r));
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(r->job, "job-", sizeof(r->job));
+    (void)tbl_strlcat(r->job, nbuf, sizeof(r->job));
+    (void)tbl_strlcpy(r->status, (i % 7UL == 0UL) ? "fail" : (i % 11UL == 0UL) ? "held" : "ok", sizeof(r->status));
+    (void)tbl_strlcpy(r->payload, "payload.bin", sizeof(r->payload));
+    r->bytes = (i * 7919UL) % 5000UL;     /* repeats: ties broken by jobid */
+    r->stored_at = 1700000000UL + i / 3UL; /* three jobs per second */
+}
+
+static void keys(const tbl_record_t *r, unsigned long *a, unsigned long *b)
+{
+    *a = (g_by == TBL_SECIDX_BY_BYTES) ? r->bytes : r->stored_at;
+    *b = 0UL;
+    if (g_by == TBL_SECIDX_BY_STATUS) {
+        *b = *a;
+        *a = (unsigned long)tbl_secidx_code(r->status);
+    }
+}
+
+static int cmp_idx(const void *x, const void *y)
+{
+    const tbl_record_t *a = &g_recs[*(const unsigned long *)x];
+    const tbl_record_t *b = &g_recs[*(const unsigned long *)y];
+    unsigned long a1, a2, b1, b2;
+
+    keys(a, &a1, &a2);
+    keys(b, &b1, &b2);
+    if (a1 != b1) return (a1 < b1) ? -1 : 1;
+    if (a2 != b2) return (a2 < b2) ? -1 : 1;
+    return strcmp(a->job, b->job);
+}
+
+typedef struct got_s {
+    char jobs[N_JOBS][16];
+    unsigned long n;
+} got_t;
+
+static got_t g_got;
+
+static int got_cb(void *ud, const tbl_record_t *rec)
+{
+    got_t *g = (got_t *)ud;
+    if (g->n < N_JOBS) (void)tbl_strlcpy(g->jobs[g->n], rec->job, sizeof(g->jobs[0]));
+    g->n++;
+    return 0;
+}
+
+static int rec_match(const tbl_secidx_q_t *q, const tbl_record_t *r)
+{
+    if (q->status && !tbl_streq(r->status, q->status)) return 0;
+    if (q->since_set && r->stored_at < q->since) return 0;
+    if (q->until_set && r->stored_at >= q->until) return 0;
+    if (q->min_set && r->bytes < q->min_bytes) return 0;
+    if (q->max_set && r->bytes > q->max_bytes) return 0;
+    return 1;
+}
+
+/* scan result == brute force over g_recs, same order */
+static int check_q(const char *repo, const tbl_secidx_q_t *q)
+{
+    static unsigned long want[N_JOBS];
+    char err[256];
+    unsigned long n = 0UL;
+    unsigned long hits;
+    unsigned long i;
+
+    for (i = 0UL; i < N_JOBS; ++i) {
+        if (g_recs[i].job[0] && rec_match(q, &g_recs[i])) want[n++] = i;
+    }
+    g_by = q->by;
+    qsort(want, (size_t)n, sizeof(want[0]), cmp_idx);
+    if (q->limit && n > q->limit) {
+        if (q->desc) (void)memmove(want, want + (n - q->limit), (size_t)q->limit * sizeof(want[0]));
+        n = q->limit;
+    }
+    g_got.n = 0UL;
+    if (tbl_secidx_scan(repo, q, got_cb, &g_got, &hits, err, sizeof(err)) != 0) return 0;
+    if (hits != n || g_got.n != n) return 0;
+    for (i = 0UL; i < n; ++i) {
+        unsigned long w = q->desc ? want[n - 1UL - i] : want[i];
+        if (!tbl_streq(g_got.jobs[i], g_recs[w].job)) return 0;
+    }
+    return 1;
+}
+
+static int check_all(const char *repo)
+{
+    tbl_secidx_q_t q;
+
+    (void)memset(&q, 0, sizeof(q));
+    q.by = TBL_SECIDX_BY_TIME;
+    if (!check_q(repo, &q)) return 0;
+    q.since = 1700000100UL;
+    q.until = 1700000300UL;
+    q.since_set = 1;
+    q.until_set = 1;
+    if (!check_q(repo, &q)) return 0;
+    q.desc = 1;
+    if (!check_q(repo, &q)) return 0;
+
+    (void)memset(&q, 0, sizeof(q));
+    q.by = TBL_SECIDX_BY_STATUS;
+    q.status = "fail";
+    q.since = 1700000250UL;
+    q.since_set = 1;
+    if (!check_q(repo, &q)) return 0;
+    q.status = "held";
+    q.desc = 1;
+    q.limit = 10UL;
+    if (!check_q(repo, &q)) return 0;
+    q.status = "ok";
+    q.since_set = 0;
+    q.limit = 0UL;
+    if (!check_q(repo, &q)) return 0;
+
+    (void)memset(&q, 0, sizeof(q));
+    q.by = TBL_SECIDX_BY_BYTES;
+    q.desc = 1;
+    q.limit = 100UL;
+    if (!check_q(repo, &q)) return 0;
+    q.desc = 0;
+    q.limit = 0UL;
+    q.min_bytes = 1000UL;
+    q.max_bytes = 1200UL;
+    q.min_set = 1;
+    q.max_set = 1;
+    if (!check_q(repo, &q)) return 0;
+    q.status = "fail"; /* filter outside the key */
+    if (!check_q(repo, &q)) return 0;
+    return 1;
+}
+
+static int store_ok(const char *repo, const tbl_record_t *r)
+{
+    return tbl_record_write_repo(repo, r, 0, 0) == 0 && tbl_recidx_put(repo, r, 0, 0) == 0 &&
+           tbl_secidx_put(repo, r, 0, 0) == 0;
+}
+
+int main(void)
+{
+    char repo[256];
+    char p[512];
+    char err[256];
+    tbl_secidx_man_t man;
+    tbl_secidx_q_t q;
+    unsigned long hits;
+    unsigned long n;
+    unsigned long i;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_secidx_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/sec.manifest"));
+
+    /* nothing indexed: empty, not an error; a status scan needs a status */
+    (void)memset(&q, 0, sizeof(q));
+    T_ASSERT_EQ_INT(tbl_secidx_scan(repo, &q, got_cb, &g_got, &hits, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(hits, 0UL);
+    q.by = TBL_SECIDX_BY_STATUS;
+    T_ASSERT_EQ_INT(tbl_secidx_scan(repo, &q, got_cb, &g_got, &hits, err, sizeof(err)), 2);
+
+    /* incremental writes: log flushes into runs, runs merge */
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &g_recs[i]);
+        T_ASSERT(store_ok(repo, &g_recs[i]));
+        if (i % 211UL == 0UL) T_ASSERT(check_all(repo));
+    }
+    T_ASSERT(check_all(repo));
+    T_ASSERT(tbl_secidx_man_read(p, &man));
+    T_ASSERT(man.nruns >= 1UL && man.nruns <= 12UL);
+
+    /* re-ingested jobs leave stale entries behind; scans drop them */
+    for (i = 0UL; i < N_JOBS; i += 13UL) {
+        (void)tbl_strlcpy(g_recs[i].status, "fail", sizeof(g_recs[i].status));
+        g_recs[i].bytes += 77UL;
+        g_recs[i].stored_at += 1000UL;
+        T_ASSERT(store_ok(repo, &g_recs[i]));
+    }
+    T_ASSERT(check_all(repo));
+
+    /* the same record written twice is reported once */
+    T_ASSERT(store_ok(repo, &g_recs[5]));
+    T_ASSERT(store_ok(repo, &g_recs[5]));
+    T_ASSERT(check_all(repo));
+
+    /* callback stops the walk */
+    (void)memset(&q, 0, sizeof(q));
+    q.by = TBL_SECIDX_BY_TIME;
+    q.limit = 3UL;
+    g_got.n = 0UL;
+    T_ASSERT_EQ_INT(tbl_secidx_scan(repo, &q, got_cb, &g_got, &hits, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(hits, 3UL);
+    T_ASSERT_STREQ(g_got.jobs[0], "job-1");
+
+    /* without records.idx the hits are checked against the .ini */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/records.idx"));
+    T_ASSERT(tbl_fs_remove_file(p) == 0);
+    T_ASSERT(check_all(repo));
+
+    /* a damaged run is reported; a rebuild from records/ repairs it */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/sec.manifest"));
+    T_ASSERT(tbl_secidx_man_read(p, &man));
+    T_ASSERT(man.nruns >= 1UL);
+    {
+        tbl_secidx_paths_t sp;
+        char rp[1100];
+        FILE *fp;
+        unsigned char c;
+
+        T_ASSERT(tbl_secidx_paths(repo, &sp));
+        T_ASSERT(tbl_secidx_run_path(&sp, man.seq[0], 0, rp, sizeof(rp)));
+        fp = fopen(rp, "r+b");
+        T_ASSERT(fp != NULL);
+        T_ASSERT(fseek(fp, -20L, SEEK_END) == 0);
+        T_ASSERT(fread(&c, 1, 1, fp) == 1U);
+        c ^= 0x5a;
+        T_ASSERT(fseek(fp, -20L, SEEK_END) == 0);
+        T_ASSERT(fwrite(&c, 1, 1, fp) == 1U);
+        T_ASSERT(fclose(fp) == 0);
+    }
+    (void)memset(&q, 0, sizeof(q));
+    T_ASSERT_EQ_INT(tbl_secidx_scan(repo, &q, got_cb, &g_got, &hits, err, sizeof(err)), 2);
+    T_ASSERT_EQ_INT(tbl_secidx_build(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, N_JOBS);
+    T_ASSERT(tbl_secidx_man_read(p, &man));
+    T_ASSERT_EQ_ULONG(man.nruns, 1UL);
+    T_ASSERT(check_all(repo));
+
+    /* empty repo: empty index */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "records"));
+    T_ASSERT(tbl_fs_rm_rf(p) == 0);
+    for (i = 0UL; i < N_JOBS; ++i) g_recs[i].job[0] = '\0';
+    T_ASSERT_EQ_INT(tbl_secidx_build(repo, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 0UL);
+    T_ASSERT(check_all(repo));
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
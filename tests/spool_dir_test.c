@@ -14,6 +14,9 @@
 #define TBL_FS_IMPLEMENTATION
 #include "os/fs.h"
 
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
 #define TBL_SPOOL_IMPLEMENTATION
 #include "core/spool.h"
 
@@ -0,0 +1,137 @@
+#define T_TESTNAME "spool_prune_test"
+#include "test.h"
+
+#include <time.h>
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_SPOOL_IMPLEMENTATION
+#include "core/spool.h"
+
+static int mk_tmp_base(char *out, size_t outsz)
+{
+    char num[16];
+
+    if (!out || outsz == 0) return 0;
+    out[0] = '\0';
+
+    if (!tbl_u32_to_dec_ok(tbl_fs_pid_u32(), num, sizeof(num))) return 0;
+
+    if (tbl_strlcpy(out, "tbl_test_spool_prune_", outsz) >= outsz) return 0;
+    if (tbl_strlcat(out, num, outsz) >= outsz) return 0;
+    return 1;
+}
+
+static int mk_job(const char *dir, const char *name)
+{
+    char job[512];
+    char f[512];
+
+    if (!tbl_path_join2(job, sizeof(job), dir, name)) return 0;
+    if (tbl_fs_mkdir_p(job) != 0) return 0;
+    if (!tbl_path_join2(f, sizeof(f), job, "payload.bin")) return 0;
+    if (tbl_fs_write_file(f, "x", 1) != 0) return 0;
+    if (!tbl_path_join2(f, sizeof(f), job, "job.meta")) return 0;
+    if (tbl_fs_write_file(f, "status=ok\n", 10) != 0) return 0;
+    return 1;
+}
+
+static int path_exists(const char *a, const char *b)
+{
+    char p[512];
+    int ex;
+
+    if (!tbl_path_join2(p, sizeof(p), a, b)) return -1;
+    ex = 0;
+    (void)tbl_fs_exists(p, &ex);
+    return ex;
+}
+
+int main(void)
+{
+    char base_dir[256];
+    char spool_root[512];
+    char old_day[512];
+    char err[256];
+    char today[16];
+    tbl_spool_t sp;
+    unsigned long removed;
+    unsigned long now;
+    time_t t;
+    struct tm *tmv;
+    int rc;
+
+    T_ASSERT(mk_tmp_base(base_dir, sizeof(base_dir)) == 1);
+    (void)tbl_fs_rm_rf(base_dir);
+    T_ASSERT(tbl_fs_mkdir_p(base_dir) == 0);
+    T_ASSERT(tbl_path_join2(spool_root, sizeof(spool_root), base_dir, "spool") == 1);
+
+    err[0] = '\0';
+    T_ASSERT_EQ_INT(tbl_spool_init(&sp, spool_root, err, sizeof(err)), TBL_SPOOL_OK);
+    T_ASSERT_EQ_INT(sp.date_buckets, 0);
+
+    /* date-bucketed commit: claim/jobA -> out/YYYY/MM/DD/jobA */
+    sp.date_buckets = 1;
+    T_ASSERT(mk_job(sp.claim, "jobA") == 1);
+    T_ASSERT_EQ_INT(tbl_spool_commit_out(&sp, "jobA", err, sizeof(err)), TBL_SPOOL_OK);
+    T_ASSERT_EQ_INT(path_exists(sp.claim, "jobA"), 0);
+
+    t = time(NULL);
+    tmv = gmtime(&t);
+    T_ASSERT(tmv != NULL);
+    T_ASSERT(tbl_u32_to_dec_ok((unsigned long)(tmv->tm_year + 1900), today, sizeof(today)) == 1);
+    T_ASSERT_EQ_INT(path_exists(sp.out, today), 1);
+
+    T_ASSERT(mk_job(sp.claim, "jobB") == 1);
+    T_ASSERT_EQ_INT(tbl_spool_commit_fail(&sp, "jobB", err, sizeof(err)), TBL_SPOOL_OK);
+    T_ASSERT_EQ_INT(path_exists(sp.fail, today), 1);
+
+    /* an old bucket (2000-01-01) and a flat job (mtime = now) */
+    T_ASSERT(tbl_path_join2(old_day, sizeof(old_day), sp.out, "2000/01/01") == 1);
+    T_ASSERT(mk_job(old_day, "old1") == 1);
+    T_ASSERT(mk_job(old_day, "old2") == 1);
+    T_ASSERT(mk_job(sp.fail, "flat1") == 1);
+    /* a flat job named like a year is no bucket */
+    T_ASSERT(mk_job(sp.fail, "2024") == 1);
+
+    /* cutoff 2001-09-09: only the 2000-01-01 bucket expires */
+    removed = 0UL;
+    rc = tbl_spool_prune(&sp, 1000000000UL, 4UL, &removed, err, sizeof(err));
+    T_ASSERT_EQ_INT(rc, TBL_SPOOL_OK);
+    T_ASSERT_EQ_ULONG(removed, 2UL);
+    T_ASSERT_EQ_INT(path_exists(sp.out, "2000"), 0);
+    T_ASSERT_EQ_INT(path_exists(sp.out, today), 1);
+    T_ASSERT_EQ_INT(path_exists(sp.fail, "flat1"), 1);
+    T_ASSERT_EQ_INT(path_exists(sp.fail, "2024"), 1);
+
+    /* cutoff in the future: everything expires, buckets are cleaned up */
+    now = (unsigned long)time(NULL);
+    removed = 0UL;
+    rc = tbl_spool_prune(&sp, now + 3UL * 86400UL, 0UL, &removed, err, sizeof(err));
+    T_ASSERT_EQ_INT(rc, TBL_SPOOL_OK);
+    T_ASSERT_EQ_ULONG(removed, 4UL);
+    T_ASSERT_EQ_INT(path_exists(sp.out, today), 0);
+    T_ASSERT_EQ_INT(path_exists(sp.fail, today), 0);
+    T_ASSERT_EQ_INT(path_exists(sp.fail, "flat1"), 0);
+    T_ASSERT_EQ_INT(path_exists(sp.fail, "2024"), 0);
+    T_ASSERT_EQ_INT(path_exists(spool_root, "out"), 1);
+
+    /* empty spool: nothing to do */
+    removed = 1UL;
+    rc = tbl_spool_prune(&sp, now, 1UL, &removed, err, sizeof(err));
+    T_ASSERT_EQ_INT(rc, TBL_SPOOL_OK);
+    T_ASSERT_EQ_ULONG(removed, 0UL);
+
+    (void)tbl_fs_rm_rf(base_dir);
+    T_OK();
+}
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "tagidx_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+#define TBL_RECIDX_IMPLEMENTATION
+#include "core/recidx.h"
+
+/* small tail: the merge path runs during the test */
+#define TBL_TAGIDX_TAIL_MAX 8192UL
+#define TBL_TAGIDX_IMPLEMENTATION
+#include "core/tagidx.h"
+
+#define N_JOBS 500UL
+#define N_CUSTOMERS 7UL
+
+typedef struct hits_s {
+    unsigned long n;
+    char last[256];
+    int ordered;
+} hits_t;
+
+/* job-<i>: customer c<i % 7>, every 3rd an invoice, every 50th untagged */
+static void mk_rec(unsigned long i, tbl_record_t *r)
+{
+    char nbuf[32];
+
+    (void)memset(r, 0, sizeof(*r));
+    (void)tbl_ul_to_dec_ok(i, nbuf, sizeof(nbuf));
+    (void)tbl_strlcpy(r->job, "job-", sizeof(r->job));
+    (void)tbl_strlcat(r->job, nbuf, sizeof(r->job));
+    (void)tbl_strlcpy(r->status, "ok", sizeof(r->status));
+    (void)tbl_strlcpy(r->payload, "payload.bin", sizeof(r->payload));
+    r->stored_at = 1700000000UL + i;
+    if (i % 50UL == 0UL) return;
+    (void)tbl_strlcpy(nbuf, "c", sizeof(nbuf));
+    (void)tbl_ul_to_dec_ok(i % N_CUSTOMERS, nbuf + 1, sizeof(nbuf) - 1U);
+    (void)tbl_record_tag_set(r, "customer", nbuf);
+    (void)tbl_record_tag_set(r, "doctype", (i % 3UL == 0UL) ? "invoice" : "letter");
+}
+
+static unsigned long want_n(const char *key, const char *value)
+{
+    tbl_record_t r;
+    char v[TBL_RECORD_TAG_VALUE_MAX + 1];
+    unsigned long n = 0UL;
+    unsigned long i;
+
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        if (tbl_record_tag_get_ok(&r, key, v, sizeof(v)) && tbl_streq(v, value)) n++;
+    }
+    return n;
+}
+
+static int hit_cb(void *ud, const char *jobid)
+{
+    hits_t *h = (hits_t *)ud;
+
+    if (h->n > 0UL && strcmp(h->last, jobid) >= 0) h->ordered = 0;
+    (void)tbl_strlcpy(h->last, jobid, sizeof(h->last));
+    h->n++;
+    return 0;
+}
+
+static int first_cb(void *ud, const char *jobid)
+{
+    (void)jobid;
+    ++*(unsigned long *)ud;
+    return 1;
+}
+
+static int each_ok(const char *repo, const char *key, const char *value, unsigned long want)
+{
+    hits_t h;
+    char err[256];
+    unsigned long n;
+
+    (void)memset(&h, 0, sizeof(h));
+    h.ordered = 1;
+    if (tbl_tagidx_each(repo, key, value, hit_cb, &h, &n, err, sizeof(err)) != 0) return 0;
+    return h.n == want && n == want && h.ordered;
+}
+
+static int store_ok(const char *repo, const tbl_record_t *r)
+{
+    return tbl_record_write_repo(repo, r, 0, 0) == 0 && tbl_recidx_put(repo, r, 0, 0) == 0 &&
+           tbl_tagidx_add(repo, r, 0, 0) == 0;
+}
+
+int main(void)
+{
+    char repo[256];
+    char p[1024];
+    char err[256];
+    tbl_record_t r;
+    unsigned long vals;
+    unsigned long tags;
+    unsigned long n;
+    unsigned long i;
+    int ex;
+    FILE *fp;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_tagidx_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+
+    /* no index yet: nothing found, no error; bad tags are refused */
+    T_ASSERT(each_ok(repo, "customer", "c1", 0UL));
+    T_ASSERT(tbl_tagidx_each(repo, "bad key", "x", hit_cb, 0, &n, err, sizeof(err)) != 0);
+    T_ASSERT(tbl_tagidx_each(repo, "customer", "", hit_cb, 0, &n, err, sizeof(err)) != 0);
+
+    /* the first half through the tail (merged on the way), the rest as
+       records only, then a build */
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        if (i < N_JOBS / 2UL) {
+            T_ASSERT(store_ok(repo, &r));
+        } else {
+            T_ASSERT(tbl_record_write_repo(repo, &r, err, sizeof(err)) == 0);
+        }
+        if (i % 50UL == 49UL && i < N_JOBS / 2UL) {
+            unsigned long k;
+            unsigned long w = 0UL;
+
+            for (k = 0UL; k <= i; ++k) {
+                if (k % 50UL != 0UL && k % N_CUSTOMERS == 3UL) w++;
+            }
+            T_ASSERT(each_ok(repo, "customer", "c3", w));
+        }
+    }
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/tags.idx"));
+    ex = 0;
+    (void)tbl_fs_exists(p, &ex);
+    T_ASSERT(ex);
+
+    T_ASSERT_EQ_INT(tbl_tagidx_build(repo, &vals, &tags, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(vals, N_CUSTOMERS + 2UL);
+    T_ASSERT_EQ_ULONG(tags, 2UL * (N_JOBS - N_JOBS / 50UL));
+    for (i = 0UL; i < N_CUSTOMERS; ++i) {
+        char v[16];
+
+        (void)tbl_strlcpy(v, "c", sizeof(v));
+        (void)tbl_ul_to_dec_ok(i, v + 1, sizeof(v) - 1U);
+        T_ASSERT(each_ok(repo, "customer", v, want_n("customer", v)));
+    }
+    T_ASSERT(each_ok(repo, "doctype", "invoice", want_n("doctype", "invoice")));
+    T_ASSERT(each_ok(repo, "DocType", "letter", want_n("doctype", "letter")));
+    T_ASSERT(each_ok(repo, "customer", "C1", 0UL));
+    T_ASSERT(each_ok(repo, "region", "eu", 0UL));
+
+    /* stop early */
+    n = 0UL;
+    T_ASSERT_EQ_INT(tbl_tagidx_each(repo, "doctype", "invoice", first_cb, &n, &vals, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+
+    /* stored again with another customer: the old entry no longer counts */
+    mk_rec(1UL, &r);
+    T_ASSERT_EQ_INT(tbl_record_tag_set(&r, "customer", "ACME GmbH"), 0);
+    T_ASSERT(store_ok(repo, &r));
+    T_ASSERT(each_ok(repo, "customer", "ACME GmbH", 1UL));
+    T_ASSERT(each_ok(repo, "customer", "c1", want_n("customer", "c1") - 1UL));
+    T_ASSERT(each_ok(repo, "doctype", "letter", want_n("doctype", "letter")));
+
+    /* a damaged index is reported; the build replaces it */
+    fp = fopen(p, "r+b");
+    T_ASSERT(fp != 0);
+    T_ASSERT(fseek(fp, 20L, SEEK_SET) == 0);
+    T_ASSERT(fputc(0x7f, fp) != EOF);
+    T_ASSERT(fclose(fp) == 0);
+    T_ASSERT(tbl_tagidx_each(repo, "customer", "c1", hit_cb, 0, &n, err, sizeof(err)) != 0);
+    T_ASSERT_EQ_INT(tbl_tagidx_build(repo, &vals, &tags, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(vals, N_CUSTOMERS + 3UL);
+    T_ASSERT(each_ok(repo, "customer", "ACME GmbH", 1UL));
+
+    /* no tags anywhere: an empty index */
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "records"));
+    T_ASSERT(tbl_fs_rm_rf(p) == 0);
+    T_ASSERT_EQ_INT(tbl_tagidx_build(repo, &vals, &tags, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(vals, 0UL);
+    T_ASSERT(each_ok(repo, "customer", "ACME GmbH", 0UL));
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
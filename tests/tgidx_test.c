@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <string.h>
+
+#define T_TESTNAME "tgidx_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_RECJOURNAL_IMPLEMENTATION
+#include "core/recjournal.h"
+
+#define TBL_RECORD_IMPLEMENTATION
+#include "core/record.h"
+
+/* small tail: the merge path runs during the test */
+#define TBL_TGIDX_TAIL_MAX 4096UL
+#define TBL_TGIDX_IMPLEMENTATION
+#include "core/tgidx.h"
+
+#define N_JOBS 400UL
+
+typedef struct hits_s {
+    unsigned long n;
+    char last[256];
+    char pay[64];
+    int ordered;
+} hits_t;
+
+/* scan batches: "SCAN-<batch>-<page>", every 7th payload a scan.tif */
+static void mk_rec(unsigned long i, tbl_record_t *r)
+{
+    char nbuf[32];
+
+    (void)memset(r, 0, sizeof(*r));
+    (void)tbl_strlcpy(r->job, "SCAN-", sizeof(r->job));
+    (void)tbl_ul_to_dec_ok(20260400UL + i / 10UL, nbuf, sizeof(nbuf));
+    (void)tbl_strlcat(r->job, nbuf, sizeof(r->job));
+    (void)tbl_strlcat(r->job, "-p", sizeof(r->job));
+    (void)tbl_ul_to_dec_ok(i % 10UL, nbuf, sizeof(nbuf));
+    (void)tbl_strlcat(r->job, nbuf, sizeof(r->job));
+    (void)tbl_strlcpy(r->status, "ok", sizeof(r->status));
+    (void)tbl_strlcpy(r->payload, (i % 7UL == 0UL) ? "Scan.TIF" : "payload.bin", sizeof(r->payload));
+    r->stored_at = 1700000000UL + i;
+}
+
+static int hit_cb(void *ud, const char *jobid, const char *payload)
+{
+    hits_t *h = (hits_t *)ud;
+
+    if (h->n > 0UL && strcmp(h->last, jobid) >= 0) h->ordered = 0;
+    (void)tbl_strlcpy(h->last, jobid, sizeof(h->last));
+    (void)tbl_strlcpy(h->pay, payload, sizeof(h->pay));
+    h->n++;
+    return 0;
+}
+
+static int first_cb(void *ud, const char *jobid, const char *payload)
+{
+    (void)jobid;
+    (void)payload;
+    ((hits_t *)ud)->n++;
+    return 1;
+}
+
+/* matches of frag, checked against a plain scan over the records */
+static int find_ok(const char *repo, const char *frag, unsigned long want)
+{
+    hits_t h;
+    char err[256];
+    unsigned long n;
+
+    (void)memset(&h, 0, sizeof(h));
+    h.ordered = 1;
+    if (tbl_tgidx_find(repo, frag, hit_cb, &h, &n, err, sizeof(err)) != 0) return 0;
+    return h.n == want && n == want && h.ordered;
+}
+
+static unsigned long brute(const char *frag)
+{
+    tbl_record_t r;
+    char low[64];
+    unsigned long n = 0UL;
+    unsigned long i;
+    size_t k;
+
+    for (k = 0; frag[k]; ++k) low[k] = (char)((frag[k] >= 'A' && frag[k] <= 'Z') ? frag[k] - 'A' + 'a' : frag[k]);
+    low[k] = '\0';
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        if (tbl_tgidx_contains(r.job, low, k) || tbl_tgidx_contains(r.payload, low, k)) n++;
+    }
+    return n;
+}
+
+int main(void)
+{
+    char repo[256];
+    char p[1024];
+    char err[256];
+    tbl_record_t r;
+    hits_t h;
+    unsigned long jobs;
+    unsigned long grams;
+    unsigned long n;
+    unsigned long i;
+    int ex = 0;
+    FILE *fp;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(repo, "tbl_test_tgidx_", sizeof(repo));
+        (void)tbl_strlcat(repo, nbuf, sizeof(repo));
+    }
+    (void)tbl_fs_rm_rf(repo);
+    T_ASSERT(tbl_fs_mkdir_p(repo) == 0);
+
+    /* no index yet: nothing found, no error */
+    T_ASSERT(find_ok(repo, "scan", 0UL));
+    T_ASSERT(tbl_tgidx_find(repo, "", hit_cb, &h, &n, err, sizeof(err)) != 0);
+    T_ASSERT(tbl_tgidx_add(repo, "a/b", "x", err, sizeof(err)) != 0);
+    T_ASSERT(tbl_tgidx_add(repo, "job", "bad\nname", err, sizeof(err)) != 0);
+
+    /* the first half through the tail (merged on the way), then a build */
+    for (i = 0UL; i < N_JOBS; ++i) {
+        mk_rec(i, &r);
+        T_ASSERT(tbl_record_write_repo(repo, &r, err, sizeof(err)) == 0);
+        if (i < N_JOBS / 2UL) T_ASSERT(tbl_tgidx_add(repo, r.job, r.payload, err, sizeof(err)) == 0);
+        if (i % 50UL == 49UL) T_ASSERT(find_ok(repo, "-p9", (i < N_JOBS / 2UL) ? (i + 1UL) / 10UL : N_JOBS / 20UL));
+    }
+    T_ASSERT(tbl_path_join2(p, sizeof(p), repo, "index/trigram.idx"));
+    T_ASSERT(tbl_fs_exists(p, &ex) == 0 && ex);
+    T_ASSERT(find_ok(repo, "scan.tif", (N_JOBS / 2UL + 6UL) / 7UL));
+
+    T_ASSERT_EQ_INT(tbl_tgidx_build(repo, &jobs, &grams, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(jobs, N_JOBS);
+    T_ASSERT(grams > 20UL);
+
+    /* trigram lookups, short fragments and case agree with a plain scan */
+    T_ASSERT(find_ok(repo, "2026041", brute("2026041")));
+    T_ASSERT_EQ_ULONG(brute("2026041"), 100UL);
+    T_ASSERT(find_ok(repo, "20260417-p3", 1UL));
+    T_ASSERT(find_ok(repo, "scan.tif", brute("scan.tif")));
+    T_ASSERT(find_ok(repo, "SCAN-", N_JOBS));
+    T_ASSERT(find_ok(repo, "p3", brute("p3")));
+    T_ASSERT(find_ok(repo, "f", brute("f")));
+    T_ASSERT(find_ok(repo, "0439-p", 10UL));
+    T_ASSERT(find_ok(repo, "tif.", 0UL));
+    T_ASSERT(find_ok(repo, "20260499", 0UL));
+
+    /* stop early */
+    (void)memset(&h, 0, sizeof(h));
+    T_ASSERT_EQ_INT(tbl_tgidx_find(repo, "scan", first_cb, &h, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(h.n, 1UL);
+    T_ASSERT_EQ_ULONG(n, 1UL);
+
+    /* a job stored again with another payload: the tail line wins */
+    T_ASSERT(tbl_tgidx_add(repo, "SCAN-20260400-p1", "rescan.pdf", err, sizeof(err)) == 0);
+    T_ASSERT(tbl_tgidx_add(repo, "manual-upload", "Invoice.PDF", err, sizeof(err)) == 0);
+    T_ASSERT(find_ok(repo, ".pdf", 2UL));
+    (void)memset(&h, 0, sizeof(h));
+    h.ordered = 1;
+    T_ASSERT_EQ_INT(tbl_tgidx_find(repo, "20260400-p1", hit_cb, &h, &n, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(h.n, 1UL);
+    T_ASSERT_STREQ(h.pay, "rescan.pdf");
+    T_ASSERT(find_ok(repo, "payload", brute("payload") - 1UL));
+
+    /* a damaged index is reported; the build replaces it */
+    fp = fopen(p, "r+b");
+    T_ASSERT(fp != 0);
+    T_ASSERT(fseek(fp, 16L, SEEK_SET) == 0);
+    T_ASSERT(fputc(0x7f, fp) != EOF);
+    T_ASSERT(fclose(fp) == 0);
+    T_ASSERT(tbl_tgidx_find(repo, "scan", hit_cb, &h, &n, err, sizeof(err)) != 0);
+    T_ASSERT_EQ_INT(tbl_tgidx_build(repo, &jobs, &grams, err, sizeof(err)), 0);
+    T_ASSERT(find_ok(repo, "2026041", 100UL));
+    T_ASSERT(find_ok(repo, "invoice", 0UL));
+
+    (void)tbl_fs_rm_rf(repo);
+    T_OK();
+}
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define T_TESTNAME "tlz_test"
+#include "test.h"
+
+#define TBL_SAFE_IMPLEMENTATION
+#include "core/safe.h"
+
+#define TBL_STR_IMPLEMENTATION
+#include "core/str.h"
+
+#define TBL_PATH_IMPLEMENTATION
+#include "core/path.h"
+
+#define TBL_FS_IMPLEMENTATION
+#include "os/fs.h"
+
+#define TBL_THREAD_IMPLEMENTATION
+#include "os/thread.h"
+
+#define TBL_TLZ_IMPLEMENTATION
+#include "core/tlz.h"
+
+/* log-like lines: shared structure, varying numbers, pseudo-random hex */
+static size_t mk_text(char *out, size_t cap, unsigned long nlines)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned long seed = 12345UL;
+    unsigned long i;
+    size_t n = 0;
+
+    for (i = 0UL; i < nlines; ++i) {
+        char nbuf[32];
+        char line[256];
+        size_t k;
+        size_t l;
+
+        (void)tbl_strlcpy(line, "prev=", sizeof(line));
+        l = strlen(line);
+        for (k = 0; k < 16U; ++k) {
+            seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+            line[l++] = hex[(seed >> 16) & 15UL];
+        }
+        line[l] = '\0';
+        (void)tbl_strlcat(line, " ts=", sizeof(line));
+        (void)tbl_ul_to_dec_ok(1700000000UL + i, nbuf, sizeof(nbuf));
+        (void)tbl_strlcat(line, nbuf, sizeof(line));
+        (void)tbl_strlcat(line, (i % 3UL) ? " event=ingest.ok job=job" : " event=verify.fail job=job", sizeof(line));
+        (void)tbl_ul_to_dec_ok(i % 97UL, nbuf, sizeof(nbuf));
+        (void)tbl_strlcat(line, nbuf, sizeof(line));
+        (void)tbl_strlcat(line, " status=ok\n", sizeof(line));
+        l = strlen(line);
+        if (n + l > cap) break;
+        (void)memcpy(out + n, line, l);
+        n += l;
+    }
+    return n;
+}
+
+static int roundtrip_ok(const unsigned char *src, size_t n)
+{
+    unsigned char *c;
+    unsigned char *d;
+    size_t cn;
+    int ok;
+
+    c = (unsigned char *)malloc(tbl_tlz_bound(n));
+    d = (unsigned char *)malloc(n ? n : 1U);
+    if (!c || !d) {
+        free(c);
+        free(d);
+        return 0;
+    }
+    cn = tbl_tlz_compress(src, n, c, tbl_tlz_bound(n));
+    ok = (n == 0 || cn > 0) && tbl_tlz_decompress_ok(c, cn, d, n) && memcmp(src, d, n) == 0;
+    free(c);
+    free(d);
+    return ok;
+}
+
+int main(void)
+{
+    char root[256];
+    char src[512];
+    char dst[512];
+    char err[256];
+    char *text;
+    char *back;
+    unsigned char *c;
+    size_t n;
+    size_t cn;
+    size_t i;
+    unsigned long raw;
+    unsigned long comp;
+    unsigned long t;
+    tbl_tlz_t z;
+
+    {
+        char nbuf[32];
+        if (!tbl_ul_to_dec_ok(tbl_fs_pid_u32(), nbuf, sizeof(nbuf))) {
+            (void)tbl_strlcpy(nbuf, "0", sizeof(nbuf));
+        }
+        (void)tbl_strlcpy(root, "tbl_test_tlz_", sizeof(root));
+        (void)tbl_strlcat(root, nbuf, sizeof(root));
+    }
+    (void)tbl_fs_rm_rf(root);
+    T_ASSERT(tbl_fs_mkdir_p(root) == 0);
+    T_ASSERT(tbl_path_join2(src, sizeof(src), root, "ops.000001.log"));
+    T_ASSERT(tbl_path_join2(dst, sizeof(dst), root, "ops.000001.log.tlz"));
+
+    text = (char *)malloc(3000000U);
+    back = (char *)malloc(3000000U);
+    c = (unsigned char *)malloc(tbl_tlz_bound(3000000U));
+    T_ASSERT(text && back && c);
+
+    /* codec: edge cases and runs (overlapping matches) */
+    T_ASSERT(roundtrip_ok((const unsigned char *)"", 0));
+    T_ASSERT(roundtrip_ok((const unsigned char *)"a", 1));
+    T_ASSERT(roundtrip_ok((const unsigned char *)"abcdabcdabcdabcdabcdabcd", 24));
+    (void)memset(text, 'z', 100000U);
+    T_ASSERT(roundtrip_ok((const unsigned char *)text, 100000U));
+    n = mk_text(text, 200000U, 100000UL);
+    T_ASSERT(roundtrip_ok((const unsigned char *)text, n));
+    cn = tbl_tlz_compress((const unsigned char *)text, n, c, tbl_tlz_bound(n));
+    T_ASSERT(cn > 0 && cn < n / 2U);
+
+    /* damaged input never overruns: every truncation and a flipped byte fail */
+    for (i = 0; i + 1U < cn; i += 97U) {
+        T_ASSERT(!tbl_tlz_decompress_ok(c, i, (unsigned char *)back, n));
+    }
+    c[cn / 2U] ^= 0x5a;
+    T_ASSERT(!tbl_tlz_decompress_ok(c, cn, (unsigned char *)back, n) || memcmp(back, text, n) != 0);
+
+    /* frame: whole-line blocks, any worker count gives the same bytes */
+    n = mk_text(text, 3000000U, 100000UL);
+    T_ASSERT(n > 2U * TBL_TLZ_BLOCK_MAX);
+    T_ASSERT(tbl_fs_write_file(src, text, n) == 0);
+    for (t = 1UL; t <= 4UL; t += 3UL) {
+        T_ASSERT_EQ_INT(tbl_tlz_compress_file(src, dst, t, &raw, &comp, err, sizeof(err)), 0);
+        T_ASSERT_EQ_ULONG(raw, (unsigned long)n);
+        T_ASSERT(comp < raw / 2UL);
+
+        T_ASSERT_EQ_INT(tbl_tlz_open(&z, dst, err, sizeof(err)), 0);
+        T_ASSERT_EQ_ULONG(z.raw_size, (unsigned long)n);
+        T_ASSERT(z.nblocks > 2UL);
+        for (i = 0; i < (size_t)z.nblocks; ++i) {
+            const tbl_tlz_ent_t *e = &z.ent[i];
+            T_ASSERT(text[e->raw_off + e->raw_len - 1UL] == '\n');
+        }
+        /* random access, across block borders */
+        T_ASSERT(tbl_tlz_pread_ok(&z, 0UL, back, n));
+        T_ASSERT(memcmp(back, text, n) == 0);
+        T_ASSERT(tbl_tlz_pread_ok(&z, z.ent[1].raw_off - 10UL, back, 20U));
+        T_ASSERT(memcmp(back, text + z.ent[1].raw_off - 10UL, 20U) == 0);
+        T_ASSERT(!tbl_tlz_pread_ok(&z, (unsigned long)n - 1UL, back, 2U));
+        tbl_tlz_close(&z);
+    }
+
+    /* a damaged block is caught by its checksum */
+    {
+        FILE *fp;
+        long at;
+
+        T_ASSERT_EQ_INT(tbl_tlz_open(&z, dst, err, sizeof(err)), 0);
+        at = (long)(z.ent[1].comp_off + z.ent[1].comp_len / 2UL);
+        tbl_tlz_close(&z);
+        fp = fopen(dst, "r+b");
+        T_ASSERT(fp != NULL);
+        T_ASSERT(fseek(fp, at, SEEK_SET) == 0);
+        T_ASSERT(fputc('#', fp) != EOF);
+        fclose(fp);
+
+        T_ASSERT_EQ_INT(tbl_tlz_open(&z, dst, err, sizeof(err)), 0);
+        T_ASSERT(tbl_tlz_pread_ok(&z, 0UL, back, 100U));
+        T_ASSERT(!tbl_tlz_pread_ok(&z, z.ent[1].raw_off, back, 100U));
+        tbl_tlz_close(&z);
+    }
+
+    /* not a frame */
+    T_ASSERT(tbl_tlz_open(&z, src, err, sizeof(err)) != 0);
+    T_ASSERT(err[0] != '\0');
+
+    /* empty file and a file without a final LF */
+    T_ASSERT(tbl_fs_write_file(src, "", 0) == 0);
+    T_ASSERT_EQ_INT(tbl_tlz_compress_file(src, dst, 2UL, &raw, &comp, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_tlz_open(&z, dst, err, sizeof(err)), 0);
+    T_ASSERT_EQ_ULONG(z.nblocks, 0UL);
+    tbl_tlz_close(&z);
+    T_ASSERT(tbl_fs_write_file(src, "line\ntail", 9) == 0);
+    T_ASSERT_EQ_INT(tbl_tlz_compress_file(src, dst, 2UL, &raw, &comp, err, sizeof(err)), 0);
+    T_ASSERT_EQ_INT(tbl_tlz_open(&z, dst, err, sizeof(err)), 0);
+    T_ASSERT(tbl_tlz_pread_ok(&z, 0UL, back, 9U));
+    T_ASSERT(memcmp(back, "line\ntail", 9) == 0);
+    tbl_tlz_close(&z);
+
+    free(text);
+    free(back);
+    free(c);
+    (void)tbl_fs_rm_rf(root);
+    T_OK();
+}